@@ -389,16 +389,20 @@ static bool collectDeviceMetrics( void )
                     metricsCollectorStatus ) );
     }
 
-    /* Collect a list of open TCP ports. */
+    /* Collect a list of open TCP ports and a list of established
+     * connections, both from a single read of the TCP socket table. */
     if( metricsCollectorStatus == MetricsCollectorSuccess )
     {
-        metricsCollectorStatus = GetOpenTcpPorts( &( openTcpPorts[ 0 ] ),
-                                                  OPEN_TCP_PORTS_ARRAY_SIZE,
-                                                  &( numOpenTcpPorts ) );
+        metricsCollectorStatus = GetOpenTcpPortsAndEstablishedConnections( &( openTcpPorts[ 0 ] ),
+                                                                           OPEN_TCP_PORTS_ARRAY_SIZE,
+                                                                           &( numOpenTcpPorts ),
+                                                                           &( establishedConnections[ 0 ] ),
+                                                                           ESTABLISHED_CONNECTIONS_ARRAY_SIZE,
+                                                                           &( numEstablishedConnections ) );
 
         if( metricsCollectorStatus != MetricsCollectorSuccess )
         {
-            LogError( ( "GetOpenTcpPorts failed. Status: %d.",
+            LogError( ( "GetOpenTcpPortsAndEstablishedConnections failed. Status: %d.",
                         metricsCollectorStatus ) );
         }
     }
@@ -417,20 +421,6 @@ static bool collectDeviceMetrics( void )
         }
     }
 
-    /* Collect a list of established connections. */
-    if( metricsCollectorStatus == MetricsCollectorSuccess )
-    {
-        metricsCollectorStatus = GetEstablishedConnections( &( establishedConnections[ 0 ] ),
-                                                            ESTABLISHED_CONNECTIONS_ARRAY_SIZE,
-                                                            &( numEstablishedConnections ) );
-
-        if( metricsCollectorStatus != MetricsCollectorSuccess )
-        {
-            LogError( ( "GetEstablishedConnections failed. Status: %d.",
-                        metricsCollectorStatus ) );
-        }
-    }
-
     /* Collect uptime from the system.
      * This is an example of a custom metric of number type. */
     if( metricsCollectorStatus == MetricsCollectorSuccess )
@@ -825,6 +815,9 @@ int main( int argc,
         }
     } while( exitStatus != EXIT_SUCCESS );
 
+    /* Close the files the metrics were collected from. */
+    CloseMetricsCollector();
+
     /* Log demo success. */
     if( exitStatus == EXIT_SUCCESS )
     {
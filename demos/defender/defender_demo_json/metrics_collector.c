@@ -25,16 +25,23 @@
  *
  * @brief This file provides an implementation of the metrics_collector interface
  * for Linux systems.
+ *
+ * The /proc files are opened on first use and kept open. Each collection
+ * reads a file with pread from offset 0 into a buffer shared by all the files,
+ * and parses its lines in place without sscanf, stopping as soon as the
+ * outputs are full. The functions are not thread safe.
  */
 
 /* Standard includes. */
-#include <stdio.h>
-#include <ctype.h>
+#include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 
 /* POSIX includes. */
 #include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 /* Demo config. */
 #include "demo_config.h"
@@ -43,10 +50,15 @@
 #include "metrics_collector.h"
 
 /**
- * @brief The maximum length of line read from any of /proc/net/dev, /proc/net/tcp,
- * /proc/net/udp, /proc/uptime, /proc/meminfo, /proc/stat, and /proc/net/arp files.
+ * @brief Size of the buffer that the /proc files are read into. The buffer is
+ * doubled whenever a line does not fit, and kept for the next collections.
+ */
+#define READ_BUFFER_INITIAL_SIZE         ( 4096U )
+
+/**
+ * @brief Length of the buffers that network interface names are written into.
  */
-#define MAX_LINE_LENGTH                  ( 256 )
+#define NETWORK_INTERFACE_NAME_LENGTH    ( 16U )
 
 /**
  * @brief Various connection status.
@@ -55,125 +67,602 @@
 #define CONNECTION_STATUS_ESTABLISHED    ( 1 )
 
 /**
- * @brief Get a list of the open ports.
+ * @brief The /proc files read by the metrics collector.
+ */
+typedef enum ProcFile
+{
+    ProcFileNetDev = 0,
+    ProcFileNetTcp,
+    ProcFileNetUdp,
+    ProcFileUptime,
+    ProcFileMeminfo,
+    ProcFileStat,
+    ProcFileNetArp,
+    ProcFileCount
+} ProcFile_t;
+
+/**
+ * @brief Reads the lines of a /proc file through #pReadBuffer.
+ */
+typedef struct ProcFileReader
+{
+    ProcFile_t procFile;             /**< The file. */
+    size_t fileOffset;               /**< Offset in the file of the next read. */
+    size_t lineStart;                /**< Start in #pReadBuffer of the next line. */
+    size_t bufferedLength;           /**< Length of the data in #pReadBuffer. */
+    bool isEndOfFile;                /**< Whether the whole file was read. */
+    MetricsCollectorStatus_t status; /**< Whether opening or reading the file failed. */
+} ProcFileReader_t;
+
+/**
+ * @brief A line of /proc/net/tcp or /proc/net/udp.
+ */
+typedef struct SocketEntry
+{
+    uint32_t localIp;    /**< Local address, as printed by the kernel. */
+    uint32_t localPort;  /**< Local port. */
+    uint32_t remoteIp;   /**< Remote address, as printed by the kernel. */
+    uint32_t remotePort; /**< Remote port. */
+    uint32_t state;      /**< Connection status. */
+} SocketEntry_t;
+
+/**
+ * @brief Paths of the /proc files, by #ProcFile_t.
+ */
+static const char * const procFilePaths[ ProcFileCount ] =
+{
+    "/proc/net/dev",
+    "/proc/net/tcp",
+    "/proc/net/udp",
+    "/proc/uptime",
+    "/proc/meminfo",
+    "/proc/stat",
+    "/proc/net/arp"
+};
+
+/**
+ * @brief File descriptors of the /proc files, by #ProcFile_t, or -1 for a
+ * file not opened yet.
+ */
+static int procFileDescriptors[ ProcFileCount ] = { -1, -1, -1, -1, -1, -1, -1 };
+
+/**
+ * @brief Buffer that the /proc files are read into.
+ */
+static char * pReadBuffer = NULL;
+
+/**
+ * @brief Size of #pReadBuffer.
+ */
+static size_t readBufferSize = 0;
+
+/**
+ * @brief Start reading a /proc file from its beginning, opening it if needed.
+ *
+ * @param[out] pReader The reader to start.
+ * @param[in] procFile The file to read.
+ *
+ * @return #MetricsCollectorSuccess if the file is open;
+ * #MetricsCollectorFileOpenFailed if the file could not be opened.
+ */
+static MetricsCollectorStatus_t startProcFile( ProcFileReader_t * pReader,
+                                               ProcFile_t procFile );
+
+/**
+ * @brief Read the next line of a /proc file.
+ *
+ * @param[in] pReader The reader.
+ * @param[out] ppLine Start of the line, valid until the next read.
+ * @param[out] ppLineEnd End of the line, before its newline character.
+ *
+ * @return true if a line was read; false at the end of the file, or if the
+ * file could not be read, in which case the status of @p pReader is
+ * #MetricsCollectorFileReadFailed.
+ */
+static bool readProcLine( ProcFileReader_t * pReader,
+                          const char ** ppLine,
+                          const char ** ppLineEnd );
+
+/**
+ * @brief Move a cursor past spaces and tabs.
+ *
+ * @param[in,out] ppCursor The cursor.
+ * @param[in] pEnd End of the line.
+ */
+static void skipSpaces( const char ** ppCursor,
+                        const char * pEnd );
+
+/**
+ * @brief Move a cursor past spaces and the field that follows them.
  *
- * This function finds the open ports by reading pProcFile. It can be called
- * with pOutPortsArray NULL to get the number of the open ports.
+ * @param[in,out] ppCursor The cursor.
+ * @param[in] pEnd End of the line.
  *
- * @param[in] pProcFile The file to read from; either /proc/net/tcp or /proc/net/udp.
+ * @return true if there was a field to skip; false otherwise.
+ */
+static bool skipField( const char ** ppCursor,
+                       const char * pEnd );
+
+/**
+ * @brief Move a cursor past an expected character.
+ *
+ * @param[in,out] ppCursor The cursor.
+ * @param[in] pEnd End of the line.
+ * @param[in] expected The character.
+ *
+ * @return true if the cursor was on @p expected; false otherwise.
+ */
+static bool skipCharacter( const char ** ppCursor,
+                           const char * pEnd,
+                           char expected );
+
+/**
+ * @brief Parse a hexadecimal number of up to 8 digits and move a cursor past
+ * it.
+ *
+ * @param[in,out] ppCursor The cursor.
+ * @param[in] pEnd End of the line.
+ * @param[out] pValue The number.
+ *
+ * @return true if a number was parsed; false if there is no digit at the
+ * cursor.
+ */
+static bool parseHex( const char ** ppCursor,
+                      const char * pEnd,
+                      uint32_t * pValue );
+
+/**
+ * @brief Skip spaces, parse a decimal number and move a cursor past it.
+ *
+ * @param[in,out] ppCursor The cursor.
+ * @param[in] pEnd End of the line.
+ * @param[out] pValue The number.
+ *
+ * @return true if a number was parsed; false if there is no digit after the
+ * spaces.
+ */
+static bool parseDecimal( const char ** ppCursor,
+                          const char * pEnd,
+                          uint64_t * pValue );
+
+/**
+ * @brief Parse a line of /proc/net/tcp or /proc/net/udp.
+ *
+ * @param[in] pLine Start of the line.
+ * @param[in] pLineEnd End of the line.
+ * @param[out] pSocketEntry The socket described by the line.
+ *
+ * @return true if the line was parsed; false otherwise.
+ */
+static bool parseSocketEntry( const char * pLine,
+                              const char * pLineEnd,
+                              SocketEntry_t * pSocketEntry );
+
+/**
+ * @brief Get the open ports and the established connections from a socket
+ * table in a single pass.
+ *
+ * Either output can be skipped by passing NULL for its count. An output
+ * array can be NULL if only the count is needed; otherwise the count stops at
+ * the length of the array. The file is read only until the outputs are full.
+ *
+ * @param[in] procFile The file to read from; either /proc/net/tcp or /proc/net/udp.
  * @param[in] pOutPortsArray The array to write the open ports into. Can be
  * NULL, if only number of open ports is needed.
  * @param[in] portsArrayLength Length of the pOutPortsArray, if it is not NULL.
- * @param[out] pOutNumOpenPorts Number of the open ports.
+ * @param[out] pOutNumOpenPorts Number of the open ports, or NULL.
+ * @param[in] pOutConnectionsArray The array to write the established
+ * connections into. Can be NULL, if only number of connections is needed.
+ * @param[in] connectionsArrayLength Length of the pOutConnectionsArray, if it
+ * is not NULL.
+ * @param[out] pOutNumEstablishedConnections Number of established connections,
+ * or NULL.
  *
- * @return #MetricsCollectorSuccess if open ports are successfully obtained;
- * #MetricsCollectorBadParameter if invalid parameters are passed;
- * #MetricsCollectorFileOpenFailed if the function fails to open pProcFile;
+ * @return #MetricsCollectorSuccess if the socket table is successfully read;
+ * #MetricsCollectorFileOpenFailed if the function fails to open the file;
+ * #MetricsCollectorFileReadFailed if the function fails to read the file;
  * MetricsCollectorParsingFailed if the function fails to parses the data read
- * from pProcFile.
+ * from the file.
  */
-static MetricsCollectorStatus_t getOpenPorts( const char * pProcFile,
-                                              uint16_t * pOutPortsArray,
-                                              uint32_t portsArrayLength,
-                                              uint32_t * pOutNumOpenPorts );
+static MetricsCollectorStatus_t readSocketTable( ProcFile_t procFile,
+                                                 uint16_t * pOutPortsArray,
+                                                 uint32_t portsArrayLength,
+                                                 uint32_t * pOutNumOpenPorts,
+                                                 Connection_t * pOutConnectionsArray,
+                                                 uint32_t connectionsArrayLength,
+                                                 uint32_t * pOutNumEstablishedConnections );
 /*-----------------------------------------------------------*/
 
-static MetricsCollectorStatus_t getOpenPorts( const char * pProcFile,
-                                              uint16_t * pOutPortsArray,
-                                              uint32_t portsArrayLength,
-                                              uint32_t * pOutNumOpenPorts )
+static MetricsCollectorStatus_t startProcFile( ProcFileReader_t * pReader,
+                                               ProcFile_t procFile )
 {
-    MetricsCollectorStatus_t status = MetricsCollectorSuccess;
-    FILE * fileHandle = NULL;
-    uint32_t lineNumber = 0;
-    int32_t filledVariables;
-    uint32_t connectionStatus, localPort, numOpenPorts = 0;
-    char lineBuffer[ MAX_LINE_LENGTH ];
-
-    if( ( pProcFile == NULL ) ||
-        ( ( pOutPortsArray != NULL ) && ( portsArrayLength == 0 ) ) ||
-        ( pOutNumOpenPorts == NULL ) )
-    {
-        LogError( ( "Invalid parameters. pProcFile: %p, pOutPortsArray: %p,"
-                    " portsArrayLength: %u, pOutNumOpenPorts: %p.",
-                    ( const void * ) pProcFile,
-                    ( void * ) pOutPortsArray,
-                    portsArrayLength,
-                    ( void * ) pOutNumOpenPorts ) );
-        status = MetricsCollectorBadParameter;
-    }
-
-    if( status == MetricsCollectorSuccess )
+    pReader->procFile = procFile;
+    pReader->fileOffset = 0;
+    pReader->lineStart = 0;
+    pReader->bufferedLength = 0;
+    pReader->isEndOfFile = false;
+    pReader->status = MetricsCollectorSuccess;
+
+    if( procFileDescriptors[ procFile ] < 0 )
     {
-        fileHandle = fopen( pProcFile, "r" );
+        procFileDescriptors[ procFile ] = open( procFilePaths[ procFile ], O_RDONLY | O_CLOEXEC );
 
-        if( fileHandle == NULL )
+        if( procFileDescriptors[ procFile ] < 0 )
         {
-            LogError( ( "Failed to open %s.", pProcFile ) );
-            status = MetricsCollectorFileOpenFailed;
+            LogError( ( "Failed to open %s.", procFilePaths[ procFile ] ) );
+            pReader->status = MetricsCollectorFileOpenFailed;
         }
     }
 
-    if( status == MetricsCollectorSuccess )
+    return pReader->status;
+}
+/*-----------------------------------------------------------*/
+
+static bool readProcLine( ProcFileReader_t * pReader,
+                          const char ** ppLine,
+                          const char ** ppLineEnd )
+{
+    bool hasLine = false, isDone = false;
+    const char * pNewline;
+    size_t newBufferSize;
+    ssize_t bytesRead;
+    char * pNewBuffer;
+
+    while( ( pReader->status == MetricsCollectorSuccess ) && ( hasLine == false ) && ( isDone == false ) )
     {
-        while( fgets( &( lineBuffer[ 0 ] ), MAX_LINE_LENGTH, fileHandle ) != NULL )
-        {
-            lineNumber++;
+        pNewline = NULL;
 
-            LogDebug( ( "File: %s, Line: %u, Content: %s.",
-                        pProcFile,
-                        lineNumber,
-                        &( lineBuffer[ 0 ] ) ) );
+        if( pReader->lineStart < pReader->bufferedLength )
+        {
+            pNewline = memchr( &( pReadBuffer[ pReader->lineStart ] ),
+                               '\n',
+                               pReader->bufferedLength - pReader->lineStart );
+        }
 
-            /* Skip the first line as it is a header. */
-            if( lineNumber <= 1 )
+        if( ( pNewline != NULL ) ||
+            ( ( pReader->isEndOfFile == true ) && ( pReader->lineStart < pReader->bufferedLength ) ) )
+        {
+            /* The last line may have no newline character. */
+            *ppLine = &( pReadBuffer[ pReader->lineStart ] );
+            *ppLineEnd = ( pNewline != NULL ) ? pNewline : &( pReadBuffer[ pReader->bufferedLength ] );
+            pReader->lineStart = ( size_t ) ( *ppLineEnd - pReadBuffer ) + 1U;
+            hasLine = true;
+        }
+        else if( pReader->isEndOfFile == true )
+        {
+            isDone = true;
+        }
+        else
+        {
+            /* Move the unfinished line to the start of the buffer, and grow
+             * the buffer if the line fills it. */
+            if( pReader->lineStart > 0U )
             {
-                continue;
+                pReader->bufferedLength -= pReader->lineStart;
+                memmove( pReadBuffer, &( pReadBuffer[ pReader->lineStart ] ), pReader->bufferedLength );
+                pReader->lineStart = 0;
             }
 
-            /* Parse the output. */
-            filledVariables = sscanf( &( lineBuffer[ 0 ] ),
-                                      "%*[^:]: %*8x:%4x %*8x:%*4x %2x",
-                                      &( localPort ),
-                                      &( connectionStatus ) );
-
-            /* sscanf should fill all the 2 variables successfully. */
-            if( filledVariables != 2 )
+            if( pReader->bufferedLength == readBufferSize )
             {
-                LogError( ( "Failed to parse %s.", &( lineBuffer[ 0 ] ) ) );
-                status = MetricsCollectorParsingFailed;
-                break;
+                newBufferSize = ( readBufferSize == 0U ) ? READ_BUFFER_INITIAL_SIZE : ( readBufferSize * 2U );
+                pNewBuffer = realloc( pReadBuffer, newBufferSize );
+
+                if( pNewBuffer == NULL )
+                {
+                    LogError( ( "Failed to allocate %lu bytes to read %s.",
+                                ( unsigned long ) newBufferSize,
+                                procFilePaths[ pReader->procFile ] ) );
+                    pReader->status = MetricsCollectorFileReadFailed;
+                }
+                else
+                {
+                    pReadBuffer = pNewBuffer;
+                    readBufferSize = newBufferSize;
+                }
             }
 
-            if( connectionStatus == CONNECTION_STATUS_LISTEN )
+            if( pReader->status == MetricsCollectorSuccess )
             {
-                if( pOutPortsArray != NULL )
+                /* The kernel generates a /proc file as it is read, and may
+                 * return less than asked for before the end of the file, so
+                 * only an empty read ends it. Reading from offset 0 makes the
+                 * kernel generate the file again. */
+                bytesRead = pread( procFileDescriptors[ pReader->procFile ],
+                                   &( pReadBuffer[ pReader->bufferedLength ] ),
+                                   readBufferSize - pReader->bufferedLength,
+                                   ( off_t ) pReader->fileOffset );
+
+                if( bytesRead > 0 )
                 {
-                    pOutPortsArray[ numOpenPorts ] = ( uint16_t ) localPort;
-                    numOpenPorts++;
-
-                    /* Break if the output array is full. */
-                    if( portsArrayLength == numOpenPorts )
-                    {
-                        break;
-                    }
+                    pReader->bufferedLength += ( size_t ) bytesRead;
+                    pReader->fileOffset += ( size_t ) bytesRead;
+                }
+                else if( bytesRead == 0 )
+                {
+                    pReader->isEndOfFile = true;
+                }
+                else if( errno != EINTR )
+                {
+                    LogError( ( "Failed to read %s. errno: %d.",
+                                procFilePaths[ pReader->procFile ],
+                                errno ) );
+                    pReader->status = MetricsCollectorFileReadFailed;
                 }
                 else
                 {
-                    numOpenPorts++;
+                    /* Empty else MISRA 15.7 */
                 }
             }
         }
     }
 
+    return hasLine;
+}
+/*-----------------------------------------------------------*/
+
+static void skipSpaces( const char ** ppCursor,
+                        const char * pEnd )
+{
+    const char * pCursor = *ppCursor;
+
+    while( ( pCursor < pEnd ) && ( ( *pCursor == ' ' ) || ( *pCursor == '\t' ) ) )
+    {
+        pCursor++;
+    }
+
+    *ppCursor = pCursor;
+}
+/*-----------------------------------------------------------*/
+
+static bool skipField( const char ** ppCursor,
+                       const char * pEnd )
+{
+    const char * pCursor;
+    const char * pFieldStart;
+
+    skipSpaces( ppCursor, pEnd );
+    pCursor = *ppCursor;
+    pFieldStart = pCursor;
+
+    while( ( pCursor < pEnd ) && ( *pCursor != ' ' ) && ( *pCursor != '\t' ) )
+    {
+        pCursor++;
+    }
+
+    *ppCursor = pCursor;
+
+    return pCursor > pFieldStart;
+}
+/*-----------------------------------------------------------*/
+
+static bool skipCharacter( const char ** ppCursor,
+                           const char * pEnd,
+                           char expected )
+{
+    bool isSkipped = false;
+
+    if( ( *ppCursor < pEnd ) && ( **ppCursor == expected ) )
+    {
+        ( *ppCursor )++;
+        isSkipped = true;
+    }
+
+    return isSkipped;
+}
+/*-----------------------------------------------------------*/
+
+static bool parseHex( const char ** ppCursor,
+                      const char * pEnd,
+                      uint32_t * pValue )
+{
+    const char * pCursor = *ppCursor;
+    uint32_t value = 0, digit = 0, numDigits = 0;
+    bool isDigit = true;
+
+    while( ( pCursor < pEnd ) && ( numDigits < 8U ) && ( isDigit == true ) )
+    {
+        if( ( *pCursor >= '0' ) && ( *pCursor <= '9' ) )
+        {
+            digit = ( uint32_t ) ( *pCursor - '0' );
+        }
+        else if( ( *pCursor >= 'A' ) && ( *pCursor <= 'F' ) )
+        {
+            digit = ( uint32_t ) ( *pCursor - 'A' ) + 10U;
+        }
+        else if( ( *pCursor >= 'a' ) && ( *pCursor <= 'f' ) )
+        {
+            digit = ( uint32_t ) ( *pCursor - 'a' ) + 10U;
+        }
+        else
+        {
+            isDigit = false;
+        }
+
+        if( isDigit == true )
+        {
+            value = ( value << 4 ) | digit;
+            numDigits++;
+            pCursor++;
+        }
+    }
+
+    *ppCursor = pCursor;
+    *pValue = value;
+
+    return numDigits > 0U;
+}
+/*-----------------------------------------------------------*/
+
+static bool parseDecimal( const char ** ppCursor,
+                          const char * pEnd,
+                          uint64_t * pValue )
+{
+    const char * pCursor;
+    const char * pNumberStart;
+    uint64_t value = 0;
+
+    skipSpaces( ppCursor, pEnd );
+    pCursor = *ppCursor;
+    pNumberStart = pCursor;
+
+    while( ( pCursor < pEnd ) && ( *pCursor >= '0' ) && ( *pCursor <= '9' ) )
+    {
+        value = ( value * 10U ) + ( uint64_t ) ( *pCursor - '0' );
+        pCursor++;
+    }
+
+    *ppCursor = pCursor;
+    *pValue = value;
+
+    return pCursor > pNumberStart;
+}
+/*-----------------------------------------------------------*/
+
+static bool parseSocketEntry( const char * pLine,
+                              const char * pLineEnd,
+                              SocketEntry_t * pSocketEntry )
+{
+    const char * pCursor = memchr( pLine, ':', ( size_t ) ( pLineEnd - pLine ) );
+    bool isParsed = false;
+
+    /* The line starts with "sl: local_address rem_address st", where the
+     * addresses are "IP:PORT" in hexadecimal. */
+    if( pCursor != NULL )
+    {
+        pCursor++;
+        skipSpaces( &pCursor, pLineEnd );
+        isParsed = ( parseHex( &pCursor, pLineEnd, &( pSocketEntry->localIp ) ) == true ) &&
+                   ( skipCharacter( &pCursor, pLineEnd, ':' ) == true ) &&
+                   ( parseHex( &pCursor, pLineEnd, &( pSocketEntry->localPort ) ) == true );
+    }
+
+    if( isParsed == true )
+    {
+        skipSpaces( &pCursor, pLineEnd );
+        isParsed = ( parseHex( &pCursor, pLineEnd, &( pSocketEntry->remoteIp ) ) == true ) &&
+                   ( skipCharacter( &pCursor, pLineEnd, ':' ) == true ) &&
+                   ( parseHex( &pCursor, pLineEnd, &( pSocketEntry->remotePort ) ) == true );
+    }
+
+    if( isParsed == true )
+    {
+        skipSpaces( &pCursor, pLineEnd );
+        isParsed = parseHex( &pCursor, pLineEnd, &( pSocketEntry->state ) );
+    }
+
+    return isParsed;
+}
+/*-----------------------------------------------------------*/
+
+static MetricsCollectorStatus_t readSocketTable( ProcFile_t procFile,
+                                                 uint16_t * pOutPortsArray,
+                                                 uint32_t portsArrayLength,
+                                                 uint32_t * pOutNumOpenPorts,
+                                                 Connection_t * pOutConnectionsArray,
+                                                 uint32_t connectionsArrayLength,
+                                                 uint32_t * pOutNumEstablishedConnections )
+{
+    MetricsCollectorStatus_t status;
+    ProcFileReader_t reader;
+    uint32_t lineNumber = 0;
+    const char * pLine = NULL;
+    const char * pLineEnd = NULL;
+    SocketEntry_t socketEntry;
+    Connection_t * pEstablishedConnection;
+    uint32_t numOpenPorts = 0, numEstablishedConnections = 0;
+    bool arePortsFull, areConnectionsFull;
+
+    /* An output is full once its array is, or if it is not wanted. */
+    arePortsFull = ( pOutNumOpenPorts == NULL );
+    areConnectionsFull = ( pOutNumEstablishedConnections == NULL );
+
+    status = startProcFile( &reader, procFile );
+
+    while( ( status == MetricsCollectorSuccess ) &&
+           ( ( arePortsFull == false ) || ( areConnectionsFull == false ) ) &&
+           ( readProcLine( &reader, &pLine, &pLineEnd ) == true ) )
+    {
+        lineNumber++;
+
+        LogDebug( ( "File: %s, Line: %u, Content: %.*s.",
+                    procFilePaths[ procFile ],
+                    lineNumber,
+                    ( int ) ( pLineEnd - pLine ),
+                    pLine ) );
+
+        /* Skip the first line as it is a header. */
+        if( lineNumber <= 1 )
+        {
+            continue;
+        }
+
+        if( parseSocketEntry( pLine, pLineEnd, &socketEntry ) == false )
+        {
+            LogError( ( "Failed to parse %.*s.",
+                        ( int ) ( pLineEnd - pLine ),
+                        pLine ) );
+            status = MetricsCollectorParsingFailed;
+        }
+        else if( ( socketEntry.state == CONNECTION_STATUS_LISTEN ) && ( arePortsFull == false ) )
+        {
+            if( pOutPortsArray != NULL )
+            {
+                pOutPortsArray[ numOpenPorts ] = ( uint16_t ) socketEntry.localPort;
+                numOpenPorts++;
+
+                /* Stop filling the output array once it is full. */
+                arePortsFull = ( portsArrayLength == numOpenPorts );
+            }
+            else
+            {
+                numOpenPorts++;
+            }
+        }
+        else if( ( socketEntry.state == CONNECTION_STATUS_ESTABLISHED ) && ( areConnectionsFull == false ) )
+        {
+            if( pOutConnectionsArray != NULL )
+            {
+                /* The output array member to fill. */
+                pEstablishedConnection = &( pOutConnectionsArray[ numEstablishedConnections ] );
+
+                pEstablishedConnection->localIp = htonl( socketEntry.localIp );
+                pEstablishedConnection->remoteIp = htonl( socketEntry.remoteIp );
+                pEstablishedConnection->localPort = ( uint16_t ) socketEntry.localPort;
+                pEstablishedConnection->remotePort = ( uint16_t ) socketEntry.remotePort;
+
+                numEstablishedConnections++;
+
+                /* Stop filling the output array once it is full. */
+                areConnectionsFull = ( connectionsArrayLength == numEstablishedConnections );
+            }
+            else
+            {
+                numEstablishedConnections++;
+            }
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+    }
+
     if( status == MetricsCollectorSuccess )
     {
-        *pOutNumOpenPorts = numOpenPorts;
+        status = reader.status;
     }
 
-    if( fileHandle != NULL )
+    if( status == MetricsCollectorSuccess )
     {
-        fclose( fileHandle );
+        if( pOutNumOpenPorts != NULL )
+        {
+            *pOutNumOpenPorts = numOpenPorts;
+        }
+
+        if( pOutNumEstablishedConnections != NULL )
+        {
+            *pOutNumEstablishedConnections = numEstablishedConnections;
+        }
     }
 
     return status;
@@ -183,11 +672,13 @@ static MetricsCollectorStatus_t getOpenPorts( const char * pProcFile,
 MetricsCollectorStatus_t GetNetworkStats( NetworkStats_t * pOutNetworkStats )
 {
     MetricsCollectorStatus_t status = MetricsCollectorSuccess;
-    FILE * fileHandle = NULL;
-    uint32_t lineNumber = 0;
-    int32_t filledVariables;
-    uint32_t bytesReceived, bytesSent, packetsReceived, packetsSent;
-    char lineBuffer[ MAX_LINE_LENGTH ];
+    ProcFileReader_t reader;
+    uint32_t lineNumber = 0, fieldNumber;
+    const char * pLine = NULL;
+    const char * pLineEnd = NULL;
+    const char * pCursor;
+    uint64_t fields[ 10 ];
+    bool isParsed;
 
     if( pOutNetworkStats == NULL )
     {
@@ -197,13 +688,7 @@ MetricsCollectorStatus_t GetNetworkStats( NetworkStats_t * pOutNetworkStats )
 
     if( status == MetricsCollectorSuccess )
     {
-        fileHandle = fopen( "/proc/net/dev", "r" );
-
-        if( fileHandle == NULL )
-        {
-            LogError( ( "Failed to open /proc/net/dev." ) );
-            status = MetricsCollectorFileOpenFailed;
-        }
+        status = startProcFile( &reader, ProcFileNetDev );
     }
 
     if( status == MetricsCollectorSuccess )
@@ -211,13 +696,14 @@ MetricsCollectorStatus_t GetNetworkStats( NetworkStats_t * pOutNetworkStats )
         /* Start with everything as zero. */
         memset( pOutNetworkStats, 0, sizeof( NetworkStats_t ) );
 
-        while( fgets( &( lineBuffer[ 0 ] ), MAX_LINE_LENGTH, fileHandle ) != NULL )
+        while( readProcLine( &reader, &pLine, &pLineEnd ) == true )
         {
             lineNumber++;
 
-            LogDebug( ( "File: /proc/net/dev, Line: %u, Content: %s.",
+            LogDebug( ( "File: /proc/net/dev, Line: %u, Content: %.*s.",
                         lineNumber,
-                        &( lineBuffer[ 0 ] ) ) );
+                        ( int ) ( pLineEnd - pLine ),
+                        pLine ) );
 
             /* Skip first two lines as those are headers. */
             if( lineNumber <= 2 )
@@ -225,35 +711,43 @@ MetricsCollectorStatus_t GetNetworkStats( NetworkStats_t * pOutNetworkStats )
                 continue;
             }
 
-            /* Parse the output. */
-            filledVariables = sscanf( &( lineBuffer[ 0 ] ),
-                                      "%*[^:]: %u %u %*u %*u %*u %*u %*u %*u "
-                                      "%u %u %*u %*u %*u %*u %*u %*u",
-                                      &( bytesReceived ),
-                                      &( packetsReceived ),
-                                      &( bytesSent ),
-                                      &( packetsSent ) );
-
-            /* sscanf should fill all the 4 variables successfully. */
-            if( filledVariables != 4 )
+            /* The interface name is followed by the received bytes and
+             * packets, six more receive counters, and the transmitted bytes
+             * and packets. */
+            pCursor = memchr( pLine, ':', ( size_t ) ( pLineEnd - pLine ) );
+            isParsed = ( pCursor != NULL );
+
+            if( isParsed == true )
             {
-                LogError( ( "Failed to parse %s.", &( lineBuffer[ 0 ] ) ) );
+                pCursor++;
+
+                for( fieldNumber = 0; ( fieldNumber < 10U ) && ( isParsed == true ); fieldNumber++ )
+                {
+                    isParsed = parseDecimal( &pCursor, pLineEnd, &( fields[ fieldNumber ] ) );
+                }
+            }
+
+            if( isParsed == false )
+            {
+                LogError( ( "Failed to parse %.*s.",
+                            ( int ) ( pLineEnd - pLine ),
+                            pLine ) );
                 status = MetricsCollectorParsingFailed;
                 break;
             }
             else
             {
-                pOutNetworkStats->bytesReceived += bytesReceived;
-                pOutNetworkStats->bytesSent += bytesSent;
-                pOutNetworkStats->packetsReceived += packetsReceived;
-                pOutNetworkStats->packetsSent += packetsSent;
+                pOutNetworkStats->bytesReceived += ( uint32_t ) fields[ 0 ];
+                pOutNetworkStats->packetsReceived += ( uint32_t ) fields[ 1 ];
+                pOutNetworkStats->bytesSent += ( uint32_t ) fields[ 8 ];
+                pOutNetworkStats->packetsSent += ( uint32_t ) fields[ 9 ];
             }
         }
     }
 
-    if( fileHandle != NULL )
+    if( status == MetricsCollectorSuccess )
     {
-        fclose( fileHandle );
+        status = reader.status;
     }
 
     return status;
@@ -264,10 +758,31 @@ MetricsCollectorStatus_t GetOpenTcpPorts( uint16_t * pOutTcpPortsArray,
                                           uint32_t tcpPortsArrayLength,
                                           uint32_t * pOutNumTcpOpenPorts )
 {
-    return getOpenPorts( "/proc/net/tcp",
-                         pOutTcpPortsArray,
-                         tcpPortsArrayLength,
-                         pOutNumTcpOpenPorts );
+    MetricsCollectorStatus_t status = MetricsCollectorSuccess;
+
+    if( ( ( pOutTcpPortsArray != NULL ) && ( tcpPortsArrayLength == 0 ) ) ||
+        ( pOutNumTcpOpenPorts == NULL ) )
+    {
+        LogError( ( "Invalid parameters. pOutTcpPortsArray: %p,"
+                    " tcpPortsArrayLength: %u, pOutNumTcpOpenPorts: %p.",
+                    ( void * ) pOutTcpPortsArray,
+                    tcpPortsArrayLength,
+                    ( void * ) pOutNumTcpOpenPorts ) );
+        status = MetricsCollectorBadParameter;
+    }
+
+    if( status == MetricsCollectorSuccess )
+    {
+        status = readSocketTable( ProcFileNetTcp,
+                                  pOutTcpPortsArray,
+                                  tcpPortsArrayLength,
+                                  pOutNumTcpOpenPorts,
+                                  NULL,
+                                  0,
+                                  NULL );
+    }
+
+    return status;
 }
 /*-----------------------------------------------------------*/
 
@@ -275,10 +790,31 @@ MetricsCollectorStatus_t GetOpenUdpPorts( uint16_t * pOutUdpPortsArray,
                                           uint32_t udpPortsArrayLength,
                                           uint32_t * pOutNumUdpOpenPorts )
 {
-    return getOpenPorts( "/proc/net/udp",
-                         pOutUdpPortsArray,
-                         udpPortsArrayLength,
-                         pOutNumUdpOpenPorts );
+    MetricsCollectorStatus_t status = MetricsCollectorSuccess;
+
+    if( ( ( pOutUdpPortsArray != NULL ) && ( udpPortsArrayLength == 0 ) ) ||
+        ( pOutNumUdpOpenPorts == NULL ) )
+    {
+        LogError( ( "Invalid parameters. pOutUdpPortsArray: %p,"
+                    " udpPortsArrayLength: %u, pOutNumUdpOpenPorts: %p.",
+                    ( void * ) pOutUdpPortsArray,
+                    udpPortsArrayLength,
+                    ( void * ) pOutNumUdpOpenPorts ) );
+        status = MetricsCollectorBadParameter;
+    }
+
+    if( status == MetricsCollectorSuccess )
+    {
+        status = readSocketTable( ProcFileNetUdp,
+                                  pOutUdpPortsArray,
+                                  udpPortsArrayLength,
+                                  pOutNumUdpOpenPorts,
+                                  NULL,
+                                  0,
+                                  NULL );
+    }
+
+    return status;
 }
 /*-----------------------------------------------------------*/
 
@@ -287,12 +823,6 @@ MetricsCollectorStatus_t GetEstablishedConnections( Connection_t * pOutConnectio
                                                     uint32_t * pOutNumEstablishedConnections )
 {
     MetricsCollectorStatus_t status = MetricsCollectorSuccess;
-    FILE * fileHandle = NULL;
-    uint32_t lineNumber = 0, connectionStatus;
-    int32_t filledVariables;
-    uint32_t localIp, localPort, remoteIp, remotePort, numEstablishedConnections = 0;
-    Connection_t * pEstablishedConnection;
-    char lineBuffer[ MAX_LINE_LENGTH ];
 
     if( ( ( pOutConnectionsArray != NULL ) && ( connectionsArrayLength == 0 ) ) ||
         ( pOutNumEstablishedConnections == NULL ) )
@@ -307,97 +837,68 @@ MetricsCollectorStatus_t GetEstablishedConnections( Connection_t * pOutConnectio
 
     if( status == MetricsCollectorSuccess )
     {
-        fileHandle = fopen( "/proc/net/tcp", "r" );
-
-        if( fileHandle == NULL )
-        {
-            LogError( ( "Failed to open /proc/net/tcp." ) );
-            status = MetricsCollectorFileOpenFailed;
-        }
+        status = readSocketTable( ProcFileNetTcp,
+                                  NULL,
+                                  0,
+                                  NULL,
+                                  pOutConnectionsArray,
+                                  connectionsArrayLength,
+                                  pOutNumEstablishedConnections );
     }
 
-    if( status == MetricsCollectorSuccess )
-    {
-        while( fgets( &( lineBuffer[ 0 ] ), MAX_LINE_LENGTH, fileHandle ) != NULL )
-        {
-            lineNumber++;
-
-            LogDebug( ( "File: /proc/net/tcp, Line: %u, Content: %s.",
-                        lineNumber,
-                        &( lineBuffer[ 0 ] ) ) );
-
-            /* Skip the first line as it is a header. */
-            if( lineNumber <= 1 )
-            {
-                continue;
-            }
-
-            /* Parse the output. */
-            filledVariables = sscanf( &( lineBuffer[ 0 ] ),
-                                      "%*[^:]: %8x:%4x %8x:%4x %2x",
-                                      &( localIp ),
-                                      &( localPort ),
-                                      &( remoteIp ),
-                                      &( remotePort ),
-                                      &( connectionStatus ) );
-
-            /* sscanf should fill all the 5 variables successfully. */
-            if( filledVariables != 5 )
-            {
-                LogError( ( "Failed to parse %s.", &( lineBuffer[ 0 ] ) ) );
-                status = MetricsCollectorParsingFailed;
-                break;
-            }
-
-            if( connectionStatus == CONNECTION_STATUS_ESTABLISHED )
-            {
-                if( pOutConnectionsArray != NULL )
-                {
-                    /* The output array member to fill. */
-                    pEstablishedConnection = &( pOutConnectionsArray[ numEstablishedConnections ] );
-
-                    pEstablishedConnection->localIp = htonl( localIp );
-                    pEstablishedConnection->remoteIp = htonl( remoteIp );
-                    pEstablishedConnection->localPort = ( uint16_t ) localPort;
-                    pEstablishedConnection->remotePort = ( uint16_t ) remotePort;
-
-                    numEstablishedConnections++;
+    return status;
+}
+/*-----------------------------------------------------------*/
 
-                    /* Break if the output array is full. */
-                    if( connectionsArrayLength == numEstablishedConnections )
-                    {
-                        break;
-                    }
-                }
-                else
-                {
-                    numEstablishedConnections++;
-                }
-            }
-        }
-    }
+MetricsCollectorStatus_t GetOpenTcpPortsAndEstablishedConnections( uint16_t * pOutTcpPortsArray,
+                                                                   uint32_t tcpPortsArrayLength,
+                                                                   uint32_t * pOutNumTcpOpenPorts,
+                                                                   Connection_t * pOutConnectionsArray,
+                                                                   uint32_t connectionsArrayLength,
+                                                                   uint32_t * pOutNumEstablishedConnections )
+{
+    MetricsCollectorStatus_t status = MetricsCollectorSuccess;
 
-    if( status == MetricsCollectorSuccess )
+    if( ( ( pOutTcpPortsArray != NULL ) && ( tcpPortsArrayLength == 0 ) ) ||
+        ( pOutNumTcpOpenPorts == NULL ) ||
+        ( ( pOutConnectionsArray != NULL ) && ( connectionsArrayLength == 0 ) ) ||
+        ( pOutNumEstablishedConnections == NULL ) )
     {
-        *pOutNumEstablishedConnections = numEstablishedConnections;
+        LogError( ( "Invalid parameters. pOutTcpPortsArray: %p,"
+                    " tcpPortsArrayLength: %u, pOutNumTcpOpenPorts: %p,"
+                    " pOutConnectionsArray: %p, connectionsArrayLength: %u,"
+                    " pOutNumEstablishedConnections: %p.",
+                    ( void * ) pOutTcpPortsArray,
+                    tcpPortsArrayLength,
+                    ( void * ) pOutNumTcpOpenPorts,
+                    ( void * ) pOutConnectionsArray,
+                    connectionsArrayLength,
+                    ( void * ) pOutNumEstablishedConnections ) );
+        status = MetricsCollectorBadParameter;
     }
 
-    if( fileHandle != NULL )
+    if( status == MetricsCollectorSuccess )
     {
-        fclose( fileHandle );
+        status = readSocketTable( ProcFileNetTcp,
+                                  pOutTcpPortsArray,
+                                  tcpPortsArrayLength,
+                                  pOutNumTcpOpenPorts,
+                                  pOutConnectionsArray,
+                                  connectionsArrayLength,
+                                  pOutNumEstablishedConnections );
     }
 
     return status;
 }
-
 /*-----------------------------------------------------------*/
 
 MetricsCollectorStatus_t GetUptime( uint64_t * pUptime )
 {
     MetricsCollectorStatus_t status = MetricsCollectorSuccess;
-    FILE * fileHandle = NULL;
-    int32_t filledVariables;
-    char lineBuffer[ MAX_LINE_LENGTH ];
+    ProcFileReader_t reader;
+    const char * pLine = NULL;
+    const char * pLineEnd = NULL;
+    const char * pCursor;
 
     if( pUptime == NULL )
     {
@@ -407,39 +908,33 @@ MetricsCollectorStatus_t GetUptime( uint64_t * pUptime )
 
     if( status == MetricsCollectorSuccess )
     {
-        fileHandle = fopen( "/proc/uptime", "r" );
-
-        if( fileHandle == NULL )
-        {
-            LogError( ( "Failed to open /proc/uptime." ) );
-            status = MetricsCollectorFileOpenFailed;
-        }
+        status = startProcFile( &reader, ProcFileUptime );
     }
 
     if( status == MetricsCollectorSuccess )
     {
-        if( fgets( &( lineBuffer[ 0 ] ), MAX_LINE_LENGTH, fileHandle ) != NULL )
+        if( readProcLine( &reader, &pLine, &pLineEnd ) == true )
         {
-            LogDebug( ( "File: /proc/uptime, Content: %s.",
-                        &( lineBuffer[ 0 ] ) ) );
+            LogDebug( ( "File: /proc/uptime, Content: %.*s.",
+                        ( int ) ( pLineEnd - pLine ),
+                        pLine ) );
 
-            /* Parse the output. */
-            filledVariables = sscanf( &( lineBuffer[ 0 ] ),
-                                      "%lu",
-                                      pUptime );
+            /* Parse the whole seconds of the uptime. */
+            pCursor = pLine;
 
-            /* sscanf should fill pUptime successfully. */
-            if( filledVariables != 1 )
+            if( parseDecimal( &pCursor, pLineEnd, pUptime ) == false )
             {
-                LogError( ( "Failed to parse CPU usage data. File: /proc/uptime, Data: %s.", &( lineBuffer[ 0 ] ) ) );
+                LogError( ( "Failed to parse CPU usage data. File: /proc/uptime, Data: %.*s.",
+                            ( int ) ( pLineEnd - pLine ),
+                            pLine ) );
                 status = MetricsCollectorParsingFailed;
             }
         }
     }
 
-    if( fileHandle != NULL )
+    if( status == MetricsCollectorSuccess )
     {
-        fclose( fileHandle );
+        status = reader.status;
     }
 
     return status;
@@ -449,9 +944,10 @@ MetricsCollectorStatus_t GetUptime( uint64_t * pUptime )
 MetricsCollectorStatus_t GetFreeMemory( uint64_t * pMemFree )
 {
     MetricsCollectorStatus_t status = MetricsCollectorSuccess;
-    FILE * fileHandle = NULL;
-    int32_t filledVariables;
-    char lineBuffer[ MAX_LINE_LENGTH ];
+    ProcFileReader_t reader;
+    const char * pLine = NULL;
+    const char * pLineEnd = NULL;
+    const char * pCursor;
 
     if( pMemFree == NULL )
     {
@@ -461,29 +957,23 @@ MetricsCollectorStatus_t GetFreeMemory( uint64_t * pMemFree )
 
     if( status == MetricsCollectorSuccess )
     {
-        fileHandle = fopen( "/proc/meminfo", "r" );
-
-        if( fileHandle == NULL )
-        {
-            LogError( ( "Failed to open /proc/meminfo." ) );
-            status = MetricsCollectorFileOpenFailed;
-        }
+        status = startProcFile( &reader, ProcFileMeminfo );
     }
 
     if( status == MetricsCollectorSuccess )
     {
-        while( fgets( &( lineBuffer[ 0 ] ), MAX_LINE_LENGTH, fileHandle ) != NULL )
+        while( readProcLine( &reader, &pLine, &pLineEnd ) == true )
         {
             /* Check if the line read is for free memory. */
-            if( strncmp( lineBuffer, "MemFree:", 8 ) == 0 )
+            if( ( ( pLineEnd - pLine ) >= 8 ) && ( strncmp( pLine, "MemFree:", 8 ) == 0 ) )
             {
-                filledVariables = sscanf( lineBuffer,
-                                          "%*s %lu",
-                                          pMemFree );
+                pCursor = pLine + 8;
 
-                if( filledVariables != 1 )
+                if( parseDecimal( &pCursor, pLineEnd, pMemFree ) == false )
                 {
-                    LogError( ( "Failed to parse memory data. File: /proc/memfree, Data: %s.", &( lineBuffer[ 0 ] ) ) );
+                    LogError( ( "Failed to parse memory data. File: /proc/meminfo, Data: %.*s.",
+                                ( int ) ( pLineEnd - pLine ),
+                                pLine ) );
                     status = MetricsCollectorParsingFailed;
                 }
 
@@ -492,9 +982,9 @@ MetricsCollectorStatus_t GetFreeMemory( uint64_t * pMemFree )
         }
     }
 
-    if( fileHandle != NULL )
+    if( status == MetricsCollectorSuccess )
     {
-        fclose( fileHandle );
+        status = reader.status;
     }
 
     return status;
@@ -506,10 +996,11 @@ MetricsCollectorStatus_t GetCpuUserUsage( uint64_t * pOutCpuUserUsage,
                                           size_t * pOutNumCpuUserUsage )
 {
     MetricsCollectorStatus_t status = MetricsCollectorSuccess;
-    FILE * fileHandle = NULL;
     /* Variables for reading and processing data from "/proc/stat" file. */
-    char lineBuffer[ MAX_LINE_LENGTH ];
-    int32_t filledVariables = 0;
+    ProcFileReader_t reader;
+    const char * pLine = NULL;
+    const char * pLineEnd = NULL;
+    const char * pCursor;
 
     *pOutNumCpuUserUsage = 0;
 
@@ -521,32 +1012,29 @@ MetricsCollectorStatus_t GetCpuUserUsage( uint64_t * pOutCpuUserUsage,
 
     if( status == MetricsCollectorSuccess )
     {
-        fileHandle = fopen( "/proc/stat", "r" );
-
-        if( fileHandle == NULL )
-        {
-            LogError( ( "Failed to open /proc/stat." ) );
-            status = MetricsCollectorFileOpenFailed;
-        }
+        status = startProcFile( &reader, ProcFileStat );
     }
 
     if( status == MetricsCollectorSuccess )
     {
         while( ( *pOutNumCpuUserUsage < cpuUserUsageLength ) &&
-               ( fgets( &( lineBuffer[ 0 ] ), MAX_LINE_LENGTH, fileHandle ) != NULL ) )
+               ( readProcLine( &reader, &pLine, &pLineEnd ) == true ) )
         {
-            LogDebug( ( "File: /proc/stat, Content: %s.", &( lineBuffer[ 0 ] ) ) );
+            LogDebug( ( "File: /proc/stat, Content: %.*s.",
+                        ( int ) ( pLineEnd - pLine ),
+                        pLine ) );
 
             /* Check if the line read is for a CPU. */
-            if( strncmp( lineBuffer, "cpu", 3 ) == 0 )
+            if( ( ( pLineEnd - pLine ) >= 3 ) && ( strncmp( pLine, "cpu", 3 ) == 0 ) )
             {
-                filledVariables = sscanf( lineBuffer,
-                                          "%*s %lu",
-                                          &( pOutCpuUserUsage[ *pOutNumCpuUserUsage ] ) );
+                pCursor = pLine;
 
-                if( filledVariables != 1 )
+                if( ( skipField( &pCursor, pLineEnd ) == false ) ||
+                    ( parseDecimal( &pCursor, pLineEnd, &( pOutCpuUserUsage[ *pOutNumCpuUserUsage ] ) ) == false ) )
                 {
-                    LogError( ( "Failed to parse data. File: /proc/stat, Content: %s", lineBuffer ) );
+                    LogError( ( "Failed to parse data. File: /proc/stat, Content: %.*s",
+                                ( int ) ( pLineEnd - pLine ),
+                                pLine ) );
                     status = MetricsCollectorParsingFailed;
 
                     break;
@@ -559,9 +1047,9 @@ MetricsCollectorStatus_t GetCpuUserUsage( uint64_t * pOutCpuUserUsage,
         }
     }
 
-    if( fileHandle != NULL )
+    if( status == MetricsCollectorSuccess )
     {
-        fclose( fileHandle );
+        status = reader.status;
     }
 
     return status;
@@ -574,11 +1062,16 @@ MetricsCollectorStatus_t GetNetworkInferfaceInfo( char ( *pOutNetworkInterfaceNa
                                                   size_t * pOutNumNetworkInterfaces )
 {
     MetricsCollectorStatus_t status = MetricsCollectorSuccess;
-    FILE * fileHandle = NULL;
     /* Variables for reading and processing data from "/proc/net/arp" file. */
-    char lineBuffer[ MAX_LINE_LENGTH ];
-    int32_t filledVariables = 0;
-    uint32_t ipPart1, ipPart2, ipPart3, ipPart4;
+    ProcFileReader_t reader;
+    const char * pLine = NULL;
+    const char * pLineEnd = NULL;
+    const char * pCursor;
+    const char * pName = NULL;
+    uint64_t ipParts[ 4 ];
+    uint32_t partNumber, fieldNumber;
+    size_t nameLength;
+    bool isParsed;
 
     *pOutNumNetworkInterfaces = 0;
 
@@ -592,53 +1085,100 @@ MetricsCollectorStatus_t GetNetworkInferfaceInfo( char ( *pOutNetworkInterfaceNa
 
     if( status == MetricsCollectorSuccess )
     {
-        fileHandle = fopen( "/proc/net/arp", "r" );
-
-        if( fileHandle == NULL )
-        {
-            LogError( ( "Failed to open /proc/net/arp." ) );
-            status = MetricsCollectorFileOpenFailed;
-        }
+        status = startProcFile( &reader, ProcFileNetArp );
     }
 
     if( status == MetricsCollectorSuccess )
     {
         /* Skip header line */
-        if( fgets( &( lineBuffer[ 0 ] ), MAX_LINE_LENGTH, fileHandle ) != NULL )
+        if( readProcLine( &reader, &pLine, &pLineEnd ) == true )
         {
             while( ( *pOutNumNetworkInterfaces < bufferLength ) &&
-                   ( fgets( &( lineBuffer[ 0 ] ), MAX_LINE_LENGTH, fileHandle ) != NULL ) )
+                   ( readProcLine( &reader, &pLine, &pLineEnd ) == true ) )
             {
-                LogDebug( ( "File: /proc/net/arp, Content: %s.", &( lineBuffer[ 0 ] ) ) );
+                LogDebug( ( "File: /proc/net/arp, Content: %.*s.",
+                            ( int ) ( pLineEnd - pLine ),
+                            pLine ) );
+
+                /* The IP address is followed by the hardware type, flags,
+                 * hardware address and mask, then the device name. */
+                pCursor = pLine;
+                isParsed = true;
+
+                for( partNumber = 0; ( partNumber < 4U ) && ( isParsed == true ); partNumber++ )
+                {
+                    isParsed = ( ( partNumber == 0U ) || ( skipCharacter( &pCursor, pLineEnd, '.' ) == true ) ) &&
+                               ( parseDecimal( &pCursor, pLineEnd, &( ipParts[ partNumber ] ) ) == true );
+                }
 
-                filledVariables = sscanf( lineBuffer,
-                                          "%u.%u.%u.%u %*s %*s %*s %*s %15s",
-                                          &ipPart1,
-                                          &ipPart2,
-                                          &ipPart3,
-                                          &ipPart4,
-                                          pOutNetworkInterfaceNames[ *pOutNumNetworkInterfaces ] );
+                for( fieldNumber = 0; ( fieldNumber < 4U ) && ( isParsed == true ); fieldNumber++ )
+                {
+                    isParsed = skipField( &pCursor, pLineEnd );
+                }
+
+                if( isParsed == true )
+                {
+                    skipSpaces( &pCursor, pLineEnd );
+                    pName = pCursor;
+                    isParsed = skipField( &pCursor, pLineEnd );
+                }
 
-                if( filledVariables != 5 )
+                if( isParsed == false )
                 {
-                    LogError( ( "Failed to parse data. File: /proc/net/arp, Content: %s", lineBuffer ) );
+                    LogError( ( "Failed to parse data. File: /proc/net/arp, Content: %.*s",
+                                ( int ) ( pLineEnd - pLine ),
+                                pLine ) );
                     status = MetricsCollectorParsingFailed;
 
                     break;
                 }
                 else
                 {
-                    pOutNetworkInterfaceAddresses[ *pOutNumNetworkInterfaces ] = ( ipPart1 << 24 ) | ( ipPart2 << 16 ) | ( ipPart3 << 8 ) | ipPart4;
+                    /* Keep the first 15 characters of the name, as "%15s"
+                     * would. */
+                    nameLength = ( size_t ) ( pCursor - pName );
+
+                    if( nameLength > ( NETWORK_INTERFACE_NAME_LENGTH - 1U ) )
+                    {
+                        nameLength = NETWORK_INTERFACE_NAME_LENGTH - 1U;
+                    }
+
+                    memcpy( pOutNetworkInterfaceNames[ *pOutNumNetworkInterfaces ], pName, nameLength );
+                    pOutNetworkInterfaceNames[ *pOutNumNetworkInterfaces ][ nameLength ] = '\0';
+
+                    pOutNetworkInterfaceAddresses[ *pOutNumNetworkInterfaces ] = ( ( uint32_t ) ipParts[ 0 ] << 24 ) |
+                                                                                 ( ( uint32_t ) ipParts[ 1 ] << 16 ) |
+                                                                                 ( ( uint32_t ) ipParts[ 2 ] << 8 ) |
+                                                                                 ( uint32_t ) ipParts[ 3 ];
                     *pOutNumNetworkInterfaces += 1;
                 }
             }
         }
     }
 
-    if( fileHandle != NULL )
+    if( status == MetricsCollectorSuccess )
     {
-        fclose( fileHandle );
+        status = reader.status;
     }
 
     return status;
 }
+/*-----------------------------------------------------------*/
+
+void CloseMetricsCollector( void )
+{
+    uint32_t i;
+
+    for( i = 0; i < ( uint32_t ) ProcFileCount; i++ )
+    {
+        if( procFileDescriptors[ i ] >= 0 )
+        {
+            ( void ) close( procFileDescriptors[ i ] );
+            procFileDescriptors[ i ] = -1;
+        }
+    }
+
+    free( pReadBuffer );
+    pReadBuffer = NULL;
+    readBufferSize = 0;
+}
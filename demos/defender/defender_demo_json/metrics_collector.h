@@ -36,7 +36,8 @@ typedef enum
     MetricsCollectorBadParameter,
     MetricsCollectorFileOpenFailed,
     MetricsCollectorParsingFailed,
-    MetricsCollectorDataNotFound
+    MetricsCollectorDataNotFound,
+    MetricsCollectorFileReadFailed
 } MetricsCollectorStatus_t;
 
 /**
@@ -93,6 +94,7 @@ typedef struct MemoryStats
  * @return #MetricsCollectorSuccess if the network stats are successfully obtained;
  * #MetricsCollectorBadParameter if invalid parameters are passed;
  * #MetricsCollectorFileOpenFailed if the function fails to open "/proc/net/dev";
+ * #MetricsCollectorFileReadFailed if the function fails to read "/proc/net/dev";
  * MetricsCollectorParsingFailed if the function fails to parses the data read
  * from "/proc/net/dev".
  */
@@ -114,6 +116,7 @@ MetricsCollectorStatus_t GetNetworkStats( NetworkStats_t * pOutNetworkStats );
  * @return #MetricsCollectorSuccess if open TCP ports are successfully obtained;
  * #MetricsCollectorBadParameter if invalid parameters are passed;
  * #MetricsCollectorFileOpenFailed if the function fails to open "/proc/net/tcp";
+ * #MetricsCollectorFileReadFailed if the function fails to read "/proc/net/tcp";
  * MetricsCollectorParsingFailed if the function fails to parses the data read
  * from "/proc/net/tcp".
  */
@@ -137,6 +140,7 @@ MetricsCollectorStatus_t GetOpenTcpPorts( uint16_t * pOutTcpPortsArray,
  * @return #MetricsCollectorSuccess if open UDP ports are successfully obtained;
  * #MetricsCollectorBadParameter if invalid parameters are passed;
  * #MetricsCollectorFileOpenFailed if the function fails to open "/proc/net/udp";
+ * #MetricsCollectorFileReadFailed if the function fails to read "/proc/net/udp";
  * MetricsCollectorParsingFailed if the function fails to parses the data read
  * from "/proc/net/udp".
  */
@@ -162,6 +166,7 @@ MetricsCollectorStatus_t GetOpenUdpPorts( uint16_t * pOutUdpPortsArray,
  * @return #MetricsCollectorSuccess if established connections are successfully obtained;
  * #MetricsCollectorBadParameter if invalid parameters are passed;
  * #MetricsCollectorFileOpenFailed if the function fails to open "/proc/net/tcp";
+ * #MetricsCollectorFileReadFailed if the function fails to read "/proc/net/tcp";
  * MetricsCollectorParsingFailed if the function fails to parses the data read
  * from "/proc/net/tcp".
  */
@@ -169,6 +174,43 @@ MetricsCollectorStatus_t GetEstablishedConnections( Connection_t * pOutConnectio
                                                     uint32_t connectionsArrayLength,
                                                     uint32_t * pOutNumEstablishedConnections );
 
+/**
+ * @brief Get a list of the open TCP ports and a list of established
+ * connections.
+ *
+ * This function gives the results of #GetOpenTcpPorts and
+ * #GetEstablishedConnections from a single read of "/proc/net/tcp", which
+ * saves reading and parsing the file twice when the device has many sockets.
+ *
+ * @param[in] pOutTcpPortsArray The array to write the open TCP ports into. This
+ * can be NULL, if only the number of open ports is needed.
+ * @param[in] tcpPortsArrayLength Length of the pOutTcpPortsArray, if it is not
+ * NULL.
+ * @param[out] pOutNumTcpOpenPorts Number of open TCP ports if @p
+ * pOutTcpPortsArray NULL, else number of TCP ports written.
+ * @param[in] pOutConnectionsArray The array to write the established connections
+ * into. This can be NULL, if only the number of established connections is
+ * needed.
+ * @param[in] connectionsArrayLength Length of the pOutConnectionsArray, if it
+ * is not NULL.
+ * @param[out] pOutNumEstablishedConnections Number of established connections if @p
+ * pOutConnectionsArray NULL, else number of established connections written.
+ *
+ * @return #MetricsCollectorSuccess if open TCP ports and established connections
+ * are successfully obtained;
+ * #MetricsCollectorBadParameter if invalid parameters are passed;
+ * #MetricsCollectorFileOpenFailed if the function fails to open "/proc/net/tcp";
+ * #MetricsCollectorFileReadFailed if the function fails to read "/proc/net/tcp";
+ * MetricsCollectorParsingFailed if the function fails to parses the data read
+ * from "/proc/net/tcp".
+ */
+MetricsCollectorStatus_t GetOpenTcpPortsAndEstablishedConnections( uint16_t * pOutTcpPortsArray,
+                                                                   uint32_t tcpPortsArrayLength,
+                                                                   uint32_t * pOutNumTcpOpenPorts,
+                                                                   Connection_t * pOutConnectionsArray,
+                                                                   uint32_t connectionsArrayLength,
+                                                                   uint32_t * pOutNumEstablishedConnections );
+
 /**
  * @brief Get system uptime.
  *
@@ -179,6 +221,7 @@ MetricsCollectorStatus_t GetEstablishedConnections( Connection_t * pOutConnectio
  * @return #MetricsCollectorSuccess if uptime is successfully obtained;
  * #MetricsCollectorBadParameter if invalid parameter is passed;
  * #MetricsCollectorFileOpenFailed if the function fails to open "/proc/uptime";
+ * #MetricsCollectorFileReadFailed if the function fails to read "/proc/uptime";
  * MetricsCollectorParsingFailed if the function fails to parses the data read
  * from "/proc/uptime".
  */
@@ -194,6 +237,7 @@ MetricsCollectorStatus_t GetUptime( uint64_t * pUptime );
  * @return #MetricsCollectorSuccess if free memory is successfully obtained;
  * #MetricsCollectorBadParameter if invalid parameter is passed;
  * #MetricsCollectorFileOpenFailed if the function fails to open "/proc/meminfo";
+ * #MetricsCollectorFileReadFailed if the function fails to read "/proc/meminfo";
  * MetricsCollectorParsingFailed if the function fails to parses the data read
  * from "/proc/meminfo".
  */
@@ -211,6 +255,7 @@ MetricsCollectorStatus_t GetFreeMemory( uint64_t * pMemFree );
  * @return #MetricsCollectorSuccess if memory data statistic is successfully calculated;
  * #MetricsCollectorBadParameter if invalid parameter is passed;
  * #MetricsCollectorFileOpenFailed if the function fails to open "/proc/stat";
+ * #MetricsCollectorFileReadFailed if the function fails to read "/proc/stat";
  * MetricsCollectorParsingFailed if the function fails to parses the data read
  * from "/proc/stat".
  */
@@ -231,6 +276,7 @@ MetricsCollectorStatus_t GetCpuUserUsage( uint64_t * pOutCpuUserUsage,
  * @return #MetricsCollectorSuccess if memory data statistic is successfully calculated;
  * #MetricsCollectorBadParameter if invalid parameter is passed;
  * #MetricsCollectorFileOpenFailed if the function fails to open "/proc/net/arp";
+ * #MetricsCollectorFileReadFailed if the function fails to read "/proc/net/arp";
  * MetricsCollectorParsingFailed if the function fails to parses the data read
  * from "/proc/net/arp".
  */
@@ -239,4 +285,12 @@ MetricsCollectorStatus_t GetNetworkInferfaceInfo( char ( *pOutNetworkInterfaceNa
                                                   size_t bufferLength,
                                                   size_t * pOutNumNetworkInterfaces );
 
+/**
+ * @brief Close the "/proc" files kept open by the metrics collector and free
+ * the buffer they are read into.
+ *
+ * The files are opened again by the next call to the metrics collector.
+ */
+void CloseMetricsCollector( void );
+
 #endif /* ifndef METRICS_COLLECTOR_H_ */
@@ -47,7 +47,8 @@ typedef void (* MQTTPublishCallback_t )( MQTTPublishInfo_t * pPublishInfo,
 bool EstablishMqttSession( MQTTPublishCallback_t publishCallback );
 
 /**
- * @brief Disconnect the MQTT connection.
+ * @brief Disconnect the MQTT connection and close the journal of outgoing
+ * publishes.
  *
  * @return true if the MQTT session was successfully disconnected;
  * false otherwise.
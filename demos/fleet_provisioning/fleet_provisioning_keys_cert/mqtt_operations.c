@@ -59,6 +59,9 @@
 /* AWS IoT Core TLS ALPN definitions for MQTT authentication */
 #include "aws_iot_alpn_defs.h"
 
+/* Retransmission store for unacknowledged publishes. */
+#include "mqtt_retransmit_store.h"
+
 /**
  * These configurations are required. Throw compilation error if the below
  * configs are not defined.
@@ -170,23 +173,6 @@
 #define INCOMING_PUBLISH_RECORD_LEN              ( 10U )
 /*-----------------------------------------------------------*/
 
-/**
- * @brief Structure to keep the MQTT publish packets until an ack is received
- * for QoS1 publishes.
- */
-typedef struct PublishPackets
-{
-    /**
-     * @brief Packet identifier of the publish packet.
-     */
-    uint16_t packetId;
-
-    /**
-     * @brief Publish info of the publish packet.
-     */
-    MQTTPublishInfo_t pubInfo;
-} PublishPackets_t;
-
 /* Each compilation unit must define the NetworkContext struct. */
 struct NetworkContext
 {
@@ -218,12 +204,27 @@ static uint16_t globalSubscribePacketIdentifier = 0U;
 static uint16_t globalUnsubscribePacketIdentifier = 0U;
 
 /**
- * @brief Array to keep the outgoing publish messages.
+ * @brief Store to keep the outgoing publish messages.
  *
  * These stored outgoing publish messages are kept until a successful ack
  * is received.
  */
-static PublishPackets_t outgoingPublishPackets[ MAX_OUTGOING_PUBLISHES ] = { 0 };
+static MqttRetransmitStore_t outgoingPublishStore;
+
+/**
+ * @brief Entries of #outgoingPublishStore.
+ */
+static MqttRetransmitEntry_t outgoingPublishEntries[ MAX_OUTGOING_PUBLISHES ];
+
+/**
+ * @brief Index of #outgoingPublishStore by packet identifier.
+ */
+static uint16_t outgoingPublishIndex[ MQTT_RETRANSMIT_STORE_INDEX_SIZE( MAX_OUTGOING_PUBLISHES ) ];
+
+/**
+ * @brief Whether #outgoingPublishStore has been initialized.
+ */
+static bool outgoingPublishStoreReady = false;
 
 /**
  * @brief The network buffer must remain valid for the lifetime of the MQTT context.
@@ -302,38 +303,6 @@ static bool connectToBrokerWithBackoffRetries( NetworkContext_t * pNetworkContex
                                                char * pClientCertLabel,
                                                char * pPrivateKeyLabel );
 
-/**
- * @brief Get the free index in the #outgoingPublishPackets array at which an
- * outgoing publish can be stored.
- *
- * @param[out] pIndex The index at which an outgoing publish can be stored.
- *
- * @return false if no more publishes can be stored;
- * true if an index to store the next outgoing publish is obtained.
- */
-static bool getNextFreeIndexForOutgoingPublishes( uint8_t * pIndex );
-
-/**
- * @brief Clean up the outgoing publish at given index from the
- * #outgoingPublishPackets array.
- *
- * @param[in] index The index at which a publish message has to be cleaned up.
- */
-static void cleanupOutgoingPublishAt( uint8_t index );
-
-/**
- * @brief Clean up all the outgoing publishes in the #outgoingPublishPackets array.
- */
-static void cleanupOutgoingPublishes( void );
-
-/**
- * @brief Clean up the publish packet with the given packet id in the
- * #outgoingPublishPackets array.
- *
- * @param[in] packetId Packet id of the packet to be clean.
- */
-static void cleanupOutgoingPublishWithPacketID( uint16_t packetId );
-
 /**
  * @brief Callback registered with the MQTT library.
  *
@@ -473,79 +442,6 @@ static bool connectToBrokerWithBackoffRetries( NetworkContext_t * pNetworkContex
 }
 /*-----------------------------------------------------------*/
 
-static bool getNextFreeIndexForOutgoingPublishes( uint8_t * pIndex )
-{
-    bool returnStatus = false;
-    uint8_t index = 0;
-
-    assert( outgoingPublishPackets != NULL );
-    assert( pIndex != NULL );
-
-    for( index = 0; index < MAX_OUTGOING_PUBLISHES; index++ )
-    {
-        /* A free index is marked by invalid packet id. Check if the the index
-         * has a free slot. */
-        if( outgoingPublishPackets[ index ].packetId == MQTT_PACKET_ID_INVALID )
-        {
-            returnStatus = true;
-            break;
-        }
-    }
-
-    /* Copy the available index into the output param. */
-    if( returnStatus == true )
-    {
-        *pIndex = index;
-    }
-
-    return returnStatus;
-}
-/*-----------------------------------------------------------*/
-
-static void cleanupOutgoingPublishAt( uint8_t index )
-{
-    assert( outgoingPublishPackets != NULL );
-    assert( index < MAX_OUTGOING_PUBLISHES );
-
-    /* Clear the outgoing publish packet. */
-    ( void ) memset( &( outgoingPublishPackets[ index ] ),
-                     0x00,
-                     sizeof( outgoingPublishPackets[ index ] ) );
-}
-/*-----------------------------------------------------------*/
-
-static void cleanupOutgoingPublishes( void )
-{
-    assert( outgoingPublishPackets != NULL );
-
-    /* Clean up all the outgoing publish packets. */
-    ( void ) memset( outgoingPublishPackets, 0x00, sizeof( outgoingPublishPackets ) );
-}
-/*-----------------------------------------------------------*/
-
-static void cleanupOutgoingPublishWithPacketID( uint16_t packetId )
-{
-    uint8_t index = 0;
-
-    assert( outgoingPublishPackets != NULL );
-    assert( packetId != MQTT_PACKET_ID_INVALID );
-
-    /* Clean up the saved outgoing publish with packet Id equal to packetId. */
-    for( index = 0; index < MAX_OUTGOING_PUBLISHES; index++ )
-    {
-        if( outgoingPublishPackets[ index ].packetId == packetId )
-        {
-            cleanupOutgoingPublishAt( index );
-
-            LogDebug( ( "Cleaned up outgoing publish packet with packet id %u.",
-                        packetId ) );
-
-            break;
-        }
-    }
-}
-/*-----------------------------------------------------------*/
-
 static void mqttCallback( MQTTContext_t * pMqttContext,
                           MQTTPacketInfo_t * pPacketInfo,
                           MQTTDeserializedInfo_t * pDeserializedInfo )
@@ -617,9 +513,10 @@ static void mqttCallback( MQTTContext_t * pMqttContext,
                 /* Update the global ACK packet identifier. */
                 globalAckPacketIdentifier = packetIdentifier;
 
-                /* Cleanup the publish packet from the #outgoingPublishPackets
-                 * array when a PUBACK is received. */
-                cleanupOutgoingPublishWithPacketID( packetIdentifier );
+                /* Cleanup the publish packet from the #outgoingPublishStore
+                 * when a PUBACK is received. */
+                ( void ) MqttRetransmitStore_Remove( &outgoingPublishStore,
+                                                     packetIdentifier );
                 break;
 
             /* Any other packet type is invalid. */
@@ -633,47 +530,22 @@ static void mqttCallback( MQTTContext_t * pMqttContext,
 
 static bool handlePublishResend( MQTTContext_t * pMqttContext )
 {
-    bool returnStatus = false;
+    bool returnStatus = true;
     MQTTStatus_t mqttStatus = MQTTSuccess;
-    uint8_t index = 0U;
 
-    assert( outgoingPublishPackets != NULL );
+    LogDebug( ( "Sending %u duplicate PUBLISH packets.",
+                ( unsigned int ) MqttRetransmitStore_PendingCount( &outgoingPublishStore ) ) );
 
-    /* Resend all the QoS1 publishes still in the #outgoingPublishPackets array.
+    /* Resend all the QoS1 publishes still in the #outgoingPublishStore.
      * These are the publishes that haven't received a PUBACK yet. When a PUBACK
-     * is received, the corresponding publish is removed from the array. */
-    for( index = 0U; index < MAX_OUTGOING_PUBLISHES; index++ )
-    {
-        if( outgoingPublishPackets[ index ].packetId != MQTT_PACKET_ID_INVALID )
-        {
-            outgoingPublishPackets[ index ].pubInfo.dup = true;
-
-            LogDebug( ( "Sending duplicate PUBLISH with packet id %u.",
-                        outgoingPublishPackets[ index ].packetId ) );
-            mqttStatus = MQTT_Publish( pMqttContext,
-                                       &outgoingPublishPackets[ index ].pubInfo,
-                                       outgoingPublishPackets[ index ].packetId );
-
-            if( mqttStatus != MQTTSuccess )
-            {
-                LogError( ( "Sending duplicate PUBLISH for packet id %u "
-                            " failed with status %s.",
-                            outgoingPublishPackets[ index ].packetId,
-                            MQTT_Status_strerror( mqttStatus ) ) );
-                break;
-            }
-            else
-            {
-                LogDebug( ( "Sent duplicate PUBLISH successfully for packet id %u.",
-                            outgoingPublishPackets[ index ].packetId ) );
-            }
-        }
-    }
+     * is received, the corresponding publish is removed from the store. */
+    mqttStatus = MqttRetransmitStore_ResendAll( &outgoingPublishStore, pMqttContext );
 
-    /* Were all the unacknowledged QoS1 publishes successfully re-sent? */
-    if( index == MAX_OUTGOING_PUBLISHES )
+    if( mqttStatus != MQTTSuccess )
     {
-        returnStatus = true;
+        LogError( ( "Sending duplicate PUBLISH packets failed with status %s.",
+                    MQTT_Status_strerror( mqttStatus ) ) );
+        returnStatus = false;
     }
 
     return returnStatus;
@@ -866,6 +738,17 @@ bool EstablishMqttSession( MQTTPublishCallback_t publishCallback,
 
         if( returnStatus == true )
         {
+            /* The store is kept across connections, so it is initialized only
+             * once. */
+            if( outgoingPublishStoreReady == false )
+            {
+                MqttRetransmitStore_Init( &outgoingPublishStore,
+                                          outgoingPublishEntries,
+                                          MAX_OUTGOING_PUBLISHES,
+                                          outgoingPublishIndex );
+                outgoingPublishStoreReady = true;
+            }
+
             /* Check if a session is present and if there are any outgoing
              * publishes that need to be resent. Resending unacknowledged
              * publishes is needed only if the broker is re-establishing a
@@ -885,7 +768,7 @@ bool EstablishMqttSession( MQTTPublishCallback_t publishCallback,
 
                 /* Clean up the outgoing publishes waiting for ack as this new
                  * connection doesn't re-establish an existing session. */
-                cleanupOutgoingPublishes();
+                MqttRetransmitStore_Clear( &outgoingPublishStore );
             }
         }
     }
@@ -1044,20 +927,29 @@ bool PublishToTopic( const char * pTopicFilter,
 {
     bool returnStatus = false;
     MQTTStatus_t mqttStatus = MQTTSuccess;
-    uint8_t publishIndex = MAX_OUTGOING_PUBLISHES;
+    MQTTPublishInfo_t publishInfo;
+    uint16_t packetId = MQTT_PACKET_ID_INVALID;
     MQTTContext_t * pMqttContext = &mqttContext;
 
     assert( pMqttContext != NULL );
     assert( pTopicFilter != NULL );
     assert( topicFilterLength > 0 );
 
-    /* Get the next free index for the outgoing publish. All QoS1 outgoing
-     * publishes are stored until a PUBACK is received. These messages are
-     * stored for supporting a resend if a network connection is broken before
-     * receiving a PUBACK. */
-    returnStatus = getNextFreeIndexForOutgoingPublishes( &publishIndex );
-
-    if( returnStatus == false )
+    /* This example publishes to only one topic and uses QOS1. */
+    ( void ) memset( &publishInfo, 0x00, sizeof( publishInfo ) );
+    publishInfo.qos = MQTTQoS1;
+    publishInfo.pTopicName = pTopicFilter;
+    publishInfo.topicNameLength = ( uint16_t ) topicFilterLength;
+    publishInfo.pPayload = pPayload;
+    publishInfo.payloadLength = payloadLength;
+
+    /* Get a new packet id. */
+    packetId = MQTT_GetPacketId( pMqttContext );
+
+    /* All QoS1 outgoing publishes are stored until a PUBACK is received. These
+     * messages are stored for supporting a resend if a network connection is
+     * broken before receiving a PUBACK. */
+    if( MqttRetransmitStore_Add( &outgoingPublishStore, packetId, &publishInfo ) == false )
     {
         LogError( ( "Unable to find a free spot for outgoing PUBLISH message." ) );
     }
@@ -1067,34 +959,23 @@ bool PublishToTopic( const char * pTopicFilter,
                     ( int ) payloadLength,
                     ( const char * ) pPayload ) );
 
-        /* This example publishes to only one topic and uses QOS1. */
-        outgoingPublishPackets[ publishIndex ].pubInfo.qos = MQTTQoS1;
-        outgoingPublishPackets[ publishIndex ].pubInfo.pTopicName = pTopicFilter;
-        outgoingPublishPackets[ publishIndex ].pubInfo.topicNameLength = topicFilterLength;
-        outgoingPublishPackets[ publishIndex ].pubInfo.pPayload = pPayload;
-        outgoingPublishPackets[ publishIndex ].pubInfo.payloadLength = payloadLength;
-
-        /* Get a new packet id. */
-        outgoingPublishPackets[ publishIndex ].packetId = MQTT_GetPacketId( pMqttContext );
-
         /* Send PUBLISH packet. */
-        mqttStatus = MQTT_Publish( pMqttContext,
-                                   &outgoingPublishPackets[ publishIndex ].pubInfo,
-                                   outgoingPublishPackets[ publishIndex ].packetId );
+        mqttStatus = MQTT_Publish( pMqttContext, &publishInfo, packetId );
 
         if( mqttStatus != MQTTSuccess )
         {
             LogError( ( "Failed to send PUBLISH packet to broker with error = %s.",
                         MQTT_Status_strerror( mqttStatus ) ) );
-            cleanupOutgoingPublishAt( publishIndex );
+            ( void ) MqttRetransmitStore_Remove( &outgoingPublishStore, packetId );
             returnStatus = false;
         }
         else
         {
+            returnStatus = true;
             LogDebug( ( "PUBLISH sent for topic %.*s to broker with packet ID %u.",
                         topicFilterLength,
                         pTopicFilter,
-                        outgoingPublishPackets[ publishIndex ].packetId ) );
+                        packetId ) );
         }
     }
 
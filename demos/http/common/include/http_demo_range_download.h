@@ -0,0 +1,153 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef HTTP_DEMO_RANGE_DOWNLOAD_H_
+#define HTTP_DEMO_RANGE_DOWNLOAD_H_
+
+/* Standard includes. */
+#include <stdlib.h>
+#include <stdbool.h>
+
+/* *INDENT-OFF* */
+#ifdef __cplusplus
+    extern "C" {
+#endif
+/* *INDENT-ON* */
+
+/* HTTP API header. */
+#include "core_http_client.h"
+
+/* Other HTTP utils header. */
+#include "http_demo_utils.h"
+
+/**
+ * @brief Maximum number of connections used by one download.
+ */
+#ifndef RANGE_DOWNLOAD_MAX_CONNECTIONS
+    #define RANGE_DOWNLOAD_MAX_CONNECTIONS    ( 16U )
+#endif
+
+/**
+ * @brief Function pointer for closing a connection opened with a
+ * #TransportConnect_t function.
+ *
+ * @param[in] pNetworkContext Implementation-defined network context.
+ */
+typedef void ( * TransportDisconnect_t )( NetworkContext_t * pNetworkContext );
+
+/**
+ * @brief Configuration of a parallel range download.
+ */
+typedef struct RangeDownloadConfig
+{
+    /**
+     * @brief Request of the object to download. The method must be GET, and
+     * #HTTP_REQUEST_KEEP_ALIVE_FLAG should be set so that each connection
+     * serves many ranges.
+     */
+    const HTTPRequestInfo_t * pRequestInfo;
+
+    /**
+     * @brief One transport interface per connection. The pNetworkContext
+     * member of each must point to a distinct network context.
+     */
+    TransportInterface_t * pTransportInterfaces;
+
+    /**
+     * @brief Number of connections in @ref pTransportInterfaces, at most
+     * #RANGE_DOWNLOAD_MAX_CONNECTIONS.
+     */
+    size_t connectionCount;
+
+    /**
+     * @brief Opens the connection of a network context. Called with backoff
+     * retries when a connection is started or has to be re-established.
+     */
+    TransportConnect_t connectFunction;
+
+    /**
+     * @brief Closes the connection of a network context.
+     */
+    TransportDisconnect_t disconnectFunction;
+
+    /**
+     * @brief Buffer split evenly between the connections. Each share is used
+     * for the request headers and then for the response, so it must hold the
+     * response headers plus @ref rangeLength bytes of body.
+     */
+    uint8_t * pBuffer;
+
+    /**
+     * @brief Length of @ref pBuffer.
+     */
+    size_t bufferLength;
+
+    /**
+     * @brief File the object is written to, opened for writing.
+     */
+    int32_t fileDescriptor;
+
+    /**
+     * @brief Size of the object in bytes.
+     */
+    size_t fileSize;
+
+    /**
+     * @brief Number of bytes requested by each range request.
+     */
+    size_t rangeLength;
+
+    /**
+     * @brief Number of times a failed range is requested again before the
+     * download is abandoned.
+     */
+    uint32_t maxRangeRetries;
+} RangeDownloadConfig_t;
+
+/**
+ * @brief Download an object over several keep-alive connections at once.
+ *
+ * The object is split into ranges of #RangeDownloadConfig_t.rangeLength
+ * bytes. Each connection is served by its own thread, which starts with an
+ * equal share of consecutive ranges and steals ranges from the busiest
+ * connection once its share is done. Every completed range is written to its
+ * offset in #RangeDownloadConfig_t.fileDescriptor as soon as it is received,
+ * so ranges may complete in any order.
+ *
+ * A range that fails is put back to be requested again, possibly on another
+ * connection, and the connection it failed on is re-established. The download
+ * fails if a range fails more than #RangeDownloadConfig_t.maxRangeRetries
+ * times or if no connection can be re-established.
+ *
+ * @param[in] pConfig Configuration of the download.
+ *
+ * @return true if the whole object was written to the file; false otherwise.
+ */
+bool downloadRangesInParallel( const RangeDownloadConfig_t * pConfig );
+
+/* *INDENT-OFF* */
+#ifdef __cplusplus
+    }
+#endif
+/* *INDENT-ON* */
+
+#endif /* ifndef HTTP_DEMO_RANGE_DOWNLOAD_H_ */
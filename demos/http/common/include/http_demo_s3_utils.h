@@ -26,6 +26,10 @@
 /* Standard includes. */
 #include <stdlib.h>
 #include <stdbool.h>
+#include <time.h>
+
+/* POSIX includes. */
+#include <pthread.h>
 
 /* *INDENT-OFF* */
 #ifdef __cplusplus
@@ -42,6 +46,9 @@
 /* SIGV4 API header. */
 #include "sigv4.h"
 
+/* MBEDTLS API header. */
+#include "mbedtls/sha256.h"
+
 /**
  * @brief Length in bytes of hex encoded hash digest.
  */
@@ -60,6 +67,166 @@
  */
 #define SERVER_HOST_NAME_MAX_LENGTH              65U
 
+/**
+ * @brief Length of the buffer for the Authorization header value of a
+ * signing context.
+ */
+#ifndef S3_SIGNING_AUTH_MAX_LENGTH
+    #define S3_SIGNING_AUTH_MAX_LENGTH    ( 2048U )
+#endif
+
+/**
+ * @brief Signs range GET requests for one S3 object with
+ * SigV4_GenerateHTTPAuthorization(), keeping what stays the same between the
+ * requests.
+ *
+ * The hash of the empty payload is computed once and given to the SigV4
+ * library with #SIGV4_HTTP_PAYLOAD_IS_HASH, and the SigV4 parameters of the
+ * object are set up once. The caller writes the headers that every range
+ * shares once as well, so that each request only adds its Range header
+ * before it is signed.
+ */
+typedef struct S3SigningContext
+{
+    /* Hex encoded SHA256 of the empty payload, the value of the
+     * x-amz-content-sha256 header. */
+    char payloadHash[ HEX_ENCODED_SHA256_HASH_DIGEST_LENGTH ];
+
+    /* Parameters given to the SigV4 library for every request. */
+    SigV4Parameters_t sigv4Params;
+    SigV4HttpParameters_t httpParams;
+    SigV4CryptoInterface_t cryptoInterface;
+    mbedtls_sha256_context hashContext;
+
+    /* Authorization header value of the last signature. */
+    char authorization[ S3_SIGNING_AUTH_MAX_LENGTH ];
+} S3SigningContext_t;
+
+/**
+ * @brief Length of the buffer a credential manager receives the responses of
+ * the AWS IoT credential provider in, which also bounds the length of the
+ * session token.
+ */
+#ifndef CREDENTIAL_MANAGER_BUFFER_LENGTH
+    #define CREDENTIAL_MANAGER_BUFFER_LENGTH    ( 2048U )
+#endif
+
+/**
+ * @brief Length of the buffers for the access key ID and the secret access
+ * key of temporary credentials.
+ */
+#ifndef TEMPORARY_CREDENTIALS_KEY_MAX_LENGTH
+    #define TEMPORARY_CREDENTIALS_KEY_MAX_LENGTH    ( 128U )
+#endif
+
+/**
+ * @brief Seconds before the credentials expire at which a credential manager
+ * refreshes them, at most half of their lifetime.
+ */
+#ifndef CREDENTIAL_MANAGER_REFRESH_MARGIN_S
+    #define CREDENTIAL_MANAGER_REFRESH_MARGIN_S    ( 300 )
+#endif
+
+/**
+ * @brief Most seconds a refresh is moved earlier at random, at most a quarter
+ * of the lifetime of the credentials, so that devices which fetched their
+ * credentials together do not refresh them together.
+ */
+#ifndef CREDENTIAL_MANAGER_REFRESH_JITTER_S
+    #define CREDENTIAL_MANAGER_REFRESH_JITTER_S    ( 60 )
+#endif
+
+/**
+ * @brief Seconds before the credentials expire at which a credential manager
+ * stops handing them out, at most a quarter of their lifetime, so that a
+ * request signed with them still reaches AWS before they expire.
+ */
+#ifndef CREDENTIAL_MANAGER_EXPIRY_GUARD_S
+    #define CREDENTIAL_MANAGER_EXPIRY_GUARD_S    ( 30 )
+#endif
+
+/**
+ * @brief Seconds a credential manager waits after a failed refresh before
+ * it tries again.
+ */
+#ifndef CREDENTIAL_MANAGER_RETRY_DELAY_S
+    #define CREDENTIAL_MANAGER_RETRY_DELAY_S    ( 5 )
+#endif
+
+/**
+ * @brief A copy of temporary credentials from the AWS IoT credential
+ * provider, which the holder can use without the credential manager.
+ */
+typedef struct TemporaryCredentials
+{
+    char accessKeyId[ TEMPORARY_CREDENTIALS_KEY_MAX_LENGTH ];
+    size_t accessKeyIdLen;
+    char secretAccessKey[ TEMPORARY_CREDENTIALS_KEY_MAX_LENGTH ];
+    size_t secretAccessKeyLen;
+    char securityToken[ CREDENTIAL_MANAGER_BUFFER_LENGTH ];
+    size_t securityTokenLen;
+
+    /* The time of the AWS IoT credential provider when the copy was made, in
+     * the ISO8601 format of the x-amz-date header, and terminated. */
+    char dateISO8601[ SIGV4_ISO_STRING_LEN + 1 ];
+
+    /* When the credentials expire, in seconds since the epoch. */
+    time_t expiration;
+
+    /* Counts the credentials fetched by the manager, so that a holder can
+     * tell whether two copies hold the same credentials. */
+    uint32_t generation;
+} TemporaryCredentials_t;
+
+/**
+ * @brief Keeps temporary credentials from the AWS IoT credential provider
+ * and refreshes them in a background thread before they expire.
+ *
+ * The connection to the credential provider is kept open between refreshes.
+ * Only one refresh is in flight at a time: threads that need credentials
+ * while one runs wait for its result instead of starting their own.
+ *
+ * Times are kept on the monotonic clock, offset by the date of the response
+ * of the credential provider, so the device clock does not need to be set.
+ */
+typedef struct CredentialManager
+{
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;
+    pthread_t refresher;
+
+    /* The connection to the credential provider, owned by the manager. */
+    NetworkContext_t * pNetworkContext;
+    bool isConnected;
+
+    bool isRefreshing;
+    bool isStopping;
+
+    /* Counts the refreshes that finished, successful or not. */
+    uint32_t refreshCount;
+
+    /* The credentials, with TemporaryCredentials_t.dateISO8601 unset. */
+    TemporaryCredentials_t credentials;
+    bool hasCredentials;
+
+    /* The date of the response the credentials came in, and the monotonic
+     * time it was received at. */
+    time_t fetchDate;
+    time_t fetchTime;
+
+    /* Monotonic times to refresh the credentials at and to stop handing them
+     * out at. */
+    time_t refreshTime;
+    time_t expiryTime;
+
+    /* Seed of the jitter of the refreshes. */
+    unsigned int seed;
+
+    /* Buffer for the requests to and responses from the credential
+     * provider. */
+    uint8_t buffer[ CREDENTIAL_MANAGER_BUFFER_LENGTH ];
+} CredentialManager_t;
+
 /**
  * @brief The host address string extracted from the AWS IOT CREDENTIAL PROVIDER URL.
  *
@@ -95,7 +262,7 @@ extern const char * pExpiration;
  * @brief Length of expiration time for the temporary credentials retrieved
  * from AWS IoT credential provider service.
  */
-size_t expirationLen;
+extern size_t expirationLen;
 
 /**
  * @brief Retrieve the temporary credentials from AWS IOT Credential Provider.
@@ -161,6 +328,88 @@ int32_t sha256Final( void * hashContext,
  */
 int32_t connectToIotServer( NetworkContext_t * pNetworkContext );
 
+/**
+ * @brief Prepare a signing context for range GET requests of one S3 object.
+ *
+ * @param[out] pContext The signing context.
+ * @param[in] pSigv4Params Credentials, ISO8601 date, region and service of
+ * the requests, which must stay valid while the context is used. Its crypto
+ * interface and HTTP parameters are not used.
+ * @param[in] pPath The path of the object, which must stay valid while the
+ * context is used.
+ * @param[in] pathLen Length of the path.
+ *
+ * @return `true` on success; `false` if hashing the empty payload fails.
+ */
+bool s3SigningContextInit( S3SigningContext_t * pContext,
+                           const SigV4Parameters_t * pSigv4Params,
+                           const char * pPath,
+                           size_t pathLen );
+
+/**
+ * @brief Sign a GET request for the object of a signing context with
+ * SigV4_GenerateHTTPAuthorization().
+ *
+ * All the headers of the request are signed. They must include the
+ * x-amz-content-sha256 header, set to S3SigningContext_t.payloadHash, and the
+ * x-amz-date header, set to the date of the context.
+ *
+ * @param[in] pContext The signing context.
+ * @param[in] pRequestHeaders The request, without its Authorization header.
+ * @param[out] pAuthorization The Authorization header value, held by the
+ * context until its next signature.
+ * @param[out] pAuthorizationLen Length of the Authorization header value.
+ *
+ * @return `true` on success; `false` if the SigV4 library fails.
+ */
+bool s3SignRangeRequest( S3SigningContext_t * pContext,
+                         const HTTPRequestHeaders_t * pRequestHeaders,
+                         const char ** pAuthorization,
+                         size_t * pAuthorizationLen );
+
+/**
+ * @brief Fetch temporary credentials from the AWS IoT credential provider
+ * and start the thread of a credential manager that refreshes them.
+ *
+ * @note getTemporaryCredentials() sets the #pSecurityToken and #pExpiration
+ * globals, so no other thread may fetch credentials while the manager runs.
+ * SIGPIPE must be ignored, as a refresh may write to a connection that the
+ * credential provider has closed.
+ *
+ * @param[out] pManager The credential manager.
+ * @param[in] pNetworkContext An unconnected network context for the
+ * connection to the credential provider, which the manager uses until
+ * credentialManagerCleanup().
+ *
+ * @return `true` if the credentials were fetched and the thread started;
+ * `false` otherwise.
+ */
+bool credentialManagerInit( CredentialManager_t * pManager,
+                            NetworkContext_t * pNetworkContext );
+
+/**
+ * @brief Copy the credentials of a credential manager, with the current date
+ * of the credential provider.
+ *
+ * Credentials close to their expiry are refreshed first, sharing the refresh
+ * with any other thread that is in one.
+ *
+ * @param[in] pManager The credential manager.
+ * @param[out] pCredentials The copy of the credentials.
+ *
+ * @return `true` on success; `false` if the credentials are close to their
+ * expiry and could not be refreshed.
+ */
+bool credentialManagerGet( CredentialManager_t * pManager,
+                           TemporaryCredentials_t * pCredentials );
+
+/**
+ * @brief Stop the thread of a credential manager and close its connection.
+ *
+ * @param[in] pManager The credential manager.
+ */
+void credentialManagerCleanup( CredentialManager_t * pManager );
+
 /* *INDENT-OFF* */
 #ifdef __cplusplus
     }
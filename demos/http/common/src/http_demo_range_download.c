@@ -0,0 +1,709 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <string.h>
+#include <errno.h>
+
+/* POSIX includes. */
+#include <unistd.h>
+#include <pthread.h>
+
+/* Include Demo Config as the first non-system header. */
+#include "demo_config.h"
+
+/* Range downloader header. */
+#include "http_demo_range_download.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief HTTP status code returned for partial content.
+ */
+#define RANGE_DOWNLOAD_STATUS_PARTIAL_CONTENT    ( 206U )
+
+/**
+ * @brief Consecutive ranges not yet taken by the thread of a connection.
+ *
+ * The owning thread takes ranges from the head. Other threads steal from the
+ * tail, so that the owner keeps requesting consecutive parts of the object.
+ */
+typedef struct RangeDeque
+{
+    pthread_mutex_t mutex; /**< @brief Protects head and tail. */
+    size_t head;           /**< @brief Next range the owner takes. */
+    size_t tail;           /**< @brief One past the last range of the deque. */
+} RangeDeque_t;
+
+/**
+ * @brief A range that failed and has to be requested again.
+ */
+typedef struct RetryRange
+{
+    size_t rangeIndex; /**< @brief Index of the range in the object. */
+    uint32_t attempts; /**< @brief Number of times the range was requested. */
+} RetryRange_t;
+
+struct RangeDownload;
+
+/**
+ * @brief State of the thread serving one connection.
+ */
+typedef struct RangeWorker
+{
+    struct RangeDownload * pDownload;           /**< @brief Download the worker belongs to. */
+    TransportInterface_t * pTransportInterface; /**< @brief Connection of the worker. */
+    uint8_t * pBuffer;                          /**< @brief Share of the request and response buffer. */
+    size_t bufferLength;                        /**< @brief Length of pBuffer. */
+    RangeDeque_t deque;                         /**< @brief Ranges left to the worker. */
+    pthread_t thread;                           /**< @brief Thread of the worker. */
+    bool isConnected;                           /**< @brief Whether the connection is open. */
+} RangeWorker_t;
+
+/**
+ * @brief State shared by the workers of a download.
+ */
+typedef struct RangeDownload
+{
+    const RangeDownloadConfig_t * pConfig;                   /**< @brief Configuration of the download. */
+    size_t rangeCount;                                       /**< @brief Number of ranges in the object. */
+    RangeWorker_t workers[ RANGE_DOWNLOAD_MAX_CONNECTIONS ]; /**< @brief One worker per connection. */
+    size_t workerCount;                                      /**< @brief Number of workers. */
+
+    pthread_mutex_t mutex;                                   /**< @brief Protects the members below. */
+    pthread_cond_t rangeAvailable;                           /**< @brief Signalled when a range is put back, stolen ranges are published or the download ends. */
+    RetryRange_t retries[ RANGE_DOWNLOAD_MAX_CONNECTIONS ];  /**< @brief Failed ranges waiting for a retry. */
+    size_t retryCount;                                       /**< @brief Number of entries in retries. */
+    uint32_t stealCount;                                     /**< @brief Incremented when stolen ranges become stealable again. */
+    size_t pendingRanges;                                    /**< @brief Ranges not yet written to the file. */
+    size_t activeWorkers;                                    /**< @brief Workers still able to download. */
+    bool isAborted;                                          /**< @brief Set when the download cannot complete. */
+} RangeDownload_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Take the next range to download, waiting for a failed range to be
+ * put back if no other range is left.
+ *
+ * @param[in] pWorker Worker taking the range.
+ * @param[out] pRangeIndex Index of the range.
+ * @param[out] pAttempts Number of times the range was already requested.
+ *
+ * @return true if a range was taken; false when there is nothing left to do.
+ */
+static bool takeRange( RangeWorker_t * pWorker,
+                       size_t * pRangeIndex,
+                       uint32_t * pAttempts );
+
+/**
+ * @brief Move the last half of the ranges of the worker with the most ranges
+ * left to @p pWorker, and take the first of them.
+ *
+ * @param[in] pWorker Worker whose own deque is empty.
+ * @param[out] pRangeIndex Index of the range taken.
+ *
+ * @return true if a range was stolen; false if all deques are empty.
+ */
+static bool stealRanges( RangeWorker_t * pWorker,
+                         size_t * pRangeIndex );
+
+/**
+ * @brief Record the outcome of a range.
+ *
+ * A failed range is put back for any worker to retry, unless it has been
+ * requested too many times, in which case the download is aborted.
+ *
+ * @param[in] pDownload The download.
+ * @param[in] rangeIndex Index of the range.
+ * @param[in] attempts Number of times the range was requested.
+ * @param[in] isWritten Whether the range was written to the file.
+ */
+static void completeRange( RangeDownload_t * pDownload,
+                           size_t rangeIndex,
+                           uint32_t attempts,
+                           bool isWritten );
+
+/**
+ * @brief Request one range and write its body to the file.
+ *
+ * @param[in] pWorker Worker downloading the range.
+ * @param[in] rangeIndex Index of the range.
+ * @param[out] pReconnectRequired Set to true if the connection cannot serve
+ * another request.
+ *
+ * @return true if the range was written to the file; false otherwise.
+ */
+static bool downloadRange( RangeWorker_t * pWorker,
+                           size_t rangeIndex,
+                           bool * pReconnectRequired );
+
+/**
+ * @brief Write a buffer to an offset of a file.
+ *
+ * @param[in] fileDescriptor File to write to.
+ * @param[in] pData Data to write.
+ * @param[in] length Length of @p pData.
+ * @param[in] offset Offset of the data in the file.
+ *
+ * @return true if all the data was written; false otherwise.
+ */
+static bool writeAtOffset( int32_t fileDescriptor,
+                           const uint8_t * pData,
+                           size_t length,
+                           size_t offset );
+
+/**
+ * @brief Thread of a worker. Downloads ranges over the worker's connection
+ * until none are left.
+ *
+ * @param[in] pArgument The #RangeWorker_t of the thread.
+ *
+ * @return NULL.
+ */
+static void * rangeWorkerThread( void * pArgument );
+
+/*-----------------------------------------------------------*/
+
+static bool stealRanges( RangeWorker_t * pWorker,
+                         size_t * pRangeIndex )
+{
+    RangeDownload_t * pDownload = pWorker->pDownload;
+    RangeWorker_t * pVictim = NULL;
+    size_t mostRanges = 0U;
+    size_t stolenCount = 0U;
+    size_t stolenHead = 0U;
+    size_t remaining = 0U;
+    size_t i;
+
+    /* Pick the worker with the most ranges left. */
+    for( i = 0U; i < pDownload->workerCount; i++ )
+    {
+        ( void ) pthread_mutex_lock( &pDownload->workers[ i ].deque.mutex );
+        remaining = pDownload->workers[ i ].deque.tail - pDownload->workers[ i ].deque.head;
+        ( void ) pthread_mutex_unlock( &pDownload->workers[ i ].deque.mutex );
+
+        if( remaining > mostRanges )
+        {
+            mostRanges = remaining;
+            pVictim = &pDownload->workers[ i ];
+        }
+    }
+
+    if( pVictim != NULL )
+    {
+        /* The victim may have taken ranges since it was picked. */
+        ( void ) pthread_mutex_lock( &pVictim->deque.mutex );
+        remaining = pVictim->deque.tail - pVictim->deque.head;
+        stolenCount = ( remaining + 1U ) / 2U;
+        pVictim->deque.tail -= stolenCount;
+        stolenHead = pVictim->deque.tail;
+        ( void ) pthread_mutex_unlock( &pVictim->deque.mutex );
+    }
+
+    if( stolenCount > 0U )
+    {
+        LogDebug( ( "Stole %lu ranges starting at range %lu.",
+                    ( unsigned long ) stolenCount,
+                    ( unsigned long ) stolenHead ) );
+
+        *pRangeIndex = stolenHead;
+
+        if( stolenCount > 1U )
+        {
+            ( void ) pthread_mutex_lock( &pWorker->deque.mutex );
+            pWorker->deque.head = stolenHead + 1U;
+            pWorker->deque.tail = stolenHead + stolenCount;
+            ( void ) pthread_mutex_unlock( &pWorker->deque.mutex );
+
+            /* Workers that found every deque empty while these ranges were
+             * moved can steal them now. */
+            ( void ) pthread_mutex_lock( &pDownload->mutex );
+            pDownload->stealCount++;
+            ( void ) pthread_cond_broadcast( &pDownload->rangeAvailable );
+            ( void ) pthread_mutex_unlock( &pDownload->mutex );
+        }
+    }
+
+    return( stolenCount > 0U );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool takeRange( RangeWorker_t * pWorker,
+                       size_t * pRangeIndex,
+                       uint32_t * pAttempts )
+{
+    RangeDownload_t * pDownload = pWorker->pDownload;
+    bool isTaken = false;
+    bool isDone = false;
+    uint32_t seenStealCount = 0U;
+
+    *pAttempts = 0U;
+
+    while( ( isTaken == false ) && ( isDone == false ) )
+    {
+        /* Ranges that were put back are retried first, which also bounds
+         * their number by the number of workers. */
+        ( void ) pthread_mutex_lock( &pDownload->mutex );
+
+        if( pDownload->isAborted == true )
+        {
+            isDone = true;
+        }
+        else if( pDownload->retryCount > 0U )
+        {
+            pDownload->retryCount--;
+            *pRangeIndex = pDownload->retries[ pDownload->retryCount ].rangeIndex;
+            *pAttempts = pDownload->retries[ pDownload->retryCount ].attempts;
+            isTaken = true;
+        }
+        else
+        {
+            seenStealCount = pDownload->stealCount;
+        }
+
+        ( void ) pthread_mutex_unlock( &pDownload->mutex );
+
+        if( ( isTaken == false ) && ( isDone == false ) )
+        {
+            ( void ) pthread_mutex_lock( &pWorker->deque.mutex );
+
+            if( pWorker->deque.head < pWorker->deque.tail )
+            {
+                *pRangeIndex = pWorker->deque.head;
+                pWorker->deque.head++;
+                isTaken = true;
+            }
+
+            ( void ) pthread_mutex_unlock( &pWorker->deque.mutex );
+        }
+
+        if( ( isTaken == false ) && ( isDone == false ) )
+        {
+            isTaken = stealRanges( pWorker, pRangeIndex );
+        }
+
+        if( ( isTaken == false ) && ( isDone == false ) )
+        {
+            /* Every deque is empty. Ranges still being downloaded by other
+             * workers may fail and be put back, so wait for them. */
+            ( void ) pthread_mutex_lock( &pDownload->mutex );
+
+            while( ( pDownload->retryCount == 0U ) &&
+                   ( pDownload->pendingRanges > 0U ) &&
+                   ( pDownload->isAborted == false ) &&
+                   ( pDownload->stealCount == seenStealCount ) )
+            {
+                ( void ) pthread_cond_wait( &pDownload->rangeAvailable, &pDownload->mutex );
+            }
+
+            if( ( pDownload->pendingRanges == 0U ) || ( pDownload->isAborted == true ) )
+            {
+                isDone = true;
+            }
+
+            ( void ) pthread_mutex_unlock( &pDownload->mutex );
+        }
+    }
+
+    return isTaken;
+}
+
+/*-----------------------------------------------------------*/
+
+static void completeRange( RangeDownload_t * pDownload,
+                           size_t rangeIndex,
+                           uint32_t attempts,
+                           bool isWritten )
+{
+    ( void ) pthread_mutex_lock( &pDownload->mutex );
+
+    if( isWritten == true )
+    {
+        pDownload->pendingRanges--;
+
+        if( pDownload->pendingRanges == 0U )
+        {
+            ( void ) pthread_cond_broadcast( &pDownload->rangeAvailable );
+        }
+    }
+    else if( attempts > pDownload->pConfig->maxRangeRetries )
+    {
+        LogError( ( "Range %lu failed %lu times, abandoning the download.",
+                    ( unsigned long ) rangeIndex,
+                    ( unsigned long ) attempts ) );
+        pDownload->isAborted = true;
+        ( void ) pthread_cond_broadcast( &pDownload->rangeAvailable );
+    }
+    else
+    {
+        /* A worker takes a put back range before any other, so no more than
+         * one put back range per worker is waiting. */
+        assert( pDownload->retryCount < RANGE_DOWNLOAD_MAX_CONNECTIONS );
+
+        pDownload->retries[ pDownload->retryCount ].rangeIndex = rangeIndex;
+        pDownload->retries[ pDownload->retryCount ].attempts = attempts;
+        pDownload->retryCount++;
+        ( void ) pthread_cond_signal( &pDownload->rangeAvailable );
+    }
+
+    ( void ) pthread_mutex_unlock( &pDownload->mutex );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool writeAtOffset( int32_t fileDescriptor,
+                           const uint8_t * pData,
+                           size_t length,
+                           size_t offset )
+{
+    bool returnStatus = true;
+    size_t written = 0U;
+    ssize_t result = 0;
+
+    while( ( returnStatus == true ) && ( written < length ) )
+    {
+        result = pwrite( fileDescriptor,
+                         &pData[ written ],
+                         length - written,
+                         ( off_t ) ( offset + written ) );
+
+        if( result > 0 )
+        {
+            written += ( size_t ) result;
+        }
+        else if( ( result < 0 ) && ( errno == EINTR ) )
+        {
+            /* Interrupted before anything was written; try again. */
+        }
+        else
+        {
+            LogError( ( "Failed to write %lu bytes at offset %lu of the file: %s.",
+                        ( unsigned long ) ( length - written ),
+                        ( unsigned long ) ( offset + written ),
+                        strerror( errno ) ) );
+            returnStatus = false;
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool downloadRange( RangeWorker_t * pWorker,
+                           size_t rangeIndex,
+                           bool * pReconnectRequired )
+{
+    const RangeDownloadConfig_t * pConfig = pWorker->pDownload->pConfig;
+    bool returnStatus = true;
+    HTTPStatus_t httpStatus = HTTPSuccess;
+    HTTPRequestHeaders_t requestHeaders;
+    HTTPResponse_t response;
+    size_t start = rangeIndex * pConfig->rangeLength;
+    size_t length = pConfig->rangeLength;
+
+    if( length > ( pConfig->fileSize - start ) )
+    {
+        length = pConfig->fileSize - start;
+    }
+
+    ( void ) memset( &requestHeaders, 0, sizeof( requestHeaders ) );
+    ( void ) memset( &response, 0, sizeof( response ) );
+
+    /* The same buffer is used for the request headers and the response, as
+     * the headers are sent before the response is received. */
+    requestHeaders.pBuffer = pWorker->pBuffer;
+    requestHeaders.bufferLen = pWorker->bufferLength;
+
+    httpStatus = HTTPClient_InitializeRequestHeaders( &requestHeaders,
+                                                      pConfig->pRequestInfo );
+
+    if( httpStatus == HTTPSuccess )
+    {
+        httpStatus = HTTPClient_AddRangeHeader( &requestHeaders,
+                                                ( int32_t ) start,
+                                                ( int32_t ) ( start + length - 1U ) );
+    }
+
+    if( httpStatus != HTTPSuccess )
+    {
+        LogError( ( "Failed to create the request for range %lu: Error=%s.",
+                    ( unsigned long ) rangeIndex,
+                    HTTPClient_strerror( httpStatus ) ) );
+        returnStatus = false;
+    }
+
+    if( returnStatus == true )
+    {
+        response.pBuffer = pWorker->pBuffer;
+        response.bufferLen = pWorker->bufferLength;
+
+        httpStatus = HTTPClient_Send( pWorker->pTransportInterface,
+                                      &requestHeaders,
+                                      NULL,
+                                      0,
+                                      &response,
+                                      0 );
+
+        if( httpStatus != HTTPSuccess )
+        {
+            /* Part of the response may still be unread, so the connection
+             * cannot be reused. */
+            LogWarn( ( "Failed to download range %lu: Error=%s.",
+                       ( unsigned long ) rangeIndex,
+                       HTTPClient_strerror( httpStatus ) ) );
+            *pReconnectRequired = true;
+            returnStatus = false;
+        }
+        else if( ( response.respFlags & HTTP_RESPONSE_CONNECTION_CLOSE_FLAG ) != 0U )
+        {
+            *pReconnectRequired = true;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+    }
+
+    if( returnStatus == true )
+    {
+        if( response.statusCode != RANGE_DOWNLOAD_STATUS_PARTIAL_CONTENT )
+        {
+            LogWarn( ( "Received unexpected status code %u for range %lu.",
+                       ( unsigned int ) response.statusCode,
+                       ( unsigned long ) rangeIndex ) );
+            returnStatus = false;
+        }
+        else if( response.bodyLen != length )
+        {
+            LogWarn( ( "Received %lu bytes for range %lu instead of %lu.",
+                       ( unsigned long ) response.bodyLen,
+                       ( unsigned long ) rangeIndex,
+                       ( unsigned long ) length ) );
+            returnStatus = false;
+        }
+        else
+        {
+            returnStatus = writeAtOffset( pConfig->fileDescriptor,
+                                          response.pBody,
+                                          length,
+                                          start );
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void * rangeWorkerThread( void * pArgument )
+{
+    RangeWorker_t * pWorker = ( RangeWorker_t * ) pArgument;
+    RangeDownload_t * pDownload = pWorker->pDownload;
+    const RangeDownloadConfig_t * pConfig = pDownload->pConfig;
+    bool canDownload = true;
+    bool isWritten = false;
+    bool reconnectRequired = false;
+    size_t rangeIndex = 0U;
+    uint32_t attempts = 0U;
+
+    while( ( canDownload == true ) &&
+           ( takeRange( pWorker, &rangeIndex, &attempts ) == true ) )
+    {
+        if( pWorker->isConnected == false )
+        {
+            if( connectToServerWithBackoffRetries( pConfig->connectFunction,
+                                                   pWorker->pTransportInterface->pNetworkContext ) == EXIT_SUCCESS )
+            {
+                pWorker->isConnected = true;
+            }
+            else
+            {
+                /* Leave the range and the rest of the deque to the other
+                 * workers. */
+                completeRange( pDownload, rangeIndex, attempts, false );
+                canDownload = false;
+            }
+        }
+
+        if( canDownload == true )
+        {
+            reconnectRequired = false;
+            isWritten = downloadRange( pWorker, rangeIndex, &reconnectRequired );
+
+            if( isWritten == false )
+            {
+                attempts++;
+            }
+
+            completeRange( pDownload, rangeIndex, attempts, isWritten );
+
+            if( reconnectRequired == true )
+            {
+                pConfig->disconnectFunction( pWorker->pTransportInterface->pNetworkContext );
+                pWorker->isConnected = false;
+            }
+        }
+    }
+
+    if( pWorker->isConnected == true )
+    {
+        pConfig->disconnectFunction( pWorker->pTransportInterface->pNetworkContext );
+        pWorker->isConnected = false;
+    }
+
+    ( void ) pthread_mutex_lock( &pDownload->mutex );
+    pDownload->activeWorkers--;
+
+    if( ( pDownload->activeWorkers == 0U ) &&
+        ( pDownload->pendingRanges > 0U ) &&
+        ( pDownload->isAborted == false ) )
+    {
+        LogError( ( "No connection is left to download the remaining %lu ranges.",
+                    ( unsigned long ) pDownload->pendingRanges ) );
+        pDownload->isAborted = true;
+    }
+
+    ( void ) pthread_cond_broadcast( &pDownload->rangeAvailable );
+    ( void ) pthread_mutex_unlock( &pDownload->mutex );
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+bool downloadRangesInParallel( const RangeDownloadConfig_t * pConfig )
+{
+    bool returnStatus = true;
+    RangeDownload_t download;
+    RangeWorker_t * pWorker = NULL;
+    size_t shareLength = 0U;
+    size_t startedCount = 0U;
+    size_t i;
+
+    if( ( pConfig == NULL ) ||
+        ( pConfig->pRequestInfo == NULL ) ||
+        ( pConfig->pTransportInterfaces == NULL ) ||
+        ( pConfig->connectionCount == 0U ) ||
+        ( pConfig->connectionCount > RANGE_DOWNLOAD_MAX_CONNECTIONS ) ||
+        ( pConfig->connectFunction == NULL ) ||
+        ( pConfig->disconnectFunction == NULL ) ||
+        ( pConfig->pBuffer == NULL ) ||
+        ( pConfig->bufferLength < pConfig->connectionCount ) ||
+        ( pConfig->rangeLength == 0U ) )
+    {
+        LogError( ( "Invalid range download configuration." ) );
+        returnStatus = false;
+    }
+
+    if( returnStatus == true )
+    {
+        ( void ) memset( &download, 0, sizeof( download ) );
+        download.pConfig = pConfig;
+        download.rangeCount = ( pConfig->fileSize + pConfig->rangeLength - 1U ) / pConfig->rangeLength;
+        download.pendingRanges = download.rangeCount;
+
+        /* A connection without a range of its own would only steal. */
+        download.workerCount = pConfig->connectionCount;
+
+        if( download.workerCount > download.rangeCount )
+        {
+            download.workerCount = download.rangeCount;
+        }
+
+        shareLength = pConfig->bufferLength / pConfig->connectionCount;
+
+        ( void ) pthread_mutex_init( &download.mutex, NULL );
+        ( void ) pthread_cond_init( &download.rangeAvailable, NULL );
+
+        for( i = 0U; i < download.workerCount; i++ )
+        {
+            pWorker = &download.workers[ i ];
+            pWorker->pDownload = &download;
+            pWorker->pTransportInterface = &pConfig->pTransportInterfaces[ i ];
+            pWorker->pBuffer = &pConfig->pBuffer[ i * shareLength ];
+            pWorker->bufferLength = shareLength;
+            pWorker->deque.head = ( i * download.rangeCount ) / download.workerCount;
+            pWorker->deque.tail = ( ( i + 1U ) * download.rangeCount ) / download.workerCount;
+            ( void ) pthread_mutex_init( &pWorker->deque.mutex, NULL );
+        }
+
+        LogInfo( ( "Downloading %lu bytes as %lu ranges over %lu connections.",
+                   ( unsigned long ) pConfig->fileSize,
+                   ( unsigned long ) download.rangeCount,
+                   ( unsigned long ) download.workerCount ) );
+
+        /* Workers started later can already be stolen from, so the count of
+         * active workers must cover all of them from the start. */
+        download.activeWorkers = download.workerCount;
+
+        for( i = 0U; i < download.workerCount; i++ )
+        {
+            if( pthread_create( &download.workers[ i ].thread,
+                                NULL,
+                                rangeWorkerThread,
+                                &download.workers[ i ] ) != 0 )
+            {
+                /* The ranges of the worker are stolen by the others. */
+                LogWarn( ( "Failed to start the thread of connection %lu.",
+                           ( unsigned long ) i ) );
+                break;
+            }
+        }
+
+        startedCount = i;
+
+        ( void ) pthread_mutex_lock( &download.mutex );
+        download.activeWorkers -= download.workerCount - startedCount;
+
+        if( ( download.activeWorkers == 0U ) && ( download.pendingRanges > 0U ) )
+        {
+            download.isAborted = true;
+        }
+
+        ( void ) pthread_cond_broadcast( &download.rangeAvailable );
+        ( void ) pthread_mutex_unlock( &download.mutex );
+
+        for( i = 0U; i < startedCount; i++ )
+        {
+            ( void ) pthread_join( download.workers[ i ].thread, NULL );
+        }
+
+        if( ( download.isAborted == true ) || ( download.pendingRanges > 0U ) )
+        {
+            returnStatus = false;
+        }
+
+        for( i = 0U; i < download.workerCount; i++ )
+        {
+            ( void ) pthread_mutex_destroy( &download.workers[ i ].deque.mutex );
+        }
+
+        ( void ) pthread_cond_destroy( &download.rangeAvailable );
+        ( void ) pthread_mutex_destroy( &download.mutex );
+    }
+
+    return returnStatus;
+}
@@ -23,7 +23,9 @@
 /* Standard includes. */
 #include <assert.h>
 #include <time.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 /* POSIX includes. */
 #include <unistd.h>
@@ -79,6 +81,29 @@
  */
 #define CREDENTIALS_RESPONSE_EXPIRATION_DATE_KEY      "credentials.expiration"
 
+/**
+ * @brief Represents empty payload for HTTP GET request sent to AWS S3.
+ */
+#define S3_REQUEST_EMPTY_PAYLOAD                      ""
+
+/**
+ * @brief Format of the expiration date in the IoT credentials response,
+ * e.g. "2021-01-28T00:12:41Z".
+ */
+#define CREDENTIALS_EXPIRATION_FORMAT                 "%4d-%2d-%2dT%2d:%2d:%2dZ"
+
+/**
+ * @brief Format of an ISO8601 date as in the x-amz-date header, e.g.
+ * "20210128T001241Z", for reading and for writing.
+ */
+#define CREDENTIALS_ISO8601_SCAN_FORMAT               "%4d%2d%2dT%2d%2d%2dZ"
+#define CREDENTIALS_ISO8601_PRINT_FORMAT              "%Y%m%dT%H%M%SZ"
+
+/**
+ * @brief Length of the buffer a date is terminated in to be read.
+ */
+#define CREDENTIALS_DATE_MAX_LENGTH                   32U
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -134,6 +159,93 @@ size_t expirationLen;
 static JSONStatus_t parseCredentials( HTTPResponse_t * response,
                                       SigV4Credentials_t * sigvCreds );
 
+/**
+ * @brief Lowercase hex encode bytes.
+ *
+ * @param[in] pInput Bytes to encode.
+ * @param[in] inputLen Number of bytes to encode.
+ * @param[out] pOutput Buffer of twice @p inputLen characters.
+ */
+static void hexEncode( const uint8_t * pInput,
+                       size_t inputLen,
+                       char * pOutput );
+
+/**
+ * @brief Connect to the AWS IoT credential provider without setting the
+ * #serverHost global, which the demos use for the S3 server meanwhile.
+ *
+ * @param[out] pNetworkContext The output parameter to return the created
+ * network context.
+ *
+ * @return EXIT_FAILURE on failure; EXIT_SUCCESS on successful connection.
+ */
+static int32_t connectToCredentialProvider( NetworkContext_t * pNetworkContext );
+
+/**
+ * @brief Read a UTC date.
+ *
+ * @param[in] pDate The date, not terminated.
+ * @param[in] dateLen Length of the date.
+ * @param[in] pFormat sscanf() format of the year, month, day, hours, minutes
+ * and seconds of the date.
+ * @param[out] pTime The date in seconds since the epoch.
+ *
+ * @return `true` on success; `false` if the date does not match the format.
+ */
+static bool parseDate( const char * pDate,
+                       size_t dateLen,
+                       const char * pFormat,
+                       time_t * pTime );
+
+/**
+ * @brief Read the monotonic clock.
+ *
+ * @return Seconds since an arbitrary point in the past.
+ */
+static time_t monotonicSeconds( void );
+
+/**
+ * @brief Fetch temporary credentials for a credential manager over its kept
+ * open connection, or over a new one if there is none or the kept one
+ * fails.
+ *
+ * @note Only the thread that is in the refresh of the manager may call this.
+ *
+ * @param[in] pManager The credential manager.
+ * @param[out] pCredentials The credentials.
+ * @param[out] pFetchDate The date of the response of the credential provider.
+ * @param[out] pFetchTime The monotonic time the response was received at.
+ *
+ * @return `true` on success; `false` otherwise.
+ */
+static bool fetchCredentials( CredentialManager_t * pManager,
+                              TemporaryCredentials_t * pCredentials,
+                              time_t * pFetchDate,
+                              time_t * pFetchTime );
+
+/**
+ * @brief Refresh the credentials of a credential manager, and schedule the
+ * next refresh.
+ *
+ * @note The lock of the manager must be held, no refresh may be in flight,
+ * and the lock is released while the credentials are fetched.
+ *
+ * @param[in] pManager The credential manager.
+ *
+ * @return `true` on success; `false` otherwise.
+ */
+static bool refreshCredentials( CredentialManager_t * pManager );
+
+/**
+ * @brief Thread of a credential manager that refreshes its credentials when
+ * they are due.
+ *
+ * @param[in] pArgument The credential manager.
+ *
+ * @return NULL.
+ */
+static void * refresherThread( void * pArgument );
+
 /*-----------------------------------------------------------*/
 
 bool getTemporaryCredentials( TransportInterface_t * transportInterface,
@@ -178,7 +290,9 @@ bool getTemporaryCredentials( TransportInterface_t * transportInterface,
     requestInfo.pathLen = pathLen;
     requestInfo.pHost = pAddress;
     requestInfo.hostLen = addressLen;
-    requestInfo.reqFlags = 0;
+    /* Keep the connection open, for a credential manager to send its next
+     * refresh over. */
+    requestInfo.reqFlags = HTTP_REQUEST_KEEP_ALIVE_FLAG;
 
     response->pHeaderParsingCallback = NULL;
 
@@ -323,50 +437,68 @@ int32_t sha256Final( void * hashContext,
 
 int32_t connectToIotServer( NetworkContext_t * pNetworkContext )
 {
-    int32_t returnStatus = EXIT_SUCCESS;
     /* Variable to store Host Address of AWS IoT Credential Provider server. */
     const char * pAddress = NULL;
 
-    /* Status returned by OpenSSL transport implementation. */
-    OpensslStatus_t opensslStatus;
-    /* Credentials to establish the TLS connection. */
-    OpensslCredentials_t opensslCredentials = { 0 };
-    /* Information about the server to send the HTTP requests. */
-    ServerInfo_t serverInfo = { 0 };
-
     pAddress = AWS_IOT_CREDENTIAL_PROVIDER_ENDPOINT;
     serverHostLength = strlen( AWS_IOT_CREDENTIAL_PROVIDER_ENDPOINT );
 
-    if( returnStatus == EXIT_SUCCESS )
+    memcpy( serverHost, pAddress, serverHostLength );
+    serverHost[ serverHostLength ] = '\0';
+
+    return connectToCredentialProvider( pNetworkContext );
+}
+
+/*-----------------------------------------------------------*/
+
+bool s3SigningContextInit( S3SigningContext_t * pContext,
+                           const SigV4Parameters_t * pSigv4Params,
+                           const char * pPath,
+                           size_t pathLen )
+{
+    bool returnStatus = true;
+    uint8_t payloadDigest[ SHA256_HASH_DIGEST_LENGTH ];
+
+    assert( pContext != NULL );
+    assert( pSigv4Params != NULL );
+    assert( pPath != NULL );
+
+    ( void ) memset( pContext, 0, sizeof( S3SigningContext_t ) );
+
+    /* The payload of a GET request is empty, so its hash is the same for
+     * every request. */
+    if( sha256( S3_REQUEST_EMPTY_PAYLOAD, sizeof( S3_REQUEST_EMPTY_PAYLOAD ) - 1U, ( char * ) payloadDigest ) != 0 )
+    {
+        LogError( ( "Failed to hash the empty payload of the S3 requests." ) );
+        returnStatus = false;
+    }
+
+    if( returnStatus == true )
     {
-        memcpy( serverHost, pAddress, serverHostLength );
-        serverHost[ serverHostLength ] = '\0';
-
-        /* Initialize TLS credentials. */
-        opensslCredentials.pRootCaPath = ROOT_CA_CERT_PATH;
-        opensslCredentials.sniHostName = serverHost;
-        opensslCredentials.pClientCertPath = CLIENT_CERT_PATH;
-        opensslCredentials.pPrivateKeyPath = CLIENT_PRIVATE_KEY_PATH;
-
-        /* Initialize server information. */
-        serverInfo.pHostName = serverHost;
-        serverInfo.hostNameLength = serverHostLength;
-        serverInfo.port = HTTPS_PORT;
-
-        /* Establish a TLS session with the HTTP server. This example connects
-         * to the AWS_IOT_CREDENTIAL_PROVIDER_ENDPOINT and HTTPS_PORT in
-         * demo_config.h. */
-        LogInfo( ( "Establishing a TLS session with %s:%d.",
-                   serverHost,
-                   HTTPS_PORT ) );
-
-        opensslStatus = Openssl_Connect( pNetworkContext,
-                                         &serverInfo,
-                                         &opensslCredentials,
-                                         TRANSPORT_SEND_RECV_TIMEOUT_MS,
-                                         TRANSPORT_SEND_RECV_TIMEOUT_MS );
-
-        returnStatus = ( opensslStatus == OPENSSL_SUCCESS ) ? EXIT_SUCCESS : EXIT_FAILURE;
+        hexEncode( payloadDigest, sizeof( payloadDigest ), pContext->payloadHash );
+
+        pContext->cryptoInterface.hashInit = sha256Init;
+        pContext->cryptoInterface.hashUpdate = sha256Update;
+        pContext->cryptoInterface.hashFinal = sha256Final;
+        pContext->cryptoInterface.pHashContext = &pContext->hashContext;
+        pContext->cryptoInterface.hashBlockLen = HEX_ENCODED_SHA256_HASH_DIGEST_LENGTH;
+        pContext->cryptoInterface.hashDigestLen = SHA256_HASH_DIGEST_LENGTH;
+
+        /* The library is given the hash of the payload instead of hashing it
+         * for every request. */
+        pContext->httpParams.pHttpMethod = HTTP_METHOD_GET;
+        pContext->httpParams.httpMethodLen = sizeof( HTTP_METHOD_GET ) - 1U;
+        pContext->httpParams.flags = SIGV4_HTTP_PAYLOAD_IS_HASH;
+        pContext->httpParams.pPath = pPath;
+        pContext->httpParams.pathLen = pathLen;
+        pContext->httpParams.pQuery = NULL;
+        pContext->httpParams.queryLen = 0U;
+        pContext->httpParams.pPayload = pContext->payloadHash;
+        pContext->httpParams.payloadLen = HEX_ENCODED_SHA256_HASH_DIGEST_LENGTH;
+
+        pContext->sigv4Params = *pSigv4Params;
+        pContext->sigv4Params.pCryptoInterface = &pContext->cryptoInterface;
+        pContext->sigv4Params.pHttpParameters = &pContext->httpParams;
     }
 
     return returnStatus;
@@ -374,6 +506,191 @@ int32_t connectToIotServer( NetworkContext_t * pNetworkContext )
 
 /*-----------------------------------------------------------*/
 
+bool s3SignRangeRequest( S3SigningContext_t * pContext,
+                         const HTTPRequestHeaders_t * pRequestHeaders,
+                         const char ** pAuthorization,
+                         size_t * pAuthorizationLen )
+{
+    bool returnStatus = true;
+    SigV4Status_t sigv4Status = SigV4Success;
+    char * pHeaders = NULL;
+    size_t headersLen = 0;
+    char * pSignature = NULL;
+    size_t signatureLen = 0;
+    size_t authorizationLen = sizeof( pContext->authorization );
+
+    assert( pContext != NULL );
+    assert( pContext->sigv4Params.pHttpParameters != NULL );
+    assert( pRequestHeaders != NULL );
+    assert( pAuthorization != NULL );
+    assert( pAuthorizationLen != NULL );
+
+    /* Skip the request line, which is not a header. */
+    getHeaderStartLocFromHttpRequest( *pRequestHeaders, &pHeaders, &headersLen );
+
+    pContext->httpParams.pHeaders = pHeaders;
+    pContext->httpParams.headersLen = headersLen;
+
+    sigv4Status = SigV4_GenerateHTTPAuthorization( &pContext->sigv4Params,
+                                                   pContext->authorization,
+                                                   &authorizationLen,
+                                                   &pSignature,
+                                                   &signatureLen );
+
+    if( sigv4Status != SigV4Success )
+    {
+        LogError( ( "SigV4 Library Failed to generate AUTHORIZATION Header." ) );
+        returnStatus = false;
+    }
+    else
+    {
+        *pAuthorization = pContext->authorization;
+        *pAuthorizationLen = authorizationLen;
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+bool credentialManagerInit( CredentialManager_t * pManager,
+                            NetworkContext_t * pNetworkContext )
+{
+    bool returnStatus = false;
+    pthread_condattr_t conditionAttributes;
+
+    assert( pManager != NULL );
+    assert( pNetworkContext != NULL );
+
+    ( void ) memset( pManager, 0, sizeof( CredentialManager_t ) );
+    pManager->pNetworkContext = pNetworkContext;
+    pManager->seed = ( unsigned int ) time( NULL ) ^ ( unsigned int ) getpid();
+
+    ( void ) pthread_mutex_init( &pManager->lock, NULL );
+    ( void ) pthread_condattr_init( &conditionAttributes );
+    ( void ) pthread_condattr_setclock( &conditionAttributes, CLOCK_MONOTONIC );
+    ( void ) pthread_cond_init( &pManager->wakeup, &conditionAttributes );
+    ( void ) pthread_condattr_destroy( &conditionAttributes );
+
+    /* Fetch the first credentials before the thread starts, so that a
+     * failure is reported to the caller. */
+    ( void ) pthread_mutex_lock( &pManager->lock );
+    returnStatus = refreshCredentials( pManager );
+    ( void ) pthread_mutex_unlock( &pManager->lock );
+
+    if( returnStatus == true )
+    {
+        if( pthread_create( &pManager->refresher, NULL, refresherThread, pManager ) != 0 )
+        {
+            LogError( ( "Failed to start the credential refresher thread." ) );
+            returnStatus = false;
+        }
+    }
+
+    if( returnStatus == false )
+    {
+        if( pManager->isConnected == true )
+        {
+            ( void ) Openssl_Disconnect( pManager->pNetworkContext );
+            pManager->isConnected = false;
+        }
+
+        ( void ) pthread_cond_destroy( &pManager->wakeup );
+        ( void ) pthread_mutex_destroy( &pManager->lock );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+bool credentialManagerGet( CredentialManager_t * pManager,
+                           TemporaryCredentials_t * pCredentials )
+{
+    bool returnStatus = false;
+    bool isDone = false;
+    uint32_t refreshCount = 0U;
+    time_t now = 0;
+    time_t date = 0;
+    struct tm dateFields;
+
+    assert( pManager != NULL );
+    assert( pCredentials != NULL );
+
+    ( void ) pthread_mutex_lock( &pManager->lock );
+
+    refreshCount = pManager->refreshCount;
+
+    while( isDone == false )
+    {
+        now = monotonicSeconds();
+
+        if( ( pManager->hasCredentials == true ) && ( now < pManager->expiryTime ) )
+        {
+            ( void ) memcpy( pCredentials, &pManager->credentials, sizeof( TemporaryCredentials_t ) );
+
+            /* The credential provider's clock has moved on as much as the
+             * monotonic one since the response. */
+            date = pManager->fetchDate + ( now - pManager->fetchTime );
+            ( void ) gmtime_r( &date, &dateFields );
+            ( void ) strftime( pCredentials->dateISO8601, sizeof( pCredentials->dateISO8601 ),
+                               CREDENTIALS_ISO8601_PRINT_FORMAT, &dateFields );
+
+            returnStatus = true;
+            isDone = true;
+        }
+        else if( ( pManager->isStopping == true ) ||
+                 ( pManager->refreshCount != refreshCount ) ||
+                 ( now < pManager->refreshTime ) )
+        {
+            /* A refresh finished since the call, or failed before it and
+             * left a retry to the refresher thread, without bringing usable
+             * credentials. The caller tries again later rather than waiting
+             * here through the retries. */
+            LogError( ( "No unexpired temporary credentials are available." ) );
+            isDone = true;
+        }
+        else if( pManager->isRefreshing == true )
+        {
+            /* Share the refresh in flight. */
+            ( void ) pthread_cond_wait( &pManager->wakeup, &pManager->lock );
+        }
+        else
+        {
+            ( void ) refreshCredentials( pManager );
+        }
+    }
+
+    ( void ) pthread_mutex_unlock( &pManager->lock );
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+void credentialManagerCleanup( CredentialManager_t * pManager )
+{
+    assert( pManager != NULL );
+
+    ( void ) pthread_mutex_lock( &pManager->lock );
+    pManager->isStopping = true;
+    ( void ) pthread_cond_broadcast( &pManager->wakeup );
+    ( void ) pthread_mutex_unlock( &pManager->lock );
+    ( void ) pthread_join( pManager->refresher, NULL );
+
+    if( pManager->isConnected == true )
+    {
+        ( void ) Openssl_Disconnect( pManager->pNetworkContext );
+        pManager->isConnected = false;
+    }
+
+    ( void ) pthread_cond_destroy( &pManager->wakeup );
+    ( void ) pthread_mutex_destroy( &pManager->lock );
+    ( void ) memset( &pManager->credentials, 0, sizeof( TemporaryCredentials_t ) );
+}
+
+/*-----------------------------------------------------------*/
+
 static JSONStatus_t parseCredentials( HTTPResponse_t * response,
                                       SigV4Credentials_t * sigvCreds )
 {
@@ -454,3 +771,302 @@ static JSONStatus_t parseCredentials( HTTPResponse_t * response,
 }
 
 /*-----------------------------------------------------------*/
+
+static void hexEncode( const uint8_t * pInput,
+                       size_t inputLen,
+                       char * pOutput )
+{
+    static const char digits[] = "0123456789abcdef";
+    size_t i = 0U;
+
+    assert( pInput != NULL );
+    assert( pOutput != NULL );
+
+    for( i = 0U; i < inputLen; i++ )
+    {
+        pOutput[ 2U * i ] = digits[ pInput[ i ] >> 4 ];
+        pOutput[ ( 2U * i ) + 1U ] = digits[ pInput[ i ] & 0x0FU ];
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t connectToCredentialProvider( NetworkContext_t * pNetworkContext )
+{
+    int32_t returnStatus = EXIT_SUCCESS;
+
+    /* Status returned by OpenSSL transport implementation. */
+    OpensslStatus_t opensslStatus;
+    /* Credentials to establish the TLS connection. */
+    OpensslCredentials_t opensslCredentials = { 0 };
+    /* Information about the server to send the HTTP requests. */
+    ServerInfo_t serverInfo = { 0 };
+
+    /* Initialize TLS credentials. */
+    opensslCredentials.pRootCaPath = ROOT_CA_CERT_PATH;
+    opensslCredentials.sniHostName = AWS_IOT_CREDENTIAL_PROVIDER_ENDPOINT;
+    opensslCredentials.pClientCertPath = CLIENT_CERT_PATH;
+    opensslCredentials.pPrivateKeyPath = CLIENT_PRIVATE_KEY_PATH;
+
+    /* Initialize server information. */
+    serverInfo.pHostName = AWS_IOT_CREDENTIAL_PROVIDER_ENDPOINT;
+    serverInfo.hostNameLength = strlen( AWS_IOT_CREDENTIAL_PROVIDER_ENDPOINT );
+    serverInfo.port = HTTPS_PORT;
+
+    /* Establish a TLS session with the HTTP server. This example connects
+     * to the AWS_IOT_CREDENTIAL_PROVIDER_ENDPOINT and HTTPS_PORT in
+     * demo_config.h. */
+    LogInfo( ( "Establishing a TLS session with %s:%d.",
+               AWS_IOT_CREDENTIAL_PROVIDER_ENDPOINT,
+               HTTPS_PORT ) );
+
+    opensslStatus = Openssl_Connect( pNetworkContext,
+                                     &serverInfo,
+                                     &opensslCredentials,
+                                     TRANSPORT_SEND_RECV_TIMEOUT_MS,
+                                     TRANSPORT_SEND_RECV_TIMEOUT_MS );
+
+    returnStatus = ( opensslStatus == OPENSSL_SUCCESS ) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool parseDate( const char * pDate,
+                       size_t dateLen,
+                       const char * pFormat,
+                       time_t * pTime )
+{
+    bool returnStatus = false;
+    char date[ CREDENTIALS_DATE_MAX_LENGTH ];
+    struct tm dateFields;
+
+    ( void ) memset( &dateFields, 0, sizeof( dateFields ) );
+
+    if( dateLen < sizeof( date ) )
+    {
+        ( void ) memcpy( date, pDate, dateLen );
+        date[ dateLen ] = '\0';
+
+        returnStatus = ( sscanf( date, pFormat,
+                                 &dateFields.tm_year, &dateFields.tm_mon, &dateFields.tm_mday,
+                                 &dateFields.tm_hour, &dateFields.tm_min, &dateFields.tm_sec ) == 6 );
+    }
+
+    if( returnStatus == true )
+    {
+        dateFields.tm_year -= 1900;
+        dateFields.tm_mon -= 1;
+        *pTime = timegm( &dateFields );
+    }
+    else
+    {
+        LogError( ( "Failed to read the date %.*s.", ( int ) dateLen, pDate ) );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static time_t monotonicSeconds( void )
+{
+    struct timespec now;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return now.tv_sec;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool fetchCredentials( CredentialManager_t * pManager,
+                              TemporaryCredentials_t * pCredentials,
+                              time_t * pFetchDate,
+                              time_t * pFetchTime )
+{
+    bool returnStatus = false;
+    bool isReused = false;
+    TransportInterface_t transportInterface = { NULL };
+    HTTPResponse_t response;
+    SigV4Credentials_t sigvCreds = { 0 };
+    char dateISO8601[ SIGV4_ISO_STRING_LEN ] = { 0 };
+
+    transportInterface.recv = Openssl_Recv;
+    transportInterface.send = Openssl_Send;
+    transportInterface.pNetworkContext = pManager->pNetworkContext;
+
+    /* The credential provider may have closed the kept connection since the
+     * last refresh; the request is then sent again over a new one. */
+    do
+    {
+        isReused = pManager->isConnected;
+
+        if( pManager->isConnected == false )
+        {
+            pManager->isConnected = ( connectToServerWithBackoffRetries( connectToCredentialProvider,
+                                                                         pManager->pNetworkContext ) == EXIT_SUCCESS );
+
+            if( pManager->isConnected == false )
+            {
+                LogError( ( "Failed to connect to AWS IoT CREDENTIAL PROVIDER server %s.",
+                            AWS_IOT_CREDENTIAL_PROVIDER_ENDPOINT ) );
+            }
+        }
+
+        if( pManager->isConnected == true )
+        {
+            ( void ) memset( &response, 0, sizeof( response ) );
+            response.pBuffer = pManager->buffer;
+            response.bufferLen = sizeof( pManager->buffer );
+
+            returnStatus = getTemporaryCredentials( &transportInterface, dateISO8601, sizeof( dateISO8601 ),
+                                                    &response, &sigvCreds );
+            *pFetchTime = monotonicSeconds();
+
+            if( ( returnStatus == false ) || ( ( response.respFlags & HTTP_RESPONSE_CONNECTION_CLOSE_FLAG ) != 0U ) )
+            {
+                ( void ) Openssl_Disconnect( pManager->pNetworkContext );
+                pManager->isConnected = false;
+            }
+        }
+    } while( ( returnStatus == false ) && ( isReused == true ) );
+
+    /* Copy the credentials out of the response buffer, which the next
+     * refresh overwrites. */
+    if( returnStatus == true )
+    {
+        if( ( sigvCreds.accessKeyIdLen > sizeof( pCredentials->accessKeyId ) ) ||
+            ( sigvCreds.secretAccessKeyLen > sizeof( pCredentials->secretAccessKey ) ) ||
+            ( securityTokenLen > sizeof( pCredentials->securityToken ) ) )
+        {
+            LogError( ( "The temporary credentials do not fit in the credential manager." ) );
+            returnStatus = false;
+        }
+    }
+
+    if( returnStatus == true )
+    {
+        returnStatus = parseDate( pExpiration, expirationLen, CREDENTIALS_EXPIRATION_FORMAT,
+                                  &pCredentials->expiration );
+    }
+
+    if( returnStatus == true )
+    {
+        returnStatus = parseDate( dateISO8601, sizeof( dateISO8601 ), CREDENTIALS_ISO8601_SCAN_FORMAT,
+                                  pFetchDate );
+    }
+
+    if( returnStatus == true )
+    {
+        ( void ) memcpy( pCredentials->accessKeyId, sigvCreds.pAccessKeyId, sigvCreds.accessKeyIdLen );
+        pCredentials->accessKeyIdLen = sigvCreds.accessKeyIdLen;
+        ( void ) memcpy( pCredentials->secretAccessKey, sigvCreds.pSecretAccessKey, sigvCreds.secretAccessKeyLen );
+        pCredentials->secretAccessKeyLen = sigvCreds.secretAccessKeyLen;
+        ( void ) memcpy( pCredentials->securityToken, pSecurityToken, securityTokenLen );
+        pCredentials->securityTokenLen = securityTokenLen;
+        pCredentials->dateISO8601[ 0 ] = '\0';
+    }
+
+    ( void ) memset( pManager->buffer, 0, sizeof( pManager->buffer ) );
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool refreshCredentials( CredentialManager_t * pManager )
+{
+    bool returnStatus = false;
+    TemporaryCredentials_t credentials;
+    time_t fetchDate = 0, fetchTime = 0;
+    time_t lifetime = 0, margin = 0, jitter = 0, guard = 0;
+
+    pManager->isRefreshing = true;
+    ( void ) pthread_mutex_unlock( &pManager->lock );
+
+    returnStatus = fetchCredentials( pManager, &credentials, &fetchDate, &fetchTime );
+
+    ( void ) pthread_mutex_lock( &pManager->lock );
+
+    if( returnStatus == true )
+    {
+        lifetime = credentials.expiration - fetchDate;
+
+        if( lifetime <= 0 )
+        {
+            LogError( ( "The temporary credentials expired before they were received." ) );
+            returnStatus = false;
+        }
+    }
+
+    if( returnStatus == true )
+    {
+        /* Short lived credentials are refreshed halfway through their
+         * lifetime at the latest. */
+        margin = ( lifetime / 2 < CREDENTIAL_MANAGER_REFRESH_MARGIN_S ) ? lifetime / 2 : CREDENTIAL_MANAGER_REFRESH_MARGIN_S;
+        jitter = ( lifetime / 4 < CREDENTIAL_MANAGER_REFRESH_JITTER_S ) ? lifetime / 4 : CREDENTIAL_MANAGER_REFRESH_JITTER_S;
+        guard = ( lifetime / 4 < CREDENTIAL_MANAGER_EXPIRY_GUARD_S ) ? lifetime / 4 : CREDENTIAL_MANAGER_EXPIRY_GUARD_S;
+        jitter = ( time_t ) ( ( unsigned long ) rand_r( &pManager->seed ) % ( ( unsigned long ) jitter + 1UL ) );
+
+        credentials.generation = pManager->credentials.generation + 1U;
+        ( void ) memcpy( &pManager->credentials, &credentials, sizeof( TemporaryCredentials_t ) );
+        pManager->hasCredentials = true;
+        pManager->fetchDate = fetchDate;
+        pManager->fetchTime = fetchTime;
+        pManager->refreshTime = fetchTime + lifetime - margin - jitter;
+        pManager->expiryTime = fetchTime + lifetime - guard;
+
+        LogInfo( ( "Fetched temporary credentials valid for %ld seconds; refreshing them in %ld seconds.",
+                   ( long ) lifetime, ( long ) ( pManager->refreshTime - fetchTime ) ) );
+    }
+    else
+    {
+        pManager->refreshTime = monotonicSeconds() + CREDENTIAL_MANAGER_RETRY_DELAY_S;
+    }
+
+    ( void ) memset( &credentials, 0, sizeof( credentials ) );
+
+    pManager->isRefreshing = false;
+    pManager->refreshCount++;
+    ( void ) pthread_cond_broadcast( &pManager->wakeup );
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void * refresherThread( void * pArgument )
+{
+    CredentialManager_t * pManager = ( CredentialManager_t * ) pArgument;
+    struct timespec deadline;
+
+    ( void ) pthread_mutex_lock( &pManager->lock );
+
+    while( pManager->isStopping == false )
+    {
+        if( pManager->isRefreshing == true )
+        {
+            /* A caller of credentialManagerGet() is in a refresh, which
+             * schedules the next one. */
+            ( void ) pthread_cond_wait( &pManager->wakeup, &pManager->lock );
+        }
+        else if( monotonicSeconds() < pManager->refreshTime )
+        {
+            deadline.tv_sec = pManager->refreshTime;
+            deadline.tv_nsec = 0;
+            ( void ) pthread_cond_timedwait( &pManager->wakeup, &pManager->lock, &deadline );
+        }
+        else
+        {
+            ( void ) refreshCredentials( pManager );
+        }
+    }
+
+    ( void ) pthread_mutex_unlock( &pManager->lock );
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
@@ -379,7 +379,7 @@ int main( int argc,
     TransportInterface_t transportInterface = { NULL };
     /* The network context for the transport layer interface. */
     NetworkContext_t networkContext;
-    PlaintextParams_t plaintextParams;
+    PlaintextParams_t plaintextParams = { 0 };
     /* An array of HTTP paths to request. */
     const httpPathStrings_t httpMethodPaths[] =
     {
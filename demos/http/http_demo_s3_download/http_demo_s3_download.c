@@ -27,6 +27,7 @@
 #include <string.h>
 
 /* POSIX includes. */
+#include <signal.h>
 #include <unistd.h>
 
 /* Include Demo Config as the first non-system header. */
@@ -44,9 +45,6 @@
 /* SIGV4 API header. */
 #include "sigv4.h"
 
-/* MBEDTLS API header. */
-#include "mbedtls/sha256.h"
-
 /* OpenSSL transport header. */
 #include "openssl_posix.h"
 
@@ -144,16 +142,6 @@
  */
 #define DELAY_BETWEEN_DEMO_RETRY_ITERATIONS_S    ( 5 )
 
-/**
- * @brief Buffer Length for storing the AWS IoT Credentials retrieved from
- * AWS IoT credential provider which includes the following:
- * 1. Access Key ID
- * 2. Secret Access key
- * 3. Session Token
- * 4. Expiration Date
- */
-#define CREDENTIAL_BUFFER_LENGTH                 1500U
-
 /**
  * @brief AWS Service name to send HTTP request using SigV4 library.
  */
@@ -177,26 +165,19 @@
  */
 #define SIGV4_AUTH_HEADER_FIELD_NAME      "Authorization"
 
-/**
- * @brief Length of AWS HTTP Authorization header value generated using SigV4 library.
- */
-#define AWS_HTTP_AUTH_HEADER_VALUE_LEN    2048U
 
 /**
- * @brief Represents empty payload for HTTP GET request sent to AWS S3.
+ * @brief A buffer used in the demo for storing HTTP response headers and body.
  */
-#define S3_REQUEST_EMPTY_PAYLOAD          ""
-
+static uint8_t userBuffer[ USER_BUFFER_LENGTH ];
 
 /**
- * @brief A buffer used in the demo for storing HTTP request headers and HTTP
- * response headers and body.
+ * @brief A buffer used in the demo for storing HTTP request headers.
  *
- * @note This demo shows how the same buffer can be re-used for storing the HTTP
- * response after the HTTP request is sent out. However, the user can decide how
- * to use buffers to store HTTP requests and responses.
+ * @note The range requests keep the headers they have in common in this
+ * buffer, so it is not shared with the response.
  */
-static uint8_t userBuffer[ USER_BUFFER_LENGTH ];
+static uint8_t requestBuffer[ USER_BUFFER_LENGTH ];
 
 /**
  * @brief Represents header data that will be sent in an HTTP request.
@@ -219,26 +200,21 @@ static HTTPResponse_t response;
  */
 static const char * pPath;
 
-/**
- *  @brief mbedTLS Hash Context passed to SigV4 cryptointerface for generating the hash digest.
- */
-static mbedtls_sha256_context hashContext = { 0 };
-
 /**
  *  @brief Configurations of the AWS credentials sent to sigV4 library for generating the Authorization Header.
  */
 static SigV4Credentials_t sigvCreds = { 0 };
 
 /**
- * @brief Represents a response returned from an AWS IOT credential provider.
+ * @brief Keeps the temporary credentials from the AWS IoT credential provider
+ * and refreshes them before they expire.
  */
-static HTTPResponse_t credentialResponse = { 0 };
+static CredentialManager_t credentialManager;
 
 /**
- * @brief Buffer used in the demo for storing temporary credentials
- * received from AWS TOT credential provider.
+ * @brief The temporary credentials that #sigvCreds points into.
  */
-static uint8_t pAwsIotHttpBuffer[ CREDENTIAL_BUFFER_LENGTH ] = { 0 };
+static TemporaryCredentials_t temporaryCredentials;
 
 /**
  * @brief Represents date in ISO8601 format used in the HTTP requests sent to AWS S3.
@@ -246,24 +222,10 @@ static uint8_t pAwsIotHttpBuffer[ CREDENTIAL_BUFFER_LENGTH ] = { 0 };
 static char pDateISO8601[ SIGV4_ISO_STRING_LEN ] = { 0 };
 
 /**
- * @brief Represents hash digest of payload.
+ * @brief Signing context of the requests for the S3 object, which keeps the
+ * hash of their empty payload and their SigV4 parameters.
  */
-static char pPayloadHashDigest[ SHA256_HASH_DIGEST_LENGTH ];
-
-/**
- * @brief Represents hex encoded hash digest of payload.
- */
-static char hexencoded[ HEX_ENCODED_SHA256_HASH_DIGEST_LENGTH ];
-
-/**
- * @brief Represents Authorization header value generated using SigV4 library.
- */
-static char pSigv4Auth[ AWS_HTTP_AUTH_HEADER_VALUE_LEN ];
-
-/**
- * @brief Represents Length of Authorization header value generated using SigV4 library.
- */
-static size_t sigv4AuthLen = AWS_HTTP_AUTH_HEADER_VALUE_LEN;
+static S3SigningContext_t signingContext;
 
 /*-----------------------------------------------------------*/
 
@@ -303,6 +265,9 @@ static bool downloadS3ObjectFile( const TransportInterface_t * pTransportInterfa
 /**
  * @brief Retrieve the size of the S3 object that is specified in pPath.
  *
+ * @note The request is signed with #signingContext, which must have been
+ * initialized for the object.
+ *
  * @param[out] pFileSize The size of the S3 object.
  * @param[in] pTransportInterface The transport interface for making network
  * calls.
@@ -321,33 +286,8 @@ static bool getS3ObjectFileSize( size_t * pFileSize,
                                  const char * pPath );
 
 /**
- * @brief Hex digest of provided string parameter.
- *
- * @param[in] pInputStr Input String to encode.
- * @param[in] inputStrLen Length of Input String to encode.
- * @param[out] pHexOutput Hex representation of @p pInputStr.
- */
-static void lowercaseHexEncode( const char * pInputStr,
-                                size_t inputStrLen,
-                                char * pHexOutput );
-
-
-/**
- * @brief CryptoInterface provided to SigV4 library for generating the hash digest.
- */
-static SigV4CryptoInterface_t cryptoInterface =
-{
-    .hashInit      = sha256Init,
-    .hashUpdate    = sha256Update,
-    .hashFinal     = sha256Final,
-    .pHashContext  = &hashContext,
-    .hashBlockLen  = HEX_ENCODED_SHA256_HASH_DIGEST_LENGTH,
-    .hashDigestLen = SHA256_HASH_DIGEST_LENGTH,
-};
-
-/**
- * @brief SigV4 parameters provided to SigV4 library by the application for generating
- * the Authorization header.
+ * @brief Credentials, date, region and service that the signing context
+ * signs the requests with.
  */
 static SigV4Parameters_t sigv4Params =
 {
@@ -357,35 +297,12 @@ static SigV4Parameters_t sigv4Params =
     .regionLen        = sizeof( AWS_S3_BUCKET_REGION ) - 1,
     .pService         = AWS_S3_SERVICE_NAME,
     .serviceLen       = sizeof( AWS_S3_SERVICE_NAME ) - 1,
-    .pCryptoInterface = &cryptoInterface,
+    .pCryptoInterface = NULL,
     .pHttpParameters  = NULL
 };
 
 /*-----------------------------------------------------------*/
 
-static void lowercaseHexEncode( const char * pInputStr,
-                                size_t inputStrLen,
-                                char * pHexOutput )
-{
-    static const char digitArr[] = "0123456789abcdef";
-    char * hex = pHexOutput;
-    size_t i = 0U;
-
-    assert( pInputStr != NULL );
-    assert( inputStrLen > 0 );
-    assert( pHexOutput != NULL );
-
-    for( i = 0; i < inputStrLen; i++ )
-    {
-        *hex = digitArr[ ( pInputStr[ i ] & 0xF0 ) >> 4 ];
-        hex++;
-        *hex = digitArr[ ( pInputStr[ i ] & 0x0F ) ];
-        hex++;
-    }
-}
-
-/*-----------------------------------------------------------*/
-
 static int32_t connectToS3Server( NetworkContext_t * pNetworkContext )
 {
     int32_t returnStatus = EXIT_SUCCESS;
@@ -452,15 +369,12 @@ static bool downloadS3ObjectFile( const TransportInterface_t * pTransportInterfa
     /* curByte indicates which starting byte we want to download next. */
     size_t curByte = 0;
 
-    SigV4Status_t sigv4Status = SigV4Success;
-    SigV4HttpParameters_t sigv4HttpParams;
-
-    char * pHeaders = NULL;
-    size_t headersLen = 0;
+    /* Length of the request headers that are the same for every range. */
+    size_t commonHeadersLen = 0;
 
-    /* Store Signature used in AWS HTTP requests generated using SigV4 library. */
-    char * signature = NULL;
-    size_t signatureLen = 0;
+    /* Authorization header value generated by the signing context. */
+    const char * pAuthorization = NULL;
+    size_t authorizationLen = 0;
 
     assert( pPath != NULL );
 
@@ -483,20 +397,29 @@ static bool downloadS3ObjectFile( const TransportInterface_t * pTransportInterfa
     requestInfo.reqFlags = HTTP_REQUEST_KEEP_ALIVE_FLAG;
 
     /* Set the buffer used for storing request headers. */
-    requestHeaders.pBuffer = userBuffer;
+    requestHeaders.pBuffer = requestBuffer;
     requestHeaders.bufferLen = USER_BUFFER_LENGTH;
 
-    /* Initialize the response object. The same buffer used for storing request
-     * headers is reused here. */
+    /* Initialize the response object. */
     response.pBuffer = userBuffer;
     response.bufferLen = USER_BUFFER_LENGTH;
 
-    /* Verify the file exists by retrieving the file size. */
-    returnStatus = getS3ObjectFileSize( &fileSize,
-                                        pTransportInterface,
-                                        serverHost,
-                                        serverHostLength,
-                                        pPath );
+    /* Hash the empty payload and set up the SigV4 parameters once for all
+     * the requests of the file. */
+    returnStatus = s3SigningContextInit( &signingContext,
+                                         &sigv4Params,
+                                         pPath,
+                                         requestInfo.pathLen );
+
+    if( returnStatus == true )
+    {
+        /* Verify the file exists by retrieving the file size. */
+        returnStatus = getS3ObjectFileSize( &fileSize,
+                                            pTransportInterface,
+                                            serverHost,
+                                            serverHostLength,
+                                            pPath );
+    }
 
     if( fileSize < RANGE_REQUEST_LENGTH )
     {
@@ -507,112 +430,100 @@ static bool downloadS3ObjectFile( const TransportInterface_t * pTransportInterfa
         numReqBytes = RANGE_REQUEST_LENGTH;
     }
 
-    /* Here we iterate sending byte range requests until the full file has been
-     * downloaded. We keep track of the next byte to download with curByte. When
-     * this reaches the fileSize we stop downloading. */
-    while( ( returnStatus == true ) && ( httpStatus == HTTPSuccess ) && ( curByte < fileSize ) )
+    /* Write the headers that every range request carries once. Each request
+     * then only adds its Range and Authorization headers after them. */
+    if( returnStatus == true )
     {
         httpStatus = HTTPClient_InitializeRequestHeaders( &requestHeaders,
                                                           &requestInfo );
 
-        if( returnStatus == true )
+        if( httpStatus != HTTPSuccess )
         {
-            /* Add the X-AMZ-DATE required headers to the request. */
-            httpStatus = HTTPClient_AddHeader( &requestHeaders,
-                                               ( const char * ) SIGV4_HTTP_X_AMZ_DATE_HEADER,
-                                               ( size_t ) sizeof( SIGV4_HTTP_X_AMZ_DATE_HEADER ) - 1,
-                                               ( const char * ) pDateISO8601,
-                                               SIGV4_ISO_STRING_LEN );
-
-            if( httpStatus != HTTPSuccess )
-            {
-                LogError( ( "Failed to add X-AMZ-DATE to request headers: Error=%s.",
-                            HTTPClient_strerror( httpStatus ) ) );
-                returnStatus = false;
-            }
+            LogError( ( "Failed to initialize HTTP request headers: Error=%s.",
+                        HTTPClient_strerror( httpStatus ) ) );
+            returnStatus = false;
         }
+    }
 
-        if( returnStatus == true )
-        {
-            /* S3 requires the security token as part of the canonical headers. */
-            httpStatus = HTTPClient_AddHeader( &requestHeaders,
-                                               ( const char * ) SIGV4_HTTP_X_AMZ_SECURITY_TOKEN_HEADER,
-                                               ( size_t ) ( sizeof( SIGV4_HTTP_X_AMZ_SECURITY_TOKEN_HEADER ) - 1 ),
-                                               ( const char * ) pSecurityToken,
-                                               ( size_t ) securityTokenLen );
+    if( returnStatus == true )
+    {
+        /* Add the X-AMZ-DATE required headers to the request. */
+        httpStatus = HTTPClient_AddHeader( &requestHeaders,
+                                           ( const char * ) SIGV4_HTTP_X_AMZ_DATE_HEADER,
+                                           ( size_t ) sizeof( SIGV4_HTTP_X_AMZ_DATE_HEADER ) - 1,
+                                           ( const char * ) pDateISO8601,
+                                           SIGV4_ISO_STRING_LEN );
 
-            if( httpStatus != HTTPSuccess )
-            {
-                LogError( ( "Failed to add X-AMZ-SECURITY-TOKEN to request headers: Error=%s.",
-                            HTTPClient_strerror( httpStatus ) ) );
-                returnStatus = false;
-            }
+        if( httpStatus != HTTPSuccess )
+        {
+            LogError( ( "Failed to add X-AMZ-DATE to request headers: Error=%s.",
+                        HTTPClient_strerror( httpStatus ) ) );
+            returnStatus = false;
         }
+    }
+
+    if( returnStatus == true )
+    {
+        /* S3 requires the security token as part of the canonical headers. */
+        httpStatus = HTTPClient_AddHeader( &requestHeaders,
+                                           ( const char * ) SIGV4_HTTP_X_AMZ_SECURITY_TOKEN_HEADER,
+                                           ( size_t ) ( sizeof( SIGV4_HTTP_X_AMZ_SECURITY_TOKEN_HEADER ) - 1 ),
+                                           ( const char * ) temporaryCredentials.securityToken,
+                                           temporaryCredentials.securityTokenLen );
 
-        if( httpStatus == HTTPSuccess )
+        if( httpStatus != HTTPSuccess )
         {
-            httpStatus = HTTPClient_AddRangeHeader( &requestHeaders,
-                                                    curByte,
-                                                    curByte + numReqBytes - 1 );
+            LogError( ( "Failed to add X-AMZ-SECURITY-TOKEN to request headers: Error=%s.",
+                        HTTPClient_strerror( httpStatus ) ) );
+            returnStatus = false;
         }
-        else
+    }
+
+    if( returnStatus == true )
+    {
+        httpStatus = HTTPClient_AddHeader( &requestHeaders,
+                                           ( const char * ) SIGV4_HTTP_X_AMZ_CONTENT_SHA256_HEADER,
+                                           ( size_t ) ( sizeof( SIGV4_HTTP_X_AMZ_CONTENT_SHA256_HEADER ) - 1 ),
+                                           ( const char * ) signingContext.payloadHash,
+                                           HEX_ENCODED_SHA256_HASH_DIGEST_LENGTH );
+
+        if( httpStatus != HTTPSuccess )
         {
-            LogError( ( "Failed to add range header to request headers: Error=%s.",
+            LogError( ( "Failed to add X-AMZ-CONTENT-SHA256-HEADER to request headers: Error=%s.",
                         HTTPClient_strerror( httpStatus ) ) );
+            returnStatus = false;
         }
+    }
 
-        /* Get the hash of the payload. */
-        sha256( ( const char * ) S3_REQUEST_EMPTY_PAYLOAD, 0, pPayloadHashDigest );
-        lowercaseHexEncode( ( const char * ) pPayloadHashDigest, SHA256_HASH_DIGEST_LENGTH, hexencoded );
+    commonHeadersLen = requestHeaders.headersLen;
 
-        if( returnStatus == true )
-        {
-            httpStatus = HTTPClient_AddHeader( &requestHeaders,
-                                               ( const char * ) SIGV4_HTTP_X_AMZ_CONTENT_SHA256_HEADER,
-                                               ( size_t ) ( sizeof( SIGV4_HTTP_X_AMZ_CONTENT_SHA256_HEADER ) - 1 ),
-                                               ( const char * ) hexencoded,
-                                               64 );
+    /* Here we iterate sending byte range requests until the full file has been
+     * downloaded. We keep track of the next byte to download with curByte. When
+     * this reaches the fileSize we stop downloading. */
+    while( ( returnStatus == true ) && ( httpStatus == HTTPSuccess ) && ( curByte < fileSize ) )
+    {
+        /* Drop the Range and Authorization headers of the previous request. */
+        requestHeaders.headersLen = commonHeadersLen;
 
-            if( httpStatus != HTTPSuccess )
-            {
-                LogError( ( "Failed to add X-AMZ-CONTENT-SHA256-HEADER to request headers: Error=%s.",
-                            HTTPClient_strerror( httpStatus ) ) );
-                returnStatus = false;
-            }
-        }
+        httpStatus = HTTPClient_AddRangeHeader( &requestHeaders,
+                                                curByte,
+                                                curByte + numReqBytes - 1 );
 
-        /* Move request header pointer past the initial headers which are added by coreHTTP
-         * library and are not required by SigV4 library. */
-        getHeaderStartLocFromHttpRequest( requestHeaders, &pHeaders, &headersLen );
-
-        /* Setup the HTTP parameters. */
-        sigv4HttpParams.pHttpMethod = requestInfo.pMethod;
-        sigv4HttpParams.httpMethodLen = requestInfo.methodLen;
-        /* None of the requests parameters below are pre-canonicalized */
-        sigv4HttpParams.flags = 0;
-        sigv4HttpParams.pPath = requestInfo.pPath;
-        sigv4HttpParams.pathLen = requestInfo.pathLen;
-        /* AWS S3 request does not require any Query parameters. */
-        sigv4HttpParams.pQuery = NULL;
-        sigv4HttpParams.queryLen = 0;
-        sigv4HttpParams.pHeaders = pHeaders;
-        sigv4HttpParams.headersLen = headersLen;
-        sigv4HttpParams.pPayload = S3_REQUEST_EMPTY_PAYLOAD;
-        sigv4HttpParams.payloadLen = sizeof( S3_REQUEST_EMPTY_PAYLOAD ) - 1U;
-
-        /* Initializing sigv4Params with Http parameters required for the HTTP request. */
-        sigv4Params.pHttpParameters = &sigv4HttpParams;
+        if( httpStatus != HTTPSuccess )
+        {
+            LogError( ( "Failed to add range header to request headers: Error=%s.",
+                        HTTPClient_strerror( httpStatus ) ) );
+            returnStatus = false;
+        }
 
         if( returnStatus == true )
         {
-            /* Generate HTTP Authorization header using SigV4_GenerateHTTPAuthorization API. */
-            sigv4Status = SigV4_GenerateHTTPAuthorization( &sigv4Params, pSigv4Auth, &sigv4AuthLen, &signature, &signatureLen );
-
-            if( sigv4Status != SigV4Success )
-            {
-                LogError( ( "SigV4 Library Failed to generate AUTHORIZATION Header." ) );
-                returnStatus = false;
-            }
+            /* Sign the common headers and the Range header of this
+             * request. */
+            returnStatus = s3SignRangeRequest( &signingContext,
+                                               &requestHeaders,
+                                               &pAuthorization,
+                                               &authorizationLen );
         }
 
         /* Add the authorization header to the HTTP request headers. */
@@ -621,8 +532,8 @@ static bool downloadS3ObjectFile( const TransportInterface_t * pTransportInterfa
             httpStatus = HTTPClient_AddHeader( &requestHeaders,
                                                ( const char * ) SIGV4_AUTH_HEADER_FIELD_NAME,
                                                ( size_t ) sizeof( SIGV4_AUTH_HEADER_FIELD_NAME ) - 1,
-                                               ( const char * ) pSigv4Auth,
-                                               ( size_t ) sigv4AuthLen );
+                                               pAuthorization,
+                                               authorizationLen );
 
             if( httpStatus != HTTPSuccess )
             {
@@ -632,7 +543,7 @@ static bool downloadS3ObjectFile( const TransportInterface_t * pTransportInterfa
             }
         }
 
-        if( httpStatus == HTTPSuccess )
+        if( returnStatus == true )
         {
             LogInfo( ( "Downloading bytes %d-%d, out of %d total bytes, from %s...:  ",
                        ( int32_t ) ( curByte ),
@@ -643,54 +554,51 @@ static bool downloadS3ObjectFile( const TransportInterface_t * pTransportInterfa
                         ( int32_t ) requestHeaders.headersLen,
                         ( char * ) requestHeaders.pBuffer ) );
 
-            /* Send HTTP Get request to AWS S3 and receive response. */
+            /* Send HTTP Get request to AWS S3 and receive response. A GET
+             * request has no body, so no Content-Length header is needed; the
+             * flag also keeps the common headers in the buffer unchanged. */
             httpStatus = HTTPClient_Send( pTransportInterface,
                                           &requestHeaders,
                                           NULL,
                                           0,
                                           &response,
-                                          0 );
-        }
-        else
-        {
-            LogError( ( "Failed to add Range header to request headers: Error=%s.",
-                        HTTPClient_strerror( httpStatus ) ) );
-        }
+                                          HTTP_SEND_DISABLE_CONTENT_LENGTH_FLAG );
 
-        if( httpStatus == HTTPSuccess )
-        {
-            LogDebug( ( "Received HTTP response from %s%s...",
-                        serverHost, pPath ) );
-            LogDebug( ( "Response Headers:\n%.*s",
-                        ( int32_t ) response.headersLen,
-                        response.pHeaders ) );
-            LogInfo( ( "Response Body:\n%.*s\n",
-                       ( int32_t ) response.bodyLen,
-                       response.pBody ) );
-
-            /* We increment by the content length because the server may not
-             * have sent us the range we request. */
-            curByte += response.contentLength;
-
-            if( ( fileSize - curByte ) < numReqBytes )
+            if( httpStatus == HTTPSuccess )
             {
-                numReqBytes = fileSize - curByte;
+                LogDebug( ( "Received HTTP response from %s%s...",
+                            serverHost, pPath ) );
+                LogDebug( ( "Response Headers:\n%.*s",
+                            ( int32_t ) response.headersLen,
+                            response.pHeaders ) );
+                LogInfo( ( "Response Body:\n%.*s\n",
+                           ( int32_t ) response.bodyLen,
+                           response.pBody ) );
+
+                /* We increment by the content length because the server may not
+                 * have sent us the range we request. */
+                curByte += response.contentLength;
+
+                if( ( fileSize - curByte ) < numReqBytes )
+                {
+                    numReqBytes = fileSize - curByte;
+                }
+
+                returnStatus = ( response.statusCode == HTTP_STATUS_CODE_PARTIAL_CONTENT ) ? true : false;
+
+                if( returnStatus != true )
+                {
+                    LogError( ( "Received an invalid response from the server "
+                                "(Status Code: %u).",
+                                response.statusCode ) );
+                }
+            }
+            else
+            {
+                LogError( ( "An error occured in downloading the file. "
+                            "Failed to send HTTP GET request to %s%s: Error=%s.",
+                            serverHost, pPath, HTTPClient_strerror( httpStatus ) ) );
             }
-
-            returnStatus = ( response.statusCode == HTTP_STATUS_CODE_PARTIAL_CONTENT ) ? true : false;
-        }
-        else
-        {
-            LogError( ( "An error occured in downloading the file. "
-                        "Failed to send HTTP GET request to %s%s: Error=%s.",
-                        serverHost, pPath, HTTPClient_strerror( httpStatus ) ) );
-        }
-
-        if( returnStatus != true )
-        {
-            LogError( ( "Received an invalid response from the server "
-                        "(Status Code: %u).",
-                        response.statusCode ) );
         }
     }
 
@@ -719,15 +627,9 @@ static bool getS3ObjectFileSize( size_t * pFileSize,
     char * contentRangeValStr = NULL;
     size_t contentRangeValStrLength = 0;
 
-    SigV4Status_t sigv4Status = SigV4Success;
-    SigV4HttpParameters_t sigv4HttpParams;
-
-    char * pHeaders = NULL;
-    size_t headersLen = 0;
-
-    /* Store Signature used in AWS HTTP requests generated using SigV4 library. */
-    char * signature = NULL;
-    size_t signatureLen = 0;
+    /* Authorization header value generated by the signing context. */
+    const char * pAuthorization = NULL;
+    size_t authorizationLen = 0;
 
     assert( pHost != NULL );
     assert( pPath != NULL );
@@ -771,10 +673,6 @@ static bool getS3ObjectFileSize( size_t * pFileSize,
         returnStatus = false;
     }
 
-    /* Get the hash of the payload. */
-    sha256( ( const char * ) S3_REQUEST_EMPTY_PAYLOAD, 0, pPayloadHashDigest );
-    lowercaseHexEncode( ( const char * ) pPayloadHashDigest, SHA256_HASH_DIGEST_LENGTH, hexencoded );
-
     if( returnStatus == true )
     {
         /* Add the sigv4 required headers to the request. */
@@ -799,8 +697,8 @@ static bool getS3ObjectFileSize( size_t * pFileSize,
         httpStatus = HTTPClient_AddHeader( &requestHeaders,
                                            ( const char * ) SIGV4_HTTP_X_AMZ_SECURITY_TOKEN_HEADER,
                                            ( size_t ) ( sizeof( SIGV4_HTTP_X_AMZ_SECURITY_TOKEN_HEADER ) - 1 ),
-                                           ( const char * ) pSecurityToken,
-                                           ( size_t ) securityTokenLen );
+                                           ( const char * ) temporaryCredentials.securityToken,
+                                           temporaryCredentials.securityTokenLen );
 
         if( httpStatus != HTTPSuccess )
         {
@@ -831,8 +729,8 @@ static bool getS3ObjectFileSize( size_t * pFileSize,
         httpStatus = HTTPClient_AddHeader( &requestHeaders,
                                            ( const char * ) SIGV4_HTTP_X_AMZ_CONTENT_SHA256_HEADER,
                                            ( size_t ) ( sizeof( SIGV4_HTTP_X_AMZ_CONTENT_SHA256_HEADER ) - 1 ),
-                                           ( const char * ) hexencoded,
-                                           64 );
+                                           ( const char * ) signingContext.payloadHash,
+                                           HEX_ENCODED_SHA256_HASH_DIGEST_LENGTH );
 
         if( httpStatus != HTTPSuccess )
         {
@@ -842,38 +740,10 @@ static bool getS3ObjectFileSize( size_t * pFileSize,
         }
     }
 
-    /* Move request header pointer past the initial headers which are added by coreHTTP
-     * library and are not required by SigV4 library. */
-    getHeaderStartLocFromHttpRequest( requestHeaders, &pHeaders, &headersLen );
-
-    /* Setup the HTTP parameters. */
-    sigv4HttpParams.pHttpMethod = requestInfo.pMethod;
-    sigv4HttpParams.httpMethodLen = requestInfo.methodLen;
-    /* None of the requests parameters below are pre-canonicalized */
-    sigv4HttpParams.flags = 0;
-    sigv4HttpParams.pPath = requestInfo.pPath;
-    sigv4HttpParams.pathLen = requestInfo.pathLen;
-    /* AWS S3 request does not require any Query parameters. */
-    sigv4HttpParams.pQuery = NULL;
-    sigv4HttpParams.queryLen = 0;
-    sigv4HttpParams.pHeaders = pHeaders;
-    sigv4HttpParams.headersLen = headersLen;
-    sigv4HttpParams.pPayload = S3_REQUEST_EMPTY_PAYLOAD;
-    sigv4HttpParams.payloadLen = strlen( S3_REQUEST_EMPTY_PAYLOAD );
-
-    /* Initializing sigv4Params with Http parameters required for the HTTP request. */
-    sigv4Params.pHttpParameters = &sigv4HttpParams;
-
     if( returnStatus == true )
     {
-        /* Generate HTTP Authorization header using SigV4_GenerateHTTPAuthorization API. */
-        sigv4Status = SigV4_GenerateHTTPAuthorization( &sigv4Params, pSigv4Auth, &sigv4AuthLen, &signature, &signatureLen );
-
-        if( sigv4Status != SigV4Success )
-        {
-            LogError( ( "Failed to generate HTTP AUTHORIZATION Header. " ) );
-            returnStatus = false;
-        }
+        /* Sign the request for bytes 0-0 with the signing context. */
+        returnStatus = s3SignRangeRequest( &signingContext, &requestHeaders, &pAuthorization, &authorizationLen );
     }
 
     /* Add the authorization header to the HTTP request headers. */
@@ -882,8 +752,8 @@ static bool getS3ObjectFileSize( size_t * pFileSize,
         httpStatus = HTTPClient_AddHeader( &requestHeaders,
                                            ( const char * ) SIGV4_AUTH_HEADER_FIELD_NAME,
                                            ( size_t ) sizeof( SIGV4_AUTH_HEADER_FIELD_NAME ) - 1,
-                                           ( const char * ) pSigv4Auth,
-                                           ( size_t ) sigv4AuthLen );
+                                           pAuthorization,
+                                           authorizationLen );
 
         if( httpStatus != HTTPSuccess )
         {
@@ -1017,72 +887,69 @@ int main( int argc,
     /* Return value of main. */
     int32_t returnStatus = EXIT_SUCCESS;
     /* Return value of private functions. */
-    bool ret = false, credentialStatus = false;
+    bool ret = false, credentialStatus = false, isManagerStarted = false;
     int demoRunCount = 0;
 
     /* The transport layer interface used by the HTTP Client library. */
     TransportInterface_t transportInterface = { NULL };
     /* The network context for the transport layer interface. */
     NetworkContext_t networkContext;
-    OpensslParams_t opensslParams;
+    OpensslParams_t opensslParams = { 0 };
+    /* The network context of the credential manager, whose connection to the
+     * AWS IoT credential provider stays open beside the one to S3. */
+    NetworkContext_t credentialNetworkContext;
+    OpensslParams_t credentialOpensslParams = { 0 };
+    struct sigaction sigpipeAction;
 
     ( void ) argc;
     ( void ) argv;
 
+    /* The credential provider closing the kept connection between refreshes
+     * must fail the next refresh, not end the program. */
+    ( void ) memset( &sigpipeAction, 0, sizeof( sigpipeAction ) );
+    sigpipeAction.sa_handler = SIG_IGN;
+    ( void ) sigemptyset( &sigpipeAction.sa_mask );
+    ( void ) sigaction( SIGPIPE, &sigpipeAction, NULL );
+
     /* Set the pParams member of the network context with desired transport. */
     networkContext.pParams = &opensslParams;
+    credentialNetworkContext.pParams = &credentialOpensslParams;
 
     LogInfo( ( "HTTP Client Synchronous S3 download demo using temporary credentials fetched from iot credential provider:\n%s",
                AWS_IOT_CREDENTIAL_PROVIDER_ENDPOINT ) );
 
     do
     {
-        /**************************** Connect. ******************************/
-
-        /* Establish TLS connection on top of TCP connection using OpenSSL. */
-
-        /* Attempt to connect to the AWS IOT CREDENTIAL PROVIDER server. If connection fails, retry
-         * after a timeout. The timeout value will be exponentially
-         * increased until either the maximum number of attempts or the
-         * maximum timeout value is reached. The function returns
-         * EXIT_FAILURE if the TCP connection cannot be established to the
-         * broker after the configured number of attempts. */
-        returnStatus = connectToServerWithBackoffRetries( connectToIotServer,
-                                                          &networkContext );
-
-        if( returnStatus == EXIT_FAILURE )
-        {
-            /* Log an error to indicate connection failure after all
-             * reconnect attempts are over. */
-            LogError( ( "Failed to connect to AWS IoT CREDENTIAL PROVIDER server %s.",
-                        serverHost ) );
-        }
+        /************************ Get credentials. **************************/
 
-        /* Define the transport interface. */
-        if( returnStatus == EXIT_SUCCESS )
+        /* Fetch temporary credentials from the AWS IoT CREDENTIAL PROVIDER
+         * server once; the credential manager then refreshes them in the
+         * background before they expire, and later iterations take them from
+         * it without a connection of their own. */
+        if( isManagerStarted == false )
         {
-            ( void ) memset( &transportInterface, 0, sizeof( transportInterface ) );
-            transportInterface.recv = Openssl_Recv;
-            transportInterface.send = Openssl_Send;
-            transportInterface.pNetworkContext = &networkContext;
+            isManagerStarted = credentialManagerInit( &credentialManager,
+                                                      &credentialNetworkContext );
         }
 
-        /* Initialize response buffer. */
-        credentialResponse.pBuffer = pAwsIotHttpBuffer;
-        credentialResponse.bufferLen = CREDENTIAL_BUFFER_LENGTH;
-
-        credentialStatus = getTemporaryCredentials( &transportInterface, pDateISO8601, sizeof( pDateISO8601 ), &credentialResponse, &sigvCreds );
+        credentialStatus = ( isManagerStarted == true ) &&
+                           ( credentialManagerGet( &credentialManager, &temporaryCredentials ) == true );
 
         returnStatus = ( credentialStatus == true ) ? EXIT_SUCCESS : EXIT_FAILURE;
 
         if( returnStatus == EXIT_FAILURE )
         {
             LogError( ( "Failed to get temporary credentials from AWS IoT CREDENTIALS PROVIDER %s.",
-                        serverHost ) );
+                        AWS_IOT_CREDENTIAL_PROVIDER_ENDPOINT ) );
+        }
+        else
+        {
+            sigvCreds.pAccessKeyId = temporaryCredentials.accessKeyId;
+            sigvCreds.accessKeyIdLen = temporaryCredentials.accessKeyIdLen;
+            sigvCreds.pSecretAccessKey = temporaryCredentials.secretAccessKey;
+            sigvCreds.secretAccessKeyLen = temporaryCredentials.secretAccessKeyLen;
+            ( void ) memcpy( pDateISO8601, temporaryCredentials.dateISO8601, sizeof( pDateISO8601 ) );
         }
-
-        /* End the TLS session, then close the TCP connection. */
-        ( void ) Openssl_Disconnect( &networkContext );
 
         if( returnStatus == EXIT_SUCCESS )
         {
@@ -1152,6 +1019,11 @@ int main( int argc,
         }
     } while( returnStatus != EXIT_SUCCESS );
 
+    if( isManagerStarted == true )
+    {
+        credentialManagerCleanup( &credentialManager );
+    }
+
     if( returnStatus == EXIT_SUCCESS )
     {
         /* Log a message indicating an iteration completed successfully. */
@@ -110,8 +110,25 @@
 #define RANGE_REQUEST_LENGTH              ( 2048 )
 
 /**
- * @brief The number of items that can be held in each queue.
+ * @brief The number of connections over which the ranges of the file are
+ * downloaded at the same time.
+ *
+ * @note Each connection has its own thread and a user buffer of
+ * USER_BUFFER_LENGTH bytes.
+ */
+#define DOWNLOAD_CONNECTION_COUNT         ( 4 )
+
+/**
+ * @brief The number of times a range that failed to download is requested
+ * again before the download fails.
  */
-#define QUEUE_SIZE                        10
+#define RANGE_REQUEST_MAX_RETRIES         ( 3 )
+
+/**
+ * @brief Path of the file the S3 object is written to.
+ */
+#ifndef DOWNLOAD_FILE_PATH
+    #define DOWNLOAD_FILE_PATH    "s3_download.bin"
+#endif
 
 #endif /* ifndef DEMO_CONFIG_H_ */
@@ -29,10 +29,7 @@
 /* POSIX includes. */
 #include <unistd.h>
 #include <fcntl.h>
-#include <mqueue.h>
 #include <errno.h>
-#include <sys/types.h>
-#include <signal.h>
 
 /* Include Demo Config as the first non-system header. */
 #include "demo_config.h"
@@ -40,6 +37,9 @@
 /* Common HTTP demo utilities. */
 #include "http_demo_utils.h"
 
+/* Parallel range downloader. */
+#include "http_demo_range_download.h"
+
 /* HTTP API header. */
 #include "core_http_client.h"
 
@@ -79,26 +79,20 @@
     #error "Please define a RANGE_REQUEST_LENGTH."
 #endif
 
-/* Check the the queue size is defined. */
-#ifndef QUEUE_SIZE
-    #error "Please define a QUEUE_SIZE."
+/* Check that the number of download connections is defined. */
+#ifndef DOWNLOAD_CONNECTION_COUNT
+    #error "Please define a DOWNLOAD_CONNECTION_COUNT."
 #endif
 
-/**
- * @brief The name of the HTTP thread's input queue. Must begin with a slash and
- * be a valid pathname.
- */
-#define REQUEST_QUEUE                             "/demo_request_queue"
-
-/**
- * @brief The name of the HTTP thread's output queue. Must begin with a slash
- * and be a valid pathname.
- */
-#define RESPONSE_QUEUE                            "/demo_response_queue"
+/* Check that the number of retries of a range is defined. */
+#ifndef RANGE_REQUEST_MAX_RETRIES
+    #error "Please define a RANGE_REQUEST_MAX_RETRIES."
+#endif
 
-/* Posix file permissions for the queues. Allows read and write access to the
- * user this demo is running as. */
-#define QUEUE_PERMISSIONS                         0600
+/* Check that the path of the downloaded file is defined. */
+#ifndef DOWNLOAD_FILE_PATH
+    #error "Please define a DOWNLOAD_FILE_PATH."
+#endif
 
 /**
  * @brief Length of the S3 presigned URL.
@@ -125,6 +119,9 @@
  */
 #define HTTP_STATUS_CODE_PARTIAL_CONTENT          206
 
+/* Posix file permissions for the downloaded file. */
+#define DOWNLOAD_FILE_PERMISSIONS                 0600
+
 /**
  * @brief The maximum number of times to run the loop in this demo.
  *
@@ -152,70 +149,16 @@ static const char * pHost = NULL;
 static size_t hostLen = 0;
 
 /**
- * @brief Data type for request queue.
- *
- * In addition to sending #HTTPRequestHeaders_t, we need to send the buffer it uses.
- * The pointer to the buffer in #HTTPRequestHeaders_t will be incorrect after
- * it is received, so it will need to be fixed.
- */
-typedef struct RequestItem
-{
-    HTTPRequestHeaders_t requestHeaders;
-    uint8_t headersBuffer[ USER_BUFFER_LENGTH ];
-} RequestItem_t;
-
-/**
- * @brief Data type for response queue.
- *
- * In addition to sending the #HTTPResponse_t, we need to send the buffer it uses.
- * The pointer to the buffer in #HTTPResponse_t will be incorrect after
- * it is received, so it will need to be fixed.
+ * @brief A buffer used in the demo for storing HTTP request headers and HTTP
+ * response headers and body of the request for the size of the S3 file.
  */
-typedef struct ResponseItem
-{
-    HTTPResponse_t response;
-    uint8_t responseBuffer[ USER_BUFFER_LENGTH ];
-} ResponseItem_t;
-
-/* @brief Struct used for sending requests to the HTTP thread.
- *
- * This is used by both the main and HTTP threads, though since we create the
- * HTTP thread without a shared memory space, each will have its own copy. We
- * have this as a global so that it will be located at the same address in the
- * main and HTTP threads so that way pointers remain valid when copied over.
- */
-static RequestItem_t requestItem = { 0 };
-
-/* @brief Struct used for receiving responses from the HTTP thread.
- *
- * This is used by both the main and HTTP threads, though since we create the
- * HTTP thread without a shared memory space, each will have its own copy. We
- * have this as a global so that it will be located at the same address in the
- * main and HTTP threads so that way pointers remain valid when copied over.
- */
-static ResponseItem_t responseItem = { 0 };
+static uint8_t userBuffer[ USER_BUFFER_LENGTH ];
 
 /**
- * @brief The return status for requestS3ObjectRange() and retrieveHTTPResponse().
+ * @brief Buffers of the connections downloading the ranges of the S3 file,
+ * USER_BUFFER_LENGTH bytes each.
  */
-typedef enum QueueOpStatus
-{
-    /**
-     * @brief The function completed successfully.
-     */
-    QUEUE_OP_SUCCESS,
-
-    /**
-     * @brief The function was given a non-blocking queue and would have blocked
-     * were it a blocking queue.
-     */
-    QUEUE_OP_WOULD_BLOCK,
-
-    /**
-     * @brief The function encountered an error.
-     */
-    QUEUE_OP_FAILURE,
-} QueueOpStatus_t;
+static uint8_t downloadBuffer[ DOWNLOAD_CONNECTION_COUNT * USER_BUFFER_LENGTH ];
 
 /*-----------------------------------------------------------*/
 
@@ -237,92 +180,58 @@ struct NetworkContext
 static int connectToServer( NetworkContext_t * pNetworkContext );
 
 /**
- * @brief Send an HTTP request based on a specified method and path, and
- * print the response received from the server.
+ * @brief End the TLS session and close the TCP connection of a network
+ * context.
  *
+ * @param[in] pNetworkContext The network context to disconnect.
+ */
+static void disconnectFromServer( NetworkContext_t * pNetworkContext );
+
+/**
+ * @brief Retrieve the size of the S3 object, then download the object over
+ * several connections into DOWNLOAD_FILE_PATH.
+ *
+ * @param[in] pTransportInterface The transport interface for making network
+ * calls.
  * @param[in] pHost The host name of the server.
  * @param[in] hostLen The length of pHost.
  * @param[in] pRequest The HTTP Request-URI.
  * @param[in] requestUriLen The length of pRequest.
- * @param[in] fileSize The length of the file at S3_PRESIGNED_GET_URL.
- * @param[in] requestQueue The queue to which HTTP requests should be written.
- * @param[in] responseQueue The queue from which HTTP responses should be read.
  *
  * @return false on failure; true on success.
  */
-static bool downloadS3ObjectFile( const char * pHost,
+static bool downloadS3ObjectFile( const TransportInterface_t * pTransportInterface,
+                                  const char * pHost,
                                   const size_t hostLen,
                                   const char * pRequest,
-                                  const size_t requestUriLen,
-                                  mqd_t requestQueue,
-                                  mqd_t responseQueue );
+                                  const size_t requestUriLen );
 
 /**
- * @brief Enqueue an HTTP request for a range of the S3 file.
- *
- * @param[in] requestInfo The #HTTPRequestInfo_t for configuring the request.
- * @param[in] requestQueue The queue to which HTTP requests should be written.
- * @param[in] start The position of the first byte in the range.
- * @param[in] end The position of the last byte in the range, inclusive.
+ * @brief Download all ranges of the S3 file over DOWNLOAD_CONNECTION_COUNT
+ * connections and write them to DOWNLOAD_FILE_PATH.
  *
- * @return QUEUE_OP_FAILURE on failure; QUEUE_OP_WOULD_BLOCK if would block,
- * QUEUE_OP_SUCCESS on success.
- */
-static QueueOpStatus_t requestS3ObjectRange( const HTTPRequestInfo_t * requestInfo,
-                                             mqd_t requestQueue,
-                                             const size_t start,
-                                             const size_t end );
-
-
-/**
- * @brief Processes an HTTP response from the response queue.
- *
- * @param[in] responseQueue The queue from which HTTP responses should be read.
- * @param[out] responseItem The HTTP response received.
+ * @param[in] requestInfo The #HTTPRequestInfo_t for configuring the requests.
+ * @param[in] fileSize The length of the file at S3_PRESIGNED_GET_URL.
  *
- * @return QUEUE_OP_FAILURE on failure; QUEUE_OP_WOULD_BLOCK if would block,
- * QUEUE_OP_SUCCESS on success.
+ * @return false on failure; true on success.
  */
-static QueueOpStatus_t retrieveHTTPResponse( mqd_t responseQueue,
-                                             ResponseItem_t * responseItem );
+static bool downloadS3ObjectRanges( const HTTPRequestInfo_t * requestInfo,
+                                    size_t fileSize );
 
 /**
- * @brief Retrieve the size of the S3 object that is specified in pPath using
- * HTTP thread.
+ * @brief Retrieve the size of the S3 object that is specified in the request.
  *
+ * @param[in] pTransportInterface The transport interface for making network
+ * calls.
  * @param[in] requestInfo The #HTTPRequestInfo_t for configuring the request.
- * @param[in] requestQueue The queue to which HTTP requests should be written.
- * @param[in] responseQueue The queue from which HTTP responses should be read.
  * @param[out] pFileSize - The size of the S3 object.
  *
  * @return false on failure; true on success.
  */
-static bool getS3ObjectFileSize( const HTTPRequestInfo_t * requestInfo,
-                                 mqd_t requestQueue,
-                                 mqd_t responseQueue,
+static bool getS3ObjectFileSize( const TransportInterface_t * pTransportInterface,
+                                 const HTTPRequestInfo_t * requestInfo,
                                  size_t * pFileSize );
 
-/**
- * @brief Services HTTP requests from the request queue and writes the
- * responses to the response queue.
- *
- * @param[in] pTransportInterface The transport interface for making network calls.
- *
- * @return -1 on failure; PID of HTTP thread on success.
- */
-static pid_t startHTTPThread( const TransportInterface_t * pTransportInterface );
-
-/**
- * @brief Clean up resources created by demo.
- *
- * @param[in] httpThread The HTTP thread.
- * @param[in] requestQueue The request queue.
- * @param[in] responseQueue The response queue.
- */
-static void tearDown( pid_t httpThread,
-                      mqd_t requestQueue,
-                      mqd_t responseQueue );
-
 /*-----------------------------------------------------------*/
 
 static int connectToServer( NetworkContext_t * pNetworkContext )
@@ -367,17 +276,20 @@ static int connectToServer( NetworkContext_t * pNetworkContext )
 
 /*-----------------------------------------------------------*/
 
-static bool downloadS3ObjectFile( const char * pHost,
+static void disconnectFromServer( NetworkContext_t * pNetworkContext )
+{
+    ( void ) Openssl_Disconnect( pNetworkContext );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool downloadS3ObjectFile( const TransportInterface_t * pTransportInterface,
+                                  const char * pHost,
                                   const size_t hostLen,
                                   const char * pRequest,
-                                  const size_t requestUriLen,
-                                  mqd_t requestQueue,
-                                  mqd_t responseQueue )
+                                  const size_t requestUriLen )
 {
     bool returnStatus = true;
-    QueueOpStatus_t queueOpStatus = QUEUE_OP_SUCCESS;
-
-    size_t requestCount = 0;
 
     /* Configurations of the initial request headers. */
     HTTPRequestInfo_t requestInfo = { 0 };
@@ -385,11 +297,6 @@ static bool downloadS3ObjectFile( const char * pHost,
     /* The length of the file at S3_PRESIGNED_GET_URL. */
     size_t fileSize = 0;
 
-    /* The number of bytes we want to request within each range of the file. */
-    size_t numReqBytes = 0;
-    /* curByte indicates which starting byte we want to download next. */
-    size_t curByte = 0;
-
     /* Initialize the request object. */
     requestInfo.pHost = pHost;
     requestInfo.hostLen = hostLen;
@@ -404,85 +311,13 @@ static bool downloadS3ObjectFile( const char * pHost,
     requestInfo.reqFlags = HTTP_REQUEST_KEEP_ALIVE_FLAG;
 
     /* Get the length of the S3 file. */
-    returnStatus = getS3ObjectFileSize( &requestInfo,
-                                        requestQueue,
-                                        responseQueue,
+    returnStatus = getS3ObjectFileSize( pTransportInterface,
+                                        &requestInfo,
                                         &fileSize );
 
     if( returnStatus == true )
     {
-        if( fileSize < RANGE_REQUEST_LENGTH )
-        {
-            numReqBytes = fileSize;
-        }
-        else
-        {
-            numReqBytes = RANGE_REQUEST_LENGTH;
-        }
-
-        /* Here we iterate sending byte range requests and retrieving responses
-         * until the full file has been downloaded. We keep track of the next byte
-         * to download with curByte. When this reaches the fileSize we stop
-         * downloading. We keep track of the number of responses we are waiting for
-         * with requestCount.
-         */
-        while( ( returnStatus != false ) && ( curByte < fileSize || requestCount > 0 ) )
-        {
-            /* Send range request if remaining. */
-            if( curByte < fileSize )
-            {
-                queueOpStatus = requestS3ObjectRange( &requestInfo,
-                                                      requestQueue,
-                                                      curByte,
-                                                      curByte + numReqBytes - 1 );
-
-                if( queueOpStatus == QUEUE_OP_FAILURE )
-                {
-                    returnStatus = false;
-                }
-                else if( queueOpStatus == QUEUE_OP_SUCCESS )
-                {
-                    requestCount += 1;
-                    curByte += numReqBytes;
-
-                    if( ( fileSize - curByte ) < numReqBytes )
-                    {
-                        numReqBytes = fileSize - curByte;
-                    }
-                }
-            }
-
-            /* Retrieve response. */
-            if( ( requestCount > 0 ) && ( queueOpStatus != QUEUE_OP_FAILURE ) )
-            {
-                queueOpStatus = retrieveHTTPResponse( responseQueue, &responseItem );
-
-                if( queueOpStatus == QUEUE_OP_FAILURE )
-                {
-                    returnStatus = false;
-                }
-                else if( queueOpStatus == QUEUE_OP_SUCCESS )
-                {
-                    LogInfo( ( "Main thread received HTTP response" ) );
-                    LogInfo( ( "Response Headers:\n%.*s",
-                               ( int32_t ) responseItem.response.headersLen,
-                               responseItem.response.pHeaders ) );
-                    LogInfo( ( "Response Status:\n%u", responseItem.response.statusCode ) );
-                    LogInfo( ( "Response Body:\n%.*s\n", ( int32_t ) responseItem.response.bodyLen,
-                               responseItem.response.pBody ) );
-
-                    if( responseItem.response.statusCode != HTTP_STATUS_CODE_PARTIAL_CONTENT )
-                    {
-                        LogError( ( "Recieved repsonse with unexpected status code: %d", responseItem.response.statusCode ) );
-                        returnStatus = false;
-                    }
-                    else
-                    {
-                        requestCount -= 1;
-                    }
-                }
-            }
-        }
+        returnStatus = downloadS3ObjectRanges( &requestInfo, fileSize );
     }
 
     return returnStatus;
@@ -490,115 +325,71 @@ static bool downloadS3ObjectFile( const char * pHost,
 
 /*-----------------------------------------------------------*/
 
-static QueueOpStatus_t requestS3ObjectRange( const HTTPRequestInfo_t * requestInfo,
-                                             mqd_t requestQueue,
-                                             const size_t start,
-                                             const size_t end )
+static bool downloadS3ObjectRanges( const HTTPRequestInfo_t * requestInfo,
+                                    size_t fileSize )
 {
-    QueueOpStatus_t returnStatus = QUEUE_OP_SUCCESS;
-    HTTPStatus_t httpStatus = HTTPSuccess;
+    bool returnStatus = true;
+    size_t i = 0;
 
-    /* Return value of mq_send. */
-    int mqerror = 0;
+    /* Configuration of the parallel download. */
+    RangeDownloadConfig_t downloadConfig = { 0 };
 
-    /* Set the buffer used for storing request headers. */
-    requestItem.requestHeaders.pBuffer = requestItem.headersBuffer;
-    requestItem.requestHeaders.bufferLen = USER_BUFFER_LENGTH;
+    /* The connections used to download the ranges. */
+    TransportInterface_t transportInterfaces[ DOWNLOAD_CONNECTION_COUNT ] = { 0 };
+    NetworkContext_t networkContexts[ DOWNLOAD_CONNECTION_COUNT ] = { 0 };
+    OpensslParams_t opensslParams[ DOWNLOAD_CONNECTION_COUNT ] = { 0 };
 
-    httpStatus = HTTPClient_InitializeRequestHeaders( &( requestItem.requestHeaders ),
-                                                      requestInfo );
+    /* The file the S3 object is written to. */
+    int fileDescriptor = -1;
 
-    if( httpStatus != HTTPSuccess )
-    {
-        LogError( ( "Failed to initialize HTTP request headers: Error=%s.",
-                    HTTPClient_strerror( httpStatus ) ) );
-        returnStatus = QUEUE_OP_FAILURE;
-    }
+    fileDescriptor = open( DOWNLOAD_FILE_PATH,
+                           O_CREAT | O_TRUNC | O_WRONLY,
+                           DOWNLOAD_FILE_PERMISSIONS );
 
-    if( returnStatus == QUEUE_OP_SUCCESS )
+    if( fileDescriptor == -1 )
     {
-        httpStatus = HTTPClient_AddRangeHeader( &( requestItem.requestHeaders ),
-                                                start,
-                                                end );
-
-        if( httpStatus != HTTPSuccess )
-        {
-            LogError( ( "Failed to add Range header to request headers: Error=%s.",
-                        HTTPClient_strerror( httpStatus ) ) );
-            returnStatus = QUEUE_OP_FAILURE;
-        }
+        LogError( ( "Failed to open %s with error %s.",
+                    DOWNLOAD_FILE_PATH,
+                    strerror( errno ) ) );
+        returnStatus = false;
     }
 
-    if( returnStatus == EXIT_SUCCESS )
+    if( returnStatus == true )
     {
-        /* Enqueue the request. */
-        LogInfo( ( "Enqueuing bytes %d to %d of S3 Object:  ",
-                   ( int32_t ) start,
-                   ( int32_t ) end ) );
-        LogInfo( ( "Request Headers:\n%.*s",
-                   ( int32_t ) requestItem.requestHeaders.headersLen,
-                   ( char * ) requestItem.requestHeaders.pBuffer ) );
-
-        mqerror = mq_send( requestQueue,
-                           ( char * ) &requestItem,
-                           sizeof( RequestItem_t ),
-                           0 );
-
-        if( mqerror == -1 )
+        for( i = 0; i < DOWNLOAD_CONNECTION_COUNT; i++ )
         {
-            if( errno != EAGAIN )
-            {
-                /* Error other than due to not blocking. */
-                LogError( ( "Failed to write to request queue with error %s.",
-                            strerror( errno ) ) );
-                returnStatus = QUEUE_OP_FAILURE;
-            }
-            else
-            {
-                returnStatus = QUEUE_OP_WOULD_BLOCK;
-            }
+            networkContexts[ i ].pParams = &opensslParams[ i ];
+            transportInterfaces[ i ].recv = Openssl_Recv;
+            transportInterfaces[ i ].send = Openssl_Send;
+            transportInterfaces[ i ].pNetworkContext = &networkContexts[ i ];
         }
-    }
-
-    return returnStatus;
-}
 
-/*-----------------------------------------------------------*/
-
-static QueueOpStatus_t retrieveHTTPResponse( mqd_t responseQueue,
-                                             ResponseItem_t * responseItem )
-{
-    QueueOpStatus_t returnStatus = QUEUE_OP_SUCCESS;
-
-    /* Return value of mq_receive. */
-    int mqread = 0;
-
-    /* Read response from queue. */
-    mqread = mq_receive( responseQueue, ( char * ) responseItem,
-                         sizeof( ResponseItem_t ), NULL );
-
-    if( mqread == -1 )
-    {
-        if( errno != EAGAIN )
+        downloadConfig.pRequestInfo = requestInfo;
+        downloadConfig.pTransportInterfaces = transportInterfaces;
+        downloadConfig.connectionCount = DOWNLOAD_CONNECTION_COUNT;
+        downloadConfig.connectFunction = connectToServer;
+        downloadConfig.disconnectFunction = disconnectFromServer;
+        downloadConfig.pBuffer = downloadBuffer;
+        downloadConfig.bufferLength = sizeof( downloadBuffer );
+        downloadConfig.fileDescriptor = fileDescriptor;
+        downloadConfig.fileSize = fileSize;
+        downloadConfig.rangeLength = RANGE_REQUEST_LENGTH;
+        downloadConfig.maxRangeRetries = RANGE_REQUEST_MAX_RETRIES;
+
+        returnStatus = downloadRangesInParallel( &downloadConfig );
+
+        if( close( fileDescriptor ) == -1 )
         {
-            /* Error other than due to not blocking. */
-            LogError( ( "Failed to read from response queue with error %s.",
+            LogError( ( "Failed to close %s with error %s.",
+                        DOWNLOAD_FILE_PATH,
                         strerror( errno ) ) );
-            returnStatus = QUEUE_OP_FAILURE;
-        }
-        else
-        {
-            returnStatus = QUEUE_OP_WOULD_BLOCK;
+            returnStatus = false;
         }
     }
 
-    if( returnStatus == QUEUE_OP_SUCCESS )
+    if( returnStatus == true )
     {
-        if( mqread != sizeof( ResponseItem_t ) )
-        {
-            LogError( ( "Response from response queue has incorrect size." ) );
-            returnStatus = QUEUE_OP_FAILURE;
-        }
+        LogInfo( ( "Wrote the S3 object to %s.", DOWNLOAD_FILE_PATH ) );
     }
 
     return returnStatus;
@@ -606,14 +397,14 @@ static QueueOpStatus_t retrieveHTTPResponse( mqd_t responseQueue,
 
 /*-----------------------------------------------------------*/
 
-static bool getS3ObjectFileSize( const HTTPRequestInfo_t * requestInfo,
-                                 mqd_t requestQueue,
-                                 mqd_t responseQueue,
+static bool getS3ObjectFileSize( const TransportInterface_t * pTransportInterface,
+                                 const HTTPRequestInfo_t * requestInfo,
                                  size_t * pFileSize )
 {
     bool returnStatus = true;
     HTTPStatus_t httpStatus = HTTPSuccess;
-    QueueOpStatus_t queueOpStatus = QUEUE_OP_SUCCESS;
+    HTTPRequestHeaders_t requestHeaders = { 0 };
+    HTTPResponse_t response = { 0 };
 
     /* The location of the file size in contentRangeValStr. */
     char * pFileSizeStr = NULL;
@@ -622,43 +413,72 @@ static bool getS3ObjectFileSize( const HTTPRequestInfo_t * requestInfo,
     char * contentRangeValStr = NULL;
     size_t contentRangeValStrLength = 0;
 
+    /* Set the buffer used for storing request headers. */
+    requestHeaders.pBuffer = userBuffer;
+    requestHeaders.bufferLen = USER_BUFFER_LENGTH;
+
+    /* Initialize the response object. The same buffer used for storing request
+     * headers is reused here. */
+    response.pBuffer = userBuffer;
+    response.bufferLen = USER_BUFFER_LENGTH;
+
     LogInfo( ( "Getting file object size from host..." ) );
 
-    /* Request bytes 0 to 0. S3 will respond with a Content-Range
-     * header that contains the size of the file in it. This header will look
-     * like: "Content-Range: bytes 0-0/FILESIZE". The body will have a single
-     * byte that we are ignoring. */
-    queueOpStatus = requestS3ObjectRange( requestInfo,
-                                          requestQueue,
-                                          0,
-                                          0 );
+    httpStatus = HTTPClient_InitializeRequestHeaders( &requestHeaders,
+                                                      requestInfo );
 
-    if( queueOpStatus != QUEUE_OP_SUCCESS )
+    if( httpStatus != HTTPSuccess )
     {
+        LogError( ( "Failed to initialize HTTP request headers: Error=%s.",
+                    HTTPClient_strerror( httpStatus ) ) );
         returnStatus = false;
     }
 
     if( returnStatus == true )
     {
-        do
+        /* Request bytes 0 to 0. S3 will respond with a Content-Range
+         * header that contains the size of the file in it. This header will look
+         * like: "Content-Range: bytes 0-0/FILESIZE". The body will have a single
+         * byte that we are ignoring. */
+        httpStatus = HTTPClient_AddRangeHeader( &requestHeaders, 0, 0 );
+
+        if( httpStatus != HTTPSuccess )
         {
-            queueOpStatus = retrieveHTTPResponse( responseQueue, &responseItem );
-        } while( queueOpStatus == QUEUE_OP_WOULD_BLOCK );
+            LogError( ( "Failed to add Range header to request headers: Error=%s.",
+                        HTTPClient_strerror( httpStatus ) ) );
+            returnStatus = false;
+        }
+    }
 
-        if( queueOpStatus == QUEUE_OP_FAILURE )
+    if( returnStatus == true )
+    {
+        httpStatus = HTTPClient_Send( pTransportInterface,
+                                      &requestHeaders,
+                                      NULL,
+                                      0,
+                                      &response,
+                                      0 );
+
+        if( httpStatus != HTTPSuccess )
         {
+            LogError( ( "Failed to send HTTP request: Error=%s.",
+                        HTTPClient_strerror( httpStatus ) ) );
             returnStatus = false;
         }
-        else if( responseItem.response.statusCode != HTTP_STATUS_CODE_PARTIAL_CONTENT )
+        else if( response.statusCode != HTTP_STATUS_CODE_PARTIAL_CONTENT )
         {
-            LogError( ( "Received response with unexpected status code: %d.", responseItem.response.statusCode ) );
+            LogError( ( "Received response with unexpected status code: %d.", response.statusCode ) );
             returnStatus = false;
         }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
     }
 
     if( returnStatus == true )
     {
-        httpStatus = HTTPClient_ReadHeader( &responseItem.response,
+        httpStatus = HTTPClient_ReadHeader( &response,
                                             ( char * ) HTTP_CONTENT_RANGE_HEADER_FIELD,
                                             ( size_t ) HTTP_CONTENT_RANGE_HEADER_FIELD_LENGTH,
                                             ( const char ** ) &contentRangeValStr,
@@ -708,158 +528,20 @@ static bool getS3ObjectFileSize( const HTTPRequestInfo_t * requestInfo,
 
 /*-----------------------------------------------------------*/
 
-static pid_t startHTTPThread( const TransportInterface_t * pTransportInterface )
-{
-    /* Return value of fork. */
-    pid_t forkPID = -1;
-
-    /* Fork to create the HTTP thread. */
-    forkPID = fork();
-
-    if( forkPID == -1 )
-    {
-        LogError( ( "Error forking." ) );
-    }
-    else if( forkPID == 0 )
-    {
-        /* HTTP thread. */
-
-        /* Queues for HTTP requests and responses. */
-        mqd_t requestQueue = -1;
-        mqd_t responseQueue = -1;
-
-        /* Open queues for read/write. */
-        requestQueue = mq_open( REQUEST_QUEUE, O_RDONLY );
-        responseQueue = mq_open( RESPONSE_QUEUE, O_WRONLY );
-
-        /* Initialize response struct. */
-        responseItem.response.pBuffer = responseItem.responseBuffer;
-        responseItem.response.bufferLen = sizeof( responseItem.responseBuffer );
-
-        for( ; ; )
-        {
-            HTTPStatus_t httpStatus = HTTPSuccess;
-
-            /* Return value of mq_receive. */
-            int mqread = 0;
-            /* Return value of mq_send. */
-            int mqerror = 0;
-
-            /* Read request from queue. */
-            mqread = mq_receive( requestQueue,
-                                 ( char * ) &requestItem,
-                                 sizeof( RequestItem_t ),
-                                 NULL );
-
-            if( mqread == -1 )
-            {
-                LogError( ( "Failed to read from request queue with error %s.",
-                            strerror( errno ) ) );
-            }
-
-            if( mqread != sizeof( RequestItem_t ) )
-            {
-                LogError( ( "Response from request queue has incorrect size." ) );
-            }
-
-            LogInfo( ( "HTTP thread retrieved request." ) );
-            LogInfo( ( "Request Headers:\n%.*s",
-                       ( int32_t ) requestItem.requestHeaders.headersLen,
-                       ( char * ) requestItem.requestHeaders.pBuffer ) );
-
-            httpStatus = HTTPClient_Send( pTransportInterface,
-                                          &requestItem.requestHeaders,
-                                          NULL,
-                                          0,
-                                          &responseItem.response,
-                                          0 );
-
-            if( httpStatus != HTTPSuccess )
-            {
-                LogError( ( "Failed to send HTTP request: Error=%s.",
-                            HTTPClient_strerror( httpStatus ) ) );
-            }
-            else
-            {
-                LogInfo( ( "HTTP thread received HTTP response" ) );
-                /* Write response to queue. */
-                mqerror = mq_send( responseQueue,
-                                   ( char * ) &responseItem,
-                                   sizeof( ResponseItem_t ),
-                                   0 );
-
-                if( mqerror != 0 )
-                {
-                    LogError( ( "Failed to write to response queue with error %s.",
-                                strerror( errno ) ) );
-                }
-            }
-        }
-    }
-
-    return forkPID;
-}
-
-/*-----------------------------------------------------------*/
-
-void tearDown( pid_t httpThread,
-               mqd_t requestQueue,
-               mqd_t responseQueue )
-{
-    /* End http task. */
-    if( httpThread != -1 )
-    {
-        kill( httpThread, SIGTERM );
-    }
-
-    /* Close and then delete the queues. */
-    if( requestQueue != -1 )
-    {
-        if( mq_close( requestQueue ) == -1 )
-        {
-            LogError( ( "Failed to close request queue with error %s.",
-                        strerror( errno ) ) );
-        }
-
-        if( mq_unlink( REQUEST_QUEUE ) == -1 )
-        {
-            LogError( ( "Failed to delete request queue with error %s.",
-                        strerror( errno ) ) );
-        }
-    }
-
-    if( responseQueue != -1 )
-    {
-        if( mq_close( responseQueue ) == -1 )
-        {
-            LogError( ( "Failed to close response queue with error %s.",
-                        strerror( errno ) ) );
-        }
-
-        if( mq_unlink( RESPONSE_QUEUE ) == -1 )
-        {
-            LogError( ( "Failed to delete response queue with error %s.",
-                        strerror( errno ) ) );
-        }
-    }
-}
-
-/*-----------------------------------------------------------*/
-
 /**
  * @brief Entry point of demo.
  *
  * This example resolves a domain, establishes a TCP connection, validates the
  * server's certificate using the root CA certificate defined in the config
  * header, then finally performs a TLS handshake with the HTTP server so that
- * all communication is encrypted. After which, an HTTP thread is started which
- * uses HTTP Client library API to send requests it reads from the request
- * queue, and writes the responses to the response queue. The main thread sends
- * requests on the request queue, which are used to download
- * the S3 file by sending multiple range requests. While it is doing this, the
- * main thread also reads responses from the response queue and prints them
- * until the entire file is received. If any request fails, an error
- * code is returned.
+ * all communication is encrypted. After which, the main thread uses HTTP
+ * Client library API to request the first byte of the S3 file, to learn its
+ * size. The file is then split into ranges, which are downloaded over
+ * DOWNLOAD_CONNECTION_COUNT connections at the same time, each on its own
+ * thread, and written to DOWNLOAD_FILE_PATH as they arrive. Each range is
+ * written from the buffer it was received in, without being copied. A range
+ * that fails is requested again, up to RANGE_REQUEST_MAX_RETRIES times. If the
+ * file cannot be downloaded, an error code is returned.
  *
  * @note This example is multi-threaded and uses statically allocated memory.
  *
@@ -868,12 +550,10 @@ void tearDown( pid_t httpThread,
  * (located in located in demos/http/common/src) to generate these URLs. For
  * detailed instructions, see the accompanied README.md.
  *
- * @note If your file requires more than 99 range requests to S3 (depending on
- * the size of the file and the length specified in RANGE_REQUEST_LENGTH), your
- * connection may be dropped by S3. In this case, either increase the buffer
- * size and range request length (if feasible), to reduce the number of requests
- * required, or re-establish the connection with S3 after receiving a
- * "Connection: close" response header.
+ * @note S3 may close a connection after about 100 range requests. The
+ * downloading connections are re-established after a "Connection: close"
+ * response header, so increasing the buffer size and range request length
+ * only reduces the number of reconnections.
  */
 int main( int argc,
           char ** argv )
@@ -902,16 +582,6 @@ int main( int argc,
     NetworkContext_t networkContext = { 0 };
     OpensslParams_t opensslParams = { 0 };
 
-    /* Queue for HTTP requests. Requests are written by the main thread,
-     * and serviced by the HTTP thread. */
-    mqd_t requestQueue = -1;
-
-    /* Queue for HTTP responses. Responses are written by the HTTP thread,
-     * and read by the main thread. */
-    mqd_t responseQueue = -1;
-
-    /* PID of HTTP thread. */
-    pid_t httpThread = -1;
     int demoRunCount = 0;
 
     ( void ) argc;
@@ -985,79 +655,16 @@ int main( int argc,
                 transportInterface.pNetworkContext = &networkContext;
             }
 
-            /******************** Start queues and HTTP task. *******************/
-
-            /* Start request and response queues. */
-            if( returnStatus == EXIT_SUCCESS )
-            {
-                /* Settings for constructing queues. */
-                struct mq_attr queueSettings;
-
-                queueSettings.mq_maxmsg = QUEUE_SIZE;
-                queueSettings.mq_msgsize = sizeof( RequestItem_t );
-
-                requestQueue = mq_open( REQUEST_QUEUE,
-
-                                        /* These options create a queue if it does
-                                         * not already exist, and then opens it in
-                                         * non-blocking mode. It is opened as
-                                         * write-only as the main thread only writes
-                                         * HTTP requests to it. */
-                                        O_CREAT | O_NONBLOCK | O_WRONLY,
-                                        QUEUE_PERMISSIONS,
-                                        &queueSettings );
-
-                if( requestQueue == -1 )
-                {
-                    LogError( ( "Failed to open request queue with error %s.",
-                                strerror( errno ) ) );
-                    returnStatus = EXIT_FAILURE;
-                }
-
-                queueSettings.mq_msgsize = sizeof( ResponseItem_t );
-
-                responseQueue = mq_open( RESPONSE_QUEUE,
-
-                                         /* These options create a queue if it does
-                                          * not already exist, and then opens it in
-                                          * non-blocking mode. It is opened as
-                                          * read-only as the main thread only reads
-                                          * HTTP responses from it. */
-                                         O_CREAT | O_NONBLOCK | O_RDONLY,
-                                         QUEUE_PERMISSIONS,
-                                         &queueSettings );
-
-                if( responseQueue == -1 )
-                {
-                    LogError( ( "Failed to open response queue with error %s.",
-                                strerror( errno ) ) );
-                    returnStatus = EXIT_FAILURE;
-                }
-            }
-
-            /* Start the HTTP task which services requests in requestQueue. */
-
-            if( returnStatus == EXIT_SUCCESS )
-            {
-                httpThread = startHTTPThread( &transportInterface );
-
-                if( httpThread == -1 )
-                {
-                    returnStatus = EXIT_SUCCESS;
-                }
-            }
-
             /******************** Download S3 Object File. **********************/
 
             if( returnStatus == EXIT_SUCCESS )
             {
                 bool result = false;
-                result = downloadS3ObjectFile( pHost,
+                result = downloadS3ObjectFile( &transportInterface,
+                                               pHost,
                                                hostLen,
                                                pPath,
-                                               requestUriLen,
-                                               requestQueue,
-                                               responseQueue );
+                                               requestUriLen );
 
                 if( result == false )
                 {
@@ -1070,10 +677,6 @@ int main( int argc,
             /* End TLS session, then close TCP connection. */
             ( void ) Openssl_Disconnect( &networkContext );
 
-            /******************** Clean up queues and HTTP task. ****************/
-
-            tearDown( httpThread, requestQueue, responseQueue );
-
             /******************* Retry in case of failure. **********************/
 
             /* Increment the demo run count. */
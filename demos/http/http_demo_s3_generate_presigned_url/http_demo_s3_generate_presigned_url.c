@@ -444,7 +444,7 @@ int main( int argc,
     TransportInterface_t transportInterface = { NULL };
     /* The network context for the transport layer interface. */
     NetworkContext_t networkContext;
-    OpensslParams_t opensslParams;
+    OpensslParams_t opensslParams = { 0 };
 
     ( void ) argc;
     ( void ) argv;
@@ -58,19 +58,44 @@
  */
 #define INTERVAL_MAX            ( 60U * 60U * 24U * 7U )
 
+/**
+ * @brief Most job executions run at the same time.
+ * (the jobs command line argument can lower it)
+ */
+#define MAX_CONCURRENT_JOBS     ( 8U )
+
+/**
+ * @brief Least interval in seconds between progress updates of a running
+ * https download.
+ */
+#define PROGRESS_INTERVAL       ( 5U )
+
 /**
  * @brief Parent directory to contain download directories and files.
  */
-#define DESTINATION_PREFIX      "/tmp"
+#ifndef DESTINATION_PREFIX
+    #define DESTINATION_PREFIX    "/tmp"
+#endif
+
+/**
+ * @brief Root CA certificate of the servers of https download URLs
+ * (the dlcafile command line argument overrides it).
+ *
+ * Amazon Root CA 1 is the root of Amazon S3 presigned URLs.
+ */
+#define DOWNLOAD_ROOT_CA_PATH    "/etc/ssl/certs/Amazon_Root_CA_1.pem"
 
 /**
- * @brief How to invoke the download program, i.e., curl.
+ * @brief How to invoke the download program, i.e., curl, for URLs
+ * other than https, which are downloaded in the demo process.
  *
  * As written, this curl command limits the download rate
  * to 10 KB per second.  The slow rate provides an opportunity
  * to observe updates, and test job cancellation.
  */
-#define CURL( url ) \
-    execl( "/usr/bin/curl", "curl", "-OLsSN", "--limit-rate", "10k", url, NULL )
+#ifndef CURL
+    #define CURL( url ) \
+        execl( "/usr/bin/curl", "curl", "-OLsSN", "--limit-rate", "10k", url, NULL )
+#endif
 
 #endif /* ifndef DEMO_CONFIG_H */
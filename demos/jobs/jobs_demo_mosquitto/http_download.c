@@ -0,0 +1,1043 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file http_download.c
+ * @brief Download files over HTTPS in the demo process, with coreHTTP and
+ * the OpenSSL transport.
+ */
+
+/* C standard includes. */
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* POSIX includes. */
+#include <fcntl.h>
+#include <poll.h>
+#include <strings.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <err.h>
+
+/* HTTP API header. */
+#include "core_http_client.h"
+
+/* OpenSSL transport header. */
+#include "openssl_posix.h"
+
+/* Clock for the timeouts of the HTTP library. */
+#include "clock.h"
+
+#include "http_download.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Port of an https URL without one.
+ */
+#define DEFAULT_HTTPS_PORT    ( 443U )
+
+/**
+ * @brief HTTP status codes of the responses to a range request.
+ */
+#define HTTP_STATUS_OK                       ( 200U )
+#define HTTP_STATUS_PARTIAL_CONTENT          ( 206U )
+#define HTTP_STATUS_RANGE_NOT_SATISFIABLE    ( 416U )
+
+/**
+ * @brief File name of a URL with an empty last path segment.
+ */
+#define DEFAULT_FILE_NAME    "download"
+
+/**
+ * @brief Log an informational message.
+ */
+#define info    warnx
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Definition of the network context for the OpenSSL transport.
+ */
+struct NetworkContext
+{
+    OpensslParams_t * pParams;
+};
+
+/**
+ * @brief A connection to a download server.
+ */
+struct connection
+{
+    char * host;
+    uint16_t port;
+    OpensslParams_t params;
+    NetworkContext_t context;
+    TransportInterface_t transport;
+};
+
+/**
+ * @brief The outcomes of a range request.
+ */
+typedef enum
+{
+    RangeNext = 0, /* the range was written, more of the file remains */
+    RangeLast,     /* the range was written, the file is complete */
+    RangeRetry,    /* the connection broke; request the range again */
+    RangeFailed,   /* the download cannot continue */
+} rangeResult_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Find the host, port and path of an https URL.
+ *
+ * @param[in] url the URL
+ * @param[in] urlLength length of the URL
+ * @param[out] host start of the host name
+ * @param[out] hostLength length of the host name
+ * @param[out] port the port number
+ * @param[out] path start of the path and query, or NULL if the URL has none
+ * @param[out] pathLength length of the path and query, without a fragment
+ *
+ * @return true if the URL is supported;
+ * false otherwise
+ */
+static bool parseUrl( const char * url,
+                      size_t urlLength,
+                      const char ** host,
+                      size_t * hostLength,
+                      uint16_t * port,
+                      const char ** path,
+                      size_t * pathLength );
+
+/**
+ * @brief Open a connection to a download server.
+ *
+ * @param[in] d the downloader
+ * @param[in] host the host name
+ * @param[in] port the port number
+ *
+ * @return the connection;
+ * NULL if the server could not be reached
+ */
+static struct connection * openConnection( downloader_t * d,
+                                           const char * host,
+                                           uint16_t port );
+
+/**
+ * @brief Close a connection and free it.
+ *
+ * @param[in] c the connection
+ */
+static void closeConnection( struct connection * c );
+
+/**
+ * @brief Take an idle connection to the host of a download, or open one.
+ *
+ * @param[in] t the download
+ *
+ * @return the connection;
+ * NULL if the server could not be reached
+ */
+static struct connection * takeConnection( download_t * t );
+
+/**
+ * @brief Return the connection of a download to the idle connections, or
+ * close it.
+ *
+ * @param[in] t the download
+ * @param[in] c the connection
+ * @param[in] reuse whether the connection can serve another request
+ */
+static void releaseConnection( download_t * t,
+                               struct connection * c,
+                               bool reuse );
+
+/**
+ * @brief Read the Content-Range header of a response.
+ *
+ * @param[in] response the response
+ * @param[out] first offset of the first byte of the body
+ * @param[out] last offset of the last byte of the body
+ * @param[out] total size of the file
+ *
+ * @return true if the header is present with a known size;
+ * first and last are 0 for an unsatisfied range
+ */
+static bool readContentRange( const HTTPResponse_t * response,
+                              size_t * first,
+                              size_t * last,
+                              size_t * total );
+
+/**
+ * @brief Write a buffer at an offset of a file.
+ *
+ * @param[in] fd the file
+ * @param[in] data the buffer
+ * @param[in] length length of the buffer
+ * @param[in] offset where in the file to write
+ *
+ * @return true if the whole buffer was written;
+ * false otherwise
+ */
+static bool writeAt( int fd,
+                     const uint8_t * data,
+                     size_t length,
+                     size_t offset );
+
+/**
+ * @brief Request the next range of a file and write it.
+ *
+ * @param[in] t the download
+ * @param[in] c the connection to request it on
+ * @param[in] buffer buffer for the request and the response
+ * @param[in] fd the file
+ * @param[in,out] offset bytes of the file written so far
+ * @param[in,out] total size of the file, or 0 if not yet known
+ * @param[out] keepAlive whether the connection can serve another request
+ *
+ * @return the outcome of the request
+ */
+static rangeResult_t requestRange( download_t * t,
+                                   struct connection * c,
+                                   uint8_t * buffer,
+                                   int fd,
+                                   size_t * offset,
+                                   size_t * total,
+                                   bool * keepAlive );
+
+/**
+ * @brief The thread of a download.
+ *
+ * @param[in] p the download
+ *
+ * @return NULL
+ */
+static void * downloadThread( void * p );
+
+/*-----------------------------------------------------------*/
+
+static bool parseUrl( const char * url,
+                      size_t urlLength,
+                      const char ** host,
+                      size_t * hostLength,
+                      uint16_t * port,
+                      const char ** path,
+                      size_t * pathLength )
+{
+    bool ret = true;
+    size_t i, start = sizeof( "https://" ) - 1U, end;
+    unsigned long x = DEFAULT_HTTPS_PORT;
+
+    assert( url != NULL );
+
+    if( ( urlLength <= start ) || ( strncasecmp( url, "https://", start ) != 0 ) )
+    {
+        ret = false;
+    }
+
+    for( end = start; ( ret == true ) && ( end < urlLength ); end++ )
+    {
+        if( ( url[ end ] == '/' ) || ( url[ end ] == '?' ) || ( url[ end ] == '#' ) )
+        {
+            break;
+        }
+
+        /* user information and IPv6 addresses are left to other clients */
+        if( ( url[ end ] == '@' ) || ( url[ end ] == '[' ) || ( url[ end ] == '\0' ) )
+        {
+            ret = false;
+        }
+    }
+
+    if( ret == true )
+    {
+        *host = &url[ start ];
+        *hostLength = end - start;
+
+        for( i = start; i < end; i++ )
+        {
+            if( url[ i ] == ':' )
+            {
+                char * digitsEnd = NULL;
+                char digits[ sizeof( "65535" ) ] = { 0 };
+
+                *hostLength = i - start;
+
+                if( ( end - i - 1U ) < sizeof( digits ) )
+                {
+                    memcpy( digits, &url[ i + 1U ], end - i - 1U );
+                    x = strtoul( digits, &digitsEnd, 10 );
+                }
+
+                if( ( digitsEnd == NULL ) || ( digitsEnd == digits ) || ( *digitsEnd != '\0' ) ||
+                    ( x == 0 ) || ( x > 0xFFFFUL ) )
+                {
+                    ret = false;
+                }
+
+                break;
+            }
+        }
+
+        *port = ( uint16_t ) x;
+
+        if( *hostLength == 0 )
+        {
+            ret = false;
+        }
+    }
+
+    if( ret == true )
+    {
+        /* the fragment is not sent */
+        for( i = end; ( i < urlLength ) && ( url[ i ] != '#' ); i++ )
+        {
+        }
+
+        *path = ( i > end ) ? &url[ end ] : NULL;
+        *pathLength = i - end;
+    }
+
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+static struct connection * openConnection( downloader_t * d,
+                                           const char * host,
+                                           uint16_t port )
+{
+    struct connection * c;
+    OpensslCredentials_t credentials = { 0 };
+    ServerInfo_t server = { 0 };
+    OpensslStatus_t ret = OPENSSL_INSUFFICIENT_MEMORY;
+
+    assert( d != NULL );
+    assert( host != NULL );
+
+    c = calloc( 1, sizeof( *c ) );
+
+    if( c != NULL )
+    {
+        c->host = strdup( host );
+        c->port = port;
+        /* calloc leaves 0, which is a valid descriptor */
+        c->params.socketDescriptor = -1;
+        c->context.pParams = &c->params;
+    }
+
+    if( ( c != NULL ) && ( c->host != NULL ) )
+    {
+        server.pHostName = c->host;
+        server.hostNameLength = strlen( c->host );
+        server.port = port;
+
+        credentials.sniHostName = c->host;
+        credentials.pRootCaPath = d->cafile;
+        /* connections to a host after the first skip the full handshake */
+        credentials.enableSessionResumption = 1U;
+
+        ret = Openssl_Connect( &c->context,
+                               &server,
+                               &credentials,
+                               DOWNLOAD_TIMEOUT_MS,
+                               DOWNLOAD_TIMEOUT_MS );
+    }
+
+    if( ret == OPENSSL_SUCCESS )
+    {
+        c->transport.pNetworkContext = &c->context;
+        c->transport.send = Openssl_Send;
+        c->transport.recv = Openssl_Recv;
+    }
+    else
+    {
+        warnx( "cannot connect to %s port %u", host, ( unsigned int ) port );
+
+        if( c != NULL )
+        {
+            /* a failed TLS handshake leaves the TCP connection open */
+            if( c->params.socketDescriptor >= 0 )
+            {
+                ( void ) Openssl_Disconnect( &c->context );
+            }
+
+            free( c->host );
+            free( c );
+            c = NULL;
+        }
+    }
+
+    return c;
+}
+
+/*-----------------------------------------------------------*/
+
+static void closeConnection( struct connection * c )
+{
+    assert( c != NULL );
+
+    ( void ) Openssl_Disconnect( &c->context );
+    free( c->host );
+    free( c );
+}
+
+/*-----------------------------------------------------------*/
+
+static struct connection * takeConnection( download_t * t )
+{
+    downloader_t * d;
+    struct connection * c = NULL;
+    struct pollfd fds = { 0 };
+    size_t i;
+
+    assert( ( t != NULL ) && ( t->d != NULL ) );
+
+    d = t->d;
+
+    ( void ) pthread_mutex_lock( &d->lock );
+
+    /* the most recently used connection to the host */
+    for( i = d->idleCount; ( c == NULL ) && ( i > 0 ); i-- )
+    {
+        if( ( d->idle[ i - 1 ]->port == t->port ) &&
+            ( strcasecmp( d->idle[ i - 1 ]->host, t->host ) == 0 ) )
+        {
+            c = d->idle[ i - 1 ];
+            memmove( &d->idle[ i - 1 ], &d->idle[ i ], ( d->idleCount - i ) * sizeof( d->idle[ 0 ] ) );
+            d->idleCount--;
+        }
+    }
+
+    ( void ) pthread_mutex_unlock( &d->lock );
+
+    if( c != NULL )
+    {
+        /* an idle connection has nothing to read, unless the server closed it */
+        fds.fd = c->params.socketDescriptor;
+        fds.events = POLLIN;
+
+        if( poll( &fds, 1, 0 ) != 0 )
+        {
+            closeConnection( c );
+            c = NULL;
+        }
+    }
+
+    if( c == NULL )
+    {
+        c = openConnection( d, t->host, t->port );
+    }
+
+    ( void ) pthread_mutex_lock( &d->lock );
+    t->connection = c;
+    ( void ) pthread_mutex_unlock( &d->lock );
+
+    return c;
+}
+
+/*-----------------------------------------------------------*/
+
+static void releaseConnection( download_t * t,
+                               struct connection * c,
+                               bool reuse )
+{
+    downloader_t * d;
+    struct connection * evicted = NULL;
+
+    assert( ( t != NULL ) && ( t->d != NULL ) );
+    assert( c != NULL );
+
+    d = t->d;
+
+    ( void ) pthread_mutex_lock( &d->lock );
+
+    t->connection = NULL;
+
+    /* a canceled download may have had its connection shut down */
+    if( ( reuse == true ) && ( t->cancel == false ) )
+    {
+        if( d->idleCount == DOWNLOAD_MAX_IDLE_CONNECTIONS )
+        {
+            evicted = d->idle[ 0 ];
+            memmove( &d->idle[ 0 ], &d->idle[ 1 ], ( d->idleCount - 1U ) * sizeof( d->idle[ 0 ] ) );
+            d->idleCount--;
+        }
+
+        d->idle[ d->idleCount ] = c;
+        d->idleCount++;
+        c = NULL;
+    }
+
+    ( void ) pthread_mutex_unlock( &d->lock );
+
+    if( c != NULL )
+    {
+        closeConnection( c );
+    }
+
+    if( evicted != NULL )
+    {
+        closeConnection( evicted );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static bool readContentRange( const HTTPResponse_t * response,
+                              size_t * first,
+                              size_t * last,
+                              size_t * total )
+{
+    bool ret = false;
+    HTTPStatus_t http_ret;
+    const char * value = NULL;
+    size_t valueLength = 0;
+    char copy[ sizeof( "bytes 18446744073709551615-18446744073709551615/18446744073709551615" ) ];
+    unsigned long long a = 0, b = 0, n = 0;
+
+    assert( response != NULL );
+
+    http_ret = HTTPClient_ReadHeader( response,
+                                      "Content-Range",
+                                      sizeof( "Content-Range" ) - 1U,
+                                      &value,
+                                      &valueLength );
+
+    if( ( http_ret == HTTPSuccess ) && ( valueLength < sizeof( copy ) ) )
+    {
+        memcpy( copy, value, valueLength );
+        copy[ valueLength ] = '\0';
+
+        /* "bytes first-last/total", without first and last for an
+         * unsatisfied range; an unknown total is not accepted */
+        if( ( sscanf( copy, "bytes %llu-%llu/%llu", &a, &b, &n ) == 3 ) ||
+            ( sscanf( copy, "bytes */%llu", &n ) == 1 ) )
+        {
+            *first = ( size_t ) a;
+            *last = ( size_t ) b;
+            *total = ( size_t ) n;
+            ret = true;
+        }
+    }
+
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool writeAt( int fd,
+                     const uint8_t * data,
+                     size_t length,
+                     size_t offset )
+{
+    bool ret = true;
+    size_t written = 0;
+    ssize_t result;
+
+    while( ( ret == true ) && ( written < length ) )
+    {
+        result = pwrite( fd, &data[ written ], length - written, ( off_t ) ( offset + written ) );
+
+        if( result > 0 )
+        {
+            written += ( size_t ) result;
+        }
+        else if( ( result == -1 ) && ( errno == EINTR ) )
+        {
+            /* nothing written; try again */
+        }
+        else
+        {
+            warn( "write" );
+            ret = false;
+        }
+    }
+
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+static rangeResult_t requestRange( download_t * t,
+                                   struct connection * c,
+                                   uint8_t * buffer,
+                                   int fd,
+                                   size_t * offset,
+                                   size_t * total,
+                                   bool * keepAlive )
+{
+    rangeResult_t ret = RangeFailed;
+    HTTPStatus_t http_ret;
+    HTTPRequestInfo_t request = { 0 };
+    HTTPRequestHeaders_t headers = { 0 };
+    HTTPResponse_t response = { 0 };
+    char range[ sizeof( "bytes=18446744073709551615-18446744073709551615" ) ];
+    int rangeLength;
+    size_t first = 0, last = 0, size = 0;
+
+    assert( ( t != NULL ) && ( c != NULL ) );
+    assert( ( buffer != NULL ) && ( offset != NULL ) && ( total != NULL ) && ( keepAlive != NULL ) );
+
+    *keepAlive = false;
+
+    request.pMethod = HTTP_METHOD_GET;
+    request.methodLen = sizeof( HTTP_METHOD_GET ) - 1U;
+    request.pHost = t->host;
+    request.hostLen = strlen( t->host );
+    request.pPath = t->path;
+    request.pathLen = strlen( t->path );
+    request.reqFlags = HTTP_REQUEST_KEEP_ALIVE_FLAG;
+
+    /* the request is sent before the response is received into the same
+     * buffer */
+    headers.pBuffer = buffer;
+    headers.bufferLen = DOWNLOAD_HEADER_LENGTH + DOWNLOAD_RANGE_LENGTH;
+
+    http_ret = HTTPClient_InitializeRequestHeaders( &headers, &request );
+
+    /* HTTPClient_AddRangeHeader() takes 32-bit offsets */
+    if( http_ret == HTTPSuccess )
+    {
+        rangeLength = snprintf( range, sizeof( range ), "bytes=%zu-%zu",
+                                *offset, *offset + DOWNLOAD_RANGE_LENGTH - 1U );
+        http_ret = HTTPClient_AddHeader( &headers,
+                                         "Range",
+                                         sizeof( "Range" ) - 1U,
+                                         range,
+                                         ( size_t ) rangeLength );
+    }
+
+    if( http_ret != HTTPSuccess )
+    {
+        warnx( "cannot request %s: %s", t->path, HTTPClient_strerror( http_ret ) );
+    }
+    else
+    {
+        response.pBuffer = buffer;
+        response.bufferLen = DOWNLOAD_HEADER_LENGTH + DOWNLOAD_RANGE_LENGTH;
+        response.getTime = Clock_GetTimeMs;
+
+        http_ret = HTTPClient_Send( &c->transport, &headers, NULL, 0, &response, 0 );
+
+        if( http_ret == HTTPInsufficientMemory )
+        {
+            /* a server that ignores the range sends the whole file */
+            warnx( "response too large, %s does not send ranges", t->host );
+        }
+        else if( http_ret != HTTPSuccess )
+        {
+            warnx( "download interrupted: %s", HTTPClient_strerror( http_ret ) );
+            ret = RangeRetry;
+        }
+        else
+        {
+            *keepAlive = ( ( response.respFlags & HTTP_RESPONSE_CONNECTION_CLOSE_FLAG ) == 0U ) ? true : false;
+        }
+    }
+
+    if( ( http_ret == HTTPSuccess ) && ( response.statusCode == HTTP_STATUS_PARTIAL_CONTENT ) )
+    {
+        if( ( readContentRange( &response, &first, &last, &size ) == false ) ||
+            ( first != *offset ) || ( last >= size ) ||
+            ( response.bodyLen != ( last - first + 1U ) ) )
+        {
+            warnx( "unexpected range from %s", t->host );
+        }
+        else if( writeAt( fd, response.pBody, response.bodyLen, *offset ) == true )
+        {
+            *offset += response.bodyLen;
+            *total = size;
+            ret = ( *offset == size ) ? RangeLast : RangeNext;
+        }
+    }
+    else if( ( http_ret == HTTPSuccess ) && ( response.statusCode == HTTP_STATUS_OK ) )
+    {
+        /* the server ignored the range; the whole file fit in the buffer */
+        if( ( writeAt( fd, response.pBody, response.bodyLen, 0 ) == true ) &&
+            ( ftruncate( fd, ( off_t ) response.bodyLen ) == 0 ) )
+        {
+            *offset = response.bodyLen;
+            *total = response.bodyLen;
+            ret = RangeLast;
+        }
+    }
+    else if( ( http_ret == HTTPSuccess ) && ( response.statusCode == HTTP_STATUS_RANGE_NOT_SATISFIABLE ) )
+    {
+        /* a file left complete by an earlier run, or an empty file */
+        if( ( readContentRange( &response, &first, &last, &size ) == true ) && ( size == *offset ) )
+        {
+            *total = size;
+            ret = RangeLast;
+        }
+        else
+        {
+            warnx( "file on %s is shorter than the %zu bytes downloaded", t->host, *offset );
+        }
+    }
+    else if( http_ret == HTTPSuccess )
+    {
+        warnx( "HTTP status %u from %s", ( unsigned int ) response.statusCode, t->host );
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+static void * downloadThread( void * p )
+{
+    download_t * t = p;
+    downloader_t * d;
+    struct connection * c = NULL;
+    uint8_t * buffer;
+    struct stat s;
+    size_t offset = 0, total = 0;
+    uint32_t failures = 0;
+    uint64_t one = 1;
+    rangeResult_t result = RangeNext;
+    bool keepAlive = false, cancel = false;
+    int fd;
+
+    assert( ( t != NULL ) && ( t->d != NULL ) );
+
+    d = t->d;
+
+    buffer = malloc( DOWNLOAD_HEADER_LENGTH + DOWNLOAD_RANGE_LENGTH );
+    fd = open( t->fileName, O_WRONLY | O_CREAT | O_CLOEXEC, 0644 );
+
+    if( ( fd == -1 ) || ( fstat( fd, &s ) == -1 ) )
+    {
+        warn( "cannot open %s", t->fileName );
+        result = RangeFailed;
+    }
+    else if( buffer == NULL )
+    {
+        warnx( "out of memory" );
+        result = RangeFailed;
+    }
+    else if( s.st_size > 0 )
+    {
+        /* resume the download of an earlier run */
+        offset = ( size_t ) s.st_size;
+        info( "resuming at byte %zu: %s", offset, t->fileName );
+    }
+    else
+    {
+        info( "download file: %s", t->fileName );
+    }
+
+    while( ( result == RangeNext ) || ( result == RangeRetry ) )
+    {
+        ( void ) pthread_mutex_lock( &d->lock );
+        t->received = offset;
+        t->total = total;
+        cancel = t->cancel;
+        ( void ) pthread_mutex_unlock( &d->lock );
+
+        if( cancel == true )
+        {
+            result = RangeFailed;
+            break;
+        }
+
+        if( c == NULL )
+        {
+            c = takeConnection( t );
+        }
+
+        if( c == NULL )
+        {
+            result = RangeFailed;
+            break;
+        }
+
+        result = requestRange( t, c, buffer, fd, &offset, &total, &keepAlive );
+
+        if( result == RangeRetry )
+        {
+            /* a kept-alive connection may have been closed by the server
+             * while idle; open another one */
+            failures++;
+
+            if( failures > DOWNLOAD_MAX_RETRIES )
+            {
+                result = RangeFailed;
+            }
+        }
+        else
+        {
+            failures = 0;
+        }
+
+        if( keepAlive == false )
+        {
+            releaseConnection( t, c, false );
+            c = NULL;
+        }
+    }
+
+    if( c != NULL )
+    {
+        /* the last response was read in full, so the connection can serve
+         * the next download from the host */
+        releaseConnection( t, c, true );
+    }
+
+    if( fd != -1 )
+    {
+        ( void ) close( fd );
+    }
+
+    free( buffer );
+
+    ( void ) pthread_mutex_lock( &d->lock );
+    t->received = offset;
+    t->total = total;
+    t->status = ( result == RangeLast ) ? DownloadSucceeded : DownloadFailed;
+    ( void ) pthread_mutex_unlock( &d->lock );
+
+    /* wake up the thread polling the downloads */
+    if( write( d->eventfd, &one, sizeof( one ) ) != sizeof( one ) )
+    {
+        warn( "eventfd" );
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+bool downloaderInit( downloader_t * d,
+                     const char * cafile )
+{
+    bool ret = true;
+    downloader_t empty = { 0 };
+
+    assert( d != NULL );
+    assert( cafile != NULL );
+
+    *d = empty;
+    d->cafile = cafile;
+    ( void ) pthread_mutex_init( &d->lock, NULL );
+
+    d->eventfd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+
+    if( d->eventfd == -1 )
+    {
+        warn( "eventfd" );
+        ret = false;
+    }
+
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+void downloaderCleanup( downloader_t * d )
+{
+    size_t i;
+
+    assert( d != NULL );
+
+    for( i = 0; i < d->idleCount; i++ )
+    {
+        closeConnection( d->idle[ i ] );
+    }
+
+    d->idleCount = 0;
+
+    if( d->eventfd != -1 )
+    {
+        ( void ) close( d->eventfd );
+        d->eventfd = -1;
+    }
+
+    ( void ) pthread_mutex_destroy( &d->lock );
+}
+
+/*-----------------------------------------------------------*/
+
+void downloaderClearEvents( downloader_t * d )
+{
+    uint64_t count;
+
+    assert( d != NULL );
+
+    ( void ) read( d->eventfd, &count, sizeof( count ) );
+}
+
+/*-----------------------------------------------------------*/
+
+bool downloadSupported( const char * url,
+                        size_t urlLength )
+{
+    const char * host, * path;
+    size_t hostLength, pathLength;
+    uint16_t port;
+
+    return parseUrl( url, urlLength, &host, &hostLength, &port, &path, &pathLength );
+}
+
+/*-----------------------------------------------------------*/
+
+bool downloadStart( downloader_t * d,
+                    download_t * t,
+                    const char * url,
+                    size_t urlLength,
+                    const char * directory )
+{
+    bool ret;
+    download_t empty = { 0 };
+    const char * host = NULL, * path = NULL, * name, * nameEnd;
+    size_t hostLength = 0, pathLength = 0, nameLength, fileNameLength;
+    uint16_t port = 0;
+
+    assert( d != NULL );
+    assert( t != NULL );
+    assert( url != NULL );
+    assert( directory != NULL );
+
+    *t = empty;
+
+    ret = parseUrl( url, urlLength, &host, &hostLength, &port, &path, &pathLength );
+
+    if( ret == true )
+    {
+        t->host = strndup( host, hostLength );
+        t->port = port;
+
+        /* the path of the request starts with a slash */
+        t->path = malloc( pathLength + 2U );
+        assert( ( t->host != NULL ) && ( t->path != NULL ) );
+
+        snprintf( t->path, pathLength + 2U, "%s%.*s",
+                  ( ( path != NULL ) && ( path[ 0 ] == '/' ) ) ? "" : "/",
+                  ( int ) pathLength, ( path != NULL ) ? path : "" );
+
+        /* the file is named after the last segment of the path */
+        name = strrchr( t->path, '/' ) + 1;
+        nameEnd = strchr( name, '?' );
+        nameLength = ( nameEnd != NULL ) ? ( size_t ) ( nameEnd - name ) : strlen( name );
+
+        if( ( nameLength == 0 ) ||
+            ( ( nameLength == 1 ) && ( name[ 0 ] == '.' ) ) ||
+            ( ( nameLength == 2 ) && ( strncmp( name, "..", 2 ) == 0 ) ) )
+        {
+            name = DEFAULT_FILE_NAME;
+            nameLength = sizeof( DEFAULT_FILE_NAME ) - 1U;
+        }
+
+        fileNameLength = strlen( directory ) + nameLength + 2U;
+        t->fileName = malloc( fileNameLength );
+        assert( t->fileName != NULL );
+
+        snprintf( t->fileName, fileNameLength, "%s/%.*s", directory, ( int ) nameLength, name );
+    }
+
+    if( ret == true )
+    {
+        t->d = d;
+        t->status = DownloadRunning;
+
+        if( pthread_create( &t->thread, NULL, downloadThread, t ) != 0 )
+        {
+            warnx( "cannot start download thread" );
+            t->d = NULL;
+            ret = false;
+        }
+    }
+
+    if( ret == false )
+    {
+        free( t->host );
+        free( t->path );
+        free( t->fileName );
+        *t = empty;
+    }
+
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+downloadStatus_t downloadProgress( download_t * t,
+                                   size_t * received,
+                                   size_t * total )
+{
+    downloadStatus_t ret;
+
+    assert( ( t != NULL ) && ( t->d != NULL ) );
+    assert( ( received != NULL ) && ( total != NULL ) );
+
+    ( void ) pthread_mutex_lock( &t->d->lock );
+    ret = t->status;
+    *received = t->received;
+    *total = t->total;
+    ( void ) pthread_mutex_unlock( &t->d->lock );
+
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+void downloadStop( download_t * t )
+{
+    download_t empty = { 0 };
+
+    assert( t != NULL );
+
+    if( t->d != NULL )
+    {
+        ( void ) pthread_mutex_lock( &t->d->lock );
+
+        t->cancel = true;
+
+        /* end a receive in progress now, rather than after the range */
+        if( t->connection != NULL )
+        {
+            ( void ) shutdown( t->connection->params.socketDescriptor, SHUT_RDWR );
+        }
+
+        ( void ) pthread_mutex_unlock( &t->d->lock );
+
+        ( void ) pthread_join( t->thread, NULL );
+
+        free( t->host );
+        free( t->path );
+        free( t->fileName );
+    }
+
+    *t = empty;
+}
@@ -0,0 +1,212 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file http_download.h
+ * @brief Download files over HTTPS in the demo process, with coreHTTP and
+ * the OpenSSL transport.
+ */
+
+#ifndef HTTP_DOWNLOAD_H_
+#define HTTP_DOWNLOAD_H_
+
+/* C standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* POSIX includes. */
+#include <pthread.h>
+
+/**
+ * @brief Number of bytes requested at a time. Each range is written to the
+ * file, and counted as progress, once it is received.
+ */
+#ifndef DOWNLOAD_RANGE_LENGTH
+    #define DOWNLOAD_RANGE_LENGTH    ( 256U * 1024U )
+#endif
+
+/**
+ * @brief Room for the response headers in the buffer of a download.
+ */
+#ifndef DOWNLOAD_HEADER_LENGTH
+    #define DOWNLOAD_HEADER_LENGTH    ( 4096U )
+#endif
+
+/**
+ * @brief Most idle connections kept open for later downloads.
+ */
+#ifndef DOWNLOAD_MAX_IDLE_CONNECTIONS
+    #define DOWNLOAD_MAX_IDLE_CONNECTIONS    ( 8U )
+#endif
+
+/**
+ * @brief Send and receive timeout in milliseconds of a connection.
+ */
+#ifndef DOWNLOAD_TIMEOUT_MS
+    #define DOWNLOAD_TIMEOUT_MS    ( 5000U )
+#endif
+
+/**
+ * @brief Times in a row a range may fail on a broken connection before the
+ * download is abandoned.
+ */
+#ifndef DOWNLOAD_MAX_RETRIES
+    #define DOWNLOAD_MAX_RETRIES    ( 3U )
+#endif
+
+/**
+ * @brief The states of a download.
+ */
+typedef enum
+{
+    DownloadRunning = 0, /* the download thread is running */
+    DownloadSucceeded,   /* the whole file was written */
+    DownloadFailed,      /* the download failed or was canceled */
+} downloadStatus_t;
+
+/**
+ * @brief Connections shared by the downloads.
+ */
+typedef struct
+{
+    pthread_mutex_t lock;
+    /* trusted root CA of the download servers */
+    const char * cafile;
+    /* idle keep-alive connections, least recently used first */
+    struct connection * idle[ DOWNLOAD_MAX_IDLE_CONNECTIONS ];
+    size_t idleCount;
+    /* readable when a download has ended */
+    int eventfd;
+} downloader_t;
+
+/**
+ * @brief One download.
+ */
+typedef struct
+{
+    downloader_t * d;
+    pthread_t thread;
+    /* parsed from the URL */
+    char * host;
+    uint16_t port;
+    char * path;
+    /* destination file */
+    char * fileName;
+    /* shared with the download thread, protected by d->lock */
+    struct connection * connection;
+    size_t received;
+    size_t total; /* 0 until the size of the file is known */
+    downloadStatus_t status;
+    bool cancel;
+} download_t;
+
+/**
+ * @brief Set up the connections shared by downloads.
+ *
+ * @param[out] d the downloader
+ * @param[in] cafile trusted root CA of the download servers, in PEM format
+ *
+ * @return true on success;
+ * false if the event descriptor could not be created
+ */
+bool downloaderInit( downloader_t * d,
+                     const char * cafile );
+
+/**
+ * @brief Close the idle connections and release the downloader.
+ *
+ * @param[in] d the downloader, with no download running
+ */
+void downloaderCleanup( downloader_t * d );
+
+/**
+ * @brief Empty the event descriptor of a downloader, after it was
+ * readable. Then check the downloads with downloadProgress().
+ *
+ * @param[in] d the downloader
+ */
+void downloaderClearEvents( downloader_t * d );
+
+/**
+ * @brief Check whether a URL can be downloaded by downloadStart().
+ *
+ * @param[in] url the URL
+ * @param[in] urlLength length of the URL
+ *
+ * @return true for an https URL with a host name;
+ * false otherwise
+ */
+bool downloadSupported( const char * url,
+                        size_t urlLength );
+
+/**
+ * @brief Start downloading a URL into a directory, on a thread of its own.
+ *
+ * The file is named after the last segment of the URL path, as with
+ * curl -O. If it already exists, the download resumes at its end, so a job
+ * started again after a restart only fetches the missing bytes. The body is
+ * requested in ranges of #DOWNLOAD_RANGE_LENGTH bytes over a keep-alive
+ * connection, taken from the idle connections to the same host when there
+ * is one. The event descriptor of the downloader becomes readable when the
+ * download ends.
+ *
+ * @param[in] d the downloader
+ * @param[out] t the download
+ * @param[in] url the URL, accepted by downloadSupported()
+ * @param[in] urlLength length of the URL
+ * @param[in] directory existing directory to write the file in
+ *
+ * @return true if the download thread was started;
+ * false otherwise
+ */
+bool downloadStart( downloader_t * d,
+                    download_t * t,
+                    const char * url,
+                    size_t urlLength,
+                    const char * directory );
+
+/**
+ * @brief Read the progress of a download.
+ *
+ * @param[in] t the download
+ * @param[out] received bytes of the file written so far
+ * @param[out] total size of the file, or 0 if not yet known
+ *
+ * @return the state of the download
+ */
+downloadStatus_t downloadProgress( download_t * t,
+                                   size_t * received,
+                                   size_t * total );
+
+/**
+ * @brief Cancel a download if it is running, wait for its thread to end,
+ * and release it.
+ *
+ * A connection in use is shut down, so that the thread does not wait for
+ * the range it is receiving.
+ *
+ * @param[in] t the download
+ */
+void downloadStop( download_t * t );
+
+#endif /* ifndef HTTP_DOWNLOAD_H_ */
@@ -40,7 +40,9 @@
 #include <time.h>
 
 /* POSIX includes. */
+#include <poll.h>
 #include <signal.h>
+#include <sys/signalfd.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -55,8 +57,9 @@
 #endif
 
 #include "demo_config.h"
+#include "http_download.h"
 #include "jobs.h"
-#include "core_json.h"
+#include "json_index.h"
 
 /*-----------------------------------------------------------*/
 
@@ -74,6 +77,14 @@
  */
 #define DEFAULT_CA_DIRECTORY    "/etc/ssl/certs"
 
+/**
+ * @brief Number of values of a job document that can be indexed.
+ * (fields of larger documents are searched for with coreJSON)
+ */
+#ifndef JOB_DOCUMENT_INDEX_CAPACITY
+    #define JOB_DOCUMENT_INDEX_CAPACITY    ( 128U )
+#endif
+
 /**
  * @brief ALPN (Application-Layer Protocol Negotiation) name for AWS IoT MQTT.
  */
@@ -109,7 +120,7 @@ static void usage( const char * programName )
              "Client device1 received SUBACK\n"
              "[...]\n"
              "starting job id: t12\n"
-             "sending first update\n" );
+             "updating job id: t12\n" );
     fprintf( stderr,
              "\nIf the output does not show a successful connection, check in the AWS console\n"
              "that the client certificate is associated with the target thing and is activated.\n"
@@ -125,9 +136,9 @@ static void usage( const char * programName )
              );
     fprintf( stderr,
              "\nusage: %s "
-             "[-o] -n name -h host [-p port] {--cafile file | --capath dir} --certfile file --keyfile file [--pollinv seconds] [--updateinv seconds]\n"
+             "[-o] -n name -h host [-p port] {--cafile file | --capath dir} --certfile file --keyfile file [--dlcafile file] [--jobs count] [--pollinv seconds] [--updateinv seconds]\n"
              "\n"
-             "-o : run once, exit after the first job is finished.\n"
+             "-o : run once, start no more jobs after the first one is finished, and exit when none are running.\n"
              "-n : thing name\n"
              "-h : mqtt host to connect to.\n"
              "-p : network port to connect to. Defaults to %d.\n",
@@ -138,12 +149,17 @@ static void usage( const char * programName )
              "--capath    : path to a directory containing trusted CA certificates to enable encrypted\n"
              "              communication.  Defaults to %s.\n"
              "--certfile  : client certificate for authentication in PEM format.\n"
-             "--keyfile   : client private key for authentication in PEM format.\n",
-             DEFAULT_CA_DIRECTORY );
+             "--keyfile   : client private key for authentication in PEM format.\n"
+             "--dlcafile  : path to a file containing the root CA certificate of the servers of https\n"
+             "              download URLs.  Defaults to %s.\n",
+             DEFAULT_CA_DIRECTORY, DOWNLOAD_ROOT_CA_PATH );
     fprintf( stderr,
-             "--pollinv   : after this many idle seconds, request a job.\n"
+             "--jobs      : run up to this many jobs at the same time.  Defaults to %d.\n",
+             MAX_CONCURRENT_JOBS );
+    fprintf( stderr,
+             "--pollinv   : after this many seconds with fewer jobs running than allowed, request pending jobs.\n"
              "              Without this option and a positive value, no polling is done.\n"
-             "--updateinv : after this many seconds running a job, resend the current status to the jobs service.\n"
+             "--updateinv : after this many seconds running jobs, resend their current status to the jobs service.\n"
              "              Without this option and a positive value, status is not resent.\n\n"
              );
 }
@@ -151,16 +167,41 @@ static void usage( const char * programName )
 /*-----------------------------------------------------------*/
 
 /**
- * @brief The several states of execution.
+ * @brief The several states of a job execution.
  */
 typedef enum
 {
-    None = 0, /* no current job */
-    Ready,    /* job document received and parsed */
-    Running,  /* download in progress */
-    Cancel,   /* cancel due to failed update */
+    None = 0,   /* free execution, no job */
+    Describing, /* job document requested */
+    Ready,      /* job document received and parsed */
+    Running,    /* download in progress */
+    Exited,     /* download finished, final status not yet sent */
+    Reporting,  /* final status sent, waiting for the jobs service to accept it */
+    Cancel,     /* cancel due to failed update */
 } runStatus_t;
 
+/**
+ * @brief The state of one job execution.
+ */
+typedef struct
+{
+    runStatus_t runStatus;
+    /* job parameters received via MQTT */
+    char * jobid;
+    size_t jobidLength;
+    char * url;
+    size_t urlLength;
+    /* download thread, for an https URL */
+    download_t download;
+    size_t reported; /* bytes downloaded when the last status was sent */
+    /* download process, for other URLs */
+    pid_t child;
+    /* final status to send */
+    char * report;
+    /* the IN_PROGRESS status is sent with the next batch of updates */
+    bool updateDue;
+} job_t;
+
 /**
  * @brief All runtime parameters and state.
  */
@@ -176,8 +217,10 @@ typedef struct
     char * capath;
     char * certfile;
     char * keyfile;
+    char * dlcafile;    /* root CA of the servers of https download URLs */
     uint32_t pollinv;   /* 0 (default) disables polling for new jobs */
     uint32_t updateinv; /* 0 (default) disables periodic resending of status */
+    uint32_t maxJobs;   /* most job executions run at the same time */
     /* flags */
     bool runOnce;
     /* callback-populated values */
@@ -185,19 +228,18 @@ typedef struct
     int subscribeQOS;
     /* mosquitto library handle */
     struct mosquitto * m;
-    /* job parameters received via MQTT */
-    char * jobid;
-    size_t jobidLength;
-    char * url;
-    size_t urlLength;
+    /* job executions, the first maxJobs are used */
+    job_t jobs[ MAX_CONCURRENT_JOBS ];
     /* internal state tracking */
-    runStatus_t runStatus;
-    char * report;
+    int sigchldfd; /* readable when a download process exits */
+    downloader_t downloader;
     time_t lastPrompt;
     time_t lastUpdate;
+    time_t lastProgress;
     bool forcePrompt;
     bool forceUpdate;
-    pid_t child;
+    bool resumed;  /* jobs left in progress by an earlier run were requested */
+    bool finished; /* a job has finished */
 } handle_t;
 
 /*-----------------------------------------------------------*/
@@ -307,15 +349,74 @@ static bool sendUpdate( handle_t * h,
                         char * report );
 
 /**
- * @brief Read job ID and URL from a JSON job document.
+ * @brief Find the execution of a job ID.
+ *
+ * @param[in] h runtime state handle
+ * @param[in] jobid the job ID
+ * @param[in] jobidLength size of the job ID string
+ *
+ * @return the execution of the job ID;
+ * NULL if the job ID is not being executed
+ */
+static job_t * findJob( handle_t * h,
+                        const char * jobid,
+                        size_t jobidLength );
+
+/**
+ * @brief Find a free execution.
+ *
+ * @param[in] h runtime state handle
+ *
+ * @return a free execution;
+ * NULL if maxJobs executions are in use
+ */
+static job_t * claimJob( handle_t * h );
+
+/**
+ * @brief Free an execution.
+ *
+ * @param[in] job the execution
+ */
+static void releaseJob( job_t * job );
+
+/**
+ * @brief Publish a request to the Jobs service to describe a job.
+ *
+ * @param[in] h runtime state handle
+ * @param[in] job the execution of the job
+ *
+ * @return true if libmosquitto accepted the publish message;
+ * false otherwise
+ */
+static bool sendDescribe( handle_t * h,
+                          job_t * job );
+
+/**
+ * @brief Request the documents of the jobs in a list of pending jobs,
+ * as long as executions are free.
+ *
+ * Jobs already in progress are only requested from the first list, to
+ * resume those left by an earlier run; later lists may still show jobs
+ * this run has just finished.
+ *
+ * @param[in] h runtime state handle
+ * @param[in] message an MQTT publish message
+ */
+static void parsePending( handle_t * h,
+                          const struct mosquitto_message * message );
+
+/**
+ * @brief Read the URL from a JSON job document.
  *
  * @param[in] h runtime state handle
+ * @param[in] job the execution of the job
  * @param[in] message an MQTT publish message
  *
- * @return true if values were found and copied to the handle;
+ * @return true if the URL was found and copied to the execution;
  * false otherwise
  */
 static bool parseJob( handle_t * h,
+                      job_t * job,
                       const struct mosquitto_message * message );
 
 /**
@@ -333,7 +434,7 @@ void on_message( struct mosquitto * m,
                  const struct mosquitto_message * message );
 
 /**
- * @brief Publish a request to the Jobs service to describe the next job.
+ * @brief Publish a request to the Jobs service to list the pending jobs.
  *
  * @param[in] h runtime state handle
  *
@@ -342,31 +443,94 @@ void on_message( struct mosquitto * m,
  *
  * @note This does not call mosquitto_loop(); it expects main() to do so.
  */
-static bool sendDescribeNext( handle_t * h );
+static bool sendGetPending( handle_t * h );
 
 /**
- * @brief Checks status of the download process.
+ * @brief Set the final status of a job whose download has ended.
  *
  * @param[in] h runtime state handle
+ * @param[in] job the execution of the job
+ * @param[in] succeeded whether the file was downloaded
  */
-static void checkChild( handle_t * h );
+static void finishJob( handle_t * h,
+                       job_t * job,
+                       bool succeeded );
 
 /**
- * @brief Launch a download process.
+ * @brief Collect the exit status of the download processes that exited.
  *
  * @param[in] h runtime state handle
+ */
+static void reapChildren( handle_t * h );
+
+/**
+ * @brief Collect the result of the download threads that ended.
  *
- * @return true if fork() succeeded;
+ * @param[in] h runtime state handle
+ */
+static void collectDownloads( handle_t * h );
+
+/**
+ * @brief Start a download thread in a directory named after the job.
+ *
+ * A job whose download cannot be started is failed.
+ *
+ * @param[in] h runtime state handle
+ * @param[in] job the execution of the job
+ */
+static void startDownloadThread( handle_t * h,
+                                 job_t * job );
+
+/**
+ * @brief Start a download thread for an https URL, or launch a download
+ * process for other URLs.
+ *
+ * @param[in] h runtime state handle
+ * @param[in] job the execution of the job
+ *
+ * @return false if fork() failed;
+ * true otherwise
+ */
+static bool download( handle_t * h,
+                      job_t * job );
+
+/**
+ * @brief Stop a download thread, or kill a download process.
+ *
+ * @param[in] job the execution of the job
+ */
+static void cancelDownload( job_t * job );
+
+/**
+ * @brief Send the status updates that are due, in one batch.
+ *
+ * The IN_PROGRESS status of every job started since the last batch, or of
+ * every running job when the update interval has passed or an update is
+ * forced, and the final status of every finished job are sent together.
+ * The IN_PROGRESS status of a download thread carries its byte count, and
+ * is also sent every PROGRESS_INTERVAL while the count grows.
+ *
+ * @param[in] h runtime state handle
+ * @param[in] now the current time
+ *
+ * @return true if libmosquitto accepted the publish messages;
  * false otherwise
+ *
+ * @note This does not call mosquitto_loop(); it expects main() to do so.
  */
-static bool download( handle_t * h );
+static bool sendUpdates( handle_t * h,
+                         time_t now );
 
 /**
- * @brief Kill a download process.
+ * @brief Wait for MQTT traffic or the end of a download, and process them.
  *
  * @param[in] h runtime state handle
+ * @param[in] timeout most milliseconds to wait
+ *
+ * @return MOSQ_ERR_SUCCESS, or the error from libmosquitto
  */
-static void cancelDownload( handle_t * h );
+static int serviceEvents( handle_t * h,
+                          int timeout );
 
 /**
  * @brief The libmosquitto callback for log messages.
@@ -419,6 +583,13 @@ static void teardown( int x,
  */
 #define makeReport_( x )    "{\"status\":\"" x "\"}"
 
+/**
+ * @brief Format of a JSON status message with the progress of a download,
+ * given the bytes downloaded and the size of the file (0 until known).
+ */
+#define progressFormat \
+    "{\"status\":\"IN_PROGRESS\",\"statusDetails\":{\"downloaded\":\"%zu\",\"size\":\"%zu\"}}"
+
 /*-----------------------------------------------------------*/
 
 void initHandle( handle_t * p )
@@ -449,6 +620,14 @@ void initHandle( handle_t * p )
 
     h.runOnce = false;
 
+    h.dlcafile = DOWNLOAD_ROOT_CA_PATH;
+
+    h.maxJobs = MAX_CONCURRENT_JOBS;
+
+    /* set by setup() */
+    h.sigchldfd = -1;
+    h.downloader.eventfd = -1;
+
     /* initialize to -1, set by on_connect() to 0 or greater */
     h.connectError = -1;
     /* initialize to -1, set by on_subscribe() to 0 or greater */
@@ -538,13 +717,15 @@ static bool parseArgs( handle_t * h,
             { "capath",    required_argument, NULL, 'd' },
             { "certfile",  required_argument, NULL, 'c' },
             { "keyfile",   required_argument, NULL, 'k' },
+            { "dlcafile",  required_argument, NULL, 'D' },
+            { "jobs",      required_argument, NULL, 'j' },
             { "pollinv",   required_argument, NULL, 'P' },
             { "updateinv", required_argument, NULL, 'u' },
             { "help",      no_argument,       NULL, '?' },
             { NULL,        0,                 NULL, 0   }
         };
 
-        c = getopt_long( argc, argv, "on:h:p:P:u:f:d:c:k:?",
+        c = getopt_long( argc, argv, "on:h:p:j:P:u:f:d:c:k:D:?",
                          long_options, &option_index );
 
         if( c == -1 )
@@ -584,6 +765,10 @@ static bool parseArgs( handle_t * h,
                 optargToInt( port, 0, 0xFFFF );
                 break;
 
+            case 'j':
+                optargToInt( maxJobs, 0, MAX_CONCURRENT_JOBS );
+                break;
+
             case 'P':
                 optargToInt( pollinv, 0, INTERVAL_MAX );
                 break;
@@ -609,6 +794,10 @@ static bool parseArgs( handle_t * h,
                 h->keyfile = optarg;
                 break;
 
+            case 'D':
+                h->dlcafile = optarg;
+                break;
+
             case '?':
             default:
                 ret = false;
@@ -825,63 +1014,260 @@ static bool sendUpdate( handle_t * h,
 
 /*-----------------------------------------------------------*/
 
-static bool parseJob( handle_t * h,
-                      const struct mosquitto_message * message )
+static job_t * findJob( handle_t * h,
+                        const char * jobid,
+                        size_t jobidLength )
 {
-    bool ret = false;
-    JSONStatus_t json_ret;
-    char * jobid = NULL, * url = NULL;
-    size_t jobidLength = 0, urlLength = 0;
+    job_t * ret = NULL;
+    size_t i;
+
+    assert( h != NULL );
+    assert( jobid != NULL );
+
+    for( i = 0; ( ret == NULL ) && ( i < h->maxJobs ); i++ )
+    {
+        if( ( h->jobs[ i ].runStatus != None ) &&
+            ( h->jobs[ i ].jobidLength == jobidLength ) &&
+            ( strncmp( h->jobs[ i ].jobid, jobid, jobidLength ) == 0 ) )
+        {
+            ret = &h->jobs[ i ];
+        }
+    }
+
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+static job_t * claimJob( handle_t * h )
+{
+    job_t * ret = NULL;
+    size_t i;
+
+    assert( h != NULL );
+
+    for( i = 0; ( ret == NULL ) && ( i < h->maxJobs ); i++ )
+    {
+        if( h->jobs[ i ].runStatus == None )
+        {
+            ret = &h->jobs[ i ];
+        }
+    }
+
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+static void releaseJob( job_t * job )
+{
+    job_t empty = { 0 };
+
+    assert( job != NULL );
+    assert( job->child == 0 );
+    assert( job->download.d == NULL );
+
+    free( job->jobid );
+    free( job->url );
+
+    *job = empty;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool sendDescribe( handle_t * h,
+                          job_t * job )
+{
+    bool ret = true;
+    JobsStatus_t jobs_ret;
+    int m_ret;
+    char topic[ JOBS_API_MAX_LENGTH( JOBS_THINGNAME_MAX_LENGTH ) ];
+
+    assert( h != NULL );
+    assert( ( job != NULL ) && ( job->jobid != NULL ) );
+
+    /* populate the topic buffer for a DescribeJobExecution request */
+    jobs_ret = Jobs_Describe( topic,
+                              sizeof( topic ),
+                              h->name,
+                              h->nameLength,
+                              job->jobid,
+                              job->jobidLength,
+                              NULL );
+
+    if( jobs_ret != JobsSuccess )
+    {
+        warnx( "invalid job id: %s", job->jobid );
+        ret = false;
+    }
+    else
+    {
+        m_ret = mosquitto_publish( h->m, NULL, topic, 0, NULL, MQTT_QOS, false );
+
+        if( m_ret != MOSQ_ERR_SUCCESS )
+        {
+            warnx( "sendDescribe: %s", mosquitto_strerror( m_ret ) );
+            ret = false;
+        }
+    }
+
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+static void parsePending( handle_t * h,
+                          const struct mosquitto_message * message )
+{
+    static const char * lists[] = { "inProgressJobs", "queuedJobs" };
+    char query[ sizeof( "inProgressJobs[4294967295].jobId" ) ];
+    JsonIndexStatus_t json_ret;
+    JsonIndex_t index;
+    JsonIndexEntry_t * entries;
+    uint16_t * slots;
+    uint16_t capacity;
+    const char * jobid;
+    size_t jobidLength, i;
+    unsigned int j;
+    int queryLength;
+    job_t * job = NULL;
+    bool more = true;
 
     assert( h != NULL );
     assert( message != NULL );
     assert( ( message->payload != NULL ) && ( message->payloadlen > 0 ) );
 
-    json_ret = JSON_Validate( message->payload, message->payloadlen );
+    /* The list grows with the number of queued jobs, so the index is sized
+     * from the payload to hold every value of the list. */
+    capacity = JSON_INDEX_CAPACITY_FOR_LENGTH( ( size_t ) message->payloadlen );
+    entries = malloc( capacity * sizeof( JsonIndexEntry_t ) );
+    slots = malloc( JSON_INDEX_SLOT_COUNT( ( size_t ) capacity ) * sizeof( uint16_t ) );
 
-    if( json_ret != JSONSuccess )
+    if( ( entries == NULL ) || ( slots == NULL ) )
     {
-        warnx( "invalid job document" );
+        warnx( "parsePending: out of memory" );
+        more = false;
     }
     else
     {
-        json_ret = JSON_Search( message->payload,
-                                message->payloadlen,
-                                "execution.jobId",
-                                ( sizeof( "execution.jobId" ) - 1 ),
-                                &jobid,
-                                &jobidLength );
+        json_ret = JsonIndex_Build( &index,
+                                    message->payload,
+                                    ( size_t ) message->payloadlen,
+                                    entries,
+                                    capacity,
+                                    slots );
+
+        if( json_ret != JsonIndexSuccess )
+        {
+            warnx( "invalid list of pending jobs" );
+            more = false;
+        }
     }
 
-    if( json_ret == JSONSuccess )
+    for( i = ( h->resumed == true ) ? 1 : 0; ( more == true ) && ( i < 2 ); i++ )
     {
-        json_ret = JSON_Search( message->payload,
-                                message->payloadlen,
-                                "execution.jobDocument.url",
-                                ( sizeof( "execution.jobDocument.url" ) - 1 ),
-                                &url,
-                                &urlLength );
+        for( j = 0; more == true; j++ )
+        {
+            queryLength = snprintf( query, sizeof( query ), "%s[%u].jobId", lists[ i ], j );
+            json_ret = JsonIndex_Find( &index,
+                                       query,
+                                       ( size_t ) queryLength,
+                                       &jobid,
+                                       &jobidLength,
+                                       NULL );
+
+            /* the end of this list */
+            if( json_ret != JsonIndexSuccess )
+            {
+                break;
+            }
+
+            if( ( jobidLength == 0 ) || ( findJob( h, jobid, jobidLength ) != NULL ) )
+            {
+                continue;
+            }
+
+            job = claimJob( h );
+
+            if( job == NULL )
+            {
+                /* all executions are in use */
+                more = false;
+            }
+            else
+            {
+                job->jobid = strndup( jobid, jobidLength );
+                assert( job->jobid != NULL );
+                job->jobidLength = jobidLength;
+                job->runStatus = Describing;
+
+                if( sendDescribe( h, job ) == false )
+                {
+                    releaseJob( job );
+                }
+            }
+        }
     }
 
-    if( json_ret == JSONSuccess )
+    free( entries );
+    free( slots );
+    h->resumed = true;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool parseJob( handle_t * h,
+                      job_t * job,
+                      const struct mosquitto_message * message )
+{
+    bool ret = false;
+    JsonIndexStatus_t json_ret;
+    JsonIndex_t index;
+    JsonIndexEntry_t entries[ JOB_DOCUMENT_INDEX_CAPACITY ];
+    uint16_t slots[ JSON_INDEX_SLOT_COUNT( JOB_DOCUMENT_INDEX_CAPACITY ) ];
+    const char * url = NULL;
+    size_t urlLength = 0;
+
+    assert( h != NULL );
+    assert( ( job != NULL ) && ( job->jobid != NULL ) );
+    assert( message != NULL );
+    assert( ( message->payload != NULL ) && ( message->payloadlen > 0 ) );
+
+    /* validate and index the document in one pass; the fields are then
+     * found without scanning it again */
+    json_ret = JsonIndex_Build( &index,
+                                message->payload,
+                                ( size_t ) message->payloadlen,
+                                entries,
+                                JOB_DOCUMENT_INDEX_CAPACITY,
+                                slots );
+
+    if( json_ret != JsonIndexSuccess )
     {
-        jobid = strndup( jobid, jobidLength );
-        url = strndup( url, urlLength );
-        assert( ( jobid != NULL ) && ( url != NULL ) );
-
-        h->jobid = jobid;
-        h->jobidLength = jobidLength;
-        h->url = url;
-        h->urlLength = urlLength;
-        ret = true;
+        warnx( "invalid job document" );
     }
     else
     {
-        if( jobid != NULL )
+        json_ret = JsonIndex_Find( &index,
+                                   "execution.jobDocument.url",
+                                   ( sizeof( "execution.jobDocument.url" ) - 1 ),
+                                   &url,
+                                   &urlLength,
+                                   NULL );
+
+        if( json_ret == JsonIndexSuccess )
         {
-            jobid[ jobidLength ] = '\0';
-            warnx( "missing url; failing job id: %s", jobid );
-            ( void ) sendUpdate( h, jobid, jobidLength, makeReport_( "FAILED" ) );
+            job->url = strndup( url, urlLength );
+            assert( job->url != NULL );
+
+            job->urlLength = urlLength;
+            ret = true;
+        }
+        else
+        {
+            warnx( "missing url; failing job id: %s", job->jobid );
+            job->report = makeReport_( "FAILED" );
+            job->runStatus = Exited;
         }
     }
 
@@ -897,8 +1283,9 @@ void on_message( struct mosquitto * m,
     handle_t * h = p;
     JobsStatus_t ret;
     JobsTopic_t api;
-    char * jobid;
-    uint16_t jobidLength;
+    char * jobid = NULL;
+    uint16_t jobidLength = 0;
+    job_t * job = NULL;
 
     assert( h != NULL );
     assert( message->topic != NULL );
@@ -914,23 +1301,45 @@ void on_message( struct mosquitto * m,
     assert( ret != JobsBadParameter );
     ( void ) ret;
 
+    if( jobid != NULL )
+    {
+        job = findJob( h, jobid, jobidLength );
+    }
+
     switch( api )
     {
-        /* a job has been added or the current job was canceled */
+        /* a job has been added or a job was canceled */
         case JobsNextJobChanged:
-        /* response to a request to describe the next job */
-        case JobsDescribeSuccess:
 
-            if( h->runStatus == Running )
+            /* look for more jobs, and resend the status of the running
+             * jobs to find out if one was canceled */
+            h->forcePrompt = true;
+            h->forceUpdate = true;
+            break;
+
+        /* response to a request to list the pending jobs */
+        case JobsGetPendingSuccess:
+
+            if( ( message->payload != NULL ) && ( message->payloadlen > 0 ) )
             {
-                h->forceUpdate = true;
-                h->forcePrompt = true;
+                parsePending( h, message );
             }
-            else if( h->runStatus == None )
+
+            break;
+
+        /* response to a request to describe a job */
+        case JobsDescribeSuccess:
+
+            if( ( job != NULL ) && ( job->runStatus == Describing ) &&
+                ( message->payload != NULL ) && ( message->payloadlen > 0 ) )
             {
-                if( parseJob( h, message ) == true )
+                if( parseJob( h, job, message ) == true )
+                {
+                    job->runStatus = Ready;
+                }
+                else if( job->runStatus == Describing )
                 {
-                    h->runStatus = Ready;
+                    releaseJob( job );
                 }
             }
             else
@@ -940,15 +1349,27 @@ void on_message( struct mosquitto * m,
 
             break;
 
+        case JobsDescribeFailed:
+
+            if( ( job != NULL ) && ( job->runStatus == Describing ) )
+            {
+                warnx( "describe failure for job id: %s", job->jobid );
+                releaseJob( job );
+            }
+
+            break;
+
         /* The last update was rejected. */
         case JobsUpdateFailed:
 
-            if( ( h->runStatus == Running ) &&
-                ( h->jobid != NULL ) &&
-                ( h->jobidLength == jobidLength ) &&
-                ( strncmp( h->jobid, jobid, jobidLength ) == 0 ) )
+            if( ( job != NULL ) && ( job->runStatus == Running ) )
             {
-                h->runStatus = Cancel;
+                job->runStatus = Cancel;
+            }
+            else if( ( job != NULL ) && ( job->runStatus == Reporting ) )
+            {
+                /* the final status was rejected, e.g., the job was canceled */
+                releaseJob( job );
             }
             else
             {
@@ -960,6 +1381,14 @@ void on_message( struct mosquitto * m,
         /* We seem to receive these even without a subscription. */
         case JobsUpdateSuccess:
             info( "job update success" );
+
+            /* the jobs service no longer lists a finished job as pending */
+            if( ( job != NULL ) && ( job->runStatus == Reporting ) )
+            {
+                releaseJob( job );
+                h->forcePrompt = true;
+            }
+
             break;
 
         case JobsInvalidTopic:
@@ -971,7 +1400,7 @@ void on_message( struct mosquitto * m,
 
 /*-----------------------------------------------------------*/
 
-static bool sendDescribeNext( handle_t * h )
+static bool sendGetPending( handle_t * h )
 {
     bool ret = true;
     JobsStatus_t jobs_ret;
@@ -980,14 +1409,12 @@ static bool sendDescribeNext( handle_t * h )
 
     assert( h != NULL );
 
-    /* populate the topic buffer for a DescribeJobExecution request */
-    jobs_ret = Jobs_Describe( topic,
-                              sizeof( topic ),
-                              h->name,
-                              h->nameLength,
-                              JOBS_API_JOBID_NEXT,
-                              JOBS_API_JOBID_NEXT_LENGTH,
-                              NULL );
+    /* populate the topic buffer for a GetPendingJobExecutions request */
+    jobs_ret = Jobs_GetPending( topic,
+                                sizeof( topic ),
+                                h->name,
+                                h->nameLength,
+                                NULL );
     assert( jobs_ret == JobsSuccess );
     ( void ) jobs_ret;
 
@@ -995,7 +1422,7 @@ static bool sendDescribeNext( handle_t * h )
 
     if( m_ret != MOSQ_ERR_SUCCESS )
     {
-        warnx( "sendDescribeNext: %s", mosquitto_strerror( ret ) );
+        warnx( "sendGetPending: %s", mosquitto_strerror( m_ret ) );
         ret = false;
     }
 
@@ -1004,120 +1431,364 @@ static bool sendDescribeNext( handle_t * h )
 
 /*-----------------------------------------------------------*/
 
-static void checkChild( handle_t * h )
+static void finishJob( handle_t * h,
+                       job_t * job,
+                       bool succeeded )
 {
+    assert( h != NULL );
+    assert( job != NULL );
+
+    if( succeeded == true )
+    {
+        info( "completed job id: %s", job->jobid );
+        job->report = makeReport_( "SUCCEEDED" );
+    }
+    else
+    {
+        info( "failed job id: %s", job->jobid );
+        job->report = makeReport_( "FAILED" );
+    }
+
+    job->runStatus = Exited;
+    h->finished = true;
+}
+
+/*-----------------------------------------------------------*/
+
+static void reapChildren( handle_t * h )
+{
+    struct signalfd_siginfo si;
     pid_t pid;
     int status;
+    size_t i;
+    job_t * job;
 
     assert( h != NULL );
-    assert( h->child > 0 );
-
-    /* Has the download process exited? */
-    pid = waitpid( h->child, &status, WNOHANG );
-    assert( pid != -1 );
 
-    switch( pid )
+    /* empty the signalfd; one SIGCHLD may stand for several exits */
+    while( read( h->sigchldfd, &si, sizeof( si ) ) == sizeof( si ) )
     {
-        /* still running */
-        case 0:
-            h->report = makeReport_( "IN_PROGRESS" );
-            break;
+    }
 
-        /* exited */
-        default:
+    /* Which download processes have exited? */
+    while( ( pid = waitpid( -1, &status, WNOHANG ) ) > 0 )
+    {
+        job = NULL;
 
-            /* process exit status 0 means success */
-            if( ( pid == h->child ) &&
-                ( WIFEXITED( status ) ) &&
-                ( WEXITSTATUS( status ) == 0 ) )
-            {
-                info( "completed job id: %s", h->jobid );
-                h->report = makeReport_( "SUCCEEDED" );
-            }
-            else
+        for( i = 0; ( job == NULL ) && ( i < h->maxJobs ); i++ )
+        {
+            if( ( h->jobs[ i ].runStatus == Running ) && ( h->jobs[ i ].child == pid ) )
             {
-                info( "failed job id: %s", h->jobid );
-                h->report = makeReport_( "FAILED" );
+                job = &h->jobs[ i ];
             }
+        }
+
+        if( job == NULL )
+        {
+            continue;
+        }
 
-            h->child = 0;
-            h->runStatus = None;
+        job->child = 0;
+
+        /* process exit status 0 means success */
+        finishJob( h, job, ( ( WIFEXITED( status ) ) && ( WEXITSTATUS( status ) == 0 ) ) ? true : false );
     }
 }
 
 /*-----------------------------------------------------------*/
 
-static bool download( handle_t * h )
+static void collectDownloads( handle_t * h )
 {
-    bool ret = true;
-    pid_t pid;
+    downloadStatus_t status;
+    size_t i, received, total;
+    job_t * job;
 
     assert( h != NULL );
-    assert( h->jobid != NULL );
-    assert( h->url != NULL );
 
-    /* run download as a separate process */
-    pid = fork();
+    /* one event may stand for several downloads */
+    downloaderClearEvents( &h->downloader );
 
-#define dir_format    "%s/job-%s.XXXXXX"
-
-    if( pid == 0 )
+    for( i = 0; i < h->maxJobs; i++ )
     {
-        /* create a unique download directory */
-        char dir_name[ sizeof( DESTINATION_PREFIX ) + h->jobidLength + sizeof( dir_format ) ];
+        job = &h->jobs[ i ];
 
-        snprintf( dir_name, sizeof( dir_name ), dir_format, DESTINATION_PREFIX, h->jobid );
-
-        if( mkdtemp( dir_name ) == NULL )
+        if( ( job->runStatus != Running ) || ( job->download.d == NULL ) )
         {
-            err( 1, "mkdtemp %s", dir_name );
+            continue;
         }
 
-        if( chdir( dir_name ) == -1 )
+        status = downloadProgress( &job->download, &received, &total );
+
+        if( status != DownloadRunning )
         {
-            err( 1, "chdir %s", dir_name );
+            downloadStop( &job->download );
+            finishJob( h, job, ( status == DownloadSucceeded ) ? true : false );
         }
+    }
+}
 
-        info( "download directory: %s", dir_name );
+/*-----------------------------------------------------------*/
+
+static void startDownloadThread( handle_t * h,
+                                 job_t * job )
+{
+#define resume_dir_format    "%s/job-%s"
+
+    /* the same directory in every run, so that a job resumed after a
+     * restart continues its file */
+    char dir_name[ sizeof( DESTINATION_PREFIX ) + job->jobidLength + sizeof( resume_dir_format ) ];
 
-        /* exec the download program */
-        CURL( h->url );
-        /* arrive here only if exec failed */
-        err( 1, "execl:" );
+    assert( h != NULL );
+    assert( job != NULL );
+
+    snprintf( dir_name, sizeof( dir_name ), resume_dir_format, DESTINATION_PREFIX, job->jobid );
+
+    if( ( mkdir( dir_name, 0700 ) == -1 ) && ( errno != EEXIST ) )
+    {
+        warn( "mkdir %s", dir_name );
+        finishJob( h, job, false );
     }
+    else if( downloadStart( &h->downloader, &job->download, job->url, job->urlLength, dir_name ) == false )
+    {
+        finishJob( h, job, false );
+    }
+    else
+    {
+        info( "download directory: %s", dir_name );
+    }
+}
 
-    free( h->url );
-    h->url = NULL;
-    h->child = pid;
+/*-----------------------------------------------------------*/
+
+static bool download( handle_t * h,
+                      job_t * job )
+{
+    bool ret = true;
+    pid_t pid;
+
+    assert( h != NULL );
+    assert( job != NULL );
+    assert( job->jobid != NULL );
+    assert( job->url != NULL );
 
-    if( pid == -1 )
+    if( downloadSupported( job->url, job->urlLength ) == true )
     {
-        warn( "fork" );
-        ret = false;
+        /* download in this process, over a connection that later jobs
+         * from the same host can reuse */
+        startDownloadThread( h, job );
     }
+    else
+    {
+        /* run download as a separate process */
+        pid = fork();
+
+#define dir_format    "%s/job-%s.XXXXXX"
+
+        if( pid == 0 )
+        {
+            /* create a unique download directory */
+            char dir_name[ sizeof( DESTINATION_PREFIX ) + job->jobidLength + sizeof( dir_format ) ];
+            sigset_t mask;
+
+            /* the download program expects SIGCHLD to be delivered */
+            sigemptyset( &mask );
+            sigaddset( &mask, SIGCHLD );
+            ( void ) sigprocmask( SIG_UNBLOCK, &mask, NULL );
+
+            snprintf( dir_name, sizeof( dir_name ), dir_format, DESTINATION_PREFIX, job->jobid );
+
+            /* failures exit with _exit(), as teardown() would kill the other
+             * downloads and close the connection of the parent */
+            if( mkdtemp( dir_name ) == NULL )
+            {
+                warn( "mkdtemp %s", dir_name );
+                _exit( 1 );
+            }
+
+            if( chdir( dir_name ) == -1 )
+            {
+                warn( "chdir %s", dir_name );
+                _exit( 1 );
+            }
+
+            info( "download directory: %s", dir_name );
+
+            /* exec the download program */
+            CURL( job->url );
+            /* arrive here only if exec failed */
+            warn( "execl:" );
+            _exit( 1 );
+        }
+
+        if( pid == -1 )
+        {
+            warn( "fork" );
+            ret = false;
+        }
+        else
+        {
+            job->child = pid;
+        }
+    }
+
+    free( job->url );
+    job->url = NULL;
 
     return ret;
 }
 
 /*-----------------------------------------------------------*/
 
-static void cancelDownload( handle_t * h )
+static void cancelDownload( job_t * job )
 {
-    assert( h != NULL );
+    assert( job != NULL );
+
+    downloadStop( &job->download );
 
-    if( h->child > 0 )
+    if( job->child > 0 )
     {
-        int ret = kill( h->child, SIGKILL );
+        int ret = kill( job->child, SIGKILL );
         assert( ( ret == 0 ) || ( errno == ESRCH ) );
 
         if( ret == 0 )
         {
             /* discard the download process exit status */
-            ( void ) wait( NULL );
+            ( void ) waitpid( job->child, NULL, 0 );
         }
     }
 
-    h->child = 0;
+    job->child = 0;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool sendUpdates( handle_t * h,
+                         time_t now )
+{
+    bool ret = true, periodic, progress;
+    size_t i, received, total;
+    job_t * job;
+    char report[ sizeof( progressFormat ) + ( 2 * sizeof( "18446744073709551615" ) ) ];
+
+    assert( h != NULL );
+
+    /* all running jobs share one update interval, so their periodic
+     * updates go out together rather than on separate timers; forced
+     * updates are coalesced to one batch a second, as every finished job
+     * triggers a next job changed notification */
+    periodic = ( ( h->forceUpdate == true ) && ( now > h->lastUpdate ) ) ||
+               ( ( h->updateinv != 0 ) && ( now > ( h->lastUpdate + h->updateinv ) ) );
+
+    /* the byte counts of download threads go out at most once an interval */
+    progress = ( now >= ( h->lastProgress + PROGRESS_INTERVAL ) ) ? true : false;
+
+    for( i = 0; ( ret == true ) && ( i < h->maxJobs ); i++ )
+    {
+        job = &h->jobs[ i ];
+        received = 0;
+        total = 0;
+
+        if( ( job->runStatus == Running ) && ( job->download.d != NULL ) )
+        {
+            ( void ) downloadProgress( &job->download, &received, &total );
+        }
+
+        if( ( job->runStatus == Running ) &&
+            ( ( job->updateDue == true ) || ( periodic == true ) ||
+              ( ( progress == true ) && ( received != job->reported ) ) ) )
+        {
+            info( "updating job id: %s", job->jobid );
+
+            if( job->download.d != NULL )
+            {
+                snprintf( report, sizeof( report ), progressFormat, received, total );
+                ret = sendUpdate( h, job->jobid, job->jobidLength, report );
+            }
+            else
+            {
+                ret = sendUpdate( h, job->jobid, job->jobidLength, makeReport_( "IN_PROGRESS" ) );
+            }
+
+            job->updateDue = false;
+            job->reported = received;
+        }
+        else if( job->runStatus == Exited )
+        {
+            ret = sendUpdate( h, job->jobid, job->jobidLength, job->report );
+            job->runStatus = Reporting;
+        }
+    }
+
+    if( periodic == true )
+    {
+        h->lastUpdate = now;
+        h->forceUpdate = false;
+    }
+
+    if( progress == true )
+    {
+        h->lastProgress = now;
+    }
+
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+static int serviceEvents( handle_t * h,
+                          int timeout )
+{
+    int ret = MOSQ_ERR_SUCCESS;
+    struct pollfd fds[ 3 ] = { 0 };
+
+    assert( h != NULL );
+
+    fds[ 0 ].fd = mosquitto_socket( h->m );
+    fds[ 0 ].events = POLLIN;
+
+    if( mosquitto_want_write( h->m ) == true )
+    {
+        fds[ 0 ].events |= POLLOUT;
+    }
+
+    fds[ 1 ].fd = h->sigchldfd;
+    fds[ 1 ].events = POLLIN;
+
+    fds[ 2 ].fd = h->downloader.eventfd;
+    fds[ 2 ].events = POLLIN;
+
+    if( ( poll( fds, 3, timeout ) == -1 ) && ( errno != EINTR ) )
+    {
+        ret = MOSQ_ERR_ERRNO;
+    }
+
+    if( ( ret == MOSQ_ERR_SUCCESS ) && ( ( fds[ 0 ].revents & ( POLLIN | POLLERR | POLLHUP ) ) != 0 ) )
+    {
+        ret = mosquitto_loop_read( h->m, 1 );
+    }
+
+    if( ( ret == MOSQ_ERR_SUCCESS ) && ( ( fds[ 0 ].revents & POLLOUT ) != 0 ) )
+    {
+        ret = mosquitto_loop_write( h->m, 1 );
+    }
+
+    /* keep alive, and resend unacknowledged messages */
+    if( ret == MOSQ_ERR_SUCCESS )
+    {
+        ret = mosquitto_loop_misc( h->m );
+    }
+
+    if( ( fds[ 1 ].revents & POLLIN ) != 0 )
+    {
+        reapChildren( h );
+    }
+
+    if( ( fds[ 2 ].revents & POLLIN ) != 0 )
+    {
+        collectDownloads( h );
+    }
+
+    return ret;
 }
 
 /*-----------------------------------------------------------*/
@@ -1145,6 +1816,7 @@ static bool setup( handle_t * h )
 {
     bool ret = false;
     struct sigaction sa = { 0 };
+    sigset_t mask;
 
     assert( h != NULL );
 
@@ -1155,8 +1827,34 @@ static bool setup( handle_t * h )
     assert( sigaction( SIGINT, &sa, NULL ) != -1 );
     assert( sigaction( SIGTERM, &sa, NULL ) != -1 );
 
-    mosquitto_lib_init();
-    h->m = mosquitto_new( h->name, true, h );
+    /* a download server closing its connection must not end the program */
+    sa.sa_handler = SIG_IGN;
+    assert( sigaction( SIGPIPE, &sa, NULL ) != -1 );
+
+    /* deliver SIGCHLD through a descriptor polled with the MQTT socket */
+    sigemptyset( &mask );
+    sigaddset( &mask, SIGCHLD );
+
+    if( sigprocmask( SIG_BLOCK, &mask, NULL ) == -1 )
+    {
+        warn( "sigprocmask" );
+    }
+    else
+    {
+        h->sigchldfd = signalfd( -1, &mask, SFD_NONBLOCK | SFD_CLOEXEC );
+
+        if( h->sigchldfd == -1 )
+        {
+            warn( "signalfd" );
+        }
+    }
+
+    /* download threads inherit the signal mask, so SIGCHLD stays blocked */
+    if( ( h->sigchldfd != -1 ) && ( downloaderInit( &h->downloader, h->dlcafile ) == true ) )
+    {
+        mosquitto_lib_init();
+        h->m = mosquitto_new( h->name, true, h );
+    }
 
     if( h->m != NULL )
     {
@@ -1176,20 +1874,26 @@ static void teardown( int x,
                       void * p )
 {
     handle_t * h = p;
+    size_t i;
 
     assert( h != NULL );
 
-    if( h->url != NULL )
+    for( i = 0; i < MAX_CONCURRENT_JOBS; i++ )
+    {
+        cancelDownload( &h->jobs[ i ] );
+        releaseJob( &h->jobs[ i ] );
+    }
+
+    if( h->sigchldfd != -1 )
     {
-        free( h->url );
+        ( void ) close( h->sigchldfd );
     }
 
-    if( h->jobid != NULL )
+    if( h->downloader.eventfd != -1 )
     {
-        free( h->jobid );
+        downloaderCleanup( &h->downloader );
     }
 
-    cancelDownload( h );
     closeConnection( h );
     mosquitto_destroy( h->m );
     mosquitto_lib_cleanup();
@@ -1202,6 +1906,7 @@ int main( int argc,
 {
     handle_t h_, * h = &h_;
     time_t now;
+    bool downloading = false;
 
     initHandle( h );
 
@@ -1222,9 +1927,9 @@ int main( int argc,
         errx( 1, "fatal error" );
     }
 
-    info( "requesting first job" );
+    info( "requesting pending jobs" );
 
-    if( sendDescribeNext( h ) == false )
+    if( sendGetPending( h ) == false )
     {
         errx( 1, "fatal error" );
     }
@@ -1235,8 +1940,22 @@ int main( int argc,
     {
         bool ret = true;
         int m_ret;
+        int timeout = MQTT_WAIT_TIME;
+        size_t i, active = 0;
+        job_t * job;
 
-        m_ret = mosquitto_loop( h->m, MQTT_WAIT_TIME, 1 );
+        /* wake up in time for a forced batch of updates, or for the
+         * progress of the download threads */
+        if( h->forceUpdate == true )
+        {
+            timeout = 1000;
+        }
+        else if( downloading == true )
+        {
+            timeout = PROGRESS_INTERVAL * 1000U;
+        }
+
+        m_ret = serviceEvents( h, timeout );
 
         if( m_ret != MOSQ_ERR_SUCCESS )
         {
@@ -1244,58 +1963,62 @@ int main( int argc,
         }
 
         now = time( NULL );
+        downloading = false;
 
-        switch( h->runStatus )
+        for( i = 0; ( ret == true ) && ( i < h->maxJobs ); i++ )
         {
-            case None:
-
-                if( ( h->forcePrompt == true ) ||
-                    ( ( h->pollinv != 0 ) && ( now > ( h->lastPrompt + h->pollinv ) ) ) )
-                {
-                    h->lastPrompt = now;
-                    info( "requesting job" );
-                    ret = sendDescribeNext( h );
-                    h->forcePrompt = false;
-                }
-
-                break;
-
-            case Ready:
-                info( "starting job id: %s", h->jobid );
-                ret = download( h );
-
-                if( ret == true )
-                {
-                    h->runStatus = Running;
-                    info( "sending first update" );
-                    checkChild( h );
-                    ret = sendUpdate( h, h->jobid, h->jobidLength, h->report );
-                    h->lastUpdate = now;
-                }
-
-                break;
+            job = &h->jobs[ i ];
 
-            case Running:
+            switch( job->runStatus )
+            {
+                case Ready:
+                    info( "starting job id: %s", job->jobid );
+                    job->runStatus = Running;
+                    job->updateDue = true;
+                    /* a download that cannot start fails the job */
+                    ret = download( h, job );
+                    break;
+
+                case Cancel:
+                    info( "canceled job id: %s", job->jobid );
+                    cancelDownload( job );
+                    releaseJob( job );
+                    h->finished = true;
+                    h->forcePrompt = true;
+                    break;
+
+                default:
+                    break;
+            }
 
-                checkChild( h );
+            if( job->runStatus != None )
+            {
+                active++;
+            }
 
-                /* send an update if the job exited, was "force" canceled, or a periodic update is due */
-                if( ( h->runStatus == None ) ||
-                    ( h->forceUpdate == true ) ||
-                    ( ( h->updateinv != 0 ) && ( now > ( h->lastUpdate + h->updateinv ) ) ) )
-                {
-                    info( "updating job id: %s", h->jobid );
-                    ret = sendUpdate( h, h->jobid, h->jobidLength, h->report );
-                    h->lastUpdate = now;
-                    h->forceUpdate = false;
-                }
+            if( job->download.d != NULL )
+            {
+                downloading = true;
+            }
+        }
 
-                break;
+        /* send the IN_PROGRESS status of the jobs just started, and the final
+         * status of the jobs just finished, together */
+        if( ret == true )
+        {
+            ret = sendUpdates( h, now );
+        }
 
-            case Cancel:
-                info( "canceled job id: %s", h->jobid );
-                cancelDownload( h );
-                h->runStatus = None;
+        if( ( ret == true ) &&
+            ( active < h->maxJobs ) &&
+            ( ( h->runOnce == false ) || ( h->finished == false ) ) &&
+            ( ( h->forcePrompt == true ) ||
+              ( ( h->pollinv != 0 ) && ( now > ( h->lastPrompt + h->pollinv ) ) ) ) )
+        {
+            h->lastPrompt = now;
+            info( "requesting pending jobs" );
+            ret = sendGetPending( h );
+            h->forcePrompt = false;
         }
 
         if( ret == false )
@@ -1303,16 +2026,9 @@ int main( int argc,
             errx( 1, "fatal error" );
         }
 
-        if( ( h->runStatus == None ) && ( h->jobid != NULL ) )
+        if( ( h->runOnce == true ) && ( h->finished == true ) && ( active == 0 ) )
         {
-            free( h->jobid );
-            h->jobid = NULL;
-            h->jobidLength = 0;
-
-            if( h->runOnce == true )
-            {
-                break;
-            }
+            break;
         }
     }
 
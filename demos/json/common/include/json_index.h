@@ -0,0 +1,187 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file json_index.h
+ * @brief The API of an index of the values of a JSON document by key path,
+ * built in a single pass over the document.
+ */
+
+#ifndef JSON_INDEX_H_
+#define JSON_INDEX_H_
+
+/* Standard includes. */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Deepest nesting of objects and arrays accepted in a document.
+ */
+#ifndef JSON_INDEX_MAX_DEPTH
+    #define JSON_INDEX_MAX_DEPTH    ( 32U )
+#endif
+
+/**
+ * @brief Number of slots needed by the hash table of an index of
+ * @p capacity values. Twice the capacity keeps probe sequences short.
+ */
+#define JSON_INDEX_SLOT_COUNT( capacity )    ( 2U * ( capacity ) )
+
+/**
+ * @brief Largest number of values an index can hold.
+ */
+#define JSON_INDEX_MAX_CAPACITY              ( ( UINT16_MAX / 2U ) - 1U )
+
+/**
+ * @brief Capacity of an index that holds all the values of any document of
+ * @p length characters, up to #JSON_INDEX_MAX_CAPACITY.
+ *
+ * Every value but the last of a container is followed by a separator, so a
+ * document has at most half as many values as characters, rounded up.
+ */
+#define JSON_INDEX_CAPACITY_FOR_LENGTH( length )                    \
+    ( ( ( ( length ) / 2U ) + 1U ) < JSON_INDEX_MAX_CAPACITY ?      \
+      ( uint16_t ) ( ( ( length ) / 2U ) + 1U ) : ( uint16_t ) JSON_INDEX_MAX_CAPACITY )
+
+/**
+ * @brief Return codes from the JSON index functions.
+ */
+typedef enum JsonIndexStatus
+{
+    JsonIndexSuccess = 0,      /**< @brief The document was indexed, or the value was found. */
+    JsonIndexBadParameter,     /**< @brief A parameter was invalid. */
+    JsonIndexIllegalDocument,  /**< @brief The document is not valid JSON. */
+    JsonIndexMaxDepthExceeded, /**< @brief The document nests deeper than #JSON_INDEX_MAX_DEPTH. */
+    JsonIndexFull,             /**< @brief The document has more values than the index can hold. */
+    JsonIndexNotFound          /**< @brief The document has no value at the key path. */
+} JsonIndexStatus_t;
+
+/**
+ * @brief Types of the values of a document.
+ */
+typedef enum JsonIndexType
+{
+    JsonIndexString = 0, /**< @brief A string. */
+    JsonIndexNumber,     /**< @brief A number. */
+    JsonIndexTrue,       /**< @brief The literal true. */
+    JsonIndexFalse,      /**< @brief The literal false. */
+    JsonIndexNull,       /**< @brief The literal null. */
+    JsonIndexObject,     /**< @brief An object. */
+    JsonIndexArray       /**< @brief An array. */
+} JsonIndexType_t;
+
+/**
+ * @brief A value of an indexed document.
+ */
+typedef struct JsonIndexEntry
+{
+    uint32_t pathHash;    /**< @brief Hash of the key path of the value. */
+    uint32_t key;         /**< @brief Offset of the key in the document, or position of an array element. */
+    uint32_t keyLength;   /**< @brief Length of the key, or #UINT32_MAX for an array element. */
+    uint32_t valueOffset; /**< @brief Offset of the value in the document, after the quote of a string. */
+    uint32_t valueLength; /**< @brief Length of the value, without the quotes of a string. */
+    uint16_t parent;      /**< @brief Entry of the enclosing object or array, or #UINT16_MAX at the top level. */
+    uint8_t type;         /**< @brief Type of the value, a #JsonIndexType_t. */
+} JsonIndexEntry_t;
+
+/**
+ * @brief An index of a document.
+ *
+ * The values are found by key path through an open-addressing hash table of
+ * the entries. The members are private to the index; use the JsonIndex_*
+ * functions to access them.
+ */
+typedef struct JsonIndex
+{
+    const char * pDocument;      /**< @brief The document. */
+    size_t documentLength;       /**< @brief Length of #pDocument. */
+    JsonIndexEntry_t * pEntries; /**< @brief The values of the document. */
+    uint16_t * pSlots;           /**< @brief Hash table of #pEntries by key path. */
+    uint16_t capacity;           /**< @brief Number of entries of #pEntries. */
+    uint16_t slotCount;          /**< @brief Number of slots of #pSlots. */
+    uint16_t entryCount;         /**< @brief Number of values of the document. */
+    bool isSearched;             /**< @brief Whether values are found with JSON_SearchConst, for a document that was not indexed. */
+} JsonIndex_t;
+
+/**
+ * @brief Validate a document and index all its values in a single pass.
+ *
+ * The document is validated as JSON_Validate of coreJSON would, including
+ * the escapes and UTF-8 encoding of strings. The index keeps pointers into
+ * the document, which must stay valid while the index is used.
+ *
+ * A document that has more than @p capacity values, or that the index does
+ * not accept, is validated again with JSON_Validate of coreJSON. If it is
+ * valid, #JsonIndex_Find finds its values with JSON_SearchConst instead of
+ * the hash table, so every document accepted by coreJSON can be used.
+ *
+ * @param[out] pIndex The index to build.
+ * @param[in] pDocument The document.
+ * @param[in] documentLength Length of the document.
+ * @param[in] pEntries Storage for the values, of @p capacity entries.
+ * @param[in] capacity Number of values the index can hold, at most
+ * #JSON_INDEX_MAX_CAPACITY.
+ * @param[in] pSlots Storage for the hash table, of
+ * #JSON_INDEX_SLOT_COUNT( @p capacity ) slots.
+ *
+ * @return #JsonIndexSuccess if the document was indexed;
+ * #JsonIndexBadParameter if a parameter is invalid;
+ * #JsonIndexIllegalDocument if the document is not valid JSON;
+ * #JsonIndexMaxDepthExceeded if the document nests too deep.
+ */
+JsonIndexStatus_t JsonIndex_Build( JsonIndex_t * pIndex,
+                                   const char * pDocument,
+                                   size_t documentLength,
+                                   JsonIndexEntry_t * pEntries,
+                                   uint16_t capacity,
+                                   uint16_t * pSlots );
+
+/**
+ * @brief Find the value at a key path of an indexed document.
+ *
+ * The key path uses the syntax of JSON_Search of coreJSON: keys separated by
+ * periods, and array elements as a position in square brackets, for example
+ * "state.reported.colors[2]". When an object has the same key more than once,
+ * the first value is found, and key paths through the key only reach into
+ * the first value, as with JSON_Search. Keys with a period or a bracket are
+ * not found.
+ *
+ * @param[in] pIndex The index.
+ * @param[in] pQuery The key path.
+ * @param[in] queryLength Length of the key path.
+ * @param[out] ppValue The value, without the quotes of a string.
+ * @param[out] pValueLength Length of the value.
+ * @param[out] pType Type of the value. Can be NULL.
+ *
+ * @return #JsonIndexSuccess if the value was found;
+ * #JsonIndexBadParameter if a parameter is invalid;
+ * #JsonIndexNotFound if the document has no value at the key path.
+ */
+JsonIndexStatus_t JsonIndex_Find( const JsonIndex_t * pIndex,
+                                  const char * pQuery,
+                                  size_t queryLength,
+                                  const char ** ppValue,
+                                  size_t * pValueLength,
+                                  JsonIndexType_t * pType );
+
+#endif /* ifndef JSON_INDEX_H_ */
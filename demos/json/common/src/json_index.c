@@ -0,0 +1,1208 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file json_index.c
+ * @brief Implementation of an index of the values of a JSON document by key
+ * path, built in a single pass over the document.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* Include header for the JSON index. */
+#include "json_index.h"
+
+/* JSON API header, for documents that are not indexed. */
+#include "core_json.h"
+
+/**
+ * @brief Marker for the absence of an entry.
+ */
+#define NO_ENTRY                    ( UINT16_MAX )
+
+/**
+ * @brief Key length of the entry of an array element.
+ */
+#define ARRAY_ELEMENT_KEY_LENGTH    ( UINT32_MAX )
+
+/**
+ * @brief Offset basis of the 32-bit FNV-1a hash, the hash of an empty key
+ * path.
+ */
+#define FNV_OFFSET_BASIS            ( 2166136261UL )
+
+/**
+ * @brief Prime of the 32-bit FNV-1a hash.
+ */
+#define FNV_PRIME                   ( 16777619UL )
+
+/**
+ * @brief Number of decimal digits of the largest array element position.
+ */
+#define POSITION_MAX_DIGITS         ( 10U )
+
+/**
+ * @brief An object or array being parsed.
+ */
+typedef struct ContainerFrame
+{
+    uint32_t pathHash; /**< @brief Hash of the key path of the container. */
+    uint32_t count;    /**< @brief Number of values of the container parsed so far. */
+    uint16_t entry;    /**< @brief Entry of the container, or #NO_ENTRY for the top-level value. */
+    bool isArray;      /**< @brief Whether the container is an array. */
+    bool isHidden;     /**< @brief Whether no key path reaches the container, so that its values are not added to the hash table. */
+} ContainerFrame_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Move past whitespace.
+ *
+ * @param[in] pBuffer The document.
+ * @param[in,out] pStart Position in the document.
+ * @param[in] max Length of the document.
+ */
+static void skipSpace( const char * pBuffer,
+                       size_t * pStart,
+                       size_t max );
+
+/**
+ * @brief Move past one or more decimal digits.
+ *
+ * @return true if there was a digit; false otherwise.
+ */
+static bool skipDigits( const char * pBuffer,
+                        size_t * pStart,
+                        size_t max );
+
+/**
+ * @brief Move past four hexadecimal digits.
+ *
+ * @param[out] pValue The value of the digits.
+ *
+ * @return true if there were four digits; false otherwise.
+ */
+static bool skipHexDigits( const char * pBuffer,
+                           size_t * pStart,
+                           size_t max,
+                           uint16_t * pValue );
+
+/**
+ * @brief Move past an escape sequence of a string, starting at its backslash.
+ * A \\u escape of a high surrogate must be followed by one of a low surrogate.
+ *
+ * @return true if the escape sequence is valid; false otherwise.
+ */
+static bool skipEscape( const char * pBuffer,
+                        size_t * pStart,
+                        size_t max );
+
+/**
+ * @brief Move past a multi-byte UTF-8 character, rejecting overlong
+ * encodings, surrogates and code points beyond U+10FFFF.
+ *
+ * @return true if the character is valid; false otherwise.
+ */
+static bool skipUTF8MultiByte( const char * pBuffer,
+                               size_t * pStart,
+                               size_t max );
+
+/**
+ * @brief Move past a string, including its quotes.
+ *
+ * @return true if the string is valid; false otherwise.
+ */
+static bool skipString( const char * pBuffer,
+                        size_t * pStart,
+                        size_t max );
+
+/**
+ * @brief Move past a number.
+ *
+ * @return true if the number is valid; false otherwise.
+ */
+static bool skipNumber( const char * pBuffer,
+                        size_t * pStart,
+                        size_t max );
+
+/**
+ * @brief Move past a literal.
+ *
+ * @param[in] pLiteral The literal.
+ * @param[in] literalLength Length of the literal.
+ *
+ * @return true if the document has the literal at the position; false
+ * otherwise.
+ */
+static bool skipLiteral( const char * pBuffer,
+                         size_t * pStart,
+                         size_t max,
+                         const char * pLiteral,
+                         size_t literalLength );
+
+/**
+ * @brief Move past a string, number or literal.
+ *
+ * @param[out] pType Type of the value.
+ *
+ * @return true if the value is valid; false otherwise.
+ */
+static bool skipScalar( const char * pBuffer,
+                        size_t * pStart,
+                        size_t max,
+                        JsonIndexType_t * pType );
+
+/**
+ * @brief Extend the FNV-1a hash of a key path with more characters.
+ *
+ * @param[in] hash Hash of the key path.
+ * @param[in] pCharacters The characters.
+ * @param[in] length Number of characters.
+ *
+ * @return Hash of the extended key path.
+ */
+static uint32_t extendHash( uint32_t hash,
+                            const char * pCharacters,
+                            size_t length );
+
+/**
+ * @brief Extend the hash of the key path of an array with the position of
+ * one of its elements, as "[position]".
+ *
+ * @param[in] hash Hash of the key path of the array.
+ * @param[in] position Position of the element.
+ *
+ * @return Hash of the key path of the element.
+ */
+static uint32_t extendHashWithPosition( uint32_t hash,
+                                        uint32_t position );
+
+/**
+ * @brief Add a value to an index.
+ *
+ * As JSON_Search of coreJSON only looks into the first value of a key, a
+ * value is hidden from lookups when its object has the key before it, when
+ * its key has a character that ends a key in a key path, or when its
+ * container is hidden.
+ *
+ * @param[in] pIndex The index.
+ * @param[in] pParent The object or array of the value.
+ * @param[in] key Offset of the key of the value, or its position in an array.
+ * @param[in] keyLength Length of the key, or #ARRAY_ELEMENT_KEY_LENGTH.
+ * @param[out] pEntry Entry of the value.
+ * @param[out] pIsHidden Whether the value is hidden from lookups.
+ *
+ * @return #JsonIndexSuccess if the value was added; #JsonIndexFull if the
+ * index has no free entry.
+ */
+static JsonIndexStatus_t addEntry( JsonIndex_t * pIndex,
+                                   const ContainerFrame_t * pParent,
+                                   uint32_t key,
+                                   uint32_t keyLength,
+                                   uint16_t * pEntry,
+                                   bool * pIsHidden );
+
+/**
+ * @brief Check whether the key path of an entry is a query, by comparing its
+ * keys and positions with the query from its end.
+ *
+ * @return true if the key path is the query; false otherwise.
+ */
+static bool matchesPath( const JsonIndex_t * pIndex,
+                         uint16_t entry,
+                         const char * pQuery,
+                         size_t queryLength );
+
+/**
+ * @brief Validate a document and index all its values in a single pass.
+ *
+ * The parameters are those of #JsonIndex_Build.
+ *
+ * @return #JsonIndexSuccess if the document was indexed;
+ * #JsonIndexBadParameter if a parameter is invalid;
+ * #JsonIndexIllegalDocument if the document is not valid JSON;
+ * #JsonIndexMaxDepthExceeded if the document nests too deep;
+ * #JsonIndexFull if the document has more than @p capacity values.
+ */
+static JsonIndexStatus_t indexDocument( JsonIndex_t * pIndex,
+                                        const char * pDocument,
+                                        size_t documentLength,
+                                        JsonIndexEntry_t * pEntries,
+                                        uint16_t capacity,
+                                        uint16_t * pSlots );
+
+/**
+ * @brief Find a value of a document that was not indexed with
+ * JSON_SearchConst of coreJSON.
+ *
+ * The parameters are those of #JsonIndex_Find.
+ *
+ * @return #JsonIndexSuccess if the value was found;
+ * #JsonIndexNotFound otherwise.
+ */
+static JsonIndexStatus_t searchDocument( const JsonIndex_t * pIndex,
+                                         const char * pQuery,
+                                         size_t queryLength,
+                                         const char ** ppValue,
+                                         size_t * pValueLength,
+                                         JsonIndexType_t * pType );
+
+/*-----------------------------------------------------------*/
+
+static void skipSpace( const char * pBuffer,
+                       size_t * pStart,
+                       size_t max )
+{
+    size_t i = *pStart;
+
+    while( ( i < max ) &&
+           ( ( pBuffer[ i ] == ' ' ) || ( pBuffer[ i ] == '\t' ) ||
+             ( pBuffer[ i ] == '\n' ) || ( pBuffer[ i ] == '\r' ) ) )
+    {
+        i++;
+    }
+
+    *pStart = i;
+}
+/*-----------------------------------------------------------*/
+
+static bool skipDigits( const char * pBuffer,
+                        size_t * pStart,
+                        size_t max )
+{
+    size_t i = *pStart;
+    bool hasDigit = false;
+
+    while( ( i < max ) && ( pBuffer[ i ] >= '0' ) && ( pBuffer[ i ] <= '9' ) )
+    {
+        hasDigit = true;
+        i++;
+    }
+
+    *pStart = i;
+
+    return hasDigit;
+}
+/*-----------------------------------------------------------*/
+
+static bool skipHexDigits( const char * pBuffer,
+                           size_t * pStart,
+                           size_t max,
+                           uint16_t * pValue )
+{
+    size_t i = *pStart;
+    size_t end = *pStart + 4U;
+    uint16_t value = 0U;
+    bool isValid = ( end <= max );
+    char c;
+
+    while( ( isValid == true ) && ( i < end ) )
+    {
+        c = pBuffer[ i ];
+
+        if( ( c >= '0' ) && ( c <= '9' ) )
+        {
+            value = ( uint16_t ) ( ( value << 4 ) | ( uint16_t ) ( c - '0' ) );
+        }
+        else if( ( c >= 'a' ) && ( c <= 'f' ) )
+        {
+            value = ( uint16_t ) ( ( value << 4 ) | ( uint16_t ) ( c - 'a' + 10 ) );
+        }
+        else if( ( c >= 'A' ) && ( c <= 'F' ) )
+        {
+            value = ( uint16_t ) ( ( value << 4 ) | ( uint16_t ) ( c - 'A' + 10 ) );
+        }
+        else
+        {
+            isValid = false;
+        }
+
+        i++;
+    }
+
+    if( isValid == true )
+    {
+        *pStart = end;
+        *pValue = value;
+    }
+
+    return isValid;
+}
+/*-----------------------------------------------------------*/
+
+static bool skipEscape( const char * pBuffer,
+                        size_t * pStart,
+                        size_t max )
+{
+    size_t i = *pStart + 1U;
+    uint16_t value = 0U;
+    bool isValid = ( i < max );
+
+    if( isValid == true )
+    {
+        switch( pBuffer[ i ] )
+        {
+            case '"':
+            case '\\':
+            case '/':
+            case 'b':
+            case 'f':
+            case 'n':
+            case 'r':
+            case 't':
+                i++;
+                break;
+
+            case 'u':
+                i++;
+                isValid = skipHexDigits( pBuffer, &i, max, &value );
+
+                if( ( isValid == true ) && ( value >= 0xD800U ) && ( value <= 0xDBFFU ) )
+                {
+                    /* A high surrogate must be followed by a low surrogate. */
+                    isValid = ( ( i + 1U ) < max ) &&
+                              ( pBuffer[ i ] == '\\' ) &&
+                              ( pBuffer[ i + 1U ] == 'u' );
+
+                    if( isValid == true )
+                    {
+                        i += 2U;
+                        isValid = skipHexDigits( pBuffer, &i, max, &value ) &&
+                                  ( value >= 0xDC00U ) && ( value <= 0xDFFFU );
+                    }
+                }
+                else if( ( value >= 0xDC00U ) && ( value <= 0xDFFFU ) )
+                {
+                    /* A low surrogate cannot come first. */
+                    isValid = false;
+                }
+                else
+                {
+                    /* Empty else MISRA 15.7 */
+                }
+
+                break;
+
+            default:
+                isValid = false;
+                break;
+        }
+    }
+
+    if( isValid == true )
+    {
+        *pStart = i;
+    }
+
+    return isValid;
+}
+/*-----------------------------------------------------------*/
+
+static bool skipUTF8MultiByte( const char * pBuffer,
+                               size_t * pStart,
+                               size_t max )
+{
+    size_t i = *pStart;
+    uint8_t lead = ( uint8_t ) pBuffer[ i ];
+    uint8_t c;
+    uint8_t secondMin = 0x80U, secondMax = 0xBFU;
+    size_t continuationCount = 0U, end;
+    bool isValid = true;
+
+    /* The lead byte gives the number of continuation bytes, and the range of
+     * the first one that excludes overlong encodings, surrogates and code
+     * points beyond U+10FFFF. */
+    if( ( lead >= 0xC2U ) && ( lead <= 0xDFU ) )
+    {
+        continuationCount = 1U;
+    }
+    else if( lead == 0xE0U )
+    {
+        continuationCount = 2U;
+        secondMin = 0xA0U;
+    }
+    else if( lead == 0xEDU )
+    {
+        continuationCount = 2U;
+        secondMax = 0x9FU;
+    }
+    else if( ( lead >= 0xE1U ) && ( lead <= 0xEFU ) )
+    {
+        continuationCount = 2U;
+    }
+    else if( lead == 0xF0U )
+    {
+        continuationCount = 3U;
+        secondMin = 0x90U;
+    }
+    else if( lead == 0xF4U )
+    {
+        continuationCount = 3U;
+        secondMax = 0x8FU;
+    }
+    else if( ( lead >= 0xF1U ) && ( lead <= 0xF3U ) )
+    {
+        continuationCount = 3U;
+    }
+    else
+    {
+        isValid = false;
+    }
+
+    end = i + 1U + continuationCount;
+    isValid = isValid && ( end <= max );
+
+    if( isValid == true )
+    {
+        i++;
+        c = ( uint8_t ) pBuffer[ i ];
+        isValid = ( c >= secondMin ) && ( c <= secondMax );
+        i++;
+    }
+
+    while( ( isValid == true ) && ( i < end ) )
+    {
+        c = ( uint8_t ) pBuffer[ i ];
+        isValid = ( c >= 0x80U ) && ( c <= 0xBFU );
+        i++;
+    }
+
+    if( isValid == true )
+    {
+        *pStart = end;
+    }
+
+    return isValid;
+}
+/*-----------------------------------------------------------*/
+
+static bool skipString( const char * pBuffer,
+                        size_t * pStart,
+                        size_t max )
+{
+    size_t i = *pStart + 1U;
+    bool isValid = ( *pStart < max ) && ( pBuffer[ *pStart ] == '"' );
+    bool isClosed = false;
+    uint8_t c;
+
+    while( ( isValid == true ) && ( isClosed == false ) )
+    {
+        if( i >= max )
+        {
+            isValid = false;
+        }
+        else
+        {
+            c = ( uint8_t ) pBuffer[ i ];
+
+            if( c == ( uint8_t ) '"' )
+            {
+                isClosed = true;
+                i++;
+            }
+            else if( c == ( uint8_t ) '\\' )
+            {
+                isValid = skipEscape( pBuffer, &i, max );
+            }
+            else if( c < 0x20U )
+            {
+                /* Control characters must be escaped. */
+                isValid = false;
+            }
+            else if( c < 0x80U )
+            {
+                i++;
+            }
+            else
+            {
+                isValid = skipUTF8MultiByte( pBuffer, &i, max );
+            }
+        }
+    }
+
+    if( isValid == true )
+    {
+        *pStart = i;
+    }
+
+    return isValid;
+}
+/*-----------------------------------------------------------*/
+
+static bool skipNumber( const char * pBuffer,
+                        size_t * pStart,
+                        size_t max )
+{
+    size_t i = *pStart;
+    bool isValid = true;
+
+    if( ( i < max ) && ( pBuffer[ i ] == '-' ) )
+    {
+        i++;
+    }
+
+    /* The integer part has no leading zero. */
+    if( ( i < max ) && ( pBuffer[ i ] == '0' ) )
+    {
+        i++;
+    }
+    else
+    {
+        isValid = ( i < max ) && ( pBuffer[ i ] != '0' ) && skipDigits( pBuffer, &i, max );
+    }
+
+    if( ( isValid == true ) && ( i < max ) && ( pBuffer[ i ] == '.' ) )
+    {
+        i++;
+        isValid = skipDigits( pBuffer, &i, max );
+    }
+
+    if( ( isValid == true ) && ( i < max ) &&
+        ( ( pBuffer[ i ] == 'e' ) || ( pBuffer[ i ] == 'E' ) ) )
+    {
+        i++;
+
+        if( ( i < max ) && ( ( pBuffer[ i ] == '+' ) || ( pBuffer[ i ] == '-' ) ) )
+        {
+            i++;
+        }
+
+        isValid = skipDigits( pBuffer, &i, max );
+    }
+
+    if( isValid == true )
+    {
+        *pStart = i;
+    }
+
+    return isValid;
+}
+/*-----------------------------------------------------------*/
+
+static bool skipLiteral( const char * pBuffer,
+                         size_t * pStart,
+                         size_t max,
+                         const char * pLiteral,
+                         size_t literalLength )
+{
+    bool isValid = ( ( max - *pStart ) >= literalLength ) &&
+                   ( memcmp( &pBuffer[ *pStart ], pLiteral, literalLength ) == 0 );
+
+    if( isValid == true )
+    {
+        *pStart += literalLength;
+    }
+
+    return isValid;
+}
+/*-----------------------------------------------------------*/
+
+static bool skipScalar( const char * pBuffer,
+                        size_t * pStart,
+                        size_t max,
+                        JsonIndexType_t * pType )
+{
+    bool isValid = false;
+
+    if( *pStart < max )
+    {
+        switch( pBuffer[ *pStart ] )
+        {
+            case '"':
+                *pType = JsonIndexString;
+                isValid = skipString( pBuffer, pStart, max );
+                break;
+
+            case 't':
+                *pType = JsonIndexTrue;
+                isValid = skipLiteral( pBuffer, pStart, max, "true", sizeof( "true" ) - 1U );
+                break;
+
+            case 'f':
+                *pType = JsonIndexFalse;
+                isValid = skipLiteral( pBuffer, pStart, max, "false", sizeof( "false" ) - 1U );
+                break;
+
+            case 'n':
+                *pType = JsonIndexNull;
+                isValid = skipLiteral( pBuffer, pStart, max, "null", sizeof( "null" ) - 1U );
+                break;
+
+            default:
+                *pType = JsonIndexNumber;
+                isValid = skipNumber( pBuffer, pStart, max );
+                break;
+        }
+    }
+
+    return isValid;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t extendHash( uint32_t hash,
+                            const char * pCharacters,
+                            size_t length )
+{
+    uint32_t extended = hash;
+    size_t i;
+
+    for( i = 0U; i < length; i++ )
+    {
+        extended ^= ( uint32_t ) ( uint8_t ) pCharacters[ i ];
+        extended *= ( uint32_t ) FNV_PRIME;
+    }
+
+    return extended;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t extendHashWithPosition( uint32_t hash,
+                                        uint32_t position )
+{
+    char digits[ POSITION_MAX_DIGITS + 2U ];
+    size_t start = sizeof( digits ) - 1U;
+    uint32_t remaining = position;
+
+    /* Write "[position]" backwards from the end of the buffer. */
+    digits[ start ] = ']';
+
+    do
+    {
+        start--;
+        digits[ start ] = ( char ) ( '0' + ( char ) ( remaining % 10U ) );
+        remaining /= 10U;
+    } while( remaining > 0U );
+
+    return extendHash( extendHash( hash, "[", 1U ),
+                       &digits[ start ],
+                       sizeof( digits ) - start );
+}
+/*-----------------------------------------------------------*/
+
+static JsonIndexStatus_t addEntry( JsonIndex_t * pIndex,
+                                   const ContainerFrame_t * pParent,
+                                   uint32_t key,
+                                   uint32_t keyLength,
+                                   uint16_t * pEntry,
+                                   bool * pIsHidden )
+{
+    JsonIndexStatus_t status = JsonIndexSuccess;
+    const JsonIndexEntry_t * pOther;
+    JsonIndexEntry_t * pNew;
+    uint32_t pathHash;
+    uint16_t slot;
+    bool isHidden = pParent->isHidden;
+
+    if( pIndex->entryCount == pIndex->capacity )
+    {
+        status = JsonIndexFull;
+    }
+    else
+    {
+        if( keyLength == ARRAY_ELEMENT_KEY_LENGTH )
+        {
+            pathHash = extendHashWithPosition( pParent->pathHash, key );
+        }
+        else if( pParent->entry == NO_ENTRY )
+        {
+            pathHash = extendHash( pParent->pathHash, &pIndex->pDocument[ key ], keyLength );
+        }
+        else
+        {
+            pathHash = extendHash( extendHash( pParent->pathHash, ".", 1U ),
+                                   &pIndex->pDocument[ key ],
+                                   keyLength );
+        }
+
+        pNew = &( pIndex->pEntries[ pIndex->entryCount ] );
+        pNew->pathHash = pathHash;
+        pNew->key = key;
+        pNew->keyLength = keyLength;
+        pNew->valueOffset = 0U;
+        pNew->valueLength = 0U;
+        pNew->parent = pParent->entry;
+        pNew->type = ( uint8_t ) JsonIndexNull;
+
+        /* A key path cannot name a key with a period or a bracket. */
+        if( ( keyLength != ARRAY_ELEMENT_KEY_LENGTH ) &&
+            ( ( memchr( &pIndex->pDocument[ key ], '.', keyLength ) != NULL ) ||
+              ( memchr( &pIndex->pDocument[ key ], '[', keyLength ) != NULL ) ) )
+        {
+            isHidden = true;
+        }
+
+        /* The first value of a key path is in the probe sequence before the
+         * first empty slot. As the container of the value is not hidden, it
+         * is the only one at its key path, so the first value would be in
+         * the same container. There is always an empty slot as the table has
+         * twice as many slots as entries. */
+        slot = ( uint16_t ) ( pathHash % pIndex->slotCount );
+
+        while( ( isHidden == false ) && ( pIndex->pSlots[ slot ] != NO_ENTRY ) )
+        {
+            pOther = &( pIndex->pEntries[ pIndex->pSlots[ slot ] ] );
+
+            if( ( pOther->pathHash == pathHash ) &&
+                ( pOther->parent == pParent->entry ) &&
+                ( pOther->keyLength == keyLength ) &&
+                ( keyLength != ARRAY_ELEMENT_KEY_LENGTH ) &&
+                ( memcmp( &pIndex->pDocument[ pOther->key ], &pIndex->pDocument[ key ], keyLength ) == 0 ) )
+            {
+                isHidden = true;
+            }
+            else
+            {
+                slot = ( uint16_t ) ( ( slot + 1U ) % pIndex->slotCount );
+            }
+        }
+
+        if( isHidden == false )
+        {
+            pIndex->pSlots[ slot ] = pIndex->entryCount;
+        }
+
+        *pEntry = pIndex->entryCount;
+        *pIsHidden = isHidden;
+        pIndex->entryCount++;
+    }
+
+    return status;
+}
+/*-----------------------------------------------------------*/
+
+static bool matchesPath( const JsonIndex_t * pIndex,
+                         uint16_t entry,
+                         const char * pQuery,
+                         size_t queryLength )
+{
+    const JsonIndexEntry_t * pEntry;
+    size_t end = queryLength;
+    uint16_t current = entry;
+    uint32_t remaining;
+    bool matches = true;
+
+    while( ( matches == true ) && ( current != NO_ENTRY ) )
+    {
+        pEntry = &( pIndex->pEntries[ current ] );
+
+        if( pEntry->keyLength == ARRAY_ELEMENT_KEY_LENGTH )
+        {
+            /* Match "[position]" from its closing bracket. */
+            remaining = pEntry->key;
+            matches = ( end > 0U ) && ( pQuery[ end - 1U ] == ']' );
+            end--;
+
+            do
+            {
+                matches = matches && ( end > 0U ) &&
+                          ( pQuery[ end - 1U ] == ( char ) ( '0' + ( char ) ( remaining % 10U ) ) );
+                end--;
+                remaining /= 10U;
+            } while( ( matches == true ) && ( remaining > 0U ) );
+
+            matches = matches && ( end > 0U ) && ( pQuery[ end - 1U ] == '[' );
+            end--;
+        }
+        else
+        {
+            matches = ( end >= pEntry->keyLength ) &&
+                      ( memcmp( &pQuery[ end - pEntry->keyLength ],
+                                &pIndex->pDocument[ pEntry->key ],
+                                pEntry->keyLength ) == 0 );
+            end -= pEntry->keyLength;
+
+            /* A key nested in an object or array follows a period. */
+            if( ( matches == true ) && ( pEntry->parent != NO_ENTRY ) )
+            {
+                matches = ( end > 0U ) && ( pQuery[ end - 1U ] == '.' );
+                end--;
+            }
+        }
+
+        current = pEntry->parent;
+    }
+
+    return ( matches == true ) && ( end == 0U );
+}
+/*-----------------------------------------------------------*/
+
+static JsonIndexStatus_t indexDocument( JsonIndex_t * pIndex,
+                                        const char * pDocument,
+                                        size_t documentLength,
+                                        JsonIndexEntry_t * pEntries,
+                                        uint16_t capacity,
+                                        uint16_t * pSlots )
+{
+    JsonIndexStatus_t status = JsonIndexSuccess;
+    ContainerFrame_t frames[ JSON_INDEX_MAX_DEPTH ];
+    ContainerFrame_t * pFrame;
+    JsonIndexEntry_t * pEntry;
+    JsonIndexType_t type = JsonIndexNull;
+    size_t depth = 0U, start = 0U, valueStart, i;
+    uint32_t key = 0U, keyLength = 0U;
+    uint16_t entry = NO_ENTRY;
+    bool isHidden = false;
+    char closing;
+
+    if( ( pIndex == NULL ) || ( pDocument == NULL ) || ( documentLength == 0U ) ||
+        ( ( uint64_t ) documentLength > ( uint64_t ) UINT32_MAX ) ||
+        ( pEntries == NULL ) || ( pSlots == NULL ) ||
+        ( capacity == 0U ) || ( capacity > JSON_INDEX_MAX_CAPACITY ) )
+    {
+        status = JsonIndexBadParameter;
+    }
+    else
+    {
+        pIndex->pDocument = pDocument;
+        pIndex->documentLength = documentLength;
+        pIndex->isSearched = false;
+        pIndex->pEntries = pEntries;
+        pIndex->pSlots = pSlots;
+        pIndex->capacity = capacity;
+        pIndex->slotCount = ( uint16_t ) JSON_INDEX_SLOT_COUNT( capacity );
+        pIndex->entryCount = 0U;
+
+        for( i = 0U; i < pIndex->slotCount; i++ )
+        {
+            pSlots[ i ] = NO_ENTRY;
+        }
+
+        /* The top-level value has no entry; a scalar is only validated. */
+        skipSpace( pDocument, &start, documentLength );
+
+        if( ( start < documentLength ) &&
+            ( ( pDocument[ start ] == '{' ) || ( pDocument[ start ] == '[' ) ) )
+        {
+            frames[ 0 ].pathHash = ( uint32_t ) FNV_OFFSET_BASIS;
+            frames[ 0 ].count = 0U;
+            frames[ 0 ].entry = NO_ENTRY;
+            frames[ 0 ].isArray = ( pDocument[ start ] == '[' );
+            frames[ 0 ].isHidden = false;
+            depth = 1U;
+            start++;
+        }
+        else if( skipScalar( pDocument, &start, documentLength, &type ) == false )
+        {
+            status = JsonIndexIllegalDocument;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+    }
+
+    /* Each iteration is either at the start of a container or after one of
+     * its values, and parses the closing of the container or its next key
+     * and value. */
+    while( ( status == JsonIndexSuccess ) && ( depth > 0U ) )
+    {
+        pFrame = &( frames[ depth - 1U ] );
+        closing = ( pFrame->isArray == true ) ? ']' : '}';
+        skipSpace( pDocument, &start, documentLength );
+
+        if( start >= documentLength )
+        {
+            status = JsonIndexIllegalDocument;
+        }
+        else if( pDocument[ start ] == closing )
+        {
+            if( pFrame->entry != NO_ENTRY )
+            {
+                pEntry = &( pEntries[ pFrame->entry ] );
+                pEntry->valueLength = ( uint32_t ) ( start + 1U ) - pEntry->valueOffset;
+            }
+
+            start++;
+            depth--;
+        }
+        else if( ( pFrame->count > 0U ) && ( pDocument[ start ] != ',' ) )
+        {
+            status = JsonIndexIllegalDocument;
+        }
+        else
+        {
+            if( pFrame->count > 0U )
+            {
+                start++;
+                skipSpace( pDocument, &start, documentLength );
+            }
+
+            if( pFrame->isArray == true )
+            {
+                key = pFrame->count;
+                keyLength = ARRAY_ELEMENT_KEY_LENGTH;
+            }
+            else
+            {
+                valueStart = start;
+
+                if( skipString( pDocument, &start, documentLength ) == false )
+                {
+                    status = JsonIndexIllegalDocument;
+                }
+                else
+                {
+                    /* The key is stored without its quotes. */
+                    key = ( uint32_t ) valueStart + 1U;
+                    keyLength = ( uint32_t ) ( start - valueStart ) - 2U;
+                    skipSpace( pDocument, &start, documentLength );
+
+                    if( ( start < documentLength ) && ( pDocument[ start ] == ':' ) )
+                    {
+                        start++;
+                        skipSpace( pDocument, &start, documentLength );
+                    }
+                    else
+                    {
+                        status = JsonIndexIllegalDocument;
+                    }
+                }
+            }
+
+            if( status == JsonIndexSuccess )
+            {
+                pFrame->count++;
+                status = addEntry( pIndex, pFrame, key, keyLength, &entry, &isHidden );
+            }
+
+            if( status != JsonIndexSuccess )
+            {
+                /* Empty else MISRA 15.7 */
+            }
+            else if( ( start < documentLength ) &&
+                     ( ( pDocument[ start ] == '{' ) || ( pDocument[ start ] == '[' ) ) )
+            {
+                if( depth == JSON_INDEX_MAX_DEPTH )
+                {
+                    status = JsonIndexMaxDepthExceeded;
+                }
+                else
+                {
+                    pEntry = &( pEntries[ entry ] );
+                    pEntry->type = ( uint8_t ) ( ( pDocument[ start ] == '[' ) ? JsonIndexArray : JsonIndexObject );
+                    pEntry->valueOffset = ( uint32_t ) start;
+
+                    frames[ depth ].pathHash = pEntry->pathHash;
+                    frames[ depth ].count = 0U;
+                    frames[ depth ].entry = entry;
+                    frames[ depth ].isArray = ( pDocument[ start ] == '[' );
+                    frames[ depth ].isHidden = isHidden;
+                    depth++;
+                    start++;
+                }
+            }
+            else
+            {
+                valueStart = start;
+
+                if( skipScalar( pDocument, &start, documentLength, &type ) == false )
+                {
+                    status = JsonIndexIllegalDocument;
+                }
+                else
+                {
+                    pEntry = &( pEntries[ entry ] );
+                    pEntry->type = ( uint8_t ) type;
+
+                    if( type == JsonIndexString )
+                    {
+                        pEntry->valueOffset = ( uint32_t ) valueStart + 1U;
+                        pEntry->valueLength = ( uint32_t ) ( start - valueStart ) - 2U;
+                    }
+                    else
+                    {
+                        pEntry->valueOffset = ( uint32_t ) valueStart;
+                        pEntry->valueLength = ( uint32_t ) ( start - valueStart );
+                    }
+                }
+            }
+        }
+    }
+
+    if( status == JsonIndexSuccess )
+    {
+        /* Only whitespace may follow the top-level value. */
+        skipSpace( pDocument, &start, documentLength );
+
+        if( start != documentLength )
+        {
+            status = JsonIndexIllegalDocument;
+        }
+    }
+
+    return status;
+}
+/*-----------------------------------------------------------*/
+
+static JsonIndexStatus_t searchDocument( const JsonIndex_t * pIndex,
+                                         const char * pQuery,
+                                         size_t queryLength,
+                                         const char ** ppValue,
+                                         size_t * pValueLength,
+                                         JsonIndexType_t * pType )
+{
+    JsonIndexStatus_t status = JsonIndexNotFound;
+    JSONTypes_t jsonType = JSONInvalid;
+
+    if( JSON_SearchConst( pIndex->pDocument,
+                          pIndex->documentLength,
+                          pQuery,
+                          queryLength,
+                          ppValue,
+                          pValueLength,
+                          &jsonType ) == JSONSuccess )
+    {
+        status = JsonIndexSuccess;
+
+        if( pType != NULL )
+        {
+            switch( jsonType )
+            {
+                case JSONString:
+                    *pType = JsonIndexString;
+                    break;
+
+                case JSONNumber:
+                    *pType = JsonIndexNumber;
+                    break;
+
+                case JSONTrue:
+                    *pType = JsonIndexTrue;
+                    break;
+
+                case JSONFalse:
+                    *pType = JsonIndexFalse;
+                    break;
+
+                case JSONObject:
+                    *pType = JsonIndexObject;
+                    break;
+
+                case JSONArray:
+                    *pType = JsonIndexArray;
+                    break;
+
+                default:
+                    *pType = JsonIndexNull;
+                    break;
+            }
+        }
+    }
+
+    return status;
+}
+/*-----------------------------------------------------------*/
+
+JsonIndexStatus_t JsonIndex_Build( JsonIndex_t * pIndex,
+                                   const char * pDocument,
+                                   size_t documentLength,
+                                   JsonIndexEntry_t * pEntries,
+                                   uint16_t capacity,
+                                   uint16_t * pSlots )
+{
+    JsonIndexStatus_t status = JsonIndexSuccess;
+
+    status = indexDocument( pIndex, pDocument, documentLength, pEntries, capacity, pSlots );
+
+    /* coreJSON decides on the documents that the index cannot hold or does
+     * not accept. The values of those it accepts are searched for. */
+    if( ( status == JsonIndexFull ) ||
+        ( status == JsonIndexIllegalDocument ) ||
+        ( status == JsonIndexMaxDepthExceeded ) )
+    {
+        switch( JSON_Validate( pDocument, documentLength ) )
+        {
+            case JSONSuccess:
+                pIndex->isSearched = true;
+                status = JsonIndexSuccess;
+                break;
+
+            case JSONMaxDepthExceeded:
+                status = JsonIndexMaxDepthExceeded;
+                break;
+
+            default:
+                status = JsonIndexIllegalDocument;
+                break;
+        }
+    }
+
+    return status;
+}
+/*-----------------------------------------------------------*/
+
+JsonIndexStatus_t JsonIndex_Find( const JsonIndex_t * pIndex,
+                                  const char * pQuery,
+                                  size_t queryLength,
+                                  const char ** ppValue,
+                                  size_t * pValueLength,
+                                  JsonIndexType_t * pType )
+{
+    JsonIndexStatus_t status = JsonIndexNotFound;
+    const JsonIndexEntry_t * pEntry;
+    uint32_t pathHash;
+    uint16_t slot;
+
+    if( ( pIndex == NULL ) || ( pIndex->pSlots == NULL ) || ( pQuery == NULL ) ||
+        ( queryLength == 0U ) || ( ppValue == NULL ) || ( pValueLength == NULL ) )
+    {
+        status = JsonIndexBadParameter;
+    }
+    else if( pIndex->isSearched == true )
+    {
+        status = searchDocument( pIndex, pQuery, queryLength, ppValue, pValueLength, pType );
+    }
+    else
+    {
+        pathHash = extendHash( ( uint32_t ) FNV_OFFSET_BASIS, pQuery, queryLength );
+        slot = ( uint16_t ) ( pathHash % pIndex->slotCount );
+
+        /* The first match in the probe sequence is the first value at the
+         * key path. */
+        while( ( status == JsonIndexNotFound ) && ( pIndex->pSlots[ slot ] != NO_ENTRY ) )
+        {
+            pEntry = &( pIndex->pEntries[ pIndex->pSlots[ slot ] ] );
+
+            if( ( pEntry->pathHash == pathHash ) &&
+                ( matchesPath( pIndex, pIndex->pSlots[ slot ], pQuery, queryLength ) == true ) )
+            {
+                *ppValue = &( pIndex->pDocument[ pEntry->valueOffset ] );
+                *pValueLength = pEntry->valueLength;
+
+                if( pType != NULL )
+                {
+                    *pType = ( JsonIndexType_t ) pEntry->type;
+                }
+
+                status = JsonIndexSuccess;
+            }
+            else
+            {
+                slot = ( uint16_t ) ( ( slot + 1U ) % pIndex->slotCount );
+            }
+        }
+    }
+
+    return status;
+}
+/*-----------------------------------------------------------*/
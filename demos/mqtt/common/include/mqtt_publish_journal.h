@@ -0,0 +1,233 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file mqtt_publish_journal.h
+ * @brief The API of a file journal that keeps outgoing QoS 1 publishes until
+ * they are acknowledged, so that they can be sent again after the process
+ * restarts.
+ */
+
+#ifndef MQTT_PUBLISH_JOURNAL_H_
+#define MQTT_PUBLISH_JOURNAL_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Logging related header files are required to be included in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define LIBRARY_LOG_NAME and  LIBRARY_LOG_LEVEL.
+ * 3. Include the header file "logging_stack.h".
+ */
+
+/* Include header that defines log levels. */
+#include "logging_levels.h"
+
+/* Logging configuration for the publish journal. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME     "MQTT Publish Journal"
+#endif
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/* Standard includes. */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* POSIX includes. */
+#include <pthread.h>
+
+/* Include MQTT library. */
+#include "core_mqtt.h"
+
+/* Include header for the retransmission store. */
+#include "mqtt_retransmit_store.h"
+
+/**
+ * @brief Size in bytes of the journal file. Records are appended until the
+ * file is full, then the acknowledged ones are compacted away.
+ */
+#ifndef MQTT_PUBLISH_JOURNAL_FILE_SIZE
+    #define MQTT_PUBLISH_JOURNAL_FILE_SIZE    ( 1024U * 1024U )
+#endif
+
+/**
+ * @brief Number of publishes a journal can keep unacknowledged at once.
+ */
+#ifndef MQTT_PUBLISH_JOURNAL_MAX_LIVE
+    #define MQTT_PUBLISH_JOURNAL_MAX_LIVE    ( 64U )
+#endif
+
+/**
+ * @brief Longest time in milliseconds between appending a record and writing
+ * it to disk. All the records appended in that time share one sync.
+ */
+#ifndef MQTT_PUBLISH_JOURNAL_COMMIT_INTERVAL_MS
+    #define MQTT_PUBLISH_JOURNAL_COMMIT_INTERVAL_MS    ( 20U )
+#endif
+
+/**
+ * @brief Size of the journal file beyond which it is compacted in the
+ * background, provided at least a quarter of the file can be reclaimed.
+ */
+#ifndef MQTT_PUBLISH_JOURNAL_COMPACT_THRESHOLD
+    #define MQTT_PUBLISH_JOURNAL_COMPACT_THRESHOLD    ( ( MQTT_PUBLISH_JOURNAL_FILE_SIZE / 4U ) * 3U )
+#endif
+
+/**
+ * @brief Longest path of a journal file, including the suffix of the file a
+ * journal is compacted into.
+ */
+#ifndef MQTT_PUBLISH_JOURNAL_PATH_MAX
+    #define MQTT_PUBLISH_JOURNAL_PATH_MAX    ( 256U )
+#endif
+
+/**
+ * @brief Number of slots of the index of a journal.
+ */
+#define MQTT_PUBLISH_JOURNAL_INDEX_SIZE    ( 2U * MQTT_PUBLISH_JOURNAL_MAX_LIVE )
+
+/**
+ * @brief A slot of the index of the live publishes of a journal.
+ */
+typedef struct MqttPublishJournalSlot
+{
+    uint32_t offset;   /**< @brief Offset of the publish record in the journal file. */
+    uint16_t packetId; /**< @brief Packet identifier of the publish, 0 for an empty slot. */
+} MqttPublishJournalSlot_t;
+
+/**
+ * @brief A journal of outgoing publishes.
+ *
+ * Publish, acknowledgement and reset records are appended to a memory-mapped
+ * file, each protected by a CRC. A record is safe from a process crash as
+ * soon as it is appended; a thread syncs the file every
+ * #MQTT_PUBLISH_JOURNAL_COMMIT_INTERVAL_MS to make the records safe from a
+ * power loss, and rewrites the file with only the live publishes when it
+ * fills up. The members are private to the journal; use the
+ * MqttPublishJournal_* functions to access them.
+ */
+typedef struct MqttPublishJournal
+{
+    pthread_mutex_t lock;                                              /**< @brief Protects the members below. */
+    pthread_cond_t wakeup;                                             /**< @brief Signalled to the committer thread, and when a sync or compaction ends. */
+    pthread_t committer;                                               /**< @brief Thread that syncs and compacts the file. */
+    char path[ MQTT_PUBLISH_JOURNAL_PATH_MAX ];                        /**< @brief Path of the journal file. */
+    int fileDescriptor;                                                /**< @brief The journal file. */
+    uint8_t * pMapping;                                                /**< @brief Mapping of the journal file. */
+    uint32_t tail;                                                     /**< @brief End of the last record. */
+    uint32_t syncedTail;                                               /**< @brief End of the records known to be on disk. */
+    uint32_t liveBytes;                                                /**< @brief Size of the records of the live publishes. */
+    MqttPublishJournalSlot_t index[ MQTT_PUBLISH_JOURNAL_INDEX_SIZE ]; /**< @brief Open-addressing index of the live publishes by packet identifier. */
+    uint16_t liveCount;                                                /**< @brief Number of live publishes. */
+    bool isSyncing;                                                    /**< @brief Whether the committer is syncing the mapping without the lock. */
+    bool isCompacting;                                                 /**< @brief Whether the file is being compacted. */
+    bool isStopping;                                                   /**< @brief Whether the committer thread must exit. */
+    const uint8_t * pRecovered;                                        /**< @brief Mapping of the file found when the journal was opened. */
+    size_t recoveredSize;                                              /**< @brief Size of #pRecovered. */
+    uint32_t restoredOffsets[ MQTT_PUBLISH_JOURNAL_MAX_LIVE ];         /**< @brief Offsets in #pRecovered of the restored publishes, 0 once acknowledged. */
+    uint16_t restoredCount;                                            /**< @brief Number of entries of #restoredOffsets. */
+    uint16_t restoredLive;                                             /**< @brief Number of restored publishes not acknowledged yet. */
+} MqttPublishJournal_t;
+
+/**
+ * @brief Open a journal file, creating it if needed, and start the thread
+ * that syncs and compacts it.
+ *
+ * The live publishes of a journal left by an earlier process are kept for
+ * #MqttPublishJournal_Restore.
+ *
+ * @param[out] pJournal The journal to open.
+ * @param[in] pPath Path of the journal file.
+ *
+ * @return true on success; false if the file could not be opened, created or
+ * mapped.
+ */
+bool MqttPublishJournal_Open( MqttPublishJournal_t * pJournal,
+                              const char * pPath );
+
+/**
+ * @brief Sync a journal and release its resources.
+ *
+ * @param[in] pJournal The journal.
+ */
+void MqttPublishJournal_Close( MqttPublishJournal_t * pJournal );
+
+/**
+ * @brief Add the live publishes found when a journal was opened to a store,
+ * in the order they were first sent.
+ *
+ * Their topics and payloads point into the old journal file, which stays
+ * mapped until all of them are acknowledged or the journal is cleared or
+ * closed. The MQTT library has no record of them, so send them with
+ * #MqttRetransmitStore_PublishAll.
+ *
+ * @param[in] pJournal The journal.
+ * @param[in] pStore The store.
+ *
+ * @return Number of publishes added to the store.
+ */
+uint16_t MqttPublishJournal_Restore( MqttPublishJournal_t * pJournal,
+                                     MqttRetransmitStore_t * pStore );
+
+/**
+ * @brief Record an outgoing publish before it is sent.
+ *
+ * @param[in] pJournal The journal.
+ * @param[in] packetId Packet identifier the publish is sent with.
+ * @param[in] pPublishInfo The publish.
+ *
+ * @return true if the publish was recorded; false if the journal already
+ * keeps #MQTT_PUBLISH_JOURNAL_MAX_LIVE publishes or a publish with
+ * @p packetId, or its file is full of live publishes.
+ */
+bool MqttPublishJournal_Append( MqttPublishJournal_t * pJournal,
+                                uint16_t packetId,
+                                const MQTTPublishInfo_t * pPublishInfo );
+
+/**
+ * @brief Record that the publish sent with a packet identifier was
+ * acknowledged, or will not be sent.
+ *
+ * @param[in] pJournal The journal.
+ * @param[in] packetId The packet identifier.
+ *
+ * @return true if the journal kept a publish for the packet identifier.
+ */
+bool MqttPublishJournal_Ack( MqttPublishJournal_t * pJournal,
+                             uint16_t packetId );
+
+/**
+ * @brief Record that none of the publishes kept will be sent, when a session
+ * is not resumed.
+ *
+ * @param[in] pJournal The journal.
+ */
+void MqttPublishJournal_Clear( MqttPublishJournal_t * pJournal );
+
+#endif /* ifndef MQTT_PUBLISH_JOURNAL_H_ */
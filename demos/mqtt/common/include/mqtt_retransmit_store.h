@@ -0,0 +1,240 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file mqtt_retransmit_store.h
+ * @brief The API of a store that keeps outgoing QoS 1 publishes until they
+ * are acknowledged, and resends them when a session is resumed.
+ */
+
+#ifndef MQTT_RETRANSMIT_STORE_H_
+#define MQTT_RETRANSMIT_STORE_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Logging related header files are required to be included in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define LIBRARY_LOG_NAME and  LIBRARY_LOG_LEVEL.
+ * 3. Include the header file "logging_stack.h".
+ */
+
+/* Include header that defines log levels. */
+#include "logging_levels.h"
+
+/* Logging configuration for the retransmission store. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME     "MQTT Retransmit Store"
+#endif
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/* Standard includes. */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Include MQTT library. */
+#include "core_mqtt.h"
+
+/**
+ * @brief Number of publishes whose packets are built for each call to the
+ * writev function of the transport when the store is flushed.
+ */
+#ifndef MQTT_RETRANSMIT_STORE_FLUSH_BATCH
+    #define MQTT_RETRANSMIT_STORE_FLUSH_BATCH    ( 32U )
+#endif
+
+/**
+ * @brief Size of the stack buffer that the packets of a flush are copied into
+ * before each send, when the transport has no writev function.
+ */
+#ifndef MQTT_RETRANSMIT_STORE_SEND_BUFFER_SIZE
+    #define MQTT_RETRANSMIT_STORE_SEND_BUFFER_SIZE    ( 1024U )
+#endif
+
+/**
+ * @brief Time in milliseconds a flush keeps retrying while the transport
+ * accepts no data.
+ */
+#ifndef MQTT_RETRANSMIT_STORE_SEND_TIMEOUT_MS
+    #define MQTT_RETRANSMIT_STORE_SEND_TIMEOUT_MS    ( 5000U )
+#endif
+
+/**
+ * @brief Number of index slots needed by a store of @p capacity publishes.
+ * Twice the capacity keeps probe sequences short.
+ */
+#define MQTT_RETRANSMIT_STORE_INDEX_SIZE( capacity )    ( 2U * ( capacity ) )
+
+/**
+ * @brief A publish kept by a store.
+ */
+typedef struct MqttRetransmitEntry
+{
+    MQTTPublishInfo_t publishInfo; /**< @brief The publish. Its topic and payload are not copied. */
+    uint16_t packetId;             /**< @brief Packet identifier the publish was sent with. */
+    uint16_t next;                 /**< @brief Next entry of the pending list, or of the free list. */
+    uint16_t previous;             /**< @brief Previous entry of the pending list. */
+} MqttRetransmitEntry_t;
+
+/**
+ * @brief A store of unacknowledged publishes.
+ *
+ * Publishes are found by packet identifier through an open-addressing index,
+ * free entries are kept in a list, and pending publishes in a list in the
+ * order they were added, so that adding and removing a publish take constant
+ * time and a resend only visits pending publishes. The members are private to
+ * the store; use the MqttRetransmitStore_* functions to access them.
+ */
+typedef struct MqttRetransmitStore
+{
+    MqttRetransmitEntry_t * pEntries; /**< @brief The entries of the store. */
+    uint16_t * pIndex;                /**< @brief Index of #pEntries by packet identifier. */
+    uint16_t capacity;                /**< @brief Number of entries of the store. */
+    uint16_t indexSize;               /**< @brief Number of slots of #pIndex. */
+    uint16_t freeHead;                /**< @brief First free entry. */
+    uint16_t pendingHead;             /**< @brief Oldest pending publish. */
+    uint16_t pendingTail;             /**< @brief Newest pending publish. */
+    uint16_t pendingCount;            /**< @brief Number of pending publishes. */
+} MqttRetransmitStore_t;
+
+/**
+ * @brief Make all the entries of a store free.
+ *
+ * @param[out] pStore The store to initialize.
+ * @param[in] pEntries Storage for the publishes, of @p capacity entries.
+ * @param[in] capacity Number of publishes the store can keep, less than
+ * UINT16_MAX / 2.
+ * @param[in] pIndex Storage for the index, of
+ * #MQTT_RETRANSMIT_STORE_INDEX_SIZE( @p capacity ) slots.
+ */
+void MqttRetransmitStore_Init( MqttRetransmitStore_t * pStore,
+                               MqttRetransmitEntry_t * pEntries,
+                               uint16_t capacity,
+                               uint16_t * pIndex );
+
+/**
+ * @brief Keep a publish until it is acknowledged.
+ *
+ * The publish info is copied, but its topic and payload must stay valid
+ * until the publish is removed.
+ *
+ * @param[in] pStore The store.
+ * @param[in] packetId Packet identifier the publish is sent with.
+ * @param[in] pPublishInfo The publish.
+ *
+ * @return true if the publish was added; false if the store is full or
+ * already keeps a publish with @p packetId.
+ */
+bool MqttRetransmitStore_Add( MqttRetransmitStore_t * pStore,
+                              uint16_t packetId,
+                              const MQTTPublishInfo_t * pPublishInfo );
+
+/**
+ * @brief Forget the publish sent with a packet identifier, after it was
+ * acknowledged or could not be sent.
+ *
+ * @param[in] pStore The store.
+ * @param[in] packetId The packet identifier.
+ *
+ * @return true if a publish was kept for the packet identifier.
+ */
+bool MqttRetransmitStore_Remove( MqttRetransmitStore_t * pStore,
+                                 uint16_t packetId );
+
+/**
+ * @brief Check whether a publish is kept for a packet identifier.
+ *
+ * @param[in] pStore The store.
+ * @param[in] packetId The packet identifier.
+ *
+ * @return true if a publish is kept for the packet identifier.
+ */
+bool MqttRetransmitStore_Contains( const MqttRetransmitStore_t * pStore,
+                                   uint16_t packetId );
+
+/**
+ * @brief Forget all the publishes, when a session is not resumed.
+ *
+ * @param[in] pStore The store.
+ */
+void MqttRetransmitStore_Clear( MqttRetransmitStore_t * pStore );
+
+/**
+ * @brief Get the number of publishes waiting for their acknowledgement.
+ *
+ * @param[in] pStore The store.
+ *
+ * @return The number of publishes.
+ */
+uint16_t MqttRetransmitStore_PendingCount( const MqttRetransmitStore_t * pStore );
+
+/**
+ * @brief Send all the pending publishes again with the DUP flag set, after a
+ * session was resumed.
+ *
+ * The packets are written in the order the publishes were added, without
+ * copying topics or payloads, through the writev function of the transport
+ * of the MQTT context in batches of #MQTT_RETRANSMIT_STORE_FLUSH_BATCH
+ * publishes. If the transport has no writev function, the packets are copied
+ * #MQTT_RETRANSMIT_STORE_SEND_BUFFER_SIZE bytes at a time and sent through
+ * its send function. The outgoing publish records of the resumed session
+ * already hold the packet identifiers, so the acknowledgements are processed
+ * by the MQTT library as for publishes sent with MQTT_Publish.
+ *
+ * Must be called from the thread that owns the MQTT context.
+ *
+ * @param[in] pStore The store.
+ * @param[in] pMqttContext The connected MQTT context.
+ *
+ * @return #MQTTSuccess if all the publishes were sent; #MQTTSendFailed if
+ * the transport failed; or the status of serializing a publish.
+ */
+MQTTStatus_t MqttRetransmitStore_ResendAll( MqttRetransmitStore_t * pStore,
+                                            MQTTContext_t * pMqttContext );
+
+/**
+ * @brief Send all the pending publishes again with the DUP flag set, one
+ * MQTT_Publish call at a time.
+ *
+ * Unlike #MqttRetransmitStore_ResendAll, this lets the MQTT library create
+ * the outgoing publish records it needs to process the acknowledgements. Use
+ * it for publishes the MQTT context has no record of, such as publishes
+ * restored after the process restarted.
+ *
+ * @param[in] pStore The store.
+ * @param[in] pMqttContext The connected MQTT context.
+ *
+ * @return #MQTTSuccess if all the publishes were sent; otherwise the status
+ * of the MQTT_Publish call that failed.
+ */
+MQTTStatus_t MqttRetransmitStore_PublishAll( MqttRetransmitStore_t * pStore,
+                                             MQTTContext_t * pMqttContext );
+
+#endif /* ifndef MQTT_RETRANSMIT_STORE_H_ */
@@ -0,0 +1,1417 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file mqtt_publish_journal.c
+ * @brief Implementation of a file journal that keeps outgoing QoS 1 publishes
+ * until they are acknowledged.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+/* POSIX includes. */
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Include header for the publish journal. */
+#include "mqtt_publish_journal.h"
+
+/**
+ * @brief Marks the start of a journal file: "MQJ1" read as a little-endian
+ * integer.
+ */
+#define JOURNAL_MAGIC                  ( 0x314A514DUL )
+
+/**
+ * @brief Version of the layout of the journal file.
+ */
+#define JOURNAL_VERSION                ( 1U )
+
+/**
+ * @brief Size of the header at the start of the journal file.
+ */
+#define FILE_HEADER_SIZE               ( ( uint32_t ) sizeof( JournalFileHeader_t ) )
+
+/**
+ * @brief Size of the header of a record.
+ */
+#define RECORD_HEADER_SIZE             ( ( uint32_t ) sizeof( JournalRecordHeader_t ) )
+
+/**
+ * @brief Records start at multiples of this size.
+ */
+#define RECORD_ALIGNMENT               ( 8U )
+
+/**
+ * @brief Size of the part of a record header covered by its CRC.
+ */
+#define RECORD_HEADER_CRC_OFFSET       ( ( uint32_t ) sizeof( uint32_t ) )
+
+/**
+ * @brief A record keeping an outgoing publish.
+ */
+#define RECORD_TYPE_PUBLISH            ( 1U )
+
+/**
+ * @brief A record marking the publish with a packet identifier as
+ * acknowledged.
+ */
+#define RECORD_TYPE_ACK                ( 2U )
+
+/**
+ * @brief A record marking all the publishes before it as acknowledged.
+ */
+#define RECORD_TYPE_RESET              ( 3U )
+
+/**
+ * @brief Invalid packet identifier, marking an empty index slot. Zero is
+ * always an invalid packet identifier as per MQTT 3.1.1 spec.
+ */
+#define PACKET_ID_INVALID              ( ( uint16_t ) 0U )
+
+/**
+ * @brief Marker for the absence of an index slot.
+ */
+#define NO_POSITION                    ( UINT16_MAX )
+
+/**
+ * @brief Suffix of the path of the file a journal is compacted into.
+ */
+#define COMPACT_PATH_SUFFIX            ".compact"
+
+/**
+ * @brief Polynomial of the CRC-32 used by Ethernet and zlib, reversed.
+ */
+#define CRC32_POLYNOMIAL               ( 0xEDB88320UL )
+
+/**
+ * @brief Nanoseconds per millisecond.
+ */
+#define NANOSECONDS_PER_MILLISECOND    ( 1000000L )
+
+/**
+ * @brief Nanoseconds per second.
+ */
+#define NANOSECONDS_PER_SECOND         ( 1000000000L )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Header at the start of the journal file.
+ */
+typedef struct JournalFileHeader
+{
+    uint32_t magic;    /**< @brief #JOURNAL_MAGIC. */
+    uint32_t version;  /**< @brief #JOURNAL_VERSION. */
+    uint32_t fileSize; /**< @brief Size of the file when it was created. */
+    uint32_t reserved; /**< @brief Zero. */
+} JournalFileHeader_t;
+
+/**
+ * @brief Header of a record, followed by the topic and the payload of a
+ * publish record.
+ */
+typedef struct JournalRecordHeader
+{
+    uint32_t crc;           /**< @brief CRC-32 of the rest of the header, the topic and the payload. */
+    uint32_t payloadLength; /**< @brief Length of the payload. */
+    uint16_t packetId;      /**< @brief Packet identifier of the publish. */
+    uint16_t topicLength;   /**< @brief Length of the topic. */
+    uint8_t type;           /**< @brief One of the RECORD_TYPE_* values. */
+    uint8_t qos;            /**< @brief QoS of the publish. */
+    uint8_t retain;         /**< @brief Retain flag of the publish. */
+    uint8_t reserved;       /**< @brief Zero. */
+} JournalRecordHeader_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Table of the CRC-32 of every byte value.
+ */
+static uint32_t crcTable[ 256 ];
+
+/**
+ * @brief Makes #crcTable be filled only once.
+ */
+static pthread_once_t crcTableOnce = PTHREAD_ONCE_INIT;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Fill #crcTable.
+ */
+static void initCrcTable( void );
+
+/**
+ * @brief Continue a CRC-32 over a buffer.
+ *
+ * @param[in] crc The CRC of the data before the buffer, 0 at the start.
+ * @param[in] pData The buffer.
+ * @param[in] length Length of the buffer.
+ *
+ * @return The CRC of the data up to the end of the buffer.
+ */
+static uint32_t updateCrc( uint32_t crc,
+                           const uint8_t * pData,
+                           size_t length );
+
+/**
+ * @brief Get the size a record takes in the file.
+ *
+ * @param[in] topicLength Length of the topic of the record.
+ * @param[in] payloadLength Length of the payload of the record.
+ *
+ * @return The size, a multiple of #RECORD_ALIGNMENT.
+ */
+static uint32_t getRecordSize( uint16_t topicLength,
+                               uint32_t payloadLength );
+
+/**
+ * @brief Read and check the record at an offset of a journal file.
+ *
+ * @param[in] pBase Start of the mapping of the file.
+ * @param[in] offset Offset of the record.
+ * @param[in] limit Size of the file.
+ * @param[out] pHeader The header of the record.
+ * @param[out] pSize Size of the record.
+ *
+ * @return true if a complete record with a valid CRC is at @p offset.
+ */
+static bool readRecord( const uint8_t * pBase,
+                        uint32_t offset,
+                        uint32_t limit,
+                        JournalRecordHeader_t * pHeader,
+                        uint32_t * pSize );
+
+/**
+ * @brief Write a record at an offset of a journal file.
+ *
+ * @param[in] pRecord Start of the record in the mapping of the file.
+ * @param[in] type Type of the record.
+ * @param[in] packetId Packet identifier of the record.
+ * @param[in] pPublishInfo The publish of a publish record, NULL otherwise.
+ */
+static void writeRecord( uint8_t * pRecord,
+                         uint8_t type,
+                         uint16_t packetId,
+                         const MQTTPublishInfo_t * pPublishInfo );
+
+/**
+ * @brief Get the size of the record at an offset of a journal file that was
+ * already checked.
+ *
+ * @param[in] pBase Start of the mapping of the file.
+ * @param[in] offset Offset of the record.
+ *
+ * @return The size of the record.
+ */
+static uint32_t getRecordSizeAt( const uint8_t * pBase,
+                                 uint32_t offset );
+
+/**
+ * @brief Find the index slot of a packet identifier.
+ *
+ * @return Position of the slot, or #NO_POSITION if the journal keeps no
+ * publish for the packet identifier.
+ */
+static uint16_t findSlot( const MqttPublishJournal_t * pJournal,
+                          uint16_t packetId );
+
+/**
+ * @brief Add a live publish to the index of a journal.
+ *
+ * @param[in] pJournal The journal.
+ * @param[in] packetId Packet identifier of the publish.
+ * @param[in] offset Offset of the record of the publish.
+ * @param[in] size Size of the record of the publish.
+ *
+ * @return false if the journal already keeps #MQTT_PUBLISH_JOURNAL_MAX_LIVE
+ * publishes.
+ */
+static bool insertSlot( MqttPublishJournal_t * pJournal,
+                        uint16_t packetId,
+                        uint32_t offset,
+                        uint32_t size );
+
+/**
+ * @brief Remove the slot at a position of the index of a journal, shifting
+ * back the slots that follow it in the probe sequence.
+ *
+ * @param[in] pJournal The journal.
+ * @param[in] position Position of the slot.
+ * @param[in] size Size of the record of the publish of the slot.
+ */
+static void removeSlot( MqttPublishJournal_t * pJournal,
+                        uint16_t position,
+                        uint32_t size );
+
+/**
+ * @brief Make the index of a journal empty.
+ *
+ * @param[in] pJournal The journal.
+ */
+static void clearIndex( MqttPublishJournal_t * pJournal );
+
+/**
+ * @brief Apply the records of a journal file to the index of a journal.
+ *
+ * @param[in] pJournal The journal, whose index is relative to @p pBase.
+ * @param[in] pBase Start of the mapping of the file.
+ * @param[in] limit Size of the file, or end of its valid records.
+ *
+ * @return End of the last valid record.
+ */
+static uint32_t replayRecords( MqttPublishJournal_t * pJournal,
+                               const uint8_t * pBase,
+                               uint32_t limit );
+
+/**
+ * @brief Get the offsets of the records of the live publishes of a journal,
+ * in the order they were appended.
+ *
+ * @param[in] pJournal The journal.
+ * @param[out] pOffsets The offsets, of #MQTT_PUBLISH_JOURNAL_MAX_LIVE
+ * entries.
+ *
+ * @return Number of offsets.
+ */
+static uint16_t getLiveOffsets( const MqttPublishJournal_t * pJournal,
+                                uint32_t * pOffsets );
+
+/**
+ * @brief Create a journal file with no records and map it.
+ *
+ * @param[in] pPath Path of the file, which is replaced if it exists.
+ * @param[out] pFileDescriptor The file.
+ * @param[out] ppMapping The mapping of the file.
+ *
+ * @return true on success.
+ */
+static bool createFile( const char * pPath,
+                        int * pFileDescriptor,
+                        uint8_t ** ppMapping );
+
+/**
+ * @brief Copy records from a journal file to another.
+ *
+ * @param[in] pSource Start of the mapping of the file to copy from.
+ * @param[in] pOffsets Offsets of the records to copy.
+ * @param[in] count Number of records to copy.
+ * @param[in] pTarget Start of the mapping of the file to copy to, with no
+ * records.
+ *
+ * @return End of the last record copied.
+ */
+static uint32_t copyRecords( const uint8_t * pSource,
+                             const uint32_t * pOffsets,
+                             uint16_t count,
+                             uint8_t * pTarget );
+
+/**
+ * @brief Write a range of a mapping of a journal file to disk.
+ *
+ * @param[in] pMapping Start of the mapping.
+ * @param[in] start Start of the range.
+ * @param[in] end End of the range.
+ *
+ * @return true on success.
+ */
+static bool syncRange( uint8_t * pMapping,
+                       uint32_t start,
+                       uint32_t end );
+
+/**
+ * @brief Write to disk the directory entry of a file that was renamed.
+ *
+ * @param[in] pPath Path of the file.
+ */
+static void syncDirectory( const char * pPath );
+
+/**
+ * @brief Replace the file of a journal with one holding only the records of
+ * its live publishes and the records appended meanwhile.
+ *
+ * Called with the lock of the journal held. The lock is released while the
+ * live records are copied and synced.
+ *
+ * @param[in] pJournal The journal.
+ *
+ * @return true on success; false if the file was left as it was.
+ */
+static bool compactJournal( MqttPublishJournal_t * pJournal );
+
+/**
+ * @brief Append a record to the file of a journal, compacting the file if it
+ * is full.
+ *
+ * Called with the lock of the journal held.
+ *
+ * @param[in] pJournal The journal.
+ * @param[in] type Type of the record.
+ * @param[in] packetId Packet identifier of the record.
+ * @param[in] pPublishInfo The publish of a publish record, NULL otherwise.
+ *
+ * @return Offset of the record; 0 if the file is full of live publishes.
+ */
+static uint32_t appendRecord( MqttPublishJournal_t * pJournal,
+                              uint8_t type,
+                              uint16_t packetId,
+                              const MQTTPublishInfo_t * pPublishInfo );
+
+/**
+ * @brief Forget a restored publish once it is acknowledged, and unmap the
+ * old journal file once no restored publish is left.
+ *
+ * @param[in] pJournal The journal.
+ * @param[in] packetId Packet identifier of the publish.
+ */
+static void releaseRestored( MqttPublishJournal_t * pJournal,
+                             uint16_t packetId );
+
+/**
+ * @brief Unmap the old journal file.
+ *
+ * @param[in] pJournal The journal.
+ */
+static void releaseRecovered( MqttPublishJournal_t * pJournal );
+
+/**
+ * @brief Thread syncing the file of a journal every
+ * #MQTT_PUBLISH_JOURNAL_COMMIT_INTERVAL_MS, and compacting it when it passes
+ * #MQTT_PUBLISH_JOURNAL_COMPACT_THRESHOLD.
+ *
+ * @param[in] pArgument The journal.
+ *
+ * @return NULL.
+ */
+static void * committerThread( void * pArgument );
+
+/*-----------------------------------------------------------*/
+
+static void initCrcTable( void )
+{
+    uint32_t value = 0U, bit = 0U, crc = 0U;
+
+    for( value = 0U; value < 256U; value++ )
+    {
+        crc = value;
+
+        for( bit = 0U; bit < 8U; bit++ )
+        {
+            crc = ( ( crc & 1U ) != 0U ) ? ( ( crc >> 1 ) ^ CRC32_POLYNOMIAL ) : ( crc >> 1 );
+        }
+
+        crcTable[ value ] = crc;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t updateCrc( uint32_t crc,
+                           const uint8_t * pData,
+                           size_t length )
+{
+    size_t index = 0U;
+
+    crc = ~crc;
+
+    for( index = 0U; index < length; index++ )
+    {
+        crc = crcTable[ ( crc ^ pData[ index ] ) & 0xFFU ] ^ ( crc >> 8 );
+    }
+
+    return ~crc;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t getRecordSize( uint16_t topicLength,
+                               uint32_t payloadLength )
+{
+    uint32_t size = RECORD_HEADER_SIZE + topicLength + payloadLength;
+
+    return ( size + RECORD_ALIGNMENT - 1U ) & ~( RECORD_ALIGNMENT - 1U );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool readRecord( const uint8_t * pBase,
+                        uint32_t offset,
+                        uint32_t limit,
+                        JournalRecordHeader_t * pHeader,
+                        uint32_t * pSize )
+{
+    bool isValid = false;
+    uint32_t crc = 0U;
+
+    if( ( limit >= RECORD_HEADER_SIZE ) && ( offset <= ( limit - RECORD_HEADER_SIZE ) ) )
+    {
+        ( void ) memcpy( pHeader, &pBase[ offset ], sizeof( JournalRecordHeader_t ) );
+
+        if( pHeader->type == RECORD_TYPE_PUBLISH )
+        {
+            isValid = ( pHeader->packetId != PACKET_ID_INVALID ) &&
+                      ( pHeader->payloadLength <= ( limit - offset ) );
+        }
+        else if( ( pHeader->type == RECORD_TYPE_ACK ) || ( pHeader->type == RECORD_TYPE_RESET ) )
+        {
+            isValid = ( pHeader->topicLength == 0U ) && ( pHeader->payloadLength == 0U );
+        }
+        else
+        {
+            /* The zeroed space after the last record ends the journal. */
+        }
+    }
+
+    if( isValid == true )
+    {
+        *pSize = getRecordSize( pHeader->topicLength, pHeader->payloadLength );
+        isValid = ( *pSize <= ( limit - offset ) );
+    }
+
+    if( isValid == true )
+    {
+        /* A record torn by a crash fails the check and ends the journal. */
+        crc = updateCrc( 0U,
+                         &pBase[ offset + RECORD_HEADER_CRC_OFFSET ],
+                         ( RECORD_HEADER_SIZE - RECORD_HEADER_CRC_OFFSET ) +
+                         pHeader->topicLength + pHeader->payloadLength );
+        isValid = ( crc == pHeader->crc );
+    }
+
+    return isValid;
+}
+
+/*-----------------------------------------------------------*/
+
+static void writeRecord( uint8_t * pRecord,
+                         uint8_t type,
+                         uint16_t packetId,
+                         const MQTTPublishInfo_t * pPublishInfo )
+{
+    JournalRecordHeader_t header;
+    uint32_t bodyLength = 0U;
+
+    ( void ) memset( &header, 0, sizeof( header ) );
+    header.type = type;
+    header.packetId = packetId;
+
+    if( pPublishInfo != NULL )
+    {
+        header.topicLength = pPublishInfo->topicNameLength;
+        header.payloadLength = ( uint32_t ) pPublishInfo->payloadLength;
+        header.qos = ( uint8_t ) pPublishInfo->qos;
+        header.retain = ( pPublishInfo->retain == true ) ? 1U : 0U;
+
+        ( void ) memcpy( &pRecord[ RECORD_HEADER_SIZE ],
+                         pPublishInfo->pTopicName,
+                         pPublishInfo->topicNameLength );
+
+        if( pPublishInfo->payloadLength > 0U )
+        {
+            ( void ) memcpy( &pRecord[ RECORD_HEADER_SIZE + pPublishInfo->topicNameLength ],
+                             pPublishInfo->pPayload,
+                             pPublishInfo->payloadLength );
+        }
+
+        bodyLength = header.topicLength + header.payloadLength;
+    }
+
+    /* The header is written last, so that a record is only valid once all
+     * of it is in the file. */
+    ( void ) memcpy( &pRecord[ RECORD_HEADER_CRC_OFFSET ],
+                     ( const uint8_t * ) &header + RECORD_HEADER_CRC_OFFSET,
+                     RECORD_HEADER_SIZE - RECORD_HEADER_CRC_OFFSET );
+    header.crc = updateCrc( 0U,
+                            &pRecord[ RECORD_HEADER_CRC_OFFSET ],
+                            ( RECORD_HEADER_SIZE - RECORD_HEADER_CRC_OFFSET ) + bodyLength );
+    ( void ) memcpy( pRecord, &header.crc, sizeof( header.crc ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t getRecordSizeAt( const uint8_t * pBase,
+                                 uint32_t offset )
+{
+    JournalRecordHeader_t header;
+
+    ( void ) memcpy( &header, &pBase[ offset ], sizeof( JournalRecordHeader_t ) );
+
+    return getRecordSize( header.topicLength, header.payloadLength );
+}
+
+/*-----------------------------------------------------------*/
+
+static uint16_t findSlot( const MqttPublishJournal_t * pJournal,
+                          uint16_t packetId )
+{
+    uint16_t position = packetId % MQTT_PUBLISH_JOURNAL_INDEX_SIZE;
+    uint16_t foundPosition = NO_POSITION;
+
+    while( ( foundPosition == NO_POSITION ) &&
+           ( pJournal->index[ position ].packetId != PACKET_ID_INVALID ) )
+    {
+        if( pJournal->index[ position ].packetId == packetId )
+        {
+            foundPosition = position;
+        }
+
+        position = ( position + 1U ) % MQTT_PUBLISH_JOURNAL_INDEX_SIZE;
+    }
+
+    return foundPosition;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool insertSlot( MqttPublishJournal_t * pJournal,
+                        uint16_t packetId,
+                        uint32_t offset,
+                        uint32_t size )
+{
+    uint16_t position = packetId % MQTT_PUBLISH_JOURNAL_INDEX_SIZE;
+    bool isInserted = false;
+
+    if( pJournal->liveCount < MQTT_PUBLISH_JOURNAL_MAX_LIVE )
+    {
+        while( pJournal->index[ position ].packetId != PACKET_ID_INVALID )
+        {
+            position = ( position + 1U ) % MQTT_PUBLISH_JOURNAL_INDEX_SIZE;
+        }
+
+        pJournal->index[ position ].packetId = packetId;
+        pJournal->index[ position ].offset = offset;
+        pJournal->liveCount++;
+        pJournal->liveBytes += size;
+        isInserted = true;
+    }
+
+    return isInserted;
+}
+
+/*-----------------------------------------------------------*/
+
+static void removeSlot( MqttPublishJournal_t * pJournal,
+                        uint16_t position,
+                        uint32_t size )
+{
+    uint16_t emptyPosition = position;
+    uint16_t nextPosition = ( emptyPosition + 1U ) % MQTT_PUBLISH_JOURNAL_INDEX_SIZE;
+    uint16_t homePosition = 0U;
+
+    pJournal->index[ emptyPosition ].packetId = PACKET_ID_INVALID;
+    pJournal->liveCount--;
+    pJournal->liveBytes -= size;
+
+    /* Move back slots that would no longer be reachable from their home
+     * position across the emptied position. */
+    while( pJournal->index[ nextPosition ].packetId != PACKET_ID_INVALID )
+    {
+        homePosition = pJournal->index[ nextPosition ].packetId % MQTT_PUBLISH_JOURNAL_INDEX_SIZE;
+
+        if( ( ( nextPosition > emptyPosition ) &&
+              ( ( homePosition <= emptyPosition ) || ( homePosition > nextPosition ) ) ) ||
+            ( ( nextPosition < emptyPosition ) &&
+              ( ( homePosition <= emptyPosition ) && ( homePosition > nextPosition ) ) ) )
+        {
+            pJournal->index[ emptyPosition ] = pJournal->index[ nextPosition ];
+            pJournal->index[ nextPosition ].packetId = PACKET_ID_INVALID;
+            emptyPosition = nextPosition;
+        }
+
+        nextPosition = ( nextPosition + 1U ) % MQTT_PUBLISH_JOURNAL_INDEX_SIZE;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void clearIndex( MqttPublishJournal_t * pJournal )
+{
+    ( void ) memset( pJournal->index, 0, sizeof( pJournal->index ) );
+    pJournal->liveCount = 0U;
+    pJournal->liveBytes = 0U;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t replayRecords( MqttPublishJournal_t * pJournal,
+                               const uint8_t * pBase,
+                               uint32_t limit )
+{
+    JournalRecordHeader_t header;
+    uint32_t offset = FILE_HEADER_SIZE, size = 0U;
+    uint16_t position = NO_POSITION;
+
+    while( readRecord( pBase, offset, limit, &header, &size ) == true )
+    {
+        position = findSlot( pJournal, header.packetId );
+
+        if( header.type == RECORD_TYPE_RESET )
+        {
+            clearIndex( pJournal );
+        }
+        else if( position != NO_POSITION )
+        {
+            /* An acknowledgement, or a publish that reused the packet
+             * identifier of one that was never acknowledged. */
+            removeSlot( pJournal, position, getRecordSizeAt( pBase, pJournal->index[ position ].offset ) );
+        }
+        else
+        {
+            /* Nothing to remove. */
+        }
+
+        if( ( header.type == RECORD_TYPE_PUBLISH ) &&
+            ( insertSlot( pJournal, header.packetId, offset, size ) == false ) )
+        {
+            LogWarn( ( "Dropping the journaled publish with packet id %u: more than %u "
+                       "publishes are unacknowledged.",
+                       ( unsigned int ) header.packetId,
+                       ( unsigned int ) MQTT_PUBLISH_JOURNAL_MAX_LIVE ) );
+        }
+
+        offset += size;
+    }
+
+    return offset;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint16_t getLiveOffsets( const MqttPublishJournal_t * pJournal,
+                                uint32_t * pOffsets )
+{
+    uint16_t position = 0U, count = 0U, sorted = 0U;
+    uint32_t offset = 0U;
+
+    for( position = 0U; position < MQTT_PUBLISH_JOURNAL_INDEX_SIZE; position++ )
+    {
+        if( pJournal->index[ position ].packetId != PACKET_ID_INVALID )
+        {
+            /* Insertion sort; there are at most MQTT_PUBLISH_JOURNAL_MAX_LIVE
+             * offsets. */
+            offset = pJournal->index[ position ].offset;
+
+            for( sorted = count; ( sorted > 0U ) && ( pOffsets[ sorted - 1U ] > offset ); sorted-- )
+            {
+                pOffsets[ sorted ] = pOffsets[ sorted - 1U ];
+            }
+
+            pOffsets[ sorted ] = offset;
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool createFile( const char * pPath,
+                        int * pFileDescriptor,
+                        uint8_t ** ppMapping )
+{
+    JournalFileHeader_t header;
+    void * pMapping = MAP_FAILED;
+    int fileDescriptor = -1;
+    int error = 0;
+
+    fileDescriptor = open( pPath, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR );
+
+    if( fileDescriptor < 0 )
+    {
+        error = errno;
+    }
+    else
+    {
+        /* Allocating the blocks up front keeps writes to the mapping from
+         * faulting when the disk is full. */
+        error = posix_fallocate( fileDescriptor, 0, ( off_t ) MQTT_PUBLISH_JOURNAL_FILE_SIZE );
+    }
+
+    if( error == 0 )
+    {
+        pMapping = mmap( NULL, MQTT_PUBLISH_JOURNAL_FILE_SIZE, PROT_READ | PROT_WRITE,
+                         MAP_SHARED, fileDescriptor, 0 );
+
+        if( pMapping == MAP_FAILED )
+        {
+            error = errno;
+        }
+    }
+
+    if( error == 0 )
+    {
+        ( void ) memset( &header, 0, sizeof( header ) );
+        header.magic = JOURNAL_MAGIC;
+        header.version = JOURNAL_VERSION;
+        header.fileSize = MQTT_PUBLISH_JOURNAL_FILE_SIZE;
+        ( void ) memcpy( pMapping, &header, sizeof( header ) );
+
+        *pFileDescriptor = fileDescriptor;
+        *ppMapping = ( uint8_t * ) pMapping;
+    }
+    else
+    {
+        LogError( ( "Failed to create journal file %s: %s.", pPath, strerror( error ) ) );
+
+        if( fileDescriptor >= 0 )
+        {
+            ( void ) close( fileDescriptor );
+            ( void ) unlink( pPath );
+        }
+    }
+
+    return( error == 0 );
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t copyRecords( const uint8_t * pSource,
+                             const uint32_t * pOffsets,
+                             uint16_t count,
+                             uint8_t * pTarget )
+{
+    uint32_t tail = FILE_HEADER_SIZE, size = 0U;
+    uint16_t index = 0U;
+
+    for( index = 0U; index < count; index++ )
+    {
+        size = getRecordSizeAt( pSource, pOffsets[ index ] );
+        ( void ) memcpy( &pTarget[ tail ], &pSource[ pOffsets[ index ] ], size );
+        tail += size;
+    }
+
+    return tail;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool syncRange( uint8_t * pMapping,
+                       uint32_t start,
+                       uint32_t end )
+{
+    uint32_t pageStart = start & ~( ( uint32_t ) sysconf( _SC_PAGESIZE ) - 1U );
+    bool isSynced = true;
+
+    if( ( end > start ) && ( msync( &pMapping[ pageStart ], end - pageStart, MS_SYNC ) != 0 ) )
+    {
+        LogError( ( "Failed to sync the journal: %s.", strerror( errno ) ) );
+        isSynced = false;
+    }
+
+    return isSynced;
+}
+
+/*-----------------------------------------------------------*/
+
+static void syncDirectory( const char * pPath )
+{
+    char directory[ MQTT_PUBLISH_JOURNAL_PATH_MAX ];
+    const char * pSeparator = strrchr( pPath, '/' );
+    int fileDescriptor = -1;
+
+    if( pSeparator == NULL )
+    {
+        ( void ) strcpy( directory, "." );
+    }
+    else if( pSeparator == pPath )
+    {
+        ( void ) strcpy( directory, "/" );
+    }
+    else
+    {
+        ( void ) memcpy( directory, pPath, ( size_t ) ( pSeparator - pPath ) );
+        directory[ pSeparator - pPath ] = '\0';
+    }
+
+    fileDescriptor = open( directory, O_RDONLY | O_DIRECTORY );
+
+    if( fileDescriptor >= 0 )
+    {
+        ( void ) fsync( fileDescriptor );
+        ( void ) close( fileDescriptor );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static bool compactJournal( MqttPublishJournal_t * pJournal )
+{
+    char compactPath[ MQTT_PUBLISH_JOURNAL_PATH_MAX ];
+    uint32_t offsets[ MQTT_PUBLISH_JOURNAL_MAX_LIVE ];
+    uint8_t * pMapping = NULL;
+    int fileDescriptor = -1;
+    uint32_t snapshotTail = 0U, tail = 0U, catchUpLength = 0U;
+    uint16_t count = 0U;
+    bool status = false;
+
+    pJournal->isCompacting = true;
+    snapshotTail = pJournal->tail;
+    count = getLiveOffsets( pJournal, offsets );
+    ( void ) pthread_mutex_unlock( &pJournal->lock );
+
+    ( void ) strcpy( compactPath, pJournal->path );
+    ( void ) strcat( compactPath, COMPACT_PATH_SUFFIX );
+
+    /* Records before the snapshot are never written again, and the mapping
+     * is only replaced by a compaction, so they are copied without the lock
+     * while publishes keep being appended. */
+    status = createFile( compactPath, &fileDescriptor, &pMapping );
+
+    if( status == true )
+    {
+        tail = copyRecords( pJournal->pMapping, offsets, count, pMapping );
+        status = syncRange( pMapping, 0U, tail );
+    }
+
+    ( void ) pthread_mutex_lock( &pJournal->lock );
+
+    while( pJournal->isSyncing == true )
+    {
+        ( void ) pthread_cond_wait( &pJournal->wakeup, &pJournal->lock );
+    }
+
+    if( status == true )
+    {
+        /* Carry over the records appended during the copy. Acknowledgements
+         * among them refer to publishes by packet identifier, so they still
+         * apply to the copied records. */
+        catchUpLength = pJournal->tail - snapshotTail;
+
+        if( catchUpLength > ( MQTT_PUBLISH_JOURNAL_FILE_SIZE - tail ) )
+        {
+            LogError( ( "Failed to compact the journal: too many records were "
+                        "appended meanwhile." ) );
+            status = false;
+        }
+        else
+        {
+            ( void ) memcpy( &pMapping[ tail ], &pJournal->pMapping[ snapshotTail ], catchUpLength );
+            status = syncRange( pMapping, tail, tail + catchUpLength );
+            tail += catchUpLength;
+        }
+    }
+
+    if( status == true )
+    {
+        if( rename( compactPath, pJournal->path ) != 0 )
+        {
+            LogError( ( "Failed to replace journal file %s: %s.",
+                        pJournal->path, strerror( errno ) ) );
+            status = false;
+        }
+        else
+        {
+            syncDirectory( pJournal->path );
+        }
+    }
+
+    if( status == true )
+    {
+        LogDebug( ( "Compacted the journal from %u to %u bytes.",
+                    ( unsigned int ) pJournal->tail,
+                    ( unsigned int ) tail ) );
+
+        ( void ) munmap( pJournal->pMapping, MQTT_PUBLISH_JOURNAL_FILE_SIZE );
+        ( void ) close( pJournal->fileDescriptor );
+        pJournal->pMapping = pMapping;
+        pJournal->fileDescriptor = fileDescriptor;
+
+        clearIndex( pJournal );
+        pJournal->tail = replayRecords( pJournal, pMapping, tail );
+        pJournal->syncedTail = pJournal->tail;
+    }
+    else if( pMapping != NULL )
+    {
+        ( void ) munmap( pMapping, MQTT_PUBLISH_JOURNAL_FILE_SIZE );
+        ( void ) close( fileDescriptor );
+        ( void ) unlink( compactPath );
+    }
+    else
+    {
+        /* Nothing was created. */
+    }
+
+    pJournal->isCompacting = false;
+    ( void ) pthread_cond_broadcast( &pJournal->wakeup );
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t appendRecord( MqttPublishJournal_t * pJournal,
+                              uint8_t type,
+                              uint16_t packetId,
+                              const MQTTPublishInfo_t * pPublishInfo )
+{
+    uint32_t size = RECORD_HEADER_SIZE;
+    uint32_t offset = 0U, reclaimable = 0U;
+    bool isFull = false;
+
+    if( pPublishInfo != NULL )
+    {
+        size = getRecordSize( pPublishInfo->topicNameLength, ( uint32_t ) pPublishInfo->payloadLength );
+    }
+
+    while( ( isFull == false ) && ( size > ( MQTT_PUBLISH_JOURNAL_FILE_SIZE - pJournal->tail ) ) )
+    {
+        reclaimable = pJournal->tail - FILE_HEADER_SIZE - pJournal->liveBytes;
+
+        if( pJournal->isCompacting == true )
+        {
+            ( void ) pthread_cond_wait( &pJournal->wakeup, &pJournal->lock );
+        }
+        else if( ( reclaimable < size ) || ( compactJournal( pJournal ) == false ) )
+        {
+            isFull = true;
+        }
+        else
+        {
+            /* Check the space left by the compaction. */
+        }
+    }
+
+    if( isFull == false )
+    {
+        offset = pJournal->tail;
+        writeRecord( &pJournal->pMapping[ offset ], type, packetId, pPublishInfo );
+        pJournal->tail += size;
+    }
+    else
+    {
+        LogError( ( "The journal is full of unacknowledged publishes." ) );
+    }
+
+    return offset;
+}
+
+/*-----------------------------------------------------------*/
+
+static void releaseRestored( MqttPublishJournal_t * pJournal,
+                             uint16_t packetId )
+{
+    JournalRecordHeader_t header;
+    uint16_t index = 0U;
+
+    for( index = 0U; ( pJournal->restoredLive > 0U ) && ( index < pJournal->restoredCount ); index++ )
+    {
+        if( pJournal->restoredOffsets[ index ] != 0U )
+        {
+            ( void ) memcpy( &header,
+                             &pJournal->pRecovered[ pJournal->restoredOffsets[ index ] ],
+                             sizeof( JournalRecordHeader_t ) );
+
+            if( header.packetId == packetId )
+            {
+                pJournal->restoredOffsets[ index ] = 0U;
+                pJournal->restoredLive--;
+
+                if( pJournal->restoredLive == 0U )
+                {
+                    releaseRecovered( pJournal );
+                }
+
+                break;
+            }
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void releaseRecovered( MqttPublishJournal_t * pJournal )
+{
+    if( pJournal->pRecovered != NULL )
+    {
+        ( void ) munmap( ( void * ) pJournal->pRecovered, pJournal->recoveredSize );
+        pJournal->pRecovered = NULL;
+        pJournal->recoveredSize = 0U;
+    }
+
+    pJournal->restoredCount = 0U;
+    pJournal->restoredLive = 0U;
+}
+
+/*-----------------------------------------------------------*/
+
+static void * committerThread( void * pArgument )
+{
+    MqttPublishJournal_t * pJournal = ( MqttPublishJournal_t * ) pArgument;
+    struct timespec deadline;
+    uint32_t start = 0U, end = 0U;
+    bool isSynced = false;
+
+    ( void ) pthread_mutex_lock( &pJournal->lock );
+
+    while( pJournal->isStopping == false )
+    {
+        ( void ) clock_gettime( CLOCK_MONOTONIC, &deadline );
+        deadline.tv_nsec += ( long ) MQTT_PUBLISH_JOURNAL_COMMIT_INTERVAL_MS * NANOSECONDS_PER_MILLISECOND;
+        deadline.tv_sec += deadline.tv_nsec / NANOSECONDS_PER_SECOND;
+        deadline.tv_nsec %= NANOSECONDS_PER_SECOND;
+        ( void ) pthread_cond_timedwait( &pJournal->wakeup, &pJournal->lock, &deadline );
+
+        if( pJournal->tail > pJournal->syncedTail )
+        {
+            /* One sync commits every record appended since the last one. The
+             * lock is released meanwhile so that publishes are not held up;
+             * a compaction waits for the sync before replacing the mapping. */
+            start = pJournal->syncedTail;
+            end = pJournal->tail;
+            pJournal->isSyncing = true;
+            ( void ) pthread_mutex_unlock( &pJournal->lock );
+
+            isSynced = syncRange( pJournal->pMapping, start, end );
+
+            ( void ) pthread_mutex_lock( &pJournal->lock );
+            pJournal->isSyncing = false;
+
+            if( ( isSynced == true ) && ( end > pJournal->syncedTail ) )
+            {
+                pJournal->syncedTail = end;
+            }
+
+            ( void ) pthread_cond_broadcast( &pJournal->wakeup );
+        }
+
+        if( ( pJournal->isCompacting == false ) &&
+            ( pJournal->tail > MQTT_PUBLISH_JOURNAL_COMPACT_THRESHOLD ) &&
+            ( ( pJournal->tail - FILE_HEADER_SIZE - pJournal->liveBytes ) >= ( MQTT_PUBLISH_JOURNAL_FILE_SIZE / 4U ) ) )
+        {
+            ( void ) compactJournal( pJournal );
+        }
+    }
+
+    ( void ) pthread_mutex_unlock( &pJournal->lock );
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+bool MqttPublishJournal_Open( MqttPublishJournal_t * pJournal,
+                              const char * pPath )
+{
+    char compactPath[ MQTT_PUBLISH_JOURNAL_PATH_MAX ];
+    JournalFileHeader_t header;
+    pthread_condattr_t conditionAttributes;
+    struct stat fileStatus;
+    void * pRecovered = MAP_FAILED;
+    int fileDescriptor = -1;
+    uint32_t limit = 0U, tail = 0U;
+    bool status = true;
+
+    assert( pJournal != NULL );
+    assert( pPath != NULL );
+
+    ( void ) memset( pJournal, 0, sizeof( MqttPublishJournal_t ) );
+    pJournal->fileDescriptor = -1;
+
+    if( ( strlen( pPath ) + sizeof( COMPACT_PATH_SUFFIX ) ) > sizeof( compactPath ) )
+    {
+        LogError( ( "The journal path %s is too long.", pPath ) );
+        status = false;
+    }
+    else
+    {
+        ( void ) strcpy( pJournal->path, pPath );
+        ( void ) strcpy( compactPath, pPath );
+        ( void ) strcat( compactPath, COMPACT_PATH_SUFFIX );
+        ( void ) pthread_once( &crcTableOnce, initCrcTable );
+
+        fileDescriptor = open( pPath, O_RDONLY );
+    }
+
+    /* Find the live publishes of a journal left by an earlier process. */
+    if( ( fileDescriptor >= 0 ) &&
+        ( fstat( fileDescriptor, &fileStatus ) == 0 ) &&
+        ( fileStatus.st_size >= ( off_t ) FILE_HEADER_SIZE ) )
+    {
+        pRecovered = mmap( NULL, ( size_t ) fileStatus.st_size, PROT_READ, MAP_SHARED, fileDescriptor, 0 );
+    }
+
+    if( fileDescriptor >= 0 )
+    {
+        /* The mapping stays valid after the file is closed and replaced. */
+        ( void ) close( fileDescriptor );
+    }
+
+    if( pRecovered != MAP_FAILED )
+    {
+        ( void ) memcpy( &header, pRecovered, sizeof( header ) );
+        limit = ( fileStatus.st_size < ( off_t ) header.fileSize ) ?
+                ( uint32_t ) fileStatus.st_size : header.fileSize;
+
+        if( ( header.magic == JOURNAL_MAGIC ) && ( header.version == JOURNAL_VERSION ) )
+        {
+            pJournal->pRecovered = ( const uint8_t * ) pRecovered;
+            pJournal->recoveredSize = ( size_t ) fileStatus.st_size;
+            ( void ) replayRecords( pJournal, pJournal->pRecovered, limit );
+            pJournal->restoredCount = getLiveOffsets( pJournal, pJournal->restoredOffsets );
+            pJournal->restoredLive = pJournal->restoredCount;
+        }
+        else
+        {
+            LogWarn( ( "%s is not a publish journal; it is replaced by an empty one.", pPath ) );
+            ( void ) munmap( pRecovered, ( size_t ) fileStatus.st_size );
+        }
+    }
+
+    /* Start a new file with only the live publishes, written to disk before
+     * it replaces the old one. */
+    if( status == true )
+    {
+        status = createFile( compactPath, &pJournal->fileDescriptor, &pJournal->pMapping );
+    }
+
+    if( status == true )
+    {
+        tail = FILE_HEADER_SIZE;
+
+        if( pJournal->pRecovered != NULL )
+        {
+            tail = copyRecords( pJournal->pRecovered, pJournal->restoredOffsets,
+                                pJournal->restoredCount, pJournal->pMapping );
+        }
+
+        status = syncRange( pJournal->pMapping, 0U, tail );
+    }
+
+    if( status == true )
+    {
+        status = ( rename( compactPath, pPath ) == 0 );
+
+        if( status == false )
+        {
+            LogError( ( "Failed to replace journal file %s: %s.", pPath, strerror( errno ) ) );
+            ( void ) unlink( compactPath );
+        }
+        else
+        {
+            syncDirectory( pPath );
+        }
+    }
+
+    if( status == true )
+    {
+        clearIndex( pJournal );
+        pJournal->tail = replayRecords( pJournal, pJournal->pMapping, tail );
+        pJournal->syncedTail = pJournal->tail;
+
+        if( pJournal->restoredCount == 0U )
+        {
+            releaseRecovered( pJournal );
+        }
+
+        ( void ) pthread_mutex_init( &pJournal->lock, NULL );
+        ( void ) pthread_condattr_init( &conditionAttributes );
+        ( void ) pthread_condattr_setclock( &conditionAttributes, CLOCK_MONOTONIC );
+        ( void ) pthread_cond_init( &pJournal->wakeup, &conditionAttributes );
+        ( void ) pthread_condattr_destroy( &conditionAttributes );
+
+        if( pthread_create( &pJournal->committer, NULL, committerThread, pJournal ) != 0 )
+        {
+            LogError( ( "Failed to start the journal committer thread." ) );
+            ( void ) pthread_cond_destroy( &pJournal->wakeup );
+            ( void ) pthread_mutex_destroy( &pJournal->lock );
+            status = false;
+        }
+    }
+
+    if( status == false )
+    {
+        if( pJournal->pMapping != NULL )
+        {
+            ( void ) munmap( pJournal->pMapping, MQTT_PUBLISH_JOURNAL_FILE_SIZE );
+            ( void ) close( pJournal->fileDescriptor );
+            pJournal->pMapping = NULL;
+        }
+
+        releaseRecovered( pJournal );
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+void MqttPublishJournal_Close( MqttPublishJournal_t * pJournal )
+{
+    assert( pJournal != NULL );
+
+    ( void ) pthread_mutex_lock( &pJournal->lock );
+    pJournal->isStopping = true;
+    ( void ) pthread_cond_broadcast( &pJournal->wakeup );
+    ( void ) pthread_mutex_unlock( &pJournal->lock );
+    ( void ) pthread_join( pJournal->committer, NULL );
+
+    ( void ) syncRange( pJournal->pMapping, pJournal->syncedTail, pJournal->tail );
+    ( void ) munmap( pJournal->pMapping, MQTT_PUBLISH_JOURNAL_FILE_SIZE );
+    ( void ) close( pJournal->fileDescriptor );
+    pJournal->pMapping = NULL;
+    releaseRecovered( pJournal );
+
+    ( void ) pthread_cond_destroy( &pJournal->wakeup );
+    ( void ) pthread_mutex_destroy( &pJournal->lock );
+}
+
+/*-----------------------------------------------------------*/
+
+uint16_t MqttPublishJournal_Restore( MqttPublishJournal_t * pJournal,
+                                     MqttRetransmitStore_t * pStore )
+{
+    JournalRecordHeader_t header;
+    MQTTPublishInfo_t publishInfo;
+    const uint8_t * pRecord = NULL;
+    uint16_t index = 0U, restored = 0U;
+
+    assert( pJournal != NULL );
+    assert( pStore != NULL );
+
+    for( index = 0U; index < pJournal->restoredCount; index++ )
+    {
+        if( pJournal->restoredOffsets[ index ] != 0U )
+        {
+            pRecord = &pJournal->pRecovered[ pJournal->restoredOffsets[ index ] ];
+            ( void ) memcpy( &header, pRecord, sizeof( JournalRecordHeader_t ) );
+
+            ( void ) memset( &publishInfo, 0, sizeof( publishInfo ) );
+            publishInfo.qos = ( MQTTQoS_t ) header.qos;
+            publishInfo.retain = ( header.retain != 0U );
+            publishInfo.pTopicName = ( const char * ) &pRecord[ RECORD_HEADER_SIZE ];
+            publishInfo.topicNameLength = header.topicLength;
+            publishInfo.pPayload = &pRecord[ RECORD_HEADER_SIZE + header.topicLength ];
+            publishInfo.payloadLength = header.payloadLength;
+
+            if( MqttRetransmitStore_Add( pStore, header.packetId, &publishInfo ) == true )
+            {
+                restored++;
+            }
+            else
+            {
+                LogWarn( ( "Dropping the journaled publish with packet id %u.",
+                           ( unsigned int ) header.packetId ) );
+                ( void ) MqttPublishJournal_Ack( pJournal, header.packetId );
+            }
+        }
+    }
+
+    LogInfo( ( "Restored %u unacknowledged publishes from the journal.",
+               ( unsigned int ) restored ) );
+
+    return restored;
+}
+
+/*-----------------------------------------------------------*/
+
+bool MqttPublishJournal_Append( MqttPublishJournal_t * pJournal,
+                                uint16_t packetId,
+                                const MQTTPublishInfo_t * pPublishInfo )
+{
+    uint32_t offset = 0U;
+    bool isAppended = false;
+
+    assert( pJournal != NULL );
+    assert( pPublishInfo != NULL );
+    assert( packetId != PACKET_ID_INVALID );
+
+    ( void ) pthread_mutex_lock( &pJournal->lock );
+
+    if( pJournal->liveCount == MQTT_PUBLISH_JOURNAL_MAX_LIVE )
+    {
+        LogError( ( "The journal already keeps %u unacknowledged publishes.",
+                    ( unsigned int ) MQTT_PUBLISH_JOURNAL_MAX_LIVE ) );
+    }
+    else if( findSlot( pJournal, packetId ) != NO_POSITION )
+    {
+        LogError( ( "The journal already keeps a publish with packet id %u.",
+                    ( unsigned int ) packetId ) );
+    }
+    else
+    {
+        offset = appendRecord( pJournal, RECORD_TYPE_PUBLISH, packetId, pPublishInfo );
+    }
+
+    if( offset != 0U )
+    {
+        isAppended = insertSlot( pJournal, packetId, offset, pJournal->tail - offset );
+    }
+
+    ( void ) pthread_mutex_unlock( &pJournal->lock );
+
+    return isAppended;
+}
+
+/*-----------------------------------------------------------*/
+
+bool MqttPublishJournal_Ack( MqttPublishJournal_t * pJournal,
+                             uint16_t packetId )
+{
+    uint16_t position = NO_POSITION;
+
+    assert( pJournal != NULL );
+
+    ( void ) pthread_mutex_lock( &pJournal->lock );
+
+    position = findSlot( pJournal, packetId );
+
+    if( position != NO_POSITION )
+    {
+        /* The publish stops counting as live first, so that a compaction
+         * made to fit the acknowledgement can drop it. */
+        removeSlot( pJournal, position, getRecordSizeAt( pJournal->pMapping, pJournal->index[ position ].offset ) );
+        ( void ) appendRecord( pJournal, RECORD_TYPE_ACK, packetId, NULL );
+    }
+
+    ( void ) pthread_mutex_unlock( &pJournal->lock );
+
+    if( ( position != NO_POSITION ) && ( pJournal->restoredLive > 0U ) )
+    {
+        releaseRestored( pJournal, packetId );
+    }
+
+    return( position != NO_POSITION );
+}
+
+/*-----------------------------------------------------------*/
+
+void MqttPublishJournal_Clear( MqttPublishJournal_t * pJournal )
+{
+    assert( pJournal != NULL );
+
+    ( void ) pthread_mutex_lock( &pJournal->lock );
+
+    clearIndex( pJournal );
+    ( void ) appendRecord( pJournal, RECORD_TYPE_RESET, PACKET_ID_INVALID, NULL );
+
+    ( void ) pthread_mutex_unlock( &pJournal->lock );
+
+    releaseRecovered( pJournal );
+}
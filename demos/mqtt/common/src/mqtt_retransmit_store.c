@@ -0,0 +1,615 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file mqtt_retransmit_store.c
+ * @brief Implementation of a store that keeps outgoing QoS 1 publishes until
+ * they are acknowledged, and resends them when a session is resumed.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <string.h>
+
+/* Include header for the retransmission store. */
+#include "mqtt_retransmit_store.h"
+
+/**
+ * @brief Marker for the absence of an entry.
+ */
+#define NO_ENTRY                          ( UINT16_MAX )
+
+/**
+ * @brief Invalid packet identifier, marking a free entry. Zero is always an
+ * invalid packet identifier as per MQTT 3.1.1 spec.
+ */
+#define PACKET_ID_INVALID                 ( ( uint16_t ) 0U )
+
+/**
+ * @brief Largest size of the fixed header and topic length of a PUBLISH: one
+ * byte of packet type and flags, up to four bytes of remaining length and
+ * two bytes of topic length.
+ */
+#define PUBLISH_HEADER_MAX_SIZE           ( 7U )
+
+/**
+ * @brief Size of the packet identifier of a PUBLISH.
+ */
+#define PUBLISH_PACKET_ID_SIZE            ( 2U )
+
+/**
+ * @brief Number of buffers of a PUBLISH: header, topic, packet identifier
+ * and payload.
+ */
+#define VECTORS_PER_PUBLISH               ( 4U )
+
+/**
+ * @brief Number of buffers written by one flush of the store.
+ */
+#define FLUSH_VECTOR_COUNT                ( MQTT_RETRANSMIT_STORE_FLUSH_BATCH * VECTORS_PER_PUBLISH )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Make all the entries of a store free and its index empty.
+ *
+ * @param[in] pStore The store.
+ */
+static void resetStore( MqttRetransmitStore_t * pStore );
+
+/**
+ * @brief Find the position of a packet identifier in the index of a store.
+ *
+ * @return The position, or #NO_ENTRY if no publish is kept for the packet
+ * identifier.
+ */
+static uint16_t findInIndex( const MqttRetransmitStore_t * pStore,
+                             uint16_t packetId );
+
+/**
+ * @brief Remove the entry at a position of the index of a store, shifting
+ * back the entries that follow it in the probe sequence.
+ *
+ * @param[in] pStore The store.
+ * @param[in] position Position of the entry in the index.
+ */
+static void removeFromIndex( MqttRetransmitStore_t * pStore,
+                             uint16_t position );
+
+/**
+ * @brief Send the first of several buffers through a transport that has no
+ * writev function, after copying as many of the following buffers as fit
+ * behind it in a #MQTT_RETRANSMIT_STORE_SEND_BUFFER_SIZE stack buffer.
+ *
+ * @param[in] pTransport The transport.
+ * @param[in] pIoVec The buffers.
+ * @param[in] ioVecCount Number of buffers in @p pIoVec.
+ *
+ * @return Number of bytes sent, which may be fewer than the total length of
+ * the buffers; negative value on error.
+ */
+static int32_t sendCoalesced( const TransportInterface_t * pTransport,
+                              const TransportOutVector_t * pIoVec,
+                              size_t ioVecCount );
+
+/**
+ * @brief Write buffers through a transport until all of them are sent.
+ *
+ * @param[in] pMqttContext The MQTT context whose transport is written to.
+ * @param[in] pIoVec The buffers. They are updated as data is sent.
+ * @param[in] ioVecCount Number of buffers in @p pIoVec.
+ *
+ * @return #MQTTSuccess if all the buffers were sent; #MQTTSendFailed
+ * otherwise.
+ */
+static MQTTStatus_t sendVectors( MQTTContext_t * pMqttContext,
+                                 TransportOutVector_t * pIoVec,
+                                 size_t ioVecCount );
+
+/*-----------------------------------------------------------*/
+
+static void resetStore( MqttRetransmitStore_t * pStore )
+{
+    uint16_t index = 0U;
+
+    for( index = 0U; index < pStore->capacity; index++ )
+    {
+        pStore->pEntries[ index ].packetId = PACKET_ID_INVALID;
+        pStore->pEntries[ index ].next = index + 1U;
+    }
+
+    pStore->pEntries[ pStore->capacity - 1U ].next = NO_ENTRY;
+
+    for( index = 0U; index < pStore->indexSize; index++ )
+    {
+        pStore->pIndex[ index ] = NO_ENTRY;
+    }
+
+    pStore->freeHead = 0U;
+    pStore->pendingHead = NO_ENTRY;
+    pStore->pendingTail = NO_ENTRY;
+    pStore->pendingCount = 0U;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint16_t findInIndex( const MqttRetransmitStore_t * pStore,
+                             uint16_t packetId )
+{
+    uint16_t position = packetId % pStore->indexSize;
+    uint16_t foundPosition = NO_ENTRY;
+    uint16_t entry = NO_ENTRY;
+
+    while( ( foundPosition == NO_ENTRY ) &&
+           ( ( entry = pStore->pIndex[ position ] ) != NO_ENTRY ) )
+    {
+        if( pStore->pEntries[ entry ].packetId == packetId )
+        {
+            foundPosition = position;
+        }
+
+        position = ( position + 1U ) % pStore->indexSize;
+    }
+
+    return foundPosition;
+}
+
+/*-----------------------------------------------------------*/
+
+static void removeFromIndex( MqttRetransmitStore_t * pStore,
+                             uint16_t position )
+{
+    uint16_t emptyPosition = position;
+    uint16_t nextPosition = ( emptyPosition + 1U ) % pStore->indexSize;
+    uint16_t homePosition = 0U;
+
+    pStore->pIndex[ emptyPosition ] = NO_ENTRY;
+
+    /* Move back entries that would no longer be reachable from their home
+     * position across the emptied position. */
+    while( pStore->pIndex[ nextPosition ] != NO_ENTRY )
+    {
+        homePosition = pStore->pEntries[ pStore->pIndex[ nextPosition ] ].packetId % pStore->indexSize;
+
+        if( ( ( nextPosition > emptyPosition ) &&
+              ( ( homePosition <= emptyPosition ) || ( homePosition > nextPosition ) ) ) ||
+            ( ( nextPosition < emptyPosition ) &&
+              ( ( homePosition <= emptyPosition ) && ( homePosition > nextPosition ) ) ) )
+        {
+            pStore->pIndex[ emptyPosition ] = pStore->pIndex[ nextPosition ];
+            pStore->pIndex[ nextPosition ] = NO_ENTRY;
+            emptyPosition = nextPosition;
+        }
+
+        nextPosition = ( nextPosition + 1U ) % pStore->indexSize;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t sendCoalesced( const TransportInterface_t * pTransport,
+                              const TransportOutVector_t * pIoVec,
+                              size_t ioVecCount )
+{
+    uint8_t sendBuffer[ MQTT_RETRANSMIT_STORE_SEND_BUFFER_SIZE ];
+    size_t bufferedLength = 0U, bytesToCopy = 0U, index = 0U;
+    int32_t bytesSent = 0;
+
+    if( pIoVec[ 0 ].iov_len >= sizeof( sendBuffer ) )
+    {
+        /* A buffer this large is sent without copying. */
+        bytesSent = pTransport->send( pTransport->pNetworkContext, pIoVec[ 0 ].iov_base, pIoVec[ 0 ].iov_len );
+    }
+    else
+    {
+        /* A buffer that only partly fits is copied in part; the rest is sent
+         * with the following buffers. */
+        for( index = 0U; ( index < ioVecCount ) && ( bufferedLength < sizeof( sendBuffer ) ); index++ )
+        {
+            bytesToCopy = sizeof( sendBuffer ) - bufferedLength;
+
+            if( pIoVec[ index ].iov_len < bytesToCopy )
+            {
+                bytesToCopy = pIoVec[ index ].iov_len;
+            }
+
+            ( void ) memcpy( &sendBuffer[ bufferedLength ], pIoVec[ index ].iov_base, bytesToCopy );
+            bufferedLength += bytesToCopy;
+        }
+
+        bytesSent = pTransport->send( pTransport->pNetworkContext, sendBuffer, bufferedLength );
+    }
+
+    return bytesSent;
+}
+
+/*-----------------------------------------------------------*/
+
+static MQTTStatus_t sendVectors( MQTTContext_t * pMqttContext,
+                                 TransportOutVector_t * pIoVec,
+                                 size_t ioVecCount )
+{
+    const TransportInterface_t * pTransport = &pMqttContext->transportInterface;
+    MQTTStatus_t status = MQTTSuccess;
+    uint32_t lastSendTimeMs = pMqttContext->getTime();
+    int32_t bytesSent = 0;
+    size_t bytesLeft = 0U;
+
+    while( ( status == MQTTSuccess ) && ( ioVecCount > 0U ) )
+    {
+        if( pTransport->writev != NULL )
+        {
+            bytesSent = pTransport->writev( pTransport->pNetworkContext, pIoVec, ioVecCount );
+        }
+        else
+        {
+            bytesSent = sendCoalesced( pTransport, pIoVec, ioVecCount );
+        }
+
+        if( bytesSent < 0 )
+        {
+            LogError( ( "Transport send failed while resending publishes: bytesSent=%d.",
+                        ( int ) bytesSent ) );
+            status = MQTTSendFailed;
+        }
+        else if( bytesSent == 0 )
+        {
+            if( ( pMqttContext->getTime() - lastSendTimeMs ) > MQTT_RETRANSMIT_STORE_SEND_TIMEOUT_MS )
+            {
+                LogError( ( "Timed out resending publishes: the transport accepted no data "
+                            "for %u ms.", ( unsigned int ) MQTT_RETRANSMIT_STORE_SEND_TIMEOUT_MS ) );
+                status = MQTTSendFailed;
+            }
+        }
+        else
+        {
+            lastSendTimeMs = pMqttContext->getTime();
+            bytesLeft = ( size_t ) bytesSent;
+
+            /* Skip the buffers that were sent entirely, and the start of the
+             * one that was sent in part. */
+            while( ( ioVecCount > 0U ) && ( bytesLeft >= pIoVec->iov_len ) )
+            {
+                bytesLeft -= pIoVec->iov_len;
+                pIoVec++;
+                ioVecCount--;
+            }
+
+            if( ioVecCount > 0U )
+            {
+                pIoVec->iov_base = ( const uint8_t * ) pIoVec->iov_base + bytesLeft;
+                pIoVec->iov_len -= bytesLeft;
+            }
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+void MqttRetransmitStore_Init( MqttRetransmitStore_t * pStore,
+                               MqttRetransmitEntry_t * pEntries,
+                               uint16_t capacity,
+                               uint16_t * pIndex )
+{
+    assert( pStore != NULL );
+    assert( pEntries != NULL );
+    assert( pIndex != NULL );
+    assert( ( capacity > 0U ) && ( capacity < ( UINT16_MAX / 2U ) ) );
+
+    ( void ) memset( pStore, 0, sizeof( MqttRetransmitStore_t ) );
+    pStore->pEntries = pEntries;
+    pStore->pIndex = pIndex;
+    pStore->capacity = capacity;
+    pStore->indexSize = MQTT_RETRANSMIT_STORE_INDEX_SIZE( capacity );
+
+    resetStore( pStore );
+}
+
+/*-----------------------------------------------------------*/
+
+bool MqttRetransmitStore_Add( MqttRetransmitStore_t * pStore,
+                              uint16_t packetId,
+                              const MQTTPublishInfo_t * pPublishInfo )
+{
+    MqttRetransmitEntry_t * pEntry = NULL;
+    uint16_t entry = NO_ENTRY;
+    uint16_t position = 0U;
+    bool isAdded = false;
+
+    assert( pStore != NULL );
+    assert( pPublishInfo != NULL );
+    assert( pPublishInfo->qos != MQTTQoS0 );
+    assert( packetId != PACKET_ID_INVALID );
+
+    entry = pStore->freeHead;
+
+    if( entry == NO_ENTRY )
+    {
+        LogError( ( "No free entry to keep the publish with packet id %u.",
+                    ( unsigned int ) packetId ) );
+    }
+    else if( findInIndex( pStore, packetId ) != NO_ENTRY )
+    {
+        /* The MQTT library numbers packets from 1 again when its context is
+         * initialized, so a new publish can be given the identifier of one
+         * that is still pending. */
+        LogError( ( "A publish with packet id %u is already pending.",
+                    ( unsigned int ) packetId ) );
+    }
+    else
+    {
+        pEntry = &pStore->pEntries[ entry ];
+        pStore->freeHead = pEntry->next;
+
+        pEntry->publishInfo = *pPublishInfo;
+        pEntry->packetId = packetId;
+
+        /* Append the publish to the pending list, so that publishes are
+         * resent in the order they were first sent. */
+        pEntry->next = NO_ENTRY;
+        pEntry->previous = pStore->pendingTail;
+
+        if( pStore->pendingTail != NO_ENTRY )
+        {
+            pStore->pEntries[ pStore->pendingTail ].next = entry;
+        }
+        else
+        {
+            pStore->pendingHead = entry;
+        }
+
+        pStore->pendingTail = entry;
+        pStore->pendingCount++;
+
+        /* The index has more positions than there are entries, so a free
+         * position is always found. */
+        position = packetId % pStore->indexSize;
+
+        while( pStore->pIndex[ position ] != NO_ENTRY )
+        {
+            position = ( position + 1U ) % pStore->indexSize;
+        }
+
+        pStore->pIndex[ position ] = entry;
+        isAdded = true;
+    }
+
+    return isAdded;
+}
+
+/*-----------------------------------------------------------*/
+
+bool MqttRetransmitStore_Remove( MqttRetransmitStore_t * pStore,
+                                 uint16_t packetId )
+{
+    MqttRetransmitEntry_t * pEntry = NULL;
+    uint16_t position = NO_ENTRY;
+    uint16_t entry = NO_ENTRY;
+    bool isRemoved = false;
+
+    assert( pStore != NULL );
+
+    position = findInIndex( pStore, packetId );
+
+    if( position != NO_ENTRY )
+    {
+        entry = pStore->pIndex[ position ];
+        pEntry = &pStore->pEntries[ entry ];
+        removeFromIndex( pStore, position );
+
+        if( pEntry->previous != NO_ENTRY )
+        {
+            pStore->pEntries[ pEntry->previous ].next = pEntry->next;
+        }
+        else
+        {
+            pStore->pendingHead = pEntry->next;
+        }
+
+        if( pEntry->next != NO_ENTRY )
+        {
+            pStore->pEntries[ pEntry->next ].previous = pEntry->previous;
+        }
+        else
+        {
+            pStore->pendingTail = pEntry->previous;
+        }
+
+        pStore->pendingCount--;
+
+        ( void ) memset( pEntry, 0, sizeof( MqttRetransmitEntry_t ) );
+        pEntry->next = pStore->freeHead;
+        pStore->freeHead = entry;
+        isRemoved = true;
+    }
+
+    return isRemoved;
+}
+
+/*-----------------------------------------------------------*/
+
+bool MqttRetransmitStore_Contains( const MqttRetransmitStore_t * pStore,
+                                   uint16_t packetId )
+{
+    assert( pStore != NULL );
+
+    return( findInIndex( pStore, packetId ) != NO_ENTRY );
+}
+
+/*-----------------------------------------------------------*/
+
+void MqttRetransmitStore_Clear( MqttRetransmitStore_t * pStore )
+{
+    assert( pStore != NULL );
+
+    resetStore( pStore );
+}
+
+/*-----------------------------------------------------------*/
+
+uint16_t MqttRetransmitStore_PendingCount( const MqttRetransmitStore_t * pStore )
+{
+    assert( pStore != NULL );
+
+    return pStore->pendingCount;
+}
+
+/*-----------------------------------------------------------*/
+
+MQTTStatus_t MqttRetransmitStore_ResendAll( MqttRetransmitStore_t * pStore,
+                                            MQTTContext_t * pMqttContext )
+{
+    TransportOutVector_t ioVectors[ FLUSH_VECTOR_COUNT ];
+    uint8_t headers[ MQTT_RETRANSMIT_STORE_FLUSH_BATCH ][ PUBLISH_HEADER_MAX_SIZE ];
+    uint8_t packetIds[ MQTT_RETRANSMIT_STORE_FLUSH_BATCH ][ PUBLISH_PACKET_ID_SIZE ];
+    MqttRetransmitEntry_t * pEntry = NULL;
+    MQTTStatus_t status = MQTTSuccess;
+    uint16_t entry = NO_ENTRY;
+    size_t batchCount = 0U, vectorCount = 0U;
+    size_t remainingLength = 0U, packetSize = 0U, headerSize = 0U;
+
+    assert( pStore != NULL );
+    assert( pMqttContext != NULL );
+
+    entry = pStore->pendingHead;
+
+    while( ( status == MQTTSuccess ) && ( entry != NO_ENTRY ) )
+    {
+        batchCount = 0U;
+        vectorCount = 0U;
+
+        /* Build the packets of a batch of publishes. Only the headers are
+         * serialized; topics and payloads are sent from where they are. */
+        while( ( status == MQTTSuccess ) &&
+               ( entry != NO_ENTRY ) &&
+               ( batchCount < MQTT_RETRANSMIT_STORE_FLUSH_BATCH ) )
+        {
+            pEntry = &pStore->pEntries[ entry ];
+            pEntry->publishInfo.dup = true;
+
+            status = MQTT_GetPublishPacketSize( &pEntry->publishInfo,
+                                                &remainingLength,
+                                                &packetSize );
+
+            if( status == MQTTSuccess )
+            {
+                status = MQTT_SerializePublishHeaderWithoutTopic( &pEntry->publishInfo,
+                                                                  remainingLength,
+                                                                  headers[ batchCount ],
+                                                                  &headerSize );
+            }
+
+            if( status == MQTTSuccess )
+            {
+                LogDebug( ( "Sending duplicate PUBLISH with packet id %u.",
+                            ( unsigned int ) pEntry->packetId ) );
+
+                packetIds[ batchCount ][ 0 ] = ( uint8_t ) ( pEntry->packetId >> 8 );
+                packetIds[ batchCount ][ 1 ] = ( uint8_t ) ( pEntry->packetId & 0xFFU );
+
+                ioVectors[ vectorCount ].iov_base = headers[ batchCount ];
+                ioVectors[ vectorCount ].iov_len = headerSize;
+                vectorCount++;
+                ioVectors[ vectorCount ].iov_base = pEntry->publishInfo.pTopicName;
+                ioVectors[ vectorCount ].iov_len = pEntry->publishInfo.topicNameLength;
+                vectorCount++;
+                ioVectors[ vectorCount ].iov_base = packetIds[ batchCount ];
+                ioVectors[ vectorCount ].iov_len = PUBLISH_PACKET_ID_SIZE;
+                vectorCount++;
+
+                if( pEntry->publishInfo.payloadLength > 0U )
+                {
+                    ioVectors[ vectorCount ].iov_base = pEntry->publishInfo.pPayload;
+                    ioVectors[ vectorCount ].iov_len = pEntry->publishInfo.payloadLength;
+                    vectorCount++;
+                }
+            }
+            else
+            {
+                LogError( ( "Failed to serialize duplicate PUBLISH with packet id %u: %s.",
+                            ( unsigned int ) pEntry->packetId,
+                            MQTT_Status_strerror( status ) ) );
+            }
+
+            batchCount++;
+            entry = pEntry->next;
+        }
+
+        if( status == MQTTSuccess )
+        {
+            status = sendVectors( pMqttContext, ioVectors, vectorCount );
+        }
+    }
+
+    if( ( status == MQTTSuccess ) && ( pStore->pendingCount > 0U ) )
+    {
+        /* The resent packets count for the keep-alive interval, as for
+         * packets sent by the MQTT library. */
+        pMqttContext->lastPacketTxTime = pMqttContext->getTime();
+
+        LogInfo( ( "Resent %u unacknowledged publishes.",
+                   ( unsigned int ) pStore->pendingCount ) );
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+MQTTStatus_t MqttRetransmitStore_PublishAll( MqttRetransmitStore_t * pStore,
+                                             MQTTContext_t * pMqttContext )
+{
+    MqttRetransmitEntry_t * pEntry = NULL;
+    MQTTStatus_t status = MQTTSuccess;
+    uint16_t entry = NO_ENTRY;
+
+    assert( pStore != NULL );
+    assert( pMqttContext != NULL );
+
+    entry = pStore->pendingHead;
+
+    while( ( status == MQTTSuccess ) && ( entry != NO_ENTRY ) )
+    {
+        pEntry = &pStore->pEntries[ entry ];
+
+        /* The DUP flag makes the MQTT library accept a publish it already
+         * has a record of. */
+        pEntry->publishInfo.dup = true;
+
+        LogDebug( ( "Sending duplicate PUBLISH with packet id %u.",
+                    ( unsigned int ) pEntry->packetId ) );
+        status = MQTT_Publish( pMqttContext, &pEntry->publishInfo, pEntry->packetId );
+
+        if( status != MQTTSuccess )
+        {
+            LogError( ( "Sending duplicate PUBLISH for packet id %u failed with status %s.",
+                        ( unsigned int ) pEntry->packetId,
+                        MQTT_Status_strerror( status ) ) );
+        }
+
+        entry = pEntry->next;
+    }
+
+    return status;
+}
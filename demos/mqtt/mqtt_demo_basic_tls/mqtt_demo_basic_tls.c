@@ -1240,7 +1240,7 @@ static int initializeMqtt( MQTTContext_t * pMqttContext,
     transport.pNetworkContext = pNetworkContext;
     transport.send = Openssl_Send;
     transport.recv = Openssl_Recv;
-    transport.writev = NULL;
+    transport.writev = Openssl_Writev;
 
     /* Fill the values for network buffer. */
     networkBuffer.pBuffer = buffer;
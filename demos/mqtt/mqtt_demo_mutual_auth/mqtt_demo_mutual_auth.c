@@ -127,6 +127,12 @@
     #define NETWORK_BUFFER_SIZE    ( 1024U )
 #endif
 
+/**
+ * @brief Size of the buffer the OpenSSL transport reads decrypted data into
+ * ahead of the reads of coreMQTT.
+ */
+#define RECV_AHEAD_BUFFER_SIZE    ( 512U )
+
 #ifndef OS_NAME
     #define OS_NAME    "Ubuntu"
 #endif
@@ -351,6 +357,12 @@ static MQTTSubscribeInfo_t pGlobalSubscriptionList[ 1 ];
  */
 static uint8_t buffer[ NETWORK_BUFFER_SIZE ];
 
+/**
+ * @brief Buffer holding decrypted data read ahead of the reads of coreMQTT,
+ * so that the small reads of packet headers do not each cost an SSL_read.
+ */
+static uint8_t recvAheadBuffer[ RECV_AHEAD_BUFFER_SIZE ];
+
 /**
  * @brief Status of latest Subscribe ACK;
  * it is updated every time the callback function processes a Subscribe ACK
@@ -656,6 +668,10 @@ static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext
      * https://docs.aws.amazon.com/iot/latest/developerguide/transport-security.html */
     opensslCredentials.sniHostName = AWS_IOT_ENDPOINT;
 
+    /* Resume the previous TLS session when reconnecting to the broker, so that
+     * retries after a dropped connection skip the full handshake. */
+    opensslCredentials.enableSessionResumption = 1U;
+
     if( AWS_MQTT_PORT == 443 )
     {
         /* Pass the ALPN protocol name depending on the port and auth type being used.
@@ -1391,7 +1407,7 @@ static int initializeMqtt( MQTTContext_t * pMqttContext,
     transport.pNetworkContext = pNetworkContext;
     transport.send = Openssl_Send;
     transport.recv = Openssl_Recv;
-    transport.writev = NULL;
+    transport.writev = Openssl_Writev;
 
     /* Fill the values for network buffer. */
     networkBuffer.pBuffer = buffer;
@@ -1661,6 +1677,10 @@ int main( int argc,
     /* Set the pParams member of the network context with desired transport. */
     networkContext.pParams = &opensslParams;
 
+    /* Serve the small reads of coreMQTT from whole TLS records read ahead. */
+    opensslParams.pRecvBuffer = recvAheadBuffer;
+    opensslParams.recvBufferSize = RECV_AHEAD_BUFFER_SIZE;
+
     /* Seed pseudo random number generator (provided by ISO C standard library) for
      * use by retry utils library when retrying failed network operations. */
 
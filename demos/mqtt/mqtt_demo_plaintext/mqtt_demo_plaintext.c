@@ -78,6 +78,12 @@
     #define NETWORK_BUFFER_SIZE    ( 1024U )
 #endif
 
+/**
+ * @brief Size of the buffer the plaintext transport receives data into ahead
+ * of the reads of coreMQTT.
+ */
+#define RECV_AHEAD_BUFFER_SIZE    ( 512U )
+
 /**
  * @brief Length of client identifier.
  */
@@ -213,6 +219,12 @@ static MQTTSubscribeInfo_t pGlobalSubscriptionList[ 1 ];
  */
 static uint8_t buffer[ NETWORK_BUFFER_SIZE ];
 
+/**
+ * @brief Buffer holding data received ahead of the reads of coreMQTT, so that
+ * the small reads of packet headers do not each cost a recv.
+ */
+static uint8_t recvAheadBuffer[ RECV_AHEAD_BUFFER_SIZE ];
+
 /**
  * @brief Status of latest Subscribe ACK;
  * it is updated every time the callback function processes a Subscribe ACK
@@ -731,7 +743,7 @@ static int establishMqttSession( MQTTContext_t * pMqttContext,
     transport.pNetworkContext = pNetworkContext;
     transport.send = Plaintext_Send;
     transport.recv = Plaintext_Recv;
-    transport.writev = NULL;
+    transport.writev = Plaintext_Writev;
 
     /* Fill the values for network buffer. */
     networkBuffer.pBuffer = buffer;
@@ -1183,6 +1195,12 @@ int main( int argc,
     /* Set the pParams member of the network context with desired transport. */
     networkContext.pParams = &plaintextParams;
 
+    /* Read the socket without polling it first, and serve the small reads
+     * of coreMQTT from a buffer filled by a single recv. */
+    plaintextParams.nonBlocking = 1U;
+    plaintextParams.pRecvBuffer = recvAheadBuffer;
+    plaintextParams.recvBufferSize = RECV_AHEAD_BUFFER_SIZE;
+
     /* Seed pseudo random number generator used in the demo for
      * backoff period calculation when retrying failed network operations
      * with broker. */
@@ -874,7 +874,7 @@ static int establishMqttSession( MQTTContext_t * pMqttContext,
     transport.pNetworkContext = pNetworkContext;
     transport.send = Openssl_Send;
     transport.recv = Openssl_Recv;
-    transport.writev = NULL;
+    transport.writev = Openssl_Writev;
 
     /* Fill the values for network buffer. */
     networkBuffer.pBuffer = buffer;
@@ -1491,7 +1491,7 @@ int main( int argc,
     int returnStatus = EXIT_SUCCESS;
     MQTTContext_t mqttContext = { 0 };
     NetworkContext_t networkContext;
-    OpensslParams_t opensslParams;
+    OpensslParams_t opensslParams = { 0 };
 
     ( void ) argc;
     ( void ) argv;
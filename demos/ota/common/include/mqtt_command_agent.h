@@ -0,0 +1,303 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file mqtt_command_agent.h
+ * @brief The API of an agent that owns an MQTT context and runs the MQTT
+ * operations requested by other threads.
+ */
+
+#ifndef MQTT_COMMAND_AGENT_H_
+#define MQTT_COMMAND_AGENT_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Logging related header files are required to be included in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define LIBRARY_LOG_NAME and  LIBRARY_LOG_LEVEL.
+ * 3. Include the header file "logging_stack.h".
+ */
+
+/* Include header that defines log levels. */
+#include "logging_levels.h"
+
+/* Logging configuration for the MQTT command agent. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME     "MQTT Command Agent"
+#endif
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/* Standard includes. */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Include MQTT library. */
+#include "core_mqtt.h"
+
+/**
+ * @brief Number of commands that can wait in the command queue of an agent.
+ * Must be a power of 2.
+ */
+#ifndef MQTT_COMMAND_QUEUE_LENGTH
+    #define MQTT_COMMAND_QUEUE_LENGTH    ( 16U )
+#endif
+
+/**
+ * @brief Number of sent commands that can wait for their acknowledgement at
+ * once. It should not exceed the number of outgoing publish records given to
+ * MQTT_InitStatefulQoS.
+ */
+#ifndef MQTT_COMMAND_MAX_PENDING_ACKS
+    #define MQTT_COMMAND_MAX_PENDING_ACKS    ( 10U )
+#endif
+
+/**
+ * @brief Time in milliseconds a sent command waits for its acknowledgement
+ * before it fails.
+ */
+#ifndef MQTT_COMMAND_ACK_TIMEOUT_MS
+    #define MQTT_COMMAND_ACK_TIMEOUT_MS    ( 5000U )
+#endif
+
+/**
+ * @brief Number of slots of the index from packet identifiers to in-flight
+ * commands. Must be larger than #MQTT_COMMAND_MAX_PENDING_ACKS; twice as
+ * large keeps probe sequences short.
+ */
+#ifndef MQTT_COMMAND_IN_FLIGHT_INDEX_SIZE
+    #define MQTT_COMMAND_IN_FLIGHT_INDEX_SIZE    ( 2U * MQTT_COMMAND_MAX_PENDING_ACKS )
+#endif
+
+/**
+ * @brief Number of slots of the timer wheel expiring acknowledgement
+ * deadlines. Must be a power of 2.
+ */
+#ifndef MQTT_COMMAND_TIMER_WHEEL_SLOTS
+    #define MQTT_COMMAND_TIMER_WHEEL_SLOTS    ( 64U )
+#endif
+
+/**
+ * @brief Time in milliseconds covered by each slot of the timer wheel.
+ * Deadlines are checked at most this long after they pass. Must be a power
+ * of 2, so that the slots stay in step when the millisecond clock wraps.
+ */
+#ifndef MQTT_COMMAND_TIMER_TICK_MS
+    #define MQTT_COMMAND_TIMER_TICK_MS    ( 128U )
+#endif
+
+#if ( ( MQTT_COMMAND_QUEUE_LENGTH & ( MQTT_COMMAND_QUEUE_LENGTH - 1U ) ) != 0U )
+    #error "MQTT_COMMAND_QUEUE_LENGTH must be a power of 2."
+#endif
+
+#if ( MQTT_COMMAND_IN_FLIGHT_INDEX_SIZE <= MQTT_COMMAND_MAX_PENDING_ACKS )
+    #error "MQTT_COMMAND_IN_FLIGHT_INDEX_SIZE must be larger than MQTT_COMMAND_MAX_PENDING_ACKS."
+#endif
+
+#if ( ( MQTT_COMMAND_TIMER_WHEEL_SLOTS & ( MQTT_COMMAND_TIMER_WHEEL_SLOTS - 1U ) ) != 0U )
+    #error "MQTT_COMMAND_TIMER_WHEEL_SLOTS must be a power of 2."
+#endif
+
+#if ( ( MQTT_COMMAND_TIMER_TICK_MS & ( MQTT_COMMAND_TIMER_TICK_MS - 1U ) ) != 0U )
+    #error "MQTT_COMMAND_TIMER_TICK_MS must be a power of 2."
+#endif
+
+/**
+ * @brief A cell of the command queue.
+ */
+typedef struct MqttCommandQueueCell
+{
+    uint32_t sequence;               /**< @brief Position at which the cell can next be written or read. */
+    struct MqttCommand * pCommand;   /**< @brief The queued command. */
+} MqttCommandQueueCell_t;
+
+/**
+ * @brief A sent command waiting for its acknowledgement.
+ */
+typedef struct MqttInFlightEntry
+{
+    struct MqttCommand * pCommand; /**< @brief The waiting command, NULL if the entry is free. */
+    uint16_t packetId;             /**< @brief Packet identifier the command was sent with. */
+    uint32_t deadlineMs;           /**< @brief Time by which the acknowledgement must be received. */
+    int16_t next;                  /**< @brief Next entry of the same timer wheel slot, or of the free list. */
+    int16_t previous;              /**< @brief Previous entry of the same timer wheel slot. */
+} MqttInFlightEntry_t;
+
+/**
+ * @brief An MQTT command agent.
+ *
+ * The thread that runs the agent is the only one that calls the MQTT library
+ * with the context of the agent. Other threads queue commands to it through a
+ * lock-free queue and wait for their own command to complete. A command that
+ * needs an acknowledgement from the broker completes when the agent receives
+ * the acknowledgement with the packet identifier of the command, so several
+ * QoS 1 publishes can be in flight at once. Acknowledgements are matched to
+ * commands through an index keyed by packet identifier, and deadlines are
+ * kept in a timer wheel, so neither takes a scan of the in-flight commands.
+ *
+ * The members are private to the agent; use the MqttCommandAgent_* functions
+ * to access them.
+ */
+typedef struct MqttCommandAgent
+{
+    MQTTContext_t * pMqttContext;                                       /**< @brief The MQTT context owned by the agent. */
+    int wakeDescriptor;                                                 /**< @brief eventfd signalled when a command is queued. */
+    MqttCommandQueueCell_t queue[ MQTT_COMMAND_QUEUE_LENGTH ];          /**< @brief The command queue. */
+    uint32_t enqueuePosition;                                           /**< @brief Next position written by the threads queuing commands. */
+    uint32_t dequeuePosition;                                           /**< @brief Next position read by the agent. */
+    MqttInFlightEntry_t inFlight[ MQTT_COMMAND_MAX_PENDING_ACKS ];      /**< @brief Sent commands waiting for their acknowledgement. */
+    int16_t inFlightIndex[ MQTT_COMMAND_IN_FLIGHT_INDEX_SIZE ];         /**< @brief Open-addressing index of #inFlight by packet identifier. */
+    int16_t timerWheel[ MQTT_COMMAND_TIMER_WHEEL_SLOTS ];               /**< @brief First in-flight entry whose deadline falls in each slot. */
+    int16_t freeEntry;                                                  /**< @brief First free in-flight entry. */
+    uint32_t expiryCheckMs;                                             /**< @brief Start of the first timer tick whose deadlines have not been checked. */
+} MqttCommandAgent_t;
+
+/**
+ * @brief Initialize an agent for an MQTT context.
+ *
+ * @param[out] pAgent The agent to initialize.
+ * @param[in] pMqttContext The MQTT context, used only by the thread running
+ * the agent from now on.
+ *
+ * @return true on success; false if the wake-up descriptor could not be
+ * created.
+ */
+bool MqttCommandAgent_Init( MqttCommandAgent_t * pAgent,
+                            MQTTContext_t * pMqttContext );
+
+/**
+ * @brief Release the resources of an agent.
+ *
+ * Commands that have not completed fail with #MQTTBadResponse.
+ *
+ * @param[in] pAgent The agent.
+ */
+void MqttCommandAgent_Deinit( MqttCommandAgent_t * pAgent );
+
+/**
+ * @brief Publish a message through an agent and wait for it to complete.
+ *
+ * A QoS 0 publish completes once it is sent, a QoS 1 publish once its PUBACK
+ * is received. Must not be called from the thread running the agent.
+ *
+ * @param[in] pAgent The agent.
+ * @param[in] pPublishInfo The message to publish.
+ *
+ * @return #MQTTSuccess on success; #MQTTNoMemory if the command queue is
+ * full; #MQTTRecvFailed if the acknowledgement was not received in time; or
+ * the status of the MQTT library call.
+ */
+MQTTStatus_t MqttCommandAgent_Publish( MqttCommandAgent_t * pAgent,
+                                       const MQTTPublishInfo_t * pPublishInfo );
+
+/**
+ * @brief Subscribe to a topic filter through an agent and wait for the
+ * SUBACK.
+ *
+ * Must not be called from the thread running the agent.
+ *
+ * @param[in] pAgent The agent.
+ * @param[in] pSubscribeInfo The subscription.
+ *
+ * @return #MQTTSuccess on success; #MQTTServerRefused if the broker refused
+ * the subscription; otherwise as for #MqttCommandAgent_Publish.
+ */
+MQTTStatus_t MqttCommandAgent_Subscribe( MqttCommandAgent_t * pAgent,
+                                         const MQTTSubscribeInfo_t * pSubscribeInfo );
+
+/**
+ * @brief Unsubscribe from a topic filter through an agent and wait for the
+ * UNSUBACK.
+ *
+ * Must not be called from the thread running the agent.
+ *
+ * @param[in] pAgent The agent.
+ * @param[in] pSubscribeInfo The subscription.
+ *
+ * @return As for #MqttCommandAgent_Publish.
+ */
+MQTTStatus_t MqttCommandAgent_Unsubscribe( MqttCommandAgent_t * pAgent,
+                                           const MQTTSubscribeInfo_t * pSubscribeInfo );
+
+/**
+ * @brief Run the queued commands and fail the commands whose acknowledgement
+ * is overdue.
+ *
+ * Called by the thread running the agent while the MQTT connection is up.
+ *
+ * @param[in] pAgent The agent.
+ */
+void MqttCommandAgent_ProcessCommands( MqttCommandAgent_t * pAgent );
+
+/**
+ * @brief Complete the command acknowledged by an incoming packet.
+ *
+ * Called from the event callback of the MQTT context for PUBACK, SUBACK and
+ * UNSUBACK packets.
+ *
+ * @param[in] pAgent The agent.
+ * @param[in] packetType The type of the acknowledgement packet.
+ * @param[in] packetId The packet identifier of the acknowledgement.
+ * @param[in] result The result of deserializing the acknowledgement.
+ *
+ * @return true if a command was waiting for the acknowledgement.
+ */
+bool MqttCommandAgent_ProcessAck( MqttCommandAgent_t * pAgent,
+                                  uint8_t packetType,
+                                  uint16_t packetId,
+                                  MQTTStatus_t result );
+
+/**
+ * @brief Fail all the queued commands and the commands waiting for their
+ * acknowledgement.
+ *
+ * Called by the thread running the agent when the MQTT connection is down.
+ *
+ * @param[in] pAgent The agent.
+ * @param[in] status The status the commands complete with.
+ */
+void MqttCommandAgent_CancelCommands( MqttCommandAgent_t * pAgent,
+                                      MQTTStatus_t status );
+
+/**
+ * @brief Wait until a command is queued or the socket of the connection is
+ * readable.
+ *
+ * Data already decrypted by the TLS library is not covered by readiness of
+ * the socket, so the caller must not wait while such data is pending.
+ *
+ * @param[in] pAgent The agent.
+ * @param[in] socketDescriptor The socket of the MQTT connection.
+ * @param[in] timeoutMs The longest time to wait, in milliseconds.
+ */
+void MqttCommandAgent_Wait( MqttCommandAgent_t * pAgent,
+                            int32_t socketDescriptor,
+                            uint32_t timeoutMs );
+
+#endif /* ifndef MQTT_COMMAND_AGENT_H_ */
@@ -95,6 +95,12 @@ typedef void (* SubscriptionManagerCallback_t )( MQTTContext_t * pContext,
  * registered topic filters matching the incoming PUBLISH topic name. The dispatch
  * handler will invoke all these callbacks with matching topic filters.
  *
+ * Topic filters are indexed in a trie of topic levels, so the cost of a
+ * dispatch depends on the number of levels of the topic name rather than on
+ * the number of registered topic filters.
+ *
+ * @note The callbacks must not register or remove callbacks.
+ *
  * @param[in] pContext The context associated with the MQTT connection.
  * @param[in] pPublishInfo The incoming PUBLISH message information.
  */
@@ -0,0 +1,121 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ota_event_buffer_pool.h
+ * @brief A fixed-capacity pool of OTA event buffers that can be shared by
+ * threads without a lock.
+ */
+
+#ifndef OTA_EVENT_BUFFER_POOL_H_
+#define OTA_EVENT_BUFFER_POOL_H_
+
+/* Standard includes. */
+#include <stdint.h>
+
+/* Include OTA library for the event buffer type. */
+#include "ota.h"
+
+/**
+ * @brief A pool of OTA event buffers.
+ *
+ * Free buffers are kept in a lock-free stack, so getting and returning a
+ * buffer take constant time and never block. The members are private to the
+ * pool; use the OtaEventBufferPool_* functions to access them.
+ */
+typedef struct OtaEventBufferPool
+{
+    OtaEventData_t * pBuffers; /**< @brief The buffers of the pool. */
+    uint32_t * pNextFree;      /**< @brief Index of the next free buffer of each free buffer. */
+    uint32_t capacity;         /**< @brief Number of buffers of the pool. */
+
+    /**
+     * @brief Index of the first free buffer in the low 32 bits, and in the
+     * high 32 bits a count of changes that keeps a stale compare-and-swap from
+     * succeeding after a buffer was taken and returned in between (ABA).
+     */
+    uint64_t freeListHead;
+
+    uint32_t inUseCount;       /**< @brief Number of buffers currently taken. */
+    uint32_t highWaterMark;    /**< @brief Largest number of buffers taken at once. */
+    uint32_t exhaustedCount;   /**< @brief Number of gets that found no free buffer. */
+} OtaEventBufferPool_t;
+
+/**
+ * @brief Usage counters of an OTA event buffer pool.
+ */
+typedef struct OtaEventBufferPoolStats
+{
+    uint32_t inUseCount;     /**< @brief Number of buffers currently taken. */
+    uint32_t highWaterMark;  /**< @brief Largest number of buffers taken at once. */
+    uint32_t exhaustedCount; /**< @brief Number of gets that found no free buffer. */
+} OtaEventBufferPoolStats_t;
+
+/**
+ * @brief Make all the buffers of a pool free.
+ *
+ * Must be called before the pool is shared with other threads.
+ *
+ * @param[out] pPool The pool to initialize.
+ * @param[in] pBuffers The buffers handed out by the pool.
+ * @param[in] pNextFree Storage for the free list, of @p capacity entries.
+ * @param[in] capacity The number of buffers in @p pBuffers.
+ */
+void OtaEventBufferPool_Init( OtaEventBufferPool_t * pPool,
+                              OtaEventData_t * pBuffers,
+                              uint32_t * pNextFree,
+                              uint32_t capacity );
+
+/**
+ * @brief Take a free buffer from a pool.
+ *
+ * Safe to call from any thread at the same time as the other functions of
+ * the pool, except OtaEventBufferPool_Init.
+ *
+ * @param[in] pPool The pool to take the buffer from.
+ *
+ * @return A buffer with bufferUsed set, or NULL if all buffers are taken.
+ */
+OtaEventData_t * OtaEventBufferPool_Get( OtaEventBufferPool_t * pPool );
+
+/**
+ * @brief Return a buffer taken with OtaEventBufferPool_Get to its pool.
+ *
+ * Safe to call from any thread at the same time as the other functions of
+ * the pool, except OtaEventBufferPool_Init.
+ *
+ * @param[in] pPool The pool the buffer was taken from.
+ * @param[in] pBuffer The buffer to return.
+ */
+void OtaEventBufferPool_Put( OtaEventBufferPool_t * pPool,
+                             OtaEventData_t * pBuffer );
+
+/**
+ * @brief Read the usage counters of a pool.
+ *
+ * @param[in] pPool The pool.
+ * @param[out] pStats The counters of the pool.
+ */
+void OtaEventBufferPool_GetStats( OtaEventBufferPool_t * pPool,
+                                  OtaEventBufferPoolStats_t * pStats );
+
+#endif /* ifndef OTA_EVENT_BUFFER_POOL_H_ */
@@ -0,0 +1,763 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file mqtt_command_agent.c
+ * @brief Implementation of an agent that owns an MQTT context and runs the
+ * MQTT operations requested by other threads.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <stddef.h>
+
+/* POSIX includes. */
+#include <unistd.h>
+#include <poll.h>
+#include <semaphore.h>
+#include <sys/eventfd.h>
+
+/* Include demo config. */
+#include "demo_config.h"
+
+/* Clock for the acknowledgement deadlines. */
+#include "clock.h"
+
+/* Include header for the command agent. */
+#include "mqtt_command_agent.h"
+
+/**
+ * @brief Mask giving the queue cell of a queue position.
+ */
+#define QUEUE_INDEX_MASK    ( MQTT_COMMAND_QUEUE_LENGTH - 1U )
+
+/**
+ * @brief Mask giving the timer wheel slot of a timer tick.
+ */
+#define WHEEL_INDEX_MASK    ( MQTT_COMMAND_TIMER_WHEEL_SLOTS - 1U )
+
+/**
+ * @brief Marker for the absence of an in-flight entry.
+ */
+#define NO_ENTRY            ( -1 )
+
+/**
+ * @brief Types of commands.
+ */
+typedef enum MqttCommandType
+{
+    MqttCommandPublish,
+    MqttCommandSubscribe,
+    MqttCommandUnsubscribe
+} MqttCommandType_t;
+
+/**
+ * @brief A command, owned by the thread waiting for it to complete.
+ */
+typedef struct MqttCommand
+{
+    MqttCommandType_t type;
+    const MQTTPublishInfo_t * pPublishInfo;     /**< @brief Message of a publish command. */
+    const MQTTSubscribeInfo_t * pSubscribeInfo; /**< @brief Subscription of a subscribe or unsubscribe command. */
+    MQTTStatus_t status;                        /**< @brief Result of the command, valid once done is posted. */
+    sem_t done;                                 /**< @brief Posted by the agent when the command completes. */
+} MqttCommand_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Queue a command and wait for the agent to complete it.
+ *
+ * @param[in] pAgent The agent.
+ * @param[in] pCommand The command.
+ *
+ * @return The result of the command.
+ */
+static MQTTStatus_t submitCommand( MqttCommandAgent_t * pAgent,
+                                   MqttCommand_t * pCommand );
+
+/**
+ * @brief Add a command to the queue of an agent. Called by any thread.
+ *
+ * @return true if the command was queued; false if the queue is full.
+ */
+static bool enqueueCommand( MqttCommandAgent_t * pAgent,
+                            MqttCommand_t * pCommand );
+
+/**
+ * @brief Take the oldest command from the queue of an agent. Called by the
+ * thread running the agent only.
+ *
+ * @return The command, or NULL if the queue is empty.
+ */
+static MqttCommand_t * dequeueCommand( MqttCommandAgent_t * pAgent );
+
+/**
+ * @brief Send a command and, if it needs no acknowledgement or could not be
+ * sent, complete it. Otherwise the command takes a free in-flight entry, so
+ * one must be available.
+ *
+ * @param[in] pAgent The agent.
+ * @param[in] pCommand The command.
+ */
+static void runCommand( MqttCommandAgent_t * pAgent,
+                        MqttCommand_t * pCommand );
+
+/**
+ * @brief Record a sent command as waiting for its acknowledgement.
+ *
+ * @param[in] pAgent The agent.
+ * @param[in] pCommand The command.
+ * @param[in] packetId Packet identifier the command was sent with.
+ */
+static void addInFlight( MqttCommandAgent_t * pAgent,
+                         MqttCommand_t * pCommand,
+                         uint16_t packetId );
+
+/**
+ * @brief Find the position of the in-flight entry of a packet identifier in
+ * the index of an agent.
+ *
+ * @return The position, or #NO_ENTRY if no command waits for the packet
+ * identifier.
+ */
+static int32_t findInFlight( const MqttCommandAgent_t * pAgent,
+                             uint16_t packetId );
+
+/**
+ * @brief Release the in-flight entry at a position of the index and complete
+ * its command.
+ *
+ * @param[in] pAgent The agent.
+ * @param[in] position Position of the entry in the index.
+ * @param[in] status The status the command completes with.
+ */
+static void removeInFlight( MqttCommandAgent_t * pAgent,
+                            int32_t position,
+                            MQTTStatus_t status );
+
+/**
+ * @brief Complete with #MQTTRecvFailed the commands whose acknowledgement
+ * deadline falls in the timer ticks that have elapsed since the last check.
+ *
+ * @param[in] pAgent The agent.
+ * @param[in] now The current time in milliseconds.
+ */
+static void expireInFlight( MqttCommandAgent_t * pAgent,
+                            uint32_t now );
+
+/**
+ * @brief Set the result of a command and wake the thread waiting for it.
+ * The agent must not access the command afterwards.
+ */
+static void completeCommand( MqttCommand_t * pCommand,
+                             MQTTStatus_t status );
+
+/*-----------------------------------------------------------*/
+
+static bool enqueueCommand( MqttCommandAgent_t * pAgent,
+                            MqttCommand_t * pCommand )
+{
+    MqttCommandQueueCell_t * pCell = NULL;
+    uint32_t position = __atomic_load_n( &pAgent->enqueuePosition, __ATOMIC_RELAXED );
+    uint32_t sequence = 0U;
+    int32_t difference = 0;
+    bool isQueued = false;
+
+    for( ; ; )
+    {
+        pCell = &pAgent->queue[ position & QUEUE_INDEX_MASK ];
+        sequence = __atomic_load_n( &pCell->sequence, __ATOMIC_ACQUIRE );
+        difference = ( int32_t ) ( sequence - position );
+
+        if( difference == 0 )
+        {
+            /* The cell is free for this position; claim the position. A
+             * failed exchange reloads position. */
+            if( __atomic_compare_exchange_n( &pAgent->enqueuePosition,
+                                             &position,
+                                             position + 1U,
+                                             true,
+                                             __ATOMIC_RELAXED,
+                                             __ATOMIC_RELAXED ) == true )
+            {
+                isQueued = true;
+                break;
+            }
+        }
+        else if( difference < 0 )
+        {
+            /* The cell still holds the command queued one lap earlier. */
+            break;
+        }
+        else
+        {
+            /* Another thread claimed the position. */
+            position = __atomic_load_n( &pAgent->enqueuePosition, __ATOMIC_RELAXED );
+        }
+    }
+
+    if( isQueued == true )
+    {
+        pCell->pCommand = pCommand;
+        __atomic_store_n( &pCell->sequence, position + 1U, __ATOMIC_RELEASE );
+    }
+
+    return isQueued;
+}
+
+/*-----------------------------------------------------------*/
+
+static MqttCommand_t * dequeueCommand( MqttCommandAgent_t * pAgent )
+{
+    MqttCommand_t * pCommand = NULL;
+    uint32_t position = pAgent->dequeuePosition;
+    MqttCommandQueueCell_t * pCell = &pAgent->queue[ position & QUEUE_INDEX_MASK ];
+
+    /* A command is only read once the thread that claimed the cell has
+     * published it, so a slow producer delays the commands queued after its
+     * own until it is done. */
+    if( __atomic_load_n( &pCell->sequence, __ATOMIC_ACQUIRE ) == ( position + 1U ) )
+    {
+        pCommand = pCell->pCommand;
+        __atomic_store_n( &pCell->sequence, position + MQTT_COMMAND_QUEUE_LENGTH, __ATOMIC_RELEASE );
+        pAgent->dequeuePosition = position + 1U;
+    }
+
+    return pCommand;
+}
+
+/*-----------------------------------------------------------*/
+
+static void completeCommand( MqttCommand_t * pCommand,
+                             MQTTStatus_t status )
+{
+    pCommand->status = status;
+    ( void ) sem_post( &pCommand->done );
+}
+
+/*-----------------------------------------------------------*/
+
+static void addInFlight( MqttCommandAgent_t * pAgent,
+                         MqttCommand_t * pCommand,
+                         uint16_t packetId )
+{
+    int16_t entry = pAgent->freeEntry;
+    MqttInFlightEntry_t * pEntry = &pAgent->inFlight[ entry ];
+    size_t position = packetId % MQTT_COMMAND_IN_FLIGHT_INDEX_SIZE;
+    size_t slot = 0U;
+
+    assert( entry != NO_ENTRY );
+
+    pAgent->freeEntry = pEntry->next;
+
+    pEntry->pCommand = pCommand;
+    pEntry->packetId = packetId;
+    pEntry->deadlineMs = Clock_GetTimeMs() + MQTT_COMMAND_ACK_TIMEOUT_MS;
+
+    /* The index has more positions than there are entries, so a free
+     * position is always found. */
+    while( pAgent->inFlightIndex[ position ] != NO_ENTRY )
+    {
+        position = ( position + 1U ) % MQTT_COMMAND_IN_FLIGHT_INDEX_SIZE;
+    }
+
+    pAgent->inFlightIndex[ position ] = entry;
+
+    /* Link the entry at the head of the wheel slot of its deadline. */
+    slot = ( pEntry->deadlineMs / MQTT_COMMAND_TIMER_TICK_MS ) & WHEEL_INDEX_MASK;
+    pEntry->previous = NO_ENTRY;
+    pEntry->next = pAgent->timerWheel[ slot ];
+
+    if( pEntry->next != NO_ENTRY )
+    {
+        pAgent->inFlight[ pEntry->next ].previous = entry;
+    }
+
+    pAgent->timerWheel[ slot ] = entry;
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t findInFlight( const MqttCommandAgent_t * pAgent,
+                             uint16_t packetId )
+{
+    size_t position = packetId % MQTT_COMMAND_IN_FLIGHT_INDEX_SIZE;
+    int32_t foundPosition = NO_ENTRY;
+    int16_t entry = NO_ENTRY;
+
+    while( ( foundPosition == NO_ENTRY ) &&
+           ( ( entry = pAgent->inFlightIndex[ position ] ) != NO_ENTRY ) )
+    {
+        if( pAgent->inFlight[ entry ].packetId == packetId )
+        {
+            foundPosition = ( int32_t ) position;
+        }
+
+        position = ( position + 1U ) % MQTT_COMMAND_IN_FLIGHT_INDEX_SIZE;
+    }
+
+    return foundPosition;
+}
+
+/*-----------------------------------------------------------*/
+
+static void removeInFlight( MqttCommandAgent_t * pAgent,
+                            int32_t position,
+                            MQTTStatus_t status )
+{
+    int16_t entry = pAgent->inFlightIndex[ position ];
+    MqttInFlightEntry_t * pEntry = &pAgent->inFlight[ entry ];
+    MqttCommand_t * pCommand = pEntry->pCommand;
+    size_t emptyPosition = ( size_t ) position;
+    size_t nextPosition = ( emptyPosition + 1U ) % MQTT_COMMAND_IN_FLIGHT_INDEX_SIZE;
+    size_t homePosition = 0U;
+    size_t slot = 0U;
+
+    pAgent->inFlightIndex[ emptyPosition ] = NO_ENTRY;
+
+    /* Move back entries that would no longer be reachable from their home
+     * position across the emptied position. */
+    while( pAgent->inFlightIndex[ nextPosition ] != NO_ENTRY )
+    {
+        homePosition = pAgent->inFlight[ pAgent->inFlightIndex[ nextPosition ] ].packetId %
+                       MQTT_COMMAND_IN_FLIGHT_INDEX_SIZE;
+
+        if( ( ( nextPosition > emptyPosition ) &&
+              ( ( homePosition <= emptyPosition ) || ( homePosition > nextPosition ) ) ) ||
+            ( ( nextPosition < emptyPosition ) &&
+              ( ( homePosition <= emptyPosition ) && ( homePosition > nextPosition ) ) ) )
+        {
+            pAgent->inFlightIndex[ emptyPosition ] = pAgent->inFlightIndex[ nextPosition ];
+            pAgent->inFlightIndex[ nextPosition ] = NO_ENTRY;
+            emptyPosition = nextPosition;
+        }
+
+        nextPosition = ( nextPosition + 1U ) % MQTT_COMMAND_IN_FLIGHT_INDEX_SIZE;
+    }
+
+    /* Unlink the entry from its wheel slot. */
+    if( pEntry->previous != NO_ENTRY )
+    {
+        pAgent->inFlight[ pEntry->previous ].next = pEntry->next;
+    }
+    else
+    {
+        slot = ( pEntry->deadlineMs / MQTT_COMMAND_TIMER_TICK_MS ) & WHEEL_INDEX_MASK;
+        pAgent->timerWheel[ slot ] = pEntry->next;
+    }
+
+    if( pEntry->next != NO_ENTRY )
+    {
+        pAgent->inFlight[ pEntry->next ].previous = pEntry->previous;
+    }
+
+    pEntry->pCommand = NULL;
+    pEntry->next = pAgent->freeEntry;
+    pAgent->freeEntry = entry;
+
+    completeCommand( pCommand, status );
+}
+
+/*-----------------------------------------------------------*/
+
+static void expireInFlight( MqttCommandAgent_t * pAgent,
+                            uint32_t now )
+{
+    uint32_t tickCount = 0U;
+    int16_t entry = NO_ENTRY;
+    int16_t nextEntry = NO_ENTRY;
+    MqttInFlightEntry_t * pEntry = NULL;
+
+    /* Only whole elapsed ticks are checked, so every deadline in them has
+     * passed, except for deadlines a full turn of the wheel or more away.
+     * If the agent was not run for more than a turn, every slot is checked
+     * once. */
+    while( ( ( int32_t ) ( now - pAgent->expiryCheckMs ) >= ( int32_t ) MQTT_COMMAND_TIMER_TICK_MS ) &&
+           ( tickCount < MQTT_COMMAND_TIMER_WHEEL_SLOTS ) )
+    {
+        entry = pAgent->timerWheel[ ( pAgent->expiryCheckMs / MQTT_COMMAND_TIMER_TICK_MS ) & WHEEL_INDEX_MASK ];
+
+        while( entry != NO_ENTRY )
+        {
+            pEntry = &pAgent->inFlight[ entry ];
+            nextEntry = pEntry->next;
+
+            if( ( int32_t ) ( now - pEntry->deadlineMs ) >= 0 )
+            {
+                LogError( ( "No acknowledgement received for packet id %u.",
+                            ( unsigned int ) pEntry->packetId ) );
+                removeInFlight( pAgent,
+                                findInFlight( pAgent, pEntry->packetId ),
+                                MQTTRecvFailed );
+            }
+
+            entry = nextEntry;
+        }
+
+        pAgent->expiryCheckMs += MQTT_COMMAND_TIMER_TICK_MS;
+        tickCount++;
+    }
+
+    if( tickCount == MQTT_COMMAND_TIMER_WHEEL_SLOTS )
+    {
+        pAgent->expiryCheckMs = now & ~( MQTT_COMMAND_TIMER_TICK_MS - 1U );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void runCommand( MqttCommandAgent_t * pAgent,
+                        MqttCommand_t * pCommand )
+{
+    MQTTStatus_t mqttStatus = MQTTBadParameter;
+    uint16_t packetId = 0U;
+    bool needsAck = true;
+
+    if( pCommand->type == MqttCommandPublish )
+    {
+        needsAck = ( pCommand->pPublishInfo->qos != MQTTQoS0 );
+    }
+
+    /* A QoS 0 publish is sent without a packet id, so it does not take one
+     * from the sequence of the acknowledged packets. */
+    if( needsAck == true )
+    {
+        packetId = MQTT_GetPacketId( pAgent->pMqttContext );
+    }
+
+    switch( pCommand->type )
+    {
+        case MqttCommandPublish:
+            mqttStatus = MQTT_Publish( pAgent->pMqttContext,
+                                       pCommand->pPublishInfo,
+                                       packetId );
+            break;
+
+        case MqttCommandSubscribe:
+            mqttStatus = MQTT_Subscribe( pAgent->pMqttContext,
+                                         pCommand->pSubscribeInfo,
+                                         1U,
+                                         packetId );
+            break;
+
+        case MqttCommandUnsubscribe:
+            mqttStatus = MQTT_Unsubscribe( pAgent->pMqttContext,
+                                           pCommand->pSubscribeInfo,
+                                           1U,
+                                           packetId );
+            break;
+
+        default:
+            LogError( ( "Unknown command type %d.", ( int ) pCommand->type ) );
+            break;
+    }
+
+    if( ( mqttStatus == MQTTSuccess ) && ( needsAck == true ) )
+    {
+        addInFlight( pAgent, pCommand, packetId );
+    }
+    else
+    {
+        completeCommand( pCommand, mqttStatus );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static MQTTStatus_t submitCommand( MqttCommandAgent_t * pAgent,
+                                   MqttCommand_t * pCommand )
+{
+    uint64_t wakeValue = 1U;
+    int ret = 0;
+
+    pCommand->status = MQTTNoMemory;
+
+    if( sem_init( &pCommand->done, 0, 0 ) != 0 )
+    {
+        LogError( ( "Failed to initialize the semaphore of a command: errno=%s",
+                    strerror( errno ) ) );
+    }
+    else
+    {
+        if( enqueueCommand( pAgent, pCommand ) == false )
+        {
+            LogError( ( "The MQTT command queue is full." ) );
+        }
+        else
+        {
+            /* Wake the agent if it is waiting for the socket. */
+            ( void ) write( pAgent->wakeDescriptor, &wakeValue, sizeof( wakeValue ) );
+
+            /* The agent always completes a queued command: when it is
+             * acknowledged, when its acknowledgement is overdue, or when the
+             * connection is lost. */
+            while( ( ( ret = sem_wait( &pCommand->done ) ) == -1 ) && ( errno == EINTR ) )
+            {
+                continue;
+            }
+
+            assert( ret == 0 );
+        }
+
+        ( void ) sem_destroy( &pCommand->done );
+    }
+
+    return pCommand->status;
+}
+
+/*-----------------------------------------------------------*/
+
+bool MqttCommandAgent_Init( MqttCommandAgent_t * pAgent,
+                            MQTTContext_t * pMqttContext )
+{
+    bool result = false;
+    uint32_t index = 0U;
+
+    assert( pAgent != NULL );
+    assert( pMqttContext != NULL );
+
+    ( void ) memset( pAgent, 0, sizeof( MqttCommandAgent_t ) );
+    pAgent->pMqttContext = pMqttContext;
+
+    for( index = 0U; index < MQTT_COMMAND_QUEUE_LENGTH; index++ )
+    {
+        pAgent->queue[ index ].sequence = index;
+    }
+
+    for( index = 0U; index < MQTT_COMMAND_MAX_PENDING_ACKS; index++ )
+    {
+        pAgent->inFlight[ index ].next = ( int16_t ) ( index + 1U );
+    }
+
+    pAgent->inFlight[ MQTT_COMMAND_MAX_PENDING_ACKS - 1U ].next = NO_ENTRY;
+    pAgent->freeEntry = 0;
+
+    for( index = 0U; index < MQTT_COMMAND_IN_FLIGHT_INDEX_SIZE; index++ )
+    {
+        pAgent->inFlightIndex[ index ] = NO_ENTRY;
+    }
+
+    for( index = 0U; index < MQTT_COMMAND_TIMER_WHEEL_SLOTS; index++ )
+    {
+        pAgent->timerWheel[ index ] = NO_ENTRY;
+    }
+
+    pAgent->expiryCheckMs = Clock_GetTimeMs() & ~( MQTT_COMMAND_TIMER_TICK_MS - 1U );
+
+    pAgent->wakeDescriptor = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+
+    if( pAgent->wakeDescriptor < 0 )
+    {
+        LogError( ( "Failed to create the wake-up eventfd of the MQTT agent: errno=%s",
+                    strerror( errno ) ) );
+    }
+    else
+    {
+        result = true;
+    }
+
+    return result;
+}
+
+/*-----------------------------------------------------------*/
+
+void MqttCommandAgent_Deinit( MqttCommandAgent_t * pAgent )
+{
+    assert( pAgent != NULL );
+
+    MqttCommandAgent_CancelCommands( pAgent, MQTTBadResponse );
+
+    if( pAgent->wakeDescriptor >= 0 )
+    {
+        ( void ) close( pAgent->wakeDescriptor );
+        pAgent->wakeDescriptor = -1;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+MQTTStatus_t MqttCommandAgent_Publish( MqttCommandAgent_t * pAgent,
+                                       const MQTTPublishInfo_t * pPublishInfo )
+{
+    MqttCommand_t command = { 0 };
+
+    assert( pAgent != NULL );
+    assert( pPublishInfo != NULL );
+
+    command.type = MqttCommandPublish;
+    command.pPublishInfo = pPublishInfo;
+
+    return submitCommand( pAgent, &command );
+}
+
+/*-----------------------------------------------------------*/
+
+MQTTStatus_t MqttCommandAgent_Subscribe( MqttCommandAgent_t * pAgent,
+                                         const MQTTSubscribeInfo_t * pSubscribeInfo )
+{
+    MqttCommand_t command = { 0 };
+
+    assert( pAgent != NULL );
+    assert( pSubscribeInfo != NULL );
+
+    command.type = MqttCommandSubscribe;
+    command.pSubscribeInfo = pSubscribeInfo;
+
+    return submitCommand( pAgent, &command );
+}
+
+/*-----------------------------------------------------------*/
+
+MQTTStatus_t MqttCommandAgent_Unsubscribe( MqttCommandAgent_t * pAgent,
+                                           const MQTTSubscribeInfo_t * pSubscribeInfo )
+{
+    MqttCommand_t command = { 0 };
+
+    assert( pAgent != NULL );
+    assert( pSubscribeInfo != NULL );
+
+    command.type = MqttCommandUnsubscribe;
+    command.pSubscribeInfo = pSubscribeInfo;
+
+    return submitCommand( pAgent, &command );
+}
+
+/*-----------------------------------------------------------*/
+
+void MqttCommandAgent_ProcessCommands( MqttCommandAgent_t * pAgent )
+{
+    MqttCommand_t * pCommand = NULL;
+
+    assert( pAgent != NULL );
+
+    expireInFlight( pAgent, Clock_GetTimeMs() );
+
+    /* Commands stay queued while all in-flight entries are in use. */
+    while( ( pAgent->freeEntry != NO_ENTRY ) &&
+           ( ( pCommand = dequeueCommand( pAgent ) ) != NULL ) )
+    {
+        runCommand( pAgent, pCommand );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+bool MqttCommandAgent_ProcessAck( MqttCommandAgent_t * pAgent,
+                                  uint8_t packetType,
+                                  uint16_t packetId,
+                                  MQTTStatus_t result )
+{
+    MqttCommandType_t type = MqttCommandPublish;
+    int32_t position = NO_ENTRY;
+    bool isFound = false;
+
+    assert( pAgent != NULL );
+
+    if( packetType == MQTT_PACKET_TYPE_SUBACK )
+    {
+        type = MqttCommandSubscribe;
+    }
+    else if( packetType == MQTT_PACKET_TYPE_UNSUBACK )
+    {
+        type = MqttCommandUnsubscribe;
+    }
+    else
+    {
+        assert( packetType == MQTT_PACKET_TYPE_PUBACK );
+    }
+
+    position = findInFlight( pAgent, packetId );
+
+    if( position == NO_ENTRY )
+    {
+        LogWarn( ( "No command waits for the acknowledgement of packet id %u.",
+                   ( unsigned int ) packetId ) );
+    }
+    else if( pAgent->inFlight[ pAgent->inFlightIndex[ position ] ].pCommand->type != type )
+    {
+        LogError( ( "Acknowledgement of packet id %u does not match the type of its command.",
+                    ( unsigned int ) packetId ) );
+    }
+    else
+    {
+        removeInFlight( pAgent, position, result );
+        isFound = true;
+    }
+
+    return isFound;
+}
+
+/*-----------------------------------------------------------*/
+
+void MqttCommandAgent_CancelCommands( MqttCommandAgent_t * pAgent,
+                                      MQTTStatus_t status )
+{
+    MqttCommand_t * pCommand = NULL;
+    size_t index = 0U;
+
+    assert( pAgent != NULL );
+
+    for( index = 0U; index < MQTT_COMMAND_MAX_PENDING_ACKS; index++ )
+    {
+        if( pAgent->inFlight[ index ].pCommand != NULL )
+        {
+            removeInFlight( pAgent,
+                            findInFlight( pAgent, pAgent->inFlight[ index ].packetId ),
+                            status );
+        }
+    }
+
+    while( ( pCommand = dequeueCommand( pAgent ) ) != NULL )
+    {
+        completeCommand( pCommand, status );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void MqttCommandAgent_Wait( MqttCommandAgent_t * pAgent,
+                            int32_t socketDescriptor,
+                            uint32_t timeoutMs )
+{
+    struct pollfd pollFds[ 2 ];
+    uint64_t wakeValue = 0U;
+
+    assert( pAgent != NULL );
+
+    pollFds[ 0 ].fd = pAgent->wakeDescriptor;
+    pollFds[ 0 ].events = POLLIN;
+    pollFds[ 0 ].revents = 0;
+    pollFds[ 1 ].fd = socketDescriptor;
+    pollFds[ 1 ].events = POLLIN | POLLPRI;
+    pollFds[ 1 ].revents = 0;
+
+    /* Commands are checked after the wait, so a command queued after the
+     * agent last checked leaves the eventfd readable and ends the wait. */
+    if( ( poll( pollFds, 2, ( int ) timeoutMs ) > 0 ) &&
+        ( ( pollFds[ 0 ].revents & POLLIN ) != 0 ) )
+    {
+        ( void ) read( pAgent->wakeDescriptor, &wakeValue, sizeof( wakeValue ) );
+    }
+}
@@ -37,6 +37,63 @@
 #include "mqtt_subscription_manager.h"
 
 
+/**
+ * @brief The default value for the maximum size of the callback registry in the
+ * subscription manager.
+ */
+#ifndef MAX_SUBSCRIPTION_CALLBACK_RECORDS
+    #define MAX_SUBSCRIPTION_CALLBACK_RECORDS    5
+#endif
+
+/**
+ * @brief The average number of topic levels per registered topic filter that
+ * the topic trie is sized for.
+ */
+#ifndef MAX_SUBSCRIPTION_TOPIC_LEVELS
+    #define MAX_SUBSCRIPTION_TOPIC_LEVELS    8
+#endif
+
+/**
+ * @brief The number of nodes in the topic trie, including its root. Each node
+ * represents one topic level shared by all topic filters with the same
+ * preceding levels.
+ */
+#ifndef MAX_SUBSCRIPTION_TRIE_NODES
+    #define MAX_SUBSCRIPTION_TRIE_NODES    ( ( MAX_SUBSCRIPTION_CALLBACK_RECORDS * MAX_SUBSCRIPTION_TOPIC_LEVELS ) + 1 )
+#endif
+
+/**
+ * @brief The number of slots of the hash index of registered topic filters.
+ * Kept at about twice the number of records for short probe sequences.
+ */
+#define FILTER_INDEX_SIZE    ( ( 2 * MAX_SUBSCRIPTION_CALLBACK_RECORDS ) + 1 )
+
+/**
+ * @brief The number of slots of the hash index of trie edges, keyed by parent
+ * node and topic level.
+ */
+#define EDGE_INDEX_SIZE      ( ( 2 * MAX_SUBSCRIPTION_TRIE_NODES ) + 1 )
+
+/**
+ * @brief Marker for the absence of a record, trie node or index entry.
+ */
+#define NO_INDEX             ( -1 )
+
+/**
+ * @brief Index of the root node of the topic trie.
+ */
+#define ROOT_NODE            ( 0 )
+
+/**
+ * @brief FNV-1a offset basis, used to seed hashes.
+ */
+#define FNV_OFFSET_BASIS     ( 2166136261U )
+
+/**
+ * @brief FNV-1a prime.
+ */
+#define FNV_PRIME            ( 16777619U )
+
 /**
  * @brief Represents a registered record of the topic filter and its associated callback
  * in the subscription manager registry.
@@ -46,53 +103,669 @@ typedef struct SubscriptionManagerRecord
     const char * pTopicFilter;
     uint16_t topicFilterLength;
     SubscriptionManagerCallback_t callback;
+    int32_t leafNode;       /**< Trie node of the last level of the topic filter. */
+    int32_t nextFreeRecord; /**< Next record in the free list. */
 } SubscriptionManagerRecord_t;
 
 /**
- * @brief The default value for the maximum size of the callback registry in the
- * subscription manager.
+ * @brief A node of the topic trie, representing one level of a topic filter.
+ *
+ * The node does not copy its topic level. It refers to the level in the topic
+ * filter of a record passing through the node; since all such topic filters
+ * share the same preceding levels, the level is at the same offset in each.
  */
-#ifndef MAX_SUBSCRIPTION_CALLBACK_RECORDS
-    #define MAX_SUBSCRIPTION_CALLBACK_RECORDS    5
-#endif
+typedef struct TopicTrieNode
+{
+    int32_t parent;
+    int32_t firstChild;
+    int32_t nextSibling; /**< Next sibling, or next node in the free list. */
+    int32_t prevSibling;
+    int32_t ownerRecord; /**< Record whose topic filter holds the level of this node. */
+    uint16_t levelOffset;
+    uint16_t levelLength;
+    int32_t record;      /**< Record whose topic filter ends at this node, if any. */
+} TopicTrieNode_t;
+
+/**
+ * @brief An open-addressing hash index mapping keys to record or node indices.
+ */
+typedef struct HashIndex
+{
+    int32_t * pValues;
+    uint32_t * pHashes;
+    size_t size;
+} HashIndex_t;
+
+/**
+ * @brief Compares the key of an index entry with a looked up key.
+ */
+typedef bool (* HashIndexMatch_t )( int32_t value,
+                                    const void * pKey );
+
+/**
+ * @brief Key of the trie edge index.
+ */
+typedef struct EdgeKey
+{
+    int32_t parent;
+    const char * pLevel;
+    uint16_t levelLength;
+} EdgeKey_t;
+
+/**
+ * @brief Key of the topic filter index.
+ */
+typedef struct FilterKey
+{
+    const char * pTopicFilter;
+    uint16_t topicFilterLength;
+} FilterKey_t;
 
 /**
  * @brief The registry to store records of topic filters and their subscription callbacks.
  */
 static SubscriptionManagerRecord_t callbackRecordList[ MAX_SUBSCRIPTION_CALLBACK_RECORDS ] = { 0 };
 
+/**
+ * @brief The nodes of the topic trie.
+ */
+static TopicTrieNode_t trieNodes[ MAX_SUBSCRIPTION_TRIE_NODES ];
+
+/**
+ * @brief Storage of the hash index of registered topic filters.
+ */
+static int32_t filterIndexValues[ FILTER_INDEX_SIZE ];
+static uint32_t filterIndexHashes[ FILTER_INDEX_SIZE ];
+
+/**
+ * @brief Storage of the hash index of trie edges.
+ */
+static int32_t edgeIndexValues[ EDGE_INDEX_SIZE ];
+static uint32_t edgeIndexHashes[ EDGE_INDEX_SIZE ];
+
+/**
+ * @brief Hash index of registered topic filters, for registration and removal.
+ */
+static HashIndex_t filterIndex = { filterIndexValues, filterIndexHashes, FILTER_INDEX_SIZE };
+
+/**
+ * @brief Hash index of trie edges, for looking up the child of a node.
+ */
+static HashIndex_t edgeIndex = { edgeIndexValues, edgeIndexHashes, EDGE_INDEX_SIZE };
+
+/**
+ * @brief Heads of the free lists of records and trie nodes.
+ */
+static int32_t freeRecord = NO_INDEX;
+static int32_t freeNode = NO_INDEX;
+
+/**
+ * @brief Whether the trie and indices have been initialized.
+ */
+static bool isInitialized = false;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Initialize the trie, the indices and the free lists on first use.
+ */
+static void initializeRegistry( void );
+
+/**
+ * @brief Compute the FNV-1a hash of a string.
+ *
+ * @param[in] seed Hash to continue from.
+ * @param[in] pData String to hash.
+ * @param[in] length Length of the string.
+ *
+ * @return The hash.
+ */
+static uint32_t hashString( uint32_t seed,
+                            const char * pData,
+                            size_t length );
+
+/**
+ * @brief Find the position of an entry in a hash index.
+ *
+ * @param[in] pIndex Hash index to search.
+ * @param[in] hash Hash of the key.
+ * @param[in] match Function comparing the key of an entry with @p pKey.
+ * @param[in] pKey Key to look up.
+ *
+ * @return Position of the entry, or #NO_INDEX if the key is not in the index.
+ */
+static int32_t findInIndex( const HashIndex_t * pIndex,
+                            uint32_t hash,
+                            HashIndexMatch_t match,
+                            const void * pKey );
+
+/**
+ * @brief Add an entry to a hash index. The index is sized so that it
+ * always has free slots.
+ *
+ * @param[in] pIndex Hash index to add to.
+ * @param[in] hash Hash of the key.
+ * @param[in] value Record or node index to store.
+ */
+static void insertInIndex( HashIndex_t * pIndex,
+                           uint32_t hash,
+                           int32_t value );
+
+/**
+ * @brief Remove the entry at a position of a hash index, shifting back the
+ * entries that follow it in the same probe sequence.
+ *
+ * @param[in] pIndex Hash index to remove from.
+ * @param[in] position Position of the entry.
+ */
+static void removeFromIndex( HashIndex_t * pIndex,
+                             int32_t position );
+
+/**
+ * @brief Compare the topic filter of a record with a #FilterKey_t.
+ */
+static bool matchFilter( int32_t value,
+                         const void * pKey );
+
+/**
+ * @brief Compare the parent and level of a trie node with an #EdgeKey_t.
+ */
+static bool matchEdge( int32_t value,
+                       const void * pKey );
+
+/**
+ * @brief Get the topic level represented by a trie node.
+ *
+ * @param[in] node Index of the trie node.
+ *
+ * @return Pointer to the level, of length #TopicTrieNode_t.levelLength.
+ */
+static const char * getNodeLevel( int32_t node );
+
+/**
+ * @brief Hash the key of a trie edge.
+ */
+static uint32_t hashEdge( int32_t parent,
+                          const char * pLevel,
+                          uint16_t levelLength );
+
+/**
+ * @brief Find the child of a trie node for a topic level.
+ *
+ * @param[in] parent Index of the parent node.
+ * @param[in] pLevel Topic level.
+ * @param[in] levelLength Length of the topic level.
+ *
+ * @return Index of the child node, or #NO_INDEX.
+ */
+static int32_t findChild( int32_t parent,
+                          const char * pLevel,
+                          uint16_t levelLength );
+
+/**
+ * @brief Add a child to a trie node.
+ *
+ * @param[in] parent Index of the parent node.
+ * @param[in] record Record whose topic filter holds the level of the child.
+ * @param[in] levelOffset Offset of the level in the topic filter.
+ * @param[in] levelLength Length of the level.
+ *
+ * @return Index of the child node, or #NO_INDEX if no node is free.
+ */
+static int32_t addChild( int32_t parent,
+                         int32_t record,
+                         uint16_t levelOffset,
+                         uint16_t levelLength );
+
+/**
+ * @brief Free trie nodes that no longer lead to a record, starting from
+ * @p node and moving towards the root.
+ *
+ * @param[in] node Index of the trie node to start from.
+ *
+ * @return Index of the deepest node left in the trie on the path.
+ */
+static int32_t pruneNodes( int32_t node );
+
+/**
+ * @brief Invoke the callback of a record for an incoming PUBLISH message.
+ */
+static void invokeRecord( int32_t record,
+                          MQTTContext_t * pContext,
+                          MQTTPublishInfo_t * pPublishInfo );
+
+/**
+ * @brief Invoke the callbacks of the topic filters under a trie node that
+ * match the remaining levels of a topic name.
+ *
+ * @param[in] node Trie node matching the levels already processed.
+ * @param[in] pRemaining Remaining levels of the topic name.
+ * @param[in] remainingLength Length of @p pRemaining.
+ * @param[in] hasLevels Whether a level remains; an empty @p pRemaining is
+ * still an (empty) level after a trailing '/'.
+ * @param[in] pContext The context associated with the MQTT connection.
+ * @param[in] pPublishInfo The incoming PUBLISH message information.
+ */
+static void dispatchToNode( int32_t node,
+                            const char * pRemaining,
+                            uint16_t remainingLength,
+                            bool hasLevels,
+                            MQTTContext_t * pContext,
+                            MQTTPublishInfo_t * pPublishInfo );
+
+/*-----------------------------------------------------------*/
+
+static void initializeRegistry( void )
+{
+    int32_t index = 0;
+
+    for( index = 0; index < MAX_SUBSCRIPTION_CALLBACK_RECORDS; index++ )
+    {
+        callbackRecordList[ index ].leafNode = NO_INDEX;
+        callbackRecordList[ index ].nextFreeRecord = ( index + 1 < MAX_SUBSCRIPTION_CALLBACK_RECORDS ) ? ( index + 1 ) : NO_INDEX;
+    }
+
+    freeRecord = 0;
+
+    for( index = 0; index < MAX_SUBSCRIPTION_TRIE_NODES; index++ )
+    {
+        trieNodes[ index ].parent = NO_INDEX;
+        trieNodes[ index ].firstChild = NO_INDEX;
+        trieNodes[ index ].prevSibling = NO_INDEX;
+        trieNodes[ index ].ownerRecord = NO_INDEX;
+        trieNodes[ index ].record = NO_INDEX;
+        trieNodes[ index ].nextSibling = ( index + 1 < MAX_SUBSCRIPTION_TRIE_NODES ) ? ( index + 1 ) : NO_INDEX;
+    }
+
+    /* The root node represents the start of every topic and is never freed. */
+    trieNodes[ ROOT_NODE ].nextSibling = NO_INDEX;
+    freeNode = ROOT_NODE + 1;
+
+    for( index = 0; index < FILTER_INDEX_SIZE; index++ )
+    {
+        filterIndexValues[ index ] = NO_INDEX;
+    }
+
+    for( index = 0; index < EDGE_INDEX_SIZE; index++ )
+    {
+        edgeIndexValues[ index ] = NO_INDEX;
+    }
+
+    isInitialized = true;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t hashString( uint32_t seed,
+                            const char * pData,
+                            size_t length )
+{
+    uint32_t hash = seed;
+    size_t index = 0u;
+
+    for( index = 0; index < length; index++ )
+    {
+        hash ^= ( uint8_t ) pData[ index ];
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t findInIndex( const HashIndex_t * pIndex,
+                            uint32_t hash,
+                            HashIndexMatch_t match,
+                            const void * pKey )
+{
+    size_t position = hash % pIndex->size;
+    int32_t foundPosition = NO_INDEX;
+
+    while( ( foundPosition == NO_INDEX ) && ( pIndex->pValues[ position ] != NO_INDEX ) )
+    {
+        if( ( pIndex->pHashes[ position ] == hash ) &&
+            ( match( pIndex->pValues[ position ], pKey ) == true ) )
+        {
+            foundPosition = ( int32_t ) position;
+        }
+
+        position = ( position + 1u ) % pIndex->size;
+    }
+
+    return foundPosition;
+}
+
+/*-----------------------------------------------------------*/
+
+static void insertInIndex( HashIndex_t * pIndex,
+                           uint32_t hash,
+                           int32_t value )
+{
+    size_t position = hash % pIndex->size;
+
+    while( pIndex->pValues[ position ] != NO_INDEX )
+    {
+        position = ( position + 1u ) % pIndex->size;
+    }
+
+    pIndex->pValues[ position ] = value;
+    pIndex->pHashes[ position ] = hash;
+}
+
+/*-----------------------------------------------------------*/
+
+static void removeFromIndex( HashIndex_t * pIndex,
+                             int32_t position )
+{
+    size_t emptyPosition = ( size_t ) position;
+    size_t nextPosition = ( emptyPosition + 1u ) % pIndex->size;
+    size_t homePosition = 0u;
+
+    pIndex->pValues[ emptyPosition ] = NO_INDEX;
+
+    /* Move back entries that would no longer be reachable from their home
+     * position across the emptied slot. */
+    while( pIndex->pValues[ nextPosition ] != NO_INDEX )
+    {
+        homePosition = pIndex->pHashes[ nextPosition ] % pIndex->size;
+
+        if( ( ( nextPosition > emptyPosition ) &&
+              ( ( homePosition <= emptyPosition ) || ( homePosition > nextPosition ) ) ) ||
+            ( ( nextPosition < emptyPosition ) &&
+              ( ( homePosition <= emptyPosition ) && ( homePosition > nextPosition ) ) ) )
+        {
+            pIndex->pValues[ emptyPosition ] = pIndex->pValues[ nextPosition ];
+            pIndex->pHashes[ emptyPosition ] = pIndex->pHashes[ nextPosition ];
+            pIndex->pValues[ nextPosition ] = NO_INDEX;
+            emptyPosition = nextPosition;
+        }
+
+        nextPosition = ( nextPosition + 1u ) % pIndex->size;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static bool matchFilter( int32_t value,
+                         const void * pKey )
+{
+    const FilterKey_t * pFilterKey = ( const FilterKey_t * ) pKey;
+    const SubscriptionManagerRecord_t * pRecord = &callbackRecordList[ value ];
+
+    return ( pRecord->topicFilterLength == pFilterKey->topicFilterLength ) &&
+           ( strncmp( pRecord->pTopicFilter, pFilterKey->pTopicFilter, pFilterKey->topicFilterLength ) == 0 );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool matchEdge( int32_t value,
+                       const void * pKey )
+{
+    const EdgeKey_t * pEdgeKey = ( const EdgeKey_t * ) pKey;
+    const TopicTrieNode_t * pNode = &trieNodes[ value ];
+
+    return ( pNode->parent == pEdgeKey->parent ) &&
+           ( pNode->levelLength == pEdgeKey->levelLength ) &&
+           ( strncmp( getNodeLevel( value ), pEdgeKey->pLevel, pEdgeKey->levelLength ) == 0 );
+}
+
+/*-----------------------------------------------------------*/
+
+static const char * getNodeLevel( int32_t node )
+{
+    const TopicTrieNode_t * pNode = &trieNodes[ node ];
+
+    return &callbackRecordList[ pNode->ownerRecord ].pTopicFilter[ pNode->levelOffset ];
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t hashEdge( int32_t parent,
+                          const char * pLevel,
+                          uint16_t levelLength )
+{
+    uint32_t hash = FNV_OFFSET_BASIS;
+
+    hash = hashString( hash, ( const char * ) &parent, sizeof( parent ) );
+
+    return hashString( hash, pLevel, levelLength );
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t findChild( int32_t parent,
+                          const char * pLevel,
+                          uint16_t levelLength )
+{
+    EdgeKey_t key = { parent, pLevel, levelLength };
+    int32_t position = NO_INDEX;
+    int32_t child = NO_INDEX;
+
+    position = findInIndex( &edgeIndex, hashEdge( parent, pLevel, levelLength ), matchEdge, &key );
+
+    if( position != NO_INDEX )
+    {
+        child = edgeIndexValues[ position ];
+    }
+
+    return child;
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t addChild( int32_t parent,
+                         int32_t record,
+                         uint16_t levelOffset,
+                         uint16_t levelLength )
+{
+    int32_t child = freeNode;
+    TopicTrieNode_t * pChild = NULL;
+
+    if( child != NO_INDEX )
+    {
+        pChild = &trieNodes[ child ];
+        freeNode = pChild->nextSibling;
+
+        pChild->parent = parent;
+        pChild->firstChild = NO_INDEX;
+        pChild->ownerRecord = record;
+        pChild->levelOffset = levelOffset;
+        pChild->levelLength = levelLength;
+        pChild->record = NO_INDEX;
+
+        /* Link the child at the head of the children of the parent. */
+        pChild->prevSibling = NO_INDEX;
+        pChild->nextSibling = trieNodes[ parent ].firstChild;
+
+        if( pChild->nextSibling != NO_INDEX )
+        {
+            trieNodes[ pChild->nextSibling ].prevSibling = child;
+        }
+
+        trieNodes[ parent ].firstChild = child;
+
+        insertInIndex( &edgeIndex,
+                       hashEdge( parent, getNodeLevel( child ), levelLength ),
+                       child );
+    }
+
+    return child;
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t pruneNodes( int32_t node )
+{
+    TopicTrieNode_t * pNode = NULL;
+    EdgeKey_t key;
+    int32_t position = NO_INDEX;
+    int32_t parent = NO_INDEX;
+
+    while( ( node != ROOT_NODE ) &&
+           ( trieNodes[ node ].record == NO_INDEX ) &&
+           ( trieNodes[ node ].firstChild == NO_INDEX ) )
+    {
+        pNode = &trieNodes[ node ];
+        parent = pNode->parent;
+
+        /* Remove the edge from the parent. */
+        key.parent = parent;
+        key.pLevel = getNodeLevel( node );
+        key.levelLength = pNode->levelLength;
+        position = findInIndex( &edgeIndex,
+                                hashEdge( parent, key.pLevel, key.levelLength ),
+                                matchEdge,
+                                &key );
+        assert( position != NO_INDEX );
+        removeFromIndex( &edgeIndex, position );
+
+        /* Unlink the node from its siblings. */
+        if( pNode->prevSibling != NO_INDEX )
+        {
+            trieNodes[ pNode->prevSibling ].nextSibling = pNode->nextSibling;
+        }
+        else
+        {
+            trieNodes[ parent ].firstChild = pNode->nextSibling;
+        }
+
+        if( pNode->nextSibling != NO_INDEX )
+        {
+            trieNodes[ pNode->nextSibling ].prevSibling = pNode->prevSibling;
+        }
+
+        /* Return the node to the free list. */
+        pNode->parent = NO_INDEX;
+        pNode->ownerRecord = NO_INDEX;
+        pNode->nextSibling = freeNode;
+        freeNode = node;
+
+        node = parent;
+    }
+
+    return node;
+}
+
+/*-----------------------------------------------------------*/
+
+static void invokeRecord( int32_t record,
+                          MQTTContext_t * pContext,
+                          MQTTPublishInfo_t * pPublishInfo )
+{
+    if( record != NO_INDEX )
+    {
+        LogInfo( ( "Invoking subscription callback of matching topic filter: "
+                   "TopicFilter=%.*s, TopicName=%.*s",
+                   callbackRecordList[ record ].topicFilterLength,
+                   callbackRecordList[ record ].pTopicFilter,
+                   pPublishInfo->topicNameLength,
+                   pPublishInfo->pTopicName ) );
+
+        /* Invoke the callback associated with the record as the topics match. */
+        callbackRecordList[ record ].callback( pContext, pPublishInfo );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void dispatchToNode( int32_t node,
+                            const char * pRemaining,
+                            uint16_t remainingLength,
+                            bool hasLevels,
+                            MQTTContext_t * pContext,
+                            MQTTPublishInfo_t * pPublishInfo )
+{
+    uint16_t levelLength = 0u;
+    const char * pNextLevel = NULL;
+    uint16_t nextLength = 0u;
+    bool nextHasLevels = false;
+    int32_t child = NO_INDEX;
+
+    if( hasLevels == false )
+    {
+        /* The topic name ends at this node. A multi-level wildcard following
+         * it also matches, as "a/#" matches "a". */
+        invokeRecord( trieNodes[ node ].record, pContext, pPublishInfo );
+
+        if( node != ROOT_NODE )
+        {
+            child = findChild( node, "#", 1u );
+
+            if( child != NO_INDEX )
+            {
+                invokeRecord( trieNodes[ child ].record, pContext, pPublishInfo );
+            }
+        }
+    }
+    else
+    {
+        while( ( levelLength < remainingLength ) && ( pRemaining[ levelLength ] != '/' ) )
+        {
+            levelLength++;
+        }
+
+        if( levelLength < remainingLength )
+        {
+            pNextLevel = &pRemaining[ levelLength + 1u ];
+            nextLength = remainingLength - levelLength - 1u;
+            nextHasLevels = true;
+        }
+
+        /* Topic names cannot contain wildcard characters, so an exact match
+         * never duplicates a wildcard match below. */
+        child = findChild( node, pRemaining, levelLength );
+
+        if( child != NO_INDEX )
+        {
+            dispatchToNode( child, pNextLevel, nextLength, nextHasLevels, pContext, pPublishInfo );
+        }
+
+        /* Wildcards at the first level do not match topic names starting
+         * with '$', such as the reserved "$aws/" topics. */
+        if( ( node != ROOT_NODE ) || ( pRemaining[ 0 ] != '$' ) )
+        {
+            child = findChild( node, "+", 1u );
+
+            if( child != NO_INDEX )
+            {
+                dispatchToNode( child, pNextLevel, nextLength, nextHasLevels, pContext, pPublishInfo );
+            }
+
+            child = findChild( node, "#", 1u );
+
+            if( child != NO_INDEX )
+            {
+                invokeRecord( trieNodes[ child ].record, pContext, pPublishInfo );
+            }
+        }
+    }
+}
+
 /*-----------------------------------------------------------*/
 
 void SubscriptionManager_DispatchHandler( MQTTContext_t * pContext,
                                           MQTTPublishInfo_t * pPublishInfo )
 {
-    bool matchStatus = false;
-    size_t listIndex = 0u;
-
     assert( pPublishInfo != NULL );
     assert( pContext != NULL );
 
-    /* Iterate through record list to find matching topics, and invoke their callbacks. */
-    for( listIndex = 0; listIndex < MAX_SUBSCRIPTION_CALLBACK_RECORDS; listIndex++ )
+    if( isInitialized == false )
     {
-        if( ( callbackRecordList[ listIndex ].pTopicFilter != NULL ) &&
-            ( MQTT_MatchTopic( pPublishInfo->pTopicName,
-                               pPublishInfo->topicNameLength,
-                               callbackRecordList[ listIndex ].pTopicFilter,
-                               callbackRecordList[ listIndex ].topicFilterLength,
-                               &matchStatus ) == MQTTSuccess ) &&
-            ( matchStatus == true ) )
-        {
-            LogInfo( ( "Invoking subscription callback of matching topic filter: "
-                       "TopicFilter=%.*s, TopicName=%.*s",
-                       callbackRecordList[ listIndex ].topicFilterLength,
-                       callbackRecordList[ listIndex ].pTopicFilter,
-                       pPublishInfo->topicNameLength,
-                       pPublishInfo->pTopicName ) );
-
-            /* Invoke the callback associated with the record as the topics match. */
-            callbackRecordList[ listIndex ].callback( pContext, pPublishInfo );
-        }
+        initializeRegistry();
+    }
+
+    /* Walk the topic trie along the levels of the topic name, following
+     * exact and wildcard levels, and invoke the callbacks of the topic
+     * filters reached. */
+    if( ( pPublishInfo->pTopicName != NULL ) && ( pPublishInfo->topicNameLength > 0u ) )
+    {
+        dispatchToNode( ROOT_NODE,
+                        pPublishInfo->pTopicName,
+                        pPublishInfo->topicNameLength,
+                        true,
+                        pContext,
+                        pPublishInfo );
     }
 }
 
@@ -106,36 +779,23 @@ SubscriptionManagerStatus_t SubscriptionManager_RegisterCallback( const char * p
     assert( topicFilterLength != 0 );
     assert( callback != NULL );
 
-    SubscriptionManagerStatus_t returnStatus;
-    size_t availableIndex = MAX_SUBSCRIPTION_CALLBACK_RECORDS;
-    bool recordExists = false;
-    size_t index = 0u;
+    SubscriptionManagerStatus_t returnStatus = SUBSCRIPTION_MANAGER_SUCCESS;
+    FilterKey_t key = { pTopicFilter, topicFilterLength };
+    uint32_t filterHash = 0u;
+    int32_t record = NO_INDEX;
+    int32_t node = ROOT_NODE;
+    int32_t child = NO_INDEX;
+    size_t levelOffset = 0u;
+    uint16_t levelLength = 0u;
 
-    /* Search for the first available spot in the list to store the record, and also check if
-     * a record for the topic filter already exists. */
-    while( ( recordExists == false ) && ( index < MAX_SUBSCRIPTION_CALLBACK_RECORDS ) )
+    if( isInitialized == false )
     {
-        /* Check if the index represents an empty spot in the registry. If we had already
-         * found an empty spot in the list, we will not update it. */
-        if( ( availableIndex == MAX_SUBSCRIPTION_CALLBACK_RECORDS ) &&
-            ( callbackRecordList[ index ].pTopicFilter == NULL ) )
-        {
-            availableIndex = index;
-        }
-
-        /* Check if the current record's topic filter in the registry matches the topic filter
-         * we are trying to register. */
-        else if( ( callbackRecordList[ index ].topicFilterLength == topicFilterLength ) &&
-                 ( strncmp( pTopicFilter, callbackRecordList[ index ].pTopicFilter, topicFilterLength )
-                   == 0 ) )
-        {
-            recordExists = true;
-        }
-
-        index++;
+        initializeRegistry();
     }
 
-    if( recordExists == true )
+    filterHash = hashString( FNV_OFFSET_BASIS, pTopicFilter, topicFilterLength );
+
+    if( findInIndex( &filterIndex, filterHash, matchFilter, &key ) != NO_INDEX )
     {
         /* The record for the topic filter already exists. */
         LogError( ( "Failed to register callback: Record for topic filter already exists: TopicFilter=%.*s",
@@ -144,7 +804,7 @@ SubscriptionManagerStatus_t SubscriptionManager_RegisterCallback( const char * p
 
         returnStatus = SUBSCRIPTION_MANAGER_RECORD_EXISTS;
     }
-    else if( availableIndex == MAX_SUBSCRIPTION_CALLBACK_RECORDS )
+    else if( freeRecord == NO_INDEX )
     {
         /* The registry is full. */
         LogError( ( "Unable to register callback: Registry list is full: TopicFilter=%.*s, MaxRegistrySize=%u",
@@ -156,15 +816,67 @@ SubscriptionManagerStatus_t SubscriptionManager_RegisterCallback( const char * p
     }
     else
     {
-        callbackRecordList[ availableIndex ].pTopicFilter = pTopicFilter;
-        callbackRecordList[ availableIndex ].topicFilterLength = topicFilterLength;
-        callbackRecordList[ availableIndex ].callback = callback;
+        record = freeRecord;
+        freeRecord = callbackRecordList[ record ].nextFreeRecord;
 
-        returnStatus = SUBSCRIPTION_MANAGER_SUCCESS;
+        callbackRecordList[ record ].pTopicFilter = pTopicFilter;
+        callbackRecordList[ record ].topicFilterLength = topicFilterLength;
+        callbackRecordList[ record ].callback = callback;
 
-        LogDebug( ( "Added callback to registry: TopicFilter=%.*s",
-                    topicFilterLength,
-                    pTopicFilter ) );
+        /* Follow the levels of the topic filter down the trie, adding the
+         * levels not shared with already registered topic filters. */
+        while( ( node != NO_INDEX ) && ( levelOffset <= topicFilterLength ) )
+        {
+            levelLength = 0u;
+
+            while( ( ( levelOffset + levelLength ) < topicFilterLength ) &&
+                   ( pTopicFilter[ levelOffset + levelLength ] != '/' ) )
+            {
+                levelLength++;
+            }
+
+            child = findChild( node, &pTopicFilter[ levelOffset ], levelLength );
+
+            if( child == NO_INDEX )
+            {
+                child = addChild( node, record, ( uint16_t ) levelOffset, levelLength );
+            }
+
+            if( child == NO_INDEX )
+            {
+                /* Undo the levels added for this topic filter. */
+                ( void ) pruneNodes( node );
+            }
+
+            node = child;
+            levelOffset += ( size_t ) levelLength + 1u;
+        }
+
+        if( node == NO_INDEX )
+        {
+            LogError( ( "Unable to register callback: Topic trie is full: TopicFilter=%.*s, MaxTrieNodes=%u",
+                        topicFilterLength,
+                        pTopicFilter,
+                        MAX_SUBSCRIPTION_TRIE_NODES ) );
+
+            callbackRecordList[ record ].pTopicFilter = NULL;
+            callbackRecordList[ record ].topicFilterLength = 0u;
+            callbackRecordList[ record ].callback = NULL;
+            callbackRecordList[ record ].nextFreeRecord = freeRecord;
+            freeRecord = record;
+
+            returnStatus = SUBSCRIPTION_MANAGER_REGISTRY_FULL;
+        }
+        else
+        {
+            trieNodes[ node ].record = record;
+            callbackRecordList[ record ].leafNode = node;
+            insertInIndex( &filterIndex, filterHash, record );
+
+            LogDebug( ( "Added callback to registry: TopicFilter=%.*s",
+                        topicFilterLength,
+                        pTopicFilter ) );
+        }
     }
 
     return returnStatus;
@@ -178,31 +890,54 @@ void SubscriptionManager_RemoveCallback( const char * pTopicFilter,
     assert( pTopicFilter != NULL );
     assert( topicFilterLength != 0 );
 
-    size_t index;
+    FilterKey_t key = { pTopicFilter, topicFilterLength };
+    int32_t position = NO_INDEX;
+    int32_t record = NO_INDEX;
+    int32_t node = NO_INDEX;
     SubscriptionManagerRecord_t * pRecord = NULL;
 
-    /* Iterate through the records list to find the matching record. */
-    for( index = 0; index < MAX_SUBSCRIPTION_CALLBACK_RECORDS; index++ )
+    if( isInitialized == false )
     {
-        pRecord = &callbackRecordList[ index ];
+        initializeRegistry();
+    }
 
-        /* Only match the non-empty records. */
-        if( pRecord->pTopicFilter != NULL )
+    position = findInIndex( &filterIndex,
+                            hashString( FNV_OFFSET_BASIS, pTopicFilter, topicFilterLength ),
+                            matchFilter,
+                            &key );
+
+    if( position != NO_INDEX )
+    {
+        record = filterIndexValues[ position ];
+        pRecord = &callbackRecordList[ record ];
+        removeFromIndex( &filterIndex, position );
+
+        /* Free the levels only used by this topic filter. */
+        trieNodes[ pRecord->leafNode ].record = NO_INDEX;
+        node = pruneNodes( pRecord->leafNode );
+
+        /* The remaining levels of the path may refer to the topic filter
+         * being removed. Refer them to another topic filter passing through
+         * them instead, visiting children before their parents. */
+        while( node != NO_INDEX )
         {
-            if( ( topicFilterLength == pRecord->topicFilterLength ) &&
-                ( strncmp( pTopicFilter, pRecord->pTopicFilter, topicFilterLength ) == 0 ) )
+            if( trieNodes[ node ].ownerRecord == record )
             {
-                break;
+                trieNodes[ node ].ownerRecord = ( trieNodes[ node ].record != NO_INDEX ) ?
+                                                trieNodes[ node ].record :
+                                                trieNodes[ trieNodes[ node ].firstChild ].ownerRecord;
             }
+
+            node = trieNodes[ node ].parent;
         }
-    }
 
-    /* Delete the record by clearing the found entry in the records list. */
-    if( index < MAX_SUBSCRIPTION_CALLBACK_RECORDS )
-    {
+        /* Delete the record by returning it to the free list. */
         pRecord->pTopicFilter = NULL;
         pRecord->topicFilterLength = 0u;
         pRecord->callback = NULL;
+        pRecord->leafNode = NO_INDEX;
+        pRecord->nextFreeRecord = freeRecord;
+        freeRecord = record;
 
         LogDebug( ( "Deleted callback record for topic filter: TopicFilter=%.*s",
                     topicFilterLength,
@@ -0,0 +1,211 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ota_event_buffer_pool.c
+ * @brief Implementation of a fixed-capacity pool of OTA event buffers, with
+ * the free buffers kept in a lock-free stack.
+ */
+
+/* Standard includes. */
+#include <stddef.h>
+#include <stdbool.h>
+#include <assert.h>
+
+/* Include header for the event buffer pool. */
+#include "ota_event_buffer_pool.h"
+
+/**
+ * @brief Index marking the end of the free list.
+ */
+#define FREE_LIST_END    UINT32_MAX
+
+/**
+ * @brief Index of the first free buffer of a free list head.
+ */
+#define HEAD_INDEX( head )    ( ( uint32_t ) ( ( head ) & 0xFFFFFFFFU ) )
+
+/**
+ * @brief A free list head with the given first free buffer, one change after
+ * @p head.
+ */
+#define NEXT_HEAD( head, index ) \
+    ( ( ( ( ( head ) >> 32 ) + 1U ) << 32 ) | ( uint64_t ) ( index ) )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Raise the high-water mark of a pool to a number of taken buffers.
+ *
+ * @param[in] pPool The pool.
+ * @param[in] inUseCount The number of taken buffers.
+ */
+static void raiseHighWaterMark( OtaEventBufferPool_t * pPool,
+                                uint32_t inUseCount );
+
+/*-----------------------------------------------------------*/
+
+static void raiseHighWaterMark( OtaEventBufferPool_t * pPool,
+                                uint32_t inUseCount )
+{
+    uint32_t highWaterMark = __atomic_load_n( &pPool->highWaterMark, __ATOMIC_RELAXED );
+
+    /* A failed exchange reloads highWaterMark, so the loop ends as soon as
+     * another thread has raised the mark at least as high. */
+    while( ( inUseCount > highWaterMark ) &&
+           ( __atomic_compare_exchange_n( &pPool->highWaterMark,
+                                          &highWaterMark,
+                                          inUseCount,
+                                          true,
+                                          __ATOMIC_RELAXED,
+                                          __ATOMIC_RELAXED ) == false ) )
+    {
+        /* Empty body. */
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void OtaEventBufferPool_Init( OtaEventBufferPool_t * pPool,
+                              OtaEventData_t * pBuffers,
+                              uint32_t * pNextFree,
+                              uint32_t capacity )
+{
+    uint32_t index = 0U;
+
+    assert( pPool != NULL );
+    assert( ( pBuffers != NULL ) || ( capacity == 0U ) );
+    assert( ( pNextFree != NULL ) || ( capacity == 0U ) );
+    assert( capacity < FREE_LIST_END );
+
+    pPool->pBuffers = pBuffers;
+    pPool->pNextFree = pNextFree;
+    pPool->capacity = capacity;
+    pPool->inUseCount = 0U;
+    pPool->highWaterMark = 0U;
+    pPool->exhaustedCount = 0U;
+
+    /* Chain the buffers in order, so the first buffer is taken first. */
+    for( index = 0U; index < capacity; index++ )
+    {
+        pBuffers[ index ].bufferUsed = false;
+        pNextFree[ index ] = ( ( index + 1U ) < capacity ) ? ( index + 1U ) : FREE_LIST_END;
+    }
+
+    pPool->freeListHead = ( capacity > 0U ) ? 0U : FREE_LIST_END;
+}
+
+/*-----------------------------------------------------------*/
+
+OtaEventData_t * OtaEventBufferPool_Get( OtaEventBufferPool_t * pPool )
+{
+    OtaEventData_t * pBuffer = NULL;
+    uint64_t head = 0U;
+    uint32_t index = FREE_LIST_END;
+    uint32_t nextIndex = FREE_LIST_END;
+    bool isTaken = false;
+
+    assert( pPool != NULL );
+
+    head = __atomic_load_n( &pPool->freeListHead, __ATOMIC_ACQUIRE );
+
+    while( isTaken == false )
+    {
+        index = HEAD_INDEX( head );
+
+        if( index == FREE_LIST_END )
+        {
+            break;
+        }
+
+        /* The buffer may be taken by another thread before the exchange
+         * below, in which case nextIndex is stale and the exchange fails as
+         * the head has changed. */
+        nextIndex = __atomic_load_n( &pPool->pNextFree[ index ], __ATOMIC_RELAXED );
+
+        isTaken = __atomic_compare_exchange_n( &pPool->freeListHead,
+                                               &head,
+                                               NEXT_HEAD( head, nextIndex ),
+                                               true,
+                                               __ATOMIC_ACQ_REL,
+                                               __ATOMIC_ACQUIRE );
+    }
+
+    if( isTaken == true )
+    {
+        pBuffer = &pPool->pBuffers[ index ];
+        pBuffer->bufferUsed = true;
+        raiseHighWaterMark( pPool, __atomic_add_fetch( &pPool->inUseCount, 1U, __ATOMIC_RELAXED ) );
+    }
+    else
+    {
+        ( void ) __atomic_add_fetch( &pPool->exhaustedCount, 1U, __ATOMIC_RELAXED );
+    }
+
+    return pBuffer;
+}
+
+/*-----------------------------------------------------------*/
+
+void OtaEventBufferPool_Put( OtaEventBufferPool_t * pPool,
+                             OtaEventData_t * pBuffer )
+{
+    uint64_t head = 0U;
+    uint32_t index = 0U;
+
+    assert( pPool != NULL );
+    assert( pBuffer != NULL );
+    assert( ( pBuffer >= pPool->pBuffers ) && ( pBuffer < &pPool->pBuffers[ pPool->capacity ] ) );
+    assert( pBuffer->bufferUsed == true );
+
+    index = ( uint32_t ) ( pBuffer - pPool->pBuffers );
+    pBuffer->bufferUsed = false;
+
+    ( void ) __atomic_sub_fetch( &pPool->inUseCount, 1U, __ATOMIC_RELAXED );
+
+    head = __atomic_load_n( &pPool->freeListHead, __ATOMIC_RELAXED );
+
+    /* The release exchange publishes the buffer contents and its link to
+     * the thread that takes it next. */
+    do
+    {
+        __atomic_store_n( &pPool->pNextFree[ index ], HEAD_INDEX( head ), __ATOMIC_RELAXED );
+    } while( __atomic_compare_exchange_n( &pPool->freeListHead,
+                                          &head,
+                                          NEXT_HEAD( head, index ),
+                                          true,
+                                          __ATOMIC_RELEASE,
+                                          __ATOMIC_RELAXED ) == false );
+}
+
+/*-----------------------------------------------------------*/
+
+void OtaEventBufferPool_GetStats( OtaEventBufferPool_t * pPool,
+                                  OtaEventBufferPoolStats_t * pStats )
+{
+    assert( pPool != NULL );
+    assert( pStats != NULL );
+
+    pStats->inUseCount = __atomic_load_n( &pPool->inUseCount, __ATOMIC_RELAXED );
+    pStats->highWaterMark = __atomic_load_n( &pPool->highWaterMark, __ATOMIC_RELAXED );
+    pStats->exhaustedCount = __atomic_load_n( &pPool->exhaustedCount, __ATOMIC_RELAXED );
+}
@@ -42,12 +42,17 @@
 
 /* pthread include. */
 #include <pthread.h>
-#include <semaphore.h>
 
 /* MQTT include. */
 #include "core_mqtt.h"
 #include "mqtt_subscription_manager.h"
 
+/* OTA event buffer pool include. */
+#include "ota_event_buffer_pool.h"
+
+/* MQTT command agent include. */
+#include "mqtt_command_agent.h"
+
 /* HTTP include. */
 #include "core_http_client.h"
 
@@ -132,9 +137,10 @@
 #define MQTT_PUBLISH_RETRY_MAX_ATTEMPS           ( 3U )
 
 /**
- * @brief Period for demo loop sleep in milliseconds.
+ * @brief Longest time in milliseconds the demo loop waits for incoming MQTT
+ * data or a queued MQTT command.
  */
-#define OTA_EXAMPLE_LOOP_SLEEP_PERIOD_MS         ( 5U )
+#define OTA_EXAMPLE_LOOP_WAIT_PERIOD_MS          ( 100U )
 
 /**
  * @brief The delay used in the main OTA Demo task loop to periodically output the OTA
@@ -148,11 +154,6 @@
  */
 #define OTA_SUSPEND_TIMEOUT_MS                   ( 5000U )
 
-/**
- * @brief Period for waiting on ack.
- */
-#define MQTT_ACK_TIMEOUT_MS                      ( 5000U )
-
 /**
  * @brief The timeout for waiting before exiting the OTA demo.
  */
@@ -339,17 +340,18 @@ static bool mqttSessionEstablished = false;
 /**
  * @brief Structure for openssl parameters for TLS session used by MQTT connection.
  */
-static OpensslParams_t opensslParamsForMqtt;
+static OpensslParams_t opensslParamsForMqtt = { 0 };
 
 /**
  * @brief Structure for openssl parameters for TLS session used by HTTP connection.
  */
-static OpensslParams_t opensslParamsForHttp;
+static OpensslParams_t opensslParamsForHttp = { 0 };
 
 /**
- * @brief Mutex for synchronizing coreMQTT API calls.
+ * @brief Agent running the MQTT operations of the OTA agent thread on the
+ * thread that runs the MQTT process loop, which owns #mqttContext.
  */
-static pthread_mutex_t mqttMutex;
+static MqttCommandAgent_t commandAgent;
 
 /**
  * @brief The host address string extracted from the pre-signed URL.
@@ -364,16 +366,6 @@ static char serverHost[ 256 ];
  */
 static size_t serverHostLength;
 
-/**
- * @brief Semaphore for synchronizing buffer operations.
- */
-static sem_t bufferSemaphore;
-
-/**
- * @brief Semaphore for synchronizing wait for ack.
- */
-static sem_t ackSemaphore;
-
 /**
  * @brief Enum for type of OTA job messages received.
  */
@@ -434,6 +426,17 @@ uint8_t authScheme[ OTA_MAX_URL_SIZE ];
  */
 static OtaEventData_t eventBuffer[ otaconfigMAX_NUM_OTA_DATA_BUFFERS ];
 
+/**
+ * @brief Free list storage of the event buffer pool.
+ */
+static uint32_t eventBufferNextFree[ otaconfigMAX_NUM_OTA_DATA_BUFFERS ];
+
+/**
+ * @brief Pool of the event buffers, shared by the MQTT receive thread and the
+ * OTA agent thread without a lock.
+ */
+static OtaEventBufferPool_t eventBufferPool;
+
 /**
  * @brief The buffer passed to the OTA Agent from application while initializing.
  */
@@ -709,48 +712,14 @@ static SubscriptionManagerCallback_t otaMessageCallback[] = { mqttJobCallback, m
 
 void otaEventBufferFree( OtaEventData_t * const pxBuffer )
 {
-    if( sem_wait( &bufferSemaphore ) == 0 )
-    {
-        pxBuffer->bufferUsed = false;
-        ( void ) sem_post( &bufferSemaphore );
-    }
-    else
-    {
-        LogError( ( "Failed to get buffer semaphore: "
-                    ",errno=%s",
-                    strerror( errno ) ) );
-    }
+    OtaEventBufferPool_Put( &eventBufferPool, pxBuffer );
 }
 
 /*-----------------------------------------------------------*/
 
 OtaEventData_t * otaEventBufferGet( void )
 {
-    uint32_t ulIndex = 0;
-    OtaEventData_t * pFreeBuffer = NULL;
-
-    if( sem_wait( &bufferSemaphore ) == 0 )
-    {
-        for( ulIndex = 0; ulIndex < otaconfigMAX_NUM_OTA_DATA_BUFFERS; ulIndex++ )
-        {
-            if( eventBuffer[ ulIndex ].bufferUsed == false )
-            {
-                eventBuffer[ ulIndex ].bufferUsed = true;
-                pFreeBuffer = &eventBuffer[ ulIndex ];
-                break;
-            }
-        }
-
-        ( void ) sem_post( &bufferSemaphore );
-    }
-    else
-    {
-        LogError( ( "Failed to get buffer semaphore: "
-                    ",errno=%s",
-                    strerror( errno ) ) );
-    }
-
-    return pFreeBuffer;
+    return OtaEventBufferPool_Get( &eventBufferPool );
 }
 
 /*-----------------------------------------------------------*/
@@ -975,10 +944,18 @@ static void mqttEventCallback( MQTTContext_t * pMqttContext,
         {
             case MQTT_PACKET_TYPE_SUBACK:
                 LogInfo( ( "Received SUBACK.\n\n" ) );
+                ( void ) MqttCommandAgent_ProcessAck( &commandAgent,
+                                                      pPacketInfo->type,
+                                                      pDeserializedInfo->packetIdentifier,
+                                                      pDeserializedInfo->deserializationResult );
                 break;
 
             case MQTT_PACKET_TYPE_UNSUBACK:
                 LogInfo( ( "Received UNSUBACK.\n\n" ) );
+                ( void ) MqttCommandAgent_ProcessAck( &commandAgent,
+                                                      pPacketInfo->type,
+                                                      pDeserializedInfo->packetIdentifier,
+                                                      pDeserializedInfo->deserializationResult );
                 break;
 
             case MQTT_PACKET_TYPE_PINGRESP:
@@ -992,7 +969,10 @@ static void mqttEventCallback( MQTTContext_t * pMqttContext,
             case MQTT_PACKET_TYPE_PUBACK:
                 LogInfo( ( "PUBACK received for packet id %u.\n\n",
                            pDeserializedInfo->packetIdentifier ) );
-                sem_post( &ackSemaphore );
+                ( void ) MqttCommandAgent_ProcessAck( &commandAgent,
+                                                      pPacketInfo->type,
+                                                      pDeserializedInfo->packetIdentifier,
+                                                      pDeserializedInfo->deserializationResult );
                 break;
 
             /* Any other packet type is invalid. */
@@ -1029,7 +1009,7 @@ static int initializeMqtt( MQTTContext_t * pMqttContext,
     transport.pNetworkContext = pNetworkContext;
     transport.send = Openssl_Send;
     transport.recv = Openssl_Recv;
-    transport.writev = NULL;
+    transport.writev = Openssl_Writev;
 
     /* Fill the values for network buffer. */
     networkBuffer.pBuffer = otaNetworkBuffer;
@@ -1232,19 +1212,8 @@ static int establishMqttSession( MQTTContext_t * pMqttContext )
         connectInfo.passwordLength = 0U;
     #endif /* ifdef CLIENT_USERNAME */
 
-    if( pthread_mutex_lock( &mqttMutex ) == 0 )
-    {
-        /* Send MQTT CONNECT packet to broker. */
-        mqttStatus = MQTT_Connect( pMqttContext, &connectInfo, NULL, CONNACK_RECV_TIMEOUT_MS, &sessionPresent );
-
-        pthread_mutex_unlock( &mqttMutex );
-    }
-    else
-    {
-        LogError( ( "Failed to acquire mutex for executing MQTT_Connect"
-                    ",errno=%s",
-                    strerror( errno ) ) );
-    }
+    /* Send MQTT CONNECT packet to broker. */
+    mqttStatus = MQTT_Connect( pMqttContext, &connectInfo, NULL, CONNACK_RECV_TIMEOUT_MS, &sessionPresent );
 
     if( mqttStatus != MQTTSuccess )
     {
@@ -1322,22 +1291,15 @@ static void disconnect( void )
 
     if( mqttSessionEstablished == true )
     {
-        if( pthread_mutex_lock( &mqttMutex ) == 0 )
-        {
-            /* Disconnect MQTT session. */
-            MQTT_Disconnect( &mqttContext );
+        /* Disconnect MQTT session. */
+        MQTT_Disconnect( &mqttContext );
 
-            /* Clear the mqtt session flag. */
-            mqttSessionEstablished = false;
+        /* Clear the mqtt session flag. */
+        mqttSessionEstablished = false;
 
-            pthread_mutex_unlock( &mqttMutex );
-        }
-        else
-        {
-            LogError( ( "Failed to acquire mutex to execute MQTT_Disconnect"
-                        ",errno=%s",
-                        strerror( errno ) ) );
-        }
+        /* Fail the MQTT operations waiting for the connection, so that the
+         * OTA agent thread can be suspended. */
+        MqttCommandAgent_CancelCommands( &commandAgent, MQTTSendFailed );
     }
     else
     {
@@ -1724,10 +1686,8 @@ static OtaMqttStatus_t mqttSubscribe( const char * pTopicFilter,
     OtaMqttStatus_t otaRet = OtaMqttSuccess;
 
     MQTTStatus_t mqttStatus = MQTTBadParameter;
-    MQTTContext_t * pMqttContext = &mqttContext;
     MQTTSubscribeInfo_t pSubscriptionList[ 1 ];
 
-    assert( pMqttContext != NULL );
     assert( pTopicFilter != NULL );
     assert( topicFilterLength > 0 );
 
@@ -1740,27 +1700,13 @@ static OtaMqttStatus_t mqttSubscribe( const char * pTopicFilter,
     pSubscriptionList[ 0 ].pTopicFilter = pTopicFilter;
     pSubscriptionList[ 0 ].topicFilterLength = topicFilterLength;
 
-    if( pthread_mutex_lock( &mqttMutex ) == 0 )
-    {
-        /* Send SUBSCRIBE packet. */
-        mqttStatus = MQTT_Subscribe( pMqttContext,
-                                     pSubscriptionList,
-                                     sizeof( pSubscriptionList ) / sizeof( MQTTSubscribeInfo_t ),
-                                     MQTT_GetPacketId( pMqttContext ) );
-
-        pthread_mutex_unlock( &mqttMutex );
-    }
-    else
-    {
-        LogError( ( "Failed to acquire mqtt mutex for executing MQTT_Subscribe"
-                    ",errno=%s",
-                    strerror( errno ) ) );
-    }
+    /* Send SUBSCRIBE packet from the MQTT thread and wait for the SUBACK. */
+    mqttStatus = MqttCommandAgent_Subscribe( &commandAgent, &pSubscriptionList[ 0 ] );
 
     if( mqttStatus != MQTTSuccess )
     {
-        LogError( ( "Failed to send SUBSCRIBE packet to broker with error = %u.",
-                    mqttStatus ) );
+        LogError( ( "Failed to subscribe with error = %s.",
+                    MQTT_Status_strerror( mqttStatus ) ) );
 
         otaRet = OtaMqttSubscribeFailed;
     }
@@ -1786,9 +1732,6 @@ static OtaMqttStatus_t mqttPublish( const char * const pTopic,
 
     MQTTStatus_t mqttStatus = MQTTBadParameter;
     MQTTPublishInfo_t publishInfo = { 0 };
-    MQTTContext_t * pMqttContext = &mqttContext;
-    struct timespec ts = { 0 };
-    int ret;
 
     /* Set the required publish parameters. */
     publishInfo.pTopicName = pTopic;
@@ -1797,51 +1740,18 @@ static OtaMqttStatus_t mqttPublish( const char * const pTopic,
     publishInfo.pPayload = pMsg;
     publishInfo.payloadLength = msgSize;
 
-    if( pthread_mutex_lock( &mqttMutex ) == 0 )
-    {
-        mqttStatus = MQTT_Publish( pMqttContext,
-                                   &publishInfo,
-                                   MQTT_GetPacketId( pMqttContext ) );
-
-        if( mqttStatus != MQTTSuccess )
-        {
-            LogError( ( "Failed to send PUBLISH packet to broker with error = %u.", mqttStatus ) );
+    /* Send PUBLISH packet from the MQTT thread, and for QoS 1 wait for the
+     * PUBACK with its packet identifier. */
+    mqttStatus = MqttCommandAgent_Publish( &commandAgent, &publishInfo );
 
-            otaRet = OtaMqttPublishFailed;
-        }
-
-        pthread_mutex_unlock( &mqttMutex );
-    }
-    else
+    if( mqttStatus != MQTTSuccess )
     {
-        LogError( ( "Failed to acquire mqtt mutex for executing MQTT_Publish"
-                    ",errno=%s",
-                    strerror( errno ) ) );
+        LogError( ( "Failed to publish with error = %s.",
+                    MQTT_Status_strerror( mqttStatus ) ) );
 
         otaRet = OtaMqttPublishFailed;
     }
 
-    if( ( mqttStatus == MQTTSuccess ) && ( qos == 1 ) )
-    {
-        /* Calculate relative interval as current time plus number of seconds. */
-        clock_gettime( CLOCK_REALTIME, &ts );
-        ts.tv_sec += MQTT_ACK_TIMEOUT_MS;
-
-        while( ( ret = sem_timedwait( &ackSemaphore, &ts ) ) == -1 && errno == EINTR )
-        {
-            continue;
-        }
-
-        if( ret == -1 )
-        {
-            LogError( ( "Failed to receive ack for publish."
-                        ",errno=%s",
-                        strerror( errno ) ) );
-
-            otaRet = OtaMqttPublishFailed;
-        }
-    }
-
     return otaRet;
 }
 
@@ -1855,7 +1765,6 @@ static OtaMqttStatus_t mqttUnsubscribe( const char * pTopicFilter,
     MQTTStatus_t mqttStatus = MQTTBadParameter;
 
     MQTTSubscribeInfo_t pSubscriptionList[ 1 ];
-    MQTTContext_t * pMqttContext = &mqttContext;
 
     ( void ) qos;
 
@@ -1867,27 +1776,13 @@ static OtaMqttStatus_t mqttUnsubscribe( const char * pTopicFilter,
     pSubscriptionList[ 0 ].pTopicFilter = pTopicFilter;
     pSubscriptionList[ 0 ].topicFilterLength = topicFilterLength;
 
-    if( pthread_mutex_lock( &mqttMutex ) == 0 )
-    {
-        /* Send UNSUBSCRIBE packet. */
-        mqttStatus = MQTT_Unsubscribe( pMqttContext,
-                                       pSubscriptionList,
-                                       sizeof( pSubscriptionList ) / sizeof( MQTTSubscribeInfo_t ),
-                                       MQTT_GetPacketId( pMqttContext ) );
-
-        pthread_mutex_unlock( &mqttMutex );
-    }
-    else
-    {
-        LogError( ( "Failed to acquire mutex for executing MQTT_Unsubscribe"
-                    ",errno=%s",
-                    strerror( errno ) ) );
-    }
+    /* Send UNSUBSCRIBE packet from the MQTT thread and wait for the UNSUBACK. */
+    mqttStatus = MqttCommandAgent_Unsubscribe( &commandAgent, &pSubscriptionList[ 0 ] );
 
     if( mqttStatus != MQTTSuccess )
     {
-        LogError( ( "Failed to send UNSUBSCRIBE packet to broker with error = %u.",
-                    mqttStatus ) );
+        LogError( ( "Failed to unsubscribe with error = %s.",
+                    MQTT_Status_strerror( mqttStatus ) ) );
 
         otaRet = OtaMqttUnsubscribeFailed;
     }
@@ -2041,24 +1936,20 @@ static int startOTADemo( void )
                         OTA_SignalEvent( &eventMsg );
                     }
                 }
+                else
+                {
+                    /* Fail the MQTT operations queued while connecting. */
+                    MqttCommandAgent_CancelCommands( &commandAgent, MQTTSendFailed );
+                }
             }
 
             if( mqttSessionEstablished == true )
             {
-                /* Acquire the mqtt mutex lock. */
-                if( pthread_mutex_lock( &mqttMutex ) == 0 )
-                {
-                    /* Loop to receive packet from transport interface. */
-                    mqttStatus = MQTT_ProcessLoop( &mqttContext );
+                /* Send the MQTT operations queued by the OTA agent thread. */
+                MqttCommandAgent_ProcessCommands( &commandAgent );
 
-                    pthread_mutex_unlock( &mqttMutex );
-                }
-                else
-                {
-                    LogError( ( "Failed to acquire mutex to execute process loop"
-                                ",errno=%s",
-                                strerror( errno ) ) );
-                }
+                /* Loop to receive packet from transport interface. */
+                mqttStatus = MQTT_ProcessLoop( &mqttContext );
 
                 if( ( mqttStatus == MQTTSuccess ) || ( mqttStatus == MQTTNeedMoreBytes ) )
                 {
@@ -2071,7 +1962,14 @@ static int startOTADemo( void )
                                otaStatistics.otaPacketsProcessed,
                                otaStatistics.otaPacketsDropped ) );
 
-                    Clock_SleepMs( OTA_EXAMPLE_LOOP_SLEEP_PERIOD_MS );
+                    /* Wait for the next packet or command. Data already decrypted
+                     * by OpenSSL does not make the socket readable. */
+                    if( SSL_pending( opensslParamsForMqtt.pSsl ) == 0 )
+                    {
+                        MqttCommandAgent_Wait( &commandAgent,
+                                               opensslParamsForMqtt.socketDescriptor,
+                                               OTA_EXAMPLE_LOOP_WAIT_PERIOD_MS );
+                    }
                 }
                 else
                 {
@@ -2098,6 +1996,10 @@ static int startOTADemo( void )
 
                         while( ( ( state = OTA_GetState() ) != OtaAgentStateSuspended ) && ( suspendTimeout > 0 ) )
                         {
+                            /* Fail the MQTT operations the OTA agent thread
+                             * queued before seeing the suspend event. */
+                            MqttCommandAgent_CancelCommands( &commandAgent, MQTTSendFailed );
+
                             /* Wait for OTA Library state to suspend */
                             Clock_SleepMs( OTA_EXAMPLE_TASK_DELAY_MS );
                             suspendTimeout -= OTA_EXAMPLE_TASK_DELAY_MS;
@@ -2148,10 +2050,11 @@ int main( int argc,
     /* Return error status. */
     int returnStatus = EXIT_SUCCESS;
 
-    /* Semaphore initialization flag. */
-    bool bufferSemInitialized = false;
-    bool ackSemInitialized = false;
-    bool mqttMutexInitialized = false;
+    /* Event buffer pool usage. */
+    OtaEventBufferPoolStats_t bufferPoolStats = { 0 };
+
+    /* Command agent initialization flag. */
+    bool commandAgentInitialized = false;
 
     /* Maximum time in milliseconds to wait before exiting demo . */
     int16_t waitTimeoutMs = OTA_DEMO_EXIT_TIMEOUT_MS;
@@ -2161,46 +2064,20 @@ int main( int argc,
                appFirmwareVersion.u.x.minor,
                appFirmwareVersion.u.x.build ) );
 
-    /* Initialize semaphore for buffer operations. */
-    if( sem_init( &bufferSemaphore, 0, 1 ) != 0 )
-    {
-        LogError( ( "Failed to initialize buffer semaphore"
-                    ",errno=%s",
-                    strerror( errno ) ) );
-
-        returnStatus = EXIT_FAILURE;
-    }
-    else
-    {
-        bufferSemInitialized = true;
-    }
-
-    /* Initialize semaphore for ack. */
-    if( sem_init( &ackSemaphore, 0, 0 ) != 0 )
-    {
-        LogError( ( "Failed to initialize ack semaphore"
-                    ",errno=%s",
-                    strerror( errno ) ) );
+    /* Initialize the pool of event buffers. */
+    OtaEventBufferPool_Init( &eventBufferPool,
+                             eventBuffer,
+                             eventBufferNextFree,
+                             otaconfigMAX_NUM_OTA_DATA_BUFFERS );
 
-        returnStatus = EXIT_FAILURE;
-    }
-    else
+    /* Initialize the agent running the MQTT operations of the OTA agent. */
+    if( MqttCommandAgent_Init( &commandAgent, &mqttContext ) == false )
     {
-        ackSemInitialized = true;
-    }
-
-    /* Initialize mutex for coreMQTT APIs. */
-    if( pthread_mutex_init( &mqttMutex, NULL ) != 0 )
-    {
-        LogError( ( "Failed to initialize mutex for mqtt apis"
-                    ",errno=%s",
-                    strerror( errno ) ) );
-
         returnStatus = EXIT_FAILURE;
     }
     else
     {
-        mqttMutexInitialized = true;
+        commandAgentInitialized = true;
     }
 
     if( returnStatus == EXIT_SUCCESS )
@@ -2222,43 +2099,16 @@ int main( int argc,
     /* Disconnect from S3 and close connection. */
     Openssl_Disconnect( &networkContextHttp );
 
-    if( bufferSemInitialized == true )
-    {
-        /* Cleanup semaphore created for buffer operations. */
-        if( sem_destroy( &bufferSemaphore ) != 0 )
-        {
-            LogError( ( "Failed to destroy buffer semaphore"
-                        ",errno=%s",
-                        strerror( errno ) ) );
-
-            returnStatus = EXIT_FAILURE;
-        }
-    }
-
-    if( ackSemInitialized == true )
-    {
-        /* Cleanup semaphore created for ack. */
-        if( sem_destroy( &ackSemaphore ) != 0 )
-        {
-            LogError( ( "Failed to destroy ack semaphore"
-                        ",errno=%s",
-                        strerror( errno ) ) );
+    OtaEventBufferPool_GetStats( &eventBufferPool, &bufferPoolStats );
+    LogInfo( ( "OTA event buffers: High water mark=%u of %u, "
+               "Times none was free=%u",
+               ( unsigned int ) bufferPoolStats.highWaterMark,
+               ( unsigned int ) otaconfigMAX_NUM_OTA_DATA_BUFFERS,
+               ( unsigned int ) bufferPoolStats.exhaustedCount ) );
 
-            returnStatus = EXIT_FAILURE;
-        }
-    }
-
-    if( mqttMutexInitialized == true )
+    if( commandAgentInitialized == true )
     {
-        /* Cleanup mutex created for buffer operations. */
-        if( pthread_mutex_destroy( &mqttMutex ) != 0 )
-        {
-            LogError( ( "Failed to destroy mutex for mqtt apis"
-                        ",errno=%s",
-                        strerror( errno ) ) );
-
-            returnStatus = EXIT_FAILURE;
-        }
+        MqttCommandAgent_Deinit( &commandAgent );
     }
 
     /* Wait and log message before exiting demo. */
@@ -42,12 +42,17 @@
 
 /* pthread include. */
 #include <pthread.h>
-#include <semaphore.h>
 
 /* MQTT include. */
 #include "core_mqtt.h"
 #include "mqtt_subscription_manager.h"
 
+/* OTA event buffer pool include. */
+#include "ota_event_buffer_pool.h"
+
+/* MQTT command agent include. */
+#include "mqtt_command_agent.h"
+
 /*Include backoff algorithm header for retry logic.*/
 #include "backoff_algorithm.h"
 
@@ -118,14 +123,10 @@
 #define MQTT_KEEP_ALIVE_INTERVAL_SECONDS    ( 60U )
 
 /**
- * @brief Period for waiting on ack.
- */
-#define MQTT_ACK_TIMEOUT_MS                 ( 5000U )
-
-/**
- * @brief Period for demo loop sleep in milliseconds.
+ * @brief Longest time in milliseconds the demo loop waits for incoming MQTT
+ * data or a queued MQTT command.
  */
-#define OTA_EXAMPLE_LOOP_SLEEP_PERIOD_MS    ( 5U )
+#define OTA_EXAMPLE_LOOP_WAIT_PERIOD_MS     ( 100U )
 
 /**
  * @brief Size of the network buffer to receive the MQTT message.
@@ -272,22 +273,13 @@ static bool mqttSessionEstablished = false;
 /**
  * @brief Structure for openssl parameters.
  */
-static OpensslParams_t opensslParams;
-
-/**
- * @brief Mutex for synchronizing coreMQTT API calls.
- */
-static pthread_mutex_t mqttMutex;
-
-/**
- * @brief Semaphore for synchronizing buffer operations.
- */
-static sem_t bufferSemaphore;
+static OpensslParams_t opensslParams = { 0 };
 
 /**
- * @brief Semaphore for synchronizing wait for ack.
+ * @brief Agent running the MQTT operations of the OTA agent thread on the
+ * thread that runs the MQTT process loop, which owns #mqttContext.
  */
-static sem_t ackSemaphore;
+static MqttCommandAgent_t commandAgent;
 
 /**
  * @brief Enum for type of OTA job messages received.
@@ -334,6 +326,17 @@ uint8_t bitmap[ OTA_MAX_BLOCK_BITMAP_SIZE ];
  */
 static OtaEventData_t eventBuffer[ otaconfigMAX_NUM_OTA_DATA_BUFFERS ];
 
+/**
+ * @brief Free list storage of the event buffer pool.
+ */
+static uint32_t eventBufferNextFree[ otaconfigMAX_NUM_OTA_DATA_BUFFERS ];
+
+/**
+ * @brief Pool of the event buffers, shared by the MQTT receive thread and the
+ * OTA agent thread without a lock.
+ */
+static OtaEventBufferPool_t eventBufferPool;
+
 /**
  * @brief The buffer passed to the OTA Agent from application while initializing.
  */
@@ -576,48 +579,14 @@ static SubscriptionManagerCallback_t otaMessageCallback[] = { mqttJobCallback, m
 
 void otaEventBufferFree( OtaEventData_t * const pxBuffer )
 {
-    if( sem_wait( &bufferSemaphore ) == 0 )
-    {
-        pxBuffer->bufferUsed = false;
-        ( void ) sem_post( &bufferSemaphore );
-    }
-    else
-    {
-        LogError( ( "Failed to get buffer semaphore: "
-                    ",errno=%s",
-                    strerror( errno ) ) );
-    }
+    OtaEventBufferPool_Put( &eventBufferPool, pxBuffer );
 }
 
 /*-----------------------------------------------------------*/
 
 OtaEventData_t * otaEventBufferGet( void )
 {
-    uint32_t ulIndex = 0;
-    OtaEventData_t * pFreeBuffer = NULL;
-
-    if( sem_wait( &bufferSemaphore ) == 0 )
-    {
-        for( ulIndex = 0; ulIndex < otaconfigMAX_NUM_OTA_DATA_BUFFERS; ulIndex++ )
-        {
-            if( eventBuffer[ ulIndex ].bufferUsed == false )
-            {
-                eventBuffer[ ulIndex ].bufferUsed = true;
-                pFreeBuffer = &eventBuffer[ ulIndex ];
-                break;
-            }
-        }
-
-        ( void ) sem_post( &bufferSemaphore );
-    }
-    else
-    {
-        LogError( ( "Failed to get buffer semaphore: "
-                    ",errno=%s",
-                    strerror( errno ) ) );
-    }
-
-    return pFreeBuffer;
+    return OtaEventBufferPool_Get( &eventBufferPool );
 }
 
 /*-----------------------------------------------------------*/
@@ -841,10 +810,18 @@ static void mqttEventCallback( MQTTContext_t * pMqttContext,
         {
             case MQTT_PACKET_TYPE_SUBACK:
                 LogInfo( ( "Received SUBACK.\n\n" ) );
+                ( void ) MqttCommandAgent_ProcessAck( &commandAgent,
+                                                      pPacketInfo->type,
+                                                      pDeserializedInfo->packetIdentifier,
+                                                      pDeserializedInfo->deserializationResult );
                 break;
 
             case MQTT_PACKET_TYPE_UNSUBACK:
                 LogInfo( ( "Received UNSUBACK.\n\n" ) );
+                ( void ) MqttCommandAgent_ProcessAck( &commandAgent,
+                                                      pPacketInfo->type,
+                                                      pDeserializedInfo->packetIdentifier,
+                                                      pDeserializedInfo->deserializationResult );
                 break;
 
             case MQTT_PACKET_TYPE_PINGRESP:
@@ -858,7 +835,10 @@ static void mqttEventCallback( MQTTContext_t * pMqttContext,
             case MQTT_PACKET_TYPE_PUBACK:
                 LogInfo( ( "PUBACK received for packet id %u.\n\n",
                            pDeserializedInfo->packetIdentifier ) );
-                sem_post( &ackSemaphore );
+                ( void ) MqttCommandAgent_ProcessAck( &commandAgent,
+                                                      pPacketInfo->type,
+                                                      pDeserializedInfo->packetIdentifier,
+                                                      pDeserializedInfo->deserializationResult );
                 break;
 
             /* Any other packet type is invalid. */
@@ -897,7 +877,7 @@ static int initializeMqtt( MQTTContext_t * pMqttContext,
     transport.pNetworkContext = pNetworkContext;
     transport.send = Openssl_Send;
     transport.recv = Openssl_Recv;
-    transport.writev = NULL;
+    transport.writev = Openssl_Writev;
 
     /* Fill the values for network buffer. */
     networkBuffer.pBuffer = otaNetworkBuffer;
@@ -968,6 +948,10 @@ static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext
      * https://docs.aws.amazon.com/iot/latest/developerguide/transport-security.html */
     opensslCredentials.sniHostName = AWS_IOT_ENDPOINT;
 
+    /* Resume the previous TLS session when reconnecting to the broker, so that
+     * retries after a dropped connection skip the full handshake. */
+    opensslCredentials.enableSessionResumption = 1U;
+
     if( AWS_MQTT_PORT == 443 )
     {
         /* Pass the ALPN protocol name depending on the port being used.
@@ -1100,19 +1084,8 @@ static int establishMqttSession( MQTTContext_t * pMqttContext )
         connectInfo.passwordLength = 0U;
     #endif /* ifdef CLIENT_USERNAME */
 
-    if( pthread_mutex_lock( &mqttMutex ) == 0 )
-    {
-        /* Send MQTT CONNECT packet to broker. */
-        mqttStatus = MQTT_Connect( pMqttContext, &connectInfo, NULL, CONNACK_RECV_TIMEOUT_MS, &sessionPresent );
-
-        pthread_mutex_unlock( &mqttMutex );
-    }
-    else
-    {
-        LogError( ( "Failed to acquire mutex for executing MQTT_Connect"
-                    ",errno=%s",
-                    strerror( errno ) ) );
-    }
+    /* Send MQTT CONNECT packet to broker. */
+    mqttStatus = MQTT_Connect( pMqttContext, &connectInfo, NULL, CONNACK_RECV_TIMEOUT_MS, &sessionPresent );
 
     if( mqttStatus != MQTTSuccess )
     {
@@ -1190,22 +1163,15 @@ static void disconnect( void )
 
     if( mqttSessionEstablished == true )
     {
-        if( pthread_mutex_lock( &mqttMutex ) == 0 )
-        {
-            /* Disconnect MQTT session. */
-            MQTT_Disconnect( &mqttContext );
+        /* Disconnect MQTT session. */
+        MQTT_Disconnect( &mqttContext );
 
-            /* Clear the mqtt session flag. */
-            mqttSessionEstablished = false;
+        /* Clear the mqtt session flag. */
+        mqttSessionEstablished = false;
 
-            pthread_mutex_unlock( &mqttMutex );
-        }
-        else
-        {
-            LogError( ( "Failed to acquire mutex to execute MQTT_Disconnect"
-                        ",errno=%s",
-                        strerror( errno ) ) );
-        }
+        /* Fail the MQTT operations waiting for the connection, so that the
+         * OTA agent thread can be suspended. */
+        MqttCommandAgent_CancelCommands( &commandAgent, MQTTSendFailed );
     }
     else
     {
@@ -1275,10 +1241,8 @@ static OtaMqttStatus_t mqttSubscribe( const char * pTopicFilter,
     OtaMqttStatus_t otaRet = OtaMqttSuccess;
 
     MQTTStatus_t mqttStatus = MQTTBadParameter;
-    MQTTContext_t * pMqttContext = &mqttContext;
     MQTTSubscribeInfo_t pSubscriptionList[ 1 ];
 
-    assert( pMqttContext != NULL );
     assert( pTopicFilter != NULL );
     assert( topicFilterLength > 0 );
 
@@ -1291,27 +1255,13 @@ static OtaMqttStatus_t mqttSubscribe( const char * pTopicFilter,
     pSubscriptionList[ 0 ].pTopicFilter = pTopicFilter;
     pSubscriptionList[ 0 ].topicFilterLength = topicFilterLength;
 
-    if( pthread_mutex_lock( &mqttMutex ) == 0 )
-    {
-        /* Send SUBSCRIBE packet. */
-        mqttStatus = MQTT_Subscribe( pMqttContext,
-                                     pSubscriptionList,
-                                     sizeof( pSubscriptionList ) / sizeof( MQTTSubscribeInfo_t ),
-                                     MQTT_GetPacketId( pMqttContext ) );
-
-        pthread_mutex_unlock( &mqttMutex );
-    }
-    else
-    {
-        LogError( ( "Failed to acquire mqtt mutex for executing MQTT_Subscribe"
-                    ",errno=%s",
-                    strerror( errno ) ) );
-    }
+    /* Send SUBSCRIBE packet from the MQTT thread and wait for the SUBACK. */
+    mqttStatus = MqttCommandAgent_Subscribe( &commandAgent, &pSubscriptionList[ 0 ] );
 
     if( mqttStatus != MQTTSuccess )
     {
-        LogError( ( "Failed to send SUBSCRIBE packet to broker with error = %u.",
-                    mqttStatus ) );
+        LogError( ( "Failed to subscribe with error = %s.",
+                    MQTT_Status_strerror( mqttStatus ) ) );
 
         otaRet = OtaMqttSubscribeFailed;
     }
@@ -1339,9 +1289,6 @@ static OtaMqttStatus_t mqttPublish( const char * const pacTopic,
 
     MQTTStatus_t mqttStatus = MQTTBadParameter;
     MQTTPublishInfo_t publishInfo = { 0 };
-    MQTTContext_t * pMqttContext = &mqttContext;
-    struct timespec ts = { 0 };
-    int ret;
 
     /* Set the required publish parameters. */
     publishInfo.pTopicName = pacTopic;
@@ -1350,51 +1297,18 @@ static OtaMqttStatus_t mqttPublish( const char * const pacTopic,
     publishInfo.pPayload = pMsg;
     publishInfo.payloadLength = msgSize;
 
-    if( pthread_mutex_lock( &mqttMutex ) == 0 )
-    {
-        mqttStatus = MQTT_Publish( pMqttContext,
-                                   &publishInfo,
-                                   MQTT_GetPacketId( pMqttContext ) );
-
-        if( mqttStatus != MQTTSuccess )
-        {
-            LogError( ( "Failed to send PUBLISH packet to broker with error = %u.", mqttStatus ) );
+    /* Send PUBLISH packet from the MQTT thread, and for QoS 1 wait for the
+     * PUBACK with its packet identifier. */
+    mqttStatus = MqttCommandAgent_Publish( &commandAgent, &publishInfo );
 
-            otaRet = OtaMqttPublishFailed;
-        }
-
-        pthread_mutex_unlock( &mqttMutex );
-    }
-    else
+    if( mqttStatus != MQTTSuccess )
     {
-        LogError( ( "Failed to acquire mqtt mutex for executing MQTT_Publish"
-                    ",errno=%s",
-                    strerror( errno ) ) );
+        LogError( ( "Failed to publish with error = %s.",
+                    MQTT_Status_strerror( mqttStatus ) ) );
 
         otaRet = OtaMqttPublishFailed;
     }
 
-    if( ( mqttStatus == MQTTSuccess ) && ( qos == 1 ) )
-    {
-        /* Calculate relative interval as current time plus number of seconds. */
-        clock_gettime( CLOCK_REALTIME, &ts );
-        ts.tv_sec += MQTT_ACK_TIMEOUT_MS;
-
-        while( ( ret = sem_timedwait( &ackSemaphore, &ts ) ) == -1 && errno == EINTR )
-        {
-            continue;
-        }
-
-        if( ret == -1 )
-        {
-            LogError( ( "Failed to receive ack for publish."
-                        ",errno=%s",
-                        strerror( errno ) ) );
-
-            otaRet = OtaMqttPublishFailed;
-        }
-    }
-
     return otaRet;
 }
 
@@ -1408,7 +1322,6 @@ static OtaMqttStatus_t mqttUnsubscribe( const char * pTopicFilter,
     MQTTStatus_t mqttStatus = MQTTBadParameter;
 
     MQTTSubscribeInfo_t pSubscriptionList[ 1 ];
-    MQTTContext_t * pMqttContext = &mqttContext;
 
     ( void ) qos;
 
@@ -1419,27 +1332,13 @@ static OtaMqttStatus_t mqttUnsubscribe( const char * pTopicFilter,
     pSubscriptionList[ 0 ].pTopicFilter = pTopicFilter;
     pSubscriptionList[ 0 ].topicFilterLength = topicFilterLength;
 
-    if( pthread_mutex_lock( &mqttMutex ) == 0 )
-    {
-        /* Send UNSUBSCRIBE packet. */
-        mqttStatus = MQTT_Unsubscribe( pMqttContext,
-                                       pSubscriptionList,
-                                       sizeof( pSubscriptionList ) / sizeof( MQTTSubscribeInfo_t ),
-                                       MQTT_GetPacketId( pMqttContext ) );
-
-        pthread_mutex_unlock( &mqttMutex );
-    }
-    else
-    {
-        LogError( ( "Failed to acquire mutex for executing MQTT_Unsubscribe"
-                    ",errno=%s",
-                    strerror( errno ) ) );
-    }
+    /* Send UNSUBSCRIBE packet from the MQTT thread and wait for the UNSUBACK. */
+    mqttStatus = MqttCommandAgent_Unsubscribe( &commandAgent, &pSubscriptionList[ 0 ] );
 
     if( mqttStatus != MQTTSuccess )
     {
-        LogError( ( "Failed to send UNSUBSCRIBE packet to broker with error = %u.",
-                    mqttStatus ) );
+        LogError( ( "Failed to unsubscribe with error = %s.",
+                    MQTT_Status_strerror( mqttStatus ) ) );
 
         otaRet = OtaMqttUnsubscribeFailed;
     }
@@ -1590,24 +1489,20 @@ static int startOTADemo( void )
                         OTA_SignalEvent( &eventMsg );
                     }
                 }
+                else
+                {
+                    /* Fail the MQTT operations queued while connecting. */
+                    MqttCommandAgent_CancelCommands( &commandAgent, MQTTSendFailed );
+                }
             }
 
             if( mqttSessionEstablished == true )
             {
-                /* Acquire the mqtt mutex lock. */
-                if( pthread_mutex_lock( &mqttMutex ) == 0 )
-                {
-                    /* Loop to receive packet from transport interface. */
-                    mqttStatus = MQTT_ProcessLoop( &mqttContext );
+                /* Send the MQTT operations queued by the OTA agent thread. */
+                MqttCommandAgent_ProcessCommands( &commandAgent );
 
-                    pthread_mutex_unlock( &mqttMutex );
-                }
-                else
-                {
-                    LogError( ( "Failed to acquire mutex to execute process loop"
-                                ",errno=%s",
-                                strerror( errno ) ) );
-                }
+                /* Loop to receive packet from transport interface. */
+                mqttStatus = MQTT_ProcessLoop( &mqttContext );
 
                 if( ( mqttStatus == MQTTSuccess ) || ( mqttStatus == MQTTNeedMoreBytes ) )
                 {
@@ -1620,8 +1515,14 @@ static int startOTADemo( void )
                                otaStatistics.otaPacketsProcessed,
                                otaStatistics.otaPacketsDropped ) );
 
-                    /* Delay to allow data to buffer for MQTT_ProcessLoop. */
-                    Clock_SleepMs( OTA_EXAMPLE_LOOP_SLEEP_PERIOD_MS );
+                    /* Wait for the next packet or command. Data already decrypted
+                     * by OpenSSL does not make the socket readable. */
+                    if( SSL_pending( opensslParams.pSsl ) == 0 )
+                    {
+                        MqttCommandAgent_Wait( &commandAgent,
+                                               opensslParams.socketDescriptor,
+                                               OTA_EXAMPLE_LOOP_WAIT_PERIOD_MS );
+                    }
                 }
                 else
                 {
@@ -1640,6 +1541,10 @@ static int startOTADemo( void )
 
                         while( ( ( state = OTA_GetState() ) != OtaAgentStateSuspended ) && ( suspendTimeout > 0 ) )
                         {
+                            /* Fail the MQTT operations the OTA agent thread
+                             * queued before seeing the suspend event. */
+                            MqttCommandAgent_CancelCommands( &commandAgent, MQTTSendFailed );
+
                             /* Wait for OTA Library state to suspend */
                             Clock_SleepMs( OTA_EXAMPLE_TASK_DELAY_MS );
                             suspendTimeout -= OTA_EXAMPLE_TASK_DELAY_MS;
@@ -1695,54 +1600,29 @@ int main( int argc,
     /* Return error status. */
     int returnStatus = EXIT_SUCCESS;
 
-    /* Semaphore initialization flag. */
-    bool bufferSemInitialized = false;
-    bool ackSemInitialized = false;
-    bool mqttMutexInitialized = false;
+    /* Event buffer pool usage. */
+    OtaEventBufferPoolStats_t bufferPoolStats = { 0 };
+
+    /* Command agent initialization flag. */
+    bool commandAgentInitialized = false;
 
     /* Maximum time in milliseconds to wait before exiting demo . */
     int16_t waitTimeoutMs = OTA_DEMO_EXIT_TIMEOUT_MS;
 
-    /* Initialize semaphore for buffer operations. */
-    if( sem_init( &bufferSemaphore, 0, 1 ) != 0 )
-    {
-        LogError( ( "Failed to initialize buffer semaphore"
-                    ",errno=%s",
-                    strerror( errno ) ) );
-
-        returnStatus = EXIT_FAILURE;
-    }
-    else
-    {
-        bufferSemInitialized = true;
-    }
-
-    /* Initialize semaphore for ack. */
-    if( sem_init( &ackSemaphore, 0, 0 ) != 0 )
-    {
-        LogError( ( "Failed to initialize ack semaphore"
-                    ",errno=%s",
-                    strerror( errno ) ) );
+    /* Initialize the pool of event buffers. */
+    OtaEventBufferPool_Init( &eventBufferPool,
+                             eventBuffer,
+                             eventBufferNextFree,
+                             otaconfigMAX_NUM_OTA_DATA_BUFFERS );
 
-        returnStatus = EXIT_FAILURE;
-    }
-    else
+    /* Initialize the agent running the MQTT operations of the OTA agent. */
+    if( MqttCommandAgent_Init( &commandAgent, &mqttContext ) == false )
     {
-        ackSemInitialized = true;
-    }
-
-    /* Initialize mutex for coreMQTT APIs. */
-    if( pthread_mutex_init( &mqttMutex, NULL ) != 0 )
-    {
-        LogError( ( "Failed to initialize mutex for mqtt apis"
-                    ",errno=%s",
-                    strerror( errno ) ) );
-
         returnStatus = EXIT_FAILURE;
     }
     else
     {
-        mqttMutexInitialized = true;
+        commandAgentInitialized = true;
     }
 
     if( returnStatus == EXIT_SUCCESS )
@@ -1761,43 +1641,16 @@ int main( int argc,
     /* Disconnect from broker and close connection. */
     disconnect();
 
-    if( bufferSemInitialized == true )
-    {
-        /* Cleanup semaphore created for buffer operations. */
-        if( sem_destroy( &bufferSemaphore ) != 0 )
-        {
-            LogError( ( "Failed to destroy buffer semaphore"
-                        ",errno=%s",
-                        strerror( errno ) ) );
-
-            returnStatus = EXIT_FAILURE;
-        }
-    }
-
-    if( ackSemInitialized == true )
-    {
-        /* Cleanup semaphore created for ack. */
-        if( sem_destroy( &ackSemaphore ) != 0 )
-        {
-            LogError( ( "Failed to destroy ack semaphore"
-                        ",errno=%s",
-                        strerror( errno ) ) );
+    OtaEventBufferPool_GetStats( &eventBufferPool, &bufferPoolStats );
+    LogInfo( ( "OTA event buffers: High water mark=%u of %u, "
+               "Times none was free=%u",
+               ( unsigned int ) bufferPoolStats.highWaterMark,
+               ( unsigned int ) otaconfigMAX_NUM_OTA_DATA_BUFFERS,
+               ( unsigned int ) bufferPoolStats.exhaustedCount ) );
 
-            returnStatus = EXIT_FAILURE;
-        }
-    }
-
-    if( mqttMutexInitialized == true )
+    if( commandAgentInitialized == true )
     {
-        /* Cleanup mutex created for MQTT operations. */
-        if( pthread_mutex_destroy( &mqttMutex ) != 0 )
-        {
-            LogError( ( "Failed to destroy mutex for mqtt apis"
-                        ",errno=%s",
-                        strerror( errno ) ) );
-
-            returnStatus = EXIT_FAILURE;
-        }
+        MqttCommandAgent_Deinit( &commandAgent );
     }
 
     /* Wait and log message before exiting demo. */
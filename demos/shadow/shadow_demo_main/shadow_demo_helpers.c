@@ -56,6 +56,9 @@
 /* AWS IoT Core TLS ALPN definitions for MQTT authentication */
 #include "aws_iot_alpn_defs.h"
 
+/* Retransmission store for unacknowledged publishes. */
+#include "mqtt_retransmit_store.h"
+
 /**
  * These configuration settings are required to run the shadow demo.
  * Throw compilation error if the below configs are not defined.
@@ -175,25 +178,6 @@
 
 /*-----------------------------------------------------------*/
 
-/**
- * @brief Structure to keep the MQTT publish packets until an ack is received
- * for QoS1 publishes.
- */
-typedef struct PublishPackets
-{
-    /**
-     * @brief Packet identifier of the publish packet.
-     */
-    uint16_t packetId;
-
-    /**
-     * @brief Publish info of the publish packet.
-     */
-    MQTTPublishInfo_t pubInfo;
-} PublishPackets_t;
-
-/*-----------------------------------------------------------*/
-
 /* Each compilation unit must define the NetworkContext struct. */
 struct NetworkContext
 {
@@ -223,11 +207,27 @@ static uint16_t globalSubscribePacketIdentifier = 0U;
 static uint16_t globalUnsubscribePacketIdentifier = 0U;
 
 /**
- * @brief Array to keep the outgoing publish messages.
+ * @brief Store to keep the outgoing publish messages.
+ *
  * These stored outgoing publish messages are kept until a successful ack
  * is received.
  */
-static PublishPackets_t outgoingPublishPackets[ MAX_OUTGOING_PUBLISHES ] = { 0 };
+static MqttRetransmitStore_t outgoingPublishStore;
+
+/**
+ * @brief Entries of #outgoingPublishStore.
+ */
+static MqttRetransmitEntry_t outgoingPublishEntries[ MAX_OUTGOING_PUBLISHES ];
+
+/**
+ * @brief Index of #outgoingPublishStore by packet identifier.
+ */
+static uint16_t outgoingPublishIndex[ MQTT_RETRANSMIT_STORE_INDEX_SIZE( MAX_OUTGOING_PUBLISHES ) ];
+
+/**
+ * @brief Whether #outgoingPublishStore has been initialized.
+ */
+static bool outgoingPublishStoreReady = false;
 
 /**
  * @brief The network buffer must remain valid for the lifetime of the MQTT context.
@@ -295,40 +295,6 @@ static uint32_t generateRandomNumber();
  */
 static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext );
 
-/**
- * @brief Function to get the free index at which an outgoing publish
- * can be stored.
- *
- * @param[out] pIndex The output parameter to return the index at which an
- * outgoing publish message can be stored.
- *
- * @return EXIT_FAILURE if no more publishes can be stored;
- * EXIT_SUCCESS if an index to store the next outgoing publish is obtained.
- */
-static int getNextFreeIndexForOutgoingPublishes( uint8_t * pIndex );
-
-/**
- * @brief Function to clean up an outgoing publish at given index from the
- * #outgoingPublishPackets array.
- *
- * @param[in] index The index at which a publish message has to be cleaned up.
- */
-static void cleanupOutgoingPublishAt( uint8_t index );
-
-/**
- * @brief Function to clean up all the outgoing publishes maintained in the
- * array.
- */
-static void cleanupOutgoingPublishes( void );
-
-/**
- * @brief Function to clean up the publish packet with the given packet id.
- *
- * @param[in] packetId Packet identifier of the packet to be cleaned up from
- * the array.
- */
-static void cleanupOutgoingPublishWithPacketID( uint16_t packetId );
-
 /**
  * @brief Function to resend the publishes if a session is re-established with
  * the broker. This function handles the resending of the QoS1 publish packets,
@@ -403,6 +369,10 @@ static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext
     opensslCredentials.pPrivateKeyPath = CLIENT_PRIVATE_KEY_PATH;
     opensslCredentials.sniHostName = AWS_IOT_ENDPOINT;
 
+    /* Resume the previous TLS session when reconnecting to the broker, so that
+     * retries after a dropped connection skip the full handshake. */
+    opensslCredentials.enableSessionResumption = 1U;
+
     if( AWS_MQTT_PORT == 443 )
     {
         /* Pass the ALPN protocol name depending on the port being used.
@@ -473,77 +443,6 @@ static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext
 
 /*-----------------------------------------------------------*/
 
-static int getNextFreeIndexForOutgoingPublishes( uint8_t * pIndex )
-{
-    int returnStatus = EXIT_FAILURE;
-    uint8_t index = 0;
-
-    assert( outgoingPublishPackets != NULL );
-    assert( pIndex != NULL );
-
-    for( index = 0; index < MAX_OUTGOING_PUBLISHES; index++ )
-    {
-        /* A free index is marked by invalid packet id.
-         * Check if the the index has a free slot. */
-        if( outgoingPublishPackets[ index ].packetId == MQTT_PACKET_ID_INVALID )
-        {
-            returnStatus = EXIT_SUCCESS;
-            break;
-        }
-    }
-
-    /* Copy the available index into the output param. */
-    *pIndex = index;
-
-    return returnStatus;
-}
-/*-----------------------------------------------------------*/
-
-static void cleanupOutgoingPublishAt( uint8_t index )
-{
-    assert( outgoingPublishPackets != NULL );
-    assert( index < MAX_OUTGOING_PUBLISHES );
-
-    /* Clear the outgoing publish packet. */
-    ( void ) memset( &( outgoingPublishPackets[ index ] ),
-                     0x00,
-                     sizeof( outgoingPublishPackets[ index ] ) );
-}
-
-/*-----------------------------------------------------------*/
-
-static void cleanupOutgoingPublishes( void )
-{
-    assert( outgoingPublishPackets != NULL );
-
-    /* Clean up all the outgoing publish packets. */
-    ( void ) memset( outgoingPublishPackets, 0x00, sizeof( outgoingPublishPackets ) );
-}
-
-/*-----------------------------------------------------------*/
-
-static void cleanupOutgoingPublishWithPacketID( uint16_t packetId )
-{
-    uint8_t index = 0;
-
-    assert( outgoingPublishPackets != NULL );
-    assert( packetId != MQTT_PACKET_ID_INVALID );
-
-    /* Clean up all the saved outgoing publishes. */
-    for( ; index < MAX_OUTGOING_PUBLISHES; index++ )
-    {
-        if( outgoingPublishPackets[ index ].packetId == packetId )
-        {
-            cleanupOutgoingPublishAt( index );
-            LogInfo( ( "Cleaned up outgoing publish packet with packet id %u.",
-                       packetId ) );
-            break;
-        }
-    }
-}
-
-/*-----------------------------------------------------------*/
-
 static int waitForPacketAck( MQTTContext_t * pMqttContext,
                              uint16_t usPacketIdentifier,
                              uint32_t ulTimeout )
@@ -651,7 +550,7 @@ void HandleOtherIncomingPacket( MQTTPacketInfo_t * pPacketInfo,
             LogInfo( ( "PUBACK received for packet id %u.",
                        packetIdentifier ) );
             /* Cleanup publish packet when a PUBACK is received. */
-            cleanupOutgoingPublishWithPacketID( packetIdentifier );
+            ( void ) MqttRetransmitStore_Remove( &outgoingPublishStore, packetIdentifier );
             /* Update the global ACK packet identifier. */
             globalAckPacketIdentifier = packetIdentifier;
             break;
@@ -669,40 +568,20 @@ static int handlePublishResend( MQTTContext_t * pMqttContext )
 {
     int returnStatus = EXIT_SUCCESS;
     MQTTStatus_t mqttStatus = MQTTSuccess;
-    uint8_t index = 0U;
 
-    assert( outgoingPublishPackets != NULL );
+    LogInfo( ( "Sending %u duplicate PUBLISH packets.",
+               ( unsigned int ) MqttRetransmitStore_PendingCount( &outgoingPublishStore ) ) );
 
-    /* Resend all the QoS1 publishes still in the array. These are the
-     * publishes that hasn't received a PUBACK. When a PUBACK is
-     * received, the publish is removed from the array. */
-    for( index = 0U; index < MAX_OUTGOING_PUBLISHES; index++ )
-    {
-        if( outgoingPublishPackets[ index ].packetId != MQTT_PACKET_ID_INVALID )
-        {
-            outgoingPublishPackets[ index ].pubInfo.dup = true;
+    /* Resend all the QoS1 publishes still in the #outgoingPublishStore.
+     * These are the publishes that haven't received a PUBACK yet. When a PUBACK
+     * is received, the corresponding publish is removed from the store. */
+    mqttStatus = MqttRetransmitStore_ResendAll( &outgoingPublishStore, pMqttContext );
 
-            LogInfo( ( "Sending duplicate PUBLISH with packet id %u.",
-                       outgoingPublishPackets[ index ].packetId ) );
-            mqttStatus = MQTT_Publish( pMqttContext,
-                                       &outgoingPublishPackets[ index ].pubInfo,
-                                       outgoingPublishPackets[ index ].packetId );
-
-            if( mqttStatus != MQTTSuccess )
-            {
-                LogError( ( "Sending duplicate PUBLISH for packet id %u "
-                            " failed with status %u.",
-                            outgoingPublishPackets[ index ].packetId,
-                            mqttStatus ) );
-                returnStatus = EXIT_FAILURE;
-                break;
-            }
-            else
-            {
-                LogInfo( ( "Sent duplicate PUBLISH successfully for packet id %u.",
-                           outgoingPublishPackets[ index ].packetId ) );
-            }
-        }
+    if( mqttStatus != MQTTSuccess )
+    {
+        LogError( ( "Sending duplicate PUBLISH packets failed with status %u.",
+                    mqttStatus ) );
+        returnStatus = EXIT_FAILURE;
     }
 
     return returnStatus;
@@ -747,6 +626,7 @@ int EstablishMqttSession( MQTTEventCallback_t eventCallback )
         transport.pNetworkContext = pNetworkContext;
         transport.send = Openssl_Send;
         transport.recv = Openssl_Recv;
+        transport.writev = Openssl_Writev;
 
         /* Fill the values for network buffer. */
         networkBuffer.pBuffer = buffer;
@@ -835,6 +715,17 @@ int EstablishMqttSession( MQTTEventCallback_t eventCallback )
 
             if( returnStatus == EXIT_SUCCESS )
             {
+                /* The store is kept across connections, so it is initialized only
+                 * once. */
+                if( outgoingPublishStoreReady == false )
+                {
+                    MqttRetransmitStore_Init( &outgoingPublishStore,
+                                              outgoingPublishEntries,
+                                              MAX_OUTGOING_PUBLISHES,
+                                              outgoingPublishIndex );
+                    outgoingPublishStoreReady = true;
+                }
+
                 /* Check if session is present and if there are any outgoing publishes
                  * that need to resend. This is only valid if the broker is
                  * re-establishing a session which was already present. */
@@ -853,7 +744,7 @@ int EstablishMqttSession( MQTTEventCallback_t eventCallback )
 
                     /* Clean up the outgoing publishes waiting for ack as this new
                      * connection doesn't re-establish an existing session. */
-                    cleanupOutgoingPublishes();
+                    MqttRetransmitStore_Clear( &outgoingPublishStore );
                 }
             }
         }
@@ -1018,46 +909,44 @@ int32_t PublishToTopic( const char * pTopicFilter,
 {
     int returnStatus = EXIT_SUCCESS;
     MQTTStatus_t mqttStatus = MQTTSuccess;
-    uint8_t publishIndex = MAX_OUTGOING_PUBLISHES;
+    MQTTPublishInfo_t publishInfo;
+    uint16_t packetId = MQTT_PACKET_ID_INVALID;
     MQTTContext_t * pMqttContext = &mqttContext;
 
     assert( pMqttContext != NULL );
     assert( pTopicFilter != NULL );
     assert( topicFilterLength > 0 );
 
-    /* Get the next free index for the outgoing publish. All QoS1 outgoing
-     * publishes are stored until a PUBACK is received. These messages are
-     * stored for supporting a resend if a network connection is broken before
-     * receiving a PUBACK. */
-    returnStatus = getNextFreeIndexForOutgoingPublishes( &publishIndex );
-
-    if( returnStatus == EXIT_FAILURE )
+    /* This example publishes to only one topic and uses QOS1. */
+    ( void ) memset( &publishInfo, 0x00, sizeof( publishInfo ) );
+    publishInfo.qos = MQTTQoS1;
+    publishInfo.pTopicName = pTopicFilter;
+    publishInfo.topicNameLength = ( uint16_t ) topicFilterLength;
+    publishInfo.pPayload = pPayload;
+    publishInfo.payloadLength = payloadLength;
+
+    /* Get a new packet id. */
+    packetId = MQTT_GetPacketId( pMqttContext );
+
+    /* All QoS1 outgoing publishes are stored until a PUBACK is received. These
+     * messages are stored for supporting a resend if a network connection is
+     * broken before receiving a PUBACK. */
+    if( MqttRetransmitStore_Add( &outgoingPublishStore, packetId, &publishInfo ) == false )
     {
         LogError( ( "Unable to find a free spot for outgoing PUBLISH message." ) );
+        returnStatus = EXIT_FAILURE;
     }
     else
     {
         LogInfo( ( "Published payload: %s", pPayload ) );
-        /* This example publishes to only one topic and uses QOS1. */
-        outgoingPublishPackets[ publishIndex ].pubInfo.qos = MQTTQoS1;
-        outgoingPublishPackets[ publishIndex ].pubInfo.pTopicName = pTopicFilter;
-        outgoingPublishPackets[ publishIndex ].pubInfo.topicNameLength = topicFilterLength;
-        outgoingPublishPackets[ publishIndex ].pubInfo.pPayload = pPayload;
-        outgoingPublishPackets[ publishIndex ].pubInfo.payloadLength = payloadLength;
-
-        /* Get a new packet id. */
-        outgoingPublishPackets[ publishIndex ].packetId = MQTT_GetPacketId( pMqttContext );
-
         /* Send PUBLISH packet. */
-        mqttStatus = MQTT_Publish( pMqttContext,
-                                   &outgoingPublishPackets[ publishIndex ].pubInfo,
-                                   outgoingPublishPackets[ publishIndex ].packetId );
+        mqttStatus = MQTT_Publish( pMqttContext, &publishInfo, packetId );
 
         if( mqttStatus != MQTTSuccess )
         {
             LogError( ( "Failed to send PUBLISH packet to broker with error = %u.",
                         mqttStatus ) );
-            cleanupOutgoingPublishAt( publishIndex );
+            ( void ) MqttRetransmitStore_Remove( &outgoingPublishStore, packetId );
             returnStatus = EXIT_FAILURE;
         }
         else
@@ -1065,7 +954,7 @@ int32_t PublishToTopic( const char * pTopicFilter,
             LogInfo( ( "PUBLISH sent for topic %.*s to broker with packet ID %u.",
                        topicFilterLength,
                        pTopicFilter,
-                       outgoingPublishPackets[ publishIndex ].packetId ) );
+                       packetId ) );
 
             /* Calling MQTT_ProcessLoop to process incoming publish echo, since
              * application subscribed to the same topic the broker will send
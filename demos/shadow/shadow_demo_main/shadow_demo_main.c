@@ -60,8 +60,8 @@
 /* SHADOW API header. */
 #include "shadow.h"
 
-/* JSON API header. */
-#include "core_json.h"
+/* JSON index API header. */
+#include "json_index.h"
 
 /* Clock for timer. */
 #include "clock.h"
@@ -180,8 +180,35 @@
  */
 #define SHADOW_DELETE_REJECTED_ERROR_CODE_KEY_LENGTH    ( ( uint16_t ) ( sizeof( SHADOW_DELETE_REJECTED_ERROR_CODE_KEY ) - 1 ) )
 
+/**
+ * @brief Number of values of an incoming shadow document that can be indexed.
+ * Fields of documents with more values are searched for with coreJSON.
+ */
+#ifndef SHADOW_DOCUMENT_INDEX_CAPACITY
+    #define SHADOW_DOCUMENT_INDEX_CAPACITY    ( 256U )
+#endif
+
 /*-----------------------------------------------------------*/
 
+/**
+ * @brief Index of the incoming shadow document being handled.
+ *
+ * The handlers validate and index a document in a single pass, then find each
+ * of its fields without scanning the document again. They all run in the MQTT
+ * event callback, so they share the index.
+ */
+static JsonIndex_t shadowDocumentIndex;
+
+/**
+ * @brief Storage for the values of #shadowDocumentIndex.
+ */
+static JsonIndexEntry_t shadowDocumentEntries[ SHADOW_DOCUMENT_INDEX_CAPACITY ];
+
+/**
+ * @brief Storage for the hash table of #shadowDocumentIndex.
+ */
+static uint16_t shadowDocumentSlots[ JSON_INDEX_SLOT_COUNT( SHADOW_DOCUMENT_INDEX_CAPACITY ) ];
+
 /**
  * @brief The simulated device current power on state.
  */
@@ -278,9 +305,9 @@ static void deleteRejectedHandler( MQTTPublishInfo_t * pPublishInfo );
 
 static void deleteRejectedHandler( MQTTPublishInfo_t * pPublishInfo )
 {
-    JSONStatus_t result = JSONSuccess;
-    char * pOutValue = NULL;
-    uint32_t outValueLength = 0U;
+    JsonIndexStatus_t result = JsonIndexSuccess;
+    const char * pOutValue = NULL;
+    size_t outValueLength = 0U;
     long errorCode = 0L;
 
     assert( pPublishInfo != NULL );
@@ -297,29 +324,33 @@ static void deleteRejectedHandler( MQTTPublishInfo_t * pPublishInfo )
      * }
      */
 
-    /* Make sure the payload is a valid json document. */
-    result = JSON_Validate( ( const char * ) pPublishInfo->pPayload,
-                            pPublishInfo->payloadLength );
+    /* Make sure the payload is a valid json document, and index it. */
+    result = JsonIndex_Build( &shadowDocumentIndex,
+                              ( const char * ) pPublishInfo->pPayload,
+                              pPublishInfo->payloadLength,
+                              shadowDocumentEntries,
+                              SHADOW_DOCUMENT_INDEX_CAPACITY,
+                              shadowDocumentSlots );
 
-    if( result == JSONSuccess )
+    if( result == JsonIndexSuccess )
     {
-        /* Then we start to get the version value by JSON keyword "version". */
-        result = JSON_Search( ( char * ) pPublishInfo->pPayload,
-                              pPublishInfo->payloadLength,
-                              SHADOW_DELETE_REJECTED_ERROR_CODE_KEY,
-                              SHADOW_DELETE_REJECTED_ERROR_CODE_KEY_LENGTH,
-                              &pOutValue,
-                              ( size_t * ) &outValueLength );
+        /* Then we get the error code value by JSON keyword "code". */
+        result = JsonIndex_Find( &shadowDocumentIndex,
+                                 SHADOW_DELETE_REJECTED_ERROR_CODE_KEY,
+                                 SHADOW_DELETE_REJECTED_ERROR_CODE_KEY_LENGTH,
+                                 &pOutValue,
+                                 &outValueLength,
+                                 NULL );
     }
     else
     {
         LogError( ( "The json document is invalid!!" ) );
     }
 
-    if( result == JSONSuccess )
+    if( result == JsonIndexSuccess )
     {
         LogInfo( ( "Error code is: %.*s.",
-                   outValueLength,
+                   ( int ) outValueLength,
                    pOutValue ) );
 
         /* Convert the extracted value to an unsigned integer value. */
@@ -346,9 +377,9 @@ static void updateDeltaHandler( MQTTPublishInfo_t * pPublishInfo )
     static uint32_t currentVersion = 0; /* Remember the latestVersion # we've ever received */
     uint32_t version = 0U;
     uint32_t newState = 0U;
-    char * outValue = NULL;
-    uint32_t outValueLength = 0U;
-    JSONStatus_t result = JSONSuccess;
+    const char * outValue = NULL;
+    size_t outValueLength = 0U;
+    JsonIndexStatus_t result = JsonIndexSuccess;
 
     assert( pPublishInfo != NULL );
     assert( pPublishInfo->pPayload != NULL );
@@ -371,19 +402,23 @@ static void updateDeltaHandler( MQTTPublishInfo_t * pPublishInfo )
      *  }
      */
 
-    /* Make sure the payload is a valid json document. */
-    result = JSON_Validate( ( const char * ) pPublishInfo->pPayload,
-                            pPublishInfo->payloadLength );
+    /* Make sure the payload is a valid json document, and index it. */
+    result = JsonIndex_Build( &shadowDocumentIndex,
+                              ( const char * ) pPublishInfo->pPayload,
+                              pPublishInfo->payloadLength,
+                              shadowDocumentEntries,
+                              SHADOW_DOCUMENT_INDEX_CAPACITY,
+                              shadowDocumentSlots );
 
-    if( result == JSONSuccess )
+    if( result == JsonIndexSuccess )
     {
         /* Then we start to get the version value by JSON keyword "version". */
-        result = JSON_Search( ( char * ) pPublishInfo->pPayload,
-                              pPublishInfo->payloadLength,
-                              "version",
-                              sizeof( "version" ) - 1,
-                              &outValue,
-                              ( size_t * ) &outValueLength );
+        result = JsonIndex_Find( &shadowDocumentIndex,
+                                 "version",
+                                 sizeof( "version" ) - 1,
+                                 &outValue,
+                                 &outValueLength,
+                                 NULL );
     }
     else
     {
@@ -391,10 +426,10 @@ static void updateDeltaHandler( MQTTPublishInfo_t * pPublishInfo )
         eventCallbackError = true;
     }
 
-    if( result == JSONSuccess )
+    if( result == JsonIndexSuccess )
     {
         LogInfo( ( "version: %.*s",
-                   outValueLength,
+                   ( int ) outValueLength,
                    outValue ) );
 
         /* Convert the extracted value to an unsigned integer value. */
@@ -415,13 +450,13 @@ static void updateDeltaHandler( MQTTPublishInfo_t * pPublishInfo )
         /* Set to received version as the current version. */
         currentVersion = version;
 
-        /* Get powerOn state from json documents. */
-        result = JSON_Search( ( char * ) pPublishInfo->pPayload,
-                              pPublishInfo->payloadLength,
-                              "state.powerOn",
-                              sizeof( "state.powerOn" ) - 1,
-                              &outValue,
-                              ( size_t * ) &outValueLength );
+        /* Get powerOn state from the index of the json document. */
+        result = JsonIndex_Find( &shadowDocumentIndex,
+                                 "state.powerOn",
+                                 sizeof( "state.powerOn" ) - 1,
+                                 &outValue,
+                                 &outValueLength,
+                                 NULL );
     }
     else
     {
@@ -433,7 +468,7 @@ static void updateDeltaHandler( MQTTPublishInfo_t * pPublishInfo )
         LogWarn( ( "The received version is smaller than current one!!" ) );
     }
 
-    if( result == JSONSuccess )
+    if( result == JsonIndexSuccess )
     {
         /* Convert the powerOn state value to an unsigned integer value. */
         newState = ( uint32_t ) strtoul( outValue, NULL, 10 );
@@ -465,10 +500,10 @@ static void updateDeltaHandler( MQTTPublishInfo_t * pPublishInfo )
 
 static void updateAcceptedHandler( MQTTPublishInfo_t * pPublishInfo )
 {
-    char * outValue = NULL;
-    uint32_t outValueLength = 0U;
+    const char * outValue = NULL;
+    size_t outValueLength = 0U;
     uint32_t receivedToken = 0U;
-    JSONStatus_t result = JSONSuccess;
+    JsonIndexStatus_t result = JsonIndexSuccess;
 
     assert( pPublishInfo != NULL );
     assert( pPublishInfo->pPayload != NULL );
@@ -498,19 +533,23 @@ static void updateAcceptedHandler( MQTTPublishInfo_t * pPublishInfo )
      *  }
      */
 
-    /* Make sure the payload is a valid json document. */
-    result = JSON_Validate( ( const char * ) pPublishInfo->pPayload,
-                            pPublishInfo->payloadLength );
+    /* Make sure the payload is a valid json document, and index it. */
+    result = JsonIndex_Build( &shadowDocumentIndex,
+                              ( const char * ) pPublishInfo->pPayload,
+                              pPublishInfo->payloadLength,
+                              shadowDocumentEntries,
+                              SHADOW_DOCUMENT_INDEX_CAPACITY,
+                              shadowDocumentSlots );
 
-    if( result == JSONSuccess )
+    if( result == JsonIndexSuccess )
     {
         /* Get clientToken from json documents. */
-        result = JSON_Search( ( char * ) pPublishInfo->pPayload,
-                              pPublishInfo->payloadLength,
-                              "clientToken",
-                              sizeof( "clientToken" ) - 1,
-                              &outValue,
-                              ( size_t * ) &outValueLength );
+        result = JsonIndex_Find( &shadowDocumentIndex,
+                                 "clientToken",
+                                 sizeof( "clientToken" ) - 1,
+                                 &outValue,
+                                 &outValueLength,
+                                 NULL );
     }
     else
     {
@@ -518,9 +557,9 @@ static void updateAcceptedHandler( MQTTPublishInfo_t * pPublishInfo )
         eventCallbackError = true;
     }
 
-    if( result == JSONSuccess )
+    if( result == JsonIndexSuccess )
     {
-        LogInfo( ( "clientToken: %.*s", outValueLength,
+        LogInfo( ( "clientToken: %.*s", ( int ) outValueLength,
                    outValue ) );
 
         /* Convert the code to an unsigned integer value. */
@@ -0,0 +1,683 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file metrics_collector_test.c
+ * @brief Tests of the socket table reader of the Device Defender metrics
+ * collector with lines longer than its buffer and with short reads, against
+ * a file standing in for /proc/net/tcp, and benchmark of a collection with
+ * 10,000 open sockets.
+ */
+
+/* For RTLD_NEXT. */
+#define _GNU_SOURCE
+
+/* Standard header includes. */
+#include <string.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <time.h>
+
+/* POSIX includes. */
+#include <unistd.h>
+#include <fcntl.h>
+#include <dlfcn.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/* Include config file before other non-system includes. */
+#include "test_config.h"
+
+/* Unity testing framework includes. */
+#include "unity.h"
+
+/* Include the metrics collector. */
+#include "metrics_collector.h"
+
+/**
+ * @brief Initial size of the read buffer of the metrics collector.
+ */
+#define READ_BUFFER_INITIAL_SIZE    ( 4096U )
+
+/**
+ * @brief Path of the socket table read by the metrics collector.
+ */
+#define PROC_NET_TCP_PATH           "/proc/net/tcp"
+
+/**
+ * @brief Template of the directory holding the stand-in of /proc/net/tcp.
+ */
+#define TEST_DIRECTORY_TEMPLATE     "/tmp/metrics_collector_test_XXXXXX"
+
+/**
+ * @brief Connection states of /proc/net/tcp.
+ */
+#define STATE_ESTABLISHED           ( 0x01U )
+#define STATE_TIME_WAIT             ( 0x06U )
+#define STATE_LISTEN                ( 0x0AU )
+
+/**
+ * @brief Size of the output arrays the stand-in table is read into, larger
+ * than the number of entries.
+ */
+#define OUTPUT_ARRAY_LENGTH         ( 16U )
+
+/**
+ * @brief Number of connections the benchmark opens on the loopback
+ * interface. With their accepted ends and the listening socket, 10,000
+ * sockets are open.
+ */
+#define BENCHMARK_CONNECTIONS       ( 4999U )
+
+/**
+ * @brief Length of the output arrays of a Device Defender report, as in the
+ * demo.
+ */
+#define REPORT_ARRAY_LENGTH         ( 10U )
+
+/**
+ * @brief Number of collections timed in each mode of the benchmark.
+ */
+#define COLLECTION_ROUNDS           ( 10U )
+
+/**
+ * @brief Length of the lines the old collector read with fgets.
+ */
+#define STDIO_LINE_LENGTH           ( 256U )
+
+/**
+ * @brief Number of microseconds in a second.
+ */
+#define MICROSECONDS_PER_SECOND     ( 1000000L )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief An entry of the stand-in of /proc/net/tcp.
+ */
+typedef struct SocketTableEntry
+{
+    uint32_t localIp;    /**< @brief Local address, as printed by the kernel. */
+    uint16_t localPort;  /**< @brief Local port. */
+    uint32_t remoteIp;   /**< @brief Remote address, as printed by the kernel. */
+    uint16_t remotePort; /**< @brief Remote port. */
+    uint8_t state;       /**< @brief Connection state. */
+} SocketTableEntry_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Entries of the stand-in of /proc/net/tcp: listening sockets,
+ * established connections, and a connection in TIME_WAIT, which neither
+ * output counts.
+ */
+static const SocketTableEntry_t tableEntries[] =
+{
+    { 0x0100007FU, 0x1F90U, 0x00000000U, 0x0000U, STATE_LISTEN      },
+    { 0x00000000U, 0x0016U, 0x00000000U, 0x0000U, STATE_LISTEN      },
+    { 0x0100007FU, 0x1F90U, 0x0100007FU, 0xC350U, STATE_ESTABLISHED },
+    { 0x0100007FU, 0x1F91U, 0x0100007FU, 0xC351U, STATE_TIME_WAIT   },
+    { 0x0100007FU, 0xC350U, 0x0100007FU, 0x1F90U, STATE_ESTABLISHED },
+    { 0x0F02000AU, 0x0035U, 0x00000000U, 0x0000U, STATE_LISTEN      },
+    { 0x0F02000AU, 0xD431U, 0x08080808U, 0x01BBU, STATE_ESTABLISHED }
+};
+
+/**
+ * @brief Number of entries of #tableEntries.
+ */
+#define TABLE_ENTRY_COUNT    ( sizeof( tableEntries ) / sizeof( tableEntries[ 0 ] ) )
+
+/**
+ * @brief Directory and path of the stand-in of /proc/net/tcp.
+ */
+static char testDirectory[ sizeof( TEST_DIRECTORY_TEMPLATE ) ];
+static char tablePath[ sizeof( TEST_DIRECTORY_TEMPLATE "/tcp" ) ];
+
+/**
+ * @brief Whether open replaces /proc/net/tcp with #tablePath.
+ */
+static bool isTableReplaced = false;
+
+/**
+ * @brief Largest number of bytes a call to pread returns, as the kernel may
+ * return less than asked for; 0 for no limit.
+ */
+static size_t preadLimit = 0U;
+
+/**
+ * @brief Every how many calls pread fails with EINTR; 0 for never.
+ */
+static uint32_t preadInterruptInterval = 0U;
+
+/**
+ * @brief Number of calls to pread since the counter was reset.
+ */
+static uint32_t preadCallCount = 0U;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Writes the stand-in of /proc/net/tcp to #tablePath: a header line,
+ * then a line for each entry of #tableEntries.
+ *
+ * @param[in] paddedLine The line to pad, 0 for the header.
+ * @param[in] paddedLength The length to pad the line to, without its
+ * newline; 0 to pad no line.
+ * @param[in] hasFinalNewline Whether the last line ends with a newline.
+ *
+ * @return The size of the file.
+ */
+static size_t writeSocketTable( size_t paddedLine,
+                                size_t paddedLength,
+                                bool hasFinalNewline );
+
+/**
+ * @brief Reads the stand-in of /proc/net/tcp with the metrics collector,
+ * and checks the open ports and established connections against
+ * #tableEntries.
+ */
+static void checkSocketTable( void );
+
+/**
+ * @brief Counts the entries of /proc/net/tcp in a state the way the metrics
+ * collector did before reading through kept-open files: with fopen, fgets
+ * and sscanf.
+ *
+ * @param[in] state The state to count.
+ *
+ * @return The number of entries.
+ */
+static uint32_t countEntriesWithStdio( uint32_t state );
+
+/**
+ * @brief Opens #BENCHMARK_CONNECTIONS connections to a listening socket on
+ * the loopback interface.
+ *
+ * @param[out] pSockets The listening socket, then both ends of each
+ * connection.
+ *
+ * @return true if every socket was opened.
+ */
+static bool openSockets( int * pSockets );
+
+/**
+ * @brief Closes the sockets of #openSockets with a reset, so that they do
+ * not linger in TIME_WAIT in /proc/net/tcp.
+ *
+ * @param[in] pSockets The sockets.
+ */
+static void closeSockets( int * pSockets );
+
+/**
+ * @brief Returns the time elapsed since a start time.
+ *
+ * @param[in] pStart The start time.
+ *
+ * @return The time elapsed in microseconds.
+ */
+static long elapsedUs( const struct timespec * pStart );
+
+/*-----------------------------------------------------------*/
+
+/* Replaces /proc/net/tcp, then calls the C library. */
+int open( const char * pPath,
+          int flags,
+          ... )
+{
+    static int ( * libcOpen )( const char *, int, ... ) = NULL;
+    mode_t mode = 0;
+    va_list arguments;
+
+    if( libcOpen == NULL )
+    {
+        *( void ** ) ( &libcOpen ) = dlsym( RTLD_NEXT, "open" );
+    }
+
+    if( ( flags & O_CREAT ) != 0 )
+    {
+        va_start( arguments, flags );
+        mode = ( mode_t ) va_arg( arguments, int );
+        va_end( arguments );
+    }
+
+    if( ( isTableReplaced == true ) && ( strcmp( pPath, PROC_NET_TCP_PATH ) == 0 ) )
+    {
+        pPath = tablePath;
+    }
+
+    return libcOpen( pPath, flags, mode );
+}
+
+/*-----------------------------------------------------------*/
+
+/* Shortens and interrupts reads, then calls the C library. */
+ssize_t pread( int fd,
+               void * pBuffer,
+               size_t count,
+               off_t offset )
+{
+    static ssize_t ( * libcPread )( int, void *, size_t, off_t ) = NULL;
+    ssize_t bytesRead = -1;
+
+    if( libcPread == NULL )
+    {
+        *( void ** ) ( &libcPread ) = dlsym( RTLD_NEXT, "pread" );
+    }
+
+    preadCallCount++;
+
+    if( ( preadInterruptInterval > 0U ) && ( ( preadCallCount % preadInterruptInterval ) == 0U ) )
+    {
+        errno = EINTR;
+    }
+    else
+    {
+        if( ( preadLimit > 0U ) && ( count > preadLimit ) )
+        {
+            count = preadLimit;
+        }
+
+        bytesRead = libcPread( fd, pBuffer, count, offset );
+    }
+
+    return bytesRead;
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t writeSocketTable( size_t paddedLine,
+                                size_t paddedLength,
+                                bool hasFinalNewline )
+{
+    FILE * pFile = fopen( tablePath, "w" );
+    long lineStart = 0L, fileSize = 0L;
+    size_t line = 0U;
+    const SocketTableEntry_t * pEntry = NULL;
+
+    TEST_ASSERT_NOT_NULL( pFile );
+
+    for( line = 0U; line <= TABLE_ENTRY_COUNT; line++ )
+    {
+        lineStart = ftell( pFile );
+
+        if( line == 0U )
+        {
+            ( void ) fputs( "  sl  local_address rem_address   st tx_queue rx_queue tr tm->when retrnsmt"
+                            "   uid  timeout inode", pFile );
+        }
+        else
+        {
+            pEntry = &tableEntries[ line - 1U ];
+            ( void ) fprintf( pFile,
+                              "%4u: %08X:%04X %08X:%04X %02X 00000000:00000000 00:00000000 00000000"
+                              "     0        0 %u 1 0000000000000000 100 0 0 10 0",
+                              ( unsigned int ) ( line - 1U ),
+                              ( unsigned int ) pEntry->localIp,
+                              ( unsigned int ) pEntry->localPort,
+                              ( unsigned int ) pEntry->remoteIp,
+                              ( unsigned int ) pEntry->remotePort,
+                              ( unsigned int ) pEntry->state,
+                              ( unsigned int ) ( 10000U + line ) );
+        }
+
+        if( ( paddedLength > 0U ) && ( line == paddedLine ) )
+        {
+            while( ( ftell( pFile ) - lineStart ) < ( long ) paddedLength )
+            {
+                ( void ) fputc( ' ', pFile );
+            }
+        }
+
+        if( ( line < TABLE_ENTRY_COUNT ) || ( hasFinalNewline == true ) )
+        {
+            ( void ) fputc( '\n', pFile );
+        }
+    }
+
+    fileSize = ftell( pFile );
+    TEST_ASSERT_EQUAL( 0, fclose( pFile ) );
+
+    return ( size_t ) fileSize;
+}
+
+/*-----------------------------------------------------------*/
+
+static void checkSocketTable( void )
+{
+    uint16_t ports[ OUTPUT_ARRAY_LENGTH ];
+    Connection_t connections[ OUTPUT_ARRAY_LENGTH ];
+    uint32_t portCount = 0U, connectionCount = 0U;
+    uint32_t expectedPortCount = 0U, expectedConnectionCount = 0U;
+    size_t index = 0U;
+    const SocketTableEntry_t * pEntry = NULL;
+
+    TEST_ASSERT_EQUAL( MetricsCollectorSuccess,
+                       GetOpenTcpPortsAndEstablishedConnections( ports,
+                                                                 OUTPUT_ARRAY_LENGTH,
+                                                                 &portCount,
+                                                                 connections,
+                                                                 OUTPUT_ARRAY_LENGTH,
+                                                                 &connectionCount ) );
+
+    for( index = 0U; index < TABLE_ENTRY_COUNT; index++ )
+    {
+        pEntry = &tableEntries[ index ];
+
+        if( pEntry->state == STATE_LISTEN )
+        {
+            TEST_ASSERT_LESS_THAN( portCount, expectedPortCount );
+            TEST_ASSERT_EQUAL_UINT16( pEntry->localPort, ports[ expectedPortCount ] );
+            expectedPortCount++;
+        }
+        else if( pEntry->state == STATE_ESTABLISHED )
+        {
+            TEST_ASSERT_LESS_THAN( connectionCount, expectedConnectionCount );
+            TEST_ASSERT_EQUAL_UINT32( htonl( pEntry->localIp ), connections[ expectedConnectionCount ].localIp );
+            TEST_ASSERT_EQUAL_UINT32( htonl( pEntry->remoteIp ), connections[ expectedConnectionCount ].remoteIp );
+            TEST_ASSERT_EQUAL_UINT16( pEntry->localPort, connections[ expectedConnectionCount ].localPort );
+            TEST_ASSERT_EQUAL_UINT16( pEntry->remotePort, connections[ expectedConnectionCount ].remotePort );
+            expectedConnectionCount++;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+    }
+
+    TEST_ASSERT_EQUAL_UINT32( expectedPortCount, portCount );
+    TEST_ASSERT_EQUAL_UINT32( expectedConnectionCount, connectionCount );
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t countEntriesWithStdio( uint32_t state )
+{
+    FILE * pFile = fopen( PROC_NET_TCP_PATH, "r" );
+    char line[ STDIO_LINE_LENGTH ];
+    uint32_t lineNumber = 0U, entryCount = 0U;
+    uint32_t localIp = 0U, localPort = 0U, remoteIp = 0U, remotePort = 0U, entryState = 0U;
+
+    TEST_ASSERT_NOT_NULL( pFile );
+
+    while( fgets( line, sizeof( line ), pFile ) != NULL )
+    {
+        lineNumber++;
+
+        if( ( lineNumber > 1U ) &&
+            ( sscanf( line, "%*[^:]: %8x:%4x %8x:%4x %2x",
+                      &localIp, &localPort, &remoteIp, &remotePort, &entryState ) == 5 ) &&
+            ( entryState == state ) )
+        {
+            entryCount++;
+        }
+    }
+
+    ( void ) fclose( pFile );
+
+    return entryCount;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool openSockets( int * pSockets )
+{
+    struct sockaddr_in address = { 0 };
+    socklen_t addressLength = sizeof( address );
+    size_t index = 0U;
+    bool isOpen = false;
+
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+
+    pSockets[ 0 ] = socket( AF_INET, SOCK_STREAM, 0 );
+    isOpen = ( pSockets[ 0 ] >= 0 ) &&
+             ( bind( pSockets[ 0 ], ( struct sockaddr * ) &address, sizeof( address ) ) == 0 ) &&
+             ( listen( pSockets[ 0 ], SOMAXCONN ) == 0 ) &&
+             ( getsockname( pSockets[ 0 ], ( struct sockaddr * ) &address, &addressLength ) == 0 );
+
+    /* Accept each connection once it is established, so that the backlog
+     * never fills. */
+    for( index = 0U; ( isOpen == true ) && ( index < BENCHMARK_CONNECTIONS ); index++ )
+    {
+        pSockets[ ( 2U * index ) + 1U ] = socket( AF_INET, SOCK_STREAM, 0 );
+        isOpen = ( pSockets[ ( 2U * index ) + 1U ] >= 0 ) &&
+                 ( connect( pSockets[ ( 2U * index ) + 1U ], ( struct sockaddr * ) &address, sizeof( address ) ) == 0 );
+
+        if( isOpen == true )
+        {
+            pSockets[ ( 2U * index ) + 2U ] = accept( pSockets[ 0 ], NULL, NULL );
+            isOpen = ( pSockets[ ( 2U * index ) + 2U ] >= 0 );
+        }
+    }
+
+    return isOpen;
+}
+
+/*-----------------------------------------------------------*/
+
+static void closeSockets( int * pSockets )
+{
+    struct linger reset = { 1, 0 };
+    size_t index = 0U;
+
+    for( index = 0U; index < ( ( 2U * BENCHMARK_CONNECTIONS ) + 1U ); index++ )
+    {
+        if( pSockets[ index ] >= 0 )
+        {
+            ( void ) setsockopt( pSockets[ index ], SOL_SOCKET, SO_LINGER, &reset, sizeof( reset ) );
+            ( void ) close( pSockets[ index ] );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static long elapsedUs( const struct timespec * pStart )
+{
+    struct timespec end;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &end );
+
+    return ( ( end.tv_sec - pStart->tv_sec ) * MICROSECONDS_PER_SECOND ) +
+           ( ( end.tv_nsec - pStart->tv_nsec ) / 1000L );
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    ( void ) strcpy( testDirectory, TEST_DIRECTORY_TEMPLATE );
+    TEST_ASSERT_NOT_NULL( mkdtemp( testDirectory ) );
+    ( void ) snprintf( tablePath, sizeof( tablePath ), "%s/tcp", testDirectory );
+
+    isTableReplaced = false;
+    preadLimit = 0U;
+    preadInterruptInterval = 0U;
+    preadCallCount = 0U;
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+    /* The metrics collector keeps its files open between collections. */
+    CloseMetricsCollector();
+
+    isTableReplaced = false;
+    preadLimit = 0U;
+    preadInterruptInterval = 0U;
+
+    ( void ) unlink( tablePath );
+    ( void ) rmdir( testDirectory );
+}
+
+/* ========================== Test Cases ============================ */
+
+/**
+ * @brief Reads socket tables with a line that just fits the read buffer,
+ * one that does not, and one several times its size, as the header, in the
+ * middle or as the last line, and checks the entries read, also on a second
+ * collection reusing the grown buffer.
+ */
+void test_MetricsCollector_SocketTable_LineLongerThanBuffer( void )
+{
+    static const size_t paddedLengths[] =
+    {
+        READ_BUFFER_INITIAL_SIZE - 1U, READ_BUFFER_INITIAL_SIZE, ( 3U * READ_BUFFER_INITIAL_SIZE ) + 17U
+    };
+    static const size_t paddedLines[] = { 0U, 3U, TABLE_ENTRY_COUNT };
+    size_t lengthIndex = 0U, lineIndex = 0U;
+
+    isTableReplaced = true;
+
+    for( lengthIndex = 0U; lengthIndex < ( sizeof( paddedLengths ) / sizeof( paddedLengths[ 0 ] ) ); lengthIndex++ )
+    {
+        for( lineIndex = 0U; lineIndex < ( sizeof( paddedLines ) / sizeof( paddedLines[ 0 ] ) ); lineIndex++ )
+        {
+            /* Start each table with a buffer of the initial size. */
+            CloseMetricsCollector();
+            ( void ) writeSocketTable( paddedLines[ lineIndex ], paddedLengths[ lengthIndex ], true );
+
+            checkSocketTable();
+            checkSocketTable();
+        }
+    }
+}
+
+/**
+ * @brief Reads a socket table, with a long line and no newline at its end,
+ * through reads shortened to a few sizes, some of them interrupted, and
+ * checks that every read up to the end of the file was made and that the
+ * entries read are those of the table.
+ */
+void test_MetricsCollector_SocketTable_ShortReads( void )
+{
+    static const size_t readLimits[] = { 1U, 7U, 150U, READ_BUFFER_INITIAL_SIZE - 1U };
+    size_t limitIndex = 0U, fileSize = 0U;
+    uint32_t interruptInterval = 0U;
+
+    isTableReplaced = true;
+    fileSize = writeSocketTable( 2U, READ_BUFFER_INITIAL_SIZE + 100U, false );
+
+    for( limitIndex = 0U; limitIndex < ( sizeof( readLimits ) / sizeof( readLimits[ 0 ] ) ); limitIndex++ )
+    {
+        for( interruptInterval = 0U; interruptInterval <= 3U; interruptInterval += 3U )
+        {
+            CloseMetricsCollector();
+            preadLimit = readLimits[ limitIndex ];
+            preadInterruptInterval = interruptInterval;
+            preadCallCount = 0U;
+
+            checkSocketTable();
+
+            /* Every short read is followed by another, until an empty one. */
+            TEST_ASSERT_GREATER_OR_EQUAL( ( fileSize / readLimits[ limitIndex ] ) + 1U, preadCallCount );
+        }
+    }
+}
+
+/**
+ * @brief Opens 10,000 sockets, and compares the time of collecting the open
+ * TCP ports and established connections of a report with that of reading
+ * /proc/net/tcp twice with fopen, fgets and sscanf, as the metrics collector
+ * did before, both for full counts and for the output arrays of the demo.
+ */
+void test_MetricsCollector_SocketTable_CollectionTime( void )
+{
+    static int sockets[ ( 2U * BENCHMARK_CONNECTIONS ) + 1U ];
+    uint16_t ports[ REPORT_ARRAY_LENGTH ];
+    Connection_t connections[ REPORT_ARRAY_LENGTH ];
+    struct rlimit fileLimit;
+    struct timespec start;
+    uint32_t portCount = 0U, connectionCount = 0U, stdioPortCount = 0U, stdioConnectionCount = 0U;
+    uint32_t round = 0U;
+    long fullUs = 0L, reportUs = 0L, stdioUs = 0L;
+    bool isOpen = false;
+
+    ( void ) memset( sockets, -1, sizeof( sockets ) );
+
+    TEST_ASSERT_EQUAL( 0, getrlimit( RLIMIT_NOFILE, &fileLimit ) );
+
+    if( fileLimit.rlim_cur < ( rlim_t ) ( sizeof( sockets ) / sizeof( sockets[ 0 ] ) + 64U ) )
+    {
+        fileLimit.rlim_cur = fileLimit.rlim_max;
+        ( void ) setrlimit( RLIMIT_NOFILE, &fileLimit );
+    }
+
+    isOpen = openSockets( sockets );
+
+    if( isOpen == true )
+    {
+        for( round = 0U; round < COLLECTION_ROUNDS; round++ )
+        {
+            ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+            TEST_ASSERT_EQUAL( MetricsCollectorSuccess,
+                               GetOpenTcpPortsAndEstablishedConnections( NULL, 0U, &portCount,
+                                                                         NULL, 0U, &connectionCount ) );
+            fullUs += elapsedUs( &start );
+
+            ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+            TEST_ASSERT_EQUAL( MetricsCollectorSuccess,
+                               GetOpenTcpPortsAndEstablishedConnections( ports, REPORT_ARRAY_LENGTH, &portCount,
+                                                                         connections, REPORT_ARRAY_LENGTH, &connectionCount ) );
+            reportUs += elapsedUs( &start );
+
+            ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+            stdioPortCount = countEntriesWithStdio( STATE_LISTEN );
+            stdioConnectionCount = countEntriesWithStdio( STATE_ESTABLISHED );
+            stdioUs += elapsedUs( &start );
+        }
+
+        /* The full counts, collected last. */
+        TEST_ASSERT_EQUAL( MetricsCollectorSuccess,
+                           GetOpenTcpPortsAndEstablishedConnections( NULL, 0U, &portCount,
+                                                                     NULL, 0U, &connectionCount ) );
+    }
+
+    closeSockets( sockets );
+
+    if( isOpen == false )
+    {
+        TEST_IGNORE_MESSAGE( "Could not open 10,000 sockets." );
+    }
+
+    LogInfo( ( "/proc/net/tcp with %u listening ports and %u established connections: "
+               "%ld us for full counts, %ld us for arrays of %u, %ld us with fopen, fgets and sscanf.",
+               ( unsigned int ) portCount,
+               ( unsigned int ) connectionCount,
+               fullUs / ( long ) COLLECTION_ROUNDS,
+               reportUs / ( long ) COLLECTION_ROUNDS,
+               ( unsigned int ) REPORT_ARRAY_LENGTH,
+               stdioUs / ( long ) COLLECTION_ROUNDS ) );
+
+    /* Other processes may open or close sockets between the reads, so the
+     * counts are checked against those of the benchmark only. */
+    TEST_ASSERT_GREATER_OR_EQUAL( 1U, portCount );
+    TEST_ASSERT_GREATER_OR_EQUAL( 1U, stdioPortCount );
+    TEST_ASSERT_GREATER_OR_EQUAL( 2U * BENCHMARK_CONNECTIONS, connectionCount );
+    TEST_ASSERT_GREATER_OR_EQUAL( 2U * BENCHMARK_CONNECTIONS, stdioConnectionCount );
+}
@@ -0,0 +1,973 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file credential_manager_test.c
+ * @brief Tests of the credential manager of the S3 download demo against a
+ * stand-in for the AWS IoT credential provider on the loopback interface,
+ * which issues credentials that expire within seconds.
+ */
+
+/* Standard header includes. */
+#include <string.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+/* POSIX includes. */
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/* OpenSSL includes. */
+#include <openssl/ssl.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#include <openssl/x509v3.h>
+
+/* Include config file before other non-system includes. The test takes
+ * the settings of the S3 utilities of the demo, so that the stand-in serves
+ * the endpoint, port and certificates the credential manager uses. */
+#include "demo_config.h"
+
+/* Unity testing framework includes. */
+#include "unity.h"
+
+/* Include OpenSSL implementation of transport interface. */
+#include "openssl_posix.h"
+
+/* Include the S3 utilities of the S3 download demo. */
+#include "http_demo_s3_utils.h"
+
+/**
+ * @brief Address the credential provider stand-in listens on, which
+ * AWS_IOT_CREDENTIAL_PROVIDER_ENDPOINT resolves to.
+ */
+#define SERVER_ADDRESS                   "127.0.0.1"
+
+/**
+ * @brief Path of the requests for credentials, as sent by the demo.
+ */
+#define CREDENTIALS_PATH                 "/role-aliases/" AWS_IOT_CREDENTIAL_PROVIDER_ROLE "/credentials"
+
+/**
+ * @brief Header carrying the thing name of the requests for credentials.
+ */
+#define THING_NAME_HEADER                "\r\nx-amzn-iot-thingname: " AWS_IOT_THING_NAME "\r\n"
+
+/**
+ * @brief Seconds the credentials of the refresh test are valid for.
+ *
+ * The manager refreshes them 4 seconds before they expire, plus a jitter of
+ * up to 2 seconds, and stops handing them out 2 seconds before they expire.
+ */
+#define REFRESH_TEST_LIFETIME_S          ( 8 )
+
+/**
+ * @brief Seconds the credentials of the jitter and concurrency tests are
+ * valid for.
+ *
+ * The manager refreshes them 2 seconds before they expire, plus a jitter of
+ * up to 1 second, and stops handing them out 1 second before they expire.
+ */
+#define SHORT_LIFETIME_S                 ( 4 )
+
+/**
+ * @brief Seconds the refresh and jitter tests watch the manager for.
+ */
+#define WATCH_DURATION_S                 ( 10 )
+
+/**
+ * @brief Milliseconds the stand-in delays its responses to refreshes in the
+ * concurrency test, so that the credentials pass their expiry guard while the
+ * refresh is in flight.
+ */
+#define SLOW_REFRESH_DELAY_MS            ( 3000U )
+
+/**
+ * @brief Number of threads getting credentials at once.
+ */
+#define GETTER_COUNT                     ( 16U )
+
+/**
+ * @brief Milliseconds between two gets of a thread.
+ */
+#define GET_INTERVAL_MS                  ( 10U )
+
+/**
+ * @brief Milliseconds a get lasts at least when it waited for a refresh.
+ */
+#define WAITED_GET_MS                    ( 200L )
+
+/**
+ * @brief Most requests for credentials recorded by the stand-in.
+ */
+#define MAX_REQUESTS                     ( 64U )
+
+/**
+ * @brief Size of the buffer receiving the headers of a request.
+ */
+#define REQUEST_BUFFER_SIZE              ( 4096U )
+
+/**
+ * @brief Size of the buffer of a response.
+ */
+#define RESPONSE_BUFFER_SIZE             ( 1024U )
+
+/**
+ * @brief Milliseconds the stand-in waits for a connection before checking
+ * whether it must stop.
+ */
+#define SERVER_POLL_TIMEOUT_MS           ( 100 )
+
+/**
+ * @brief Nanoseconds per millisecond.
+ */
+#define NANOSECONDS_PER_MILLISECOND      ( 1000000L )
+
+/**
+ * @brief Milliseconds per second.
+ */
+#define MILLISECONDS_PER_SECOND          ( 1000L )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Each compilation unit must define the NetworkContext struct.
+ */
+struct NetworkContext
+{
+    OpensslParams_t * pParams;
+};
+
+/**
+ * @brief A request for credentials received by the stand-in.
+ */
+typedef struct IssuedCredentials
+{
+    struct timespec requestTime; /**< @brief When the request was received, on the real-time clock. */
+    time_t expiration;           /**< @brief When the credentials issued for it expire. */
+} IssuedCredentials_t;
+
+/**
+ * @brief A thread getting credentials in the concurrency test.
+ */
+typedef struct Getter
+{
+    pthread_t thread;                   /**< @brief The thread. */
+    TemporaryCredentials_t credentials; /**< @brief The last credentials it got. */
+    uint32_t gets;                      /**< @brief Number of gets. */
+    uint32_t failures;                  /**< @brief Number of gets that failed. */
+    uint32_t waitedGets;                /**< @brief Number of gets that waited for a refresh. */
+    long longestGetMs;                  /**< @brief Milliseconds of the longest get. */
+} Getter_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief TLS context of the stand-in, created by the first test.
+ */
+static SSL_CTX * pServerContext = NULL;
+
+/**
+ * @brief Listening socket of the stand-in.
+ */
+static int serverSocket = -1;
+
+/**
+ * @brief Thread accepting the connections of the stand-in.
+ */
+static pthread_t serverThread;
+
+/**
+ * @brief Set to stop the stand-in.
+ */
+static uint32_t isServerStopping = 0U;
+
+/**
+ * @brief Number of connections the stand-in is serving.
+ */
+static uint32_t activeConnections = 0U;
+
+/**
+ * @brief Seconds the credentials issued by the stand-in are valid for.
+ */
+static time_t credentialLifetime = REFRESH_TEST_LIFETIME_S;
+
+/**
+ * @brief Milliseconds the stand-in delays the responses after the first.
+ */
+static uint32_t refreshDelayMs = 0U;
+
+/**
+ * @brief The requests for credentials received by the stand-in, guarded by
+ * #requestLock.
+ */
+static IssuedCredentials_t requests[ MAX_REQUESTS ];
+
+/**
+ * @brief Number of #requests.
+ */
+static uint32_t requestCount = 0U;
+
+/**
+ * @brief Guards #requests and #requestCount.
+ */
+static pthread_mutex_t requestLock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief The credential manager under test.
+ */
+static CredentialManager_t manager;
+
+/**
+ * @brief TLS state of the connection of the manager.
+ */
+static OpensslParams_t opensslParams;
+
+/**
+ * @brief Network context of the connection of the manager.
+ */
+static NetworkContext_t networkContext;
+
+/**
+ * @brief Monotonic time the getters stop at.
+ */
+static struct timespec getterDeadline;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Create a self-signed certificate for localhost, and write it and,
+ * optionally, its key to files.
+ *
+ * @param[in] pCertFileName Path of the certificate file.
+ * @param[in] pKeyFileName Path of the key file, or NULL.
+ * @param[out] ppKey The key of the certificate.
+ *
+ * @return The certificate, or NULL on failure.
+ */
+static X509 * createCertificate( const char * pCertFileName,
+                                 const char * pKeyFileName,
+                                 EVP_PKEY ** ppKey );
+
+/**
+ * @brief Add an X509v3 extension to a certificate.
+ *
+ * @param[in] pCert The certificate.
+ * @param[in] nid The extension.
+ * @param[in] pValue The value of the extension.
+ *
+ * @return true if the extension was added.
+ */
+static bool addExtension( X509 * pCert,
+                          int nid,
+                          const char * pValue );
+
+/**
+ * @brief Accept the connections to the stand-in, each served by a thread.
+ *
+ * @param[in] pArgs Unused.
+ *
+ * @return NULL.
+ */
+static void * serverRoutine( void * pArgs );
+
+/**
+ * @brief Serve the requests of a connection to the stand-in until the client
+ * closes it.
+ *
+ * @param[in] pArgs The socket of the connection.
+ *
+ * @return NULL.
+ */
+static void * connectionRoutine( void * pArgs );
+
+/**
+ * @brief Issue credentials in response to a request.
+ *
+ * @param[in] pSsl The connection.
+ * @param[in] pRequest The request headers, terminated by a null character.
+ *
+ * @return true if the response was sent.
+ */
+static bool sendCredentials( SSL * pSsl,
+                             const char * pRequest );
+
+/**
+ * @brief Start the stand-in on #HTTPS_PORT.
+ *
+ * @param[in] lifetime Seconds the credentials it issues are valid for.
+ * @param[in] delayMs Milliseconds it delays the responses after the first.
+ */
+static void startServer( time_t lifetime,
+                         uint32_t delayMs );
+
+/**
+ * @brief Get credentials in a loop until #getterDeadline, or until they are
+ * of the second generation.
+ *
+ * @param[in] pArgs The #Getter_t of the thread.
+ *
+ * @return NULL.
+ */
+static void * getterRoutine( void * pArgs );
+
+/**
+ * @brief Seconds of the credential provider's clock in the date of
+ * credentials.
+ *
+ * @param[in] pCredentials The credentials.
+ *
+ * @return The date, in seconds since the epoch.
+ */
+static time_t credentialsDate( const TemporaryCredentials_t * pCredentials );
+
+/**
+ * @brief Milliseconds from one time to another.
+ *
+ * @param[in] pStart The first time.
+ * @param[in] pEnd The second time.
+ *
+ * @return Milliseconds elapsed.
+ */
+static long millisecondsBetween( const struct timespec * pStart,
+                                 const struct timespec * pEnd );
+
+/**
+ * @brief Milliseconds elapsed since a time of the monotonic clock.
+ *
+ * @param[in] pStart The time.
+ *
+ * @return Milliseconds elapsed.
+ */
+static long millisecondsSince( const struct timespec * pStart );
+
+/*-----------------------------------------------------------*/
+
+static bool addExtension( X509 * pCert,
+                          int nid,
+                          const char * pValue )
+{
+    X509V3_CTX context;
+    X509_EXTENSION * pExtension = NULL;
+    bool isAdded = false;
+
+    X509V3_set_ctx_nodb( &context );
+    X509V3_set_ctx( &context, pCert, pCert, NULL, NULL, 0 );
+    pExtension = X509V3_EXT_nconf_nid( NULL, &context, nid, pValue );
+
+    if( pExtension != NULL )
+    {
+        isAdded = ( 1 == X509_add_ext( pCert, pExtension, -1 ) );
+        X509_EXTENSION_free( pExtension );
+    }
+
+    return isAdded;
+}
+
+/*-----------------------------------------------------------*/
+
+static X509 * createCertificate( const char * pCertFileName,
+                                 const char * pKeyFileName,
+                                 EVP_PKEY ** ppKey )
+{
+    EVP_PKEY * pKey = NULL;
+    EVP_PKEY_CTX * pKeyContext = NULL;
+    X509 * pCert = NULL;
+    X509_NAME * pName = NULL;
+    FILE * pCertFile = NULL;
+    FILE * pKeyFile = NULL;
+    bool isCreated = false;
+
+    pKeyContext = EVP_PKEY_CTX_new_id( EVP_PKEY_EC, NULL );
+
+    if( ( pKeyContext != NULL ) &&
+        ( 1 == EVP_PKEY_keygen_init( pKeyContext ) ) &&
+        ( 1 == EVP_PKEY_CTX_set_ec_paramgen_curve_nid( pKeyContext, NID_X9_62_prime256v1 ) ) &&
+        ( 1 == EVP_PKEY_keygen( pKeyContext, &pKey ) ) )
+    {
+        pCert = X509_new();
+    }
+
+    if( pCert != NULL )
+    {
+        pName = X509_get_subject_name( pCert );
+
+        if( ( 1 == X509_set_version( pCert, 2 ) ) &&
+            ( 1 == ASN1_INTEGER_set( X509_get_serialNumber( pCert ), 1 ) ) &&
+            ( NULL != X509_gmtime_adj( X509_getm_notBefore( pCert ), 0 ) ) &&
+            ( NULL != X509_gmtime_adj( X509_getm_notAfter( pCert ), 3600L ) ) &&
+            ( 1 == X509_NAME_add_entry_by_txt( pName, "CN", MBSTRING_ASC,
+                                               ( const unsigned char * ) AWS_IOT_CREDENTIAL_PROVIDER_ENDPOINT, -1, -1, 0 ) ) &&
+            ( 1 == X509_set_issuer_name( pCert, pName ) ) &&
+            ( 1 == X509_set_pubkey( pCert, pKey ) ) &&
+            ( addExtension( pCert, NID_basic_constraints, "critical,CA:TRUE" ) == true ) &&
+            ( addExtension( pCert, NID_key_usage, "critical,digitalSignature,keyCertSign" ) == true ) &&
+            ( addExtension( pCert, NID_subject_key_identifier, "hash" ) == true ) &&
+            ( addExtension( pCert, NID_authority_key_identifier, "keyid:always" ) == true ) &&
+            ( addExtension( pCert, NID_subject_alt_name,
+                            "DNS:" AWS_IOT_CREDENTIAL_PROVIDER_ENDPOINT ",IP:" SERVER_ADDRESS ) == true ) &&
+            ( 0 < X509_sign( pCert, pKey, EVP_sha256() ) ) )
+        {
+            pCertFile = fopen( pCertFileName, "w" );
+        }
+    }
+
+    if( pCertFile != NULL )
+    {
+        isCreated = ( 1 == PEM_write_X509( pCertFile, pCert ) );
+        isCreated = ( fclose( pCertFile ) == 0 ) && isCreated;
+    }
+
+    if( ( isCreated == true ) && ( pKeyFileName != NULL ) )
+    {
+        pKeyFile = fopen( pKeyFileName, "w" );
+        isCreated = ( pKeyFile != NULL ) &&
+                    ( 1 == PEM_write_PrivateKey( pKeyFile, pKey, NULL, NULL, 0, NULL, NULL ) );
+        isCreated = ( pKeyFile != NULL ) && ( fclose( pKeyFile ) == 0 ) && isCreated;
+    }
+
+    if( isCreated == false )
+    {
+        X509_free( pCert );
+        pCert = NULL;
+        EVP_PKEY_free( pKey );
+        pKey = NULL;
+    }
+
+    EVP_PKEY_CTX_free( pKeyContext );
+    *ppKey = pKey;
+
+    return pCert;
+}
+
+/*-----------------------------------------------------------*/
+
+static void * serverRoutine( void * pArgs )
+{
+    struct pollfd pollFd;
+    pthread_t thread;
+    pthread_attr_t attributes;
+    intptr_t connection = -1;
+
+    ( void ) pArgs;
+
+    ( void ) pthread_attr_init( &attributes );
+    ( void ) pthread_attr_setdetachstate( &attributes, PTHREAD_CREATE_DETACHED );
+
+    pollFd.fd = serverSocket;
+    pollFd.events = POLLIN;
+
+    while( __atomic_load_n( &isServerStopping, __ATOMIC_ACQUIRE ) == 0U )
+    {
+        if( poll( &pollFd, 1, SERVER_POLL_TIMEOUT_MS ) > 0 )
+        {
+            connection = accept( serverSocket, NULL, NULL );
+
+            if( connection >= 0 )
+            {
+                __atomic_add_fetch( &activeConnections, 1U, __ATOMIC_ACQ_REL );
+
+                if( pthread_create( &thread, &attributes, connectionRoutine, ( void * ) connection ) != 0 )
+                {
+                    ( void ) close( ( int ) connection );
+                    __atomic_sub_fetch( &activeConnections, 1U, __ATOMIC_ACQ_REL );
+                }
+            }
+        }
+    }
+
+    ( void ) pthread_attr_destroy( &attributes );
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static void * connectionRoutine( void * pArgs )
+{
+    int connection = ( int ) ( intptr_t ) pArgs;
+    SSL * pSsl = NULL;
+    char request[ REQUEST_BUFFER_SIZE + 1U ];
+    size_t received = 0U;
+    char * pEnd = NULL;
+    int result = 0;
+    bool isOpen = true;
+
+    pSsl = SSL_new( pServerContext );
+
+    if( ( pSsl != NULL ) &&
+        ( 1 == SSL_set_fd( pSsl, connection ) ) &&
+        ( 1 == SSL_accept( pSsl ) ) )
+    {
+        while( isOpen == true )
+        {
+            request[ received ] = '\0';
+            pEnd = strstr( request, "\r\n\r\n" );
+
+            if( pEnd != NULL )
+            {
+                /* The requests have no body. */
+                pEnd += sizeof( "\r\n\r\n" ) - 1U;
+                isOpen = sendCredentials( pSsl, request );
+                received -= ( size_t ) ( pEnd - request );
+                ( void ) memmove( request, pEnd, received );
+            }
+            else if( received == REQUEST_BUFFER_SIZE )
+            {
+                isOpen = false;
+            }
+            else
+            {
+                result = SSL_read( pSsl, &request[ received ], ( int ) ( REQUEST_BUFFER_SIZE - received ) );
+
+                if( result > 0 )
+                {
+                    received += ( size_t ) result;
+                }
+                else
+                {
+                    isOpen = false;
+                }
+            }
+        }
+    }
+
+    SSL_free( pSsl );
+    ( void ) close( connection );
+    __atomic_sub_fetch( &activeConnections, 1U, __ATOMIC_ACQ_REL );
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool sendCredentials( SSL * pSsl,
+                             const char * pRequest )
+{
+    char response[ RESPONSE_BUFFER_SIZE ];
+    char body[ RESPONSE_BUFFER_SIZE ];
+    char date[ sizeof( "Thu, 01 Jan 1970 00:00:00 GMT" ) ];
+    char expirationDate[ sizeof( "1970-01-01T00:00:00Z" ) ];
+    struct timespec requestTime;
+    struct tm fields;
+    time_t expiration = 0;
+    uint32_t sequence = 0U;
+    int bodyLength = 0;
+    int responseLength = 0;
+    bool isSent = false;
+
+    ( void ) clock_gettime( CLOCK_REALTIME, &requestTime );
+
+    ( void ) pthread_mutex_lock( &requestLock );
+    sequence = requestCount;
+
+    if( requestCount < MAX_REQUESTS )
+    {
+        requests[ requestCount ].requestTime = requestTime;
+        requestCount++;
+    }
+
+    ( void ) pthread_mutex_unlock( &requestLock );
+
+    if( ( sequence > 0U ) && ( refreshDelayMs > 0U ) )
+    {
+        ( void ) usleep( refreshDelayMs * 1000U );
+        ( void ) clock_gettime( CLOCK_REALTIME, &requestTime );
+    }
+
+    /* The credentials are dated and expire from the time of the response,
+     * as the Date header of the credential provider. */
+    expiration = requestTime.tv_sec + credentialLifetime;
+    ( void ) gmtime_r( &requestTime.tv_sec, &fields );
+    ( void ) strftime( date, sizeof( date ), "%a, %d %b %Y %H:%M:%S GMT", &fields );
+    ( void ) gmtime_r( &expiration, &fields );
+    ( void ) strftime( expirationDate, sizeof( expirationDate ), "%Y-%m-%dT%H:%M:%SZ", &fields );
+
+    if( sequence < MAX_REQUESTS )
+    {
+        ( void ) pthread_mutex_lock( &requestLock );
+        requests[ sequence ].expiration = expiration;
+        ( void ) pthread_mutex_unlock( &requestLock );
+    }
+
+    if( ( strncmp( pRequest, "GET " CREDENTIALS_PATH " HTTP/1.1\r\n", sizeof( "GET " CREDENTIALS_PATH " HTTP/1.1\r\n" ) - 1U ) == 0 ) &&
+        ( strstr( pRequest, THING_NAME_HEADER ) != NULL ) )
+    {
+        bodyLength = snprintf( body, sizeof( body ),
+                               "{\"credentials\":{\"accessKeyId\":\"ASIA%016u\","
+                               "\"secretAccessKey\":\"secret-%u\","
+                               "\"sessionToken\":\"token-%u\","
+                               "\"expiration\":\"%s\"}}",
+                               ( unsigned ) sequence, ( unsigned ) sequence, ( unsigned ) sequence, expirationDate );
+        responseLength = snprintf( response, sizeof( response ),
+                                   "HTTP/1.1 200 OK\r\n"
+                                   "Date: %s\r\n"
+                                   "Content-Type: application/json\r\n"
+                                   "Content-Length: %d\r\n\r\n%s",
+                                   date, bodyLength, body );
+    }
+    else
+    {
+        responseLength = snprintf( response, sizeof( response ),
+                                   "HTTP/1.1 403 Forbidden\r\n"
+                                   "Date: %s\r\n"
+                                   "Content-Length: 0\r\n\r\n",
+                                   date );
+    }
+
+    if( ( responseLength > 0 ) && ( ( size_t ) responseLength < sizeof( response ) ) )
+    {
+        isSent = ( SSL_write( pSsl, response, responseLength ) == responseLength );
+    }
+
+    return isSent;
+}
+
+/*-----------------------------------------------------------*/
+
+static void startServer( time_t lifetime,
+                         uint32_t delayMs )
+{
+    struct sockaddr_in address = { 0 };
+    int reuse = 1;
+
+    credentialLifetime = lifetime;
+    refreshDelayMs = delayMs;
+
+    serverSocket = socket( AF_INET, SOCK_STREAM, 0 );
+    TEST_ASSERT_GREATER_OR_EQUAL( 0, serverSocket );
+    ( void ) setsockopt( serverSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof( reuse ) );
+
+    address.sin_family = AF_INET;
+    address.sin_port = htons( HTTPS_PORT );
+    address.sin_addr.s_addr = inet_addr( SERVER_ADDRESS );
+    TEST_ASSERT_EQUAL( 0, bind( serverSocket, ( struct sockaddr * ) &address, sizeof( address ) ) );
+    TEST_ASSERT_EQUAL( 0, listen( serverSocket, 4 ) );
+
+    TEST_ASSERT_EQUAL( 0, pthread_create( &serverThread, NULL, serverRoutine, NULL ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static void * getterRoutine( void * pArgs )
+{
+    Getter_t * pGetter = ( Getter_t * ) pArgs;
+    struct timespec start;
+    struct timespec end;
+    long elapsedMs = 0L;
+    bool isDone = false;
+
+    while( isDone == false )
+    {
+        ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+
+        if( credentialManagerGet( &manager, &pGetter->credentials ) == false )
+        {
+            pGetter->failures++;
+        }
+
+        ( void ) clock_gettime( CLOCK_MONOTONIC, &end );
+        elapsedMs = millisecondsBetween( &start, &end );
+        pGetter->gets++;
+        pGetter->waitedGets += ( elapsedMs >= WAITED_GET_MS ) ? 1U : 0U;
+        pGetter->longestGetMs = ( elapsedMs > pGetter->longestGetMs ) ? elapsedMs : pGetter->longestGetMs;
+
+        isDone = ( pGetter->credentials.generation >= 2U ) ||
+                 ( millisecondsBetween( &getterDeadline, &end ) >= 0L );
+
+        ( void ) usleep( GET_INTERVAL_MS * 1000U );
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static time_t credentialsDate( const TemporaryCredentials_t * pCredentials )
+{
+    struct tm fields;
+
+    ( void ) memset( &fields, 0, sizeof( fields ) );
+    TEST_ASSERT_EQUAL( 6, sscanf( pCredentials->dateISO8601, "%4d%2d%2dT%2d%2d%2dZ",
+                                  &fields.tm_year, &fields.tm_mon, &fields.tm_mday,
+                                  &fields.tm_hour, &fields.tm_min, &fields.tm_sec ) );
+    fields.tm_year -= 1900;
+    fields.tm_mon -= 1;
+
+    return timegm( &fields );
+}
+
+/*-----------------------------------------------------------*/
+
+static long millisecondsBetween( const struct timespec * pStart,
+                                 const struct timespec * pEnd )
+{
+    return ( ( pEnd->tv_sec - pStart->tv_sec ) * MILLISECONDS_PER_SECOND ) +
+           ( ( pEnd->tv_nsec - pStart->tv_nsec ) / NANOSECONDS_PER_MILLISECOND );
+}
+
+/*-----------------------------------------------------------*/
+
+static long millisecondsSince( const struct timespec * pStart )
+{
+    struct timespec now;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return millisecondsBetween( pStart, &now );
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    EVP_PKEY * pKey = NULL;
+    X509 * pCert = NULL;
+
+    /* A refresh may write to a connection the stand-in has closed. */
+    ( void ) signal( SIGPIPE, SIG_IGN );
+
+    if( pServerContext == NULL )
+    {
+        /* The client certificate is self-signed, and trusted by the
+         * stand-in, which requires it. */
+        pCert = createCertificate( CLIENT_CERT_PATH, CLIENT_PRIVATE_KEY_PATH, &pKey );
+        TEST_ASSERT_NOT_NULL( pCert );
+        X509_free( pCert );
+        EVP_PKEY_free( pKey );
+
+        pCert = createCertificate( ROOT_CA_CERT_PATH, NULL, &pKey );
+        TEST_ASSERT_NOT_NULL( pCert );
+
+        pServerContext = SSL_CTX_new( TLS_server_method() );
+        TEST_ASSERT_NOT_NULL( pServerContext );
+        TEST_ASSERT_EQUAL( 1, SSL_CTX_use_certificate( pServerContext, pCert ) );
+        TEST_ASSERT_EQUAL( 1, SSL_CTX_use_PrivateKey( pServerContext, pKey ) );
+        TEST_ASSERT_EQUAL( 1, SSL_CTX_load_verify_locations( pServerContext, CLIENT_CERT_PATH, NULL ) );
+        SSL_CTX_set_verify( pServerContext, SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT, NULL );
+        X509_free( pCert );
+        EVP_PKEY_free( pKey );
+    }
+
+    ( void ) memset( requests, 0, sizeof( requests ) );
+    requestCount = 0U;
+    __atomic_store_n( &isServerStopping, 0U, __ATOMIC_RELEASE );
+
+    ( void ) memset( &opensslParams, 0, sizeof( opensslParams ) );
+    networkContext.pParams = &opensslParams;
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+    __atomic_store_n( &isServerStopping, 1U, __ATOMIC_RELEASE );
+    ( void ) pthread_join( serverThread, NULL );
+    ( void ) close( serverSocket );
+    serverSocket = -1;
+
+    /* The connection threads end when the clients close their connections. */
+    while( __atomic_load_n( &activeConnections, __ATOMIC_ACQUIRE ) > 0U )
+    {
+        ( void ) usleep( 1000U );
+    }
+}
+
+/* ========================== Test Cases ============================ */
+
+/**
+ * @brief The manager refreshes short-lived credentials before they expire,
+ * by the refresh margin and jitter, and the copies it hands out in the
+ * meantime are never expired.
+ */
+void test_CredentialManager_RefreshesBeforeExpiry( void )
+{
+    TemporaryCredentials_t credentials;
+    struct timespec start;
+    uint32_t gets = 0U;
+    uint32_t index = 0U;
+    double secondsLeft = 0.0;
+    double fewestSecondsLeft = ( double ) REFRESH_TEST_LIFETIME_S;
+    double mostSecondsLeft = 0.0;
+
+    /* Margin of 4 seconds, jitter of up to 2, guard of 2. */
+    const double margin = ( double ) REFRESH_TEST_LIFETIME_S / 2.0;
+    const double jitter = ( double ) REFRESH_TEST_LIFETIME_S / 4.0;
+    const double guard = ( double ) REFRESH_TEST_LIFETIME_S / 4.0;
+
+    startServer( REFRESH_TEST_LIFETIME_S, 0U );
+    TEST_ASSERT_TRUE( credentialManagerInit( &manager, &networkContext ) );
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+
+    while( millisecondsSince( &start ) < ( WATCH_DURATION_S * MILLISECONDS_PER_SECOND ) )
+    {
+        TEST_ASSERT_TRUE( credentialManagerGet( &manager, &credentials ) );
+        TEST_ASSERT_LESS_THAN( credentials.expiration - ( time_t ) guard, credentialsDate( &credentials ) );
+        gets++;
+        ( void ) usleep( GET_INTERVAL_MS * 1000U );
+    }
+
+    credentialManagerCleanup( &manager );
+
+    /* The credentials were refreshed every 2 to 4 seconds. */
+    TEST_ASSERT_GREATER_OR_EQUAL( 3U, requestCount );
+
+    for( index = 1U; index < requestCount; index++ )
+    {
+        /* Seconds the previous credentials had left at the refresh, within
+         * a second either way, as the Date header and the monotonic clock
+         * of the manager are in whole seconds. */
+        secondsLeft = ( double ) requests[ index - 1U ].expiration -
+                      ( ( double ) requests[ index ].requestTime.tv_sec +
+                        ( ( double ) requests[ index ].requestTime.tv_nsec / 1e9 ) );
+
+        TEST_ASSERT_TRUE( secondsLeft > guard );
+        TEST_ASSERT_TRUE( secondsLeft >= margin - 1.0 );
+        TEST_ASSERT_TRUE( secondsLeft <= margin + jitter + 1.0 );
+
+        fewestSecondsLeft = ( secondsLeft < fewestSecondsLeft ) ? secondsLeft : fewestSecondsLeft;
+        mostSecondsLeft = ( secondsLeft > mostSecondsLeft ) ? secondsLeft : mostSecondsLeft;
+    }
+
+    LogInfo( ( "%u gets over %d s of %d s credentials: %u refreshes, between %.2f and %.2f s before expiry.",
+               ( unsigned ) gets, WATCH_DURATION_S, REFRESH_TEST_LIFETIME_S,
+               ( unsigned ) ( requestCount - 1U ), fewestSecondsLeft, mostSecondsLeft ) );
+}
+
+/**
+ * @brief The jitter of every refresh is within its bounds: the manager plans
+ * each refresh between the margin and the margin plus a quarter of the
+ * lifetime before expiry.
+ */
+void test_CredentialManager_JitterWithinBounds( void )
+{
+    struct timespec start;
+    uint32_t generation = 0U;
+    uint32_t samples = 0U;
+    uint32_t histogram[ ( SHORT_LIFETIME_S / 4 ) + 1 ] = { 0U };
+    time_t lifetime = 0;
+    time_t jitter = 0;
+
+    startServer( SHORT_LIFETIME_S, 0U );
+    TEST_ASSERT_TRUE( credentialManagerInit( &manager, &networkContext ) );
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+
+    while( millisecondsSince( &start ) < ( WATCH_DURATION_S * MILLISECONDS_PER_SECOND ) )
+    {
+        ( void ) pthread_mutex_lock( &manager.lock );
+
+        if( ( manager.isRefreshing == false ) && ( manager.credentials.generation != generation ) )
+        {
+            generation = manager.credentials.generation;
+            lifetime = manager.credentials.expiration - manager.fetchDate;
+
+            /* refreshTime = fetchTime + lifetime - margin - jitter, with a
+             * margin of half the lifetime for short-lived credentials. */
+            jitter = ( manager.fetchTime + lifetime - ( lifetime / 2 ) ) - manager.refreshTime;
+
+            TEST_ASSERT_EQUAL( SHORT_LIFETIME_S, lifetime );
+            TEST_ASSERT_GREATER_OR_EQUAL( 0, jitter );
+            TEST_ASSERT_LESS_OR_EQUAL( lifetime / 4, jitter );
+            TEST_ASSERT_EQUAL( manager.fetchTime + lifetime - ( lifetime / 4 ), manager.expiryTime );
+
+            histogram[ jitter ]++;
+            samples++;
+        }
+
+        ( void ) pthread_mutex_unlock( &manager.lock );
+        ( void ) usleep( GET_INTERVAL_MS * 1000U );
+    }
+
+    credentialManagerCleanup( &manager );
+
+    /* Refreshes every 1 to 2 seconds. */
+    TEST_ASSERT_GREATER_OR_EQUAL( 4U, samples );
+
+    LogInfo( ( "%u refreshes of %d s credentials: jitter of 0 s %u times, of 1 s %u times.",
+               ( unsigned ) samples, SHORT_LIFETIME_S, ( unsigned ) histogram[ 0 ], ( unsigned ) histogram[ 1 ] ) );
+}
+
+/**
+ * @brief Threads that need credentials past their expiry guard while a slow
+ * refresh is in flight wait for that refresh, rather than each sending its
+ * own request: the credential provider sees a single refresh.
+ */
+void test_CredentialManager_ConcurrentGetsShareOneRefresh( void )
+{
+    Getter_t getters[ GETTER_COUNT ];
+    uint32_t index = 0U;
+    uint32_t gets = 0U;
+    uint32_t waitedGets = 0U;
+    long longestGetMs = 0L;
+
+    ( void ) memset( getters, 0, sizeof( getters ) );
+
+    startServer( SHORT_LIFETIME_S, SLOW_REFRESH_DELAY_MS );
+    TEST_ASSERT_TRUE( credentialManagerInit( &manager, &networkContext ) );
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &getterDeadline );
+    getterDeadline.tv_sec += 2 * SHORT_LIFETIME_S;
+
+    for( index = 0U; index < GETTER_COUNT; index++ )
+    {
+        TEST_ASSERT_EQUAL( 0, pthread_create( &getters[ index ].thread, NULL, getterRoutine, &getters[ index ] ) );
+    }
+
+    for( index = 0U; index < GETTER_COUNT; index++ )
+    {
+        ( void ) pthread_join( getters[ index ].thread, NULL );
+    }
+
+    credentialManagerCleanup( &manager );
+
+    for( index = 0U; index < GETTER_COUNT; index++ )
+    {
+        TEST_ASSERT_EQUAL_UINT32( 0U, getters[ index ].failures );
+        TEST_ASSERT_EQUAL_UINT32( 2U, getters[ index ].credentials.generation );
+
+        /* Every thread got past the expiry guard, and waited for the
+         * refresh in flight. */
+        TEST_ASSERT_GREATER_OR_EQUAL( 1U, getters[ index ].waitedGets );
+
+        gets += getters[ index ].gets;
+        waitedGets += getters[ index ].waitedGets;
+        longestGetMs = ( getters[ index ].longestGetMs > longestGetMs ) ? getters[ index ].longestGetMs : longestGetMs;
+    }
+
+    /* The first fetch and the one refresh all threads shared. */
+    TEST_ASSERT_EQUAL_UINT32( 2U, requestCount );
+
+    LogInfo( ( "%u threads, %u gets, %u of which waited for the refresh, for up to %ld ms; "
+               "%u requests to the credential provider.",
+               ( unsigned ) GETTER_COUNT, ( unsigned ) gets, ( unsigned ) waitedGets, longestGetMs,
+               ( unsigned ) requestCount ) );
+}
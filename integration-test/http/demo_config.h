@@ -0,0 +1,96 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef DEMO_CONFIG_H_
+#define DEMO_CONFIG_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Logging config definition and header files inclusion are required in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define the LIBRARY_LOG_NAME and LIBRARY_LOG_LEVEL macros depending on
+ * the logging configuration for DEMO.
+ * 3. Include the header file "logging_stack.h", if logging is enabled for DEMO.
+ */
+
+#include "logging_levels.h"
+
+/* Logging configuration for the Demo. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME    "DEMO"
+#endif
+
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/**
+ * @brief The AWS IoT credential provider the S3 utilities of the demos
+ * connect to. credential_manager_test serves it on the loopback interface
+ * with a stand-in that issues short-lived credentials.
+ */
+#ifndef AWS_IOT_CREDENTIAL_PROVIDER_ENDPOINT
+    #define AWS_IOT_CREDENTIAL_PROVIDER_ENDPOINT    "localhost"
+#endif
+
+#ifndef AWS_IOT_CREDENTIAL_PROVIDER_ROLE
+    #define AWS_IOT_CREDENTIAL_PROVIDER_ROLE    "s3-test-role"
+#endif
+
+#ifndef AWS_IOT_THING_NAME
+    #define AWS_IOT_THING_NAME    "s3-test-thing"
+#endif
+
+#ifndef HTTPS_PORT
+    #define HTTPS_PORT    8443
+#endif
+
+/**
+ * @brief Paths of the certificates of the connection to the AWS IoT
+ * credential provider.
+ */
+#ifndef ROOT_CA_CERT_PATH
+    #define ROOT_CA_CERT_PATH    "credential_provider_ca.crt"
+#endif
+
+#ifndef CLIENT_CERT_PATH
+    #define CLIENT_CERT_PATH    "credential_provider_client.crt"
+#endif
+
+#ifndef CLIENT_PRIVATE_KEY_PATH
+    #define CLIENT_PRIVATE_KEY_PATH    "credential_provider_client.key"
+#endif
+
+/**
+ * @brief Transport timeout in milliseconds for transport send and receive.
+ */
+#ifndef TRANSPORT_SEND_RECV_TIMEOUT_MS
+    #define TRANSPORT_SEND_RECV_TIMEOUT_MS    ( 5000 )
+#endif
+
+#endif /* ifndef DEMO_CONFIG_H_ */
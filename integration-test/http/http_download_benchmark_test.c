@@ -0,0 +1,1022 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file http_download_benchmark_test.c
+ * @brief Throughput benchmark of the S3 download demo, comparing the message
+ * queue hand-off it used to pass every response from an HTTP thread to the
+ * thread writing the file, with the range download that writes each response
+ * from the buffer it was received in, and measuring the range download over
+ * 1 to #RANGE_DOWNLOAD_MAX_CONNECTIONS connections. Also tests that ranges
+ * the server fails are retried, and that the download is abandoned once a
+ * range fails too often.
+ */
+
+/* Standard header includes. */
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+
+/* POSIX includes. */
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <mqueue.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/* Include config file before other non-system includes. */
+#include "test_config.h"
+
+/* Unity testing framework includes. */
+#include "unity.h"
+
+/* Include plaintext implementation of transport interface. */
+#include "plaintext_posix.h"
+
+/* Include the range download of the S3 download demo. */
+#include "http_demo_range_download.h"
+
+/**
+ * @brief Address the range server listens on.
+ */
+#define SERVER_ADDRESS                  "127.0.0.1"
+
+/**
+ * @brief Length of #SERVER_ADDRESS.
+ */
+#define SERVER_ADDRESS_LENGTH           ( sizeof( SERVER_ADDRESS ) - 1U )
+
+/**
+ * @brief Size of the object served by the range server.
+ */
+#define OBJECT_SIZE                     ( 8U * 1024U * 1024U )
+
+/**
+ * @brief Number of bytes requested by each range request, as in the S3
+ * download demo.
+ */
+#define RANGE_REQUEST_LENGTH            ( 2048U )
+
+/**
+ * @brief Length of the buffer receiving each response, as in the S3 download
+ * demo.
+ */
+#define RESPONSE_BUFFER_LENGTH          ( 4096U )
+
+/**
+ * @brief Number of messages each queue of the hand-off holds, as in the S3
+ * download demo.
+ */
+#define QUEUE_SIZE                      ( 10 )
+
+/**
+ * @brief Names of the queues of the hand-off.
+ */
+#define REQUEST_QUEUE                   "/http_benchmark_request"
+#define RESPONSE_QUEUE                  "/http_benchmark_response"
+
+/**
+ * @brief Number of ranges of the object.
+ */
+#define RANGE_COUNT                     ( OBJECT_SIZE / RANGE_REQUEST_LENGTH )
+
+/**
+ * @brief Number of times the object is downloaded each way. The two ways
+ * alternate, so that both see the same system load.
+ */
+#define DOWNLOAD_ROUNDS                 ( 3U )
+
+/**
+ * @brief Delay of the range server before each response in the second series
+ * of the connection count benchmark, standing in for the round trip to S3,
+ * which the loopback interface does not have.
+ */
+#define ROUND_TRIP_DELAY_US             ( 1000U )
+
+/**
+ * @brief Maximum number of ranges the range server fails in a test.
+ */
+#define MAX_FAILED_RANGES               ( 8U )
+
+/**
+ * @brief Length of the buffer receiving the request headers at the range
+ * server.
+ */
+#define SERVER_REQUEST_BUFFER_LENGTH    ( 1024U )
+
+/**
+ * @brief Interval at which the range server checks for the end of a test.
+ */
+#define SERVER_POLL_INTERVAL_MS         ( 50 )
+
+/**
+ * @brief Number of nanoseconds in a microsecond.
+ */
+#define NANOSECONDS_PER_MICROSECOND     ( 1000L )
+
+/**
+ * @brief Number of microseconds in a second.
+ */
+#define MICROSECONDS_PER_SECOND         ( 1000000L )
+
+/*-----------------------------------------------------------*/
+
+/* Each compilation unit must define the NetworkContext struct. */
+struct NetworkContext
+{
+    PlaintextParams_t * pParams;
+};
+
+/**
+ * @brief How the range server fails a range.
+ */
+typedef enum RangeFailure
+{
+    RANGE_FAILURE_NONE = 0,  /**< @brief The range is served. */
+    RANGE_FAILURE_STATUS,    /**< @brief The range is answered with 503, and the connection kept. */
+    RANGE_FAILURE_CONNECTION /**< @brief The connection is closed without an answer. */
+} RangeFailure_t;
+
+/**
+ * @brief A range the range server fails a number of times before serving it.
+ */
+typedef struct FailedRange
+{
+    size_t rangeIndex;      /**< @brief Index of the range in the object. */
+    uint32_t failuresLeft;  /**< @brief Number of requests of the range still to fail. */
+    RangeFailure_t failure; /**< @brief How the requests fail. */
+} FailedRange_t;
+
+/**
+ * @brief A request passed from the thread writing the file to the HTTP thread,
+ * as in the S3 download demo before the range download.
+ */
+typedef struct RequestItem
+{
+    HTTPRequestHeaders_t requestHeaders;
+    uint8_t headersBuffer[ RESPONSE_BUFFER_LENGTH ];
+} RequestItem_t;
+
+/**
+ * @brief A response passed from the HTTP thread to the thread writing the
+ * file, as in the S3 download demo before the range download.
+ */
+typedef struct ResponseItem
+{
+    HTTPResponse_t response;
+    uint8_t responseBuffer[ RESPONSE_BUFFER_LENGTH ];
+} ResponseItem_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The object served by the range server.
+ */
+static uint8_t object[ OBJECT_SIZE ];
+
+/**
+ * @brief The downloaded file, read back to be compared with #object.
+ */
+static uint8_t downloaded[ OBJECT_SIZE ];
+
+/**
+ * @brief Request of the object, kept alive across ranges.
+ */
+static const HTTPRequestInfo_t requestInfo =
+{
+    HTTP_METHOD_GET, sizeof( HTTP_METHOD_GET ) - 1U,
+    "/object",       sizeof( "/object" ) - 1U,
+    SERVER_ADDRESS,  SERVER_ADDRESS_LENGTH,
+    HTTP_REQUEST_KEEP_ALIVE_FLAG
+};
+
+/**
+ * @brief State of the range server.
+ */
+static int serverSocket = -1;
+static uint16_t serverPort = 0U;
+static pthread_t serverThread;
+static uint32_t isServerStopping = 0U;
+static uint32_t activeConnections = 0U;
+
+/**
+ * @brief Delay of the range server before each response, in microseconds.
+ */
+static uint32_t responseDelayUs = 0U;
+
+/**
+ * @brief Number of requests the range server received for each range.
+ */
+static uint32_t rangeRequests[ RANGE_COUNT ];
+
+/**
+ * @brief Ranges the range server fails, protected by #failedRangesMutex.
+ */
+static FailedRange_t failedRanges[ MAX_FAILED_RANGES ];
+static size_t failedRangeCount = 0U;
+static pthread_mutex_t failedRangesMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief The connections of the downloads. The message queue hand-off uses
+ * the first.
+ */
+static PlaintextParams_t plaintextParams[ RANGE_DOWNLOAD_MAX_CONNECTIONS ];
+static NetworkContext_t networkContexts[ RANGE_DOWNLOAD_MAX_CONNECTIONS ];
+static TransportInterface_t transportInterfaces[ RANGE_DOWNLOAD_MAX_CONNECTIONS ];
+
+/**
+ * @brief Number of connections and of retries per range of
+ * #downloadInParallel.
+ */
+static size_t connectionCount = 1U;
+static uint32_t maxRangeRetries = 0U;
+
+/**
+ * @brief The queues of the hand-off.
+ */
+static mqd_t requestQueue = ( mqd_t ) -1;
+static mqd_t responseQueue = ( mqd_t ) -1;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Count a request of a range, and take one of the failures set for it
+ * in #failedRanges.
+ *
+ * @param[in] rangeIndex Index of the requested range.
+ *
+ * @return How the request fails, or #RANGE_FAILURE_NONE if it is served.
+ */
+static RangeFailure_t takeRangeFailure( size_t rangeIndex );
+
+/**
+ * @brief Make the range server fail a range a number of times.
+ *
+ * @param[in] rangeIndex Index of the range.
+ * @param[in] failures Number of requests of the range to fail.
+ * @param[in] failure How the requests fail.
+ */
+static void failRange( size_t rangeIndex,
+                       uint32_t failures,
+                       RangeFailure_t failure );
+
+/**
+ * @brief Answer the range requests of a connection until it is closed.
+ *
+ * @param[in] connectionSocket The accepted connection.
+ */
+static void serveRangeRequests( int connectionSocket );
+
+/**
+ * @brief Thread serving one connection of the range server.
+ *
+ * @param[in] pArgs The accepted socket, cast to a pointer.
+ *
+ * @return NULL.
+ */
+static void * connectionThreadRoutine( void * pArgs );
+
+/**
+ * @brief Accept connections on #serverSocket and serve each in its own
+ * thread, until #isServerStopping is set.
+ *
+ * @param[in] pArgs Unused.
+ *
+ * @return NULL.
+ */
+static void * serverThreadRoutine( void * pArgs );
+
+/**
+ * @brief Connect a network context to the range server.
+ *
+ * @param[in] pNetworkContext The network context to connect.
+ *
+ * @return EXIT_SUCCESS if the connection is established; EXIT_FAILURE
+ * otherwise.
+ */
+static int32_t connectToServer( NetworkContext_t * pNetworkContext );
+
+/**
+ * @brief Close the connection of a network context to the range server.
+ *
+ * @param[in] pNetworkContext The network context to disconnect.
+ */
+static void disconnectFromServer( NetworkContext_t * pNetworkContext );
+
+/**
+ * @brief Set up #transportInterfaces over closed #networkContexts.
+ */
+static void initializeTransportInterfaces( void );
+
+/**
+ * @brief Send the requests read from #requestQueue and write their responses
+ * to #responseQueue, until a request without headers is read.
+ *
+ * @param[in] pArgs Unused.
+ *
+ * @return NULL.
+ */
+static void * httpThreadRoutine( void * pArgs );
+
+/**
+ * @brief Download the object range by range, passing each request and
+ * response through the queues to an HTTP thread, and writing each response
+ * as it is read from #responseQueue.
+ *
+ * @param[in] fileDescriptor The file the object is written to.
+ *
+ * @return true if the whole object was written to the file; false otherwise.
+ */
+static bool downloadThroughQueues( int fileDescriptor );
+
+/**
+ * @brief Download the object with #downloadRangesInParallel over
+ * #connectionCount connections, retrying each range up to #maxRangeRetries
+ * times. Over a single connection, only the hand-off differs from
+ * #downloadThroughQueues.
+ *
+ * @param[in] fileDescriptor The file the object is written to.
+ *
+ * @return true if the whole object was written to the file; false otherwise.
+ */
+static bool downloadInParallel( int fileDescriptor );
+
+/**
+ * @brief Time a download of the object into a new file, and check that the
+ * file holds the object.
+ *
+ * @param[in] download The download to run.
+ *
+ * @return The duration of the download in microseconds.
+ */
+static long timeDownload( bool ( * download )( int fileDescriptor ) );
+
+/*-----------------------------------------------------------*/
+
+static RangeFailure_t takeRangeFailure( size_t rangeIndex )
+{
+    RangeFailure_t failure = RANGE_FAILURE_NONE;
+    size_t i = 0U;
+
+    ( void ) pthread_mutex_lock( &failedRangesMutex );
+
+    if( rangeIndex < RANGE_COUNT )
+    {
+        rangeRequests[ rangeIndex ]++;
+    }
+
+    for( i = 0U; i < failedRangeCount; i++ )
+    {
+        if( ( failedRanges[ i ].rangeIndex == rangeIndex ) &&
+            ( failedRanges[ i ].failuresLeft > 0U ) )
+        {
+            failedRanges[ i ].failuresLeft--;
+            failure = failedRanges[ i ].failure;
+        }
+    }
+
+    ( void ) pthread_mutex_unlock( &failedRangesMutex );
+
+    return failure;
+}
+
+/*-----------------------------------------------------------*/
+
+static void failRange( size_t rangeIndex,
+                       uint32_t failures,
+                       RangeFailure_t failure )
+{
+    TEST_ASSERT_LESS_THAN( MAX_FAILED_RANGES, failedRangeCount );
+    TEST_ASSERT_LESS_THAN( RANGE_COUNT, rangeIndex );
+
+    ( void ) pthread_mutex_lock( &failedRangesMutex );
+    failedRanges[ failedRangeCount ].rangeIndex = rangeIndex;
+    failedRanges[ failedRangeCount ].failuresLeft = failures;
+    failedRanges[ failedRangeCount ].failure = failure;
+    failedRangeCount++;
+    ( void ) pthread_mutex_unlock( &failedRangesMutex );
+}
+
+/*-----------------------------------------------------------*/
+
+static void serveRangeRequests( int connectionSocket )
+{
+    char request[ SERVER_REQUEST_BUFFER_LENGTH + 1U ];
+    char headers[ SERVER_REQUEST_BUFFER_LENGTH ];
+    struct pollfd pollFd = { 0 };
+    size_t requestLength = 0U;
+    size_t headersLength = 0U;
+    size_t rangeStart = 0U;
+    size_t rangeEnd = 0U;
+    ssize_t bytesReceived = 0;
+    char * pEnd = NULL;
+    char * pRange = NULL;
+    RangeFailure_t failure = RANGE_FAILURE_NONE;
+    bool isOpen = true;
+
+    pollFd.fd = connectionSocket;
+    pollFd.events = POLLIN;
+
+    while( ( isOpen == true ) &&
+           ( __atomic_load_n( &isServerStopping, __ATOMIC_ACQUIRE ) == 0U ) )
+    {
+        if( poll( &pollFd, 1U, SERVER_POLL_INTERVAL_MS ) <= 0 )
+        {
+            continue;
+        }
+
+        bytesReceived = recv( connectionSocket,
+                              &request[ requestLength ],
+                              SERVER_REQUEST_BUFFER_LENGTH - requestLength,
+                              0 );
+
+        if( bytesReceived <= 0 )
+        {
+            break;
+        }
+
+        requestLength += ( size_t ) bytesReceived;
+        request[ requestLength ] = '\0';
+        pEnd = strstr( request, "\r\n\r\n" );
+
+        if( pEnd == NULL )
+        {
+            /* Assertions are left to the test thread; a request that does not
+             * fit the buffer closes the connection, and fails the download. */
+            isOpen = ( requestLength < SERVER_REQUEST_BUFFER_LENGTH );
+            continue;
+        }
+
+        pRange = strstr( request, "Range: bytes=" );
+
+        if( pRange != NULL )
+        {
+            rangeStart = strtoul( pRange + sizeof( "Range: bytes=" ) - 1U, &pRange, 10 );
+            rangeEnd = strtoul( pRange + 1, NULL, 10 );
+        }
+
+        if( ( pRange == NULL ) || ( rangeStart > rangeEnd ) || ( rangeEnd >= OBJECT_SIZE ) )
+        {
+            break;
+        }
+
+        failure = takeRangeFailure( rangeStart / RANGE_REQUEST_LENGTH );
+
+        if( failure == RANGE_FAILURE_CONNECTION )
+        {
+            break;
+        }
+
+        if( responseDelayUs > 0U )
+        {
+            ( void ) usleep( responseDelayUs );
+        }
+
+        if( failure == RANGE_FAILURE_STATUS )
+        {
+            headersLength = ( size_t ) snprintf( headers,
+                                                 sizeof( headers ),
+                                                 "HTTP/1.1 503 Service Unavailable\r\n"
+                                                 "Content-Length: 0\r\n"
+                                                 "Connection: keep-alive\r\n\r\n" );
+            isOpen = ( send( connectionSocket, headers, headersLength, MSG_NOSIGNAL ) == ( ssize_t ) headersLength );
+        }
+        else
+        {
+            headersLength = ( size_t ) snprintf( headers,
+                                                 sizeof( headers ),
+                                                 "HTTP/1.1 206 Partial Content\r\n"
+                                                 "Content-Length: %lu\r\n"
+                                                 "Content-Range: bytes %lu-%lu/%lu\r\n"
+                                                 "Connection: keep-alive\r\n\r\n",
+                                                 ( unsigned long ) ( rangeEnd - rangeStart + 1U ),
+                                                 ( unsigned long ) rangeStart,
+                                                 ( unsigned long ) rangeEnd,
+                                                 ( unsigned long ) OBJECT_SIZE );
+
+            /* The headers are held back until the body is sent, so that each
+             * response leaves in as few segments as possible. */
+            isOpen = ( send( connectionSocket, headers, headersLength, MSG_MORE | MSG_NOSIGNAL ) == ( ssize_t ) headersLength ) &&
+                     ( send( connectionSocket, &object[ rangeStart ], rangeEnd - rangeStart + 1U, MSG_NOSIGNAL ) == ( ssize_t ) ( rangeEnd - rangeStart + 1U ) );
+        }
+
+        /* Requests are only sent once the previous response is received. */
+        requestLength = 0U;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void * connectionThreadRoutine( void * pArgs )
+{
+    int connectionSocket = ( int ) ( intptr_t ) pArgs;
+
+    serveRangeRequests( connectionSocket );
+    ( void ) close( connectionSocket );
+    __atomic_sub_fetch( &activeConnections, 1U, __ATOMIC_ACQ_REL );
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static void * serverThreadRoutine( void * pArgs )
+{
+    struct pollfd pollFd = { 0 };
+    pthread_t connectionThread;
+    pthread_attr_t threadAttributes;
+    int connectionSocket = -1;
+
+    ( void ) pArgs;
+
+    ( void ) pthread_attr_init( &threadAttributes );
+    ( void ) pthread_attr_setdetachstate( &threadAttributes, PTHREAD_CREATE_DETACHED );
+
+    pollFd.fd = serverSocket;
+    pollFd.events = POLLIN;
+
+    while( __atomic_load_n( &isServerStopping, __ATOMIC_ACQUIRE ) == 0U )
+    {
+        if( poll( &pollFd, 1U, SERVER_POLL_INTERVAL_MS ) <= 0 )
+        {
+            continue;
+        }
+
+        connectionSocket = accept( serverSocket, NULL, NULL );
+
+        if( connectionSocket >= 0 )
+        {
+            __atomic_add_fetch( &activeConnections, 1U, __ATOMIC_ACQ_REL );
+
+            if( pthread_create( &connectionThread,
+                                &threadAttributes,
+                                connectionThreadRoutine,
+                                ( void * ) ( intptr_t ) connectionSocket ) != 0 )
+            {
+                ( void ) close( connectionSocket );
+                __atomic_sub_fetch( &activeConnections, 1U, __ATOMIC_ACQ_REL );
+            }
+        }
+    }
+
+    ( void ) pthread_attr_destroy( &threadAttributes );
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t connectToServer( NetworkContext_t * pNetworkContext )
+{
+    ServerInfo_t serverInfo = { SERVER_ADDRESS, SERVER_ADDRESS_LENGTH, 0U };
+    int32_t returnStatus = EXIT_FAILURE;
+
+    serverInfo.port = serverPort;
+
+    if( Plaintext_Connect( pNetworkContext,
+                           &serverInfo,
+                           TRANSPORT_SEND_RECV_TIMEOUT_MS,
+                           TRANSPORT_SEND_RECV_TIMEOUT_MS ) == SOCKETS_SUCCESS )
+    {
+        returnStatus = EXIT_SUCCESS;
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void disconnectFromServer( NetworkContext_t * pNetworkContext )
+{
+    ( void ) Plaintext_Disconnect( pNetworkContext );
+}
+
+/*-----------------------------------------------------------*/
+
+static void initializeTransportInterfaces( void )
+{
+    size_t i = 0U;
+
+    ( void ) memset( plaintextParams, 0, sizeof( plaintextParams ) );
+    ( void ) memset( transportInterfaces, 0, sizeof( transportInterfaces ) );
+
+    for( i = 0U; i < RANGE_DOWNLOAD_MAX_CONNECTIONS; i++ )
+    {
+        networkContexts[ i ].pParams = &plaintextParams[ i ];
+        transportInterfaces[ i ].pNetworkContext = &networkContexts[ i ];
+        transportInterfaces[ i ].send = Plaintext_Send;
+        transportInterfaces[ i ].recv = Plaintext_Recv;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void * httpThreadRoutine( void * pArgs )
+{
+    /* Static, as each item is larger than a thread stack should hold. */
+    static RequestItem_t requestItem;
+    static ResponseItem_t responseItem;
+    HTTPStatus_t httpStatus = HTTPSuccess;
+    ssize_t mqread = 0;
+    bool isRunning = true;
+
+    ( void ) pArgs;
+
+    while( isRunning == true )
+    {
+        mqread = mq_receive( requestQueue,
+                             ( char * ) &requestItem,
+                             sizeof( RequestItem_t ),
+                             NULL );
+
+        if( ( mqread != ( ssize_t ) sizeof( RequestItem_t ) ) ||
+            ( requestItem.requestHeaders.headersLen == 0U ) )
+        {
+            isRunning = false;
+        }
+        else
+        {
+            /* The headers point into the buffer of the sending thread. */
+            requestItem.requestHeaders.pBuffer = requestItem.headersBuffer;
+
+            ( void ) memset( &responseItem.response, 0, sizeof( HTTPResponse_t ) );
+            responseItem.response.pBuffer = responseItem.responseBuffer;
+            responseItem.response.bufferLen = RESPONSE_BUFFER_LENGTH;
+
+            httpStatus = HTTPClient_Send( &transportInterfaces[ 0 ],
+                                          &requestItem.requestHeaders,
+                                          NULL,
+                                          0,
+                                          &responseItem.response,
+                                          0 );
+
+            if( httpStatus != HTTPSuccess )
+            {
+                /* Answered anyway, so that the download does not wait. */
+                responseItem.response.statusCode = 0U;
+            }
+
+            isRunning = ( mq_send( responseQueue,
+                                   ( char * ) &responseItem,
+                                   sizeof( ResponseItem_t ),
+                                   0 ) == 0 );
+        }
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool downloadThroughQueues( int fileDescriptor )
+{
+    static RequestItem_t requestItem;
+    static ResponseItem_t responseItem;
+    pthread_t httpThread;
+    size_t offset = 0U;
+    size_t bodyOffset = 0U;
+    size_t rangeLength = 0U;
+    bool returnStatus = true;
+
+    initializeTransportInterfaces();
+    TEST_ASSERT_EQUAL( EXIT_SUCCESS, connectToServer( &networkContexts[ 0 ] ) );
+    TEST_ASSERT_EQUAL( 0, pthread_create( &httpThread, NULL, httpThreadRoutine, NULL ) );
+
+    for( offset = 0U; ( returnStatus == true ) && ( offset < OBJECT_SIZE ); offset += rangeLength )
+    {
+        rangeLength = ( ( OBJECT_SIZE - offset ) < RANGE_REQUEST_LENGTH ) ?
+                      ( OBJECT_SIZE - offset ) : RANGE_REQUEST_LENGTH;
+
+        ( void ) memset( &requestItem.requestHeaders, 0, sizeof( HTTPRequestHeaders_t ) );
+        requestItem.requestHeaders.pBuffer = requestItem.headersBuffer;
+        requestItem.requestHeaders.bufferLen = RESPONSE_BUFFER_LENGTH;
+
+        returnStatus = ( HTTPClient_InitializeRequestHeaders( &requestItem.requestHeaders,
+                                                              &requestInfo ) == HTTPSuccess ) &&
+                       ( HTTPClient_AddRangeHeader( &requestItem.requestHeaders,
+                                                    ( int32_t ) offset,
+                                                    ( int32_t ) ( offset + rangeLength - 1U ) ) == HTTPSuccess ) &&
+                       ( mq_send( requestQueue,
+                                  ( char * ) &requestItem,
+                                  sizeof( RequestItem_t ),
+                                  0 ) == 0 ) &&
+                       ( mq_receive( responseQueue,
+                                     ( char * ) &responseItem,
+                                     sizeof( ResponseItem_t ),
+                                     NULL ) == ( ssize_t ) sizeof( ResponseItem_t ) );
+
+        if( returnStatus == true )
+        {
+            returnStatus = ( responseItem.response.statusCode == 206U ) &&
+                           ( responseItem.response.bodyLen == rangeLength );
+        }
+
+        if( returnStatus == true )
+        {
+            /* The body points into the buffer of the HTTP thread. */
+            bodyOffset = ( size_t ) ( responseItem.response.pBody - responseItem.response.pBuffer );
+            returnStatus = ( pwrite( fileDescriptor,
+                                     &responseItem.responseBuffer[ bodyOffset ],
+                                     rangeLength,
+                                     ( off_t ) offset ) == ( ssize_t ) rangeLength );
+        }
+    }
+
+    /* A request without headers stops the HTTP thread. */
+    ( void ) memset( &requestItem.requestHeaders, 0, sizeof( HTTPRequestHeaders_t ) );
+    TEST_ASSERT_EQUAL( 0, mq_send( requestQueue, ( char * ) &requestItem, sizeof( RequestItem_t ), 0 ) );
+    ( void ) pthread_join( httpThread, NULL );
+    disconnectFromServer( &networkContexts[ 0 ] );
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool downloadInParallel( int fileDescriptor )
+{
+    static uint8_t buffer[ RANGE_DOWNLOAD_MAX_CONNECTIONS * RESPONSE_BUFFER_LENGTH ];
+    RangeDownloadConfig_t config = { 0 };
+
+    initializeTransportInterfaces();
+
+    /* Each connection gets a buffer of the size the S3 download demo uses. */
+    config.pRequestInfo = &requestInfo;
+    config.pTransportInterfaces = transportInterfaces;
+    config.connectionCount = connectionCount;
+    config.connectFunction = connectToServer;
+    config.disconnectFunction = disconnectFromServer;
+    config.pBuffer = buffer;
+    config.bufferLength = connectionCount * RESPONSE_BUFFER_LENGTH;
+    config.fileDescriptor = fileDescriptor;
+    config.fileSize = OBJECT_SIZE;
+    config.rangeLength = RANGE_REQUEST_LENGTH;
+    config.maxRangeRetries = maxRangeRetries;
+
+    return downloadRangesInParallel( &config );
+}
+
+/*-----------------------------------------------------------*/
+
+static long timeDownload( bool ( * download )( int fileDescriptor ) )
+{
+    FILE * pFile = NULL;
+    struct timespec start;
+    struct timespec end;
+
+    pFile = tmpfile();
+    TEST_ASSERT_NOT_NULL( pFile );
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+    TEST_ASSERT_TRUE( download( fileno( pFile ) ) );
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &end );
+
+    TEST_ASSERT_EQUAL( OBJECT_SIZE, pread( fileno( pFile ), downloaded, OBJECT_SIZE, 0 ) );
+    TEST_ASSERT_EQUAL_MEMORY( object, downloaded, OBJECT_SIZE );
+    ( void ) fclose( pFile );
+
+    return ( ( end.tv_sec - start.tv_sec ) * MICROSECONDS_PER_SECOND ) +
+           ( ( end.tv_nsec - start.tv_nsec ) / NANOSECONDS_PER_MICROSECOND );
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    struct sockaddr_in address = { 0 };
+    socklen_t addressLength = sizeof( address );
+    struct mq_attr queueSettings = { 0 };
+    size_t index = 0U;
+
+    for( index = 0U; index < OBJECT_SIZE; index++ )
+    {
+        object[ index ] = ( uint8_t ) ( ( index * 7U ) + ( index >> 11 ) );
+    }
+
+    serverSocket = socket( AF_INET, SOCK_STREAM, 0 );
+    TEST_ASSERT_NOT_EQUAL( -1, serverSocket );
+    address.sin_family = AF_INET;
+    TEST_ASSERT_EQUAL( 1, inet_pton( AF_INET, SERVER_ADDRESS, &address.sin_addr ) );
+    TEST_ASSERT_EQUAL( 0, bind( serverSocket, ( struct sockaddr * ) &address, sizeof( address ) ) );
+    TEST_ASSERT_EQUAL( 0, listen( serverSocket, RANGE_DOWNLOAD_MAX_CONNECTIONS ) );
+    TEST_ASSERT_EQUAL( 0, getsockname( serverSocket, ( struct sockaddr * ) &address, &addressLength ) );
+    serverPort = ntohs( address.sin_port );
+
+    ( void ) memset( rangeRequests, 0, sizeof( rangeRequests ) );
+    failedRangeCount = 0U;
+    responseDelayUs = 0U;
+    connectionCount = 1U;
+    maxRangeRetries = 0U;
+
+    __atomic_store_n( &isServerStopping, 0U, __ATOMIC_RELEASE );
+    TEST_ASSERT_EQUAL( 0, pthread_create( &serverThread, NULL, serverThreadRoutine, NULL ) );
+
+    /* The queues are created as in the S3 download demo. */
+    ( void ) mq_unlink( REQUEST_QUEUE );
+    ( void ) mq_unlink( RESPONSE_QUEUE );
+    queueSettings.mq_maxmsg = QUEUE_SIZE;
+    queueSettings.mq_msgsize = sizeof( RequestItem_t );
+    requestQueue = mq_open( REQUEST_QUEUE, O_CREAT | O_RDWR, 0600, &queueSettings );
+    TEST_ASSERT_NOT_EQUAL( ( mqd_t ) -1, requestQueue );
+    queueSettings.mq_msgsize = sizeof( ResponseItem_t );
+    responseQueue = mq_open( RESPONSE_QUEUE, O_CREAT | O_RDWR, 0600, &queueSettings );
+    TEST_ASSERT_NOT_EQUAL( ( mqd_t ) -1, responseQueue );
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+    __atomic_store_n( &isServerStopping, 1U, __ATOMIC_RELEASE );
+    ( void ) pthread_join( serverThread, NULL );
+    ( void ) close( serverSocket );
+
+    /* The connection threads end at the next poll interval. */
+    while( __atomic_load_n( &activeConnections, __ATOMIC_ACQUIRE ) > 0U )
+    {
+        ( void ) usleep( 1000U );
+    }
+
+    ( void ) mq_close( requestQueue );
+    ( void ) mq_close( responseQueue );
+    ( void ) mq_unlink( REQUEST_QUEUE );
+    ( void ) mq_unlink( RESPONSE_QUEUE );
+}
+
+/* ========================== Test Cases ============================ */
+
+/**
+ * @brief Downloads the object #DOWNLOAD_ROUNDS times each way, checks every
+ * download, and logs the throughput of both ways.
+ */
+void test_S3Download_HandOffThroughput( void )
+{
+    long queuesUs = 0L;
+    long inPlaceUs = 0L;
+    uint32_t round = 0U;
+
+    for( round = 0U; round < DOWNLOAD_ROUNDS; round++ )
+    {
+        queuesUs += timeDownload( downloadThroughQueues );
+        inPlaceUs += timeDownload( downloadInParallel );
+    }
+
+    LogInfo( ( "Downloaded %u ranges of %u bytes, %u times each way.",
+               ( unsigned ) ( OBJECT_SIZE / RANGE_REQUEST_LENGTH ),
+               ( unsigned ) RANGE_REQUEST_LENGTH,
+               ( unsigned ) DOWNLOAD_ROUNDS ) );
+    LogInfo( ( "Message queue hand-off: %.1f MB/s.",
+               ( ( double ) OBJECT_SIZE * DOWNLOAD_ROUNDS ) / ( double ) queuesUs ) );
+    LogInfo( ( "In-place range download: %.1f MB/s.",
+               ( ( double ) OBJECT_SIZE * DOWNLOAD_ROUNDS ) / ( double ) inPlaceUs ) );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Downloads the object over 1, 2, 4, 8 and 16 connections, checks
+ * every download, and logs the throughput of each connection count, both
+ * over the bare loopback interface and with #ROUND_TRIP_DELAY_US before each
+ * response.
+ */
+void test_S3Download_ConnectionCountThroughput( void )
+{
+    long loopbackUs = 0L;
+    long delayedUs = 0L;
+    uint32_t round = 0U;
+
+    LogInfo( ( "Downloading %u ranges of %u bytes; %u us delay per response in the second series.",
+               ( unsigned ) RANGE_COUNT,
+               ( unsigned ) RANGE_REQUEST_LENGTH,
+               ( unsigned ) ROUND_TRIP_DELAY_US ) );
+
+    for( connectionCount = 1U;
+         connectionCount <= RANGE_DOWNLOAD_MAX_CONNECTIONS;
+         connectionCount *= 2U )
+    {
+        responseDelayUs = 0U;
+        loopbackUs = 0L;
+
+        for( round = 0U; round < DOWNLOAD_ROUNDS; round++ )
+        {
+            loopbackUs += timeDownload( downloadInParallel );
+        }
+
+        /* A single delayed download takes seconds over few connections. */
+        responseDelayUs = ROUND_TRIP_DELAY_US;
+        delayedUs = timeDownload( downloadInParallel );
+
+        LogInfo( ( "%2u connections: %.1f MB/s over loopback, %.1f MB/s with the delay.",
+                   ( unsigned ) connectionCount,
+                   ( ( double ) OBJECT_SIZE * DOWNLOAD_ROUNDS ) / ( double ) loopbackUs,
+                   ( double ) OBJECT_SIZE / ( double ) delayedUs ) );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Fails ranges at the start, middle and end of the object, some with
+ * an error status and some by closing the connection, no more times than the
+ * download retries them, and checks that the download completes with each
+ * failed range requested once more than it failed, and every other range
+ * once.
+ */
+void test_S3Download_RetriesFailedRanges( void )
+{
+    uint32_t totalRequests = 0U;
+    size_t i = 0U;
+
+    connectionCount = 4U;
+    maxRangeRetries = 2U;
+
+    /* Ranges at both ends of the shares of the connections, and inside
+     * them. */
+    failRange( 0U, 1U, RANGE_FAILURE_STATUS );
+    failRange( 1U, 2U, RANGE_FAILURE_CONNECTION );
+    failRange( ( RANGE_COUNT / 4U ) - 1U, 2U, RANGE_FAILURE_STATUS );
+    failRange( RANGE_COUNT / 2U, 1U, RANGE_FAILURE_CONNECTION );
+    failRange( ( RANGE_COUNT * 3U ) / 8U, 2U, RANGE_FAILURE_CONNECTION );
+    failRange( RANGE_COUNT - 1U, 2U, RANGE_FAILURE_STATUS );
+
+    ( void ) timeDownload( downloadInParallel );
+
+    for( i = 0U; i < failedRangeCount; i++ )
+    {
+        TEST_ASSERT_EQUAL_UINT32( 0U, failedRanges[ i ].failuresLeft );
+    }
+
+    TEST_ASSERT_EQUAL_UINT32( 2U, rangeRequests[ 0U ] );
+    TEST_ASSERT_EQUAL_UINT32( 3U, rangeRequests[ 1U ] );
+    TEST_ASSERT_EQUAL_UINT32( 3U, rangeRequests[ ( RANGE_COUNT / 4U ) - 1U ] );
+    TEST_ASSERT_EQUAL_UINT32( 2U, rangeRequests[ RANGE_COUNT / 2U ] );
+    TEST_ASSERT_EQUAL_UINT32( 3U, rangeRequests[ ( RANGE_COUNT * 3U ) / 8U ] );
+    TEST_ASSERT_EQUAL_UINT32( 3U, rangeRequests[ RANGE_COUNT - 1U ] );
+
+    for( i = 0U; i < RANGE_COUNT; i++ )
+    {
+        TEST_ASSERT_GREATER_THAN_UINT32( 0U, rangeRequests[ i ] );
+        totalRequests += rangeRequests[ i ];
+    }
+
+    /* 10 failures in all, each followed by one more request. */
+    TEST_ASSERT_EQUAL_UINT32( RANGE_COUNT + 10U, totalRequests );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Fails a range on every request, once with an error status and once
+ * by closing the connection, and checks that the download is abandoned after
+ * the range was requested once more than it is retried.
+ */
+void test_S3Download_AbortsWhenRangeFailsTooOften( void )
+{
+    static const RangeFailure_t failures[] = { RANGE_FAILURE_STATUS, RANGE_FAILURE_CONNECTION };
+    const size_t rangeIndex = RANGE_COUNT / 3U;
+    FILE * pFile = NULL;
+    size_t i = 0U;
+
+    connectionCount = 4U;
+    maxRangeRetries = 3U;
+
+    for( i = 0U; i < ( sizeof( failures ) / sizeof( failures[ 0 ] ) ); i++ )
+    {
+        ( void ) memset( rangeRequests, 0, sizeof( rangeRequests ) );
+        failedRangeCount = 0U;
+        failRange( rangeIndex, UINT32_MAX, failures[ i ] );
+
+        pFile = tmpfile();
+        TEST_ASSERT_NOT_NULL( pFile );
+        TEST_ASSERT_FALSE( downloadInParallel( fileno( pFile ) ) );
+        ( void ) fclose( pFile );
+
+        TEST_ASSERT_EQUAL_UINT32( maxRangeRetries + 1U, rangeRequests[ rangeIndex ] );
+    }
+}
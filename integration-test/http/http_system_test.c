@@ -136,7 +136,7 @@ static NetworkContext_t networkContext;
 /**
  * @brief Parameters for the Openssl Context.
  */
-static OpensslParams_t opensslParams;
+static OpensslParams_t opensslParams = { 0 };
 
 /**
  * @brief The transport layer interface used by the HTTP Client library.
@@ -0,0 +1,973 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file jobs_download_benchmark_test.c
+ * @brief Turnaround benchmark of the in-process downloader of the jobs demo,
+ * comparing it with the fork and exec of curl it replaced for https URLs,
+ * against an HTTPS range server on the loopback interface.
+ */
+
+/* Standard header includes. */
+#include <string.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+
+/* POSIX includes. */
+#include <unistd.h>
+#include <dirent.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/* OpenSSL includes. */
+#include <openssl/ssl.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#include <openssl/x509v3.h>
+
+/* Include config file before other non-system includes. */
+#include "test_config.h"
+
+/* Unity testing framework includes. */
+#include "unity.h"
+
+/* Include the in-process downloader of the jobs demo. */
+#include "http_download.h"
+
+/**
+ * @brief Address the range server listens on.
+ */
+#define SERVER_ADDRESS                   "127.0.0.1"
+
+/**
+ * @brief Certificate the range server presents, trusted by the downloads.
+ */
+#define SERVER_CERT_FILE_NAME            "jobs_download_server.crt"
+
+/**
+ * @brief Certificate of another server, which the range server is not.
+ */
+#define OTHER_CERT_FILE_NAME             "jobs_download_other.crt"
+
+/**
+ * @brief Directories the files are downloaded to, in process and by curl.
+ */
+#define IN_PROCESS_DIRECTORY             "jobs_download_in_process"
+#define CURL_DIRECTORY                   "jobs_download_curl"
+
+/**
+ * @brief Path of curl, as in the demo configuration.
+ */
+#define CURL_PATH                        "/usr/bin/curl"
+
+/**
+ * @brief Size of the file served by the range server.
+ */
+#define OBJECT_SIZE                      ( 1024U * 1024U )
+
+/**
+ * @brief Number of jobs of the benchmark, each downloading a file.
+ */
+#define JOB_COUNT                        ( 40U )
+
+/**
+ * @brief Number of downloads running at once.
+ */
+#define JOB_CONCURRENCY                  ( 8U )
+
+/**
+ * @brief Milliseconds to wait for a download to end.
+ */
+#define DOWNLOAD_WAIT_TIMEOUT_MS         ( 30000 )
+
+/**
+ * @brief Size of the buffer receiving the headers of a request.
+ */
+#define REQUEST_BUFFER_SIZE              ( 4096U )
+
+/**
+ * @brief Size of the buffer of a download URL.
+ */
+#define URL_BUFFER_SIZE                  ( 128U )
+
+/**
+ * @brief Milliseconds the range server waits for a connection before
+ * checking whether it must stop.
+ */
+#define SERVER_POLL_TIMEOUT_MS           ( 100 )
+
+/**
+ * @brief Nanoseconds per microsecond.
+ */
+#define NANOSECONDS_PER_MICROSECOND      ( 1000L )
+
+/**
+ * @brief Microseconds per second.
+ */
+#define MICROSECONDS_PER_SECOND          ( 1000000L )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief A download running in a slot of the benchmark.
+ */
+typedef struct JobSlot
+{
+    bool isRunning;          /**< @brief True while the slot has a download. */
+    download_t download;     /**< @brief The in-process download. */
+    pid_t child;             /**< @brief The curl process. */
+    struct timespec start;   /**< @brief When the job started. */
+} JobSlot_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The file served by the range server.
+ */
+static uint8_t object[ OBJECT_SIZE ];
+
+/**
+ * @brief TLS context of the range server, created by the first test.
+ */
+static SSL_CTX * pServerContext = NULL;
+
+/**
+ * @brief Listening socket and port of the range server.
+ */
+static int serverSocket = -1;
+static uint16_t serverPort = 0U;
+
+/**
+ * @brief Thread accepting the connections of the range server.
+ */
+static pthread_t serverThread;
+
+/**
+ * @brief Set to stop the range server.
+ */
+static uint32_t isServerStopping = 0U;
+
+/**
+ * @brief Number of connection threads of the range server still running.
+ */
+static uint32_t activeConnections = 0U;
+
+/**
+ * @brief Number of TLS connections the range server completed a handshake on.
+ */
+static uint32_t tlsConnectionCount = 0U;
+
+/**
+ * @brief Slots of the downloads running at once.
+ */
+static JobSlot_t slots[ JOB_CONCURRENCY ];
+
+/**
+ * @brief Turnaround of each job, in microseconds.
+ */
+static long turnarounds[ JOB_COUNT ];
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Generate a P-256 key and a self-signed certificate for
+ * #SERVER_ADDRESS, and write the certificate to a file.
+ *
+ * @param[in] pCertFileName The file.
+ * @param[out] ppKey The key.
+ *
+ * @return The certificate, NULL on failure.
+ */
+static X509 * createCertificate( const char * pCertFileName,
+                                 EVP_PKEY ** ppKey );
+
+/**
+ * @brief Add an extension to a self-signed certificate.
+ *
+ * @param[in] pCert The certificate.
+ * @param[in] nid The extension.
+ * @param[in] pValue The value of the extension, as in an OpenSSL config file.
+ *
+ * @return true on success; false otherwise.
+ */
+static bool addExtension( X509 * pCert,
+                          int nid,
+                          const char * pValue );
+
+/**
+ * @brief Accept connections to the range server until it must stop.
+ *
+ * @param[in] pArgs Unused.
+ *
+ * @return NULL.
+ */
+static void * serverRoutine( void * pArgs );
+
+/**
+ * @brief Serve the range requests of a connection until the client closes it.
+ *
+ * @param[in] pArgs The socket of the connection.
+ *
+ * @return NULL.
+ */
+static void * connectionRoutine( void * pArgs );
+
+/**
+ * @brief Answer a request of a connection of the range server.
+ *
+ * @param[in] pSsl The connection.
+ * @param[in] pRequest The headers of the request, terminated by a NUL.
+ *
+ * @return true if the response was sent; false otherwise.
+ */
+static bool sendResponse( SSL * pSsl,
+                          const char * pRequest );
+
+/**
+ * @brief Write a whole buffer to a TLS connection.
+ *
+ * @return true on success; false otherwise.
+ */
+static bool writeAll( SSL * pSsl,
+                      const void * pData,
+                      size_t length );
+
+/**
+ * @brief Write the URL of the file of a job.
+ *
+ * @param[out] pUrl The buffer of the URL, of #URL_BUFFER_SIZE bytes.
+ * @param[in] jobIndex The job.
+ *
+ * @return The length of the URL.
+ */
+static size_t jobUrl( char * pUrl,
+                      uint32_t jobIndex );
+
+/**
+ * @brief Check that the file of a job was downloaded whole, and remove it.
+ *
+ * @param[in] pDirectory The directory of the file.
+ * @param[in] jobIndex The job.
+ */
+static void checkJobFile( const char * pDirectory,
+                          uint32_t jobIndex );
+
+/**
+ * @brief Run the jobs with the in-process downloader, recording their
+ * turnarounds in #turnarounds.
+ *
+ * @return The microseconds all the jobs took.
+ */
+static long runInProcessJobs( void );
+
+/**
+ * @brief Run the jobs by forking curl, as the demo did, recording their
+ * turnarounds in #turnarounds.
+ *
+ * @return The microseconds all the jobs took.
+ */
+static long runCurlJobs( void );
+
+/**
+ * @brief Log the mean and 90th percentile of #turnarounds.
+ *
+ * @param[in] pName Name of the way the jobs were run.
+ * @param[in] totalUs The microseconds all the jobs took.
+ */
+static void reportTurnarounds( const char * pName,
+                               long totalUs );
+
+/**
+ * @brief Compare two turnarounds, for qsort.
+ */
+static int compareTurnarounds( const void * pFirst,
+                               const void * pSecond );
+
+/**
+ * @brief Count the open file descriptors of the process.
+ *
+ * @return The number of open descriptors.
+ */
+static uint32_t countOpenDescriptors( void );
+
+/**
+ * @brief Microseconds elapsed since a time.
+ *
+ * @param[in] pStart The time.
+ *
+ * @return The microseconds elapsed since @p pStart.
+ */
+static long microsecondsSince( const struct timespec * pStart );
+
+/*-----------------------------------------------------------*/
+
+static bool addExtension( X509 * pCert,
+                          int nid,
+                          const char * pValue )
+{
+    X509V3_CTX context;
+    X509_EXTENSION * pExtension = NULL;
+    bool isAdded = false;
+
+    X509V3_set_ctx_nodb( &context );
+    X509V3_set_ctx( &context, pCert, pCert, NULL, NULL, 0 );
+    pExtension = X509V3_EXT_nconf_nid( NULL, &context, nid, pValue );
+
+    if( pExtension != NULL )
+    {
+        isAdded = ( 1 == X509_add_ext( pCert, pExtension, -1 ) );
+        X509_EXTENSION_free( pExtension );
+    }
+
+    return isAdded;
+}
+
+/*-----------------------------------------------------------*/
+
+static X509 * createCertificate( const char * pCertFileName,
+                                 EVP_PKEY ** ppKey )
+{
+    EVP_PKEY * pKey = NULL;
+    EVP_PKEY_CTX * pKeyContext = NULL;
+    X509 * pCert = NULL;
+    X509_NAME * pName = NULL;
+    FILE * pCertFile = NULL;
+    bool isCreated = false;
+
+    pKeyContext = EVP_PKEY_CTX_new_id( EVP_PKEY_EC, NULL );
+
+    if( ( pKeyContext != NULL ) &&
+        ( 1 == EVP_PKEY_keygen_init( pKeyContext ) ) &&
+        ( 1 == EVP_PKEY_CTX_set_ec_paramgen_curve_nid( pKeyContext, NID_X9_62_prime256v1 ) ) &&
+        ( 1 == EVP_PKEY_keygen( pKeyContext, &pKey ) ) )
+    {
+        pCert = X509_new();
+    }
+
+    if( pCert != NULL )
+    {
+        pName = X509_get_subject_name( pCert );
+
+        if( ( 1 == X509_set_version( pCert, 2 ) ) &&
+            ( 1 == ASN1_INTEGER_set( X509_get_serialNumber( pCert ), 1 ) ) &&
+            ( NULL != X509_gmtime_adj( X509_getm_notBefore( pCert ), 0 ) ) &&
+            ( NULL != X509_gmtime_adj( X509_getm_notAfter( pCert ), 3600L ) ) &&
+            ( 1 == X509_NAME_add_entry_by_txt( pName, "CN", MBSTRING_ASC,
+                                               ( const unsigned char * ) SERVER_ADDRESS, -1, -1, 0 ) ) &&
+            ( 1 == X509_set_issuer_name( pCert, pName ) ) &&
+            ( 1 == X509_set_pubkey( pCert, pKey ) ) &&
+            ( addExtension( pCert, NID_basic_constraints, "critical,CA:TRUE" ) == true ) &&
+            ( addExtension( pCert, NID_key_usage, "critical,digitalSignature,keyCertSign" ) == true ) &&
+            ( addExtension( pCert, NID_subject_key_identifier, "hash" ) == true ) &&
+            ( addExtension( pCert, NID_authority_key_identifier, "keyid:always" ) == true ) &&
+            ( addExtension( pCert, NID_subject_alt_name, "IP:" SERVER_ADDRESS ) == true ) &&
+            ( 0 < X509_sign( pCert, pKey, EVP_sha256() ) ) )
+        {
+            pCertFile = fopen( pCertFileName, "w" );
+        }
+    }
+
+    if( pCertFile != NULL )
+    {
+        isCreated = ( 1 == PEM_write_X509( pCertFile, pCert ) );
+        isCreated = ( fclose( pCertFile ) == 0 ) && isCreated;
+    }
+
+    if( isCreated == false )
+    {
+        X509_free( pCert );
+        pCert = NULL;
+        EVP_PKEY_free( pKey );
+        pKey = NULL;
+    }
+
+    EVP_PKEY_CTX_free( pKeyContext );
+    *ppKey = pKey;
+
+    return pCert;
+}
+
+/*-----------------------------------------------------------*/
+
+static void * serverRoutine( void * pArgs )
+{
+    struct pollfd pollFd;
+    pthread_t thread;
+    pthread_attr_t attributes;
+    intptr_t connection = -1;
+
+    ( void ) pArgs;
+
+    ( void ) pthread_attr_init( &attributes );
+    ( void ) pthread_attr_setdetachstate( &attributes, PTHREAD_CREATE_DETACHED );
+
+    pollFd.fd = serverSocket;
+    pollFd.events = POLLIN;
+
+    while( __atomic_load_n( &isServerStopping, __ATOMIC_ACQUIRE ) == 0U )
+    {
+        if( poll( &pollFd, 1, SERVER_POLL_TIMEOUT_MS ) > 0 )
+        {
+            connection = accept( serverSocket, NULL, NULL );
+
+            if( connection >= 0 )
+            {
+                __atomic_add_fetch( &activeConnections, 1U, __ATOMIC_ACQ_REL );
+
+                if( pthread_create( &thread, &attributes, connectionRoutine, ( void * ) connection ) != 0 )
+                {
+                    ( void ) close( ( int ) connection );
+                    __atomic_sub_fetch( &activeConnections, 1U, __ATOMIC_ACQ_REL );
+                }
+            }
+        }
+    }
+
+    ( void ) pthread_attr_destroy( &attributes );
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static void * connectionRoutine( void * pArgs )
+{
+    int connection = ( int ) ( intptr_t ) pArgs;
+    SSL * pSsl = NULL;
+    char request[ REQUEST_BUFFER_SIZE + 1U ];
+    size_t received = 0U;
+    char * pEnd = NULL;
+    int result = 0;
+    bool isOpen = true;
+
+    pSsl = SSL_new( pServerContext );
+
+    if( ( pSsl != NULL ) &&
+        ( 1 == SSL_set_fd( pSsl, connection ) ) &&
+        ( 1 == SSL_accept( pSsl ) ) )
+    {
+        __atomic_add_fetch( &tlsConnectionCount, 1U, __ATOMIC_ACQ_REL );
+
+        while( isOpen == true )
+        {
+            request[ received ] = '\0';
+            pEnd = strstr( request, "\r\n\r\n" );
+
+            if( pEnd != NULL )
+            {
+                /* The requests have no body. */
+                pEnd += sizeof( "\r\n\r\n" ) - 1U;
+                isOpen = sendResponse( pSsl, request );
+                received -= ( size_t ) ( pEnd - request );
+                ( void ) memmove( request, pEnd, received );
+            }
+            else if( received == REQUEST_BUFFER_SIZE )
+            {
+                isOpen = false;
+            }
+            else
+            {
+                result = SSL_read( pSsl, &request[ received ], ( int ) ( REQUEST_BUFFER_SIZE - received ) );
+
+                if( result > 0 )
+                {
+                    received += ( size_t ) result;
+                }
+                else
+                {
+                    isOpen = false;
+                }
+            }
+        }
+    }
+
+    SSL_free( pSsl );
+    ( void ) close( connection );
+    __atomic_sub_fetch( &activeConnections, 1U, __ATOMIC_ACQ_REL );
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool sendResponse( SSL * pSsl,
+                          const char * pRequest )
+{
+    char headers[ 256 ];
+    const char * pRange = NULL;
+    unsigned long first = 0UL;
+    unsigned long last = OBJECT_SIZE - 1U;
+    int headersLength = 0;
+    bool isSent = false;
+
+    /* curl asks for the whole file, and the downloader for ranges. */
+    pRange = strstr( pRequest, "\r\nRange: bytes=" );
+
+    if( pRange == NULL )
+    {
+        headersLength = snprintf( headers, sizeof( headers ),
+                                  "HTTP/1.1 200 OK\r\nContent-Length: %u\r\n\r\n",
+                                  ( unsigned ) OBJECT_SIZE );
+    }
+    else if( ( sscanf( pRange, "\r\nRange: bytes=%lu-%lu", &first, &last ) >= 1 ) &&
+             ( first < OBJECT_SIZE ) )
+    {
+        last = ( last < OBJECT_SIZE ) ? last : ( OBJECT_SIZE - 1U );
+        headersLength = snprintf( headers, sizeof( headers ),
+                                  "HTTP/1.1 206 Partial Content\r\n"
+                                  "Content-Length: %lu\r\n"
+                                  "Content-Range: bytes %lu-%lu/%u\r\n\r\n",
+                                  last - first + 1UL, first, last, ( unsigned ) OBJECT_SIZE );
+    }
+    else
+    {
+        headersLength = snprintf( headers, sizeof( headers ),
+                                  "HTTP/1.1 416 Range Not Satisfiable\r\n"
+                                  "Content-Length: 0\r\n"
+                                  "Content-Range: bytes */%u\r\n\r\n",
+                                  ( unsigned ) OBJECT_SIZE );
+        first = 1UL;
+        last = 0UL;
+    }
+
+    if( writeAll( pSsl, headers, ( size_t ) headersLength ) == true )
+    {
+        isSent = ( last < first ) || writeAll( pSsl, &object[ first ], last - first + 1UL );
+    }
+
+    return isSent;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool writeAll( SSL * pSsl,
+                      const void * pData,
+                      size_t length )
+{
+    size_t written = 0U;
+    int result = 1;
+
+    while( ( result > 0 ) && ( written < length ) )
+    {
+        result = SSL_write( pSsl, &( ( const uint8_t * ) pData )[ written ], ( int ) ( length - written ) );
+
+        if( result > 0 )
+        {
+            written += ( size_t ) result;
+        }
+    }
+
+    return written == length;
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t jobUrl( char * pUrl,
+                      uint32_t jobIndex )
+{
+    int length = snprintf( pUrl, URL_BUFFER_SIZE, "https://" SERVER_ADDRESS ":%u/job-%u.bin",
+                           ( unsigned ) serverPort, ( unsigned ) jobIndex );
+
+    return ( size_t ) length;
+}
+
+/*-----------------------------------------------------------*/
+
+static void checkJobFile( const char * pDirectory,
+                          uint32_t jobIndex )
+{
+    char fileName[ URL_BUFFER_SIZE ];
+    uint8_t * pContents = NULL;
+    FILE * pFile = NULL;
+
+    ( void ) snprintf( fileName, sizeof( fileName ), "%s/job-%u.bin", pDirectory, ( unsigned ) jobIndex );
+
+    pContents = malloc( OBJECT_SIZE + 1U );
+    TEST_ASSERT_NOT_NULL( pContents );
+
+    pFile = fopen( fileName, "rb" );
+    TEST_ASSERT_NOT_NULL( pFile );
+
+    /* Reading one more byte than the file checks its size. */
+    TEST_ASSERT_EQUAL( OBJECT_SIZE, fread( pContents, 1U, OBJECT_SIZE + 1U, pFile ) );
+    TEST_ASSERT_EQUAL( 0, fclose( pFile ) );
+    TEST_ASSERT_EQUAL_MEMORY( object, pContents, OBJECT_SIZE );
+    TEST_ASSERT_EQUAL( 0, unlink( fileName ) );
+
+    free( pContents );
+}
+
+/*-----------------------------------------------------------*/
+
+static long runInProcessJobs( void )
+{
+    downloader_t downloader;
+    struct pollfd pollFd;
+    struct timespec start;
+    char url[ URL_BUFFER_SIZE ];
+    size_t received = 0U;
+    size_t total = 0U;
+    downloadStatus_t status = DownloadRunning;
+    uint32_t startedCount = 0U;
+    uint32_t doneCount = 0U;
+    uint32_t index = 0U;
+    long totalUs = 0L;
+
+    TEST_ASSERT_TRUE( downloaderInit( &downloader, SERVER_CERT_FILE_NAME ) );
+
+    pollFd.fd = downloader.eventfd;
+    pollFd.events = POLLIN;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+
+    while( doneCount < JOB_COUNT )
+    {
+        for( index = 0U; ( index < JOB_CONCURRENCY ) && ( startedCount < JOB_COUNT ); index++ )
+        {
+            if( slots[ index ].isRunning == false )
+            {
+                ( void ) clock_gettime( CLOCK_MONOTONIC, &slots[ index ].start );
+                TEST_ASSERT_TRUE( downloadStart( &downloader, &slots[ index ].download,
+                                                 url, jobUrl( url, startedCount ), IN_PROCESS_DIRECTORY ) );
+                slots[ index ].isRunning = true;
+                startedCount++;
+            }
+        }
+
+        /* The event descriptor is readable when a download has ended. */
+        TEST_ASSERT_EQUAL( 1, poll( &pollFd, 1, DOWNLOAD_WAIT_TIMEOUT_MS ) );
+        downloaderClearEvents( &downloader );
+
+        for( index = 0U; index < JOB_CONCURRENCY; index++ )
+        {
+            if( slots[ index ].isRunning == true )
+            {
+                status = downloadProgress( &slots[ index ].download, &received, &total );
+
+                if( status != DownloadRunning )
+                {
+                    turnarounds[ doneCount ] = microsecondsSince( &slots[ index ].start );
+                    TEST_ASSERT_EQUAL( DownloadSucceeded, status );
+                    TEST_ASSERT_EQUAL( OBJECT_SIZE, received );
+                    downloadStop( &slots[ index ].download );
+                    slots[ index ].isRunning = false;
+                    doneCount++;
+                }
+            }
+        }
+    }
+
+    totalUs = microsecondsSince( &start );
+    downloaderCleanup( &downloader );
+
+    return totalUs;
+}
+
+/*-----------------------------------------------------------*/
+
+static long runCurlJobs( void )
+{
+    struct timespec start;
+    char url[ URL_BUFFER_SIZE ];
+    pid_t child = -1;
+    int status = 0;
+    uint32_t startedCount = 0U;
+    uint32_t doneCount = 0U;
+    uint32_t index = 0U;
+    long totalUs = 0L;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+
+    while( doneCount < JOB_COUNT )
+    {
+        for( index = 0U; ( index < JOB_CONCURRENCY ) && ( startedCount < JOB_COUNT ); index++ )
+        {
+            if( slots[ index ].isRunning == false )
+            {
+                ( void ) jobUrl( url, startedCount );
+                ( void ) clock_gettime( CLOCK_MONOTONIC, &slots[ index ].start );
+                child = fork();
+
+                if( child == 0 )
+                {
+                    /* As the demo did, without its rate limit, and trusting
+                     * the certificate of the range server. */
+                    if( chdir( CURL_DIRECTORY ) == 0 )
+                    {
+                        ( void ) execl( CURL_PATH, "curl", "-OLsSN", "--cacert", "../" SERVER_CERT_FILE_NAME, url, NULL );
+                    }
+
+                    _exit( EXIT_FAILURE );
+                }
+
+                TEST_ASSERT_TRUE( child > 0 );
+                slots[ index ].child = child;
+                slots[ index ].isRunning = true;
+                startedCount++;
+            }
+        }
+
+        child = waitpid( -1, &status, 0 );
+        TEST_ASSERT_TRUE( child > 0 );
+        TEST_ASSERT_TRUE( WIFEXITED( status ) );
+        TEST_ASSERT_EQUAL( 0, WEXITSTATUS( status ) );
+
+        for( index = 0U; index < JOB_CONCURRENCY; index++ )
+        {
+            if( ( slots[ index ].isRunning == true ) && ( slots[ index ].child == child ) )
+            {
+                turnarounds[ doneCount ] = microsecondsSince( &slots[ index ].start );
+                slots[ index ].isRunning = false;
+                doneCount++;
+            }
+        }
+    }
+
+    totalUs = microsecondsSince( &start );
+
+    return totalUs;
+}
+
+/*-----------------------------------------------------------*/
+
+static int compareTurnarounds( const void * pFirst,
+                               const void * pSecond )
+{
+    long first = *( const long * ) pFirst;
+    long second = *( const long * ) pSecond;
+
+    return ( first > second ) - ( first < second );
+}
+
+/*-----------------------------------------------------------*/
+
+static void reportTurnarounds( const char * pName,
+                               long totalUs )
+{
+    long sumUs = 0L;
+    uint32_t index = 0U;
+
+    qsort( turnarounds, JOB_COUNT, sizeof( turnarounds[ 0 ] ), compareTurnarounds );
+
+    for( index = 0U; index < JOB_COUNT; index++ )
+    {
+        sumUs += turnarounds[ index ];
+    }
+
+    LogInfo( ( "%s: %u jobs of %u bytes, %u at a time: mean turnaround %ld us, p90 %ld us, "
+               "all jobs %ld us, %u TLS connections.",
+               pName,
+               ( unsigned ) JOB_COUNT,
+               ( unsigned ) OBJECT_SIZE,
+               ( unsigned ) JOB_CONCURRENCY,
+               sumUs / ( long ) JOB_COUNT,
+               turnarounds[ ( ( JOB_COUNT * 9U ) / 10U ) - 1U ],
+               totalUs,
+               ( unsigned ) __atomic_load_n( &tlsConnectionCount, __ATOMIC_ACQUIRE ) ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t countOpenDescriptors( void )
+{
+    DIR * pDirectory = NULL;
+    uint32_t count = 0U;
+
+    pDirectory = opendir( "/proc/self/fd" );
+    TEST_ASSERT_NOT_NULL( pDirectory );
+
+    while( readdir( pDirectory ) != NULL )
+    {
+        count++;
+    }
+
+    ( void ) closedir( pDirectory );
+
+    return count;
+}
+
+/*-----------------------------------------------------------*/
+
+static long microsecondsSince( const struct timespec * pStart )
+{
+    struct timespec end;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &end );
+
+    return ( ( end.tv_sec - pStart->tv_sec ) * MICROSECONDS_PER_SECOND ) +
+           ( ( end.tv_nsec - pStart->tv_nsec ) / NANOSECONDS_PER_MICROSECOND );
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    struct sockaddr_in address = { 0 };
+    socklen_t addressLength = sizeof( address );
+    EVP_PKEY * pKey = NULL;
+    X509 * pCert = NULL;
+    uint32_t index = 0U;
+
+    if( pServerContext == NULL )
+    {
+        /* The other certificate is only written, never presented. */
+        pCert = createCertificate( OTHER_CERT_FILE_NAME, &pKey );
+        TEST_ASSERT_NOT_NULL( pCert );
+        X509_free( pCert );
+        EVP_PKEY_free( pKey );
+
+        pCert = createCertificate( SERVER_CERT_FILE_NAME, &pKey );
+        TEST_ASSERT_NOT_NULL( pCert );
+
+        pServerContext = SSL_CTX_new( TLS_server_method() );
+        TEST_ASSERT_NOT_NULL( pServerContext );
+        TEST_ASSERT_EQUAL( 1, SSL_CTX_use_certificate( pServerContext, pCert ) );
+        TEST_ASSERT_EQUAL( 1, SSL_CTX_use_PrivateKey( pServerContext, pKey ) );
+        X509_free( pCert );
+        EVP_PKEY_free( pKey );
+    }
+
+    srand( 1U );
+
+    for( index = 0U; index < OBJECT_SIZE; index++ )
+    {
+        object[ index ] = ( uint8_t ) rand();
+    }
+
+    ( void ) memset( slots, 0, sizeof( slots ) );
+    ( void ) memset( turnarounds, 0, sizeof( turnarounds ) );
+    __atomic_store_n( &tlsConnectionCount, 0U, __ATOMIC_RELEASE );
+    __atomic_store_n( &isServerStopping, 0U, __ATOMIC_RELEASE );
+
+    ( void ) mkdir( IN_PROCESS_DIRECTORY, 0755 );
+    ( void ) mkdir( CURL_DIRECTORY, 0755 );
+
+    serverSocket = socket( AF_INET, SOCK_STREAM, 0 );
+    TEST_ASSERT_TRUE( serverSocket >= 0 );
+
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = inet_addr( SERVER_ADDRESS );
+    address.sin_port = 0;
+
+    TEST_ASSERT_EQUAL( 0, bind( serverSocket, ( struct sockaddr * ) &address, sizeof( address ) ) );
+    TEST_ASSERT_EQUAL( 0, listen( serverSocket, ( int ) ( 2U * JOB_CONCURRENCY ) ) );
+    TEST_ASSERT_EQUAL( 0, getsockname( serverSocket, ( struct sockaddr * ) &address, &addressLength ) );
+    serverPort = ntohs( address.sin_port );
+
+    TEST_ASSERT_EQUAL( 0, pthread_create( &serverThread, NULL, serverRoutine, NULL ) );
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+    __atomic_store_n( &isServerStopping, 1U, __ATOMIC_RELEASE );
+    ( void ) pthread_join( serverThread, NULL );
+    ( void ) close( serverSocket );
+    serverSocket = -1;
+
+    /* The connection threads end when the clients close their connections. */
+    while( __atomic_load_n( &activeConnections, __ATOMIC_ACQUIRE ) > 0U )
+    {
+        ( void ) usleep( 1000U );
+    }
+
+    ( void ) rmdir( IN_PROCESS_DIRECTORY );
+    ( void ) rmdir( CURL_DIRECTORY );
+}
+
+/* ========================== Test Cases ============================ */
+
+/**
+ * @brief Runs the same jobs with the in-process downloader and with curl,
+ * and compares their turnaround.
+ */
+void test_JobsDownload_TurnaroundAgainstCurl( void )
+{
+    long totalUs = 0L;
+    uint32_t index = 0U;
+
+    totalUs = runInProcessJobs();
+    reportTurnarounds( "In process", totalUs );
+
+    for( index = 0U; index < JOB_COUNT; index++ )
+    {
+        checkJobFile( IN_PROCESS_DIRECTORY, index );
+    }
+
+    __atomic_store_n( &tlsConnectionCount, 0U, __ATOMIC_RELEASE );
+
+    totalUs = runCurlJobs();
+    reportTurnarounds( "fork+curl", totalUs );
+
+    for( index = 0U; index < JOB_COUNT; index++ )
+    {
+        checkJobFile( CURL_DIRECTORY, index );
+    }
+}
+
+/**
+ * @brief Fails the TLS handshake of every connection of a download, by
+ * trusting another certificate than the server's, and checks that the
+ * connections are closed.
+ */
+void test_JobsDownload_FailedHandshakeClosesConnections( void )
+{
+    downloader_t downloader;
+    download_t download;
+    struct pollfd pollFd;
+    char url[ URL_BUFFER_SIZE ];
+    char fileName[ URL_BUFFER_SIZE ];
+    size_t received = 0U;
+    size_t total = 0U;
+    uint32_t descriptorCount = 0U;
+
+    TEST_ASSERT_TRUE( downloaderInit( &downloader, OTHER_CERT_FILE_NAME ) );
+    descriptorCount = countOpenDescriptors();
+
+    TEST_ASSERT_TRUE( downloadStart( &downloader, &download, url, jobUrl( url, 0U ), IN_PROCESS_DIRECTORY ) );
+
+    pollFd.fd = downloader.eventfd;
+    pollFd.events = POLLIN;
+    TEST_ASSERT_EQUAL( 1, poll( &pollFd, 1, DOWNLOAD_WAIT_TIMEOUT_MS ) );
+    downloaderClearEvents( &downloader );
+
+    TEST_ASSERT_EQUAL( DownloadFailed, downloadProgress( &download, &received, &total ) );
+    downloadStop( &download );
+
+    TEST_ASSERT_EQUAL( descriptorCount, countOpenDescriptors() );
+    TEST_ASSERT_EQUAL( 0U, downloader.idleCount );
+
+    downloaderCleanup( &downloader );
+
+    ( void ) snprintf( fileName, sizeof( fileName ), "%s/job-0.bin", IN_PROCESS_DIRECTORY );
+    ( void ) unlink( fileName );
+}
@@ -0,0 +1,959 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file s3_signing_test.c
+ * @brief Tests that the signing context of the S3 download demo signs range
+ * requests as the demo did before it, and benchmarks the cost of signing and
+ * the requests per second of a download signed either way.
+ */
+
+/* Standard header includes. */
+#include <string.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+/* POSIX includes. */
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/* Include config file before other non-system includes. */
+#include "test_config.h"
+
+/* Unity testing framework includes. */
+#include "unity.h"
+
+/* Include plaintext implementation of transport interface. */
+#include "plaintext_posix.h"
+
+/* Include the S3 utilities of the S3 download demo. */
+#include "http_demo_s3_utils.h"
+
+/**
+ * @brief Address the range server listens on.
+ */
+#define SERVER_ADDRESS                   "127.0.0.1"
+
+/**
+ * @brief Length of #SERVER_ADDRESS.
+ */
+#define SERVER_ADDRESS_LENGTH            ( sizeof( SERVER_ADDRESS ) - 1U )
+
+/**
+ * @brief Request of the example of the AWS documentation of SigV4 signed S3
+ * GET requests.
+ */
+#define OBJECT_HOST                      "examplebucket.s3.amazonaws.com"
+#define OBJECT_PATH                      "/test.txt"
+#define ACCESS_KEY_ID                    "AKIDEXAMPLE"
+#define SECRET_ACCESS_KEY                "wJalrXUtnFEMI/K7MDENG+bPxRfiCYEXAMPLEKEY"
+#define REQUEST_DATE                     "20130524T000000Z"
+#define AWS_REGION                       "us-east-1"
+#define AWS_S3_SERVICE_NAME              "s3"
+
+/**
+ * @brief Length of the security token of the tests that use one, close to
+ * the length of the tokens of the AWS IoT credential provider.
+ */
+#define SECURITY_TOKEN_LENGTH            ( 1000U )
+
+/**
+ * @brief Length of the buffers of the request headers, as in the S3 download
+ * demo.
+ */
+#define REQUEST_BUFFER_LENGTH            ( 4096U )
+
+/**
+ * @brief Length of the buffer of an Authorization header value signed the
+ * way the demo did before the signing context.
+ */
+#define AUTHORIZATION_BUFFER_LENGTH      ( 2048U )
+
+/**
+ * @brief Size of the object served by the range server.
+ */
+#define OBJECT_SIZE                      ( 4U * 1024U * 1024U )
+
+/**
+ * @brief Number of bytes requested by each range request, as in the S3
+ * download demo.
+ */
+#define RANGE_REQUEST_LENGTH             ( 2048U )
+
+/**
+ * @brief Number of requests signed each way to measure the cost of signing.
+ */
+#define SIGNING_ROUNDS                   ( 20000U )
+
+/**
+ * @brief Number of times the object is downloaded each way. The two ways
+ * alternate, so that both see the same system load.
+ */
+#define DOWNLOAD_ROUNDS                  ( 3U )
+
+/**
+ * @brief Length of the buffer receiving the request headers at the range
+ * server.
+ */
+#define SERVER_REQUEST_BUFFER_LENGTH     ( 4096U )
+
+/**
+ * @brief Interval at which the range server checks for the end of a test.
+ */
+#define SERVER_POLL_INTERVAL_MS          ( 50 )
+
+/**
+ * @brief The start of the Authorization header of a signed request.
+ */
+#define AUTHORIZATION_HEADER_PREFIX      "Authorization: AWS4-HMAC-SHA256 "
+
+/**
+ * @brief Field name of the HTTP Authorization header, as in the S3 download
+ * demo.
+ */
+#define SIGV4_AUTH_HEADER_FIELD_NAME     "Authorization"
+
+/**
+ * @brief Number of nanoseconds in a microsecond.
+ */
+#define NANOSECONDS_PER_MICROSECOND      ( 1000L )
+
+/**
+ * @brief Number of microseconds in a second.
+ */
+#define MICROSECONDS_PER_SECOND          ( 1000000L )
+
+/*-----------------------------------------------------------*/
+
+/* Each compilation unit must define the NetworkContext struct. */
+struct NetworkContext
+{
+    PlaintextParams_t * pParams;
+};
+
+/**
+ * @brief Writes the headers of a range request, with its Authorization
+ * header.
+ */
+typedef bool ( * PrepareRequest_t )( HTTPRequestHeaders_t * pRequestHeaders,
+                                     size_t rangeStart,
+                                     size_t rangeEnd );
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The ranges the signatures are compared for.
+ */
+static const size_t ranges[][ 2 ] =
+{
+    { 0U,          0U          },
+    { 0U,          2047U       },
+    { 2048U,       4095U       },
+    { 1048576U,    1050623U    },
+    { 123456789U,  123458836U  },
+    { 2147481600U, 2147483646U }
+};
+
+/**
+ * @brief Request of the object, kept alive across ranges.
+ */
+static const HTTPRequestInfo_t requestInfo =
+{
+    HTTP_METHOD_GET, sizeof( HTTP_METHOD_GET ) - 1U,
+    OBJECT_PATH,     sizeof( OBJECT_PATH ) - 1U,
+    OBJECT_HOST,     sizeof( OBJECT_HOST ) - 1U,
+    HTTP_REQUEST_KEEP_ALIVE_FLAG
+};
+
+/**
+ * @brief The credentials and the date of the requests.
+ */
+static SigV4Credentials_t credentials =
+{
+    ACCESS_KEY_ID,     sizeof( ACCESS_KEY_ID ) - 1U,
+    SECRET_ACCESS_KEY, sizeof( SECRET_ACCESS_KEY ) - 1U
+};
+static char securityToken[ SECURITY_TOKEN_LENGTH ];
+static size_t securityTokenLength = 0U;
+
+/**
+ * @brief Signing parameters of the requests, as set up by the S3 download
+ * demo.
+ */
+static SigV4Parameters_t sigv4Params;
+
+/**
+ * @brief The signing context of the requests, and the length of the headers
+ * every request carries.
+ */
+static S3SigningContext_t signingContext;
+static size_t commonHeadersLength = 0U;
+
+/**
+ * @brief The object served by the range server, and the downloaded copy.
+ */
+static uint8_t object[ OBJECT_SIZE ];
+static uint8_t downloaded[ OBJECT_SIZE ];
+
+/**
+ * @brief State of the range server.
+ */
+static int serverSocket = -1;
+static uint16_t serverPort = 0U;
+static pthread_t serverThread;
+static uint32_t isServerStopping = 0U;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Hex encode a digest, in lower case as SigV4 expects.
+ *
+ * @param[in] pInput The digest.
+ * @param[in] inputLength Length of the digest.
+ * @param[out] pHex Buffer of twice @p inputLength characters.
+ */
+static void encodeHex( const uint8_t * pInput,
+                       size_t inputLength,
+                       char * pHex );
+
+/**
+ * @brief Write the headers that every range request carries, as the S3
+ * download demo does before its first range.
+ *
+ * @param[out] pRequestHeaders The request headers.
+ *
+ * @return true on success; false otherwise.
+ */
+static bool addCommonHeaders( HTTPRequestHeaders_t * pRequestHeaders );
+
+/**
+ * @brief Write a range request after the common headers and sign it with
+ * #signingContext, as the S3 download demo does.
+ *
+ * @param[in,out] pRequestHeaders Request headers written by
+ * #addCommonHeaders.
+ * @param[in] rangeStart First byte of the range.
+ * @param[in] rangeEnd Last byte of the range.
+ * @param[out] pAuthorization The Authorization header value.
+ * @param[out] pAuthorizationLength Length of the Authorization header value.
+ *
+ * @return true on success; false otherwise.
+ */
+static bool signWithContext( HTTPRequestHeaders_t * pRequestHeaders,
+                             size_t rangeStart,
+                             size_t rangeEnd,
+                             const char ** pAuthorization,
+                             size_t * pAuthorizationLength );
+
+/**
+ * @brief Write and sign a range request the way the S3 download demo did
+ * before the signing context: all the headers are written for every range,
+ * and SigV4_GenerateHTTPAuthorization() hashes the empty payload.
+ *
+ * @param[out] pRequestHeaders The request headers.
+ * @param[in] rangeStart First byte of the range.
+ * @param[in] rangeEnd Last byte of the range.
+ * @param[out] pAuthorization Buffer of #AUTHORIZATION_BUFFER_LENGTH bytes
+ * for the Authorization header value.
+ * @param[out] pAuthorizationLength Length of the Authorization header value.
+ *
+ * @return true on success; false otherwise.
+ */
+static bool signAsBefore( HTTPRequestHeaders_t * pRequestHeaders,
+                          size_t rangeStart,
+                          size_t rangeEnd,
+                          char * pAuthorization,
+                          size_t * pAuthorizationLength );
+
+/**
+ * @brief Compare the Authorization header values of both ways of signing
+ * for each of #ranges.
+ */
+static void compareSignatures( void );
+
+/**
+ * @brief #PrepareRequest_t of the signing context.
+ */
+static bool prepareWithContext( HTTPRequestHeaders_t * pRequestHeaders,
+                                size_t rangeStart,
+                                size_t rangeEnd );
+
+/**
+ * @brief #PrepareRequest_t of the way the demo signed before the signing
+ * context.
+ */
+static bool prepareAsBefore( HTTPRequestHeaders_t * pRequestHeaders,
+                             size_t rangeStart,
+                             size_t rangeEnd );
+
+/**
+ * @brief Answer the range requests of a connection until it is closed.
+ * Requests without an Authorization header close the connection.
+ *
+ * @param[in] connectionSocket The accepted connection.
+ */
+static void serveRangeRequests( int connectionSocket );
+
+/**
+ * @brief Accept connections on #serverSocket and serve them one at a time,
+ * until #isServerStopping is set.
+ *
+ * @param[in] pArgs Unused.
+ *
+ * @return NULL.
+ */
+static void * serverThreadRoutine( void * pArgs );
+
+/**
+ * @brief Download the object from the range server over one connection,
+ * signing every range request, and check the downloaded copy.
+ *
+ * @param[in] prepareRequest Writes and signs each request.
+ *
+ * @return The duration of the download in microseconds.
+ */
+static long timeDownload( PrepareRequest_t prepareRequest );
+
+/**
+ * @brief Microseconds elapsed since a time.
+ *
+ * @param[in] pStart The time.
+ *
+ * @return The microseconds elapsed since @p pStart.
+ */
+static long microsecondsSince( const struct timespec * pStart );
+
+/*-----------------------------------------------------------*/
+
+static void encodeHex( const uint8_t * pInput,
+                       size_t inputLength,
+                       char * pHex )
+{
+    static const char digits[] = "0123456789abcdef";
+    size_t index = 0U;
+
+    for( index = 0U; index < inputLength; index++ )
+    {
+        pHex[ 2U * index ] = digits[ pInput[ index ] >> 4 ];
+        pHex[ ( 2U * index ) + 1U ] = digits[ pInput[ index ] & 0x0FU ];
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static bool addCommonHeaders( HTTPRequestHeaders_t * pRequestHeaders )
+{
+    bool returnStatus = false;
+
+    returnStatus = ( HTTPClient_InitializeRequestHeaders( pRequestHeaders,
+                                                          &requestInfo ) == HTTPSuccess ) &&
+                   ( HTTPClient_AddHeader( pRequestHeaders,
+                                           SIGV4_HTTP_X_AMZ_DATE_HEADER,
+                                           sizeof( SIGV4_HTTP_X_AMZ_DATE_HEADER ) - 1U,
+                                           REQUEST_DATE,
+                                           SIGV4_ISO_STRING_LEN ) == HTTPSuccess );
+
+    if( ( returnStatus == true ) && ( securityTokenLength > 0U ) )
+    {
+        returnStatus = ( HTTPClient_AddHeader( pRequestHeaders,
+                                               SIGV4_HTTP_X_AMZ_SECURITY_TOKEN_HEADER,
+                                               sizeof( SIGV4_HTTP_X_AMZ_SECURITY_TOKEN_HEADER ) - 1U,
+                                               securityToken,
+                                               securityTokenLength ) == HTTPSuccess );
+    }
+
+    if( returnStatus == true )
+    {
+        returnStatus = ( HTTPClient_AddHeader( pRequestHeaders,
+                                               SIGV4_HTTP_X_AMZ_CONTENT_SHA256_HEADER,
+                                               sizeof( SIGV4_HTTP_X_AMZ_CONTENT_SHA256_HEADER ) - 1U,
+                                               signingContext.payloadHash,
+                                               HEX_ENCODED_SHA256_HASH_DIGEST_LENGTH ) == HTTPSuccess );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool signWithContext( HTTPRequestHeaders_t * pRequestHeaders,
+                             size_t rangeStart,
+                             size_t rangeEnd,
+                             const char ** pAuthorization,
+                             size_t * pAuthorizationLength )
+{
+    /* Drop the Range and Authorization headers of the previous request. */
+    pRequestHeaders->headersLen = commonHeadersLength;
+
+    return ( HTTPClient_AddRangeHeader( pRequestHeaders,
+                                        ( int32_t ) rangeStart,
+                                        ( int32_t ) rangeEnd ) == HTTPSuccess ) &&
+           ( s3SignRangeRequest( &signingContext,
+                                 pRequestHeaders,
+                                 pAuthorization,
+                                 pAuthorizationLength ) == true );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool signAsBefore( HTTPRequestHeaders_t * pRequestHeaders,
+                          size_t rangeStart,
+                          size_t rangeEnd,
+                          char * pAuthorization,
+                          size_t * pAuthorizationLength )
+{
+    mbedtls_sha256_context hashContext;
+    SigV4CryptoInterface_t cryptoInterface = { 0 };
+    SigV4HttpParameters_t httpParams = { 0 };
+    SigV4Parameters_t params = { 0 };
+    uint8_t payloadDigest[ SHA256_HASH_DIGEST_LENGTH ];
+    char payloadHash[ HEX_ENCODED_SHA256_HASH_DIGEST_LENGTH ];
+    char * pHeaders = NULL;
+    size_t headersLength = 0U;
+    char * pSignature = NULL;
+    size_t signatureLength = 0U;
+    bool returnStatus = false;
+
+    /* The headers were written in this order for every range. */
+    returnStatus = ( HTTPClient_InitializeRequestHeaders( pRequestHeaders,
+                                                          &requestInfo ) == HTTPSuccess ) &&
+                   ( HTTPClient_AddHeader( pRequestHeaders,
+                                           SIGV4_HTTP_X_AMZ_DATE_HEADER,
+                                           sizeof( SIGV4_HTTP_X_AMZ_DATE_HEADER ) - 1U,
+                                           REQUEST_DATE,
+                                           SIGV4_ISO_STRING_LEN ) == HTTPSuccess );
+
+    if( ( returnStatus == true ) && ( securityTokenLength > 0U ) )
+    {
+        returnStatus = ( HTTPClient_AddHeader( pRequestHeaders,
+                                               SIGV4_HTTP_X_AMZ_SECURITY_TOKEN_HEADER,
+                                               sizeof( SIGV4_HTTP_X_AMZ_SECURITY_TOKEN_HEADER ) - 1U,
+                                               securityToken,
+                                               securityTokenLength ) == HTTPSuccess );
+    }
+
+    if( returnStatus == true )
+    {
+        returnStatus = ( HTTPClient_AddRangeHeader( pRequestHeaders,
+                                                    ( int32_t ) rangeStart,
+                                                    ( int32_t ) rangeEnd ) == HTTPSuccess ) &&
+                       ( sha256( "", 0U, ( char * ) payloadDigest ) == 0 );
+    }
+
+    if( returnStatus == true )
+    {
+        encodeHex( payloadDigest, sizeof( payloadDigest ), payloadHash );
+        returnStatus = ( HTTPClient_AddHeader( pRequestHeaders,
+                                               SIGV4_HTTP_X_AMZ_CONTENT_SHA256_HEADER,
+                                               sizeof( SIGV4_HTTP_X_AMZ_CONTENT_SHA256_HEADER ) - 1U,
+                                               payloadHash,
+                                               sizeof( payloadHash ) ) == HTTPSuccess );
+    }
+
+    if( returnStatus == true )
+    {
+        getHeaderStartLocFromHttpRequest( *pRequestHeaders, &pHeaders, &headersLength );
+
+        cryptoInterface.hashInit = sha256Init;
+        cryptoInterface.hashUpdate = sha256Update;
+        cryptoInterface.hashFinal = sha256Final;
+        cryptoInterface.pHashContext = &hashContext;
+        cryptoInterface.hashBlockLen = HEX_ENCODED_SHA256_HASH_DIGEST_LENGTH;
+        cryptoInterface.hashDigestLen = SHA256_HASH_DIGEST_LENGTH;
+
+        httpParams.pHttpMethod = HTTP_METHOD_GET;
+        httpParams.httpMethodLen = sizeof( HTTP_METHOD_GET ) - 1U;
+        httpParams.flags = 0U;
+        httpParams.pPath = OBJECT_PATH;
+        httpParams.pathLen = sizeof( OBJECT_PATH ) - 1U;
+        httpParams.pHeaders = pHeaders;
+        httpParams.headersLen = headersLength;
+        httpParams.pPayload = "";
+        httpParams.payloadLen = 0U;
+
+        params = sigv4Params;
+        params.pCryptoInterface = &cryptoInterface;
+        params.pHttpParameters = &httpParams;
+
+        *pAuthorizationLength = AUTHORIZATION_BUFFER_LENGTH;
+        returnStatus = ( SigV4_GenerateHTTPAuthorization( &params,
+                                                          pAuthorization,
+                                                          pAuthorizationLength,
+                                                          &pSignature,
+                                                          &signatureLength ) == SigV4Success );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void compareSignatures( void )
+{
+    static uint8_t contextBuffer[ REQUEST_BUFFER_LENGTH ];
+    static uint8_t referenceBuffer[ REQUEST_BUFFER_LENGTH ];
+    static char referenceAuthorization[ AUTHORIZATION_BUFFER_LENGTH ];
+    HTTPRequestHeaders_t contextHeaders = { 0 };
+    HTTPRequestHeaders_t referenceHeaders = { 0 };
+    const char * pAuthorization = NULL;
+    size_t authorizationLength = 0U;
+    size_t referenceLength = 0U;
+    size_t index = 0U;
+
+    contextHeaders.pBuffer = contextBuffer;
+    contextHeaders.bufferLen = sizeof( contextBuffer );
+    referenceHeaders.pBuffer = referenceBuffer;
+    referenceHeaders.bufferLen = sizeof( referenceBuffer );
+
+    TEST_ASSERT_TRUE( addCommonHeaders( &contextHeaders ) );
+    commonHeadersLength = contextHeaders.headersLen;
+
+    for( index = 0U; index < ( sizeof( ranges ) / sizeof( ranges[ 0 ] ) ); index++ )
+    {
+        TEST_ASSERT_TRUE( signWithContext( &contextHeaders,
+                                           ranges[ index ][ 0 ],
+                                           ranges[ index ][ 1 ],
+                                           &pAuthorization,
+                                           &authorizationLength ) );
+        TEST_ASSERT_TRUE( signAsBefore( &referenceHeaders,
+                                        ranges[ index ][ 0 ],
+                                        ranges[ index ][ 1 ],
+                                        referenceAuthorization,
+                                        &referenceLength ) );
+
+        /* Both requests carry the same headers, in a different order. */
+        TEST_ASSERT_EQUAL( referenceHeaders.headersLen, contextHeaders.headersLen );
+        TEST_ASSERT_EQUAL( referenceLength, authorizationLength );
+        TEST_ASSERT_EQUAL_MEMORY( referenceAuthorization, pAuthorization, referenceLength );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prepareWithContext( HTTPRequestHeaders_t * pRequestHeaders,
+                                size_t rangeStart,
+                                size_t rangeEnd )
+{
+    const char * pAuthorization = NULL;
+    size_t authorizationLength = 0U;
+
+    return ( signWithContext( pRequestHeaders,
+                              rangeStart,
+                              rangeEnd,
+                              &pAuthorization,
+                              &authorizationLength ) == true ) &&
+           ( HTTPClient_AddHeader( pRequestHeaders,
+                                   SIGV4_AUTH_HEADER_FIELD_NAME,
+                                   sizeof( SIGV4_AUTH_HEADER_FIELD_NAME ) - 1U,
+                                   pAuthorization,
+                                   authorizationLength ) == HTTPSuccess );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prepareAsBefore( HTTPRequestHeaders_t * pRequestHeaders,
+                             size_t rangeStart,
+                             size_t rangeEnd )
+{
+    static char authorization[ AUTHORIZATION_BUFFER_LENGTH ];
+    size_t authorizationLength = 0U;
+
+    return ( signAsBefore( pRequestHeaders,
+                           rangeStart,
+                           rangeEnd,
+                           authorization,
+                           &authorizationLength ) == true ) &&
+           ( HTTPClient_AddHeader( pRequestHeaders,
+                                   SIGV4_AUTH_HEADER_FIELD_NAME,
+                                   sizeof( SIGV4_AUTH_HEADER_FIELD_NAME ) - 1U,
+                                   authorization,
+                                   authorizationLength ) == HTTPSuccess );
+}
+
+/*-----------------------------------------------------------*/
+
+static void serveRangeRequests( int connectionSocket )
+{
+    char request[ SERVER_REQUEST_BUFFER_LENGTH + 1U ];
+    char headers[ SERVER_REQUEST_BUFFER_LENGTH ];
+    struct pollfd pollFd = { 0 };
+    size_t requestLength = 0U;
+    size_t headersLength = 0U;
+    size_t rangeStart = 0U;
+    size_t rangeEnd = 0U;
+    ssize_t bytesReceived = 0;
+    char * pRange = NULL;
+    bool isOpen = true;
+
+    pollFd.fd = connectionSocket;
+    pollFd.events = POLLIN;
+
+    while( ( isOpen == true ) &&
+           ( __atomic_load_n( &isServerStopping, __ATOMIC_ACQUIRE ) == 0U ) )
+    {
+        if( poll( &pollFd, 1U, SERVER_POLL_INTERVAL_MS ) <= 0 )
+        {
+            continue;
+        }
+
+        bytesReceived = recv( connectionSocket,
+                              &request[ requestLength ],
+                              SERVER_REQUEST_BUFFER_LENGTH - requestLength,
+                              0 );
+
+        if( bytesReceived <= 0 )
+        {
+            break;
+        }
+
+        requestLength += ( size_t ) bytesReceived;
+        request[ requestLength ] = '\0';
+
+        if( strstr( request, "\r\n\r\n" ) == NULL )
+        {
+            /* Assertions are left to the test thread; a request that does not
+             * fit the buffer closes the connection, and fails the download. */
+            isOpen = ( requestLength < SERVER_REQUEST_BUFFER_LENGTH );
+            continue;
+        }
+
+        pRange = strstr( request, "Range: bytes=" );
+
+        if( pRange != NULL )
+        {
+            rangeStart = strtoul( pRange + sizeof( "Range: bytes=" ) - 1U, &pRange, 10 );
+            rangeEnd = strtoul( pRange + 1, NULL, 10 );
+        }
+
+        if( ( pRange == NULL ) || ( rangeStart > rangeEnd ) || ( rangeEnd >= OBJECT_SIZE ) ||
+            ( strstr( request, AUTHORIZATION_HEADER_PREFIX ) == NULL ) )
+        {
+            break;
+        }
+
+        headersLength = ( size_t ) snprintf( headers,
+                                             sizeof( headers ),
+                                             "HTTP/1.1 206 Partial Content\r\n"
+                                             "Content-Length: %lu\r\n"
+                                             "Content-Range: bytes %lu-%lu/%lu\r\n"
+                                             "Connection: keep-alive\r\n\r\n",
+                                             ( unsigned long ) ( rangeEnd - rangeStart + 1U ),
+                                             ( unsigned long ) rangeStart,
+                                             ( unsigned long ) rangeEnd,
+                                             ( unsigned long ) OBJECT_SIZE );
+
+        isOpen = ( send( connectionSocket, headers, headersLength, MSG_MORE | MSG_NOSIGNAL ) == ( ssize_t ) headersLength ) &&
+                 ( send( connectionSocket, &object[ rangeStart ], rangeEnd - rangeStart + 1U, MSG_NOSIGNAL ) == ( ssize_t ) ( rangeEnd - rangeStart + 1U ) );
+
+        /* Requests are only sent once the previous response is received. */
+        requestLength = 0U;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void * serverThreadRoutine( void * pArgs )
+{
+    struct pollfd pollFd = { 0 };
+    int connectionSocket = -1;
+
+    ( void ) pArgs;
+
+    pollFd.fd = serverSocket;
+    pollFd.events = POLLIN;
+
+    while( __atomic_load_n( &isServerStopping, __ATOMIC_ACQUIRE ) == 0U )
+    {
+        if( poll( &pollFd, 1U, SERVER_POLL_INTERVAL_MS ) <= 0 )
+        {
+            continue;
+        }
+
+        connectionSocket = accept( serverSocket, NULL, NULL );
+
+        if( connectionSocket >= 0 )
+        {
+            serveRangeRequests( connectionSocket );
+            ( void ) close( connectionSocket );
+        }
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static long timeDownload( PrepareRequest_t prepareRequest )
+{
+    static uint8_t requestBuffer[ REQUEST_BUFFER_LENGTH ];
+    static uint8_t responseBuffer[ REQUEST_BUFFER_LENGTH ];
+    PlaintextParams_t plaintextParams = { 0 };
+    NetworkContext_t networkContext = { 0 };
+    TransportInterface_t transportInterface = { 0 };
+    ServerInfo_t serverInfo = { SERVER_ADDRESS, SERVER_ADDRESS_LENGTH, 0U };
+    HTTPRequestHeaders_t requestHeaders = { 0 };
+    HTTPResponse_t response = { 0 };
+    struct timespec start;
+    long elapsed = 0L;
+    size_t offset = 0U;
+    bool isDownloading = true;
+
+    networkContext.pParams = &plaintextParams;
+    transportInterface.pNetworkContext = &networkContext;
+    transportInterface.send = Plaintext_Send;
+    transportInterface.recv = Plaintext_Recv;
+    serverInfo.port = serverPort;
+
+    requestHeaders.pBuffer = requestBuffer;
+    requestHeaders.bufferLen = sizeof( requestBuffer );
+
+    ( void ) memset( downloaded, 0, sizeof( downloaded ) );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, Plaintext_Connect( &networkContext,
+                                                           &serverInfo,
+                                                           TRANSPORT_SEND_RECV_TIMEOUT_MS,
+                                                           TRANSPORT_SEND_RECV_TIMEOUT_MS ) );
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+
+    /* The signing context is set up once per object, as in the demo. */
+    isDownloading = ( s3SigningContextInit( &signingContext,
+                                            &sigv4Params,
+                                            OBJECT_PATH,
+                                            sizeof( OBJECT_PATH ) - 1U ) == true ) &&
+                    ( addCommonHeaders( &requestHeaders ) == true );
+    commonHeadersLength = requestHeaders.headersLen;
+
+    for( offset = 0U; ( isDownloading == true ) && ( offset < OBJECT_SIZE ); offset += RANGE_REQUEST_LENGTH )
+    {
+        ( void ) memset( &response, 0, sizeof( response ) );
+        response.pBuffer = responseBuffer;
+        response.bufferLen = sizeof( responseBuffer );
+
+        isDownloading = ( prepareRequest( &requestHeaders,
+                                          offset,
+                                          offset + RANGE_REQUEST_LENGTH - 1U ) == true ) &&
+                        ( HTTPClient_Send( &transportInterface,
+                                           &requestHeaders,
+                                           NULL,
+                                           0,
+                                           &response,
+                                           HTTP_SEND_DISABLE_CONTENT_LENGTH_FLAG ) == HTTPSuccess ) &&
+                        ( response.statusCode == 206U ) &&
+                        ( response.bodyLen == RANGE_REQUEST_LENGTH );
+
+        if( isDownloading == true )
+        {
+            ( void ) memcpy( &downloaded[ offset ], response.pBody, RANGE_REQUEST_LENGTH );
+        }
+    }
+
+    elapsed = microsecondsSince( &start );
+    ( void ) Plaintext_Disconnect( &networkContext );
+
+    TEST_ASSERT_TRUE( isDownloading );
+    TEST_ASSERT_EQUAL_MEMORY( object, downloaded, OBJECT_SIZE );
+
+    return elapsed;
+}
+
+/*-----------------------------------------------------------*/
+
+static long microsecondsSince( const struct timespec * pStart )
+{
+    struct timespec end;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &end );
+
+    return ( ( end.tv_sec - pStart->tv_sec ) * MICROSECONDS_PER_SECOND ) +
+           ( ( end.tv_nsec - pStart->tv_nsec ) / NANOSECONDS_PER_MICROSECOND );
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    struct sockaddr_in address = { 0 };
+    socklen_t addressLength = sizeof( address );
+    size_t index = 0U;
+
+    ( void ) memset( &sigv4Params, 0, sizeof( sigv4Params ) );
+    sigv4Params.pCredentials = &credentials;
+    sigv4Params.pDateIso8601 = REQUEST_DATE;
+    sigv4Params.pRegion = AWS_REGION;
+    sigv4Params.regionLen = sizeof( AWS_REGION ) - 1U;
+    sigv4Params.pService = AWS_S3_SERVICE_NAME;
+    sigv4Params.serviceLen = sizeof( AWS_S3_SERVICE_NAME ) - 1U;
+    TEST_ASSERT_TRUE( s3SigningContextInit( &signingContext,
+                                            &sigv4Params,
+                                            OBJECT_PATH,
+                                            sizeof( OBJECT_PATH ) - 1U ) );
+
+    /* A token of the characters of the base64 alphabet. */
+    for( index = 0U; index < SECURITY_TOKEN_LENGTH; index++ )
+    {
+        securityToken[ index ] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"[ ( index * 37U ) % 64U ];
+    }
+
+    securityTokenLength = 0U;
+
+    for( index = 0U; index < OBJECT_SIZE; index++ )
+    {
+        object[ index ] = ( uint8_t ) ( ( index * 7U ) + ( index >> 11 ) );
+    }
+
+    serverSocket = socket( AF_INET, SOCK_STREAM, 0 );
+    TEST_ASSERT_NOT_EQUAL( -1, serverSocket );
+    address.sin_family = AF_INET;
+    TEST_ASSERT_EQUAL( 1, inet_pton( AF_INET, SERVER_ADDRESS, &address.sin_addr ) );
+    TEST_ASSERT_EQUAL( 0, bind( serverSocket, ( struct sockaddr * ) &address, sizeof( address ) ) );
+    TEST_ASSERT_EQUAL( 0, listen( serverSocket, 1 ) );
+    TEST_ASSERT_EQUAL( 0, getsockname( serverSocket, ( struct sockaddr * ) &address, &addressLength ) );
+    serverPort = ntohs( address.sin_port );
+
+    __atomic_store_n( &isServerStopping, 0U, __ATOMIC_RELEASE );
+    TEST_ASSERT_EQUAL( 0, pthread_create( &serverThread, NULL, serverThreadRoutine, NULL ) );
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+    __atomic_store_n( &isServerStopping, 1U, __ATOMIC_RELEASE );
+    ( void ) pthread_join( serverThread, NULL );
+    ( void ) close( serverSocket );
+}
+
+/* ========================== Test Cases ============================ */
+
+/**
+ * @brief The signing context gives the Authorization header value of the
+ * demo before it, for requests without a security token.
+ */
+void test_S3Signing_MatchesLibraryWithoutSecurityToken( void )
+{
+    securityTokenLength = 0U;
+    compareSignatures();
+}
+
+/**
+ * @brief The signing context gives the Authorization header value of the
+ * demo before it, for requests with a security token.
+ */
+void test_S3Signing_MatchesLibraryWithSecurityToken( void )
+{
+    securityTokenLength = SECURITY_TOKEN_LENGTH;
+    compareSignatures();
+}
+
+/**
+ * @brief Signs #SIGNING_ROUNDS range requests each way, with a security
+ * token, and logs the cost of a signature.
+ */
+void test_S3Signing_SigningCost( void )
+{
+    static uint8_t requestBuffer[ REQUEST_BUFFER_LENGTH ];
+    static char authorization[ AUTHORIZATION_BUFFER_LENGTH ];
+    HTTPRequestHeaders_t requestHeaders = { 0 };
+    const char * pAuthorization = NULL;
+    size_t authorizationLength = 0U;
+    struct timespec start;
+    long contextUs = 0L;
+    long beforeUs = 0L;
+    size_t round = 0U;
+    bool isSigned = true;
+
+    securityTokenLength = SECURITY_TOKEN_LENGTH;
+    requestHeaders.pBuffer = requestBuffer;
+    requestHeaders.bufferLen = sizeof( requestBuffer );
+
+    TEST_ASSERT_TRUE( addCommonHeaders( &requestHeaders ) );
+    commonHeadersLength = requestHeaders.headersLen;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+
+    for( round = 0U; ( isSigned == true ) && ( round < SIGNING_ROUNDS ); round++ )
+    {
+        isSigned = signWithContext( &requestHeaders,
+                                    round * RANGE_REQUEST_LENGTH,
+                                    ( ( round + 1U ) * RANGE_REQUEST_LENGTH ) - 1U,
+                                    &pAuthorization,
+                                    &authorizationLength );
+    }
+
+    contextUs = microsecondsSince( &start );
+    TEST_ASSERT_TRUE( isSigned );
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+
+    for( round = 0U; ( isSigned == true ) && ( round < SIGNING_ROUNDS ); round++ )
+    {
+        isSigned = signAsBefore( &requestHeaders,
+                                 round * RANGE_REQUEST_LENGTH,
+                                 ( ( round + 1U ) * RANGE_REQUEST_LENGTH ) - 1U,
+                                 authorization,
+                                 &authorizationLength );
+    }
+
+    beforeUs = microsecondsSince( &start );
+    TEST_ASSERT_TRUE( isSigned );
+
+    LogInfo( ( "Signed %u range requests each way.", ( unsigned ) SIGNING_ROUNDS ) );
+    LogInfo( ( "Headers written and signed per request: %.2f us.",
+               ( double ) beforeUs / SIGNING_ROUNDS ) );
+    LogInfo( ( "Range header added and signed with the signing context: %.2f us.",
+               ( double ) contextUs / SIGNING_ROUNDS ) );
+}
+
+/**
+ * @brief Downloads the object #DOWNLOAD_ROUNDS times each way over the
+ * loopback interface, with a security token, checks every download, and
+ * logs the requests per second of both ways.
+ */
+void test_S3Signing_RequestsPerSecond( void )
+{
+    long contextUs = 0L;
+    long beforeUs = 0L;
+    uint32_t round = 0U;
+
+    securityTokenLength = SECURITY_TOKEN_LENGTH;
+
+    for( round = 0U; round < DOWNLOAD_ROUNDS; round++ )
+    {
+        beforeUs += timeDownload( prepareAsBefore );
+        contextUs += timeDownload( prepareWithContext );
+    }
+
+    LogInfo( ( "Downloaded %u ranges of %u bytes, %u times each way.",
+               ( unsigned ) ( OBJECT_SIZE / RANGE_REQUEST_LENGTH ),
+               ( unsigned ) RANGE_REQUEST_LENGTH,
+               ( unsigned ) DOWNLOAD_ROUNDS ) );
+    LogInfo( ( "Headers written and signed per request: %.0f requests/s.",
+               ( ( double ) ( OBJECT_SIZE / RANGE_REQUEST_LENGTH ) * DOWNLOAD_ROUNDS * MICROSECONDS_PER_SECOND ) / ( double ) beforeUs ) );
+    LogInfo( ( "Signing context: %.0f requests/s.",
+               ( ( double ) ( OBJECT_SIZE / RANGE_REQUEST_LENGTH ) * DOWNLOAD_ROUNDS * MICROSECONDS_PER_SECOND ) / ( double ) contextUs ) );
+}
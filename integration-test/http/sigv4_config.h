@@ -0,0 +1,88 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file sigv4_config.h
+ * @brief Values for configuration macros used by the SigV4 Utility Library in
+ * the tests of the S3 utilities of the demos.
+ */
+
+#ifndef SIGV4_CONFIG_H_
+#define SIGV4_CONFIG_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Include logging header files and define logging macros in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define the LIBRARY_LOG_NAME and LIBRARY_LOG_LEVEL macros depending on
+ * the logging configuration for SIGV4.
+ * 3. Include the header file "logging_stack.h", if logging is enabled for SIGV4.
+ */
+
+#include "logging_levels.h"
+
+/* Logging configuration for the SigV4 library. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME    "SIGV4"
+#endif
+
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+
+#include "logging_stack.h"
+
+/**
+ * @brief The size of the compile time allocated internal library buffer that is used
+ * for generating the canonical request, with room for the security token of the
+ * tests.
+ */
+#define SIGV4_PROCESSING_BUFFER_LENGTH    2048U
+
+/**
+ * @brief Number of HTTP headers does not exceed a maximum of 10 in the signed requests.
+ */
+#define SIGV4_MAX_HTTP_HEADER_COUNT       10U
+
+/**
+ * @brief The signed requests have no query parameters.
+ */
+#define SIGV4_MAX_QUERY_PAIR_COUNT        1U
+
+/**
+ * @brief Maximum block size of SHA256, the only hashing algorithm of the tests.
+ */
+#define SIGV4_HASH_MAX_BLOCK_LENGTH       64U
+
+/**
+ * @brief Maximum digest length of SHA256.
+ */
+#define SIGV4_HASH_MAX_DIGEST_LENGTH      32U
+
+/**
+ * @brief The requests are not pre-canonicalized, as in the S3 download demo.
+ */
+#define SIGV4_USE_CANONICAL_SUPPORT       1
+
+#endif /* ifndef SIGV4_CONFIG_H_ */
@@ -0,0 +1,877 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file jobs_demo_concurrency_test.c
+ * @brief Tests of the mosquitto jobs demo running a hundred queued jobs
+ * against a jobs service of the test.
+ *
+ * The demo is built with a libmosquitto stand-in, which exchanges publishes
+ * with the test over a TCP connection, and with "downloads" that sleep for
+ * the number of seconds given as url. The test plays the AWS IoT Jobs
+ * service: it lists the pending jobs, describes them, accepts or rejects
+ * status updates, and cancels a job while it runs.
+ */
+
+/* Standard header includes. */
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* POSIX includes. */
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* Include config file before other non-system includes. */
+#include "test_config.h"
+
+/* Unity testing framework includes. */
+#include "unity.h"
+
+#ifndef JOBS_DEMO_STAND_IN_PATH
+    #error "Define JOBS_DEMO_STAND_IN_PATH as the path of the demo built with the libmosquitto stand-in."
+#endif
+
+/**
+ * @brief Number of jobs queued for the demo.
+ */
+#define JOB_COUNT                    ( 100U )
+
+/**
+ * @brief Index of the job whose document has no url, so that it fails.
+ */
+#define FAILED_JOB_INDEX             ( 13U )
+
+/**
+ * @brief Index of the job that is canceled while it runs.
+ */
+#define CANCELED_JOB_INDEX           ( 50U )
+
+/**
+ * @brief Index of the job left in progress by an earlier run of the demo.
+ */
+#define RESUMED_JOB_INDEX            ( JOB_COUNT - 1U )
+
+/**
+ * @brief Milliseconds between the canceled job going in progress and its
+ * cancellation.
+ */
+#define CANCEL_DELAY_MS              ( 200L )
+
+/**
+ * @brief Number of jobs the demo may run at once.
+ */
+#define MAX_RUNNING_JOBS             ( 4U )
+
+/**
+ * @brief Seconds the demo has to finish all the jobs.
+ */
+#define TEST_TIMEOUT_SECONDS         ( 120 )
+
+/**
+ * @brief Milliseconds to wait for the demo to connect.
+ */
+#define CONNECT_TIMEOUT_MS           ( 10000 )
+
+/**
+ * @brief Milliseconds the service waits for a publish at a time.
+ */
+#define POLL_INTERVAL_MS             ( 50 )
+
+/**
+ * @brief Prefix of the topics of the jobs of the thing.
+ */
+#define JOBS_TOPIC_PREFIX            "$aws/things/" THING_NAME "/jobs/"
+
+/**
+ * @brief Topic of the frame carrying a subscription of the stand-in.
+ */
+#define SUBSCRIBE_TOPIC              "SUBSCRIBE"
+
+/**
+ * @brief Parent directory of the download directories of the demo, as
+ * configured by jobs_demo_stand_in_config.h.
+ */
+#define DOWNLOAD_DIRECTORY           "jobs_demo_downloads"
+
+/**
+ * @brief Path of the empty file given to the demo as certificates and key,
+ * which the stand-in ignores.
+ */
+#define CREDENTIAL_PATH              "jobs_demo_test.pem"
+
+/**
+ * @brief Path of the file receiving the output of the demo.
+ */
+#define DEMO_LOG_PATH                "jobs_demo_test.log"
+
+/**
+ * @brief Size of the frame header: topic length and payload length.
+ */
+#define FRAME_HEADER_SIZE            ( 2U * sizeof( uint32_t ) )
+
+/**
+ * @brief Size of the buffer of publishes received from the demo.
+ */
+#define RECEIVE_BUFFER_SIZE          ( 64U * 1024U )
+
+/**
+ * @brief Size of the buffer a response payload is formatted into.
+ */
+#define PAYLOAD_BUFFER_SIZE          ( 32U * 1024U )
+
+/**
+ * @brief Size of the buffer a response topic is formatted into.
+ */
+#define TOPIC_BUFFER_SIZE            ( 256U )
+
+/**
+ * @brief Size of the buffer of a job id.
+ */
+#define JOB_ID_BUFFER_SIZE           ( 16U )
+
+/**
+ * @brief Size of the buffer of a job document.
+ */
+#define JOB_DOCUMENT_BUFFER_SIZE     ( 32U )
+
+/**
+ * @brief Start of the status field of a status update.
+ */
+#define STATUS_FIELD                 "\"status\":\""
+
+/**
+ * @brief Number of nanoseconds in a millisecond.
+ */
+#define NANOSECONDS_PER_MILLISECOND  ( 1000000L )
+
+/**
+ * @brief Number of milliseconds in a second.
+ */
+#define MILLISECONDS_PER_SECOND      ( 1000L )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Status of a job execution.
+ */
+typedef enum JobStatus
+{
+    JobQueued = 0,
+    JobInProgress,
+    JobSucceeded,
+    JobFailed,
+    JobCanceled,
+    JobUnknown
+} JobStatus_t;
+
+/**
+ * @brief A job of the service.
+ */
+typedef struct ServiceJob
+{
+    char jobId[ JOB_ID_BUFFER_SIZE ];             /**< @brief Job id. */
+    char document[ JOB_DOCUMENT_BUFFER_SIZE ];    /**< @brief Job document. */
+    JobStatus_t status;                           /**< @brief Status of the execution. */
+    uint32_t describeCount;                       /**< @brief Number of times the demo described the job. */
+} ServiceJob_t;
+
+/**
+ * @brief The jobs service played by the test.
+ */
+typedef struct JobsService
+{
+    int socket;                                   /**< @brief Connection to the demo. */
+    uint8_t received[ RECEIVE_BUFFER_SIZE ];      /**< @brief Bytes received, not yet handled. */
+    size_t receivedLength;                        /**< @brief Number of bytes of #received. */
+    ServiceJob_t jobs[ JOB_COUNT ];               /**< @brief The jobs. */
+    bool isCancelPending;                         /**< @brief Whether the cancellation is due. */
+    struct timespec cancelTime;                   /**< @brief When the cancellation is due. */
+    uint32_t maxRunning;                          /**< @brief Largest number of jobs in progress at once. */
+    uint32_t lateUpdates;                         /**< @brief Updates of jobs that had finished. */
+    uint32_t pendingRequests;                     /**< @brief Requests for the pending jobs. */
+    uint32_t updates;                             /**< @brief Status updates. */
+} JobsService_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The jobs service of the test.
+ */
+static JobsService_t service;
+
+/**
+ * @brief Names of the job statuses, indexed by #JobStatus_t.
+ */
+static const char * const statusNames[] =
+{
+    "QUEUED",
+    "IN_PROGRESS",
+    "SUCCEEDED",
+    "FAILED",
+    "CANCELED"
+};
+
+/**
+ * @brief Process id of the demo, or 0.
+ */
+static pid_t demoProcess = 0;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Queue the jobs of the test.
+ *
+ * Each job sleeps for 20 to 300 milliseconds, except the canceled one, which
+ * sleeps for 5 seconds, and the failed one, which has no url.
+ */
+static void queueJobs( void );
+
+/**
+ * @brief Start the demo, and accept its connection.
+ *
+ * @param[in] maxJobs Number of jobs the demo may run at once.
+ */
+static void startDemo( uint32_t maxJobs );
+
+/**
+ * @brief Handle the publishes of the demo until all jobs have finished, or
+ * the test times out.
+ *
+ * @return Milliseconds until all jobs had finished.
+ */
+static long serveJobs( void );
+
+/**
+ * @brief Handle the complete publishes received from the demo.
+ */
+static void handlePublishes( void );
+
+/**
+ * @brief Handle a publish of the demo.
+ *
+ * @param[in] pTopic Topic of the publish, terminated by a null character.
+ * @param[in] pPayload Payload of the publish, terminated by a null character.
+ */
+static void handlePublish( const char * pTopic,
+                           const char * pPayload );
+
+/**
+ * @brief Answer a request for the pending jobs.
+ */
+static void sendPendingJobs( void );
+
+/**
+ * @brief Handle a status update of a job.
+ *
+ * @param[in] pJob The job.
+ * @param[in] pPayload Payload of the update.
+ */
+static void updateJob( ServiceJob_t * pJob,
+                       const char * pPayload );
+
+/**
+ * @brief Send a publish to the demo.
+ *
+ * @param[in] pTopic Topic of the publish.
+ * @param[in] pPayload Payload of the publish.
+ */
+static void sendPublish( const char * pTopic,
+                         const char * pPayload );
+
+/**
+ * @brief Find a job of the service.
+ *
+ * @param[in] pJobId Job id.
+ * @param[in] jobIdLength Length of the job id.
+ *
+ * @return The job, or NULL.
+ */
+static ServiceJob_t * findJob( const char * pJobId,
+                               size_t jobIdLength );
+
+/**
+ * @brief Parse the status of a status update.
+ *
+ * @param[in] pPayload Payload of the update.
+ *
+ * @return The status, or #JobUnknown.
+ */
+static JobStatus_t parseStatus( const char * pPayload );
+
+/**
+ * @brief Count the jobs with a status.
+ *
+ * @param[in] status The status.
+ *
+ * @return Number of jobs.
+ */
+static uint32_t countJobs( JobStatus_t status );
+
+/**
+ * @brief Milliseconds elapsed since a time.
+ *
+ * @param[in] pStart The time, of the monotonic clock.
+ *
+ * @return Milliseconds elapsed.
+ */
+static long millisecondsSince( const struct timespec * pStart );
+
+/*-----------------------------------------------------------*/
+
+static void queueJobs( void )
+{
+    uint32_t i;
+    ServiceJob_t * pJob;
+
+    ( void ) memset( &service, 0, sizeof( service ) );
+    service.socket = -1;
+
+    for( i = 0U; i < JOB_COUNT; i++ )
+    {
+        pJob = &service.jobs[ i ];
+        ( void ) snprintf( pJob->jobId, sizeof( pJob->jobId ), "job-%03u", ( unsigned ) i );
+
+        if( i == FAILED_JOB_INDEX )
+        {
+            ( void ) snprintf( pJob->document, sizeof( pJob->document ), "{}" );
+        }
+        else if( i == CANCELED_JOB_INDEX )
+        {
+            ( void ) snprintf( pJob->document, sizeof( pJob->document ), "{\"url\":\"5\"}" );
+        }
+        else
+        {
+            ( void ) snprintf( pJob->document, sizeof( pJob->document ), "{\"url\":\"0.%02u\"}",
+                               ( unsigned ) ( 2U + ( ( i * 37U ) % 29U ) ) );
+        }
+
+        pJob->status = ( i == RESUMED_JOB_INDEX ) ? JobInProgress : JobQueued;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void startDemo( uint32_t maxJobs )
+{
+    struct sockaddr_in address;
+    socklen_t addressLength = sizeof( address );
+    struct pollfd fds;
+    int listener, logFile;
+    char port[ sizeof( "65535" ) ];
+    char jobs[ sizeof( "4294967295" ) ];
+
+    listener = socket( AF_INET, SOCK_STREAM, 0 );
+    TEST_ASSERT_GREATER_OR_EQUAL( 0, listener );
+
+    ( void ) memset( &address, 0, sizeof( address ) );
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+    TEST_ASSERT_EQUAL( 0, bind( listener, ( struct sockaddr * ) &address, sizeof( address ) ) );
+    TEST_ASSERT_EQUAL( 0, listen( listener, 1 ) );
+    TEST_ASSERT_EQUAL( 0, getsockname( listener, ( struct sockaddr * ) &address, &addressLength ) );
+
+    ( void ) snprintf( port, sizeof( port ), "%u", ( unsigned ) ntohs( address.sin_port ) );
+    ( void ) snprintf( jobs, sizeof( jobs ), "%u", ( unsigned ) maxJobs );
+
+    demoProcess = fork();
+    TEST_ASSERT_GREATER_OR_EQUAL( 0, demoProcess );
+
+    if( demoProcess == 0 )
+    {
+        logFile = open( DEMO_LOG_PATH, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR );
+
+        if( logFile >= 0 )
+        {
+            ( void ) dup2( logFile, STDOUT_FILENO );
+            ( void ) dup2( logFile, STDERR_FILENO );
+        }
+
+        ( void ) close( listener );
+        ( void ) execl( JOBS_DEMO_STAND_IN_PATH, JOBS_DEMO_STAND_IN_PATH,
+                        "-n", THING_NAME, "-h", "127.0.0.1", "-p", port,
+                        "-f", CREDENTIAL_PATH, "-c", CREDENTIAL_PATH, "-k", CREDENTIAL_PATH,
+                        "-j", jobs, NULL );
+        _exit( EXIT_FAILURE );
+    }
+
+    fds.fd = listener;
+    fds.events = POLLIN;
+    fds.revents = 0;
+    TEST_ASSERT_EQUAL_MESSAGE( 1, poll( &fds, 1, CONNECT_TIMEOUT_MS ),
+                               "The demo did not connect; see " DEMO_LOG_PATH "." );
+
+    service.socket = accept( listener, NULL, NULL );
+    TEST_ASSERT_GREATER_OR_EQUAL( 0, service.socket );
+    ( void ) close( listener );
+}
+
+/*-----------------------------------------------------------*/
+
+static long serveJobs( void )
+{
+    struct timespec start;
+    struct pollfd fds;
+    ssize_t received = 0;
+    bool isDone = false;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+
+    while( ( isDone == false ) && ( millisecondsSince( &start ) < ( TEST_TIMEOUT_SECONDS * MILLISECONDS_PER_SECOND ) ) )
+    {
+        fds.fd = service.socket;
+        fds.events = POLLIN;
+        fds.revents = 0;
+
+        if( poll( &fds, 1, POLL_INTERVAL_MS ) > 0 )
+        {
+            received = recv( service.socket, &service.received[ service.receivedLength ],
+                             sizeof( service.received ) - service.receivedLength, 0 );
+            TEST_ASSERT_GREATER_THAN_MESSAGE( 0, received, "The demo disconnected; see " DEMO_LOG_PATH "." );
+            service.receivedLength += ( size_t ) received;
+            handlePublishes();
+        }
+
+        if( ( service.isCancelPending == true ) && ( millisecondsSince( &service.cancelTime ) >= 0L ) )
+        {
+            service.isCancelPending = false;
+            service.jobs[ CANCELED_JOB_INDEX ].status = JobCanceled;
+            sendPublish( JOBS_TOPIC_PREFIX "notify-next", "{\"execution\":{}}" );
+        }
+
+        isDone = ( ( countJobs( JobQueued ) + countJobs( JobInProgress ) ) == 0U ) ? true : false;
+    }
+
+    TEST_ASSERT_TRUE_MESSAGE( isDone, "The jobs did not finish in time; see " DEMO_LOG_PATH "." );
+
+    return millisecondsSince( &start );
+}
+
+/*-----------------------------------------------------------*/
+
+static void handlePublishes( void )
+{
+    uint32_t lengths[ 2 ];
+    size_t frameLength = 0U;
+    char * pTopic = NULL;
+    char * pPayload = NULL;
+
+    while( service.receivedLength >= FRAME_HEADER_SIZE )
+    {
+        ( void ) memcpy( lengths, service.received, FRAME_HEADER_SIZE );
+        frameLength = FRAME_HEADER_SIZE + lengths[ 0 ] + lengths[ 1 ];
+        TEST_ASSERT_LESS_OR_EQUAL( sizeof( service.received ), frameLength );
+
+        if( service.receivedLength < frameLength )
+        {
+            break;
+        }
+
+        pTopic = strndup( ( const char * ) &service.received[ FRAME_HEADER_SIZE ], lengths[ 0 ] );
+        pPayload = strndup( ( const char * ) &service.received[ FRAME_HEADER_SIZE + lengths[ 0 ] ], lengths[ 1 ] );
+        TEST_ASSERT_NOT_NULL( pTopic );
+        TEST_ASSERT_NOT_NULL( pPayload );
+
+        handlePublish( pTopic, pPayload );
+
+        free( pTopic );
+        free( pPayload );
+
+        ( void ) memmove( service.received, &service.received[ frameLength ], service.receivedLength - frameLength );
+        service.receivedLength -= frameLength;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void handlePublish( const char * pTopic,
+                           const char * pPayload )
+{
+    const char * pRequest = NULL;
+    const char * pOperation = NULL;
+    ServiceJob_t * pJob = NULL;
+    char topic[ TOPIC_BUFFER_SIZE ];
+    char payload[ PAYLOAD_BUFFER_SIZE ];
+
+    if( strcmp( pTopic, SUBSCRIBE_TOPIC ) != 0 )
+    {
+        TEST_ASSERT_EQUAL_STRING_LEN( JOBS_TOPIC_PREFIX, pTopic, sizeof( JOBS_TOPIC_PREFIX ) - 1U );
+        pRequest = &pTopic[ sizeof( JOBS_TOPIC_PREFIX ) - 1U ];
+
+        if( strcmp( pRequest, "get" ) == 0 )
+        {
+            sendPendingJobs();
+        }
+        else
+        {
+            pOperation = strchr( pRequest, '/' );
+            TEST_ASSERT_NOT_NULL( pOperation );
+            pJob = findJob( pRequest, ( size_t ) ( pOperation - pRequest ) );
+            TEST_ASSERT_NOT_NULL_MESSAGE( pJob, pTopic );
+
+            if( strcmp( pOperation, "/get" ) == 0 )
+            {
+                pJob->describeCount++;
+                ( void ) snprintf( topic, sizeof( topic ), JOBS_TOPIC_PREFIX "%s/get/accepted", pJob->jobId );
+                ( void ) snprintf( payload, sizeof( payload ),
+                                   "{\"execution\":{\"jobId\":\"%s\",\"status\":\"%s\",\"jobDocument\":%s}}",
+                                   pJob->jobId, statusNames[ pJob->status ], pJob->document );
+                sendPublish( topic, payload );
+            }
+            else
+            {
+                TEST_ASSERT_EQUAL_STRING( "/update", pOperation );
+                updateJob( pJob, pPayload );
+            }
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void sendPendingJobs( void )
+{
+    char payload[ PAYLOAD_BUFFER_SIZE ];
+    size_t length = 0U;
+    uint32_t i;
+    bool isFirst = true;
+
+    service.pendingRequests++;
+
+    length += ( size_t ) snprintf( &payload[ length ], sizeof( payload ) - length, "{\"inProgressJobs\":[" );
+
+    for( i = 0U; i < JOB_COUNT; i++ )
+    {
+        if( service.jobs[ i ].status == JobInProgress )
+        {
+            length += ( size_t ) snprintf( &payload[ length ], sizeof( payload ) - length,
+                                           "%s{\"jobId\":\"%s\",\"executionNumber\":1,\"versionNumber\":2,"
+                                           "\"lastUpdatedAt\":1,\"queuedAt\":1,\"startedAt\":1}",
+                                           ( isFirst == true ) ? "" : ",", service.jobs[ i ].jobId );
+            isFirst = false;
+        }
+    }
+
+    length += ( size_t ) snprintf( &payload[ length ], sizeof( payload ) - length, "],\"queuedJobs\":[" );
+    isFirst = true;
+
+    for( i = 0U; i < JOB_COUNT; i++ )
+    {
+        if( service.jobs[ i ].status == JobQueued )
+        {
+            length += ( size_t ) snprintf( &payload[ length ], sizeof( payload ) - length,
+                                           "%s{\"jobId\":\"%s\",\"executionNumber\":1,\"versionNumber\":1,"
+                                           "\"lastUpdatedAt\":1,\"queuedAt\":1}",
+                                           ( isFirst == true ) ? "" : ",", service.jobs[ i ].jobId );
+            isFirst = false;
+        }
+    }
+
+    length += ( size_t ) snprintf( &payload[ length ], sizeof( payload ) - length, "],\"timestamp\":1}" );
+    TEST_ASSERT_LESS_THAN( sizeof( payload ), length );
+
+    sendPublish( JOBS_TOPIC_PREFIX "get/accepted", payload );
+}
+
+/*-----------------------------------------------------------*/
+
+static void updateJob( ServiceJob_t * pJob,
+                       const char * pPayload )
+{
+    JobStatus_t status = parseStatus( pPayload );
+    JobStatus_t current = pJob->status;
+    char topic[ TOPIC_BUFFER_SIZE ];
+    uint32_t running = 0U;
+
+    service.updates++;
+
+    if( ( current == JobSucceeded ) || ( current == JobFailed ) )
+    {
+        service.lateUpdates++;
+    }
+
+    if( ( ( current == JobQueued ) || ( current == JobInProgress ) ) &&
+        ( ( status == JobInProgress ) || ( status == JobSucceeded ) || ( status == JobFailed ) ) )
+    {
+        pJob->status = status;
+        ( void ) snprintf( topic, sizeof( topic ), JOBS_TOPIC_PREFIX "%s/update/accepted", pJob->jobId );
+        sendPublish( topic, "{}" );
+
+        if( ( pJob == &service.jobs[ CANCELED_JOB_INDEX ] ) && ( status == JobInProgress ) &&
+            ( current == JobQueued ) )
+        {
+            ( void ) clock_gettime( CLOCK_MONOTONIC, &service.cancelTime );
+            service.cancelTime.tv_nsec += CANCEL_DELAY_MS * NANOSECONDS_PER_MILLISECOND;
+            service.cancelTime.tv_sec += service.cancelTime.tv_nsec / ( MILLISECONDS_PER_SECOND * NANOSECONDS_PER_MILLISECOND );
+            service.cancelTime.tv_nsec %= MILLISECONDS_PER_SECOND * NANOSECONDS_PER_MILLISECOND;
+            service.isCancelPending = true;
+        }
+
+        if( status != JobInProgress )
+        {
+            sendPublish( JOBS_TOPIC_PREFIX "notify-next", "{\"execution\":{}}" );
+        }
+    }
+    else
+    {
+        ( void ) snprintf( topic, sizeof( topic ), JOBS_TOPIC_PREFIX "%s/update/rejected", pJob->jobId );
+        sendPublish( topic, "{\"code\":\"InvalidStateTransition\"}" );
+    }
+
+    running = countJobs( JobInProgress );
+
+    if( running > service.maxRunning )
+    {
+        service.maxRunning = running;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void sendPublish( const char * pTopic,
+                         const char * pPayload )
+{
+    uint32_t lengths[ 2 ];
+    struct iovec vectors[ 3 ];
+    struct msghdr message;
+    ssize_t sent = 0;
+    size_t remaining = 0U;
+    size_t i = 0U;
+
+    lengths[ 0 ] = ( uint32_t ) strlen( pTopic );
+    lengths[ 1 ] = ( uint32_t ) strlen( pPayload );
+    vectors[ 0 ].iov_base = lengths;
+    vectors[ 0 ].iov_len = FRAME_HEADER_SIZE;
+    vectors[ 1 ].iov_base = ( void * ) pTopic;
+    vectors[ 1 ].iov_len = lengths[ 0 ];
+    vectors[ 2 ].iov_base = ( void * ) pPayload;
+    vectors[ 2 ].iov_len = lengths[ 1 ];
+    remaining = FRAME_HEADER_SIZE + lengths[ 0 ] + lengths[ 1 ];
+
+    while( remaining > 0U )
+    {
+        ( void ) memset( &message, 0, sizeof( message ) );
+        message.msg_iov = &vectors[ i ];
+        message.msg_iovlen = 3U - i;
+
+        sent = sendmsg( service.socket, &message, MSG_NOSIGNAL );
+        TEST_ASSERT_GREATER_THAN( 0, sent );
+        remaining -= ( size_t ) sent;
+
+        while( ( sent > 0 ) && ( i < 3U ) )
+        {
+            if( ( size_t ) sent >= vectors[ i ].iov_len )
+            {
+                sent -= ( ssize_t ) vectors[ i ].iov_len;
+                vectors[ i ].iov_len = 0U;
+                i++;
+            }
+            else
+            {
+                vectors[ i ].iov_base = &( ( uint8_t * ) vectors[ i ].iov_base )[ sent ];
+                vectors[ i ].iov_len -= ( size_t ) sent;
+                sent = 0;
+            }
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static ServiceJob_t * findJob( const char * pJobId,
+                               size_t jobIdLength )
+{
+    ServiceJob_t * pJob = NULL;
+    uint32_t i;
+
+    for( i = 0U; ( pJob == NULL ) && ( i < JOB_COUNT ); i++ )
+    {
+        if( ( strlen( service.jobs[ i ].jobId ) == jobIdLength ) &&
+            ( strncmp( service.jobs[ i ].jobId, pJobId, jobIdLength ) == 0 ) )
+        {
+            pJob = &service.jobs[ i ];
+        }
+    }
+
+    return pJob;
+}
+
+/*-----------------------------------------------------------*/
+
+static JobStatus_t parseStatus( const char * pPayload )
+{
+    JobStatus_t status = JobUnknown;
+    const char * pStatus = strstr( pPayload, STATUS_FIELD );
+    uint32_t i;
+
+    if( pStatus != NULL )
+    {
+        pStatus = &pStatus[ sizeof( STATUS_FIELD ) - 1U ];
+
+        for( i = 0U; ( status == JobUnknown ) && ( i < JobUnknown ); i++ )
+        {
+            if( ( strncmp( pStatus, statusNames[ i ], strlen( statusNames[ i ] ) ) == 0 ) &&
+                ( pStatus[ strlen( statusNames[ i ] ) ] == '"' ) )
+            {
+                status = ( JobStatus_t ) i;
+            }
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t countJobs( JobStatus_t status )
+{
+    uint32_t count = 0U;
+    uint32_t i;
+
+    for( i = 0U; i < JOB_COUNT; i++ )
+    {
+        if( service.jobs[ i ].status == status )
+        {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/*-----------------------------------------------------------*/
+
+static long millisecondsSince( const struct timespec * pStart )
+{
+    struct timespec now;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ( ( now.tv_sec - pStart->tv_sec ) * MILLISECONDS_PER_SECOND ) +
+           ( ( now.tv_nsec - pStart->tv_nsec ) / NANOSECONDS_PER_MILLISECOND );
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    int credentialFile;
+
+    ( void ) mkdir( DOWNLOAD_DIRECTORY, S_IRWXU );
+
+    credentialFile = open( CREDENTIAL_PATH, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR );
+    TEST_ASSERT_GREATER_OR_EQUAL( 0, credentialFile );
+    ( void ) close( credentialFile );
+
+    queueJobs();
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+    DIR * pDirectory;
+    struct dirent * pEntry;
+    char path[ sizeof( DOWNLOAD_DIRECTORY ) + sizeof( pEntry->d_name ) ];
+
+    if( demoProcess > 0 )
+    {
+        /* The demo disconnects and exits on SIGTERM. */
+        ( void ) kill( demoProcess, SIGTERM );
+        ( void ) waitpid( demoProcess, NULL, 0 );
+        demoProcess = 0;
+    }
+
+    if( service.socket >= 0 )
+    {
+        ( void ) close( service.socket );
+        service.socket = -1;
+    }
+
+    pDirectory = opendir( DOWNLOAD_DIRECTORY );
+
+    if( pDirectory != NULL )
+    {
+        for( pEntry = readdir( pDirectory ); pEntry != NULL; pEntry = readdir( pDirectory ) )
+        {
+            if( pEntry->d_name[ 0 ] != '.' )
+            {
+                ( void ) snprintf( path, sizeof( path ), DOWNLOAD_DIRECTORY "/%s", pEntry->d_name );
+                ( void ) rmdir( path );
+            }
+        }
+
+        ( void ) closedir( pDirectory );
+    }
+
+    ( void ) rmdir( DOWNLOAD_DIRECTORY );
+    ( void ) unlink( CREDENTIAL_PATH );
+}
+
+/* ========================== Test Cases ============================ */
+
+/**
+ * @brief The demo runs a hundred queued jobs to their final status, running
+ * up to the allowed number at once: it resumes the job left in progress,
+ * fails the job without url, and stops the canceled job. It starts no job
+ * twice, and sends no update for a job that has finished.
+ */
+void test_JobsDemo_RunsHundredQueuedJobs( void )
+{
+    long elapsed = 0L;
+    uint32_t i;
+
+    startDemo( MAX_RUNNING_JOBS );
+    elapsed = serveJobs();
+
+    LogInfo( ( "%u jobs finished in %ld ms, at most %u at once, "
+               "with %u requests for pending jobs and %u status updates.",
+               ( unsigned ) JOB_COUNT, elapsed, ( unsigned ) service.maxRunning,
+               ( unsigned ) service.pendingRequests, ( unsigned ) service.updates ) );
+
+    TEST_ASSERT_EQUAL( JobFailed, service.jobs[ FAILED_JOB_INDEX ].status );
+    TEST_ASSERT_EQUAL( JobCanceled, service.jobs[ CANCELED_JOB_INDEX ].status );
+    TEST_ASSERT_EQUAL( JobSucceeded, service.jobs[ RESUMED_JOB_INDEX ].status );
+    TEST_ASSERT_EQUAL_UINT32( JOB_COUNT - 2U, countJobs( JobSucceeded ) );
+
+    for( i = 0U; i < JOB_COUNT; i++ )
+    {
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE( 1U, service.jobs[ i ].describeCount, service.jobs[ i ].jobId );
+    }
+
+    TEST_ASSERT_EQUAL_UINT32( 0U, service.lateUpdates );
+    TEST_ASSERT_GREATER_THAN_UINT32( 1U, service.maxRunning );
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32( MAX_RUNNING_JOBS, service.maxRunning );
+}
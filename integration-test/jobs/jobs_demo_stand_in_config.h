@@ -0,0 +1,45 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef JOBS_DEMO_STAND_IN_CONFIG_H_
+#define JOBS_DEMO_STAND_IN_CONFIG_H_
+
+/**
+ * @file jobs_demo_stand_in_config.h
+ * @brief Settings of the mosquitto jobs demo built for the jobs demo test,
+ * included before any other header of the demo.
+ */
+
+/**
+ * @brief Parent directory of the download directories, relative to the
+ * working directory of the test.
+ */
+#define DESTINATION_PREFIX    "jobs_demo_downloads"
+
+/**
+ * @brief Run a "download" that sleeps for the number of seconds given as
+ * url, so that a job runs for a known time without a network.
+ */
+#define CURL( url ) \
+    execl( "/bin/sleep", "sleep", url, NULL )
+
+#endif /* ifndef JOBS_DEMO_STAND_IN_CONFIG_H_ */
@@ -0,0 +1,561 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file mosquitto_stand_in.c
+ * @brief A libmosquitto stand-in for the jobs demo test.
+ *
+ * Publishes are exchanged with the test over a TCP connection to the host
+ * and port given to mosquitto_connect, each framed as the topic length and
+ * the payload length in host byte order, followed by the topic and the
+ * payload. A subscription is sent as a publish to the topic "SUBSCRIBE"
+ * with the topic filter as payload. Connecting and subscribing succeed on
+ * the next call to mosquitto_loop. As with libmosquitto, publishes are
+ * written at once, except from a callback, where they are queued until
+ * mosquitto_loop_write.
+ */
+
+/* Standard includes. */
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* POSIX includes. */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "mosquitto.h"
+
+/**
+ * @brief Size of the frame header: topic length and payload length.
+ */
+#define FRAME_HEADER_SIZE        ( 2U * sizeof( uint32_t ) )
+
+/**
+ * @brief Size of the buffer of received frames.
+ */
+#define RECEIVE_BUFFER_SIZE      ( 1024U * 1024U )
+
+/**
+ * @brief Topic of the frame carrying a subscription.
+ */
+#define SUBSCRIBE_TOPIC          "SUBSCRIBE"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief A client of the stand-in.
+ */
+struct mosquitto
+{
+    int socket;                                                                      /**< @brief Connection to the test, or -1. */
+    void * pObject;                                                                  /**< @brief Object passed to the callbacks. */
+    void ( * onConnect )( struct mosquitto *, void *, int );                         /**< @brief Connect callback. */
+    void ( * onSubscribe )( struct mosquitto *, void *, int, int, const int * );     /**< @brief Subscribe callback. */
+    void ( * onMessage )( struct mosquitto *, void *, const struct mosquitto_message * ); /**< @brief Message callback. */
+    bool isConnectPending;                                                           /**< @brief Whether the connect callback is due. */
+    bool isSubscribePending;                                                         /**< @brief Whether the subscribe callback is due. */
+    bool isInCallback;                                                               /**< @brief Whether a message callback runs. */
+    uint8_t * pOutgoing;                                                             /**< @brief Frames waiting to be written. */
+    size_t outgoingLength;                                                           /**< @brief Number of bytes of #pOutgoing. */
+    uint8_t incoming[ RECEIVE_BUFFER_SIZE ];                                         /**< @brief Bytes received, not yet delivered. */
+    size_t incomingLength;                                                           /**< @brief Number of bytes of #incoming. */
+};
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Write the queued frames, until the socket would block.
+ *
+ * @param[in] mosq The client.
+ *
+ * @return #MOSQ_ERR_SUCCESS, or #MOSQ_ERR_CONN_LOST if the write failed.
+ */
+static int flushOutgoing( struct mosquitto * mosq );
+
+/**
+ * @brief Deliver the complete frames received to the message callback.
+ *
+ * @param[in] mosq The client.
+ */
+static void deliverIncoming( struct mosquitto * mosq );
+
+/*-----------------------------------------------------------*/
+
+static int flushOutgoing( struct mosquitto * mosq )
+{
+    int ret = MOSQ_ERR_SUCCESS;
+    ssize_t written = 0;
+
+    while( ( ret == MOSQ_ERR_SUCCESS ) && ( mosq->outgoingLength > 0U ) )
+    {
+        written = send( mosq->socket, mosq->pOutgoing, mosq->outgoingLength, MSG_DONTWAIT | MSG_NOSIGNAL );
+
+        if( written > 0 )
+        {
+            ( void ) memmove( mosq->pOutgoing, &mosq->pOutgoing[ written ], mosq->outgoingLength - ( size_t ) written );
+            mosq->outgoingLength -= ( size_t ) written;
+        }
+        else if( ( written < 0 ) && ( ( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) ) )
+        {
+            /* The rest is written when the socket is writable. */
+            break;
+        }
+        else
+        {
+            ret = MOSQ_ERR_CONN_LOST;
+        }
+    }
+
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+static void deliverIncoming( struct mosquitto * mosq )
+{
+    struct mosquitto_message message;
+    uint32_t lengths[ 2 ];
+    size_t frameLength = 0U;
+
+    while( mosq->incomingLength >= FRAME_HEADER_SIZE )
+    {
+        ( void ) memcpy( lengths, mosq->incoming, FRAME_HEADER_SIZE );
+        frameLength = FRAME_HEADER_SIZE + lengths[ 0 ] + lengths[ 1 ];
+
+        if( mosq->incomingLength < frameLength )
+        {
+            break;
+        }
+
+        ( void ) memset( &message, 0, sizeof( message ) );
+        message.qos = 1;
+        message.topic = malloc( lengths[ 0 ] + 1U );
+        message.payload = malloc( lengths[ 1 ] + 1U );
+        message.payloadlen = ( int ) lengths[ 1 ];
+
+        if( ( message.topic != NULL ) && ( message.payload != NULL ) )
+        {
+            ( void ) memcpy( message.topic, &mosq->incoming[ FRAME_HEADER_SIZE ], lengths[ 0 ] );
+            message.topic[ lengths[ 0 ] ] = '\0';
+            ( void ) memcpy( message.payload, &mosq->incoming[ FRAME_HEADER_SIZE + lengths[ 0 ] ], lengths[ 1 ] );
+
+            mosq->isInCallback = true;
+            mosq->onMessage( mosq, mosq->pObject, &message );
+            mosq->isInCallback = false;
+        }
+
+        free( message.topic );
+        free( message.payload );
+
+        ( void ) memmove( mosq->incoming, &mosq->incoming[ frameLength ], mosq->incomingLength - frameLength );
+        mosq->incomingLength -= frameLength;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+int mosquitto_lib_init( void )
+{
+    return MOSQ_ERR_SUCCESS;
+}
+
+/*-----------------------------------------------------------*/
+
+int mosquitto_lib_cleanup( void )
+{
+    return MOSQ_ERR_SUCCESS;
+}
+
+/*-----------------------------------------------------------*/
+
+struct mosquitto * mosquitto_new( const char * id,
+                                  bool clean_session,
+                                  void * obj )
+{
+    struct mosquitto * mosq = calloc( 1U, sizeof( struct mosquitto ) );
+
+    ( void ) id;
+    ( void ) clean_session;
+
+    if( mosq != NULL )
+    {
+        mosq->socket = -1;
+        mosq->pObject = obj;
+    }
+
+    return mosq;
+}
+
+/*-----------------------------------------------------------*/
+
+void mosquitto_destroy( struct mosquitto * mosq )
+{
+    if( mosq != NULL )
+    {
+        if( mosq->socket >= 0 )
+        {
+            ( void ) close( mosq->socket );
+        }
+
+        free( mosq->pOutgoing );
+        free( mosq );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void mosquitto_log_callback_set( struct mosquitto * mosq,
+                                 void ( * on_log )( struct mosquitto *, void *, int, const char * ) )
+{
+    ( void ) mosq;
+    ( void ) on_log;
+}
+
+/*-----------------------------------------------------------*/
+
+void mosquitto_connect_callback_set( struct mosquitto * mosq,
+                                     void ( * on_connect )( struct mosquitto *, void *, int ) )
+{
+    mosq->onConnect = on_connect;
+}
+
+/*-----------------------------------------------------------*/
+
+void mosquitto_subscribe_callback_set( struct mosquitto * mosq,
+                                       void ( * on_subscribe )( struct mosquitto *, void *, int, int, const int * ) )
+{
+    mosq->onSubscribe = on_subscribe;
+}
+
+/*-----------------------------------------------------------*/
+
+void mosquitto_message_callback_set( struct mosquitto * mosq,
+                                     void ( * on_message )( struct mosquitto *, void *, const struct mosquitto_message * ) )
+{
+    mosq->onMessage = on_message;
+}
+
+/*-----------------------------------------------------------*/
+
+int mosquitto_tls_set( struct mosquitto * mosq,
+                       const char * cafile,
+                       const char * capath,
+                       const char * certfile,
+                       const char * keyfile,
+                       int ( * pw_callback )( char * buf, int size, int rwflag, void * userdata ) )
+{
+    ( void ) mosq;
+    ( void ) cafile;
+    ( void ) capath;
+    ( void ) certfile;
+    ( void ) keyfile;
+    ( void ) pw_callback;
+
+    return MOSQ_ERR_SUCCESS;
+}
+
+/*-----------------------------------------------------------*/
+
+int mosquitto_string_option( struct mosquitto * mosq,
+                             enum mosq_opt_t option,
+                             const char * value )
+{
+    ( void ) mosq;
+    ( void ) option;
+    ( void ) value;
+
+    return MOSQ_ERR_SUCCESS;
+}
+
+/*-----------------------------------------------------------*/
+
+int mosquitto_connect( struct mosquitto * mosq,
+                       const char * host,
+                       int port,
+                       int keepalive )
+{
+    struct sockaddr_in address;
+    int ret = MOSQ_ERR_SUCCESS;
+
+    ( void ) keepalive;
+
+    ( void ) memset( &address, 0, sizeof( address ) );
+    address.sin_family = AF_INET;
+    address.sin_port = htons( ( uint16_t ) port );
+
+    if( inet_pton( AF_INET, host, &address.sin_addr ) != 1 )
+    {
+        ret = MOSQ_ERR_INVAL;
+    }
+    else
+    {
+        mosq->socket = socket( AF_INET, SOCK_STREAM, 0 );
+
+        if( ( mosq->socket < 0 ) ||
+            ( connect( mosq->socket, ( struct sockaddr * ) &address, sizeof( address ) ) != 0 ) )
+        {
+            ret = MOSQ_ERR_ERRNO;
+        }
+        else
+        {
+            mosq->isConnectPending = true;
+        }
+    }
+
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+int mosquitto_disconnect( struct mosquitto * mosq )
+{
+    int ret = MOSQ_ERR_NO_CONN;
+
+    if( mosq->socket >= 0 )
+    {
+        ( void ) flushOutgoing( mosq );
+        ( void ) shutdown( mosq->socket, SHUT_RDWR );
+        ret = MOSQ_ERR_SUCCESS;
+    }
+
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+int mosquitto_subscribe( struct mosquitto * mosq,
+                         int * mid,
+                         const char * sub,
+                         int qos )
+{
+    mosq->isSubscribePending = true;
+
+    return mosquitto_publish( mosq, mid, SUBSCRIBE_TOPIC, ( int ) strlen( sub ), sub, qos, false );
+}
+
+/*-----------------------------------------------------------*/
+
+int mosquitto_publish( struct mosquitto * mosq,
+                       int * mid,
+                       const char * topic,
+                       int payloadlen,
+                       const void * payload,
+                       int qos,
+                       bool retain )
+{
+    uint32_t lengths[ 2 ];
+    uint8_t * pOutgoing = NULL;
+    size_t frameLength = 0U;
+    int ret = MOSQ_ERR_SUCCESS;
+
+    ( void ) qos;
+    ( void ) retain;
+
+    lengths[ 0 ] = ( uint32_t ) strlen( topic );
+    lengths[ 1 ] = ( uint32_t ) payloadlen;
+    frameLength = FRAME_HEADER_SIZE + lengths[ 0 ] + lengths[ 1 ];
+
+    if( mid != NULL )
+    {
+        *mid = 0;
+    }
+
+    if( mosq->socket < 0 )
+    {
+        ret = MOSQ_ERR_NO_CONN;
+    }
+    else
+    {
+        pOutgoing = realloc( mosq->pOutgoing, mosq->outgoingLength + frameLength );
+
+        if( pOutgoing == NULL )
+        {
+            ret = MOSQ_ERR_NOMEM;
+        }
+    }
+
+    if( ret == MOSQ_ERR_SUCCESS )
+    {
+        mosq->pOutgoing = pOutgoing;
+        ( void ) memcpy( &pOutgoing[ mosq->outgoingLength ], lengths, FRAME_HEADER_SIZE );
+        ( void ) memcpy( &pOutgoing[ mosq->outgoingLength + FRAME_HEADER_SIZE ], topic, lengths[ 0 ] );
+
+        if( payloadlen > 0 )
+        {
+            ( void ) memcpy( &pOutgoing[ mosq->outgoingLength + FRAME_HEADER_SIZE + lengths[ 0 ] ], payload, lengths[ 1 ] );
+        }
+
+        mosq->outgoingLength += frameLength;
+
+        if( mosq->isInCallback == false )
+        {
+            ret = flushOutgoing( mosq );
+        }
+    }
+
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+int mosquitto_loop( struct mosquitto * mosq,
+                    int timeout,
+                    int max_packets )
+{
+    struct pollfd fds;
+    int grantedQos = 1;
+    int ret = MOSQ_ERR_SUCCESS;
+
+    if( mosq->isConnectPending == true )
+    {
+        mosq->isConnectPending = false;
+        mosq->onConnect( mosq, mosq->pObject, 0 );
+    }
+    else if( mosq->isSubscribePending == true )
+    {
+        mosq->isSubscribePending = false;
+        mosq->onSubscribe( mosq, mosq->pObject, 1, 1, &grantedQos );
+    }
+    else
+    {
+        fds.fd = mosq->socket;
+        fds.events = POLLIN;
+        fds.revents = 0;
+
+        if( poll( &fds, 1, timeout ) > 0 )
+        {
+            ret = mosquitto_loop_read( mosq, max_packets );
+        }
+    }
+
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+int mosquitto_loop_read( struct mosquitto * mosq,
+                         int max_packets )
+{
+    ssize_t received = 0;
+    int ret = MOSQ_ERR_SUCCESS;
+
+    ( void ) max_packets;
+
+    received = recv( mosq->socket, &mosq->incoming[ mosq->incomingLength ],
+                     sizeof( mosq->incoming ) - mosq->incomingLength, 0 );
+
+    if( received <= 0 )
+    {
+        ret = MOSQ_ERR_CONN_LOST;
+    }
+    else
+    {
+        mosq->incomingLength += ( size_t ) received;
+        deliverIncoming( mosq );
+    }
+
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+int mosquitto_loop_write( struct mosquitto * mosq,
+                          int max_packets )
+{
+    ( void ) max_packets;
+
+    return flushOutgoing( mosq );
+}
+
+/*-----------------------------------------------------------*/
+
+int mosquitto_loop_misc( struct mosquitto * mosq )
+{
+    ( void ) mosq;
+
+    return MOSQ_ERR_SUCCESS;
+}
+
+/*-----------------------------------------------------------*/
+
+int mosquitto_socket( struct mosquitto * mosq )
+{
+    return mosq->socket;
+}
+
+/*-----------------------------------------------------------*/
+
+bool mosquitto_want_write( struct mosquitto * mosq )
+{
+    return( mosq->outgoingLength > 0U );
+}
+
+/*-----------------------------------------------------------*/
+
+const char * mosquitto_strerror( int mosq_errno )
+{
+    const char * pMessage = "Unknown error.";
+
+    switch( mosq_errno )
+    {
+        case MOSQ_ERR_SUCCESS:
+            pMessage = "No error.";
+            break;
+
+        case MOSQ_ERR_NOMEM:
+            pMessage = "Out of memory.";
+            break;
+
+        case MOSQ_ERR_INVAL:
+            pMessage = "Invalid function arguments provided.";
+            break;
+
+        case MOSQ_ERR_NO_CONN:
+            pMessage = "The client is not currently connected.";
+            break;
+
+        case MOSQ_ERR_CONN_LOST:
+            pMessage = "The connection was lost.";
+            break;
+
+        case MOSQ_ERR_ERRNO:
+            pMessage = strerror( errno );
+            break;
+
+        default:
+            break;
+    }
+
+    return pMessage;
+}
+
+/*-----------------------------------------------------------*/
+
+const char * mosquitto_connack_string( int connack_code )
+{
+    return ( connack_code == 0 ) ? "Connection Accepted." : "Connection Refused.";
+}
@@ -0,0 +1,134 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file mosquitto.h
+ * @brief The part of the libmosquitto API used by the mosquitto jobs demo,
+ * implemented by mosquitto_stand_in.c for the jobs demo test.
+ *
+ * The stand-in exchanges publishes with the test over a TCP connection
+ * instead of speaking MQTT to a broker.
+ */
+
+#ifndef MOSQUITTO_STAND_IN_H_
+#define MOSQUITTO_STAND_IN_H_
+
+/* Standard includes. */
+#include <stdbool.h>
+
+/**
+ * @brief Version of libmosquitto whose API the stand-in implements.
+ */
+#define LIBMOSQUITTO_VERSION_NUMBER    ( 1006012 )
+
+/**
+ * @brief Return codes of the libmosquitto functions.
+ */
+enum mosq_err_t
+{
+    MOSQ_ERR_SUCCESS = 0,
+    MOSQ_ERR_NOMEM = 1,
+    MOSQ_ERR_INVAL = 3,
+    MOSQ_ERR_NO_CONN = 4,
+    MOSQ_ERR_CONN_LOST = 7,
+    MOSQ_ERR_ERRNO = 14
+};
+
+/**
+ * @brief Options of mosquitto_string_option.
+ */
+enum mosq_opt_t
+{
+    MOSQ_OPT_TLS_ALPN = 10
+};
+
+/**
+ * @brief A client.
+ */
+struct mosquitto;
+
+/**
+ * @brief A received publish.
+ */
+struct mosquitto_message
+{
+    int mid;       /**< @brief Message identifier. */
+    char * topic;  /**< @brief Topic, terminated by a null character. */
+    void * payload;/**< @brief Payload. */
+    int payloadlen;/**< @brief Length of the payload. */
+    int qos;       /**< @brief Quality of service. */
+    bool retain;   /**< @brief Whether the publish was retained. */
+};
+
+int mosquitto_lib_init( void );
+int mosquitto_lib_cleanup( void );
+struct mosquitto * mosquitto_new( const char * id,
+                                  bool clean_session,
+                                  void * obj );
+void mosquitto_destroy( struct mosquitto * mosq );
+void mosquitto_log_callback_set( struct mosquitto * mosq,
+                                 void ( * on_log )( struct mosquitto *, void *, int, const char * ) );
+void mosquitto_connect_callback_set( struct mosquitto * mosq,
+                                     void ( * on_connect )( struct mosquitto *, void *, int ) );
+void mosquitto_subscribe_callback_set( struct mosquitto * mosq,
+                                       void ( * on_subscribe )( struct mosquitto *, void *, int, int, const int * ) );
+void mosquitto_message_callback_set( struct mosquitto * mosq,
+                                     void ( * on_message )( struct mosquitto *, void *, const struct mosquitto_message * ) );
+int mosquitto_tls_set( struct mosquitto * mosq,
+                       const char * cafile,
+                       const char * capath,
+                       const char * certfile,
+                       const char * keyfile,
+                       int ( * pw_callback )( char * buf, int size, int rwflag, void * userdata ) );
+int mosquitto_string_option( struct mosquitto * mosq,
+                             enum mosq_opt_t option,
+                             const char * value );
+int mosquitto_connect( struct mosquitto * mosq,
+                       const char * host,
+                       int port,
+                       int keepalive );
+int mosquitto_disconnect( struct mosquitto * mosq );
+int mosquitto_subscribe( struct mosquitto * mosq,
+                         int * mid,
+                         const char * sub,
+                         int qos );
+int mosquitto_publish( struct mosquitto * mosq,
+                       int * mid,
+                       const char * topic,
+                       int payloadlen,
+                       const void * payload,
+                       int qos,
+                       bool retain );
+int mosquitto_loop( struct mosquitto * mosq,
+                    int timeout,
+                    int max_packets );
+int mosquitto_loop_read( struct mosquitto * mosq,
+                         int max_packets );
+int mosquitto_loop_write( struct mosquitto * mosq,
+                          int max_packets );
+int mosquitto_loop_misc( struct mosquitto * mosq );
+int mosquitto_socket( struct mosquitto * mosq );
+bool mosquitto_want_write( struct mosquitto * mosq );
+const char * mosquitto_strerror( int mosq_errno );
+const char * mosquitto_connack_string( int connack_code );
+
+#endif /* ifndef MOSQUITTO_STAND_IN_H_ */
@@ -0,0 +1,767 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file json_index_test.c
+ * @brief Tests that the JSON index of the shadow and jobs demos accepts the
+ * documents and finds the values that coreJSON does, and benchmarks indexing
+ * a document against searching it with coreJSON for every value.
+ */
+
+/* Standard header includes. */
+#include <string.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <time.h>
+
+/* Include config file before other non-system includes. */
+#include "test_config.h"
+
+/* Unity testing framework includes. */
+#include "unity.h"
+
+/* Include the JSON index of the demos. */
+#include "json_index.h"
+
+/* JSON API header. */
+#include "core_json.h"
+
+/**
+ * @brief Capacity of the indexes of the tests, enough for any document of
+ * the tests but the oversized ones.
+ */
+#define INDEX_CAPACITY              ( JSON_INDEX_MAX_CAPACITY )
+
+/**
+ * @brief Capacity of the index of the tests of oversized documents.
+ */
+#define SMALL_INDEX_CAPACITY        ( 16U )
+
+/**
+ * @brief Number of values of an oversized document, more than
+ * #SMALL_INDEX_CAPACITY.
+ */
+#define OVERSIZED_VALUE_COUNT       ( 100U )
+
+/**
+ * @brief Nesting depth up to which documents are compared, past the depth
+ * limits of the index and of coreJSON.
+ */
+#define DEEPEST_DOCUMENT            ( JSON_INDEX_MAX_DEPTH + 8U )
+
+/**
+ * @brief Length of the buffer of the documents built by the tests.
+ */
+#define DOCUMENT_BUFFER_LENGTH      ( 64U * 1024U )
+
+/**
+ * @brief Length of the buffer of the key paths built by the tests.
+ */
+#define QUERY_BUFFER_LENGTH         ( 256U )
+
+/**
+ * @brief Smallest and largest documents of the benchmark.
+ */
+#define BENCHMARK_MIN_LENGTH        ( 1024U )
+#define BENCHMARK_MAX_LENGTH        ( 64U * 1024U )
+
+/**
+ * @brief Number of values looked up in each document of the benchmark, as a
+ * demo reads the fields of a job or shadow document.
+ */
+#define BENCHMARK_LOOKUP_COUNT      ( 16U )
+
+/**
+ * @brief Number of bytes of documents each way of the benchmark goes
+ * through for each document length, so that every length is measured for a
+ * similar time.
+ */
+#define BENCHMARK_BYTES             ( 16U * 1024U * 1024U )
+
+/**
+ * @brief Number of nanoseconds in a microsecond.
+ */
+#define NANOSECONDS_PER_MICROSECOND    ( 1000L )
+
+/**
+ * @brief Number of microseconds in a second.
+ */
+#define MICROSECONDS_PER_SECOND        ( 1000000L )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Valid documents, with the kinds of values and strings of shadow and
+ * job documents.
+ */
+static const char * const validDocuments[] =
+{
+    "{\"state\":{\"reported\":{\"powerOn\":1,\"color\":\"red\"},\"desired\":{\"powerOn\":0}},"
+    "\"metadata\":{\"reported\":{\"powerOn\":{\"timestamp\":1596059986}}},\"version\":12,\"timestamp\":1596060000}",
+    "{\"execution\":{\"jobId\":\"job-1\",\"status\":\"QUEUED\",\"queuedAt\":1596060000,\"versionNumber\":1,"
+    "\"jobDocument\":{\"action\":\"publish\",\"topic\":\"demo/topic\",\"message\":\"Hello\"}},"
+    "\"timestamp\":1596060001,\"clientToken\":\"token\"}",
+    " [ 1 , -2.5e+3 , \"s\" , true , false , null , { \"a\" : [ [ ] , { } ] } ] ",
+    "{\"esc\":\"a\\\"b\\\\c\\/d\\b\\f\\n\\r\\t\\u00e9\\ud83d\\ude00\",\"utf8\":\"\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80\","
+    "\"n\":0.5,\"e\":1E9,\"z\":-0,\"k\\\"ey\":\"quoted\"}",
+    "{\"a\":{\"b\":{\"c\":[10,[20,{\"d\":\"deep\"}]]}},\"list\":[{\"k\":1},{\"k\":2},{\"k\":3}]}",
+    "{\"pendingJobs\":[{\"jobId\":\"a\",\"queuedAt\":1},{\"jobId\":\"b\",\"queuedAt\":2}],"
+    "\"inProgressJobs\":[],\"empty\":{},\"blank\":\"\"}",
+    "{}",
+    "[]"
+};
+
+/**
+ * @brief Key paths looked up in every valid document.
+ */
+static const char * const queries[] =
+{
+    "state",                  "state.reported",    "state.reported.color", "state.desired.powerOn",
+    "metadata.reported.powerOn.timestamp",         "version",              "execution",
+    "execution.jobDocument",  "execution.jobDocument.topic",               "execution.status",
+    "[0]",                    "[1]",               "[2]",                  "[5]",
+    "[6]",                    "[6].a",             "[6].a[0]",             "[6].a[1]",
+    "[7]",                    "esc",               "utf8",                 "n",
+    "e",                      "z",                 "k\\\"ey",              "a.b.c[1][1].d",
+    "a.b.c[0]",               "a.b.c[1]",          "list[0]",              "list[2].k",
+    "list[3]",                "list[1].k.x",       "pendingJobs[1].jobId", "pendingJobs[2]",
+    "inProgressJobs[0]",      "empty",             "empty.x",              "blank",
+    "missing",                "state.missing",     "a.b.x",                "k"
+};
+
+/**
+ * @brief Documents that are not valid JSON.
+ */
+static const char * const invalidDocuments[] =
+{
+    "   ",
+    "{",
+    "}",
+    "[1,",
+    "{\"a\"}",
+    "{\"a\":}",
+    "{\"a\":1,}",
+    "[1,]",
+    "[1 2]",
+    "{a:1}",
+    "{'a':1}",
+    "{\"a\" 1}",
+    "{\"a\":1 \"b\":2}",
+    "{\"a\":tru}",
+    "{\"a\":nul}",
+    "{\"a\":1.}",
+    "{\"a\":-}",
+    "{\"a\":1e}",
+    "{\"a\":+1}",
+    "{\"a\":\"\x01\"}",
+    "{\"a\":\"\\x\"}",
+    "{\"a\":\"\\u12G4\"}",
+    "{\"a\":\"\\ud83d\"}",
+    "{\"a\":\"\\ude00\"}",
+    "{\"a\":\"\xc0\x80\"}",
+    "{\"a\":\"\xed\xa0\x80\"}",
+    "{\"a\":\"\xf4\x90\x80\x80\"}",
+    "{\"a\":\"\xe2\x82\"}",
+    "{\"a\":\"\x80\"}",
+    "{\"a\":1} x",
+    "{\"a\":1}{}",
+    "[\"unterminated]",
+    "[1,2]]",
+    "{\"a\":[1,2}"
+};
+
+/**
+ * @brief Documents in which objects have the same key more than once, or
+ * keys that a key path cannot name, with the key paths to look up in them.
+ */
+static const char * const duplicateKeyDocuments[] =
+{
+    "{\"a\":1,\"a\":2}",
+    "{\"o\":{\"k\":\"first\",\"k\":\"second\"},\"o\":{\"k\":\"third\",\"j\":4}}",
+    "[{\"k\":1,\"k\":2},{\"k\":3}]",
+    "{\"a\":{\"a\":{\"a\":1}},\"a\":5}",
+    "{\"a.b\":1,\"a\":{\"b\":2},\"o[0]\":3,\"o\":[4]}"
+};
+static const char * const duplicateKeyQueries[] =
+{
+    "a", "a.a", "a.a.a", "a.b", "o", "o.k", "o.j", "o[0]", "[0].k", "[1].k"
+};
+
+/**
+ * @brief Storage of the indexes of the tests.
+ */
+static JsonIndexEntry_t entries[ INDEX_CAPACITY ];
+static uint16_t slots[ JSON_INDEX_SLOT_COUNT( INDEX_CAPACITY ) ];
+
+/**
+ * @brief Buffers of the documents and key paths built by the tests.
+ */
+static char document[ DOCUMENT_BUFFER_LENGTH ];
+static char query[ QUERY_BUFFER_LENGTH ];
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Convert a status of JSON_Validate to the status JsonIndex_Build
+ * returns for the same document.
+ *
+ * @param[in] jsonStatus The status of JSON_Validate.
+ *
+ * @return The status of JsonIndex_Build.
+ */
+static JsonIndexStatus_t toIndexStatus( JSONStatus_t jsonStatus );
+
+/**
+ * @brief Convert a type of coreJSON to the type of the JSON index.
+ *
+ * @param[in] jsonType The type of coreJSON.
+ *
+ * @return The type of the JSON index.
+ */
+static JsonIndexType_t toIndexType( JSONTypes_t jsonType );
+
+/**
+ * @brief Check that a value is found as JSON_SearchConst finds it.
+ *
+ * @param[in] pIndex Index of the document.
+ * @param[in] pDocument The document.
+ * @param[in] documentLength Length of the document.
+ * @param[in] pQuery The key path.
+ * @param[in] queryLength Length of the key path.
+ */
+static void compareFind( const JsonIndex_t * pIndex,
+                         const char * pDocument,
+                         size_t documentLength,
+                         const char * pQuery,
+                         size_t queryLength );
+
+/**
+ * @brief Index a document, check that it is accepted as JSON_Validate
+ * accepts it, and if so that every key path is found as JSON_SearchConst
+ * finds it.
+ *
+ * @param[in] pDocument The document.
+ * @param[in] documentLength Length of the document.
+ * @param[in] capacity Capacity of the index.
+ * @param[in] ppQueries The key paths.
+ * @param[in] queryCount Number of key paths.
+ *
+ * @return The status of JsonIndex_Build.
+ */
+static JsonIndexStatus_t compareDocument( const char * pDocument,
+                                          size_t documentLength,
+                                          uint16_t capacity,
+                                          const char * const * ppQueries,
+                                          size_t queryCount );
+
+/**
+ * @brief Write a document of nested objects, each with the single key "a",
+ * and a number at the innermost level.
+ *
+ * @param[in] depth Number of objects.
+ *
+ * @return Length of the document.
+ */
+static size_t writeNestedObjects( size_t depth );
+
+/**
+ * @brief Write a shadow document of at most @p maxLength characters, with a
+ * reported object per sensor.
+ *
+ * @param[in] maxLength Largest length of the document.
+ * @param[out] pSensorCount Number of sensors of the document.
+ *
+ * @return Length of the document.
+ */
+static size_t writeShadowDocument( size_t maxLength,
+                                   size_t * pSensorCount );
+
+/**
+ * @brief Microseconds elapsed since a time.
+ *
+ * @param[in] pStart The time.
+ *
+ * @return The microseconds elapsed since @p pStart.
+ */
+static long microsecondsSince( const struct timespec * pStart );
+
+/*-----------------------------------------------------------*/
+
+static JsonIndexStatus_t toIndexStatus( JSONStatus_t jsonStatus )
+{
+    JsonIndexStatus_t status = JsonIndexIllegalDocument;
+
+    if( jsonStatus == JSONSuccess )
+    {
+        status = JsonIndexSuccess;
+    }
+    else if( jsonStatus == JSONMaxDepthExceeded )
+    {
+        status = JsonIndexMaxDepthExceeded;
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+static JsonIndexType_t toIndexType( JSONTypes_t jsonType )
+{
+    JsonIndexType_t type = JsonIndexNull;
+
+    switch( jsonType )
+    {
+        case JSONString:
+            type = JsonIndexString;
+            break;
+
+        case JSONNumber:
+            type = JsonIndexNumber;
+            break;
+
+        case JSONTrue:
+            type = JsonIndexTrue;
+            break;
+
+        case JSONFalse:
+            type = JsonIndexFalse;
+            break;
+
+        case JSONObject:
+            type = JsonIndexObject;
+            break;
+
+        case JSONArray:
+            type = JsonIndexArray;
+            break;
+
+        default:
+            type = JsonIndexNull;
+            break;
+    }
+
+    return type;
+}
+
+/*-----------------------------------------------------------*/
+
+static void compareFind( const JsonIndex_t * pIndex,
+                         const char * pDocument,
+                         size_t documentLength,
+                         const char * pQuery,
+                         size_t queryLength )
+{
+    JSONStatus_t jsonStatus = JSONSuccess;
+    JsonIndexStatus_t status = JsonIndexSuccess;
+    const char * pJsonValue = NULL;
+    const char * pValue = NULL;
+    size_t jsonValueLength = 0U;
+    size_t valueLength = 0U;
+    JSONTypes_t jsonType = JSONInvalid;
+    JsonIndexType_t type = JsonIndexNull;
+
+    jsonStatus = JSON_SearchConst( pDocument, documentLength, pQuery, queryLength,
+                                   &pJsonValue, &jsonValueLength, &jsonType );
+    status = JsonIndex_Find( pIndex, pQuery, queryLength, &pValue, &valueLength, &type );
+
+    if( jsonStatus == JSONSuccess )
+    {
+        TEST_ASSERT_EQUAL_MESSAGE( JsonIndexSuccess, status, pQuery );
+        TEST_ASSERT_EQUAL_PTR_MESSAGE( pJsonValue, pValue, pQuery );
+        TEST_ASSERT_EQUAL_MESSAGE( jsonValueLength, valueLength, pQuery );
+        TEST_ASSERT_EQUAL_MESSAGE( toIndexType( jsonType ), type, pQuery );
+    }
+    else
+    {
+        TEST_ASSERT_EQUAL_MESSAGE( JsonIndexNotFound, status, pQuery );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static JsonIndexStatus_t compareDocument( const char * pDocument,
+                                          size_t documentLength,
+                                          uint16_t capacity,
+                                          const char * const * ppQueries,
+                                          size_t queryCount )
+{
+    JsonIndex_t index;
+    JsonIndexStatus_t status = JsonIndexSuccess;
+    size_t i = 0U;
+
+    status = JsonIndex_Build( &index, pDocument, documentLength, entries, capacity, slots );
+    TEST_ASSERT_EQUAL_MESSAGE( toIndexStatus( JSON_Validate( pDocument, documentLength ) ), status, pDocument );
+
+    for( i = 0U; ( status == JsonIndexSuccess ) && ( i < queryCount ); i++ )
+    {
+        compareFind( &index, pDocument, documentLength, ppQueries[ i ], strlen( ppQueries[ i ] ) );
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t writeNestedObjects( size_t depth )
+{
+    size_t length = 0U;
+    size_t i = 0U;
+
+    for( i = 0U; i < depth; i++ )
+    {
+        length += ( size_t ) snprintf( &document[ length ], sizeof( document ) - length, "{\"a\":" );
+    }
+
+    document[ length++ ] = '7';
+
+    for( i = 0U; i < depth; i++ )
+    {
+        document[ length++ ] = '}';
+    }
+
+    return length;
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t writeShadowDocument( size_t maxLength,
+                                   size_t * pSensorCount )
+{
+    static char sensor[ QUERY_BUFFER_LENGTH ];
+    static const char prefix[] = "{\"state\":{\"reported\":{";
+    static const char suffix[] = "}},\"version\":42,\"timestamp\":1596060000}";
+    size_t length = sizeof( prefix ) - 1U;
+    size_t sensorLength = 0U;
+    size_t count = 0U;
+
+    ( void ) memcpy( document, prefix, sizeof( prefix ) - 1U );
+
+    for( ; ; )
+    {
+        sensorLength = ( size_t ) snprintf( sensor,
+                                            sizeof( sensor ),
+                                            "%s\"sensor%lu\":{\"value\":%lu,\"unit\":\"C\",\"ok\":true,\"history\":[1,2,3]}",
+                                            ( count == 0U ) ? "" : ",",
+                                            ( unsigned long ) count,
+                                            ( unsigned long ) ( ( count * 37U ) % 1000U ) );
+
+        if( ( length + sensorLength + sizeof( suffix ) - 1U ) > maxLength )
+        {
+            break;
+        }
+
+        ( void ) memcpy( &document[ length ], sensor, sensorLength );
+        length += sensorLength;
+        count++;
+    }
+
+    ( void ) memcpy( &document[ length ], suffix, sizeof( suffix ) - 1U );
+    *pSensorCount = count;
+
+    return length + sizeof( suffix ) - 1U;
+}
+
+/*-----------------------------------------------------------*/
+
+static long microsecondsSince( const struct timespec * pStart )
+{
+    struct timespec end;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &end );
+
+    return ( ( end.tv_sec - pStart->tv_sec ) * MICROSECONDS_PER_SECOND ) +
+           ( ( end.tv_nsec - pStart->tv_nsec ) / NANOSECONDS_PER_MICROSECOND );
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    ( void ) memset( document, 0, sizeof( document ) );
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+}
+
+/* ========================== Test Cases ============================ */
+
+/**
+ * @brief Valid documents are indexed, and their values are found as
+ * JSON_SearchConst finds them.
+ */
+void test_JsonIndex_ValidDocuments( void )
+{
+    size_t i = 0U;
+
+    for( i = 0U; i < ( sizeof( validDocuments ) / sizeof( validDocuments[ 0 ] ) ); i++ )
+    {
+        TEST_ASSERT_EQUAL( JsonIndexSuccess,
+                           compareDocument( validDocuments[ i ],
+                                            strlen( validDocuments[ i ] ),
+                                            INDEX_CAPACITY,
+                                            queries,
+                                            sizeof( queries ) / sizeof( queries[ 0 ] ) ) );
+    }
+}
+
+/**
+ * @brief Documents that are not valid JSON are rejected as JSON_Validate
+ * rejects them, including when they hold more values than the index.
+ */
+void test_JsonIndex_InvalidDocuments( void )
+{
+    size_t i = 0U;
+    size_t length = 0U;
+
+    for( i = 0U; i < ( sizeof( invalidDocuments ) / sizeof( invalidDocuments[ 0 ] ) ); i++ )
+    {
+        TEST_ASSERT_EQUAL( JsonIndexIllegalDocument,
+                           compareDocument( invalidDocuments[ i ],
+                                            strlen( invalidDocuments[ i ] ),
+                                            INDEX_CAPACITY,
+                                            NULL,
+                                            0U ) );
+    }
+
+    /* An error past the capacity of the index is found by coreJSON. */
+    document[ length++ ] = '[';
+
+    for( i = 0U; i < OVERSIZED_VALUE_COUNT; i++ )
+    {
+        length += ( size_t ) snprintf( &document[ length ], sizeof( document ) - length, "%lu,", ( unsigned long ) i );
+    }
+
+    document[ length++ ] = ']';
+    TEST_ASSERT_EQUAL( JsonIndexIllegalDocument,
+                       compareDocument( document, length, SMALL_INDEX_CAPACITY, NULL, 0U ) );
+}
+
+/**
+ * @brief Documents are accepted up to the depth that JSON_Validate accepts,
+ * and the innermost values of those accepted are found.
+ */
+void test_JsonIndex_DeepDocuments( void )
+{
+    const char * pQueries[ 1 ] = { query };
+    JsonIndex_t index;
+    size_t depth = 0U;
+    size_t length = 0U;
+    size_t queryLength = 0U;
+    size_t i = 0U;
+
+    for( depth = 1U; depth <= DEEPEST_DOCUMENT; depth++ )
+    {
+        /* The key path of the innermost value: "a.a. ... .a". */
+        queryLength = 0U;
+
+        for( i = 0U; i < depth; i++ )
+        {
+            query[ queryLength++ ] = 'a';
+            query[ queryLength++ ] = '.';
+        }
+
+        query[ queryLength - 1U ] = '\0';
+
+        length = writeNestedObjects( depth );
+        ( void ) compareDocument( document, length, INDEX_CAPACITY, pQueries, 1U );
+
+        /* Nested arrays, which hold no keys. */
+        for( i = 0U; i < depth; i++ )
+        {
+            document[ i ] = '[';
+            document[ ( 2U * depth ) - i - 1U ] = ']';
+        }
+
+        TEST_ASSERT_EQUAL( toIndexStatus( JSON_Validate( document, 2U * depth ) ),
+                           JsonIndex_Build( &index, document, 2U * depth, entries, INDEX_CAPACITY, slots ) );
+    }
+}
+
+/**
+ * @brief The first of the values of a key repeated in an object is found,
+ * and key paths only reach into that value, as with JSON_SearchConst.
+ */
+void test_JsonIndex_DuplicateKeys( void )
+{
+    size_t i = 0U;
+
+    for( i = 0U; i < ( sizeof( duplicateKeyDocuments ) / sizeof( duplicateKeyDocuments[ 0 ] ) ); i++ )
+    {
+        TEST_ASSERT_EQUAL( JsonIndexSuccess,
+                           compareDocument( duplicateKeyDocuments[ i ],
+                                            strlen( duplicateKeyDocuments[ i ] ),
+                                            INDEX_CAPACITY,
+                                            duplicateKeyQueries,
+                                            sizeof( duplicateKeyQueries ) / sizeof( duplicateKeyQueries[ 0 ] ) ) );
+    }
+}
+
+/**
+ * @brief A document with more values than the index holds is validated by
+ * coreJSON, and its values are found with JSON_SearchConst.
+ */
+void test_JsonIndex_OversizedDocumentFallsBack( void )
+{
+    static char queryStorage[ 4 ][ QUERY_BUFFER_LENGTH ];
+    const char * pQueries[ 6 ] = { NULL };
+    JsonIndex_t index;
+    size_t length = 0U;
+    size_t i = 0U;
+
+    length = ( size_t ) snprintf( document, sizeof( document ), "{\"values\":[" );
+
+    for( i = 0U; i < OVERSIZED_VALUE_COUNT; i++ )
+    {
+        length += ( size_t ) snprintf( &document[ length ],
+                                       sizeof( document ) - length,
+                                       "%s{\"id\":%lu,\"name\":\"value%lu\"}",
+                                       ( i == 0U ) ? "" : ",",
+                                       ( unsigned long ) i,
+                                       ( unsigned long ) i );
+    }
+
+    length += ( size_t ) snprintf( &document[ length ], sizeof( document ) - length, "],\"count\":%lu}",
+                                   ( unsigned long ) OVERSIZED_VALUE_COUNT );
+
+    ( void ) snprintf( queryStorage[ 0 ], QUERY_BUFFER_LENGTH, "values[0].id" );
+    ( void ) snprintf( queryStorage[ 1 ], QUERY_BUFFER_LENGTH, "values[%lu].name", ( unsigned long ) ( OVERSIZED_VALUE_COUNT - 1U ) );
+    ( void ) snprintf( queryStorage[ 2 ], QUERY_BUFFER_LENGTH, "values[%lu]", ( unsigned long ) ( OVERSIZED_VALUE_COUNT / 2U ) );
+    ( void ) snprintf( queryStorage[ 3 ], QUERY_BUFFER_LENGTH, "values[%lu]", ( unsigned long ) OVERSIZED_VALUE_COUNT );
+
+    for( i = 0U; i < 4U; i++ )
+    {
+        pQueries[ i ] = queryStorage[ i ];
+    }
+
+    pQueries[ 4 ] = "count";
+    pQueries[ 5 ] = "values";
+
+    TEST_ASSERT_EQUAL( JsonIndexSuccess,
+                       compareDocument( document, length, SMALL_INDEX_CAPACITY, pQueries, 6U ) );
+
+    /* Only an index too small for the document falls back to coreJSON. */
+    TEST_ASSERT_EQUAL( JsonIndexSuccess,
+                       JsonIndex_Build( &index, document, length, entries, SMALL_INDEX_CAPACITY, slots ) );
+    TEST_ASSERT_TRUE( index.isSearched );
+    TEST_ASSERT_EQUAL( JsonIndexSuccess,
+                       JsonIndex_Build( &index, document, length, entries, INDEX_CAPACITY, slots ) );
+    TEST_ASSERT_FALSE( index.isSearched );
+}
+
+/**
+ * @brief Benchmarks indexing a shadow document and looking up
+ * #BENCHMARK_LOOKUP_COUNT of its values, against validating it and
+ * searching it with JSON_Search for every value, for documents of 1 KB to
+ * 64 KB.
+ */
+void test_JsonIndex_LookupBenchmark( void )
+{
+    static char queryStorage[ BENCHMARK_LOOKUP_COUNT ][ QUERY_BUFFER_LENGTH ];
+    static size_t queryLengths[ BENCHMARK_LOOKUP_COUNT ];
+    JsonIndex_t index;
+    struct timespec start;
+    const char * pValue = NULL;
+    char * pSearchValue = NULL;
+    size_t valueLength = 0U;
+    size_t maxLength = 0U;
+    size_t length = 0U;
+    size_t sensorCount = 0U;
+    size_t rounds = 0U;
+    size_t round = 0U;
+    size_t i = 0U;
+    uint16_t capacity = 0U;
+    long indexUs = 0L;
+    long searchUs = 0L;
+    bool isFound = true;
+
+    for( maxLength = BENCHMARK_MIN_LENGTH; maxLength <= BENCHMARK_MAX_LENGTH; maxLength *= 2U )
+    {
+        length = writeShadowDocument( maxLength, &sensorCount );
+        rounds = BENCHMARK_BYTES / length;
+
+        /* The index is sized from the document, as the jobs demo does. */
+        capacity = JSON_INDEX_CAPACITY_FOR_LENGTH( length );
+
+        /* The looked up values are spread over the document. */
+        for( i = 0U; i < BENCHMARK_LOOKUP_COUNT; i++ )
+        {
+            queryLengths[ i ] = ( size_t ) snprintf( queryStorage[ i ],
+                                                     QUERY_BUFFER_LENGTH,
+                                                     "state.reported.sensor%lu.value",
+                                                     ( unsigned long ) ( ( i * sensorCount ) / BENCHMARK_LOOKUP_COUNT ) );
+        }
+
+        TEST_ASSERT_EQUAL( JsonIndexSuccess,
+                           JsonIndex_Build( &index, document, length, entries, capacity, slots ) );
+        TEST_ASSERT_FALSE( index.isSearched );
+
+        for( i = 0U; i < BENCHMARK_LOOKUP_COUNT; i++ )
+        {
+            compareFind( &index, document, length, queryStorage[ i ], queryLengths[ i ] );
+        }
+
+        ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+
+        for( round = 0U; ( isFound == true ) && ( round < rounds ); round++ )
+        {
+            isFound = ( JsonIndex_Build( &index, document, length, entries, capacity, slots ) == JsonIndexSuccess );
+
+            for( i = 0U; ( isFound == true ) && ( i < BENCHMARK_LOOKUP_COUNT ); i++ )
+            {
+                isFound = ( JsonIndex_Find( &index, queryStorage[ i ], queryLengths[ i ],
+                                            &pValue, &valueLength, NULL ) == JsonIndexSuccess );
+            }
+        }
+
+        indexUs = microsecondsSince( &start );
+        TEST_ASSERT_TRUE( isFound );
+
+        ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+
+        for( round = 0U; ( isFound == true ) && ( round < rounds ); round++ )
+        {
+            isFound = ( JSON_Validate( document, length ) == JSONSuccess );
+
+            for( i = 0U; ( isFound == true ) && ( i < BENCHMARK_LOOKUP_COUNT ); i++ )
+            {
+                isFound = ( JSON_Search( document, length, queryStorage[ i ], queryLengths[ i ],
+                                         &pSearchValue, &valueLength ) == JSONSuccess );
+            }
+        }
+
+        searchUs = microsecondsSince( &start );
+        TEST_ASSERT_TRUE( isFound );
+
+        LogInfo( ( "%lu byte document, %lu values looked up: index %.2f us, JSON_Search %.2f us.",
+                   ( unsigned long ) length,
+                   ( unsigned long ) BENCHMARK_LOOKUP_COUNT,
+                   ( double ) indexUs / ( double ) rounds,
+                   ( double ) searchUs / ( double ) rounds ) );
+    }
+}
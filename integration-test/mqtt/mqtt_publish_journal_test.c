@@ -0,0 +1,812 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file mqtt_publish_journal_test.c
+ * @brief Tests of the journal of outgoing publishes: round trips through a
+ * reopened journal, recovery from a damaged tail, compaction while publishes
+ * are appended, and the cost of journaling a publish.
+ */
+
+/* Standard header includes. */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* POSIX includes. */
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Include config file before other non-system includes. */
+#include "test_config.h"
+
+/* Unity testing framework includes. */
+#include "unity.h"
+
+/* Include the publish journal and the retransmission store. */
+#include "mqtt_publish_journal.h"
+#include "mqtt_retransmit_store.h"
+
+/**
+ * @brief Path of the journal file, in the working directory.
+ */
+#define JOURNAL_PATH                   "mqtt_publish_journal_test.bin"
+
+/**
+ * @brief Path of the file a journal is compacted into.
+ */
+#define JOURNAL_COMPACT_PATH           JOURNAL_PATH ".compact"
+
+/**
+ * @brief Number of publishes the retransmission store can keep.
+ */
+#define STORE_CAPACITY                 ( MQTT_PUBLISH_JOURNAL_MAX_LIVE )
+
+/**
+ * @brief Size of the buffer a topic is formatted into.
+ */
+#define TOPIC_BUFFER_SIZE              ( 32U )
+
+/**
+ * @brief Largest payload of a publish of the tests.
+ */
+#define MAX_PAYLOAD_LENGTH             ( 2048U )
+
+/**
+ * @brief Number of publishes appended by the round trip tests.
+ */
+#define ROUND_TRIP_PUBLISH_COUNT       ( 20U )
+
+/**
+ * @brief Number of threads appending publishes while the journal is
+ * compacted.
+ */
+#define APPENDER_THREAD_COUNT          ( 2U )
+
+/**
+ * @brief Number of publishes each thread appends while the journal is
+ * compacted, enough to fill the journal file several times.
+ */
+#define APPENDER_PUBLISH_COUNT         ( 2000U )
+
+/**
+ * @brief Number of publishes each thread keeps unacknowledged.
+ */
+#define APPENDER_WINDOW                ( 8U )
+
+/**
+ * @brief Packet identifiers of the publishes of appender thread i start at
+ * 1 + i * #APPENDER_ID_STRIDE.
+ */
+#define APPENDER_ID_STRIDE             ( 10000U )
+
+/**
+ * @brief Number of publishes the journal keeps when the store restores
+ * fewer of them.
+ */
+#define SMALL_STORE_CAPACITY           ( 4U )
+
+/**
+ * @brief Number of publishes of the benchmark.
+ */
+#define BENCHMARK_PUBLISH_COUNT        ( 100000U )
+
+/**
+ * @brief Payload length of the publishes of the benchmark, that of a
+ * typical device defender report.
+ */
+#define BENCHMARK_PAYLOAD_LENGTH       ( 256U )
+
+/**
+ * @brief Number of publishes the benchmark keeps unacknowledged, as with a
+ * round trip of that many publishes to the broker.
+ */
+#define BENCHMARK_WINDOW               ( 16U )
+
+/**
+ * @brief Size of the buffer the publishes of the benchmark are serialized
+ * into.
+ */
+#define BENCHMARK_BUFFER_SIZE          ( 512U )
+
+/**
+ * @brief Nanoseconds per microsecond.
+ */
+#define NANOSECONDS_PER_MICROSECOND    ( 1000L )
+
+/**
+ * @brief Microseconds per second.
+ */
+#define MICROSECONDS_PER_SECOND        ( 1000000L )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief State of a thread appending publishes while the journal is
+ * compacted.
+ */
+typedef struct AppenderThread
+{
+    pthread_t thread;          /**< @brief The thread. */
+    uint16_t firstPacketId;    /**< @brief Packet identifier of its first publish. */
+    uint32_t appendedCount;    /**< @brief Number of publishes it appended. */
+    uint32_t failedCount;      /**< @brief Number of appends and acks that failed. */
+    uint32_t appendedBytes;    /**< @brief Number of payload bytes it appended. */
+} AppenderThread_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The journal under test.
+ */
+static MqttPublishJournal_t journal;
+
+/**
+ * @brief Whether #journal is open, so that tearDown closes it.
+ */
+static bool isJournalOpen = false;
+
+/**
+ * @brief The store publishes are restored into, and its storage.
+ */
+static MqttRetransmitStore_t store;
+static MqttRetransmitEntry_t storeEntries[ STORE_CAPACITY ];
+static uint16_t storeIndex[ MQTT_RETRANSMIT_STORE_INDEX_SIZE( STORE_CAPACITY ) ];
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Get the payload length of the publish with a packet identifier.
+ * Some publishes have no payload.
+ *
+ * @param[in] packetId The packet identifier.
+ *
+ * @return The payload length.
+ */
+static size_t getPayloadLength( uint16_t packetId );
+
+/**
+ * @brief Build the publish with a packet identifier. Its topic and payload
+ * are derived from the packet identifier, so that restored publishes can be
+ * checked.
+ *
+ * @param[out] pPublishInfo The publish.
+ * @param[in] packetId The packet identifier.
+ * @param[out] pTopic Buffer of #TOPIC_BUFFER_SIZE bytes for the topic.
+ * @param[out] pPayload Buffer of #MAX_PAYLOAD_LENGTH bytes for the payload.
+ * @param[in] payloadLength Length of the payload.
+ */
+static void buildPublish( MQTTPublishInfo_t * pPublishInfo,
+                          uint16_t packetId,
+                          char * pTopic,
+                          uint8_t * pPayload,
+                          size_t payloadLength );
+
+/**
+ * @brief Append the publish with a packet identifier and the payload length
+ * of #getPayloadLength to #journal.
+ *
+ * @param[in] packetId The packet identifier.
+ *
+ * @return The result of #MqttPublishJournal_Append.
+ */
+static bool appendPublish( uint16_t packetId );
+
+/**
+ * @brief Check that #store keeps the publish with a packet identifier, as
+ * built by #buildPublish.
+ *
+ * @param[in] packetId The packet identifier.
+ * @param[in] payloadLength Length of the payload of the publish.
+ */
+static void checkRestoredPublish( uint16_t packetId,
+                                  size_t payloadLength );
+
+/**
+ * @brief Open #journal at #JOURNAL_PATH, and restore its publishes into an
+ * empty #store.
+ *
+ * @param[in] capacity Number of publishes #store can keep.
+ *
+ * @return The number of restored publishes.
+ */
+static uint16_t reopenJournal( uint16_t capacity );
+
+/**
+ * @brief Close #journal.
+ */
+static void closeJournal( void );
+
+/**
+ * @brief Append three publishes to a new journal, damage the file after the
+ * first two of them, and check that reopening the journal drops only the
+ * damaged record, and appends after the intact ones.
+ *
+ * @param[in] truncate true to cut the file in the middle of the third
+ * record, as after a torn write; false to corrupt a byte of its payload.
+ */
+static void checkDamagedTail( bool truncate );
+
+/**
+ * @brief Append publishes to #journal and acknowledge all but the last
+ * #APPENDER_WINDOW of them.
+ *
+ * @param[in] pArgs The #AppenderThread_t of the thread.
+ *
+ * @return NULL.
+ */
+static void * appenderThread( void * pArgs );
+
+/**
+ * @brief Transport send function of the benchmark, discarding the bytes.
+ *
+ * @param[in] pNetworkContext Unused.
+ * @param[in] pBuffer Unused.
+ * @param[in] bytesToSend Number of bytes to send.
+ *
+ * @return @p bytesToSend.
+ */
+static int32_t discardSend( NetworkContext_t * pNetworkContext,
+                            const void * pBuffer,
+                            size_t bytesToSend );
+
+/**
+ * @brief Send #BENCHMARK_PUBLISH_COUNT publishes as the defender demo does:
+ * keep each in #store, serialize and send it, and forget it when it is
+ * acknowledged #BENCHMARK_WINDOW publishes later.
+ *
+ * @param[in] useJournal Whether the publishes are also appended to #journal
+ * and acknowledged in it.
+ *
+ * @return The number of publishes per second.
+ */
+static double benchmarkPublishes( bool useJournal );
+
+/**
+ * @brief Get the number of microseconds elapsed since a time.
+ *
+ * @param[in] pStart The time.
+ *
+ * @return The number of microseconds.
+ */
+static long microsecondsSince( const struct timespec * pStart );
+
+/*-----------------------------------------------------------*/
+
+static size_t getPayloadLength( uint16_t packetId )
+{
+    return ( ( size_t ) packetId * 37U ) % 300U;
+}
+
+/*-----------------------------------------------------------*/
+
+static void buildPublish( MQTTPublishInfo_t * pPublishInfo,
+                          uint16_t packetId,
+                          char * pTopic,
+                          uint8_t * pPayload,
+                          size_t payloadLength )
+{
+    size_t index = 0U;
+
+    ( void ) snprintf( pTopic, TOPIC_BUFFER_SIZE, "test/journal/%u", ( unsigned int ) packetId );
+
+    for( index = 0U; index < payloadLength; index++ )
+    {
+        pPayload[ index ] = ( uint8_t ) ( packetId + index );
+    }
+
+    ( void ) memset( pPublishInfo, 0, sizeof( MQTTPublishInfo_t ) );
+    pPublishInfo->qos = MQTTQoS1;
+    pPublishInfo->retain = ( ( packetId % 5U ) == 0U );
+    pPublishInfo->pTopicName = pTopic;
+    pPublishInfo->topicNameLength = ( uint16_t ) strlen( pTopic );
+    pPublishInfo->pPayload = pPayload;
+    pPublishInfo->payloadLength = payloadLength;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool appendPublish( uint16_t packetId )
+{
+    MQTTPublishInfo_t publishInfo;
+    char topic[ TOPIC_BUFFER_SIZE ];
+    uint8_t payload[ MAX_PAYLOAD_LENGTH ];
+
+    buildPublish( &publishInfo, packetId, topic, payload, getPayloadLength( packetId ) );
+
+    return MqttPublishJournal_Append( &journal, packetId, &publishInfo );
+}
+
+/*-----------------------------------------------------------*/
+
+static void checkRestoredPublish( uint16_t packetId,
+                                  size_t payloadLength )
+{
+    MQTTPublishInfo_t expected;
+    const MQTTPublishInfo_t * pRestored = NULL;
+    char topic[ TOPIC_BUFFER_SIZE ];
+    uint8_t payload[ MAX_PAYLOAD_LENGTH ];
+    uint16_t index = 0U;
+
+    buildPublish( &expected, packetId, topic, payload, payloadLength );
+    TEST_ASSERT_TRUE( MqttRetransmitStore_Contains( &store, packetId ) );
+
+    for( index = 0U; ( pRestored == NULL ) && ( index < STORE_CAPACITY ); index++ )
+    {
+        if( storeEntries[ index ].packetId == packetId )
+        {
+            pRestored = &storeEntries[ index ].publishInfo;
+        }
+    }
+
+    TEST_ASSERT_NOT_NULL( pRestored );
+    TEST_ASSERT_EQUAL( expected.qos, pRestored->qos );
+    TEST_ASSERT_EQUAL( expected.retain, pRestored->retain );
+    TEST_ASSERT_EQUAL_UINT16( expected.topicNameLength, pRestored->topicNameLength );
+    TEST_ASSERT_EQUAL_MEMORY( expected.pTopicName, pRestored->pTopicName, expected.topicNameLength );
+    TEST_ASSERT_EQUAL_UINT32( expected.payloadLength, pRestored->payloadLength );
+
+    if( payloadLength > 0U )
+    {
+        TEST_ASSERT_EQUAL_MEMORY( expected.pPayload, pRestored->pPayload, payloadLength );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static uint16_t reopenJournal( uint16_t capacity )
+{
+    TEST_ASSERT_TRUE( MqttPublishJournal_Open( &journal, JOURNAL_PATH ) );
+    isJournalOpen = true;
+
+    ( void ) memset( storeEntries, 0, sizeof( storeEntries ) );
+    MqttRetransmitStore_Init( &store, storeEntries, capacity, storeIndex );
+
+    return MqttPublishJournal_Restore( &journal, &store );
+}
+
+/*-----------------------------------------------------------*/
+
+static void closeJournal( void )
+{
+    MqttPublishJournal_Close( &journal );
+    isJournalOpen = false;
+}
+
+/*-----------------------------------------------------------*/
+
+static void checkDamagedTail( bool truncate )
+{
+    uint32_t recordEnds[ 3 ];
+    uint32_t damagedOffset = 0U;
+    uint8_t byte = 0U;
+    uint16_t packetId = 0U;
+    int fileDescriptor = -1;
+
+    TEST_ASSERT_EQUAL_UINT16( 0U, reopenJournal( STORE_CAPACITY ) );
+
+    for( packetId = 1U; packetId <= 3U; packetId++ )
+    {
+        TEST_ASSERT_TRUE( appendPublish( packetId ) );
+        recordEnds[ packetId - 1U ] = journal.tail;
+    }
+
+    closeJournal();
+
+    /* The middle of the payload of the third record. */
+    damagedOffset = recordEnds[ 2 ] - ( ( uint32_t ) getPayloadLength( 3U ) / 2U ) - 8U;
+    fileDescriptor = open( JOURNAL_PATH, O_RDWR );
+    TEST_ASSERT_GREATER_OR_EQUAL( 0, fileDescriptor );
+
+    if( truncate == true )
+    {
+        TEST_ASSERT_EQUAL( 0, ftruncate( fileDescriptor, ( off_t ) damagedOffset ) );
+    }
+    else
+    {
+        TEST_ASSERT_EQUAL( 1, pread( fileDescriptor, &byte, 1U, ( off_t ) damagedOffset ) );
+        byte ^= 0x10U;
+        TEST_ASSERT_EQUAL( 1, pwrite( fileDescriptor, &byte, 1U, ( off_t ) damagedOffset ) );
+    }
+
+    ( void ) close( fileDescriptor );
+
+    /* Only the damaged record is dropped, and the next one takes its
+     * place. */
+    TEST_ASSERT_EQUAL_UINT16( 2U, reopenJournal( STORE_CAPACITY ) );
+    TEST_ASSERT_EQUAL_UINT32( recordEnds[ 1 ], journal.tail );
+    TEST_ASSERT_FALSE( MqttRetransmitStore_Contains( &store, 3U ) );
+    checkRestoredPublish( 1U, getPayloadLength( 1U ) );
+    checkRestoredPublish( 2U, getPayloadLength( 2U ) );
+    TEST_ASSERT_TRUE( appendPublish( 4U ) );
+    closeJournal();
+
+    TEST_ASSERT_EQUAL_UINT16( 3U, reopenJournal( STORE_CAPACITY ) );
+    checkRestoredPublish( 1U, getPayloadLength( 1U ) );
+    checkRestoredPublish( 2U, getPayloadLength( 2U ) );
+    checkRestoredPublish( 4U, getPayloadLength( 4U ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static void * appenderThread( void * pArgs )
+{
+    AppenderThread_t * pThread = ( AppenderThread_t * ) pArgs;
+    MQTTPublishInfo_t publishInfo;
+    char topic[ TOPIC_BUFFER_SIZE ];
+    uint8_t payload[ MAX_PAYLOAD_LENGTH ];
+    uint32_t index = 0U;
+    uint16_t packetId = 0U;
+
+    for( index = 0U; index < APPENDER_PUBLISH_COUNT; index++ )
+    {
+        packetId = ( uint16_t ) ( pThread->firstPacketId + index );
+        buildPublish( &publishInfo, packetId, topic, payload, MAX_PAYLOAD_LENGTH );
+
+        if( MqttPublishJournal_Append( &journal, packetId, &publishInfo ) == true )
+        {
+            pThread->appendedCount++;
+            pThread->appendedBytes += MAX_PAYLOAD_LENGTH;
+        }
+        else
+        {
+            pThread->failedCount++;
+        }
+
+        if( ( index >= APPENDER_WINDOW ) &&
+            ( MqttPublishJournal_Ack( &journal, ( uint16_t ) ( packetId - APPENDER_WINDOW ) ) == false ) )
+        {
+            pThread->failedCount++;
+        }
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t discardSend( NetworkContext_t * pNetworkContext,
+                            const void * pBuffer,
+                            size_t bytesToSend )
+{
+    ( void ) pNetworkContext;
+    ( void ) pBuffer;
+
+    return ( int32_t ) bytesToSend;
+}
+
+/*-----------------------------------------------------------*/
+
+static double benchmarkPublishes( bool useJournal )
+{
+    MQTTPublishInfo_t publishInfo;
+    MQTTFixedBuffer_t networkBuffer;
+    TransportInterface_t transport;
+    struct timespec start;
+    char topic[ TOPIC_BUFFER_SIZE ];
+    uint8_t payload[ MAX_PAYLOAD_LENGTH ];
+    uint8_t buffer[ BENCHMARK_BUFFER_SIZE ];
+    size_t remainingLength = 0U, packetSize = 0U;
+    uint32_t index = 0U;
+    uint16_t packetId = 0U;
+    long elapsed = 0L;
+
+    ( void ) memset( &transport, 0, sizeof( transport ) );
+    transport.send = discardSend;
+    networkBuffer.pBuffer = buffer;
+    networkBuffer.size = sizeof( buffer );
+
+    ( void ) memset( storeEntries, 0, sizeof( storeEntries ) );
+    MqttRetransmitStore_Init( &store, storeEntries, STORE_CAPACITY, storeIndex );
+
+    /* Every publish has the same topic and payload, which the store does not
+     * copy. */
+    buildPublish( &publishInfo, 1U, topic, payload, BENCHMARK_PAYLOAD_LENGTH );
+    TEST_ASSERT_EQUAL( MQTTSuccess,
+                       MQTT_GetPublishPacketSize( &publishInfo, &remainingLength, &packetSize ) );
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+
+    for( index = 0U; index < BENCHMARK_PUBLISH_COUNT; index++ )
+    {
+        packetId = ( uint16_t ) ( ( index % UINT16_MAX ) + 1U );
+        TEST_ASSERT_TRUE( MqttRetransmitStore_Add( &store, packetId, &publishInfo ) );
+
+        if( useJournal == true )
+        {
+            TEST_ASSERT_TRUE( MqttPublishJournal_Append( &journal, packetId, &publishInfo ) );
+        }
+
+        TEST_ASSERT_EQUAL( MQTTSuccess,
+                           MQTT_SerializePublish( &publishInfo, packetId, remainingLength, &networkBuffer ) );
+        TEST_ASSERT_EQUAL( ( int32_t ) packetSize,
+                           transport.send( transport.pNetworkContext, buffer, packetSize ) );
+
+        if( index >= BENCHMARK_WINDOW )
+        {
+            packetId = ( uint16_t ) ( ( ( index - BENCHMARK_WINDOW ) % UINT16_MAX ) + 1U );
+            TEST_ASSERT_TRUE( MqttRetransmitStore_Remove( &store, packetId ) );
+
+            if( useJournal == true )
+            {
+                TEST_ASSERT_TRUE( MqttPublishJournal_Ack( &journal, packetId ) );
+            }
+        }
+    }
+
+    elapsed = microsecondsSince( &start );
+
+    return ( ( double ) BENCHMARK_PUBLISH_COUNT * MICROSECONDS_PER_SECOND ) / ( double ) elapsed;
+}
+
+/*-----------------------------------------------------------*/
+
+static long microsecondsSince( const struct timespec * pStart )
+{
+    struct timespec now;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ( ( now.tv_sec - pStart->tv_sec ) * MICROSECONDS_PER_SECOND ) +
+           ( ( now.tv_nsec - pStart->tv_nsec ) / NANOSECONDS_PER_MICROSECOND );
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+void setUp()
+{
+    ( void ) unlink( JOURNAL_PATH );
+    ( void ) unlink( JOURNAL_COMPACT_PATH );
+    isJournalOpen = false;
+}
+
+/*-----------------------------------------------------------*/
+
+void tearDown()
+{
+    if( isJournalOpen == true )
+    {
+        closeJournal();
+    }
+
+    ( void ) unlink( JOURNAL_PATH );
+    ( void ) unlink( JOURNAL_COMPACT_PATH );
+}
+
+/* ========================== Test Cases ============================ */
+
+/**
+ * @brief Unacknowledged publishes survive reopening the journal, with their
+ * topics, payloads and flags, and acknowledged ones do not.
+ */
+void test_MqttPublishJournal_AppendAckReopenRoundTrip( void )
+{
+    uint16_t packetId = 0U;
+
+    TEST_ASSERT_EQUAL_UINT16( 0U, reopenJournal( STORE_CAPACITY ) );
+
+    for( packetId = 1U; packetId <= ROUND_TRIP_PUBLISH_COUNT; packetId++ )
+    {
+        TEST_ASSERT_TRUE( appendPublish( packetId ) );
+    }
+
+    TEST_ASSERT_FALSE( appendPublish( 1U ) );
+
+    for( packetId = 2U; packetId <= ROUND_TRIP_PUBLISH_COUNT; packetId += 2U )
+    {
+        TEST_ASSERT_TRUE( MqttPublishJournal_Ack( &journal, packetId ) );
+    }
+
+    TEST_ASSERT_FALSE( MqttPublishJournal_Ack( &journal, 2U ) );
+    TEST_ASSERT_FALSE( MqttPublishJournal_Ack( &journal, ROUND_TRIP_PUBLISH_COUNT + 1U ) );
+    closeJournal();
+
+    TEST_ASSERT_EQUAL_UINT16( ROUND_TRIP_PUBLISH_COUNT / 2U, reopenJournal( STORE_CAPACITY ) );
+    TEST_ASSERT_EQUAL_UINT16( ROUND_TRIP_PUBLISH_COUNT / 2U, MqttRetransmitStore_PendingCount( &store ) );
+
+    for( packetId = 1U; packetId <= ROUND_TRIP_PUBLISH_COUNT; packetId++ )
+    {
+        if( ( packetId % 2U ) == 1U )
+        {
+            checkRestoredPublish( packetId, getPayloadLength( packetId ) );
+        }
+        else
+        {
+            TEST_ASSERT_FALSE( MqttRetransmitStore_Contains( &store, packetId ) );
+        }
+    }
+
+    /* Acknowledging restored publishes removes them from the journal. */
+    TEST_ASSERT_TRUE( MqttPublishJournal_Ack( &journal, 1U ) );
+    TEST_ASSERT_TRUE( MqttPublishJournal_Ack( &journal, 3U ) );
+    closeJournal();
+
+    TEST_ASSERT_EQUAL_UINT16( ( ROUND_TRIP_PUBLISH_COUNT / 2U ) - 2U, reopenJournal( STORE_CAPACITY ) );
+    TEST_ASSERT_FALSE( MqttRetransmitStore_Contains( &store, 1U ) );
+    TEST_ASSERT_FALSE( MqttRetransmitStore_Contains( &store, 3U ) );
+    checkRestoredPublish( 5U, getPayloadLength( 5U ) );
+
+    /* A session that is not resumed forgets all the publishes. */
+    MqttPublishJournal_Clear( &journal );
+    closeJournal();
+
+    TEST_ASSERT_EQUAL_UINT16( 0U, reopenJournal( STORE_CAPACITY ) );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief A record cut short by a crash while it was written is dropped when
+ * the journal is opened, with the records before it kept.
+ */
+void test_MqttPublishJournal_TornTailTruncatedOnOpen( void )
+{
+    checkDamagedTail( true );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief A record whose CRC does not match its content is dropped when the
+ * journal is opened, with the records before it kept.
+ */
+void test_MqttPublishJournal_CorruptTailTruncatedOnOpen( void )
+{
+    checkDamagedTail( false );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief A file that is not a journal is replaced by an empty journal.
+ */
+void test_MqttPublishJournal_ForeignFileReplaced( void )
+{
+    static const char content[] = "not a publish journal, but long enough";
+    int fileDescriptor = -1;
+
+    fileDescriptor = open( JOURNAL_PATH, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR );
+    TEST_ASSERT_GREATER_OR_EQUAL( 0, fileDescriptor );
+    TEST_ASSERT_EQUAL( ( ssize_t ) sizeof( content ), write( fileDescriptor, content, sizeof( content ) ) );
+    ( void ) close( fileDescriptor );
+
+    TEST_ASSERT_EQUAL_UINT16( 0U, reopenJournal( STORE_CAPACITY ) );
+    TEST_ASSERT_TRUE( appendPublish( 1U ) );
+    closeJournal();
+
+    TEST_ASSERT_EQUAL_UINT16( 1U, reopenJournal( STORE_CAPACITY ) );
+    checkRestoredPublish( 1U, getPayloadLength( 1U ) );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Publishes appended from several threads while the journal is
+ * compacted, both by the committer thread and by appends that find the file
+ * full, are all kept until they are acknowledged.
+ */
+void test_MqttPublishJournal_CompactionWhileAppending( void )
+{
+    AppenderThread_t threads[ APPENDER_THREAD_COUNT ];
+    uint32_t threadIndex = 0U, appendedBytes = 0U, index = 0U;
+    uint16_t packetId = 0U;
+
+    TEST_ASSERT_EQUAL_UINT16( 0U, reopenJournal( STORE_CAPACITY ) );
+    ( void ) memset( threads, 0, sizeof( threads ) );
+
+    for( threadIndex = 0U; threadIndex < APPENDER_THREAD_COUNT; threadIndex++ )
+    {
+        threads[ threadIndex ].firstPacketId = ( uint16_t ) ( 1U + ( threadIndex * APPENDER_ID_STRIDE ) );
+        TEST_ASSERT_EQUAL( 0, pthread_create( &threads[ threadIndex ].thread, NULL,
+                                              appenderThread, &threads[ threadIndex ] ) );
+    }
+
+    for( threadIndex = 0U; threadIndex < APPENDER_THREAD_COUNT; threadIndex++ )
+    {
+        TEST_ASSERT_EQUAL( 0, pthread_join( threads[ threadIndex ].thread, NULL ) );
+        TEST_ASSERT_EQUAL_UINT32( 0U, threads[ threadIndex ].failedCount );
+        TEST_ASSERT_EQUAL_UINT32( APPENDER_PUBLISH_COUNT, threads[ threadIndex ].appendedCount );
+        appendedBytes += threads[ threadIndex ].appendedBytes;
+    }
+
+    /* The publishes filled the file several times over, so it was
+     * compacted. */
+    TEST_ASSERT_GREATER_THAN_UINT32( 4U * MQTT_PUBLISH_JOURNAL_FILE_SIZE, appendedBytes );
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32( MQTT_PUBLISH_JOURNAL_FILE_SIZE, journal.tail );
+    TEST_ASSERT_EQUAL_UINT16( APPENDER_THREAD_COUNT * APPENDER_WINDOW, journal.liveCount );
+    closeJournal();
+
+    TEST_ASSERT_NOT_EQUAL( 0, access( JOURNAL_COMPACT_PATH, F_OK ) );
+    TEST_ASSERT_EQUAL_UINT16( APPENDER_THREAD_COUNT * APPENDER_WINDOW, reopenJournal( STORE_CAPACITY ) );
+
+    for( threadIndex = 0U; threadIndex < APPENDER_THREAD_COUNT; threadIndex++ )
+    {
+        for( index = APPENDER_PUBLISH_COUNT - APPENDER_WINDOW; index < APPENDER_PUBLISH_COUNT; index++ )
+        {
+            packetId = ( uint16_t ) ( threads[ threadIndex ].firstPacketId + index );
+            checkRestoredPublish( packetId, MAX_PAYLOAD_LENGTH );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Publishes the store has no room for are dropped from the journal,
+ * and the oldest ones are restored.
+ */
+void test_MqttPublishJournal_RestoreIntoStore( void )
+{
+    uint16_t packetId = 0U;
+
+    TEST_ASSERT_EQUAL_UINT16( 0U, reopenJournal( STORE_CAPACITY ) );
+
+    for( packetId = 1U; packetId <= ROUND_TRIP_PUBLISH_COUNT; packetId++ )
+    {
+        TEST_ASSERT_TRUE( appendPublish( packetId ) );
+    }
+
+    closeJournal();
+
+    TEST_ASSERT_EQUAL_UINT16( SMALL_STORE_CAPACITY, reopenJournal( SMALL_STORE_CAPACITY ) );
+    TEST_ASSERT_EQUAL_UINT16( SMALL_STORE_CAPACITY, MqttRetransmitStore_PendingCount( &store ) );
+
+    for( packetId = 1U; packetId <= SMALL_STORE_CAPACITY; packetId++ )
+    {
+        checkRestoredPublish( packetId, getPayloadLength( packetId ) );
+    }
+
+    TEST_ASSERT_EQUAL_UINT16( SMALL_STORE_CAPACITY, journal.liveCount );
+    closeJournal();
+
+    /* The dropped publishes were acknowledged in the journal. */
+    TEST_ASSERT_EQUAL_UINT16( SMALL_STORE_CAPACITY, reopenJournal( STORE_CAPACITY ) );
+    TEST_ASSERT_FALSE( MqttRetransmitStore_Contains( &store, SMALL_STORE_CAPACITY + 1U ) );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Measure the publishes per second of the defender demo's publish
+ * path with and without the journal.
+ */
+void test_MqttPublishJournal_PublishesPerSecond( void )
+{
+    double withoutJournal = 0.0, withJournal = 0.0;
+
+    withoutJournal = benchmarkPublishes( false );
+
+    TEST_ASSERT_EQUAL_UINT16( 0U, reopenJournal( STORE_CAPACITY ) );
+    withJournal = benchmarkPublishes( true );
+
+    LogInfo( ( "%u publishes of %u bytes: %.0f publishes/s without the journal, "
+               "%.0f publishes/s with it (%.2f us per journaled publish).",
+               ( unsigned int ) BENCHMARK_PUBLISH_COUNT,
+               ( unsigned int ) BENCHMARK_PAYLOAD_LENGTH,
+               withoutJournal,
+               withJournal,
+               ( MICROSECONDS_PER_SECOND / withJournal ) - ( MICROSECONDS_PER_SECOND / withoutJournal ) ) );
+}
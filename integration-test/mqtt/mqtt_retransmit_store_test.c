@@ -0,0 +1,817 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file mqtt_retransmit_store_test.c
+ * @brief Tests of resending the publishes of the retransmission store
+ * through a loopback transport, comparing the bytes sent with those of
+ * MQTT_SerializePublish, and a benchmark of resending 1,000 publishes.
+ */
+
+/* Standard header includes. */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* POSIX includes. */
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/* Include config file before other non-system includes. */
+#include "test_config.h"
+
+/* Unity testing framework includes. */
+#include "unity.h"
+
+/* Include the retransmission store. */
+#include "mqtt_retransmit_store.h"
+
+/**
+ * @brief Number of publishes the store can keep.
+ */
+#define STORE_CAPACITY                 ( 1024U )
+
+/**
+ * @brief Size of the buffer a topic is formatted into.
+ */
+#define TOPIC_BUFFER_SIZE              ( 32U )
+
+/**
+ * @brief Size of the buffer the payloads of the publishes are taken from.
+ */
+#define PAYLOAD_POOL_SIZE              ( 20000U )
+
+/**
+ * @brief Size of the buffers the loopback transport captures into, and the
+ * expected bytes are serialized into.
+ */
+#define CAPTURE_BUFFER_SIZE            ( 2U * 1024U * 1024U )
+
+/**
+ * @brief Number of publishes crossing two flush batch boundaries.
+ */
+#define BATCH_CROSSING_COUNT           ( ( 2U * MQTT_RETRANSMIT_STORE_FLUSH_BATCH ) + 3U )
+
+/**
+ * @brief Number of publishes of the benchmark.
+ */
+#define BENCHMARK_PUBLISH_COUNT        ( 1000U )
+
+/**
+ * @brief Payload length of the publishes of the benchmark.
+ */
+#define BENCHMARK_PAYLOAD_LENGTH       ( 256U )
+
+/**
+ * @brief Number of times each way of resending is measured.
+ */
+#define BENCHMARK_ITERATIONS           ( 50U )
+
+/**
+ * @brief Nanoseconds per microsecond.
+ */
+#define NANOSECONDS_PER_MICROSECOND    ( 1000L )
+
+/**
+ * @brief Microseconds per second.
+ */
+#define MICROSECONDS_PER_SECOND        ( 1000000L )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief A loopback transport, capturing what is sent into a buffer, or
+ * writing it to a socket.
+ */
+struct NetworkContext
+{
+    int socket;               /**< @brief Socket written to, or -1 to capture. */
+    uint8_t * pCapture;       /**< @brief Buffer of #CAPTURE_BUFFER_SIZE bytes receiving the data. */
+    size_t capturedLength;    /**< @brief Number of bytes captured. */
+    size_t maxBytesPerCall;   /**< @brief Most bytes accepted by one call, 0 for no limit. */
+    bool isStalling;          /**< @brief Whether every other call accepts no data. */
+    size_t failAfter;         /**< @brief Number of bytes after which calls fail, 0 for never. */
+    size_t stallAfter;        /**< @brief Number of bytes after which calls accept no data, 0 for never. */
+    uint32_t callCount;       /**< @brief Number of calls. */
+};
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The store under test and its storage.
+ */
+static MqttRetransmitStore_t store;
+static MqttRetransmitEntry_t storeEntries[ STORE_CAPACITY ];
+static uint16_t storeIndex[ MQTT_RETRANSMIT_STORE_INDEX_SIZE( STORE_CAPACITY ) ];
+
+/**
+ * @brief Topics of the publishes, one per packet identifier.
+ */
+static char topics[ STORE_CAPACITY + 1U ][ TOPIC_BUFFER_SIZE ];
+
+/**
+ * @brief Payloads of the publishes point into this buffer.
+ */
+static uint8_t payloadPool[ PAYLOAD_POOL_SIZE ];
+
+/**
+ * @brief The bytes the loopback transport captured, and those expected.
+ */
+static uint8_t captured[ CAPTURE_BUFFER_SIZE ];
+static uint8_t expected[ CAPTURE_BUFFER_SIZE ];
+
+/**
+ * @brief The transport of #mqttContext.
+ */
+static NetworkContext_t networkContext;
+
+/**
+ * @brief The MQTT context resending the publishes, and its network buffer.
+ */
+static MQTTContext_t mqttContext;
+static uint8_t networkBuffer[ CAPTURE_BUFFER_SIZE / 64U ];
+
+/**
+ * @brief Time of the fake clock of #mqttContext, and by how much it moves
+ * each time it is read.
+ */
+static uint32_t clockMs = 0U;
+static uint32_t clockStepMs = 0U;
+
+/**
+ * @brief Payload lengths of the publishes, repeated in turn: no payload,
+ * payloads around the size of the coalescing buffer, and payloads needing
+ * two and three bytes of remaining length.
+ */
+static const size_t payloadLengths[] = { 0U, 1U, 120U, 300U, 1000U, 1024U, 5000U, 17000U };
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Read the fake clock.
+ *
+ * @return #clockMs, before it moves by #clockStepMs.
+ */
+static uint32_t getFakeTime( void );
+
+/**
+ * @brief Event callback of #mqttContext, which receives nothing.
+ */
+static void eventCallback( MQTTContext_t * pContext,
+                           MQTTPacketInfo_t * pPacketInfo,
+                           MQTTDeserializedInfo_t * pDeserializedInfo );
+
+/**
+ * @brief Get the number of bytes the loopback transport accepts from a call.
+ *
+ * @param[in] pNetworkContext The transport.
+ * @param[in] bytesToSend Number of bytes offered.
+ *
+ * @return The number of bytes to accept, 0 for none, or a negative value if
+ * the call fails.
+ */
+static int32_t getAcceptedLength( NetworkContext_t * pNetworkContext,
+                                  size_t bytesToSend );
+
+/**
+ * @brief Send function of the loopback transport.
+ */
+static int32_t loopbackSend( NetworkContext_t * pNetworkContext,
+                             const void * pBuffer,
+                             size_t bytesToSend );
+
+/**
+ * @brief Writev function of the loopback transport.
+ */
+static int32_t loopbackWritev( NetworkContext_t * pNetworkContext,
+                               TransportOutVector_t * pIoVec,
+                               size_t ioVecCount );
+
+/**
+ * @brief Initialize #mqttContext over the loopback transport.
+ *
+ * @param[in] useWritev Whether the transport has a writev function.
+ */
+static void initContext( bool useWritev );
+
+/**
+ * @brief Build the publish with a packet identifier, whose payload length is
+ * taken in turn from #payloadLengths.
+ *
+ * @param[out] pPublishInfo The publish.
+ * @param[in] packetId The packet identifier.
+ * @param[in] payloadLength Length of the payload.
+ */
+static void buildPublish( MQTTPublishInfo_t * pPublishInfo,
+                          uint16_t packetId,
+                          size_t payloadLength );
+
+/**
+ * @brief Add the publishes with packet identifiers from 1 to @p count to
+ * #store.
+ *
+ * @param[in] count Number of publishes.
+ */
+static void addPublishes( uint16_t count );
+
+/**
+ * @brief Serialize the pending publishes of #store with MQTT_SerializePublish
+ * and the DUP flag set, in the order they were added, into #expected.
+ *
+ * @param[in] pPacketIds Packet identifiers of the pending publishes, in the
+ * order they were added.
+ * @param[in] count Number of pending publishes.
+ *
+ * @return Number of bytes serialized.
+ */
+static size_t serializeExpected( const uint16_t * pPacketIds,
+                                 uint16_t count );
+
+/**
+ * @brief Resend the pending publishes of #store, and check that the bytes
+ * sent are those of MQTT_SerializePublish.
+ *
+ * @param[in] count Number of publishes, with packet identifiers from 1.
+ */
+static void checkResendAll( uint16_t count );
+
+/**
+ * @brief Read and discard all the data written to a socket until it is
+ * closed.
+ *
+ * @param[in] pArgs Pointer to the socket.
+ *
+ * @return NULL.
+ */
+static void * drainSocket( void * pArgs );
+
+/**
+ * @brief Get the number of microseconds elapsed since a time.
+ *
+ * @param[in] pStart The time.
+ *
+ * @return The number of microseconds.
+ */
+static long microsecondsSince( const struct timespec * pStart );
+
+/*-----------------------------------------------------------*/
+
+static uint32_t getFakeTime( void )
+{
+    uint32_t now = clockMs;
+
+    clockMs += clockStepMs;
+
+    return now;
+}
+
+/*-----------------------------------------------------------*/
+
+static void eventCallback( MQTTContext_t * pContext,
+                           MQTTPacketInfo_t * pPacketInfo,
+                           MQTTDeserializedInfo_t * pDeserializedInfo )
+{
+    ( void ) pContext;
+    ( void ) pPacketInfo;
+    ( void ) pDeserializedInfo;
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t getAcceptedLength( NetworkContext_t * pNetworkContext,
+                                  size_t bytesToSend )
+{
+    int32_t accepted = ( int32_t ) bytesToSend;
+
+    pNetworkContext->callCount++;
+
+    if( ( pNetworkContext->failAfter > 0U ) &&
+        ( pNetworkContext->capturedLength >= pNetworkContext->failAfter ) )
+    {
+        accepted = -1;
+    }
+    else if( ( ( pNetworkContext->stallAfter > 0U ) &&
+               ( pNetworkContext->capturedLength >= pNetworkContext->stallAfter ) ) ||
+             ( ( pNetworkContext->isStalling == true ) &&
+               ( ( pNetworkContext->callCount % 2U ) == 0U ) ) )
+    {
+        accepted = 0;
+    }
+    else if( ( pNetworkContext->maxBytesPerCall > 0U ) &&
+             ( bytesToSend > pNetworkContext->maxBytesPerCall ) )
+    {
+        accepted = ( int32_t ) pNetworkContext->maxBytesPerCall;
+    }
+    else
+    {
+        /* All the bytes are accepted. */
+    }
+
+    TEST_ASSERT_LESS_OR_EQUAL( CAPTURE_BUFFER_SIZE, pNetworkContext->capturedLength + ( size_t ) accepted );
+
+    return accepted;
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t loopbackSend( NetworkContext_t * pNetworkContext,
+                             const void * pBuffer,
+                             size_t bytesToSend )
+{
+    int32_t bytesSent = 0;
+
+    if( pNetworkContext->socket >= 0 )
+    {
+        pNetworkContext->callCount++;
+        bytesSent = ( int32_t ) send( pNetworkContext->socket, pBuffer, bytesToSend, 0 );
+    }
+    else
+    {
+        bytesSent = getAcceptedLength( pNetworkContext, bytesToSend );
+
+        if( bytesSent > 0 )
+        {
+            ( void ) memcpy( &pNetworkContext->pCapture[ pNetworkContext->capturedLength ], pBuffer, ( size_t ) bytesSent );
+            pNetworkContext->capturedLength += ( size_t ) bytesSent;
+        }
+    }
+
+    return bytesSent;
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t loopbackWritev( NetworkContext_t * pNetworkContext,
+                               TransportOutVector_t * pIoVec,
+                               size_t ioVecCount )
+{
+    struct iovec socketVectors[ MQTT_RETRANSMIT_STORE_FLUSH_BATCH * 4U ];
+    size_t index = 0U, totalLength = 0U, bytesToCopy = 0U;
+    int32_t bytesSent = 0, bytesLeft = 0;
+
+    TEST_ASSERT_LESS_OR_EQUAL( MQTT_RETRANSMIT_STORE_FLUSH_BATCH * 4U, ioVecCount );
+
+    if( pNetworkContext->socket >= 0 )
+    {
+        for( index = 0U; index < ioVecCount; index++ )
+        {
+            socketVectors[ index ].iov_base = ( void * ) pIoVec[ index ].iov_base;
+            socketVectors[ index ].iov_len = pIoVec[ index ].iov_len;
+        }
+
+        pNetworkContext->callCount++;
+        bytesSent = ( int32_t ) writev( pNetworkContext->socket, socketVectors, ( int ) ioVecCount );
+    }
+    else
+    {
+        for( index = 0U; index < ioVecCount; index++ )
+        {
+            totalLength += pIoVec[ index ].iov_len;
+        }
+
+        bytesSent = getAcceptedLength( pNetworkContext, totalLength );
+        bytesLeft = bytesSent;
+
+        for( index = 0U; ( bytesLeft > 0 ) && ( index < ioVecCount ); index++ )
+        {
+            bytesToCopy = ( pIoVec[ index ].iov_len < ( size_t ) bytesLeft ) ?
+                          pIoVec[ index ].iov_len : ( size_t ) bytesLeft;
+            ( void ) memcpy( &pNetworkContext->pCapture[ pNetworkContext->capturedLength ],
+                             pIoVec[ index ].iov_base, bytesToCopy );
+            pNetworkContext->capturedLength += bytesToCopy;
+            bytesLeft -= ( int32_t ) bytesToCopy;
+        }
+    }
+
+    return bytesSent;
+}
+
+/*-----------------------------------------------------------*/
+
+static void initContext( bool useWritev )
+{
+    TransportInterface_t transport;
+    MQTTFixedBuffer_t fixedBuffer;
+
+    ( void ) memset( &transport, 0, sizeof( transport ) );
+    transport.pNetworkContext = &networkContext;
+    transport.send = loopbackSend;
+    transport.recv = NULL;
+    transport.writev = ( useWritev == true ) ? loopbackWritev : NULL;
+    fixedBuffer.pBuffer = networkBuffer;
+    fixedBuffer.size = sizeof( networkBuffer );
+
+    TEST_ASSERT_EQUAL( MQTTSuccess,
+                       MQTT_Init( &mqttContext, &transport, getFakeTime, eventCallback, &fixedBuffer ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static void buildPublish( MQTTPublishInfo_t * pPublishInfo,
+                          uint16_t packetId,
+                          size_t payloadLength )
+{
+    ( void ) snprintf( topics[ packetId ], TOPIC_BUFFER_SIZE, "test/resend/%u", ( unsigned int ) packetId );
+
+    ( void ) memset( pPublishInfo, 0, sizeof( MQTTPublishInfo_t ) );
+    pPublishInfo->qos = MQTTQoS1;
+    pPublishInfo->retain = ( ( packetId % 3U ) == 0U );
+    pPublishInfo->pTopicName = topics[ packetId ];
+    pPublishInfo->topicNameLength = ( uint16_t ) strlen( topics[ packetId ] );
+    pPublishInfo->pPayload = ( payloadLength > 0U ) ? &payloadPool[ packetId % 512U ] : NULL;
+    pPublishInfo->payloadLength = payloadLength;
+}
+
+/*-----------------------------------------------------------*/
+
+static void addPublishes( uint16_t count )
+{
+    MQTTPublishInfo_t publishInfo;
+    uint16_t packetId = 0U;
+
+    for( packetId = 1U; packetId <= count; packetId++ )
+    {
+        buildPublish( &publishInfo, packetId,
+                      payloadLengths[ packetId % ( sizeof( payloadLengths ) / sizeof( payloadLengths[ 0 ] ) ) ] );
+        TEST_ASSERT_TRUE( MqttRetransmitStore_Add( &store, packetId, &publishInfo ) );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t serializeExpected( const uint16_t * pPacketIds,
+                                 uint16_t count )
+{
+    MQTTPublishInfo_t publishInfo;
+    MQTTFixedBuffer_t fixedBuffer;
+    size_t expectedLength = 0U, remainingLength = 0U, packetSize = 0U;
+    uint16_t index = 0U, packetId = 0U;
+
+    for( index = 0U; index < count; index++ )
+    {
+        packetId = pPacketIds[ index ];
+        buildPublish( &publishInfo, packetId,
+                      payloadLengths[ packetId % ( sizeof( payloadLengths ) / sizeof( payloadLengths[ 0 ] ) ) ] );
+        publishInfo.dup = true;
+
+        TEST_ASSERT_EQUAL( MQTTSuccess,
+                           MQTT_GetPublishPacketSize( &publishInfo, &remainingLength, &packetSize ) );
+        TEST_ASSERT_LESS_OR_EQUAL( CAPTURE_BUFFER_SIZE, expectedLength + packetSize );
+
+        fixedBuffer.pBuffer = &expected[ expectedLength ];
+        fixedBuffer.size = CAPTURE_BUFFER_SIZE - expectedLength;
+        TEST_ASSERT_EQUAL( MQTTSuccess,
+                           MQTT_SerializePublish( &publishInfo, packetId, remainingLength, &fixedBuffer ) );
+        expectedLength += packetSize;
+    }
+
+    return expectedLength;
+}
+
+/*-----------------------------------------------------------*/
+
+static void checkResendAll( uint16_t count )
+{
+    uint16_t packetIds[ STORE_CAPACITY ];
+    size_t expectedLength = 0U;
+    uint16_t index = 0U;
+
+    for( index = 0U; index < count; index++ )
+    {
+        packetIds[ index ] = ( uint16_t ) ( index + 1U );
+    }
+
+    expectedLength = serializeExpected( packetIds, count );
+
+    TEST_ASSERT_EQUAL( MQTTSuccess, MqttRetransmitStore_ResendAll( &store, &mqttContext ) );
+    TEST_ASSERT_EQUAL_UINT32( expectedLength, networkContext.capturedLength );
+    TEST_ASSERT_EQUAL_MEMORY( expected, captured, expectedLength );
+    TEST_ASSERT_EQUAL_UINT16( count, MqttRetransmitStore_PendingCount( &store ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static void * drainSocket( void * pArgs )
+{
+    uint8_t buffer[ 65536 ];
+    int socket = *( ( int * ) pArgs );
+
+    while( read( socket, buffer, sizeof( buffer ) ) > 0 )
+    {
+        /* Discard the data. */
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static long microsecondsSince( const struct timespec * pStart )
+{
+    struct timespec now;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ( ( now.tv_sec - pStart->tv_sec ) * MICROSECONDS_PER_SECOND ) +
+           ( ( now.tv_nsec - pStart->tv_nsec ) / NANOSECONDS_PER_MICROSECOND );
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+void setUp()
+{
+    size_t index = 0U;
+
+    for( index = 0U; index < PAYLOAD_POOL_SIZE; index++ )
+    {
+        payloadPool[ index ] = ( uint8_t ) ( ( index * 7U ) + ( index >> 8 ) );
+    }
+
+    ( void ) memset( &networkContext, 0, sizeof( networkContext ) );
+    networkContext.socket = -1;
+    networkContext.pCapture = captured;
+    clockMs = 0U;
+    clockStepMs = 0U;
+
+    ( void ) memset( storeEntries, 0, sizeof( storeEntries ) );
+    MqttRetransmitStore_Init( &store, storeEntries, STORE_CAPACITY, storeIndex );
+}
+
+/*-----------------------------------------------------------*/
+
+void tearDown()
+{
+}
+
+/* ========================== Test Cases ============================ */
+
+/**
+ * @brief Publishes with and without payloads are resent through writev as
+ * MQTT_SerializePublish serializes them with the DUP flag set.
+ */
+void test_MqttRetransmitStore_ResendAllMatchesSerializePublish( void )
+{
+    initContext( true );
+    addPublishes( 8U );
+
+    checkResendAll( 8U );
+    TEST_ASSERT_EQUAL_UINT32( 1U, networkContext.callCount );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Publishes with and without payloads are resent through send, copied
+ * into the coalescing buffer or sent from where they are, as
+ * MQTT_SerializePublish serializes them with the DUP flag set.
+ */
+void test_MqttRetransmitStore_ResendAllCoalescedMatchesSerializePublish( void )
+{
+    initContext( false );
+    addPublishes( 8U );
+
+    checkResendAll( 8U );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Publishes across two flush batch boundaries are resent in the order
+ * they were added, one writev call per batch, including after publishes were
+ * removed and others added in their place.
+ */
+void test_MqttRetransmitStore_ResendAllCrossesFlushBatches( void )
+{
+    MQTTPublishInfo_t publishInfo;
+    uint16_t packetIds[ BATCH_CROSSING_COUNT ];
+    size_t expectedLength = 0U;
+    uint16_t index = 0U, count = 0U;
+
+    initContext( true );
+    addPublishes( BATCH_CROSSING_COUNT );
+    checkResendAll( BATCH_CROSSING_COUNT );
+    TEST_ASSERT_EQUAL_UINT32( 3U, networkContext.callCount );
+
+    /* Acknowledge every third publish, and reuse two of the packet
+     * identifiers; they are resent last. */
+    for( index = 1U; index <= BATCH_CROSSING_COUNT; index++ )
+    {
+        if( ( index % 3U ) == 0U )
+        {
+            TEST_ASSERT_TRUE( MqttRetransmitStore_Remove( &store, index ) );
+        }
+        else
+        {
+            packetIds[ count ] = index;
+            count++;
+        }
+    }
+
+    buildPublish( &publishInfo, 3U, payloadLengths[ 3 ] );
+    TEST_ASSERT_TRUE( MqttRetransmitStore_Add( &store, 3U, &publishInfo ) );
+    packetIds[ count ] = 3U;
+    count++;
+    buildPublish( &publishInfo, 6U, payloadLengths[ 6 ] );
+    TEST_ASSERT_TRUE( MqttRetransmitStore_Add( &store, 6U, &publishInfo ) );
+    packetIds[ count ] = 6U;
+    count++;
+
+    networkContext.capturedLength = 0U;
+    expectedLength = serializeExpected( packetIds, count );
+    TEST_ASSERT_EQUAL( MQTTSuccess, MqttRetransmitStore_ResendAll( &store, &mqttContext ) );
+    TEST_ASSERT_EQUAL_UINT32( expectedLength, networkContext.capturedLength );
+    TEST_ASSERT_EQUAL_MEMORY( expected, captured, expectedLength );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief A writev transport that accepts a few bytes at a time, and nothing
+ * every other call, receives every byte once and in order.
+ */
+void test_MqttRetransmitStore_ResendAllPartialWritev( void )
+{
+    initContext( true );
+    networkContext.maxBytesPerCall = 7U;
+    networkContext.isStalling = true;
+    addPublishes( BATCH_CROSSING_COUNT );
+
+    checkResendAll( BATCH_CROSSING_COUNT );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief A send transport that accepts part of the coalescing buffer at a
+ * time resumes from the first byte it did not accept, whether it stopped in
+ * a copied buffer or in one sent from where it is.
+ */
+void test_MqttRetransmitStore_ResendAllPartialCoalescedSend( void )
+{
+    static const size_t maxBytesPerCall[] = { 1U, 5U, 333U, MQTT_RETRANSMIT_STORE_SEND_BUFFER_SIZE - 1U, 4096U };
+    size_t index = 0U;
+
+    initContext( false );
+    addPublishes( BATCH_CROSSING_COUNT );
+
+    for( index = 0U; index < ( sizeof( maxBytesPerCall ) / sizeof( maxBytesPerCall[ 0 ] ) ); index++ )
+    {
+        networkContext.capturedLength = 0U;
+        networkContext.maxBytesPerCall = maxBytesPerCall[ index ];
+        networkContext.isStalling = ( index % 2U ) == 0U;
+
+        checkResendAll( BATCH_CROSSING_COUNT );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief A transport error stops the resend, and the publishes stay in the
+ * store.
+ */
+void test_MqttRetransmitStore_ResendAllTransportFailure( void )
+{
+    initContext( true );
+    networkContext.failAfter = 10000U;
+    addPublishes( BATCH_CROSSING_COUNT );
+
+    TEST_ASSERT_EQUAL( MQTTSendFailed, MqttRetransmitStore_ResendAll( &store, &mqttContext ) );
+    TEST_ASSERT_EQUAL_UINT16( BATCH_CROSSING_COUNT, MqttRetransmitStore_PendingCount( &store ) );
+
+    initContext( false );
+    networkContext.capturedLength = 0U;
+    TEST_ASSERT_EQUAL( MQTTSendFailed, MqttRetransmitStore_ResendAll( &store, &mqttContext ) );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief A transport that accepts no data for longer than
+ * #MQTT_RETRANSMIT_STORE_SEND_TIMEOUT_MS fails the resend.
+ */
+void test_MqttRetransmitStore_ResendAllTimesOut( void )
+{
+    initContext( true );
+    networkContext.maxBytesPerCall = 50U;
+    networkContext.stallAfter = 100U;
+    clockStepMs = MQTT_RETRANSMIT_STORE_SEND_TIMEOUT_MS / 4U;
+    addPublishes( 8U );
+
+    TEST_ASSERT_EQUAL( MQTTSendFailed, MqttRetransmitStore_ResendAll( &store, &mqttContext ) );
+    TEST_ASSERT_EQUAL_UINT32( 100U, networkContext.capturedLength );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Measure resending 1,000 publishes over a socket through writev and
+ * through send, against serializing and sending them one at a time.
+ */
+void test_MqttRetransmitStore_ResendThousandPublishes( void )
+{
+    MQTTPublishInfo_t publishInfo;
+    MQTTFixedBuffer_t fixedBuffer;
+    pthread_t drainer;
+    struct timespec start;
+    int sockets[ 2 ] = { -1, -1 };
+    size_t remainingLength = 0U, packetSize = 0U;
+    uint32_t iteration = 0U, calls[ 3 ] = { 0U };
+    uint16_t packetId = 0U;
+    long elapsed[ 3 ] = { 0L };
+
+    TEST_ASSERT_EQUAL( 0, socketpair( AF_UNIX, SOCK_STREAM, 0, sockets ) );
+    TEST_ASSERT_EQUAL( 0, pthread_create( &drainer, NULL, drainSocket, &sockets[ 1 ] ) );
+    networkContext.socket = sockets[ 0 ];
+
+    for( packetId = 1U; packetId <= BENCHMARK_PUBLISH_COUNT; packetId++ )
+    {
+        buildPublish( &publishInfo, packetId, BENCHMARK_PAYLOAD_LENGTH );
+        TEST_ASSERT_TRUE( MqttRetransmitStore_Add( &store, packetId, &publishInfo ) );
+    }
+
+    initContext( true );
+    networkContext.callCount = 0U;
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+
+    for( iteration = 0U; iteration < BENCHMARK_ITERATIONS; iteration++ )
+    {
+        TEST_ASSERT_EQUAL( MQTTSuccess, MqttRetransmitStore_ResendAll( &store, &mqttContext ) );
+    }
+
+    elapsed[ 0 ] = microsecondsSince( &start );
+    calls[ 0 ] = networkContext.callCount;
+
+    initContext( false );
+    networkContext.callCount = 0U;
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+
+    for( iteration = 0U; iteration < BENCHMARK_ITERATIONS; iteration++ )
+    {
+        TEST_ASSERT_EQUAL( MQTTSuccess, MqttRetransmitStore_ResendAll( &store, &mqttContext ) );
+    }
+
+    elapsed[ 1 ] = microsecondsSince( &start );
+    calls[ 1 ] = networkContext.callCount;
+
+    /* One serialized packet and one send per publish. */
+    networkContext.callCount = 0U;
+    fixedBuffer.pBuffer = networkBuffer;
+    fixedBuffer.size = sizeof( networkBuffer );
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+
+    for( iteration = 0U; iteration < BENCHMARK_ITERATIONS; iteration++ )
+    {
+        for( packetId = 1U; packetId <= BENCHMARK_PUBLISH_COUNT; packetId++ )
+        {
+            buildPublish( &publishInfo, packetId, BENCHMARK_PAYLOAD_LENGTH );
+            publishInfo.dup = true;
+            TEST_ASSERT_EQUAL( MQTTSuccess,
+                               MQTT_GetPublishPacketSize( &publishInfo, &remainingLength, &packetSize ) );
+            TEST_ASSERT_EQUAL( MQTTSuccess,
+                               MQTT_SerializePublish( &publishInfo, packetId, remainingLength, &fixedBuffer ) );
+            TEST_ASSERT_EQUAL( ( int32_t ) packetSize, loopbackSend( &networkContext, networkBuffer, packetSize ) );
+        }
+    }
+
+    elapsed[ 2 ] = microsecondsSince( &start );
+    calls[ 2 ] = networkContext.callCount;
+
+    ( void ) close( sockets[ 0 ] );
+    TEST_ASSERT_EQUAL( 0, pthread_join( drainer, NULL ) );
+    ( void ) close( sockets[ 1 ] );
+
+    LogInfo( ( "Resending %u publishes of %u bytes: writev %ld us (%u calls), "
+               "coalesced send %ld us (%u calls), one send per publish %ld us (%u calls).",
+               ( unsigned int ) BENCHMARK_PUBLISH_COUNT,
+               ( unsigned int ) BENCHMARK_PAYLOAD_LENGTH,
+               elapsed[ 0 ] / ( long ) BENCHMARK_ITERATIONS,
+               ( unsigned int ) ( calls[ 0 ] / BENCHMARK_ITERATIONS ),
+               elapsed[ 1 ] / ( long ) BENCHMARK_ITERATIONS,
+               ( unsigned int ) ( calls[ 1 ] / BENCHMARK_ITERATIONS ),
+               elapsed[ 2 ] / ( long ) BENCHMARK_ITERATIONS,
+               ( unsigned int ) ( calls[ 2 ] / BENCHMARK_ITERATIONS ) ) );
+}
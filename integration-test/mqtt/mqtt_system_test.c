@@ -273,7 +273,7 @@ static NetworkContext_t networkContext;
 /**
  * @brief Parameters for the Openssl Context.
  */
-static OpensslParams_t opensslParams;
+static OpensslParams_t opensslParams = { 0 };
 
 /**
  * @brief Represents the hostname and port of the broker.
@@ -0,0 +1,1026 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file mqtt_command_agent_test.c
+ * @brief Multi-producer test of the MQTT command agent, publishing from many
+ * threads at once through the agent to a local MQTT broker stand-in, and
+ * measurement of the latency of job status updates during a block download.
+ */
+
+/* Standard header includes. */
+#include <string.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+
+/* POSIX includes. */
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+/* Include config file before other non-system includes. */
+#include "test_config.h"
+
+/* Unity testing framework includes. */
+#include "unity.h"
+
+/* Include plaintext implementation of transport interface. */
+#include "plaintext_posix.h"
+
+/* Include clock for the MQTT context and the agent. */
+#include "clock.h"
+
+/* Include the MQTT command agent. */
+#include "mqtt_command_agent.h"
+
+/**
+ * @brief Address the broker stand-in listens on.
+ */
+#define BROKER_ADDRESS                  "127.0.0.1"
+
+/**
+ * @brief Length of #BROKER_ADDRESS.
+ */
+#define BROKER_ADDRESS_LENGTH           ( sizeof( BROKER_ADDRESS ) - 1U )
+
+/**
+ * @brief Number of threads publishing through the agent. More than
+ * #MQTT_COMMAND_MAX_PENDING_ACKS, so that commands wait in the queue for a
+ * free in-flight entry, and fewer than #MQTT_COMMAND_QUEUE_LENGTH, so that
+ * every command fits in the queue.
+ */
+#define PRODUCER_COUNT                  ( 12U )
+
+/**
+ * @brief Number of messages each producer publishes, alternating QoS 0 and
+ * QoS 1.
+ */
+#define MESSAGES_PER_PRODUCER           ( 500U )
+
+/**
+ * @brief Topic of the published messages.
+ */
+#define TEST_TOPIC                      "test/agent"
+
+/**
+ * @brief Length of #TEST_TOPIC.
+ */
+#define TEST_TOPIC_LENGTH               ( ( uint16_t ) ( sizeof( TEST_TOPIC ) - 1U ) )
+
+/**
+ * @brief Length of the payload of the published messages: the index of the
+ * producer, then the sequence number of the message in big-endian order.
+ */
+#define TEST_PAYLOAD_LENGTH             ( 5U )
+
+/**
+ * @brief Client identifier of the MQTT connection.
+ */
+#define TEST_CLIENT_IDENTIFIER          "mqtt_command_agent_test"
+
+/**
+ * @brief Topic of the block requests of the download, and of the data blocks
+ * the broker stand-in sends in answer.
+ */
+#define BLOCK_REQUEST_TOPIC             "test/agent/stream/get"
+#define DATA_BLOCK_TOPIC                "test/agent/stream/data"
+
+/**
+ * @brief Lengths of #BLOCK_REQUEST_TOPIC and #DATA_BLOCK_TOPIC.
+ */
+#define BLOCK_REQUEST_TOPIC_LENGTH      ( ( uint16_t ) ( sizeof( BLOCK_REQUEST_TOPIC ) - 1U ) )
+#define DATA_BLOCK_TOPIC_LENGTH         ( ( uint16_t ) ( sizeof( DATA_BLOCK_TOPIC ) - 1U ) )
+
+/**
+ * @brief Size of a data block, and number of blocks sent for each block
+ * request, as configured in the OTA over MQTT demo.
+ */
+#define DATA_BLOCK_SIZE                 ( 4096U )
+#define BLOCKS_PER_REQUEST              ( 8U )
+
+/**
+ * @brief Length of a data block PUBLISH: the fixed header with a two-byte
+ * remaining length, the topic name, then the block.
+ */
+#define DATA_BLOCK_PACKET_LENGTH        ( 3U + 2U + DATA_BLOCK_TOPIC_LENGTH + DATA_BLOCK_SIZE )
+
+/**
+ * @brief Time the download waits for a data block before giving up.
+ */
+#define DATA_BLOCK_TIMEOUT_MS           ( 1000U )
+
+/**
+ * @brief Number of job status updates timed with and without the download.
+ */
+#define JOB_STATUS_UPDATE_COUNT         ( 200U )
+
+/**
+ * @brief Size of the network buffer of the MQTT context, and of the packet
+ * buffer of the broker stand-in. Large enough for a data block.
+ */
+#define NETWORK_BUFFER_SIZE             ( DATA_BLOCK_PACKET_LENGTH + 64U )
+
+/**
+ * @brief Timeout of the transport send and receive calls.
+ */
+#define TRANSPORT_SEND_RECV_TIMEOUT_MS  ( 1000U )
+
+/**
+ * @brief Time to wait for the CONNACK.
+ */
+#define CONNACK_RECV_TIMEOUT_MS         ( 1000U )
+
+/**
+ * @brief Longest time the agent thread waits for a command or a packet.
+ */
+#define AGENT_LOOP_WAIT_MS              ( 10U )
+
+/**
+ * @brief Time the producers are given to publish all their messages. A
+ * command lost by the queue never completes, so its producer never finishes.
+ */
+#define PRODUCERS_TIMEOUT_MS            ( 10000U )
+
+/**
+ * @brief Interval at which the test checks whether the producers finished.
+ */
+#define PRODUCERS_POLL_INTERVAL_MS      ( 10U )
+
+/**
+ * @brief Interval at which the broker stand-in checks for the end of a test.
+ */
+#define BROKER_POLL_INTERVAL_MS         ( 50 )
+
+/**
+ * @brief Bytes of the packets exchanged with the broker stand-in.
+ */
+#define CONNACK_PACKET                  { MQTT_PACKET_TYPE_CONNACK, 0x02U, 0x00U, 0x00U }
+#define PINGRESP_PACKET                 { MQTT_PACKET_TYPE_PINGRESP, 0x00U }
+
+/*-----------------------------------------------------------*/
+
+/* Each compilation unit must define the NetworkContext struct. */
+struct NetworkContext
+{
+    PlaintextParams_t * pParams;
+};
+
+/**
+ * @brief State of a thread publishing through the agent.
+ */
+typedef struct Producer
+{
+    pthread_t thread;      /**< @brief The thread. */
+    uint8_t index;         /**< @brief Index of the producer, sent in every payload. */
+    uint32_t failedCount;  /**< @brief Number of publishes that did not succeed. */
+} Producer_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The agent under test and its MQTT connection.
+ */
+static MqttCommandAgent_t agent;
+static MQTTContext_t mqttContext;
+static PlaintextParams_t plaintextParams;
+static NetworkContext_t networkContext;
+static uint8_t networkBuffer[ NETWORK_BUFFER_SIZE ];
+static MQTTPubAckInfo_t outgoingPublishRecords[ MQTT_COMMAND_MAX_PENDING_ACKS ];
+static MQTTPubAckInfo_t incomingPublishRecords[ 1 ];
+
+/**
+ * @brief State of the agent thread.
+ */
+static pthread_t agentThread;
+static bool isAgentRunning = false;
+static uint32_t isAgentStopping = 0U;
+static uint32_t unmatchedAckCount = 0U;
+
+/**
+ * @brief The threads publishing through the agent.
+ */
+static Producer_t producers[ PRODUCER_COUNT ];
+static uint32_t finishedProducerCount = 0U;
+
+/**
+ * @brief State of the thread downloading data blocks through the agent.
+ * #blockSemaphore is posted by the agent thread for each data block received.
+ */
+static pthread_t downloadThread;
+static bool isDownloadRunning = false;
+static uint32_t isDownloadStopping = 0U;
+static uint32_t downloadedBlockCount = 0U;
+static uint32_t downloadFailedCount = 0U;
+static sem_t blockSemaphore;
+
+/**
+ * @brief State of the broker stand-in. The counters are written by the
+ * broker thread only, and read by the test once it has stopped.
+ */
+static int brokerSocket = -1;
+static uint16_t brokerPort = 0U;
+static pthread_t brokerThread;
+static bool isBrokerRunning = false;
+static uint32_t isBrokerStopping = 0U;
+static uint32_t receivedCounts[ PRODUCER_COUNT ];
+static uint32_t orderErrorCount = 0U;
+static uint32_t malformedCount = 0U;
+static uint16_t lastPacketId = 0U;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Receive exactly a number of bytes at the broker stand-in.
+ *
+ * @param[in] connectionSocket The connection to receive from.
+ * @param[out] pBuffer The buffer to fill.
+ * @param[in] length The number of bytes to receive.
+ *
+ * @return true if the bytes were received; false if the connection was
+ * closed or the test is ending.
+ */
+static bool receiveExactly( int connectionSocket,
+                            uint8_t * pBuffer,
+                            size_t length );
+
+/**
+ * @brief Check the order of a PUBLISH received by the broker stand-in, and
+ * acknowledge it if it has QoS 1.
+ *
+ * @param[in] connectionSocket The connection of the agent.
+ * @param[in] flags The lower bits of the fixed header of the PUBLISH.
+ * @param[in] pBody The variable header and payload of the PUBLISH.
+ * @param[in] bodyLength The length of @p pBody.
+ *
+ * @return true if the PUBLISH was well formed and, if needed, acknowledged.
+ */
+static bool handlePublish( int connectionSocket,
+                           uint8_t flags,
+                           const uint8_t * pBody,
+                           size_t bodyLength );
+
+/**
+ * @brief Send #BLOCKS_PER_REQUEST data blocks from the broker stand-in, in
+ * answer to a block request.
+ *
+ * @param[in] connectionSocket The connection of the agent.
+ *
+ * @return true if the blocks were sent.
+ */
+static bool sendDataBlocks( int connectionSocket );
+
+/**
+ * @brief Accept the connection of the agent and answer its packets until it
+ * disconnects.
+ *
+ * @param[in] pArgs Unused.
+ *
+ * @return NULL.
+ */
+static void * brokerThreadRoutine( void * pArgs );
+
+/**
+ * @brief Complete the command of the agent acknowledged by an incoming
+ * packet, as the OTA demo does, and count the data blocks received.
+ */
+static void eventCallback( MQTTContext_t * pMqttContext,
+                           MQTTPacketInfo_t * pPacketInfo,
+                           MQTTDeserializedInfo_t * pDeserializedInfo );
+
+/**
+ * @brief Run the agent until #isAgentStopping is set, as the OTA demo does.
+ *
+ * @param[in] pArgs Unused.
+ *
+ * @return NULL.
+ */
+static void * agentThreadRoutine( void * pArgs );
+
+/**
+ * @brief Publish #MESSAGES_PER_PRODUCER messages through the agent, each
+ * after the previous one completed.
+ *
+ * @param[in] pArgs The #Producer_t of the thread.
+ *
+ * @return NULL.
+ */
+static void * producerThreadRoutine( void * pArgs );
+
+/**
+ * @brief Request data blocks through the agent until #isDownloadStopping is
+ * set, waiting for the blocks of a request before sending the next, as the
+ * OTA agent does.
+ *
+ * @param[in] pArgs Unused.
+ *
+ * @return NULL.
+ */
+static void * downloadThreadRoutine( void * pArgs );
+
+/**
+ * @brief Publish job status updates through the agent with QoS 1, each after
+ * the previous one was acknowledged, and time them.
+ *
+ * @param[in] firstSequence The sequence number of the first update.
+ * @param[out] pAverageUs The average time from submitting an update to its
+ * acknowledgement.
+ * @param[out] pMaxUs The longest of these times.
+ */
+static void timeJobStatusUpdates( uint32_t firstSequence,
+                                  long * pAverageUs,
+                                  long * pMaxUs );
+
+/**
+ * @brief Stop the download thread, then the agent thread, disconnect, then
+ * stop the broker stand-in. Threads already stopped are skipped.
+ */
+static void stopThreads( void );
+
+/*-----------------------------------------------------------*/
+
+static bool receiveExactly( int connectionSocket,
+                            uint8_t * pBuffer,
+                            size_t length )
+{
+    struct pollfd pollFd = { 0 };
+    size_t receivedLength = 0U;
+    ssize_t bytesReceived = 0;
+    bool isOpen = true;
+
+    pollFd.fd = connectionSocket;
+    pollFd.events = POLLIN;
+
+    while( ( isOpen == true ) && ( receivedLength < length ) )
+    {
+        if( __atomic_load_n( &isBrokerStopping, __ATOMIC_ACQUIRE ) != 0U )
+        {
+            isOpen = false;
+        }
+        else if( poll( &pollFd, 1U, BROKER_POLL_INTERVAL_MS ) > 0 )
+        {
+            bytesReceived = recv( connectionSocket,
+                                  &pBuffer[ receivedLength ],
+                                  length - receivedLength,
+                                  0 );
+            isOpen = ( bytesReceived > 0 );
+
+            if( isOpen == true )
+            {
+                receivedLength += ( size_t ) bytesReceived;
+            }
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+    }
+
+    return isOpen;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool handlePublish( int connectionSocket,
+                           uint8_t flags,
+                           const uint8_t * pBody,
+                           size_t bodyLength )
+{
+    uint8_t puback[ 4 ] = { MQTT_PACKET_TYPE_PUBACK, 0x02U, 0x00U, 0x00U };
+    const uint8_t * pPayload = NULL;
+    size_t headerLength = 0U;
+    uint32_t sequence = 0U;
+    uint8_t qos = ( uint8_t ) ( ( flags >> 1 ) & 0x03U );
+    uint8_t producerIndex = 0U;
+    bool isValid = true;
+
+    /* Topic name, packet identifier for QoS 1, then the payload. */
+    headerLength = 2U + TEST_TOPIC_LENGTH + ( ( qos > 0U ) ? 2U : 0U );
+
+    if( ( qos > 1U ) ||
+        ( bodyLength != ( headerLength + TEST_PAYLOAD_LENGTH ) ) ||
+        ( ( ( ( size_t ) pBody[ 0 ] << 8 ) | pBody[ 1 ] ) != TEST_TOPIC_LENGTH ) ||
+        ( memcmp( &pBody[ 2 ], TEST_TOPIC, TEST_TOPIC_LENGTH ) != 0 ) ||
+        ( pBody[ headerLength ] >= PRODUCER_COUNT ) )
+    {
+        isValid = false;
+    }
+
+    if( isValid == true )
+    {
+        pPayload = &pBody[ headerLength ];
+        producerIndex = pPayload[ 0 ];
+        sequence = ( ( uint32_t ) pPayload[ 1 ] << 24 ) | ( ( uint32_t ) pPayload[ 2 ] << 16 ) |
+                   ( ( uint32_t ) pPayload[ 3 ] << 8 ) | ( uint32_t ) pPayload[ 4 ];
+
+        /* Every message of a producer arrives once, in the order published. */
+        if( sequence != receivedCounts[ producerIndex ] )
+        {
+            orderErrorCount++;
+        }
+
+        receivedCounts[ producerIndex ]++;
+
+        /* A QoS 0 message carries no packet identifier. */
+        if( qos == 1U )
+        {
+            puback[ 2 ] = pBody[ 2U + TEST_TOPIC_LENGTH ];
+            puback[ 3 ] = pBody[ 3U + TEST_TOPIC_LENGTH ];
+            lastPacketId = ( uint16_t ) ( ( ( uint16_t ) puback[ 2 ] << 8 ) | puback[ 3 ] );
+            isValid = ( send( connectionSocket, puback, sizeof( puback ), MSG_NOSIGNAL ) == ( ssize_t ) sizeof( puback ) );
+        }
+    }
+
+    return isValid;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool sendDataBlocks( int connectionSocket )
+{
+    static uint8_t blockPacket[ DATA_BLOCK_PACKET_LENGTH ];
+    size_t remainingLength = DATA_BLOCK_PACKET_LENGTH - 3U;
+    uint32_t blockIndex = 0U;
+    bool isSent = true;
+
+    /* A QoS 0 PUBLISH, so that the blocks need no acknowledgement. */
+    blockPacket[ 0 ] = MQTT_PACKET_TYPE_PUBLISH;
+    blockPacket[ 1 ] = ( uint8_t ) ( ( remainingLength & 0x7FU ) | 0x80U );
+    blockPacket[ 2 ] = ( uint8_t ) ( remainingLength >> 7 );
+    blockPacket[ 3 ] = ( uint8_t ) ( DATA_BLOCK_TOPIC_LENGTH >> 8 );
+    blockPacket[ 4 ] = ( uint8_t ) DATA_BLOCK_TOPIC_LENGTH;
+    ( void ) memcpy( &blockPacket[ 5 ], DATA_BLOCK_TOPIC, DATA_BLOCK_TOPIC_LENGTH );
+
+    for( blockIndex = 0U; ( isSent == true ) && ( blockIndex < BLOCKS_PER_REQUEST ); blockIndex++ )
+    {
+        isSent = ( send( connectionSocket, blockPacket, sizeof( blockPacket ), MSG_NOSIGNAL ) == ( ssize_t ) sizeof( blockPacket ) );
+    }
+
+    return isSent;
+}
+
+/*-----------------------------------------------------------*/
+
+static void * brokerThreadRoutine( void * pArgs )
+{
+    static const uint8_t connack[] = CONNACK_PACKET;
+    static const uint8_t pingresp[] = PINGRESP_PACKET;
+    uint8_t packet[ NETWORK_BUFFER_SIZE ];
+    struct pollfd pollFd = { 0 };
+    size_t remainingLength = 0U;
+    int connectionSocket = -1;
+    bool isOpen = false;
+
+    ( void ) pArgs;
+
+    pollFd.fd = brokerSocket;
+    pollFd.events = POLLIN;
+
+    while( ( connectionSocket < 0 ) &&
+           ( __atomic_load_n( &isBrokerStopping, __ATOMIC_ACQUIRE ) == 0U ) )
+    {
+        if( poll( &pollFd, 1U, BROKER_POLL_INTERVAL_MS ) > 0 )
+        {
+            connectionSocket = accept( brokerSocket, NULL, NULL );
+        }
+    }
+
+    isOpen = ( connectionSocket >= 0 );
+
+    /* The agent only sends packets with a single-byte remaining length.
+     * Assertions are left to the test thread; a packet that is not expected
+     * ends the connection, and fails the publishes waiting for it. */
+    while( ( isOpen == true ) && ( receiveExactly( connectionSocket, packet, 2U ) == true ) )
+    {
+        remainingLength = packet[ 1 ];
+
+        if( ( ( remainingLength & 0x80U ) != 0U ) ||
+            ( receiveExactly( connectionSocket, &packet[ 2 ], remainingLength ) == false ) )
+        {
+            malformedCount++;
+            break;
+        }
+
+        switch( packet[ 0 ] & 0xF0U )
+        {
+            case MQTT_PACKET_TYPE_CONNECT:
+                isOpen = ( send( connectionSocket, connack, sizeof( connack ), MSG_NOSIGNAL ) == ( ssize_t ) sizeof( connack ) );
+                break;
+
+            case MQTT_PACKET_TYPE_PUBLISH:
+
+                if( ( remainingLength == ( 2U + BLOCK_REQUEST_TOPIC_LENGTH ) ) &&
+                    ( memcmp( &packet[ 4 ], BLOCK_REQUEST_TOPIC, BLOCK_REQUEST_TOPIC_LENGTH ) == 0 ) )
+                {
+                    isOpen = sendDataBlocks( connectionSocket );
+                }
+                else
+                {
+                    isOpen = handlePublish( connectionSocket, packet[ 0 ] & 0x0FU, &packet[ 2 ], remainingLength );
+
+                    if( isOpen == false )
+                    {
+                        malformedCount++;
+                    }
+                }
+
+                break;
+
+            case MQTT_PACKET_TYPE_PINGREQ:
+                isOpen = ( send( connectionSocket, pingresp, sizeof( pingresp ), MSG_NOSIGNAL ) == ( ssize_t ) sizeof( pingresp ) );
+                break;
+
+            case MQTT_PACKET_TYPE_DISCONNECT:
+                isOpen = false;
+                break;
+
+            default:
+                malformedCount++;
+                isOpen = false;
+                break;
+        }
+    }
+
+    if( connectionSocket >= 0 )
+    {
+        ( void ) close( connectionSocket );
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static void eventCallback( MQTTContext_t * pMqttContext,
+                           MQTTPacketInfo_t * pPacketInfo,
+                           MQTTDeserializedInfo_t * pDeserializedInfo )
+{
+    ( void ) pMqttContext;
+
+    switch( pPacketInfo->type )
+    {
+        case MQTT_PACKET_TYPE_PUBACK:
+        case MQTT_PACKET_TYPE_SUBACK:
+        case MQTT_PACKET_TYPE_UNSUBACK:
+
+            if( MqttCommandAgent_ProcessAck( &agent,
+                                             pPacketInfo->type,
+                                             pDeserializedInfo->packetIdentifier,
+                                             pDeserializedInfo->deserializationResult ) == false )
+            {
+                unmatchedAckCount++;
+            }
+
+            break;
+
+        case MQTT_PACKET_TYPE_PUBLISH:
+            ( void ) sem_post( &blockSemaphore );
+            break;
+
+        default:
+            unmatchedAckCount++;
+            break;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void * agentThreadRoutine( void * pArgs )
+{
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+
+    ( void ) pArgs;
+
+    while( __atomic_load_n( &isAgentStopping, __ATOMIC_ACQUIRE ) == 0U )
+    {
+        MqttCommandAgent_ProcessCommands( &agent );
+        mqttStatus = MQTT_ProcessLoop( &mqttContext );
+
+        if( ( mqttStatus == MQTTSuccess ) || ( mqttStatus == MQTTNeedMoreBytes ) )
+        {
+            MqttCommandAgent_Wait( &agent,
+                                   plaintextParams.socketDescriptor,
+                                   AGENT_LOOP_WAIT_MS );
+        }
+        else
+        {
+            /* The waiting producers count the failure. */
+            MqttCommandAgent_CancelCommands( &agent, mqttStatus );
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static void * producerThreadRoutine( void * pArgs )
+{
+    Producer_t * pProducer = ( Producer_t * ) pArgs;
+    MQTTPublishInfo_t publishInfo = { 0 };
+    uint8_t payload[ TEST_PAYLOAD_LENGTH ];
+    uint32_t sequence = 0U;
+
+    publishInfo.pTopicName = TEST_TOPIC;
+    publishInfo.topicNameLength = TEST_TOPIC_LENGTH;
+    publishInfo.pPayload = payload;
+    publishInfo.payloadLength = sizeof( payload );
+    payload[ 0 ] = pProducer->index;
+
+    for( sequence = 0U; sequence < MESSAGES_PER_PRODUCER; sequence++ )
+    {
+        payload[ 1 ] = ( uint8_t ) ( sequence >> 24 );
+        payload[ 2 ] = ( uint8_t ) ( sequence >> 16 );
+        payload[ 3 ] = ( uint8_t ) ( sequence >> 8 );
+        payload[ 4 ] = ( uint8_t ) sequence;
+        publishInfo.qos = ( ( sequence % 2U ) == 0U ) ? MQTTQoS0 : MQTTQoS1;
+
+        /* Assertions are left to the test thread. */
+        if( MqttCommandAgent_Publish( &agent, &publishInfo ) != MQTTSuccess )
+        {
+            pProducer->failedCount++;
+        }
+    }
+
+    ( void ) __atomic_add_fetch( &finishedProducerCount, 1U, __ATOMIC_RELEASE );
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static void * downloadThreadRoutine( void * pArgs )
+{
+    MQTTPublishInfo_t publishInfo = { 0 };
+    struct timespec deadline;
+    uint32_t blockIndex = 0U;
+    bool isDownloading = true;
+
+    ( void ) pArgs;
+
+    publishInfo.qos = MQTTQoS0;
+    publishInfo.pTopicName = BLOCK_REQUEST_TOPIC;
+    publishInfo.topicNameLength = BLOCK_REQUEST_TOPIC_LENGTH;
+
+    while( ( isDownloading == true ) &&
+           ( __atomic_load_n( &isDownloadStopping, __ATOMIC_ACQUIRE ) == 0U ) )
+    {
+        /* Assertions are left to the test thread. */
+        isDownloading = ( MqttCommandAgent_Publish( &agent, &publishInfo ) == MQTTSuccess );
+
+        for( blockIndex = 0U; ( isDownloading == true ) && ( blockIndex < BLOCKS_PER_REQUEST ); blockIndex++ )
+        {
+            ( void ) clock_gettime( CLOCK_REALTIME, &deadline );
+            deadline.tv_sec += DATA_BLOCK_TIMEOUT_MS / 1000U;
+            isDownloading = ( sem_timedwait( &blockSemaphore, &deadline ) == 0 );
+
+            if( isDownloading == true )
+            {
+                downloadedBlockCount++;
+            }
+        }
+    }
+
+    if( isDownloading == false )
+    {
+        downloadFailedCount++;
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static void timeJobStatusUpdates( uint32_t firstSequence,
+                                  long * pAverageUs,
+                                  long * pMaxUs )
+{
+    MQTTPublishInfo_t publishInfo = { 0 };
+    uint8_t payload[ TEST_PAYLOAD_LENGTH ] = { 0 };
+    struct timespec start, end;
+    uint32_t sequence = 0U;
+    long elapsedUs = 0L, totalUs = 0L;
+
+    publishInfo.qos = MQTTQoS1;
+    publishInfo.pTopicName = TEST_TOPIC;
+    publishInfo.topicNameLength = TEST_TOPIC_LENGTH;
+    publishInfo.pPayload = payload;
+    publishInfo.payloadLength = sizeof( payload );
+    *pMaxUs = 0L;
+
+    for( sequence = firstSequence; sequence < ( firstSequence + JOB_STATUS_UPDATE_COUNT ); sequence++ )
+    {
+        payload[ 1 ] = ( uint8_t ) ( sequence >> 24 );
+        payload[ 2 ] = ( uint8_t ) ( sequence >> 16 );
+        payload[ 3 ] = ( uint8_t ) ( sequence >> 8 );
+        payload[ 4 ] = ( uint8_t ) sequence;
+
+        ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+        TEST_ASSERT_EQUAL( MQTTSuccess, MqttCommandAgent_Publish( &agent, &publishInfo ) );
+        ( void ) clock_gettime( CLOCK_MONOTONIC, &end );
+
+        elapsedUs = ( ( end.tv_sec - start.tv_sec ) * 1000000L ) +
+                    ( ( end.tv_nsec - start.tv_nsec ) / 1000L );
+        totalUs += elapsedUs;
+
+        if( elapsedUs > *pMaxUs )
+        {
+            *pMaxUs = elapsedUs;
+        }
+    }
+
+    *pAverageUs = totalUs / ( long ) JOB_STATUS_UPDATE_COUNT;
+}
+
+/*-----------------------------------------------------------*/
+
+static void stopThreads( void )
+{
+    if( isDownloadRunning == true )
+    {
+        __atomic_store_n( &isDownloadStopping, 1U, __ATOMIC_RELEASE );
+        ( void ) pthread_join( downloadThread, NULL );
+        isDownloadRunning = false;
+    }
+
+    if( isAgentRunning == true )
+    {
+        __atomic_store_n( &isAgentStopping, 1U, __ATOMIC_RELEASE );
+        ( void ) pthread_join( agentThread, NULL );
+        ( void ) MQTT_Disconnect( &mqttContext );
+        isAgentRunning = false;
+
+        /* Release the producers still waiting, as the OTA demo does when the
+         * connection closes. */
+        MqttCommandAgent_CancelCommands( &agent, MQTTSendFailed );
+    }
+
+    if( isBrokerRunning == true )
+    {
+        __atomic_store_n( &isBrokerStopping, 1U, __ATOMIC_RELEASE );
+        ( void ) pthread_join( brokerThread, NULL );
+        isBrokerRunning = false;
+    }
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    struct sockaddr_in address = { 0 };
+    socklen_t addressLength = sizeof( address );
+    ServerInfo_t serverInfo = { BROKER_ADDRESS, BROKER_ADDRESS_LENGTH, 0U };
+    TransportInterface_t transport = { 0 };
+    MQTTFixedBuffer_t fixedBuffer = { 0 };
+    MQTTConnectInfo_t connectInfo = { 0 };
+    bool sessionPresent = false;
+    int noDelay = 1;
+
+    ( void ) memset( producers, 0, sizeof( producers ) );
+    ( void ) memset( receivedCounts, 0, sizeof( receivedCounts ) );
+    ( void ) memset( &plaintextParams, 0, sizeof( plaintextParams ) );
+    orderErrorCount = 0U;
+    malformedCount = 0U;
+    lastPacketId = 0U;
+    unmatchedAckCount = 0U;
+    finishedProducerCount = 0U;
+    downloadedBlockCount = 0U;
+    downloadFailedCount = 0U;
+    __atomic_store_n( &isDownloadStopping, 0U, __ATOMIC_RELEASE );
+    TEST_ASSERT_EQUAL( 0, sem_init( &blockSemaphore, 0, 0U ) );
+
+    brokerSocket = socket( AF_INET, SOCK_STREAM, 0 );
+    TEST_ASSERT_NOT_EQUAL( -1, brokerSocket );
+    address.sin_family = AF_INET;
+    TEST_ASSERT_EQUAL( 1, inet_pton( AF_INET, BROKER_ADDRESS, &address.sin_addr ) );
+    TEST_ASSERT_EQUAL( 0, bind( brokerSocket, ( struct sockaddr * ) &address, sizeof( address ) ) );
+    TEST_ASSERT_EQUAL( 0, listen( brokerSocket, 1 ) );
+    TEST_ASSERT_EQUAL( 0, getsockname( brokerSocket, ( struct sockaddr * ) &address, &addressLength ) );
+    brokerPort = ntohs( address.sin_port );
+
+    __atomic_store_n( &isBrokerStopping, 0U, __ATOMIC_RELEASE );
+    TEST_ASSERT_EQUAL( 0, pthread_create( &brokerThread, NULL, brokerThreadRoutine, NULL ) );
+    isBrokerRunning = true;
+
+    networkContext.pParams = &plaintextParams;
+    serverInfo.port = brokerPort;
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, Plaintext_Connect( &networkContext,
+                                                           &serverInfo,
+                                                           TRANSPORT_SEND_RECV_TIMEOUT_MS,
+                                                           TRANSPORT_SEND_RECV_TIMEOUT_MS ) );
+
+    /* The agent sends packets back to back; without this, each waits for the
+     * delayed acknowledgement of the one before it. */
+    TEST_ASSERT_EQUAL( 0, setsockopt( plaintextParams.socketDescriptor,
+                                      IPPROTO_TCP,
+                                      TCP_NODELAY,
+                                      &noDelay,
+                                      sizeof( noDelay ) ) );
+
+    /* Set up the MQTT context as the OTA demo does. */
+    transport.pNetworkContext = &networkContext;
+    transport.send = Plaintext_Send;
+    transport.recv = Plaintext_Recv;
+    transport.writev = Plaintext_Writev;
+    fixedBuffer.pBuffer = networkBuffer;
+    fixedBuffer.size = NETWORK_BUFFER_SIZE;
+    TEST_ASSERT_EQUAL( MQTTSuccess, MQTT_Init( &mqttContext,
+                                               &transport,
+                                               Clock_GetTimeMs,
+                                               eventCallback,
+                                               &fixedBuffer ) );
+    TEST_ASSERT_EQUAL( MQTTSuccess, MQTT_InitStatefulQoS( &mqttContext,
+                                                          outgoingPublishRecords,
+                                                          MQTT_COMMAND_MAX_PENDING_ACKS,
+                                                          incomingPublishRecords,
+                                                          1U ) );
+
+    connectInfo.cleanSession = true;
+    connectInfo.pClientIdentifier = TEST_CLIENT_IDENTIFIER;
+    connectInfo.clientIdentifierLength = ( uint16_t ) ( sizeof( TEST_CLIENT_IDENTIFIER ) - 1U );
+    TEST_ASSERT_EQUAL( MQTTSuccess, MQTT_Connect( &mqttContext,
+                                                  &connectInfo,
+                                                  NULL,
+                                                  CONNACK_RECV_TIMEOUT_MS,
+                                                  &sessionPresent ) );
+
+    TEST_ASSERT_TRUE( MqttCommandAgent_Init( &agent, &mqttContext ) );
+    __atomic_store_n( &isAgentStopping, 0U, __ATOMIC_RELEASE );
+    TEST_ASSERT_EQUAL( 0, pthread_create( &agentThread, NULL, agentThreadRoutine, NULL ) );
+    isAgentRunning = true;
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+    stopThreads();
+    MqttCommandAgent_Deinit( &agent );
+    ( void ) Plaintext_Disconnect( &networkContext );
+    ( void ) close( brokerSocket );
+    ( void ) sem_destroy( &blockSemaphore );
+}
+
+/* ========================== Test Cases ============================ */
+
+/**
+ * @brief Publishes from #PRODUCER_COUNT threads at once through the agent,
+ * and verifies at the broker stand-in that every message arrives exactly
+ * once, and that the messages of each producer arrive in the order they were
+ * published.
+ */
+void test_MqttCommandAgent_MultipleProducers( void )
+{
+    uint32_t index = 0U;
+    uint32_t startTimeMs = 0U;
+
+    for( index = 0U; index < PRODUCER_COUNT; index++ )
+    {
+        producers[ index ].index = ( uint8_t ) index;
+        TEST_ASSERT_EQUAL( 0, pthread_create( &producers[ index ].thread,
+                                              NULL,
+                                              producerThreadRoutine,
+                                              &producers[ index ] ) );
+    }
+
+    startTimeMs = Clock_GetTimeMs();
+
+    while( ( __atomic_load_n( &finishedProducerCount, __ATOMIC_ACQUIRE ) < PRODUCER_COUNT ) &&
+           ( ( Clock_GetTimeMs() - startTimeMs ) < PRODUCERS_TIMEOUT_MS ) )
+    {
+        Clock_SleepMs( PRODUCERS_POLL_INTERVAL_MS );
+    }
+
+    TEST_ASSERT_EQUAL_MESSAGE( PRODUCER_COUNT,
+                               __atomic_load_n( &finishedProducerCount, __ATOMIC_ACQUIRE ),
+                               "A publish never completed." );
+
+    for( index = 0U; index < PRODUCER_COUNT; index++ )
+    {
+        TEST_ASSERT_EQUAL( 0, pthread_join( producers[ index ].thread, NULL ) );
+    }
+
+    /* Every publish completed, so the broker stand-in has received every
+     * message; stop it to read its counters. */
+    stopThreads();
+
+    for( index = 0U; index < PRODUCER_COUNT; index++ )
+    {
+        TEST_ASSERT_EQUAL_UINT32( 0U, producers[ index ].failedCount );
+        TEST_ASSERT_EQUAL_UINT32( MESSAGES_PER_PRODUCER, receivedCounts[ index ] );
+    }
+
+    TEST_ASSERT_EQUAL_UINT32( 0U, orderErrorCount );
+    TEST_ASSERT_EQUAL_UINT32( 0U, malformedCount );
+    TEST_ASSERT_EQUAL_UINT32( 0U, unmatchedAckCount );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Verifies that QoS 0 publishes do not take packet identifiers: the
+ * first QoS 1 publish after a run of QoS 0 publishes carries the first
+ * identifier of the connection.
+ */
+void test_MqttCommandAgent_Qos0PublishTakesNoPacketId( void )
+{
+    MQTTPublishInfo_t publishInfo = { 0 };
+    uint8_t payload[ TEST_PAYLOAD_LENGTH ] = { 0 };
+    uint32_t sequence = 0U;
+
+    publishInfo.pTopicName = TEST_TOPIC;
+    publishInfo.topicNameLength = TEST_TOPIC_LENGTH;
+    publishInfo.pPayload = payload;
+    publishInfo.payloadLength = sizeof( payload );
+
+    for( sequence = 0U; sequence <= MESSAGES_PER_PRODUCER; sequence++ )
+    {
+        payload[ 1 ] = ( uint8_t ) ( sequence >> 24 );
+        payload[ 2 ] = ( uint8_t ) ( sequence >> 16 );
+        payload[ 3 ] = ( uint8_t ) ( sequence >> 8 );
+        payload[ 4 ] = ( uint8_t ) sequence;
+        publishInfo.qos = ( sequence < MESSAGES_PER_PRODUCER ) ? MQTTQoS0 : MQTTQoS1;
+        TEST_ASSERT_EQUAL( MQTTSuccess, MqttCommandAgent_Publish( &agent, &publishInfo ) );
+    }
+
+    stopThreads();
+
+    TEST_ASSERT_EQUAL_UINT32( MESSAGES_PER_PRODUCER + 1U, receivedCounts[ 0 ] );
+    TEST_ASSERT_EQUAL_UINT16( 1U, lastPacketId );
+    TEST_ASSERT_EQUAL_UINT32( 0U, orderErrorCount );
+    TEST_ASSERT_EQUAL_UINT32( 0U, malformedCount );
+    TEST_ASSERT_EQUAL_UINT32( 0U, unmatchedAckCount );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Measures how long a job status update takes to be acknowledged
+ * while a thread downloads data blocks through the same agent, as the OTA
+ * over MQTT demo does, against the same updates on an idle connection.
+ */
+void test_MqttCommandAgent_JobStatusLatencyUnderBlockDownload( void )
+{
+    long idleAverageUs = 0L, idleMaxUs = 0L;
+    long loadedAverageUs = 0L, loadedMaxUs = 0L;
+    struct timespec start, end;
+    long downloadUs = 0L;
+
+    timeJobStatusUpdates( 0U, &idleAverageUs, &idleMaxUs );
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+    TEST_ASSERT_EQUAL( 0, pthread_create( &downloadThread, NULL, downloadThreadRoutine, NULL ) );
+    isDownloadRunning = true;
+
+    timeJobStatusUpdates( JOB_STATUS_UPDATE_COUNT, &loadedAverageUs, &loadedMaxUs );
+
+    /* Stops the download before the agent, so that its last request is
+     * answered. */
+    stopThreads();
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &end );
+    downloadUs = ( ( end.tv_sec - start.tv_sec ) * 1000000L ) +
+                 ( ( end.tv_nsec - start.tv_nsec ) / 1000L );
+
+    TEST_ASSERT_EQUAL_UINT32( 0U, downloadFailedCount );
+    TEST_ASSERT_GREATER_THAN_UINT32( 0U, downloadedBlockCount );
+    TEST_ASSERT_EQUAL_UINT32( 2U * JOB_STATUS_UPDATE_COUNT, receivedCounts[ 0 ] );
+    TEST_ASSERT_EQUAL_UINT32( 0U, orderErrorCount );
+    TEST_ASSERT_EQUAL_UINT32( 0U, malformedCount );
+    TEST_ASSERT_EQUAL_UINT32( 0U, unmatchedAckCount );
+
+    LogInfo( ( "Job status update latency over %u updates: idle average %ld us, max %ld us; "
+               "during block download average %ld us, max %ld us, with %u blocks downloaded at %ld KB/s.",
+               JOB_STATUS_UPDATE_COUNT,
+               idleAverageUs,
+               idleMaxUs,
+               loadedAverageUs,
+               loadedMaxUs,
+               downloadedBlockCount,
+               ( ( long ) downloadedBlockCount * ( DATA_BLOCK_SIZE / 1024L ) * 1000000L ) / downloadUs ) );
+}
@@ -0,0 +1,739 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file mqtt_subscription_manager_test.c
+ * @brief Tests of the topic trie of the OTA subscription manager with
+ * wildcard topic filters and after removals, and comparison of its dispatch
+ * speed with the linear scan of MQTT_MatchTopic it replaced.
+ */
+
+/* Standard header includes. */
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+/* Include config file before other non-system includes. */
+#include "test_config.h"
+
+/* Unity testing framework includes. */
+#include "unity.h"
+
+/* Include the subscription manager. */
+#include "mqtt_subscription_manager.h"
+
+/**
+ * @brief Size of the registry of the subscription manager, set for both the
+ * test and the subscription manager by the build.
+ */
+#ifndef MAX_SUBSCRIPTION_CALLBACK_RECORDS
+    #define MAX_SUBSCRIPTION_CALLBACK_RECORDS    ( 10000 )
+#endif
+
+/**
+ * @brief Number of distinct callbacks, telling apart the topic filters
+ * invoked by a dispatch.
+ */
+#define CALLBACK_COUNT                       ( 6U )
+
+/**
+ * @brief Size of the buffers holding the topic filters registered.
+ */
+#define FILTER_BUFFER_SIZE                   ( 48U )
+
+/**
+ * @brief Number of register, remove and dispatch steps of the comparison
+ * with MQTT_MatchTopic.
+ */
+#define RANDOM_STEPS                         ( 20000U )
+
+/**
+ * @brief Number of rounds of removing and registering again random topic
+ * filters of the full registry.
+ */
+#define CHURN_ROUNDS                         ( 100U )
+
+/**
+ * @brief Number of dispatches timed for each number of topic filters.
+ */
+#define BENCHMARK_DISPATCHES                 ( 2000U )
+
+/**
+ * @brief Number of nanoseconds in a second.
+ */
+#define NANOSECONDS_PER_SECOND               ( 1000000000L )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief A topic name, and the number of times a dispatch to it invokes
+ * each callback.
+ */
+typedef struct DispatchCase
+{
+    const char * pTopicName;                     /**< @brief The topic name. */
+    uint32_t expectedCounts[ CALLBACK_COUNT ];   /**< @brief Expected invocations of each callback. */
+} DispatchCase_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Number of times each callback was invoked since the last dispatch.
+ */
+static uint32_t invocationCounts[ CALLBACK_COUNT ];
+
+/**
+ * @brief Topic filters registered by the test, removed after each test.
+ */
+static char filterBuffers[ MAX_SUBSCRIPTION_CALLBACK_RECORDS ][ FILTER_BUFFER_SIZE ];
+static bool isRegistered[ MAX_SUBSCRIPTION_CALLBACK_RECORDS ];
+
+/**
+ * @brief The MQTT context passed to the dispatch handler, unused by the
+ * callbacks.
+ */
+static MQTTContext_t mqttContext;
+
+/**
+ * @brief State of the pseudo-random generator of the comparison with
+ * MQTT_MatchTopic, seeded for reproducible runs.
+ */
+static uint32_t randomState = 1U;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Callbacks counting their invocations in #invocationCounts.
+ */
+static void callback0( MQTTContext_t * pContext,
+                       MQTTPublishInfo_t * pPublishInfo );
+static void callback1( MQTTContext_t * pContext,
+                       MQTTPublishInfo_t * pPublishInfo );
+static void callback2( MQTTContext_t * pContext,
+                       MQTTPublishInfo_t * pPublishInfo );
+static void callback3( MQTTContext_t * pContext,
+                       MQTTPublishInfo_t * pPublishInfo );
+static void callback4( MQTTContext_t * pContext,
+                       MQTTPublishInfo_t * pPublishInfo );
+static void callback5( MQTTContext_t * pContext,
+                       MQTTPublishInfo_t * pPublishInfo );
+
+/**
+ * @brief Registers the topic filter held in a buffer of #filterBuffers.
+ *
+ * @param[in] index The index of the buffer.
+ * @param[in] callbackIndex The callback to register.
+ *
+ * @return The status returned by SubscriptionManager_RegisterCallback.
+ */
+static SubscriptionManagerStatus_t registerFilter( size_t index,
+                                                   size_t callbackIndex );
+
+/**
+ * @brief Removes the topic filter held in a buffer of #filterBuffers.
+ *
+ * @param[in] index The index of the buffer.
+ */
+static void removeFilter( size_t index );
+
+/**
+ * @brief Dispatches a PUBLISH to a topic name, after clearing
+ * #invocationCounts.
+ *
+ * @param[in] pTopicName The topic name.
+ */
+static void dispatch( const char * pTopicName );
+
+/**
+ * @brief Dispatches a PUBLISH to a topic name the way the subscription
+ * manager did before the topic trie: by matching every registered topic
+ * filter with MQTT_MatchTopic.
+ *
+ * @param[in] pTopicName The topic name.
+ * @param[in] filterCount The number of topic filters, the first buffers of
+ * #filterBuffers.
+ *
+ * @return The number of matching topic filters.
+ */
+static uint32_t dispatchByLinearScan( const char * pTopicName,
+                                      size_t filterCount );
+
+/**
+ * @brief Generates a pseudo-random number.
+ *
+ * @param[in] range The number of values.
+ *
+ * @return A number below @p range.
+ */
+static uint32_t nextRandom( uint32_t range );
+
+/**
+ * @brief Writes a random topic name or topic filter of up to four levels.
+ *
+ * @param[out] pBuffer The buffer to write to, of #FILTER_BUFFER_SIZE bytes.
+ * @param[in] isFilter true to write a topic filter, which may contain
+ * wildcards.
+ */
+static void writeRandomTopic( char * pBuffer,
+                              bool isFilter );
+
+/**
+ * @brief Times #BENCHMARK_DISPATCHES dispatches to topic filters without
+ * wildcards, each matching one of them.
+ *
+ * @param[in] filterCount The number of topic filters registered.
+ * @param[in] useLinearScan true to time #dispatchByLinearScan.
+ *
+ * @return The average time of a dispatch in nanoseconds.
+ */
+static long timeDispatches( size_t filterCount,
+                            bool useLinearScan );
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The callbacks, in the order of #invocationCounts.
+ */
+static const SubscriptionManagerCallback_t callbacks[ CALLBACK_COUNT ] =
+{
+    callback0, callback1, callback2, callback3, callback4, callback5
+};
+
+/*-----------------------------------------------------------*/
+
+static void callback0( MQTTContext_t * pContext,
+                       MQTTPublishInfo_t * pPublishInfo )
+{
+    ( void ) pContext;
+    ( void ) pPublishInfo;
+    invocationCounts[ 0 ]++;
+}
+
+static void callback1( MQTTContext_t * pContext,
+                       MQTTPublishInfo_t * pPublishInfo )
+{
+    ( void ) pContext;
+    ( void ) pPublishInfo;
+    invocationCounts[ 1 ]++;
+}
+
+static void callback2( MQTTContext_t * pContext,
+                       MQTTPublishInfo_t * pPublishInfo )
+{
+    ( void ) pContext;
+    ( void ) pPublishInfo;
+    invocationCounts[ 2 ]++;
+}
+
+static void callback3( MQTTContext_t * pContext,
+                       MQTTPublishInfo_t * pPublishInfo )
+{
+    ( void ) pContext;
+    ( void ) pPublishInfo;
+    invocationCounts[ 3 ]++;
+}
+
+static void callback4( MQTTContext_t * pContext,
+                       MQTTPublishInfo_t * pPublishInfo )
+{
+    ( void ) pContext;
+    ( void ) pPublishInfo;
+    invocationCounts[ 4 ]++;
+}
+
+static void callback5( MQTTContext_t * pContext,
+                       MQTTPublishInfo_t * pPublishInfo )
+{
+    ( void ) pContext;
+    ( void ) pPublishInfo;
+    invocationCounts[ 5 ]++;
+}
+
+/*-----------------------------------------------------------*/
+
+static SubscriptionManagerStatus_t registerFilter( size_t index,
+                                                   size_t callbackIndex )
+{
+    SubscriptionManagerStatus_t status = SUBSCRIPTION_MANAGER_SUCCESS;
+
+    status = SubscriptionManager_RegisterCallback( filterBuffers[ index ],
+                                                   ( uint16_t ) strlen( filterBuffers[ index ] ),
+                                                   callbacks[ callbackIndex ] );
+
+    if( status == SUBSCRIPTION_MANAGER_SUCCESS )
+    {
+        isRegistered[ index ] = true;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+static void removeFilter( size_t index )
+{
+    SubscriptionManager_RemoveCallback( filterBuffers[ index ],
+                                        ( uint16_t ) strlen( filterBuffers[ index ] ) );
+    isRegistered[ index ] = false;
+
+    /* The subscription manager must no longer refer to the topic filter. */
+    ( void ) memset( filterBuffers[ index ], '!', FILTER_BUFFER_SIZE - 1U );
+}
+
+/*-----------------------------------------------------------*/
+
+static void dispatch( const char * pTopicName )
+{
+    MQTTPublishInfo_t publishInfo = { 0 };
+
+    publishInfo.pTopicName = pTopicName;
+    publishInfo.topicNameLength = ( uint16_t ) strlen( pTopicName );
+
+    ( void ) memset( invocationCounts, 0, sizeof( invocationCounts ) );
+    SubscriptionManager_DispatchHandler( &mqttContext, &publishInfo );
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t dispatchByLinearScan( const char * pTopicName,
+                                      size_t filterCount )
+{
+    uint16_t topicNameLength = ( uint16_t ) strlen( pTopicName );
+    uint32_t matchCount = 0U;
+    size_t index = 0U;
+    bool isMatch = false;
+
+    for( index = 0U; index < filterCount; index++ )
+    {
+        if( ( MQTT_MatchTopic( pTopicName,
+                               topicNameLength,
+                               filterBuffers[ index ],
+                               ( uint16_t ) strlen( filterBuffers[ index ] ),
+                               &isMatch ) == MQTTSuccess ) &&
+            ( isMatch == true ) )
+        {
+            matchCount++;
+        }
+    }
+
+    return matchCount;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t nextRandom( uint32_t range )
+{
+    randomState = ( randomState * 1103515245U ) + 12345U;
+
+    return ( randomState >> 16 ) % range;
+}
+
+/*-----------------------------------------------------------*/
+
+static void writeRandomTopic( char * pBuffer,
+                              bool isFilter )
+{
+    /* Few distinct levels, so that topic filters share levels and match. */
+    static const char * const nameLevels[] = { "a", "b", "c", "", "$s" };
+    static const char * const filterLevels[] = { "a", "b", "c", "", "+", "$s" };
+    const char * const * pLevels = ( isFilter == true ) ? filterLevels : nameLevels;
+    uint32_t levelChoices = ( isFilter == true ) ? 6U : 5U;
+    uint32_t levelCount = nextRandom( 4U ) + 1U, level = 0U;
+
+    pBuffer[ 0 ] = '\0';
+
+    for( level = 0U; level < levelCount; level++ )
+    {
+        if( level > 0U )
+        {
+            ( void ) strcat( pBuffer, "/" );
+        }
+
+        if( ( isFilter == true ) && ( level == ( levelCount - 1U ) ) && ( nextRandom( 4U ) == 0U ) )
+        {
+            ( void ) strcat( pBuffer, "#" );
+        }
+        else
+        {
+            ( void ) strcat( pBuffer, pLevels[ nextRandom( levelChoices ) ] );
+        }
+    }
+
+    /* A topic of a single empty level is not valid. */
+    if( pBuffer[ 0 ] == '\0' )
+    {
+        ( void ) strcpy( pBuffer, "a" );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static long timeDispatches( size_t filterCount,
+                            bool useLinearScan )
+{
+    char topicName[ FILTER_BUFFER_SIZE ];
+    struct timespec start, end;
+    uint32_t dispatchIndex = 0U, matchCount = 0U;
+    long elapsedNs = 0L;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+
+    for( dispatchIndex = 0U; dispatchIndex < BENCHMARK_DISPATCHES; dispatchIndex++ )
+    {
+        /* The topic filters are topic names, so that each dispatch matches
+         * one of them. */
+        ( void ) memcpy( topicName, filterBuffers[ ( dispatchIndex * 7919U ) % filterCount ], sizeof( topicName ) );
+
+        if( useLinearScan == true )
+        {
+            matchCount += dispatchByLinearScan( topicName, filterCount );
+        }
+        else
+        {
+            dispatch( topicName );
+            matchCount += invocationCounts[ 0 ];
+        }
+    }
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &end );
+
+    TEST_ASSERT_EQUAL_UINT32( BENCHMARK_DISPATCHES, matchCount );
+
+    elapsedNs = ( ( end.tv_sec - start.tv_sec ) * NANOSECONDS_PER_SECOND ) +
+                ( end.tv_nsec - start.tv_nsec );
+
+    return elapsedNs / ( long ) BENCHMARK_DISPATCHES;
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    ( void ) memset( invocationCounts, 0, sizeof( invocationCounts ) );
+    randomState = 1U;
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+    size_t index = 0U;
+
+    /* The registry outlives the test; empty it for the next test. */
+    for( index = 0U; index < MAX_SUBSCRIPTION_CALLBACK_RECORDS; index++ )
+    {
+        if( isRegistered[ index ] == true )
+        {
+            removeFilter( index );
+        }
+    }
+}
+
+/* ========================== Test Cases ============================ */
+
+/**
+ * @brief Dispatches to topic names matching topic filters with single-level
+ * and multi-level wildcards, and checks the callbacks invoked.
+ */
+void test_SubscriptionManager_Dispatch_Wildcards( void )
+{
+    static const char * const filters[ CALLBACK_COUNT ] =
+    {
+        "a/b/c", "a/+/c", "a/#", "+/b/#", "#", "+"
+    };
+    static const DispatchCase_t cases[] =
+    {
+        { "a/b/c",    { 1U, 1U, 1U, 1U, 1U, 0U } },
+        { "a/x/c",    { 0U, 1U, 1U, 0U, 1U, 0U } },
+        /* "a/#" also matches "a", and "+/b/#" matches "a/b". */
+        { "a",        { 0U, 0U, 1U, 0U, 1U, 1U } },
+        { "a/b",      { 0U, 0U, 1U, 1U, 1U, 0U } },
+        { "a/b/c/d",  { 0U, 0U, 1U, 1U, 1U, 0U } },
+        { "x/b/y/z",  { 0U, 0U, 0U, 1U, 1U, 0U } },
+        /* '+' matches an empty level. */
+        { "a//c",     { 0U, 1U, 1U, 0U, 1U, 0U } },
+        { "/b",       { 0U, 0U, 0U, 1U, 1U, 0U } },
+        /* First-level wildcards do not match topic names starting with '$'. */
+        { "$aws/b/c", { 0U, 0U, 0U, 0U, 0U, 0U } },
+        { "b/a/c",    { 0U, 0U, 0U, 0U, 1U, 0U } }
+    };
+    size_t index = 0U, caseIndex = 0U;
+
+    for( index = 0U; index < CALLBACK_COUNT; index++ )
+    {
+        ( void ) strcpy( filterBuffers[ index ], filters[ index ] );
+        TEST_ASSERT_EQUAL( SUBSCRIPTION_MANAGER_SUCCESS, registerFilter( index, index ) );
+    }
+
+    for( caseIndex = 0U; caseIndex < ( sizeof( cases ) / sizeof( cases[ 0 ] ) ); caseIndex++ )
+    {
+        dispatch( cases[ caseIndex ].pTopicName );
+
+        for( index = 0U; index < CALLBACK_COUNT; index++ )
+        {
+            TEST_ASSERT_EQUAL_UINT32_MESSAGE( cases[ caseIndex ].expectedCounts[ index ],
+                                              invocationCounts[ index ],
+                                              cases[ caseIndex ].pTopicName );
+        }
+    }
+}
+
+/**
+ * @brief Removes a topic filter whose levels the trie nodes shared with
+ * other topic filters refer to, overwrites it, and checks that the other
+ * topic filters are still dispatched to.
+ */
+void test_SubscriptionManager_Remove_SharedLevelsKept( void )
+{
+    ( void ) strcpy( filterBuffers[ 0 ], "devices/thing/jobs/notify" );
+    ( void ) strcpy( filterBuffers[ 1 ], "devices/thing/jobs/+" );
+    ( void ) strcpy( filterBuffers[ 2 ], "devices/thing" );
+
+    TEST_ASSERT_EQUAL( SUBSCRIPTION_MANAGER_SUCCESS, registerFilter( 0U, 0U ) );
+    TEST_ASSERT_EQUAL( SUBSCRIPTION_MANAGER_SUCCESS, registerFilter( 1U, 1U ) );
+    TEST_ASSERT_EQUAL( SUBSCRIPTION_MANAGER_SUCCESS, registerFilter( 2U, 2U ) );
+
+    /* The first topic filter holds the levels "devices", "thing" and
+     * "jobs" of the trie. */
+    removeFilter( 0U );
+
+    dispatch( "devices/thing/jobs/notify" );
+    TEST_ASSERT_EQUAL_UINT32( 0U, invocationCounts[ 0 ] );
+    TEST_ASSERT_EQUAL_UINT32( 1U, invocationCounts[ 1 ] );
+    TEST_ASSERT_EQUAL_UINT32( 0U, invocationCounts[ 2 ] );
+
+    dispatch( "devices/thing" );
+    TEST_ASSERT_EQUAL_UINT32( 1U, invocationCounts[ 2 ] );
+
+    TEST_ASSERT_EQUAL( SUBSCRIPTION_MANAGER_RECORD_EXISTS, registerFilter( 1U, 3U ) );
+
+    ( void ) strcpy( filterBuffers[ 0 ], "devices/thing/jobs/notify" );
+    TEST_ASSERT_EQUAL( SUBSCRIPTION_MANAGER_SUCCESS, registerFilter( 0U, 0U ) );
+    dispatch( "devices/thing/jobs/notify" );
+    TEST_ASSERT_EQUAL_UINT32( 1U, invocationCounts[ 0 ] );
+    TEST_ASSERT_EQUAL_UINT32( 1U, invocationCounts[ 1 ] );
+}
+
+/**
+ * @brief Fills the registry, removes every other topic filter, then every
+ * other one left in reverse order, so that the hash indices shift back
+ * entries of their probe sequences. Checks after each pass that the topic
+ * filters left are still found and that the removed ones are not, then
+ * fills the registry again and removes random topic filters in rounds.
+ */
+void test_SubscriptionManager_Remove_BackwardShiftKeepsEntries( void )
+{
+    size_t index = 0U, reverseIndex = 0U;
+    uint32_t pass = 0U;
+
+    for( index = 0U; index < MAX_SUBSCRIPTION_CALLBACK_RECORDS; index++ )
+    {
+        ( void ) snprintf( filterBuffers[ index ], FILTER_BUFFER_SIZE, "things/%u/jobs", ( unsigned int ) index );
+        TEST_ASSERT_EQUAL( SUBSCRIPTION_MANAGER_SUCCESS, registerFilter( index, 0U ) );
+    }
+
+    TEST_ASSERT_EQUAL( SUBSCRIPTION_MANAGER_REGISTRY_FULL,
+                       SubscriptionManager_RegisterCallback( "things/full", 11U, callback0 ) );
+
+    for( pass = 0U; pass < 2U; pass++ )
+    {
+        for( index = 0U; index < MAX_SUBSCRIPTION_CALLBACK_RECORDS; index++ )
+        {
+            reverseIndex = MAX_SUBSCRIPTION_CALLBACK_RECORDS - 1U - index;
+
+            if( ( pass == 0U ) && ( ( index % 2U ) == 1U ) )
+            {
+                removeFilter( index );
+            }
+            else if( ( pass == 1U ) && ( ( reverseIndex % 4U ) == 0U ) )
+            {
+                removeFilter( reverseIndex );
+            }
+            else
+            {
+                /* Empty else MISRA 15.7 */
+            }
+        }
+
+        for( index = 0U; index < MAX_SUBSCRIPTION_CALLBACK_RECORDS; index++ )
+        {
+            if( isRegistered[ index ] == true )
+            {
+                dispatch( filterBuffers[ index ] );
+                TEST_ASSERT_EQUAL_UINT32( 1U, invocationCounts[ 0 ] );
+
+                /* Found by the index of topic filters; each refusal is
+                 * logged, so only some are checked. */
+                if( ( index % 64U ) == 0U )
+                {
+                    TEST_ASSERT_EQUAL( SUBSCRIPTION_MANAGER_RECORD_EXISTS, registerFilter( index, 1U ) );
+                }
+            }
+            else
+            {
+                ( void ) snprintf( filterBuffers[ index ], FILTER_BUFFER_SIZE, "things/%u/jobs", ( unsigned int ) index );
+                dispatch( filterBuffers[ index ] );
+                TEST_ASSERT_EQUAL_UINT32( 0U, invocationCounts[ 0 ] );
+            }
+        }
+    }
+
+    /* The records and trie nodes removed are free again. */
+    for( index = 0U; index < MAX_SUBSCRIPTION_CALLBACK_RECORDS; index++ )
+    {
+        if( isRegistered[ index ] == false )
+        {
+            TEST_ASSERT_EQUAL( SUBSCRIPTION_MANAGER_SUCCESS, registerFilter( index, 0U ) );
+        }
+    }
+
+    /* Remove random topic filters of the full registry, so that entries of
+     * every probe sequence are shifted back, including those wrapping
+     * around the end of the indices, then register them again. */
+    for( pass = 0U; pass < CHURN_ROUNDS; pass++ )
+    {
+        for( index = 0U; index < MAX_SUBSCRIPTION_CALLBACK_RECORDS; index++ )
+        {
+            if( nextRandom( 2U ) == 0U )
+            {
+                removeFilter( index );
+            }
+        }
+
+        for( index = 0U; index < MAX_SUBSCRIPTION_CALLBACK_RECORDS; index++ )
+        {
+            if( isRegistered[ index ] == true )
+            {
+                dispatch( filterBuffers[ index ] );
+                TEST_ASSERT_EQUAL_UINT32( 1U, invocationCounts[ 0 ] );
+            }
+            else
+            {
+                /* New topic filters, as the slots linear probing fills only
+                 * depend on the keys in the index. */
+                ( void ) snprintf( filterBuffers[ index ], FILTER_BUFFER_SIZE, "things/%u/jobs/%u",
+                                   ( unsigned int ) index, ( unsigned int ) pass );
+                TEST_ASSERT_EQUAL( SUBSCRIPTION_MANAGER_SUCCESS, registerFilter( index, 0U ) );
+            }
+        }
+    }
+}
+
+/**
+ * @brief Registers and removes random topic filters with wildcards,
+ * dispatches to random topic names after each step, and checks that the
+ * callbacks invoked are those of the topic filters MQTT_MatchTopic matches.
+ */
+void test_SubscriptionManager_Dispatch_MatchesMqttMatchTopic( void )
+{
+    char topicName[ FILTER_BUFFER_SIZE ];
+    uint32_t step = 0U, expectedCount = 0U, totalMatches = 0U;
+    size_t index = 0U, other = 0U;
+    bool isMatch = false, isDuplicate = false;
+
+    for( step = 0U; step < RANDOM_STEPS; step++ )
+    {
+        index = nextRandom( CALLBACK_COUNT );
+
+        if( isRegistered[ index ] == true )
+        {
+            removeFilter( index );
+        }
+        else
+        {
+            writeRandomTopic( filterBuffers[ index ], true );
+
+            isDuplicate = false;
+
+            for( other = 0U; other < CALLBACK_COUNT; other++ )
+            {
+                isDuplicate = isDuplicate ||
+                              ( ( isRegistered[ other ] == true ) &&
+                                ( strcmp( filterBuffers[ other ], filterBuffers[ index ] ) == 0 ) );
+            }
+
+            TEST_ASSERT_EQUAL( ( isDuplicate == true ) ? SUBSCRIPTION_MANAGER_RECORD_EXISTS : SUBSCRIPTION_MANAGER_SUCCESS,
+                               registerFilter( index, index ) );
+        }
+
+        writeRandomTopic( topicName, false );
+        dispatch( topicName );
+
+        for( index = 0U; index < CALLBACK_COUNT; index++ )
+        {
+            expectedCount = 0U;
+
+            if( ( isRegistered[ index ] == true ) &&
+                ( MQTT_MatchTopic( topicName,
+                                   ( uint16_t ) strlen( topicName ),
+                                   filterBuffers[ index ],
+                                   ( uint16_t ) strlen( filterBuffers[ index ] ),
+                                   &isMatch ) == MQTTSuccess ) &&
+                ( isMatch == true ) )
+            {
+                expectedCount = 1U;
+            }
+
+            totalMatches += expectedCount;
+            TEST_ASSERT_EQUAL_UINT32_MESSAGE( expectedCount, invocationCounts[ index ], topicName );
+        }
+    }
+
+    /* The random topics match often enough to test the wildcards. */
+    TEST_ASSERT_GREATER_THAN_UINT32( RANDOM_STEPS / 10U, totalMatches );
+}
+
+/**
+ * @brief Compares the time of a dispatch through the topic trie with that
+ * of the linear scan of MQTT_MatchTopic, for 10 to 10,000 topic filters.
+ */
+void test_SubscriptionManager_Dispatch_Throughput( void )
+{
+    static const size_t filterCounts[] = { 10U, 100U, 1000U, 10000U };
+    size_t countIndex = 0U, index = 0U, registeredCount = 0U;
+    long trieNs = 0L, scanNs = 0L;
+
+    for( countIndex = 0U; countIndex < ( sizeof( filterCounts ) / sizeof( filterCounts[ 0 ] ) ); countIndex++ )
+    {
+        TEST_ASSERT_LESS_OR_EQUAL( MAX_SUBSCRIPTION_CALLBACK_RECORDS, filterCounts[ countIndex ] );
+
+        /* Topic filters of the shape of the AWS IoT Jobs topics. */
+        for( index = registeredCount; index < filterCounts[ countIndex ]; index++ )
+        {
+            ( void ) snprintf( filterBuffers[ index ], FILTER_BUFFER_SIZE,
+                               "$aws/things/thing%u/jobs/notify-next", ( unsigned int ) index );
+            TEST_ASSERT_EQUAL( SUBSCRIPTION_MANAGER_SUCCESS, registerFilter( index, 0U ) );
+        }
+
+        registeredCount = filterCounts[ countIndex ];
+
+        trieNs = timeDispatches( registeredCount, false );
+        scanNs = timeDispatches( registeredCount, true );
+
+        LogInfo( ( "%u topic filters: %ld ns per dispatch with the topic trie, %ld ns with a linear scan of MQTT_MatchTopic.",
+                   ( unsigned int ) registeredCount,
+                   trieNs,
+                   scanNs ) );
+    }
+}
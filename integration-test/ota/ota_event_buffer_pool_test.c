@@ -0,0 +1,605 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ota_event_buffer_pool_test.c
+ * @brief Stress test of the lock-free OTA event buffer pool, taking and
+ * returning buffers from many threads at once, and comparison of its speed
+ * with the semaphore and linear scan the OTA demos used before.
+ */
+
+/* Standard header includes. */
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+/* POSIX includes. */
+#include <pthread.h>
+#include <semaphore.h>
+
+/* Include config file before other non-system includes. */
+#include "test_config.h"
+
+/* Unity testing framework includes. */
+#include "unity.h"
+
+/* Include the OTA event buffer pool. */
+#include "ota_event_buffer_pool.h"
+
+/**
+ * @brief Number of buffers of the pool, fewer than the threads can hold at
+ * once so that the pool is often exhausted.
+ */
+#define POOL_CAPACITY                ( 8U )
+
+/**
+ * @brief Number of threads taking and returning buffers.
+ */
+#define STRESS_THREAD_COUNT          ( 8U )
+
+/**
+ * @brief Largest number of buffers a thread holds at once.
+ */
+#define MAX_BUFFERS_PER_THREAD       ( 3U )
+
+/**
+ * @brief Number of times each thread takes and returns its buffers.
+ */
+#define STRESS_ITERATIONS            ( 200000U )
+
+/**
+ * @brief Number of bytes of a taken buffer its owner fills, and checks
+ * before returning it.
+ */
+#define OWNER_MARK_LENGTH            ( 16U )
+
+/**
+ * @brief Number of times each thread of the benchmark takes and returns a
+ * buffer.
+ */
+#define BENCHMARK_ITERATIONS         ( 1000000U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Function taking a free buffer, or returning NULL if there is none.
+ */
+typedef OtaEventData_t * ( * BufferGetFunc_t )( void );
+
+/**
+ * @brief Function returning a taken buffer.
+ */
+typedef void ( * BufferPutFunc_t )( OtaEventData_t * pBuffer );
+
+/**
+ * @brief State of a thread of the stress test.
+ */
+typedef struct StressThread
+{
+    pthread_t thread;      /**< @brief The thread. */
+    uint8_t id;            /**< @brief Non-zero identifier of the thread. */
+    uint32_t takenCount;   /**< @brief Number of buffers the thread took. */
+    uint32_t emptyCount;   /**< @brief Number of gets that returned NULL. */
+    uint32_t errorCount;   /**< @brief Number of ownership violations seen. */
+} StressThread_t;
+
+/**
+ * @brief State of a thread of the benchmark.
+ */
+typedef struct BenchmarkThread
+{
+    pthread_t thread;      /**< @brief The thread. */
+    BufferGetFunc_t get;   /**< @brief Takes a buffer. */
+    BufferPutFunc_t put;   /**< @brief Returns a buffer. */
+    uint32_t emptyCount;   /**< @brief Number of gets that returned NULL. */
+} BenchmarkThread_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The pool under test and its storage.
+ */
+static OtaEventBufferPool_t pool;
+static OtaEventData_t buffers[ POOL_CAPACITY ];
+static uint32_t nextFree[ POOL_CAPACITY ];
+
+/**
+ * @brief Identifier of the thread holding each buffer, or 0 if the buffer is
+ * in the pool.
+ */
+static uint8_t owners[ POOL_CAPACITY ];
+
+/**
+ * @brief The threads of the stress test.
+ */
+static StressThread_t stressThreads[ STRESS_THREAD_COUNT ];
+
+/**
+ * @brief Set once all the threads are started, so that they run together.
+ */
+static uint32_t isStarted = 0U;
+
+/**
+ * @brief Semaphore guarding the scan of #buffers, as in the OTA demos before
+ * the pool.
+ */
+static sem_t bufferSemaphore;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Take a buffer from #pool, and check that no other thread holds it.
+ *
+ * @param[in] pThread The thread taking the buffer.
+ *
+ * @return The buffer, or NULL if the pool is exhausted.
+ */
+static OtaEventData_t * takeBuffer( StressThread_t * pThread );
+
+/**
+ * @brief Check that a buffer still holds the mark of its owner, and return
+ * it to #pool.
+ *
+ * @param[in] pThread The thread returning the buffer.
+ * @param[in] pBuffer The buffer to return.
+ */
+static void returnBuffer( StressThread_t * pThread,
+                          OtaEventData_t * pBuffer );
+
+/**
+ * @brief Repeatedly take up to #MAX_BUFFERS_PER_THREAD buffers from #pool
+ * and return them.
+ *
+ * @param[in] pArgs The #StressThread_t of the thread.
+ *
+ * @return NULL.
+ */
+static void * stressThreadRoutine( void * pArgs );
+
+/**
+ * @brief Take a buffer from #pool.
+ *
+ * @return The buffer, or NULL if the pool is exhausted.
+ */
+static OtaEventData_t * poolBufferGet( void );
+
+/**
+ * @brief Return a buffer to #pool.
+ *
+ * @param[in] pBuffer The buffer to return.
+ */
+static void poolBufferPut( OtaEventData_t * pBuffer );
+
+/**
+ * @brief Take a buffer by scanning #buffers for a free one while holding
+ * #bufferSemaphore, as the OTA demos did before the pool.
+ *
+ * @return The buffer, or NULL if every buffer is taken.
+ */
+static OtaEventData_t * semaphoreBufferGet( void );
+
+/**
+ * @brief Return a buffer taken by semaphoreBufferGet.
+ *
+ * @param[in] pBuffer The buffer to return.
+ */
+static void semaphoreBufferPut( OtaEventData_t * pBuffer );
+
+/**
+ * @brief Take and return a buffer #BENCHMARK_ITERATIONS times.
+ *
+ * @param[in] pArgs The #BenchmarkThread_t of the thread.
+ *
+ * @return NULL.
+ */
+static void * benchmarkThreadRoutine( void * pArgs );
+
+/**
+ * @brief Run #benchmarkThreadRoutine in a number of threads at once.
+ *
+ * @param[in] get Takes a buffer.
+ * @param[in] put Returns a buffer.
+ * @param[in] threadCount The number of threads, at most
+ * #STRESS_THREAD_COUNT.
+ *
+ * @return The average time of a get and a put, in nanoseconds.
+ */
+static long timeGetPut( BufferGetFunc_t get,
+                        BufferPutFunc_t put,
+                        uint32_t threadCount );
+
+/*-----------------------------------------------------------*/
+
+static OtaEventData_t * takeBuffer( StressThread_t * pThread )
+{
+    OtaEventData_t * pBuffer = NULL;
+    uint32_t index = 0U;
+
+    pBuffer = OtaEventBufferPool_Get( &pool );
+
+    if( pBuffer == NULL )
+    {
+        pThread->emptyCount++;
+    }
+    else
+    {
+        index = ( uint32_t ) ( pBuffer - buffers );
+
+        /* Assertions are left to the test thread, as Unity is not thread
+         * safe. */
+        if( ( index >= POOL_CAPACITY ) ||
+            ( pBuffer->bufferUsed != true ) ||
+            ( __atomic_exchange_n( &owners[ index ], pThread->id, __ATOMIC_RELAXED ) != 0U ) )
+        {
+            pThread->errorCount++;
+        }
+
+        ( void ) memset( pBuffer->data, pThread->id, OWNER_MARK_LENGTH );
+        pBuffer->dataLength = pThread->id;
+        pThread->takenCount++;
+    }
+
+    return pBuffer;
+}
+
+/*-----------------------------------------------------------*/
+
+static void returnBuffer( StressThread_t * pThread,
+                          OtaEventData_t * pBuffer )
+{
+    uint32_t index = ( uint32_t ) ( pBuffer - buffers );
+    uint32_t byteIndex = 0U;
+
+    /* A buffer handed out twice is overwritten by its other owner. */
+    for( byteIndex = 0U; byteIndex < OWNER_MARK_LENGTH; byteIndex++ )
+    {
+        if( pBuffer->data[ byteIndex ] != pThread->id )
+        {
+            pThread->errorCount++;
+            break;
+        }
+    }
+
+    if( ( pBuffer->dataLength != pThread->id ) ||
+        ( __atomic_exchange_n( &owners[ index ], 0U, __ATOMIC_RELAXED ) != pThread->id ) )
+    {
+        pThread->errorCount++;
+    }
+
+    OtaEventBufferPool_Put( &pool, pBuffer );
+}
+
+/*-----------------------------------------------------------*/
+
+static void * stressThreadRoutine( void * pArgs )
+{
+    StressThread_t * pThread = ( StressThread_t * ) pArgs;
+    OtaEventData_t * heldBuffers[ MAX_BUFFERS_PER_THREAD ];
+    uint32_t iteration = 0U;
+    uint32_t heldCount = 0U;
+    uint32_t index = 0U;
+    OtaEventData_t * pBuffer = NULL;
+
+    while( __atomic_load_n( &isStarted, __ATOMIC_ACQUIRE ) == 0U )
+    {
+        /* Empty body. */
+    }
+
+    for( iteration = 0U; iteration < STRESS_ITERATIONS; iteration++ )
+    {
+        /* Vary the number of buffers held, so that gets and puts from
+         * different threads interleave in every order. */
+        heldCount = 0U;
+
+        for( index = 0U; index <= ( ( iteration + pThread->id ) % MAX_BUFFERS_PER_THREAD ); index++ )
+        {
+            pBuffer = takeBuffer( pThread );
+
+            if( pBuffer != NULL )
+            {
+                heldBuffers[ heldCount ] = pBuffer;
+                heldCount++;
+            }
+        }
+
+        /* Return the buffers in the order they were taken, which is not the
+         * order of the free stack. */
+        for( index = 0U; index < heldCount; index++ )
+        {
+            returnBuffer( pThread, heldBuffers[ index ] );
+        }
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static OtaEventData_t * poolBufferGet( void )
+{
+    return OtaEventBufferPool_Get( &pool );
+}
+
+/*-----------------------------------------------------------*/
+
+static void poolBufferPut( OtaEventData_t * pBuffer )
+{
+    OtaEventBufferPool_Put( &pool, pBuffer );
+}
+
+/*-----------------------------------------------------------*/
+
+static OtaEventData_t * semaphoreBufferGet( void )
+{
+    uint32_t index = 0U;
+    OtaEventData_t * pFreeBuffer = NULL;
+
+    if( sem_wait( &bufferSemaphore ) == 0 )
+    {
+        for( index = 0U; index < POOL_CAPACITY; index++ )
+        {
+            if( buffers[ index ].bufferUsed == false )
+            {
+                buffers[ index ].bufferUsed = true;
+                pFreeBuffer = &buffers[ index ];
+                break;
+            }
+        }
+
+        ( void ) sem_post( &bufferSemaphore );
+    }
+
+    return pFreeBuffer;
+}
+
+/*-----------------------------------------------------------*/
+
+static void semaphoreBufferPut( OtaEventData_t * pBuffer )
+{
+    if( sem_wait( &bufferSemaphore ) == 0 )
+    {
+        pBuffer->bufferUsed = false;
+        ( void ) sem_post( &bufferSemaphore );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void * benchmarkThreadRoutine( void * pArgs )
+{
+    BenchmarkThread_t * pThread = ( BenchmarkThread_t * ) pArgs;
+    OtaEventData_t * pBuffer = NULL;
+    uint32_t iteration = 0U;
+
+    while( __atomic_load_n( &isStarted, __ATOMIC_ACQUIRE ) == 0U )
+    {
+        /* Empty body. */
+    }
+
+    for( iteration = 0U; iteration < BENCHMARK_ITERATIONS; iteration++ )
+    {
+        pBuffer = pThread->get();
+
+        if( pBuffer != NULL )
+        {
+            pThread->put( pBuffer );
+        }
+        else
+        {
+            pThread->emptyCount++;
+        }
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static long timeGetPut( BufferGetFunc_t get,
+                        BufferPutFunc_t put,
+                        uint32_t threadCount )
+{
+    BenchmarkThread_t benchmarkThreads[ STRESS_THREAD_COUNT ];
+    struct timespec start, end;
+    uint32_t index = 0U;
+    long elapsedNs = 0L;
+
+    ( void ) memset( benchmarkThreads, 0, sizeof( benchmarkThreads ) );
+    __atomic_store_n( &isStarted, 0U, __ATOMIC_RELEASE );
+
+    for( index = 0U; index < threadCount; index++ )
+    {
+        benchmarkThreads[ index ].get = get;
+        benchmarkThreads[ index ].put = put;
+        TEST_ASSERT_EQUAL( 0, pthread_create( &benchmarkThreads[ index ].thread,
+                                              NULL,
+                                              benchmarkThreadRoutine,
+                                              &benchmarkThreads[ index ] ) );
+    }
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+    __atomic_store_n( &isStarted, 1U, __ATOMIC_RELEASE );
+
+    for( index = 0U; index < threadCount; index++ )
+    {
+        TEST_ASSERT_EQUAL( 0, pthread_join( benchmarkThreads[ index ].thread, NULL ) );
+
+        /* Each thread holds at most one buffer, so the pool is never
+         * exhausted. */
+        TEST_ASSERT_EQUAL_UINT32( 0U, benchmarkThreads[ index ].emptyCount );
+    }
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &end );
+    elapsedNs = ( ( end.tv_sec - start.tv_sec ) * 1000000000L ) +
+                ( end.tv_nsec - start.tv_nsec );
+
+    return elapsedNs / ( ( long ) threadCount * ( long ) BENCHMARK_ITERATIONS );
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    ( void ) memset( buffers, 0, sizeof( buffers ) );
+    ( void ) memset( owners, 0, sizeof( owners ) );
+    ( void ) memset( stressThreads, 0, sizeof( stressThreads ) );
+    __atomic_store_n( &isStarted, 0U, __ATOMIC_RELEASE );
+
+    OtaEventBufferPool_Init( &pool, buffers, nextFree, POOL_CAPACITY );
+    TEST_ASSERT_EQUAL( 0, sem_init( &bufferSemaphore, 0, 1U ) );
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+    ( void ) sem_destroy( &bufferSemaphore );
+}
+
+/* ========================== Test Cases ============================ */
+
+/**
+ * @brief Takes every buffer of a pool from a single thread, and checks the
+ * counters and the order buffers are handed out in.
+ */
+void test_OtaEventBufferPool_GetPutSingleThread( void )
+{
+    OtaEventBufferPoolStats_t stats = { 0 };
+    OtaEventData_t * pBuffer = NULL;
+    uint32_t index = 0U;
+
+    for( index = 0U; index < POOL_CAPACITY; index++ )
+    {
+        pBuffer = OtaEventBufferPool_Get( &pool );
+        TEST_ASSERT_EQUAL_PTR( &buffers[ index ], pBuffer );
+        TEST_ASSERT_TRUE( pBuffer->bufferUsed );
+    }
+
+    TEST_ASSERT_NULL( OtaEventBufferPool_Get( &pool ) );
+
+    OtaEventBufferPool_GetStats( &pool, &stats );
+    TEST_ASSERT_EQUAL_UINT32( POOL_CAPACITY, stats.inUseCount );
+    TEST_ASSERT_EQUAL_UINT32( POOL_CAPACITY, stats.highWaterMark );
+    TEST_ASSERT_EQUAL_UINT32( 1U, stats.exhaustedCount );
+
+    /* The last buffer returned is the first taken. */
+    OtaEventBufferPool_Put( &pool, &buffers[ 2 ] );
+    OtaEventBufferPool_Put( &pool, &buffers[ 5 ] );
+    TEST_ASSERT_FALSE( buffers[ 5 ].bufferUsed );
+    TEST_ASSERT_EQUAL_PTR( &buffers[ 5 ], OtaEventBufferPool_Get( &pool ) );
+    TEST_ASSERT_EQUAL_PTR( &buffers[ 2 ], OtaEventBufferPool_Get( &pool ) );
+
+    for( index = 0U; index < POOL_CAPACITY; index++ )
+    {
+        OtaEventBufferPool_Put( &pool, &buffers[ index ] );
+    }
+
+    OtaEventBufferPool_GetStats( &pool, &stats );
+    TEST_ASSERT_EQUAL_UINT32( 0U, stats.inUseCount );
+    TEST_ASSERT_EQUAL_UINT32( POOL_CAPACITY, stats.highWaterMark );
+}
+
+/**
+ * @brief Takes and returns buffers from #STRESS_THREAD_COUNT threads at once,
+ * and checks that no buffer is ever held by two threads, that the counters
+ * add up, and that every buffer is back in the pool afterwards.
+ */
+void test_OtaEventBufferPool_StressManyThreads( void )
+{
+    OtaEventBufferPoolStats_t stats = { 0 };
+    OtaEventData_t * pBuffer = NULL;
+    uint32_t takenCount = 0U;
+    uint32_t emptyCount = 0U;
+    uint32_t index = 0U;
+    bool isTaken[ POOL_CAPACITY ] = { false };
+
+    for( index = 0U; index < STRESS_THREAD_COUNT; index++ )
+    {
+        stressThreads[ index ].id = ( uint8_t ) ( index + 1U );
+        TEST_ASSERT_EQUAL( 0, pthread_create( &stressThreads[ index ].thread,
+                                              NULL,
+                                              stressThreadRoutine,
+                                              &stressThreads[ index ] ) );
+    }
+
+    __atomic_store_n( &isStarted, 1U, __ATOMIC_RELEASE );
+
+    for( index = 0U; index < STRESS_THREAD_COUNT; index++ )
+    {
+        TEST_ASSERT_EQUAL( 0, pthread_join( stressThreads[ index ].thread, NULL ) );
+        TEST_ASSERT_EQUAL_UINT32( 0U, stressThreads[ index ].errorCount );
+        takenCount += stressThreads[ index ].takenCount;
+        emptyCount += stressThreads[ index ].emptyCount;
+    }
+
+    OtaEventBufferPool_GetStats( &pool, &stats );
+    LogInfo( ( "Took %u buffers; %u gets found the pool exhausted; high-water mark %u.",
+               ( unsigned ) takenCount,
+               ( unsigned ) emptyCount,
+               ( unsigned ) stats.highWaterMark ) );
+
+    TEST_ASSERT_EQUAL_UINT32( 0U, stats.inUseCount );
+    TEST_ASSERT_EQUAL_UINT32( emptyCount, stats.exhaustedCount );
+    TEST_ASSERT_TRUE( stats.highWaterMark <= POOL_CAPACITY );
+    TEST_ASSERT_TRUE( takenCount > 0U );
+
+    /* No buffer was lost or linked twice: every buffer can be taken once,
+     * and then the pool is exhausted. */
+    for( index = 0U; index < POOL_CAPACITY; index++ )
+    {
+        pBuffer = OtaEventBufferPool_Get( &pool );
+        TEST_ASSERT_NOT_NULL( pBuffer );
+        TEST_ASSERT_FALSE( isTaken[ pBuffer - buffers ] );
+        isTaken[ pBuffer - buffers ] = true;
+    }
+
+    TEST_ASSERT_NULL( OtaEventBufferPool_Get( &pool ) );
+}
+
+/**
+ * @brief Times a get and a put of the pool against the semaphore and linear
+ * scan the OTA demos used before, from one thread and from
+ * #STRESS_THREAD_COUNT threads at once.
+ */
+void test_OtaEventBufferPool_GetPutThroughput( void )
+{
+    OtaEventBufferPoolStats_t stats = { 0 };
+    uint32_t threadCounts[ 2 ] = { 1U, STRESS_THREAD_COUNT };
+    uint32_t index = 0U;
+    long poolNs = 0L, semaphoreNs = 0L;
+
+    for( index = 0U; index < ( sizeof( threadCounts ) / sizeof( threadCounts[ 0 ] ) ); index++ )
+    {
+        poolNs = timeGetPut( poolBufferGet, poolBufferPut, threadCounts[ index ] );
+        semaphoreNs = timeGetPut( semaphoreBufferGet, semaphoreBufferPut, threadCounts[ index ] );
+
+        LogInfo( ( "%u thread(s): get and put took %ld ns from the pool, %ld ns with the semaphore and scan.",
+                   ( unsigned ) threadCounts[ index ],
+                   poolNs,
+                   semaphoreNs ) );
+    }
+
+    OtaEventBufferPool_GetStats( &pool, &stats );
+    TEST_ASSERT_EQUAL_UINT32( 0U, stats.inUseCount );
+    TEST_ASSERT_EQUAL_UINT32( 0U, stats.exhaustedCount );
+}
@@ -0,0 +1,810 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ota_pal_posix_test.c
+ * @brief Tests of the POSIX OTA PAL, receiving images signed by a code signer
+ * generated for the test into files of the working directory.
+ */
+
+/* Standard header includes. */
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+
+/* POSIX includes. */
+#include <unistd.h>
+#include <sys/resource.h>
+
+/* OpenSSL includes. */
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+
+/* Include config file before other non-system includes. */
+#include "test_config.h"
+
+/* Unity testing framework includes. */
+#include "unity.h"
+
+/* Include the POSIX OTA PAL. */
+#include "ota_pal_posix.h"
+
+/**
+ * @brief Size of the buffers of the write-behind queue of the PAL, which the
+ * tests build with its default configuration.
+ */
+#ifndef OTA_PAL_WRITE_BUFFER_SIZE
+    #define OTA_PAL_WRITE_BUFFER_SIZE    ( 4096U )
+#endif
+
+/**
+ * @brief File the images are received into.
+ */
+#define IMAGE_FILE_NAME                 "ota_pal_test_image.bin"
+
+/**
+ * @brief File of the certificate of the code signer.
+ */
+#define SIGNER_CERT_FILE_NAME           "ota_pal_test_signer.crt"
+
+/**
+ * @brief Size of the images of the tests.
+ */
+#define TEST_IMAGE_SIZE                 ( 64U * 1024U )
+
+/**
+ * @brief Size of the blocks of the images of the tests.
+ */
+#define TEST_BLOCK_SIZE                 ( 1024U )
+
+/**
+ * @brief Number of blocks of the images of the tests.
+ */
+#define TEST_BLOCK_COUNT                ( TEST_IMAGE_SIZE / TEST_BLOCK_SIZE )
+
+/**
+ * @brief Step between the indexes of blocks received out of order. It has no
+ * common factor with #TEST_BLOCK_COUNT, so every block is received once.
+ */
+#define OUT_OF_ORDER_STEP               ( 7U )
+
+/**
+ * @brief Largest file the process may write in the failed write tests.
+ */
+#define FAILED_WRITE_FILE_SIZE_LIMIT    ( 16U * 1024U )
+
+/**
+ * @brief Size of the images of the benchmark.
+ */
+#define BENCHMARK_IMAGE_SIZE            ( 16U * 1024U * 1024U )
+
+/**
+ * @brief Number of image sizes of the close latency benchmark.
+ */
+#define CLOSE_BENCHMARK_SIZE_COUNT      ( 4U )
+
+/**
+ * @brief Size of the blocks of the close latency benchmark.
+ */
+#define CLOSE_BENCHMARK_BLOCK_SIZE      ( 4096U )
+
+/**
+ * @brief Nanoseconds per microsecond.
+ */
+#define NANOSECONDS_PER_MICROSECOND     ( 1000L )
+
+/**
+ * @brief Microseconds per second.
+ */
+#define MICROSECONDS_PER_SECOND         ( 1000000L )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Key of the code signer, generated by the first test.
+ */
+static EVP_PKEY * pSignerKey = NULL;
+
+/**
+ * @brief The image of the tests.
+ */
+static uint8_t testImage[ TEST_IMAGE_SIZE ];
+
+/**
+ * @brief Signature of the image received.
+ */
+static Sig_t imageSignature;
+
+/**
+ * @brief OTA file context of the image received.
+ */
+static OtaFileContext_t fileContext;
+
+/**
+ * @brief File size limit of the process before the test.
+ */
+static struct rlimit fileSizeLimit;
+
+/**
+ * @brief Image sizes of the close latency benchmark, from 1 MB to 512 MB.
+ */
+static const uint32_t closeBenchmarkSizes[ CLOSE_BENCHMARK_SIZE_COUNT ] =
+{
+    1U * 1024U * 1024U,
+    8U * 1024U * 1024U,
+    64U * 1024U * 1024U,
+    512U * 1024U * 1024U
+};
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Generate a P-256 code signer, and write its self-signed certificate
+ * to #SIGNER_CERT_FILE_NAME.
+ *
+ * @return The key of the signer, NULL on failure.
+ */
+static EVP_PKEY * createSigner( void );
+
+/**
+ * @brief Sign an image with #pSignerKey, as the code signing service does:
+ * an ECDSA signature of its SHA-256 digest.
+ *
+ * @param[in] pImage The image.
+ * @param[in] imageSize Size of @p pImage.
+ * @param[out] pSignature The signature.
+ */
+static void signImage( const uint8_t * pImage,
+                       size_t imageSize,
+                       Sig_t * pSignature );
+
+/**
+ * @brief Create the receive file of #fileContext.
+ *
+ * @param[in] fileSize Size of the image, used to reserve storage; 0 if the
+ * storage must not be reserved.
+ */
+static void createReceiveFile( uint32_t fileSize );
+
+/**
+ * @brief Write the blocks of an image to the receive file.
+ *
+ * @param[in] pImage The image.
+ * @param[in] imageSize Size of @p pImage, a multiple of @p blockSize.
+ * @param[in] blockSize Size of the blocks.
+ * @param[in] step Step between the indexes of consecutive blocks written, with
+ * no common factor with the number of blocks; 1 to write them in order.
+ */
+static void writeImage( const uint8_t * pImage,
+                        uint32_t imageSize,
+                        uint32_t blockSize,
+                        uint32_t step );
+
+/**
+ * @brief Check that the file received holds an image.
+ *
+ * @param[in] pImage The image.
+ * @param[in] imageSize Size of @p pImage.
+ */
+static void checkReceivedFile( const uint8_t * pImage,
+                               size_t imageSize );
+
+/**
+ * @brief Receive an image in blocks of a size, and report the blocks written
+ * per second.
+ *
+ * @param[in] pImage The image, of #BENCHMARK_IMAGE_SIZE bytes.
+ * @param[in] pSignature The signature of @p pImage.
+ * @param[in] blockSize Size of the blocks.
+ */
+static void benchmarkBlockSize( uint8_t * pImage,
+                                Sig_t * pSignature,
+                                uint32_t blockSize );
+
+/**
+ * @brief Receive an image, and measure how long closing the file takes.
+ *
+ * @param[in] pImage The image.
+ * @param[in] imageSize Size of @p pImage, a multiple of
+ * #CLOSE_BENCHMARK_BLOCK_SIZE.
+ * @param[in] pSignature The signature of @p pImage.
+ * @param[in] step Step between the indexes of consecutive blocks received.
+ *
+ * @return The microseconds otaPal_CloseFile took.
+ */
+static long measureCloseLatency( uint8_t * pImage,
+                                 uint32_t imageSize,
+                                 Sig_t * pSignature,
+                                 uint32_t step );
+
+/**
+ * @brief Microseconds elapsed since a time.
+ *
+ * @param[in] pStart The time.
+ *
+ * @return The microseconds elapsed since @p pStart.
+ */
+static long microsecondsSince( const struct timespec * pStart );
+
+/*-----------------------------------------------------------*/
+
+static EVP_PKEY * createSigner( void )
+{
+    EVP_PKEY * pKey = NULL;
+    EVP_PKEY_CTX * pKeyContext = NULL;
+    X509 * pCert = NULL;
+    X509_NAME * pName = NULL;
+    FILE * pCertFile = NULL;
+    bool isCreated = false;
+
+    pKeyContext = EVP_PKEY_CTX_new_id( EVP_PKEY_EC, NULL );
+
+    if( ( pKeyContext != NULL ) &&
+        ( 1 == EVP_PKEY_keygen_init( pKeyContext ) ) &&
+        ( 1 == EVP_PKEY_CTX_set_ec_paramgen_curve_nid( pKeyContext, NID_X9_62_prime256v1 ) ) &&
+        ( 1 == EVP_PKEY_keygen( pKeyContext, &pKey ) ) )
+    {
+        pCert = X509_new();
+    }
+
+    if( pCert != NULL )
+    {
+        pName = X509_get_subject_name( pCert );
+
+        if( ( 1 == X509_set_version( pCert, 2 ) ) &&
+            ( 1 == ASN1_INTEGER_set( X509_get_serialNumber( pCert ), 1 ) ) &&
+            ( NULL != X509_gmtime_adj( X509_getm_notBefore( pCert ), 0 ) ) &&
+            ( NULL != X509_gmtime_adj( X509_getm_notAfter( pCert ), 3600L ) ) &&
+            ( 1 == X509_NAME_add_entry_by_txt( pName, "CN", MBSTRING_ASC,
+                                               ( const unsigned char * ) "OTA PAL test signer", -1, -1, 0 ) ) &&
+            ( 1 == X509_set_issuer_name( pCert, pName ) ) &&
+            ( 1 == X509_set_pubkey( pCert, pKey ) ) &&
+            ( 0 < X509_sign( pCert, pKey, EVP_sha256() ) ) )
+        {
+            pCertFile = fopen( SIGNER_CERT_FILE_NAME, "w" );
+        }
+    }
+
+    if( pCertFile != NULL )
+    {
+        isCreated = ( 1 == PEM_write_X509( pCertFile, pCert ) );
+        isCreated = ( fclose( pCertFile ) == 0 ) && isCreated;
+    }
+
+    if( isCreated == false )
+    {
+        EVP_PKEY_free( pKey );
+        pKey = NULL;
+    }
+
+    X509_free( pCert );
+    EVP_PKEY_CTX_free( pKeyContext );
+
+    return pKey;
+}
+
+/*-----------------------------------------------------------*/
+
+static void signImage( const uint8_t * pImage,
+                       size_t imageSize,
+                       Sig_t * pSignature )
+{
+    EVP_PKEY_CTX * pSignContext = NULL;
+    uint8_t digest[ EVP_MAX_MD_SIZE ];
+    unsigned int digestLength = 0U;
+    size_t signatureLength = sizeof( pSignature->data );
+
+    TEST_ASSERT_EQUAL( 1, EVP_Digest( pImage, imageSize, digest, &digestLength, EVP_sha256(), NULL ) );
+
+    pSignContext = EVP_PKEY_CTX_new( pSignerKey, NULL );
+    TEST_ASSERT_NOT_NULL( pSignContext );
+    TEST_ASSERT_EQUAL( 1, EVP_PKEY_sign_init( pSignContext ) );
+    TEST_ASSERT_EQUAL( 1, EVP_PKEY_CTX_set_signature_md( pSignContext, EVP_sha256() ) );
+    TEST_ASSERT_EQUAL( 1, EVP_PKEY_sign( pSignContext, pSignature->data, &signatureLength, digest, digestLength ) );
+    EVP_PKEY_CTX_free( pSignContext );
+
+    pSignature->size = ( uint16_t ) signatureLength;
+}
+
+/*-----------------------------------------------------------*/
+
+static void createReceiveFile( uint32_t fileSize )
+{
+    OtaPalStatus_t status;
+
+    ( void ) memset( &fileContext, 0, sizeof( fileContext ) );
+    fileContext.pFilePath = ( uint8_t * ) IMAGE_FILE_NAME;
+    fileContext.pCertFilepath = ( uint8_t * ) SIGNER_CERT_FILE_NAME;
+    fileContext.fileSize = fileSize;
+    fileContext.pSignature = &imageSignature;
+
+    status = otaPal_CreateFileForRx( &fileContext );
+    TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( status ) );
+    TEST_ASSERT_NOT_NULL( fileContext.pFile );
+}
+
+/*-----------------------------------------------------------*/
+
+static void writeImage( const uint8_t * pImage,
+                        uint32_t imageSize,
+                        uint32_t blockSize,
+                        uint32_t step )
+{
+    uint32_t blockCount = imageSize / blockSize;
+    uint32_t blockIndex = 0U;
+    uint32_t index = 0U;
+
+    for( index = 0U; index < blockCount; index++ )
+    {
+        blockIndex = ( index * step ) % blockCount;
+        TEST_ASSERT_EQUAL( ( int16_t ) blockSize,
+                           otaPal_WriteBlock( &fileContext,
+                                              blockIndex * blockSize,
+                                              ( uint8_t * ) &pImage[ blockIndex * blockSize ],
+                                              blockSize ) );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void checkReceivedFile( const uint8_t * pImage,
+                               size_t imageSize )
+{
+    FILE * pFile = NULL;
+    uint8_t * pContents = NULL;
+
+    pContents = malloc( imageSize + 1U );
+    TEST_ASSERT_NOT_NULL( pContents );
+
+    pFile = fopen( IMAGE_FILE_NAME, "rb" );
+    TEST_ASSERT_NOT_NULL( pFile );
+
+    /* Reading one more byte than the image checks the size of the file. */
+    TEST_ASSERT_EQUAL( imageSize, fread( pContents, 1U, imageSize + 1U, pFile ) );
+    TEST_ASSERT_EQUAL( 0, fclose( pFile ) );
+    TEST_ASSERT_EQUAL_MEMORY( pImage, pContents, imageSize );
+
+    free( pContents );
+}
+
+/*-----------------------------------------------------------*/
+
+static void benchmarkBlockSize( uint8_t * pImage,
+                                Sig_t * pSignature,
+                                uint32_t blockSize )
+{
+    struct timespec start;
+    long writeUs = 0L;
+    long totalUs = 0L;
+    OtaPalStatus_t status;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+
+    createReceiveFile( BENCHMARK_IMAGE_SIZE );
+    fileContext.pSignature = pSignature;
+    writeImage( pImage, BENCHMARK_IMAGE_SIZE, blockSize, 1U );
+    writeUs = microsecondsSince( &start );
+
+    status = otaPal_CloseFile( &fileContext );
+    totalUs = microsecondsSince( &start );
+    TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( status ) );
+
+    LogInfo( ( "%u byte blocks: %.0f blocks/s written, %.0f blocks/s including closing the file.",
+               ( unsigned ) blockSize,
+               ( double ) ( BENCHMARK_IMAGE_SIZE / blockSize ) * MICROSECONDS_PER_SECOND / ( double ) writeUs,
+               ( double ) ( BENCHMARK_IMAGE_SIZE / blockSize ) * MICROSECONDS_PER_SECOND / ( double ) totalUs ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static long measureCloseLatency( uint8_t * pImage,
+                                 uint32_t imageSize,
+                                 Sig_t * pSignature,
+                                 uint32_t step )
+{
+    struct timespec start;
+    long closeUs = 0L;
+    OtaPalStatus_t status;
+
+    createReceiveFile( imageSize );
+    fileContext.pSignature = pSignature;
+    writeImage( pImage, imageSize, CLOSE_BENCHMARK_BLOCK_SIZE, step );
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+    status = otaPal_CloseFile( &fileContext );
+    closeUs = microsecondsSince( &start );
+    TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( status ) );
+
+    return closeUs;
+}
+
+/*-----------------------------------------------------------*/
+
+static long microsecondsSince( const struct timespec * pStart )
+{
+    struct timespec end;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &end );
+
+    return ( ( end.tv_sec - pStart->tv_sec ) * MICROSECONDS_PER_SECOND ) +
+           ( ( end.tv_nsec - pStart->tv_nsec ) / NANOSECONDS_PER_MICROSECOND );
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    uint32_t index = 0U;
+
+    if( pSignerKey == NULL )
+    {
+        pSignerKey = createSigner();
+        TEST_ASSERT_NOT_NULL( pSignerKey );
+    }
+
+    srand( 1U );
+
+    for( index = 0U; index < TEST_IMAGE_SIZE; index++ )
+    {
+        testImage[ index ] = ( uint8_t ) rand();
+    }
+
+    signImage( testImage, TEST_IMAGE_SIZE, &imageSignature );
+    ( void ) memset( &fileContext, 0, sizeof( fileContext ) );
+
+    TEST_ASSERT_EQUAL( 0, getrlimit( RLIMIT_FSIZE, &fileSizeLimit ) );
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+    ( void ) setrlimit( RLIMIT_FSIZE, &fileSizeLimit );
+
+    if( fileContext.pFile != NULL )
+    {
+        ( void ) otaPal_Abort( &fileContext );
+    }
+
+    ( void ) unlink( IMAGE_FILE_NAME );
+}
+
+/* ========================== Test Cases ============================ */
+
+/**
+ * @brief Receives the blocks of an image in order, and reads the file back.
+ */
+void test_OtaPal_InOrderBlocks( void )
+{
+    createReceiveFile( TEST_IMAGE_SIZE );
+    writeImage( testImage, TEST_IMAGE_SIZE, TEST_BLOCK_SIZE, 1U );
+
+    TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CloseFile( &fileContext ) ) );
+    TEST_ASSERT_NULL( fileContext.pFile );
+
+    checkReceivedFile( testImage, TEST_IMAGE_SIZE );
+}
+
+/**
+ * @brief Receives the blocks of an image out of order, without reserving the
+ * storage of the file, and reads the file back.
+ */
+void test_OtaPal_OutOfOrderBlocks( void )
+{
+    createReceiveFile( 0U );
+    writeImage( testImage, TEST_IMAGE_SIZE, TEST_BLOCK_SIZE, OUT_OF_ORDER_STEP );
+
+    TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CloseFile( &fileContext ) ) );
+
+    checkReceivedFile( testImage, TEST_IMAGE_SIZE );
+}
+
+/**
+ * @brief Receives a block larger than a buffer of the write-behind queue,
+ * which is written on the caller's thread, over a stale block still queued.
+ */
+void test_OtaPal_BlockLargerThanWriteBuffer( void )
+{
+    uint32_t largeBlockOffset = 2U * TEST_BLOCK_SIZE;
+    uint32_t largeBlockSize = ( 3U * OTA_PAL_WRITE_BUFFER_SIZE ) + TEST_BLOCK_SIZE;
+    uint32_t offset = 0U;
+    uint8_t staleBlock[ TEST_BLOCK_SIZE ];
+
+    ( void ) memset( staleBlock, 0xA5, sizeof( staleBlock ) );
+
+    createReceiveFile( TEST_IMAGE_SIZE );
+
+    /* The blocks queued before the large block must be written before it,
+     * or the stale block would overwrite part of it. */
+    for( offset = 0U; offset < largeBlockOffset; offset += TEST_BLOCK_SIZE )
+    {
+        TEST_ASSERT_EQUAL( TEST_BLOCK_SIZE, otaPal_WriteBlock( &fileContext, offset, &testImage[ offset ], TEST_BLOCK_SIZE ) );
+    }
+
+    TEST_ASSERT_EQUAL( TEST_BLOCK_SIZE, otaPal_WriteBlock( &fileContext, largeBlockOffset, staleBlock, TEST_BLOCK_SIZE ) );
+    TEST_ASSERT_EQUAL( ( int16_t ) largeBlockSize,
+                       otaPal_WriteBlock( &fileContext, largeBlockOffset, &testImage[ largeBlockOffset ], largeBlockSize ) );
+
+    for( offset = largeBlockOffset + largeBlockSize; offset < TEST_IMAGE_SIZE; offset += TEST_BLOCK_SIZE )
+    {
+        TEST_ASSERT_EQUAL( TEST_BLOCK_SIZE, otaPal_WriteBlock( &fileContext, offset, &testImage[ offset ], TEST_BLOCK_SIZE ) );
+    }
+
+    TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CloseFile( &fileContext ) ) );
+
+    checkReceivedFile( testImage, TEST_IMAGE_SIZE );
+}
+
+/**
+ * @brief Fails to write a queued block, past the file size limit of the
+ * process, and checks that the failure is returned by a later
+ * otaPal_WriteBlock and by otaPal_CloseFile.
+ */
+void test_OtaPal_FailedWriteSurfacesFromNextWriteBlock( void )
+{
+    struct rlimit limit = fileSizeLimit;
+    uint32_t offset = 0U;
+    int16_t result = 0;
+    OtaPalStatus_t status;
+
+    /* Writes past the limit fail with EFBIG instead of raising SIGXFSZ. */
+    ( void ) signal( SIGXFSZ, SIG_IGN );
+    limit.rlim_cur = FAILED_WRITE_FILE_SIZE_LIMIT;
+    TEST_ASSERT_EQUAL( 0, setrlimit( RLIMIT_FSIZE, &limit ) );
+
+    /* The storage is not reserved, so that the limit is reached when the
+     * blocks are written. */
+    createReceiveFile( 0U );
+
+    for( offset = 0U; offset <= FAILED_WRITE_FILE_SIZE_LIMIT; offset += TEST_BLOCK_SIZE )
+    {
+        TEST_ASSERT_EQUAL( TEST_BLOCK_SIZE, otaPal_WriteBlock( &fileContext, offset, &testImage[ offset ], TEST_BLOCK_SIZE ) );
+    }
+
+    /* Once the queue is full, otaPal_WriteBlock waits for the failed block to
+     * be written, so the failure is returned before the end of the image. */
+    while( ( result >= 0 ) && ( offset < TEST_IMAGE_SIZE ) )
+    {
+        result = otaPal_WriteBlock( &fileContext, offset, &testImage[ offset ], TEST_BLOCK_SIZE );
+        offset += TEST_BLOCK_SIZE;
+    }
+
+    TEST_ASSERT_EQUAL( -1, result );
+
+    TEST_ASSERT_EQUAL( 0, setrlimit( RLIMIT_FSIZE, &fileSizeLimit ) );
+    status = otaPal_CloseFile( &fileContext );
+    TEST_ASSERT_EQUAL( OtaPalFileClose, OTA_PAL_MAIN_ERR( status ) );
+    TEST_ASSERT_EQUAL( EFBIG, OTA_PAL_SUB_ERR( status ) );
+    TEST_ASSERT_NULL( fileContext.pFile );
+}
+
+/**
+ * @brief Fails to write the last queued block, past the file size limit of
+ * the process, and checks that the failure is returned by otaPal_CloseFile.
+ */
+void test_OtaPal_FailedWriteSurfacesFromCloseFile( void )
+{
+    struct rlimit limit = fileSizeLimit;
+    uint32_t offset = 0U;
+    OtaPalStatus_t status;
+
+    ( void ) signal( SIGXFSZ, SIG_IGN );
+    limit.rlim_cur = FAILED_WRITE_FILE_SIZE_LIMIT;
+    TEST_ASSERT_EQUAL( 0, setrlimit( RLIMIT_FSIZE, &limit ) );
+
+    createReceiveFile( 0U );
+
+    /* Only the last block is past the limit, so no block written before it
+     * fails. */
+    for( offset = 0U; offset <= FAILED_WRITE_FILE_SIZE_LIMIT; offset += TEST_BLOCK_SIZE )
+    {
+        TEST_ASSERT_EQUAL( TEST_BLOCK_SIZE, otaPal_WriteBlock( &fileContext, offset, &testImage[ offset ], TEST_BLOCK_SIZE ) );
+    }
+
+    status = otaPal_CloseFile( &fileContext );
+    TEST_ASSERT_EQUAL( OtaPalFileClose, OTA_PAL_MAIN_ERR( status ) );
+    TEST_ASSERT_EQUAL( EFBIG, OTA_PAL_SUB_ERR( status ) );
+    TEST_ASSERT_NULL( fileContext.pFile );
+}
+
+/**
+ * @brief Aborts a file with blocks still queued, and checks that the next
+ * file is received whole.
+ */
+void test_OtaPal_AbortDiscardsQueuedBlocks( void )
+{
+    createReceiveFile( TEST_IMAGE_SIZE );
+    writeImage( testImage, TEST_IMAGE_SIZE / 2U, TEST_BLOCK_SIZE, 1U );
+
+    TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_Abort( &fileContext ) ) );
+    TEST_ASSERT_NULL( fileContext.pFile );
+
+    createReceiveFile( TEST_IMAGE_SIZE );
+    writeImage( testImage, TEST_IMAGE_SIZE, TEST_BLOCK_SIZE, 1U );
+
+    TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CloseFile( &fileContext ) ) );
+
+    checkReceivedFile( testImage, TEST_IMAGE_SIZE );
+}
+
+/**
+ * @brief Measures the blocks written per second for 1 KB and 4 KB blocks.
+ */
+void test_OtaPal_BlocksPerSecond( void )
+{
+    uint8_t * pImage = NULL;
+    Sig_t signature;
+    uint32_t index = 0U;
+
+    pImage = malloc( BENCHMARK_IMAGE_SIZE );
+    TEST_ASSERT_NOT_NULL( pImage );
+
+    for( index = 0U; index < BENCHMARK_IMAGE_SIZE; index++ )
+    {
+        pImage[ index ] = ( uint8_t ) rand();
+    }
+
+    signImage( pImage, BENCHMARK_IMAGE_SIZE, &signature );
+
+    benchmarkBlockSize( pImage, &signature, 1024U );
+    benchmarkBlockSize( pImage, &signature, 4096U );
+
+    free( pImage );
+}
+
+/**
+ * @brief Verifies a correctly signed image received in order into a file
+ * preallocated to its size. The received blocks then cover the whole file, so
+ * the digest computed as they were received is used.
+ */
+void test_OtaPal_SignedImageInOrder( void )
+{
+    createReceiveFile( TEST_IMAGE_SIZE );
+    writeImage( testImage, TEST_IMAGE_SIZE, TEST_BLOCK_SIZE, 1U );
+
+    TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CloseFile( &fileContext ) ) );
+}
+
+/**
+ * @brief Verifies a correctly signed image received out of order, which is
+ * hashed through mmap when the file is closed.
+ */
+void test_OtaPal_SignedImageOutOfOrder( void )
+{
+    createReceiveFile( TEST_IMAGE_SIZE );
+    writeImage( testImage, TEST_IMAGE_SIZE, TEST_BLOCK_SIZE, OUT_OF_ORDER_STEP );
+
+    TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CloseFile( &fileContext ) ) );
+}
+
+/**
+ * @brief Rejects a tampered image received in order, hashed as its blocks are
+ * received.
+ */
+void test_OtaPal_TamperedImageInOrder( void )
+{
+    testImage[ TEST_IMAGE_SIZE / 2U ] ^= 0x01U;
+
+    createReceiveFile( TEST_IMAGE_SIZE );
+    writeImage( testImage, TEST_IMAGE_SIZE, TEST_BLOCK_SIZE, 1U );
+
+    TEST_ASSERT_EQUAL( OtaPalSignatureCheckFailed, OTA_PAL_MAIN_ERR( otaPal_CloseFile( &fileContext ) ) );
+}
+
+/**
+ * @brief Rejects a tampered image received out of order, hashed through mmap
+ * when the file is closed.
+ */
+void test_OtaPal_TamperedImageOutOfOrder( void )
+{
+    testImage[ TEST_IMAGE_SIZE / 2U ] ^= 0x01U;
+
+    createReceiveFile( TEST_IMAGE_SIZE );
+    writeImage( testImage, TEST_IMAGE_SIZE, TEST_BLOCK_SIZE, OUT_OF_ORDER_STEP );
+
+    TEST_ASSERT_EQUAL( OtaPalSignatureCheckFailed, OTA_PAL_MAIN_ERR( otaPal_CloseFile( &fileContext ) ) );
+}
+
+/**
+ * @brief Checks that the digest of the received blocks is only used when they
+ * cover the whole preallocated file: an image received in order into a file
+ * reserved for a larger one is hashed with the unwritten tail, and rejected.
+ */
+void test_OtaPal_PreallocatedFileLargerThanBlocks( void )
+{
+    uint8_t * pImage = NULL;
+    Sig_t signature;
+
+    /* The signer signs the image followed by the zeroes of the reserved but
+     * unwritten tail, so that only the file, not the blocks, match. */
+    pImage = calloc( 1U, TEST_IMAGE_SIZE + TEST_BLOCK_SIZE );
+    TEST_ASSERT_NOT_NULL( pImage );
+    ( void ) memcpy( pImage, testImage, TEST_IMAGE_SIZE );
+    signImage( pImage, TEST_IMAGE_SIZE + TEST_BLOCK_SIZE, &signature );
+
+    createReceiveFile( TEST_IMAGE_SIZE + TEST_BLOCK_SIZE );
+    fileContext.pSignature = &signature;
+    writeImage( testImage, TEST_IMAGE_SIZE, TEST_BLOCK_SIZE, 1U );
+
+    TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CloseFile( &fileContext ) ) );
+    checkReceivedFile( pImage, TEST_IMAGE_SIZE + TEST_BLOCK_SIZE );
+
+    /* The signature of the blocks alone does not match the file. */
+    createReceiveFile( TEST_IMAGE_SIZE + TEST_BLOCK_SIZE );
+    writeImage( testImage, TEST_IMAGE_SIZE, TEST_BLOCK_SIZE, 1U );
+
+    TEST_ASSERT_EQUAL( OtaPalSignatureCheckFailed, OTA_PAL_MAIN_ERR( otaPal_CloseFile( &fileContext ) ) );
+
+    free( pImage );
+}
+
+/**
+ * @brief Measures how long closing the file takes for images of 1 MB to
+ * 512 MB, received in order and out of order.
+ */
+void test_OtaPal_CloseLatency( void )
+{
+    uint8_t * pImage = NULL;
+    uint32_t * pWords = NULL;
+    uint32_t state = 1U;
+    uint32_t imageSize = 0U;
+    uint32_t index = 0U;
+    Sig_t signature;
+    long inOrderUs = 0L;
+    long outOfOrderUs = 0L;
+
+    pImage = malloc( closeBenchmarkSizes[ CLOSE_BENCHMARK_SIZE_COUNT - 1U ] );
+    TEST_ASSERT_NOT_NULL( pImage );
+
+    /* A xorshift generator fills the image faster than rand(). */
+    pWords = ( uint32_t * ) pImage;
+
+    for( index = 0U; index < ( closeBenchmarkSizes[ CLOSE_BENCHMARK_SIZE_COUNT - 1U ] / sizeof( uint32_t ) ); index++ )
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        pWords[ index ] = state;
+    }
+
+    for( index = 0U; index < CLOSE_BENCHMARK_SIZE_COUNT; index++ )
+    {
+        imageSize = closeBenchmarkSizes[ index ];
+        signImage( pImage, imageSize, &signature );
+
+        inOrderUs = measureCloseLatency( pImage, imageSize, &signature, 1U );
+        outOfOrderUs = measureCloseLatency( pImage, imageSize, &signature, OUT_OF_ORDER_STEP );
+
+        LogInfo( ( "%u MB image: closed in %ld us received in order, %ld us received out of order.",
+                   ( unsigned ) ( imageSize / ( 1024U * 1024U ) ),
+                   inOrderUs,
+                   outOfOrderUs ) );
+    }
+
+    free( pImage );
+}
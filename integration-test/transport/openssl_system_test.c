@@ -0,0 +1,1567 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file openssl_system_test.c
+ * @brief Integration tests for the SSL context and TLS session caches, for
+ * the receive buffer and for the coalescing writev of the OpenSSL transport,
+ * against a TLS server running in the test process.
+ */
+
+/* Standard header includes. */
+#include <string.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+/* POSIX includes. */
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/* OpenSSL includes. */
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+#include <openssl/pem.h>
+
+/* Include config file before other non-system includes. */
+#include "test_config.h"
+
+/* Unity testing framework includes. */
+#include "unity.h"
+
+/* Include OpenSSL implementation of transport interface. */
+#include "openssl_posix.h"
+
+/**
+ * @brief Number of handshakes timed with and without a cached SSL context,
+ * and with and without session resumption.
+ */
+#define HANDSHAKE_ITERATIONS           ( 50U )
+
+/**
+ * @brief Receive timeout of the client while the server stalls a handshake.
+ */
+#define STALLED_HANDSHAKE_TIMEOUT_MS   ( 200U )
+
+/**
+ * @brief Time the server holds a stalled connection before closing it,
+ * longer than #STALLED_HANDSHAKE_TIMEOUT_MS.
+ */
+#define STALLED_CONNECTION_US          ( 500000U )
+
+/**
+ * @brief Byte the server sends after each handshake. Reading it makes the
+ * client process the session tickets that a TLS 1.3 server sends after the
+ * handshake, as reading the first response of a protocol would.
+ */
+#define SERVER_GREETING                ( 'G' )
+
+/**
+ * @brief Template of the directory holding the credential files of a test.
+ */
+#define TEST_DIRECTORY_TEMPLATE        "/tmp/openssl_system_test_XXXXXX"
+
+/**
+ * @brief Length of the host name of the local server.
+ */
+#define SERVER_HOST_LENGTH             ( sizeof( SERVER_HOST ) - 1U )
+
+/**
+ * @brief Size of the receive buffer in the tests of reads that do not line
+ * up with the TLS records, smaller than the records sent.
+ */
+#define SMALL_RECV_BUFFER_SIZE         ( 64U )
+
+/**
+ * @brief Size of the receive buffer in the throughput benchmark, as in the
+ * mutual authentication MQTT demo.
+ */
+#define DEMO_RECV_BUFFER_SIZE          ( 512U )
+
+/**
+ * @brief Largest TLS record the server sends in the throughput benchmark.
+ */
+#define MAX_RECORD_LENGTH              ( 16384U )
+
+/**
+ * @brief Number of bytes of MQTT packets the server sends in the throughput
+ * benchmark, for each packet size.
+ */
+#define THROUGHPUT_STREAM_LENGTH       ( 2U * 1024U * 1024U )
+
+/**
+ * @brief Length of the fixed header of a PUBLISH with a remaining length
+ * below 128, and below 2097152.
+ */
+#define SHORT_FIXED_HEADER_LENGTH      ( 2U )
+#define LONG_FIXED_HEADER_LENGTH       ( 4U )
+
+/**
+ * @brief Size of the stack buffer Openssl_Writev coalesces buffers into, the
+ * default of the transport.
+ */
+#ifndef OPENSSL_WRITEV_BUFFER_SIZE
+    #define OPENSSL_WRITEV_BUFFER_SIZE    ( 2048U )
+#endif
+
+/**
+ * @brief Number of bytes sent by the client the server keeps, for the tests
+ * to check.
+ */
+#define SERVER_RECEIVED_SIZE           ( 4096U )
+
+/**
+ * @brief Byte the server sends to acknowledge every #serverAckLength bytes
+ * received.
+ */
+#define SERVER_ACK                     ( 'A' )
+
+/**
+ * @brief Number and length of the buffers of the test sending more buffers
+ * than the plaintext transport takes in one writev.
+ */
+#define MANY_VECTOR_COUNT              ( 20U )
+#define MANY_VECTOR_LENGTH             ( 3U )
+
+/**
+ * @brief Number of PUBLISH packets sent in each mode of the send benchmark.
+ */
+#define PUBLISH_COUNT                  ( 200U )
+
+/**
+ * @brief Lengths of the buffers coreMQTT sends a QoS 0 PUBLISH in: the fixed
+ * header with the length of the topic, the topic, then the payload.
+ */
+#define PUBLISH_HEADER_LENGTH          ( 4U )
+#define PUBLISH_TOPIC_LENGTH           ( 20U )
+#define PUBLISH_PAYLOAD_LENGTH         ( 100U )
+#define PUBLISH_LENGTH                 ( PUBLISH_HEADER_LENGTH + PUBLISH_TOPIC_LENGTH + PUBLISH_PAYLOAD_LENGTH )
+
+/**
+ * @brief Number of nanoseconds in a microsecond.
+ */
+#define NANOSECONDS_PER_MICROSECOND    ( 1000L )
+
+/**
+ * @brief Number of microseconds in a second.
+ */
+#define MICROSECONDS_PER_SECOND        ( 1000000L )
+
+/*-----------------------------------------------------------*/
+
+/* Each compilation unit must define the NetworkContext struct. */
+struct NetworkContext
+{
+    OpensslParams_t * pParams;
+};
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Directory holding the credential files of a test.
+ */
+static char testDirectory[ sizeof( TEST_DIRECTORY_TEMPLATE ) ];
+
+/**
+ * @brief Path of the root CA file passed to the transport.
+ */
+static char rootCaPath[ sizeof( TEST_DIRECTORY_TEMPLATE "/root_ca.pem" ) ];
+
+/**
+ * @brief Certificate and key of the local server.
+ */
+static X509 * pServerCertificate = NULL;
+static EVP_PKEY * pServerKey = NULL;
+
+/**
+ * @brief Listening socket and port of the local server.
+ */
+static int serverSocket = -1;
+static uint16_t serverPort = 0U;
+
+/**
+ * @brief Thread accepting TLS connections on #serverSocket.
+ */
+static pthread_t serverThread;
+
+/**
+ * @brief Set to stop #serverThread.
+ */
+static volatile bool stopServer = false;
+
+/**
+ * @brief Set to make the server hold the next connection for
+ * #STALLED_CONNECTION_US without answering, then close it. Cleared by the
+ * server when it does.
+ */
+static volatile bool stallNextConnection = false;
+
+/**
+ * @brief Send and receive timeout of the client.
+ */
+static uint32_t clientTimeoutMs = TRANSPORT_SEND_RECV_TIMEOUT_MS;
+
+/**
+ * @brief Highest TLS version the server negotiates; 0 for the highest
+ * supported.
+ */
+static volatile int serverMaxVersion = 0;
+
+/**
+ * @brief TLS versions the session resumption tests run with: session IDs
+ * with TLS 1.2, and session tickets with TLS 1.3.
+ */
+static const int resumptionVersions[] = { TLS1_2_VERSION, TLS1_3_VERSION };
+
+/**
+ * @brief Bytes the server sends after #SERVER_GREETING, in TLS records of
+ * #serverRecordLength bytes. Set before connecting; none if NULL.
+ */
+static uint8_t * pServerStream = NULL;
+static size_t serverStreamLength = 0U;
+static size_t serverRecordLength = MAX_RECORD_LENGTH;
+
+/**
+ * @brief Number of bytes after which the server acknowledges with
+ * #SERVER_ACK; 0 for never. Set before connecting.
+ */
+static size_t serverAckLength = 0U;
+
+/**
+ * @brief TLS records the server received on the last connection, and the
+ * first #SERVER_RECEIVED_SIZE bytes they carried. Read once
+ * #serverConnectionCount has counted the connection.
+ */
+static volatile uint32_t serverRecordCount = 0U;
+static uint8_t serverReceived[ SERVER_RECEIVED_SIZE ];
+static size_t serverReceivedLength = 0U;
+
+/**
+ * @brief Number of connections the server has closed.
+ */
+static volatile uint32_t serverConnectionCount = 0U;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Creates a self-signed certificate issued to #SERVER_HOST.
+ *
+ * @param[out] ppKey The key of the certificate.
+ *
+ * @return The certificate; NULL on failure.
+ */
+static X509 * createCertificate( EVP_PKEY ** ppKey );
+
+/**
+ * @brief Writes a certificate to a file in PEM format, replacing the contents
+ * of the file without changing its inode.
+ *
+ * @param[in] pPath Path of the file.
+ * @param[in] pCertificate The certificate to write.
+ * @param[in] paddingLength Number of bytes of text to write ahead of the
+ * certificate, which the PEM reader skips.
+ *
+ * @return The size of the file.
+ */
+static long writeCertificate( const char * pPath,
+                              X509 * pCertificate,
+                              long paddingLength );
+
+/**
+ * @brief Accepts TLS connections until #stopServer is set, and sends
+ * #SERVER_GREETING then #pServerStream after each handshake. Then counts
+ * the records the client sends until it closes the connection.
+ *
+ * @param[in] pArgument Server SSL context.
+ *
+ * @return NULL.
+ */
+static void * serverTask( void * pArgument );
+
+/**
+ * @brief Connects to the local server with #rootCaPath as the trusted root,
+ * and reads #SERVER_GREETING before disconnecting.
+ *
+ * @param[in] enableSessionResumption Value of
+ * #OpensslCredentials_t.enableSessionResumption.
+ * @param[out] pElapsedUs Duration of #Openssl_Connect in microseconds; may be
+ * NULL.
+ * @param[out] pSessionResumed #OpensslParams_t.sessionResumed of the
+ * connection; may be NULL.
+ *
+ * @return The status returned by #Openssl_Connect.
+ */
+static OpensslStatus_t connectToServer( uint8_t enableSessionResumption,
+                                        long * pElapsedUs,
+                                        uint8_t * pSessionResumed );
+
+/**
+ * @brief Connects to the local server with a receive buffer, and reads
+ * #SERVER_GREETING, leaving #pServerStream to be read.
+ *
+ * @param[out] pNetworkContext The network context of the connection.
+ * @param[in] pRecvBuffer The receive buffer; NULL for none.
+ * @param[in] recvBufferSize The size of @p pRecvBuffer.
+ *
+ * @return true if the greeting was received; the connection must then be
+ * closed with #Openssl_Disconnect.
+ */
+static bool openStream( NetworkContext_t * pNetworkContext,
+                        uint8_t * pRecvBuffer,
+                        size_t recvBufferSize );
+
+/**
+ * @brief Receives exactly a number of bytes, calling #Openssl_Recv again for
+ * the rest while it returns fewer.
+ *
+ * @param[in] pNetworkContext The network context of the connection.
+ * @param[out] pBuffer The buffer to fill.
+ * @param[in] length The number of bytes to receive.
+ *
+ * @return true if the bytes were received; false on a transport error, if a
+ * call returned more than requested, or after
+ * #TRANSPORT_SEND_RECV_TIMEOUT_MS without data.
+ */
+static bool receiveExactly( NetworkContext_t * pNetworkContext,
+                            uint8_t * pBuffer,
+                            size_t length );
+
+/**
+ * @brief Receives #pServerStream with calls to #Openssl_Recv of the given
+ * sizes, used in turn, and checks the bytes received.
+ *
+ * @param[in] pNetworkContext The network context of the connection.
+ * @param[in] pReadSizes The sizes of the reads.
+ * @param[in] readSizeCount The number of sizes in @p pReadSizes.
+ *
+ * @return The number of bytes of #pServerStream received intact before the
+ * first mismatch or error.
+ */
+static size_t receiveStream( NetworkContext_t * pNetworkContext,
+                             const size_t * pReadSizes,
+                             size_t readSizeCount );
+
+/**
+ * @brief Fills #pServerStream with PUBLISH packets of the same size.
+ *
+ * @param[in] packetLength The length of a packet, including its fixed
+ * header.
+ *
+ * @return The number of packets.
+ */
+static size_t fillStreamWithPackets( size_t packetLength );
+
+/**
+ * @brief Receives the packets of #fillStreamWithPackets as coreMQTT reads
+ * them: the packet type, then the remaining length one byte at a time, then
+ * the rest of the packet.
+ *
+ * @param[in] recvBufferSize The size of the receive buffer; 0 for none.
+ * @param[in] packetLength The length of a packet.
+ * @param[in] packetCount The number of packets.
+ *
+ * @return The throughput in kilobytes per second.
+ */
+static long receivePackets( size_t recvBufferSize,
+                            size_t packetLength,
+                            size_t packetCount );
+
+/**
+ * @brief Receives the records the client sends on a connection, keeping
+ * their count and their first bytes, and acknowledges every
+ * #serverAckLength bytes.
+ *
+ * @param[in] pSsl The connection.
+ */
+static void receiveRecords( SSL * pSsl );
+
+/**
+ * @brief Waits for the server to close a connection.
+ *
+ * @param[in] connectionCount The value of #serverConnectionCount before the
+ * connection was closed by the client.
+ *
+ * @return true if the server closed it within
+ * #TRANSPORT_SEND_RECV_TIMEOUT_MS.
+ */
+static bool waitForServer( uint32_t connectionCount );
+
+/**
+ * @brief Send buffers as coreMQTT does: with #Openssl_Writev, or with one
+ * #Openssl_Send per buffer when there is no writev, calling again for the
+ * rest until every byte is sent. The buffers are updated as they are sent.
+ *
+ * @param[in] pNetworkContext The network context of the connection.
+ * @param[in] pIoVec The buffers.
+ * @param[in] ioVecCount The number of buffers.
+ * @param[in] useWritev true to send with #Openssl_Writev.
+ *
+ * @return true if every byte was sent.
+ */
+static bool sendVectors( NetworkContext_t * pNetworkContext,
+                         TransportOutVector_t * pIoVec,
+                         size_t ioVecCount,
+                         bool useWritev );
+
+/**
+ * @brief Sends #PUBLISH_COUNT PUBLISH packets, each after the server
+ * acknowledged the one before, and measures the round trips.
+ *
+ * @param[in] useWritev true to send with #Openssl_Writev.
+ * @param[out] pAverageUs The average round trip in microseconds.
+ * @param[out] pMaxUs The longest round trip in microseconds.
+ *
+ * @return The number of TLS records sent per PUBLISH.
+ */
+static double benchmarkSendMode( bool useWritev,
+                                 long * pAverageUs,
+                                 long * pMaxUs );
+
+/*-----------------------------------------------------------*/
+
+static X509 * createCertificate( EVP_PKEY ** ppKey )
+{
+    X509 * pCertificate = X509_new();
+    X509_NAME * pName = NULL;
+    X509_EXTENSION * pExtension = NULL;
+    X509V3_CTX extensionContext;
+
+    *ppKey = EVP_EC_gen( "P-256" );
+    TEST_ASSERT_NOT_NULL( *ppKey );
+    TEST_ASSERT_NOT_NULL( pCertificate );
+
+    /* Random serial numbers keep the two roots of a test distinct. */
+    ( void ) ASN1_INTEGER_set( X509_get_serialNumber( pCertificate ), rand() );
+    ( void ) X509_gmtime_adj( X509_getm_notBefore( pCertificate ), -60L );
+    ( void ) X509_gmtime_adj( X509_getm_notAfter( pCertificate ), 3600L );
+    ( void ) X509_set_pubkey( pCertificate, *ppKey );
+
+    pName = X509_get_subject_name( pCertificate );
+    ( void ) X509_NAME_add_entry_by_txt( pName, "CN", MBSTRING_ASC,
+                                         ( const unsigned char * ) SERVER_HOST,
+                                         -1, -1, 0 );
+    ( void ) X509_set_issuer_name( pCertificate, pName );
+
+    X509V3_set_ctx( &extensionContext, pCertificate, pCertificate, NULL, NULL, 0 );
+    pExtension = X509V3_EXT_conf_nid( NULL, &extensionContext, NID_subject_alt_name,
+                                      "DNS:" SERVER_HOST );
+    TEST_ASSERT_NOT_NULL( pExtension );
+    ( void ) X509_add_ext( pCertificate, pExtension, -1 );
+    X509_EXTENSION_free( pExtension );
+
+    TEST_ASSERT_NOT_EQUAL( 0, X509_sign( pCertificate, *ppKey, EVP_sha256() ) );
+
+    return pCertificate;
+}
+
+/*-----------------------------------------------------------*/
+
+static long writeCertificate( const char * pPath,
+                              X509 * pCertificate,
+                              long paddingLength )
+{
+    FILE * pFile = NULL;
+    long index = 0L, fileSize = 0L;
+
+    /* "r+" rewrites the file in place, so that only its contents change. */
+    pFile = fopen( pPath, "r+" );
+
+    if( pFile == NULL )
+    {
+        pFile = fopen( pPath, "w" );
+    }
+
+    TEST_ASSERT_NOT_NULL( pFile );
+
+    for( index = 0L; index < paddingLength; index++ )
+    {
+        ( void ) fputc( ( index == ( paddingLength - 1L ) ) ? '\n' : '#', pFile );
+    }
+
+    TEST_ASSERT_EQUAL( 1, PEM_write_X509( pFile, pCertificate ) );
+    fileSize = ftell( pFile );
+    TEST_ASSERT_EQUAL( 0, ftruncate( fileno( pFile ), fileSize ) );
+    TEST_ASSERT_EQUAL( 0, fclose( pFile ) );
+
+    return fileSize;
+}
+
+/*-----------------------------------------------------------*/
+
+static void * serverTask( void * pArgument )
+{
+    SSL_CTX * pContext = ( SSL_CTX * ) pArgument;
+    SSL * pSsl = NULL;
+    int clientSocket = -1;
+    char greeting = SERVER_GREETING;
+    size_t sentLength = 0U, recordLength = 0U;
+    bool isSent = false;
+
+    while( stopServer == false )
+    {
+        clientSocket = accept( serverSocket, NULL, NULL );
+
+        if( ( clientSocket >= 0 ) && ( stallNextConnection == true ) )
+        {
+            stallNextConnection = false;
+            ( void ) usleep( STALLED_CONNECTION_US );
+            ( void ) close( clientSocket );
+        }
+        else if( clientSocket >= 0 )
+        {
+            pSsl = SSL_new( pContext );
+            ( void ) SSL_set_fd( pSsl, clientSocket );
+
+            if( serverMaxVersion != 0 )
+            {
+                ( void ) SSL_set_max_proto_version( pSsl, serverMaxVersion );
+            }
+
+            /* The handshake fails when the client rejects the certificate. */
+            isSent = ( ( SSL_accept( pSsl ) == 1 ) &&
+                       ( SSL_write( pSsl, &greeting, 1 ) == 1 ) );
+
+            /* Each SSL_write sends one record. */
+            for( sentLength = 0U; ( isSent == true ) && ( sentLength < serverStreamLength ); sentLength += recordLength )
+            {
+                recordLength = serverStreamLength - sentLength;
+                recordLength = ( recordLength < serverRecordLength ) ? recordLength : serverRecordLength;
+                isSent = ( SSL_write( pSsl, &pServerStream[ sentLength ], ( int ) recordLength ) == ( int ) recordLength );
+            }
+
+            if( isSent == true )
+            {
+                /* Wait for the client to close the connection, so that it
+                 * reads the greeting before the connection is reset. */
+                receiveRecords( pSsl );
+                ( void ) SSL_shutdown( pSsl );
+            }
+
+            SSL_free( pSsl );
+            ( void ) close( clientSocket );
+            serverConnectionCount++;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+    }
+
+    SSL_CTX_free( pContext );
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static OpensslStatus_t connectToServer( uint8_t enableSessionResumption,
+                                        long * pElapsedUs,
+                                        uint8_t * pSessionResumed )
+{
+    OpensslStatus_t opensslStatus = OPENSSL_SUCCESS;
+    NetworkContext_t networkContext = { 0 };
+    OpensslParams_t opensslParams = { 0 };
+    OpensslCredentials_t opensslCredentials = { 0 };
+    ServerInfo_t serverInfo = { 0 };
+    struct timespec start, end;
+    char greeting = '\0';
+    int32_t bytesReceived = 0;
+
+    opensslCredentials.pRootCaPath = rootCaPath;
+    opensslCredentials.sniHostName = SERVER_HOST;
+    opensslCredentials.enableSessionResumption = enableSessionResumption;
+
+    serverInfo.pHostName = SERVER_HOST;
+    serverInfo.hostNameLength = SERVER_HOST_LENGTH;
+    serverInfo.port = serverPort;
+
+    networkContext.pParams = &opensslParams;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+    opensslStatus = Openssl_Connect( &networkContext,
+                                     &serverInfo,
+                                     &opensslCredentials,
+                                     clientTimeoutMs,
+                                     clientTimeoutMs );
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &end );
+
+    if( pElapsedUs != NULL )
+    {
+        *pElapsedUs = ( ( end.tv_sec - start.tv_sec ) * MICROSECONDS_PER_SECOND ) +
+                      ( ( end.tv_nsec - start.tv_nsec ) / NANOSECONDS_PER_MICROSECOND );
+    }
+
+    if( pSessionResumed != NULL )
+    {
+        *pSessionResumed = opensslParams.sessionResumed;
+    }
+
+    if( opensslStatus == OPENSSL_SUCCESS )
+    {
+        /* Openssl_Recv returns 0 until the greeting has arrived. */
+        do
+        {
+            bytesReceived = Openssl_Recv( &networkContext, &greeting, 1U );
+        } while( bytesReceived == 0 );
+
+        /* Disconnect before asserting, so that the server is not left
+         * waiting for the connection to close. */
+        ( void ) Openssl_Disconnect( &networkContext );
+        TEST_ASSERT_EQUAL( 1, bytesReceived );
+        TEST_ASSERT_EQUAL( SERVER_GREETING, greeting );
+    }
+
+    return opensslStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool openStream( NetworkContext_t * pNetworkContext,
+                        uint8_t * pRecvBuffer,
+                        size_t recvBufferSize )
+{
+    OpensslParams_t * pOpensslParams = pNetworkContext->pParams;
+    OpensslCredentials_t opensslCredentials = { 0 };
+    ServerInfo_t serverInfo = { 0 };
+    uint8_t greeting = 0U;
+    bool isOpen = false;
+
+    opensslCredentials.pRootCaPath = rootCaPath;
+    opensslCredentials.sniHostName = SERVER_HOST;
+
+    serverInfo.pHostName = SERVER_HOST;
+    serverInfo.hostNameLength = SERVER_HOST_LENGTH;
+    serverInfo.port = serverPort;
+
+    pOpensslParams->pRecvBuffer = pRecvBuffer;
+    pOpensslParams->recvBufferSize = recvBufferSize;
+
+    if( Openssl_Connect( pNetworkContext,
+                         &serverInfo,
+                         &opensslCredentials,
+                         TRANSPORT_SEND_RECV_TIMEOUT_MS,
+                         TRANSPORT_SEND_RECV_TIMEOUT_MS ) == OPENSSL_SUCCESS )
+    {
+        isOpen = ( ( receiveExactly( pNetworkContext, &greeting, 1U ) == true ) &&
+                   ( greeting == ( uint8_t ) SERVER_GREETING ) );
+
+        if( isOpen == false )
+        {
+            ( void ) Openssl_Disconnect( pNetworkContext );
+        }
+    }
+
+    return isOpen;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool receiveExactly( NetworkContext_t * pNetworkContext,
+                            uint8_t * pBuffer,
+                            size_t length )
+{
+    struct timespec start, now;
+    size_t receivedLength = 0U;
+    int32_t bytesReceived = 0;
+    bool isReceiving = true;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+
+    while( ( isReceiving == true ) && ( receivedLength < length ) )
+    {
+        bytesReceived = Openssl_Recv( pNetworkContext,
+                                      &pBuffer[ receivedLength ],
+                                      length - receivedLength );
+
+        if( ( bytesReceived > 0 ) && ( ( size_t ) bytesReceived <= ( length - receivedLength ) ) )
+        {
+            receivedLength += ( size_t ) bytesReceived;
+        }
+        else if( bytesReceived == 0 )
+        {
+            /* Openssl_Recv returns 0 until data has arrived. */
+            ( void ) clock_gettime( CLOCK_MONOTONIC, &now );
+            isReceiving = ( ( now.tv_sec - start.tv_sec ) * 1000L ) <= TRANSPORT_SEND_RECV_TIMEOUT_MS;
+        }
+        else
+        {
+            isReceiving = false;
+        }
+    }
+
+    return isReceiving;
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t receiveStream( NetworkContext_t * pNetworkContext,
+                             const size_t * pReadSizes,
+                             size_t readSizeCount )
+{
+    uint8_t buffer[ 1024 ];
+    size_t receivedLength = 0U, readSize = 0U, readIndex = 0U;
+    bool isIntact = true;
+
+    while( ( isIntact == true ) && ( receivedLength < serverStreamLength ) )
+    {
+        readSize = pReadSizes[ readIndex % readSizeCount ];
+        readSize = ( readSize < ( serverStreamLength - receivedLength ) ) ? readSize : ( serverStreamLength - receivedLength );
+        readIndex++;
+
+        isIntact = ( ( readSize <= sizeof( buffer ) ) &&
+                     ( receiveExactly( pNetworkContext, buffer, readSize ) == true ) &&
+                     ( memcmp( buffer, &pServerStream[ receivedLength ], readSize ) == 0 ) );
+
+        if( isIntact == true )
+        {
+            receivedLength += readSize;
+        }
+    }
+
+    return receivedLength;
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t fillStreamWithPackets( size_t packetLength )
+{
+    size_t packetCount = THROUGHPUT_STREAM_LENGTH / packetLength;
+    size_t headerLength = ( packetLength < 128U ) ? SHORT_FIXED_HEADER_LENGTH : LONG_FIXED_HEADER_LENGTH;
+    size_t remainingLength = packetLength - headerLength;
+    size_t index = 0U;
+    uint8_t * pPacket = NULL;
+
+    serverStreamLength = packetCount * packetLength;
+    pServerStream = malloc( serverStreamLength );
+    TEST_ASSERT_NOT_NULL( pServerStream );
+
+    for( index = 0U; index < serverStreamLength; index++ )
+    {
+        pServerStream[ index ] = ( uint8_t ) ( index % 251U );
+    }
+
+    for( index = 0U; index < packetCount; index++ )
+    {
+        pPacket = &pServerStream[ index * packetLength ];
+        pPacket[ 0 ] = 0x30U;
+
+        if( headerLength == SHORT_FIXED_HEADER_LENGTH )
+        {
+            pPacket[ 1 ] = ( uint8_t ) remainingLength;
+        }
+        else
+        {
+            pPacket[ 1 ] = ( uint8_t ) ( ( remainingLength & 0x7FU ) | 0x80U );
+            pPacket[ 2 ] = ( uint8_t ) ( ( ( remainingLength >> 7 ) & 0x7FU ) | 0x80U );
+            pPacket[ 3 ] = ( uint8_t ) ( remainingLength >> 14 );
+        }
+    }
+
+    return packetCount;
+}
+
+/*-----------------------------------------------------------*/
+
+static long receivePackets( size_t recvBufferSize,
+                            size_t packetLength,
+                            size_t packetCount )
+{
+    static uint8_t recvBuffer[ DEMO_RECV_BUFFER_SIZE ];
+    NetworkContext_t networkContext = { 0 };
+    OpensslParams_t opensslParams = { 0 };
+    struct timespec start, end;
+    uint8_t * pPacket = NULL;
+    size_t packetIndex = 0U, remainingLength = 0U, headerLength = 0U;
+    uint32_t multiplier = 1U;
+    bool isIntact = true;
+    long elapsedUs = 0L;
+
+    pPacket = malloc( packetLength );
+    TEST_ASSERT_NOT_NULL( pPacket );
+
+    networkContext.pParams = &opensslParams;
+    TEST_ASSERT_TRUE( openStream( &networkContext,
+                                  ( recvBufferSize > 0U ) ? recvBuffer : NULL,
+                                  recvBufferSize ) );
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+
+    for( packetIndex = 0U; ( isIntact == true ) && ( packetIndex < packetCount ); packetIndex++ )
+    {
+        isIntact = receiveExactly( &networkContext, &pPacket[ 0 ], 1U );
+        headerLength = 1U;
+        remainingLength = 0U;
+        multiplier = 1U;
+
+        do
+        {
+            isIntact = ( isIntact == true ) &&
+                       ( headerLength < LONG_FIXED_HEADER_LENGTH ) &&
+                       ( receiveExactly( &networkContext, &pPacket[ headerLength ], 1U ) == true );
+            remainingLength += ( size_t ) ( pPacket[ headerLength ] & 0x7FU ) * multiplier;
+            multiplier *= 128U;
+            headerLength++;
+        } while( ( isIntact == true ) && ( ( pPacket[ headerLength - 1U ] & 0x80U ) != 0U ) );
+
+        isIntact = ( isIntact == true ) &&
+                   ( ( headerLength + remainingLength ) == packetLength ) &&
+                   ( receiveExactly( &networkContext, &pPacket[ headerLength ], remainingLength ) == true ) &&
+                   ( memcmp( pPacket, &pServerStream[ packetIndex * packetLength ], packetLength ) == 0 );
+    }
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &end );
+
+    /* Disconnect before asserting, so that the server is not left waiting
+     * for the connection to close. */
+    ( void ) Openssl_Disconnect( &networkContext );
+    free( pPacket );
+    TEST_ASSERT_TRUE_MESSAGE( isIntact, "A packet was lost or corrupted." );
+
+    elapsedUs = ( ( end.tv_sec - start.tv_sec ) * MICROSECONDS_PER_SECOND ) +
+                ( ( end.tv_nsec - start.tv_nsec ) / NANOSECONDS_PER_MICROSECOND );
+
+    return ( long ) ( ( ( double ) serverStreamLength * ( double ) MICROSECONDS_PER_SECOND ) /
+                      ( ( double ) elapsedUs * 1024.0 ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static void receiveRecords( SSL * pSsl )
+{
+    static uint8_t record[ MAX_RECORD_LENGTH ];
+    char ack = SERVER_ACK;
+    size_t pendingLength = 0U, copyLength = 0U;
+    int readLength = 0;
+    bool isOpen = true;
+
+    serverRecordCount = 0U;
+    serverReceivedLength = 0U;
+
+    while( isOpen == true )
+    {
+        /* Each SSL_read returns the data of at most one record. */
+        readLength = SSL_read( pSsl, record, ( int ) sizeof( record ) );
+        isOpen = ( readLength > 0 );
+
+        if( isOpen == true )
+        {
+            serverRecordCount++;
+
+            copyLength = sizeof( serverReceived ) - serverReceivedLength;
+            copyLength = ( ( size_t ) readLength < copyLength ) ? ( size_t ) readLength : copyLength;
+            ( void ) memcpy( &serverReceived[ serverReceivedLength ], record, copyLength );
+            serverReceivedLength += copyLength;
+
+            pendingLength += ( size_t ) readLength;
+
+            while( ( isOpen == true ) && ( serverAckLength > 0U ) && ( pendingLength >= serverAckLength ) )
+            {
+                pendingLength -= serverAckLength;
+                isOpen = ( SSL_write( pSsl, &ack, 1 ) == 1 );
+            }
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static bool waitForServer( uint32_t connectionCount )
+{
+    struct timespec start, now;
+    bool isWaiting = true;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+
+    while( ( isWaiting == true ) && ( serverConnectionCount == connectionCount ) )
+    {
+        ( void ) usleep( 1000U );
+        ( void ) clock_gettime( CLOCK_MONOTONIC, &now );
+        isWaiting = ( ( now.tv_sec - start.tv_sec ) * 1000L ) <= TRANSPORT_SEND_RECV_TIMEOUT_MS;
+    }
+
+    return( serverConnectionCount != connectionCount );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool sendVectors( NetworkContext_t * pNetworkContext,
+                         TransportOutVector_t * pIoVec,
+                         size_t ioVecCount,
+                         bool useWritev )
+{
+    int32_t bytesSent = 0;
+    size_t index = 0U, remainingLength = 0U;
+    bool isSending = true;
+
+    while( ( isSending == true ) && ( index < ioVecCount ) )
+    {
+        if( useWritev == true )
+        {
+            bytesSent = Openssl_Writev( pNetworkContext, &pIoVec[ index ], ioVecCount - index );
+        }
+        else
+        {
+            bytesSent = Openssl_Send( pNetworkContext, pIoVec[ index ].iov_base, pIoVec[ index ].iov_len );
+        }
+
+        isSending = ( bytesSent >= 0 );
+        remainingLength = ( isSending == true ) ? ( size_t ) bytesSent : 0U;
+
+        /* Skip the buffers sent, then the part sent of the next one. */
+        while( ( index < ioVecCount ) && ( remainingLength >= pIoVec[ index ].iov_len ) )
+        {
+            remainingLength -= pIoVec[ index ].iov_len;
+            index++;
+        }
+
+        if( index < ioVecCount )
+        {
+            pIoVec[ index ].iov_base = &( ( const uint8_t * ) pIoVec[ index ].iov_base )[ remainingLength ];
+            pIoVec[ index ].iov_len -= remainingLength;
+        }
+    }
+
+    return isSending;
+}
+
+/*-----------------------------------------------------------*/
+
+static double benchmarkSendMode( bool useWritev,
+                                 long * pAverageUs,
+                                 long * pMaxUs )
+{
+    NetworkContext_t networkContext = { 0 };
+    OpensslParams_t opensslParams = { 0 };
+    TransportOutVector_t ioVec[ 3 ];
+    uint8_t publish[ PUBLISH_LENGTH ];
+    uint8_t ack = 0U;
+    struct timespec start, end;
+    uint32_t publishIndex = 0U, connectionCount = serverConnectionCount;
+    long elapsedUs = 0L, totalUs = 0L;
+    bool isIntact = true;
+
+    ( void ) memset( publish, 0xA5, sizeof( publish ) );
+    publish[ 0 ] = 0x30U;
+    publish[ 1 ] = ( uint8_t ) ( PUBLISH_LENGTH - 2U );
+    publish[ 2 ] = 0U;
+    publish[ 3 ] = ( uint8_t ) PUBLISH_TOPIC_LENGTH;
+
+    serverAckLength = PUBLISH_LENGTH;
+    networkContext.pParams = &opensslParams;
+    TEST_ASSERT_TRUE( openStream( &networkContext, NULL, 0U ) );
+    *pMaxUs = 0L;
+
+    for( publishIndex = 0U; ( isIntact == true ) && ( publishIndex < PUBLISH_COUNT ); publishIndex++ )
+    {
+        ioVec[ 0 ].iov_base = publish;
+        ioVec[ 0 ].iov_len = PUBLISH_HEADER_LENGTH;
+        ioVec[ 1 ].iov_base = &publish[ PUBLISH_HEADER_LENGTH ];
+        ioVec[ 1 ].iov_len = PUBLISH_TOPIC_LENGTH;
+        ioVec[ 2 ].iov_base = &publish[ PUBLISH_HEADER_LENGTH + PUBLISH_TOPIC_LENGTH ];
+        ioVec[ 2 ].iov_len = PUBLISH_PAYLOAD_LENGTH;
+
+        ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+
+        /* The server acknowledges each PUBLISH once it has all of it. */
+        isIntact = ( ( sendVectors( &networkContext, ioVec, 3U, useWritev ) == true ) &&
+                     ( receiveExactly( &networkContext, &ack, 1U ) == true ) &&
+                     ( ack == ( uint8_t ) SERVER_ACK ) );
+
+        ( void ) clock_gettime( CLOCK_MONOTONIC, &end );
+
+        elapsedUs = ( ( end.tv_sec - start.tv_sec ) * MICROSECONDS_PER_SECOND ) +
+                    ( ( end.tv_nsec - start.tv_nsec ) / NANOSECONDS_PER_MICROSECOND );
+        totalUs += elapsedUs;
+
+        if( elapsedUs > *pMaxUs )
+        {
+            *pMaxUs = elapsedUs;
+        }
+    }
+
+    /* Disconnect before asserting, so that the server is not left waiting
+     * for the connection to close. */
+    ( void ) Openssl_Disconnect( &networkContext );
+    TEST_ASSERT_TRUE_MESSAGE( isIntact, "A PUBLISH was not sent or acknowledged." );
+    TEST_ASSERT_TRUE( waitForServer( connectionCount ) );
+
+    *pAverageUs = totalUs / ( long ) PUBLISH_COUNT;
+
+    return ( double ) serverRecordCount / ( double ) PUBLISH_COUNT;
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    SSL_CTX * pServerContext = NULL;
+    struct sockaddr_in serverAddress = { 0 };
+    socklen_t addressLength = sizeof( serverAddress );
+
+    ( void ) strcpy( testDirectory, TEST_DIRECTORY_TEMPLATE );
+    TEST_ASSERT_NOT_NULL( mkdtemp( testDirectory ) );
+    ( void ) snprintf( rootCaPath, sizeof( rootCaPath ), "%s/root_ca.pem", testDirectory );
+
+    /* The server presents a self-signed certificate, used as the root CA. */
+    pServerCertificate = createCertificate( &pServerKey );
+    ( void ) writeCertificate( rootCaPath, pServerCertificate, 0L );
+
+    pServerContext = SSL_CTX_new( TLS_server_method() );
+    TEST_ASSERT_NOT_NULL( pServerContext );
+    TEST_ASSERT_EQUAL( 1, SSL_CTX_use_certificate( pServerContext, pServerCertificate ) );
+    TEST_ASSERT_EQUAL( 1, SSL_CTX_use_PrivateKey( pServerContext, pServerKey ) );
+
+    /* Listen on an ephemeral port of the loopback interface. */
+    serverSocket = socket( AF_INET, SOCK_STREAM, 0 );
+    TEST_ASSERT_NOT_EQUAL( -1, serverSocket );
+    serverAddress.sin_family = AF_INET;
+    serverAddress.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+    TEST_ASSERT_EQUAL( 0, bind( serverSocket, ( struct sockaddr * ) &serverAddress, sizeof( serverAddress ) ) );
+    TEST_ASSERT_EQUAL( 0, listen( serverSocket, 16 ) );
+    TEST_ASSERT_EQUAL( 0, getsockname( serverSocket, ( struct sockaddr * ) &serverAddress, &addressLength ) );
+    serverPort = ntohs( serverAddress.sin_port );
+
+    stopServer = false;
+    stallNextConnection = false;
+    serverMaxVersion = 0;
+    clientTimeoutMs = TRANSPORT_SEND_RECV_TIMEOUT_MS;
+    pServerStream = NULL;
+    serverStreamLength = 0U;
+    serverRecordLength = MAX_RECORD_LENGTH;
+    serverAckLength = 0U;
+    TEST_ASSERT_EQUAL( 0, pthread_create( &serverThread, NULL, serverTask, pServerContext ) );
+
+    /* Start every test without cached contexts. */
+    Openssl_ClearContextCache();
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+    /* Shutting down the listening socket wakes up the blocked accept. */
+    stopServer = true;
+    ( void ) shutdown( serverSocket, SHUT_RDWR );
+    ( void ) pthread_join( serverThread, NULL );
+    ( void ) close( serverSocket );
+
+    Openssl_ClearContextCache();
+
+    X509_free( pServerCertificate );
+    EVP_PKEY_free( pServerKey );
+    free( pServerStream );
+    ( void ) unlink( rootCaPath );
+    ( void ) rmdir( testDirectory );
+}
+
+/* ========================== Test Cases ============================ */
+
+/**
+ * @brief Compares the duration of connections that build their SSL context
+ * (cold) with that of connections sharing the cached context (warm).
+ */
+void test_Openssl_Connect_WarmHandshakeUsesCachedContext( void )
+{
+    long coldTotalUs = 0L, warmTotalUs = 0L, elapsedUs = 0L;
+    uint32_t iteration = 0U;
+
+    for( iteration = 0U; iteration < HANDSHAKE_ITERATIONS; iteration++ )
+    {
+        Openssl_ClearContextCache();
+        TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, connectToServer( 0U, &elapsedUs, NULL ) );
+        coldTotalUs += elapsedUs;
+    }
+
+    /* The last cold connection left its context in the cache. */
+    for( iteration = 0U; iteration < HANDSHAKE_ITERATIONS; iteration++ )
+    {
+        TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, connectToServer( 0U, &elapsedUs, NULL ) );
+        warmTotalUs += elapsedUs;
+    }
+
+    LogInfo( ( "Average handshake over %u connections: cold %ld us, warm %ld us.",
+               ( unsigned int ) HANDSHAKE_ITERATIONS,
+               coldTotalUs / ( long ) HANDSHAKE_ITERATIONS,
+               warmTotalUs / ( long ) HANDSHAKE_ITERATIONS ) );
+
+    TEST_ASSERT_LESS_THAN( coldTotalUs, warmTotalUs );
+}
+
+/**
+ * @brief Replaces the root CA within the same second, keeping the size and
+ * inode of the file, and verifies that the cached context is not reused.
+ */
+void test_Openssl_Connect_RootCaReplacedWithinSameSecond( void )
+{
+    X509 * pOtherCertificate = NULL;
+    EVP_PKEY * pOtherKey = NULL;
+    struct stat trustedStat, replacedStat;
+    struct timespec times[ 2 ];
+    long trustedSize = 0L, otherSize = 0L;
+    int fileDescriptor = -1;
+
+    /* Cache the context trusting the server certificate. */
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, connectToServer( 0U, NULL, NULL ) );
+    TEST_ASSERT_EQUAL( 0, stat( rootCaPath, &trustedStat ) );
+    trustedSize = ( long ) trustedStat.st_size;
+
+    /* Measure the unrelated root, then pad the shorter of the two so that
+     * the replacement keeps the size of the file. */
+    pOtherCertificate = createCertificate( &pOtherKey );
+    otherSize = writeCertificate( rootCaPath, pOtherCertificate, 0L );
+
+    if( otherSize < trustedSize )
+    {
+        ( void ) writeCertificate( rootCaPath, pOtherCertificate, trustedSize - otherSize );
+    }
+    else
+    {
+        ( void ) writeCertificate( rootCaPath, pServerCertificate, otherSize - trustedSize );
+        TEST_ASSERT_EQUAL( 0, stat( rootCaPath, &trustedStat ) );
+        TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, connectToServer( 0U, NULL, NULL ) );
+        ( void ) writeCertificate( rootCaPath, pOtherCertificate, 0L );
+    }
+
+    /* Give the replacement the same second as the cached file. */
+    times[ 0 ] = trustedStat.st_atim;
+    times[ 1 ].tv_sec = trustedStat.st_mtim.tv_sec;
+    times[ 1 ].tv_nsec = ( trustedStat.st_mtim.tv_nsec + 1L ) % 1000000000L;
+    fileDescriptor = open( rootCaPath, O_RDONLY );
+    TEST_ASSERT_NOT_EQUAL( -1, fileDescriptor );
+    TEST_ASSERT_EQUAL( 0, futimens( fileDescriptor, times ) );
+    ( void ) close( fileDescriptor );
+
+    TEST_ASSERT_EQUAL( 0, stat( rootCaPath, &replacedStat ) );
+    TEST_ASSERT_EQUAL( trustedStat.st_mtime, replacedStat.st_mtime );
+    TEST_ASSERT_EQUAL( trustedStat.st_size, replacedStat.st_size );
+    TEST_ASSERT_EQUAL( trustedStat.st_ino, replacedStat.st_ino );
+
+    /* The server certificate is no longer trusted. */
+    TEST_ASSERT_EQUAL( OPENSSL_HANDSHAKE_FAILED, connectToServer( 0U, NULL, NULL ) );
+
+    X509_free( pOtherCertificate );
+    EVP_PKEY_free( pOtherKey );
+}
+
+/**
+ * @brief Connects twice with session resumption enabled, and verifies that
+ * the first connection performs a full handshake and the second resumes the
+ * session of the first.
+ */
+void test_Openssl_Connect_ResumesCachedSession( void )
+{
+    uint8_t sessionResumed = 1U;
+    size_t index = 0U;
+
+    for( index = 0U; index < ( sizeof( resumptionVersions ) / sizeof( resumptionVersions[ 0 ] ) ); index++ )
+    {
+        serverMaxVersion = resumptionVersions[ index ];
+        Openssl_ClearContextCache();
+
+        TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, connectToServer( 1U, NULL, &sessionResumed ) );
+        TEST_ASSERT_EQUAL( 0U, sessionResumed );
+
+        TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, connectToServer( 1U, NULL, &sessionResumed ) );
+        TEST_ASSERT_EQUAL( 1U, sessionResumed );
+
+        /* Connections without session resumption do not offer the session. */
+        TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, connectToServer( 0U, NULL, &sessionResumed ) );
+        TEST_ASSERT_EQUAL( 0U, sessionResumed );
+    }
+}
+
+/**
+ * @brief Times out a handshake that offers a cached session, and verifies
+ * that the session is discarded, so that the next connection performs a full
+ * handshake instead of offering it again.
+ *
+ * OpenSSL makes a session unresumable itself when it sends a fatal alert,
+ * but not when a handshake times out, so the timeout relies on the transport
+ * discarding the session.
+ */
+void test_Openssl_Connect_FailedResumptionDiscardsSession( void )
+{
+    uint8_t sessionResumed = 1U;
+    size_t index = 0U;
+
+    for( index = 0U; index < ( sizeof( resumptionVersions ) / sizeof( resumptionVersions[ 0 ] ) ); index++ )
+    {
+        serverMaxVersion = resumptionVersions[ index ];
+        Openssl_ClearContextCache();
+
+        TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, connectToServer( 1U, NULL, &sessionResumed ) );
+        TEST_ASSERT_EQUAL( 0U, sessionResumed );
+
+        /* The server does not answer while the session is offered. */
+        stallNextConnection = true;
+        clientTimeoutMs = STALLED_HANDSHAKE_TIMEOUT_MS;
+        TEST_ASSERT_NOT_EQUAL( OPENSSL_SUCCESS, connectToServer( 1U, NULL, &sessionResumed ) );
+        TEST_ASSERT_FALSE( stallNextConnection );
+        clientTimeoutMs = TRANSPORT_SEND_RECV_TIMEOUT_MS;
+
+        TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, connectToServer( 1U, NULL, &sessionResumed ) );
+        TEST_ASSERT_EQUAL( 0U, sessionResumed );
+
+        /* The full handshake cached a new session. */
+        TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, connectToServer( 1U, NULL, &sessionResumed ) );
+        TEST_ASSERT_EQUAL( 1U, sessionResumed );
+    }
+}
+
+/**
+ * @brief Compares the duration of full handshakes with that of resumed ones,
+ * both over the cached SSL context, for each TLS version.
+ */
+void test_Openssl_Connect_ResumedHandshakeIsFaster( void )
+{
+    long fullTotalUs = 0L, resumedTotalUs = 0L, elapsedUs = 0L;
+    uint8_t sessionResumed = 0U;
+    uint32_t iteration = 0U;
+    size_t index = 0U;
+
+    for( index = 0U; index < ( sizeof( resumptionVersions ) / sizeof( resumptionVersions[ 0 ] ) ); index++ )
+    {
+        serverMaxVersion = resumptionVersions[ index ];
+        Openssl_ClearContextCache();
+        fullTotalUs = 0L;
+        resumedTotalUs = 0L;
+
+        /* Cache the context and a session. */
+        TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, connectToServer( 1U, NULL, NULL ) );
+
+        for( iteration = 0U; iteration < HANDSHAKE_ITERATIONS; iteration++ )
+        {
+            TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, connectToServer( 0U, &elapsedUs, &sessionResumed ) );
+            TEST_ASSERT_EQUAL( 0U, sessionResumed );
+            fullTotalUs += elapsedUs;
+
+            TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, connectToServer( 1U, &elapsedUs, &sessionResumed ) );
+            TEST_ASSERT_EQUAL( 1U, sessionResumed );
+            resumedTotalUs += elapsedUs;
+        }
+
+        LogInfo( ( "Average %s handshake over %u connections: full %ld us, resumed %ld us.",
+                   ( serverMaxVersion == TLS1_2_VERSION ) ? "TLS 1.2" : "TLS 1.3",
+                   ( unsigned int ) HANDSHAKE_ITERATIONS,
+                   fullTotalUs / ( long ) HANDSHAKE_ITERATIONS,
+                   resumedTotalUs / ( long ) HANDSHAKE_ITERATIONS ) );
+
+        TEST_ASSERT_LESS_THAN( fullTotalUs, resumedTotalUs );
+    }
+}
+
+/**
+ * @brief Receives records larger than the receive buffer with reads of
+ * various sizes, so that records are split across refills of the buffer and
+ * reads span the end of the data buffered, and checks every byte.
+ */
+void test_Openssl_Recv_RecordSplitAcrossBuffer( void )
+{
+    static const size_t readSizes[] = { 1U, 2U, 5U, 13U, 1U, 1U, 40U };
+    static uint8_t recvBuffer[ SMALL_RECV_BUFFER_SIZE ];
+    NetworkContext_t networkContext = { 0 };
+    OpensslParams_t opensslParams = { 0 };
+    size_t receivedLength = 0U, index = 0U;
+
+    /* Records of 100 bytes do not line up with a 64-byte buffer. */
+    serverStreamLength = 1000U;
+    serverRecordLength = 100U;
+    pServerStream = malloc( serverStreamLength );
+    TEST_ASSERT_NOT_NULL( pServerStream );
+
+    for( index = 0U; index < serverStreamLength; index++ )
+    {
+        pServerStream[ index ] = ( uint8_t ) ( index % 251U );
+    }
+
+    networkContext.pParams = &opensslParams;
+    TEST_ASSERT_TRUE( openStream( &networkContext, recvBuffer, sizeof( recvBuffer ) ) );
+
+    receivedLength = receiveStream( &networkContext,
+                                    readSizes,
+                                    sizeof( readSizes ) / sizeof( readSizes[ 0 ] ) );
+
+    ( void ) Openssl_Disconnect( &networkContext );
+    TEST_ASSERT_EQUAL_UINT32( serverStreamLength, receivedLength );
+}
+
+/**
+ * @brief Requests more than the receive buffer holds, both while it holds
+ * data and once it is empty, and checks that the first read returns only the
+ * data buffered and the second reads past the buffer into that of the
+ * caller.
+ */
+void test_Openssl_Recv_ReadLargerThanBuffer( void )
+{
+    static const size_t readSizes[] = { 1U, 300U, 7U };
+    static uint8_t recvBuffer[ SMALL_RECV_BUFFER_SIZE ];
+    NetworkContext_t networkContext = { 0 };
+    OpensslParams_t opensslParams = { 0 };
+    uint8_t buffer[ 1000 ];
+    int32_t firstLength = 0, bufferedLength = 0, directLength = 0;
+    size_t receivedLength = 0U, index = 0U;
+
+    serverStreamLength = 4000U;
+    serverRecordLength = 1000U;
+    pServerStream = malloc( serverStreamLength );
+    TEST_ASSERT_NOT_NULL( pServerStream );
+
+    for( index = 0U; index < serverStreamLength; index++ )
+    {
+        pServerStream[ index ] = ( uint8_t ) ( index % 251U );
+    }
+
+    networkContext.pParams = &opensslParams;
+    TEST_ASSERT_TRUE( openStream( &networkContext, recvBuffer, sizeof( recvBuffer ) ) );
+
+    /* A 1-byte read fills the buffer from the first record. */
+    do
+    {
+        firstLength = Openssl_Recv( &networkContext, buffer, 1U );
+    } while( firstLength == 0 );
+
+    /* Served from the buffer: only the rest of the buffered data. */
+    bufferedLength = Openssl_Recv( &networkContext, &buffer[ 1 ], sizeof( buffer ) - 1U );
+
+    /* The buffer is empty: the rest of the first record, read straight into
+     * the buffer of the caller. */
+    if( bufferedLength == ( int32_t ) ( SMALL_RECV_BUFFER_SIZE - 1U ) )
+    {
+        directLength = Openssl_Recv( &networkContext, &buffer[ SMALL_RECV_BUFFER_SIZE ], sizeof( buffer ) - SMALL_RECV_BUFFER_SIZE );
+    }
+
+    /* Then the rest of the stream, from the start of the second record. */
+    serverStreamLength -= serverRecordLength;
+    ( void ) memmove( pServerStream, &pServerStream[ serverRecordLength ], serverStreamLength );
+    receivedLength = receiveStream( &networkContext,
+                                    readSizes,
+                                    sizeof( readSizes ) / sizeof( readSizes[ 0 ] ) );
+
+    ( void ) Openssl_Disconnect( &networkContext );
+
+    TEST_ASSERT_EQUAL( 1, firstLength );
+    TEST_ASSERT_EQUAL( SMALL_RECV_BUFFER_SIZE - 1U, bufferedLength );
+    TEST_ASSERT_EQUAL( 1000U - SMALL_RECV_BUFFER_SIZE, directLength );
+
+    for( index = 0U; index < sizeof( buffer ); index++ )
+    {
+        TEST_ASSERT_EQUAL_UINT8( ( uint8_t ) ( index % 251U ), buffer[ index ] );
+    }
+
+    TEST_ASSERT_EQUAL_UINT32( serverStreamLength, receivedLength );
+}
+
+/**
+ * @brief Compares the throughput of receiving 64-byte and 64-kilobyte
+ * PUBLISH packets the way coreMQTT reads them, with and without the receive
+ * buffer.
+ */
+void test_Openssl_Recv_BufferedThroughput( void )
+{
+    static const size_t packetLengths[] = { 64U, ( 64U * 1024U ) + LONG_FIXED_HEADER_LENGTH };
+    size_t packetCount = 0U, index = 0U;
+    long unbufferedKBps = 0L, bufferedKBps = 0L;
+
+    for( index = 0U; index < ( sizeof( packetLengths ) / sizeof( packetLengths[ 0 ] ) ); index++ )
+    {
+        packetCount = fillStreamWithPackets( packetLengths[ index ] );
+
+        unbufferedKBps = receivePackets( 0U, packetLengths[ index ], packetCount );
+        bufferedKBps = receivePackets( DEMO_RECV_BUFFER_SIZE, packetLengths[ index ], packetCount );
+
+        LogInfo( ( "%u packets of %u bytes: %ld KB/s unbuffered, %ld KB/s with a %u-byte receive buffer.",
+                   ( unsigned int ) packetCount,
+                   ( unsigned int ) packetLengths[ index ],
+                   unbufferedKBps,
+                   bufferedKBps,
+                   ( unsigned int ) DEMO_RECV_BUFFER_SIZE ) );
+
+        free( pServerStream );
+        pServerStream = NULL;
+        serverStreamLength = 0U;
+    }
+}
+
+/**
+ * @brief Sends more buffers than the plaintext transport takes in one
+ * writev, and checks that #Openssl_Writev sends them all in one record.
+ */
+void test_Openssl_Writev_ManyVectorsInOneRecord( void )
+{
+    NetworkContext_t networkContext = { 0 };
+    OpensslParams_t opensslParams = { 0 };
+    TransportOutVector_t ioVec[ MANY_VECTOR_COUNT ];
+    uint8_t data[ MANY_VECTOR_COUNT * MANY_VECTOR_LENGTH ];
+    uint32_t connectionCount = serverConnectionCount;
+    int32_t bytesSent = 0;
+    size_t index = 0U;
+
+    for( index = 0U; index < sizeof( data ); index++ )
+    {
+        data[ index ] = ( uint8_t ) index;
+    }
+
+    for( index = 0U; index < MANY_VECTOR_COUNT; index++ )
+    {
+        ioVec[ index ].iov_base = &data[ index * MANY_VECTOR_LENGTH ];
+        ioVec[ index ].iov_len = MANY_VECTOR_LENGTH;
+    }
+
+    networkContext.pParams = &opensslParams;
+    TEST_ASSERT_TRUE( openStream( &networkContext, NULL, 0U ) );
+
+    bytesSent = Openssl_Writev( &networkContext, ioVec, MANY_VECTOR_COUNT );
+
+    ( void ) Openssl_Disconnect( &networkContext );
+    TEST_ASSERT_TRUE( waitForServer( connectionCount ) );
+
+    TEST_ASSERT_EQUAL( sizeof( data ), bytesSent );
+    TEST_ASSERT_EQUAL_UINT32( 1U, serverRecordCount );
+    TEST_ASSERT_EQUAL( sizeof( data ), serverReceivedLength );
+    TEST_ASSERT_EQUAL_MEMORY( data, serverReceived, sizeof( data ) );
+}
+
+/**
+ * @brief Sends buffers adding up to more than #OPENSSL_WRITEV_BUFFER_SIZE,
+ * and checks that the first call fills one record, splitting the buffer
+ * that crosses the boundary, and that the rest follows in a second record.
+ */
+void test_Openssl_Writev_CoalescesAcrossBufferBoundary( void )
+{
+    static uint8_t data[ 2200U ];
+    NetworkContext_t networkContext = { 0 };
+    OpensslParams_t opensslParams = { 0 };
+    TransportOutVector_t ioVec[ 3 ];
+    uint32_t connectionCount = serverConnectionCount;
+    int32_t firstBytesSent = 0;
+    size_t index = 0U;
+    bool isSent = false;
+
+    for( index = 0U; index < sizeof( data ); index++ )
+    {
+        data[ index ] = ( uint8_t ) ( index % 251U );
+    }
+
+    /* The second buffer crosses the boundary at 2048 bytes. */
+    ioVec[ 0 ].iov_base = data;
+    ioVec[ 0 ].iov_len = 1000U;
+    ioVec[ 1 ].iov_base = &data[ 1000 ];
+    ioVec[ 1 ].iov_len = 1100U;
+    ioVec[ 2 ].iov_base = &data[ 2100 ];
+    ioVec[ 2 ].iov_len = 100U;
+
+    networkContext.pParams = &opensslParams;
+    TEST_ASSERT_TRUE( openStream( &networkContext, NULL, 0U ) );
+
+    firstBytesSent = Openssl_Writev( &networkContext, ioVec, 3U );
+
+    /* The caller sends the rest of the second buffer. */
+    ioVec[ 1 ].iov_base = &data[ firstBytesSent ];
+    ioVec[ 1 ].iov_len = 2100U - ( size_t ) firstBytesSent;
+    isSent = sendVectors( &networkContext, &ioVec[ 1 ], 2U, true );
+
+    ( void ) Openssl_Disconnect( &networkContext );
+    TEST_ASSERT_TRUE( waitForServer( connectionCount ) );
+
+    TEST_ASSERT_EQUAL( OPENSSL_WRITEV_BUFFER_SIZE, firstBytesSent );
+    TEST_ASSERT_TRUE( isSent );
+    TEST_ASSERT_EQUAL_UINT32( 2U, serverRecordCount );
+    TEST_ASSERT_EQUAL( sizeof( data ), serverReceivedLength );
+    TEST_ASSERT_EQUAL_MEMORY( data, serverReceived, sizeof( data ) );
+}
+
+/**
+ * @brief Sends a first buffer of #OPENSSL_WRITEV_BUFFER_SIZE bytes or more,
+ * and checks that it is sent alone, without the buffers after it.
+ */
+void test_Openssl_Writev_LargeFirstBufferSentAlone( void )
+{
+    static uint8_t data[ 3000U ];
+    NetworkContext_t networkContext = { 0 };
+    OpensslParams_t opensslParams = { 0 };
+    TransportOutVector_t ioVec[ 3 ];
+    uint32_t connectionCount = serverConnectionCount;
+    int32_t firstBytesSent = 0;
+    size_t index = 0U;
+    bool isSent = false;
+
+    for( index = 0U; index < sizeof( data ); index++ )
+    {
+        data[ index ] = ( uint8_t ) ( index % 251U );
+    }
+
+    ioVec[ 0 ].iov_base = data;
+    ioVec[ 0 ].iov_len = OPENSSL_WRITEV_BUFFER_SIZE + 500U;
+    ioVec[ 1 ].iov_base = &data[ OPENSSL_WRITEV_BUFFER_SIZE + 500U ];
+    ioVec[ 1 ].iov_len = 200U;
+    ioVec[ 2 ].iov_base = &data[ OPENSSL_WRITEV_BUFFER_SIZE + 700U ];
+    ioVec[ 2 ].iov_len = sizeof( data ) - ( OPENSSL_WRITEV_BUFFER_SIZE + 700U );
+
+    networkContext.pParams = &opensslParams;
+    TEST_ASSERT_TRUE( openStream( &networkContext, NULL, 0U ) );
+
+    firstBytesSent = Openssl_Writev( &networkContext, ioVec, 3U );
+    isSent = sendVectors( &networkContext, &ioVec[ 1 ], 2U, true );
+
+    ( void ) Openssl_Disconnect( &networkContext );
+    TEST_ASSERT_TRUE( waitForServer( connectionCount ) );
+
+    TEST_ASSERT_EQUAL( OPENSSL_WRITEV_BUFFER_SIZE + 500U, firstBytesSent );
+    TEST_ASSERT_TRUE( isSent );
+    TEST_ASSERT_EQUAL_UINT32( 2U, serverRecordCount );
+    TEST_ASSERT_EQUAL( sizeof( data ), serverReceivedLength );
+    TEST_ASSERT_EQUAL_MEMORY( data, serverReceived, sizeof( data ) );
+}
+
+/**
+ * @brief Sends #PUBLISH_COUNT QoS 0 PUBLISH packets as three buffers, each
+ * acknowledged by the server before the next is sent, with one
+ * #Openssl_Send per buffer and with #Openssl_Writev, and compares the
+ * records sent per PUBLISH and the round trips.
+ */
+void test_Openssl_Writev_PublishLatency( void )
+{
+    long sendAverageUs = 0L, sendMaxUs = 0L, writevAverageUs = 0L, writevMaxUs = 0L;
+    double sendRecords = 0.0, writevRecords = 0.0;
+
+    sendRecords = benchmarkSendMode( false, &sendAverageUs, &sendMaxUs );
+    writevRecords = benchmarkSendMode( true, &writevAverageUs, &writevMaxUs );
+
+    LogInfo( ( "%u PUBLISH packets of %u bytes: one send per buffer %.2f records per PUBLISH, "
+               "average %ld us, max %ld us; writev %.2f records, average %ld us, max %ld us.",
+               ( unsigned int ) PUBLISH_COUNT,
+               ( unsigned int ) PUBLISH_LENGTH,
+               sendRecords,
+               sendAverageUs,
+               sendMaxUs,
+               writevRecords,
+               writevAverageUs,
+               writevMaxUs ) );
+
+    TEST_ASSERT_TRUE( writevRecords < 1.01 );
+}
@@ -0,0 +1,798 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file plaintext_system_test.c
+ * @brief Benchmarks of Plaintext_Recv reading MQTT packets the way coreMQTT
+ * does, in each receive mode of the plaintext transport, and of
+ * Plaintext_Writev sending them, against peers on the loopback interface.
+ */
+
+/* For RTLD_NEXT. */
+#define _GNU_SOURCE
+
+/* Standard header includes. */
+#include <string.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* POSIX includes. */
+#include <unistd.h>
+#include <poll.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/* For the TCP_INFO segment counters. */
+#include <linux/tcp.h>
+
+/* Include config file before other non-system includes. */
+#include "test_config.h"
+
+/* Unity testing framework includes. */
+#include "unity.h"
+
+/* Include plaintext implementation of transport interface. */
+#include "plaintext_posix.h"
+
+/**
+ * @brief Address the server listens on.
+ */
+#define SERVER_ADDRESS                  "127.0.0.1"
+
+/**
+ * @brief Length of #SERVER_ADDRESS.
+ */
+#define SERVER_ADDRESS_LENGTH           ( sizeof( SERVER_ADDRESS ) - 1U )
+
+/**
+ * @brief Number of messages received in each receive mode.
+ */
+#define MESSAGE_COUNT                   ( 100000U )
+
+/**
+ * @brief Length of a message: a QoS 0 PUBLISH with a single-byte remaining
+ * length, to #MESSAGE_TOPIC, carrying its sequence number.
+ */
+#define MESSAGE_LENGTH                  ( 64U )
+
+/**
+ * @brief Topic of the messages.
+ */
+#define MESSAGE_TOPIC                   "test/plaintext"
+
+/**
+ * @brief Length of #MESSAGE_TOPIC.
+ */
+#define MESSAGE_TOPIC_LENGTH            ( sizeof( MESSAGE_TOPIC ) - 1U )
+
+/**
+ * @brief Offset of the sequence number in a message, after the fixed header
+ * and the topic name.
+ */
+#define MESSAGE_SEQUENCE_OFFSET         ( 4U + MESSAGE_TOPIC_LENGTH )
+
+/**
+ * @brief Number of messages the server sends in one call.
+ */
+#define MESSAGES_PER_SEND               ( 256U )
+
+/**
+ * @brief Size of the receive buffer of the buffered receive modes.
+ */
+#define RECV_BUFFER_SIZE                ( 4096U )
+
+/**
+ * @brief Maximum number of buffers sent by one call to Plaintext_Writev, the
+ * default of the transport.
+ */
+#ifndef PLAINTEXT_WRITEV_MAX_VECTORS
+    #define PLAINTEXT_WRITEV_MAX_VECTORS    ( 16U )
+#endif
+
+/**
+ * @brief Number and length of the buffers of the test sending more buffers
+ * than one call to Plaintext_Writev takes.
+ */
+#define MANY_VECTOR_COUNT               ( 20U )
+#define MANY_VECTOR_LENGTH              ( 3U )
+
+/**
+ * @brief Number of PUBLISH packets sent in each mode of the send benchmark.
+ */
+#define PUBLISH_COUNT                   ( 200U )
+
+/**
+ * @brief Lengths of the buffers coreMQTT sends a QoS 0 PUBLISH in: the fixed
+ * header with the length of the topic, the topic, then the payload.
+ */
+#define PUBLISH_HEADER_LENGTH           ( 4U )
+#define PUBLISH_TOPIC_LENGTH            ( 20U )
+#define PUBLISH_PAYLOAD_LENGTH          ( 100U )
+#define PUBLISH_LENGTH                  ( PUBLISH_HEADER_LENGTH + PUBLISH_TOPIC_LENGTH + PUBLISH_PAYLOAD_LENGTH )
+
+/**
+ * @brief Number of nanoseconds in a second.
+ */
+#define NANOSECONDS_PER_SECOND          ( 1000000000.0 )
+
+/*-----------------------------------------------------------*/
+
+/* Each compilation unit must define the NetworkContext struct. */
+struct NetworkContext
+{
+    PlaintextParams_t * pParams;
+};
+
+/**
+ * @brief A receive mode of the plaintext transport.
+ */
+typedef struct RecvMode
+{
+    const char * pName;    /**< @brief Name of the mode in the results. */
+    uint8_t nonBlocking;   /**< @brief Value of #PlaintextParams_t.nonBlocking. */
+    size_t recvBufferSize; /**< @brief Size of the receive buffer; 0 for none. */
+} RecvMode_t;
+
+/**
+ * @brief Results of a mode of the send benchmark.
+ */
+typedef struct SendResult
+{
+    long averageUs;             /**< @brief Average time from sending a PUBLISH to receiving the acknowledgement of the peer. */
+    long maxUs;                 /**< @brief Longest of these times. */
+    double segmentsPerPublish;  /**< @brief TCP segments carrying data sent per PUBLISH. */
+} SendResult_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The receive modes benchmarked, the default first.
+ */
+static const RecvMode_t recvModes[] =
+{
+    { "poll before recv",        0U, 0U               },
+    { "non-blocking",            1U, 0U               },
+    { "poll, buffered",          0U, RECV_BUFFER_SIZE },
+    { "non-blocking, buffered",  1U, RECV_BUFFER_SIZE }
+};
+
+/**
+ * @brief Number of calls to recv and poll since the counters were reset.
+ * Only the test thread calls them.
+ */
+static uint32_t recvCallCount = 0U;
+static uint32_t pollCallCount = 0U;
+
+/**
+ * @brief State of the server.
+ */
+static int serverSocket = -1;
+static uint16_t serverPort = 0U;
+static pthread_t serverThread;
+static bool isServerRunning = false;
+
+/**
+ * @brief Receive buffer of the buffered receive modes.
+ */
+static uint8_t recvBuffer[ RECV_BUFFER_SIZE ];
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Write a message to a buffer.
+ *
+ * @param[out] pMessage Buffer of #MESSAGE_LENGTH bytes.
+ * @param[in] sequence The sequence number of the message.
+ */
+static void buildMessage( uint8_t * pMessage,
+                          uint32_t sequence );
+
+/**
+ * @brief Accept a connection, send it #MESSAGE_COUNT messages, then close it.
+ *
+ * @param[in] pArgs Unused.
+ *
+ * @return NULL.
+ */
+static void * serverThreadRoutine( void * pArgs );
+
+/**
+ * @brief Receive exactly a number of bytes with Plaintext_Recv, calling it
+ * again while it returns 0.
+ *
+ * @param[in] pNetworkContext The connection.
+ * @param[out] pBuffer The buffer to fill.
+ * @param[in] length The number of bytes to receive.
+ *
+ * @return true if the bytes were received; false on a transport error or
+ * after #TRANSPORT_SEND_RECV_TIMEOUT_MS without data.
+ */
+static bool receiveExactly( NetworkContext_t * pNetworkContext,
+                            uint8_t * pBuffer,
+                            size_t length );
+
+/**
+ * @brief Receive a message as coreMQTT reads a packet: the packet type, then
+ * the remaining length one byte at a time, then the rest of the packet.
+ *
+ * @param[in] pNetworkContext The connection.
+ * @param[out] pMessage Buffer of #MESSAGE_LENGTH bytes.
+ *
+ * @return true if a message of #MESSAGE_LENGTH bytes was received.
+ */
+static bool receiveMessage( NetworkContext_t * pNetworkContext,
+                            uint8_t * pMessage );
+
+/**
+ * @brief Receive #MESSAGE_COUNT messages in a receive mode, checking their
+ * order, and measure the rate and the system calls made.
+ *
+ * @param[in] pMode The receive mode.
+ * @param[out] pMessagesPerSecond Messages received per second.
+ * @param[out] pSyscallsPerMessage Calls to recv and poll per message.
+ */
+static void benchmarkRecvMode( const RecvMode_t * pMode,
+                               double * pMessagesPerSecond,
+                               double * pSyscallsPerMessage );
+
+/**
+ * @brief Connect to #serverSocket with Plaintext_Connect, and accept the
+ * connection in the test thread.
+ *
+ * @param[out] pNetworkContext The network context of the connection.
+ *
+ * @return The socket of the peer.
+ */
+static int connectToPeer( NetworkContext_t * pNetworkContext );
+
+/**
+ * @brief Send buffers as coreMQTT does: with Plaintext_Writev, or with one
+ * Plaintext_Send per buffer when there is no writev, calling again for the
+ * rest until every byte is sent. The buffers are updated as they are sent.
+ *
+ * @param[in] pNetworkContext The connection.
+ * @param[in] pIoVec The buffers.
+ * @param[in] ioVecCount The number of buffers.
+ * @param[in] useWritev true to send with Plaintext_Writev.
+ *
+ * @return true if every byte was sent.
+ */
+static bool sendVectors( NetworkContext_t * pNetworkContext,
+                         TransportOutVector_t * pIoVec,
+                         size_t ioVecCount,
+                         bool useWritev );
+
+/**
+ * @brief Get the number of TCP segments carrying data sent on a socket.
+ *
+ * @param[in] tcpSocket The socket.
+ *
+ * @return The number of segments.
+ */
+static uint32_t getDataSegmentsOut( int tcpSocket );
+
+/**
+ * @brief Send #PUBLISH_COUNT PUBLISH packets, each after the peer
+ * acknowledged the one before, and measure the round trips and the segments
+ * sent.
+ *
+ * @param[in] useWritev true to send with Plaintext_Writev.
+ * @param[out] pResult The results.
+ */
+static void benchmarkSendMode( bool useWritev,
+                               SendResult_t * pResult );
+
+/*-----------------------------------------------------------*/
+
+/* Counts the calls of the transport, then calls the C library. */
+ssize_t recv( int sockfd,
+              void * pBuffer,
+              size_t length,
+              int flags )
+{
+    static ssize_t ( * libcRecv )( int, void *, size_t, int ) = NULL;
+
+    if( libcRecv == NULL )
+    {
+        *( void ** ) ( &libcRecv ) = dlsym( RTLD_NEXT, "recv" );
+    }
+
+    recvCallCount++;
+
+    return libcRecv( sockfd, pBuffer, length, flags );
+}
+
+/*-----------------------------------------------------------*/
+
+/* Counts the calls of the transport, then calls the C library. */
+int poll( struct pollfd * pFds,
+          nfds_t fdCount,
+          int timeoutMs )
+{
+    static int ( * libcPoll )( struct pollfd *, nfds_t, int ) = NULL;
+
+    if( libcPoll == NULL )
+    {
+        *( void ** ) ( &libcPoll ) = dlsym( RTLD_NEXT, "poll" );
+    }
+
+    pollCallCount++;
+
+    return libcPoll( pFds, fdCount, timeoutMs );
+}
+
+/*-----------------------------------------------------------*/
+
+static void buildMessage( uint8_t * pMessage,
+                          uint32_t sequence )
+{
+    ( void ) memset( pMessage, 0, MESSAGE_LENGTH );
+    pMessage[ 0 ] = 0x30U;
+    pMessage[ 1 ] = ( uint8_t ) ( MESSAGE_LENGTH - 2U );
+    pMessage[ 2 ] = 0U;
+    pMessage[ 3 ] = ( uint8_t ) MESSAGE_TOPIC_LENGTH;
+    ( void ) memcpy( &pMessage[ 4 ], MESSAGE_TOPIC, MESSAGE_TOPIC_LENGTH );
+    pMessage[ MESSAGE_SEQUENCE_OFFSET ] = ( uint8_t ) ( sequence >> 24 );
+    pMessage[ MESSAGE_SEQUENCE_OFFSET + 1U ] = ( uint8_t ) ( sequence >> 16 );
+    pMessage[ MESSAGE_SEQUENCE_OFFSET + 2U ] = ( uint8_t ) ( sequence >> 8 );
+    pMessage[ MESSAGE_SEQUENCE_OFFSET + 3U ] = ( uint8_t ) sequence;
+}
+
+/*-----------------------------------------------------------*/
+
+static void * serverThreadRoutine( void * pArgs )
+{
+    static uint8_t messages[ MESSAGES_PER_SEND * MESSAGE_LENGTH ];
+    uint32_t sequence = 0U;
+    uint32_t index = 0U;
+    ssize_t bytesSent = 0;
+    int connectionSocket = -1;
+
+    ( void ) pArgs;
+
+    /* Assertions are left to the test thread, which checks every message. */
+    connectionSocket = accept( serverSocket, NULL, NULL );
+
+    while( ( connectionSocket >= 0 ) && ( bytesSent >= 0 ) && ( sequence < MESSAGE_COUNT ) )
+    {
+        for( index = 0U; index < MESSAGES_PER_SEND; index++ )
+        {
+            buildMessage( &messages[ index * MESSAGE_LENGTH ], sequence + index );
+        }
+
+        bytesSent = send( connectionSocket, messages, sizeof( messages ), MSG_NOSIGNAL );
+        sequence += MESSAGES_PER_SEND;
+    }
+
+    if( connectionSocket >= 0 )
+    {
+        ( void ) close( connectionSocket );
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool receiveExactly( NetworkContext_t * pNetworkContext,
+                            uint8_t * pBuffer,
+                            size_t length )
+{
+    struct timespec start, now;
+    size_t receivedLength = 0U;
+    int32_t bytesReceived = 0;
+    bool isReceiving = true;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+
+    while( ( isReceiving == true ) && ( receivedLength < length ) )
+    {
+        bytesReceived = Plaintext_Recv( pNetworkContext,
+                                        &pBuffer[ receivedLength ],
+                                        length - receivedLength );
+
+        if( bytesReceived > 0 )
+        {
+            receivedLength += ( size_t ) bytesReceived;
+        }
+        else if( bytesReceived == 0 )
+        {
+            ( void ) clock_gettime( CLOCK_MONOTONIC, &now );
+            isReceiving = ( ( now.tv_sec - start.tv_sec ) * 1000L ) <= TRANSPORT_SEND_RECV_TIMEOUT_MS;
+        }
+        else
+        {
+            isReceiving = false;
+        }
+    }
+
+    return isReceiving;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool receiveMessage( NetworkContext_t * pNetworkContext,
+                            uint8_t * pMessage )
+{
+    bool isReceived = false;
+
+    /* The messages have a single-byte remaining length. */
+    if( ( receiveExactly( pNetworkContext, &pMessage[ 0 ], 1U ) == true ) &&
+        ( receiveExactly( pNetworkContext, &pMessage[ 1 ], 1U ) == true ) &&
+        ( pMessage[ 1 ] == ( MESSAGE_LENGTH - 2U ) ) )
+    {
+        isReceived = receiveExactly( pNetworkContext, &pMessage[ 2 ], MESSAGE_LENGTH - 2U );
+    }
+
+    return isReceived;
+}
+
+/*-----------------------------------------------------------*/
+
+static void benchmarkRecvMode( const RecvMode_t * pMode,
+                               double * pMessagesPerSecond,
+                               double * pSyscallsPerMessage )
+{
+    NetworkContext_t networkContext = { 0 };
+    PlaintextParams_t plaintextParams = { 0 };
+    ServerInfo_t serverInfo = { SERVER_ADDRESS, SERVER_ADDRESS_LENGTH, 0U };
+    uint8_t message[ MESSAGE_LENGTH ];
+    uint8_t expectedMessage[ MESSAGE_LENGTH ];
+    struct timespec start, end;
+    uint32_t sequence = 0U;
+    double elapsedNs = 0.0;
+
+    TEST_ASSERT_EQUAL( 0, pthread_create( &serverThread, NULL, serverThreadRoutine, NULL ) );
+    isServerRunning = true;
+
+    networkContext.pParams = &plaintextParams;
+    serverInfo.port = serverPort;
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, Plaintext_Connect( &networkContext,
+                                                           &serverInfo,
+                                                           TRANSPORT_SEND_RECV_TIMEOUT_MS,
+                                                           TRANSPORT_SEND_RECV_TIMEOUT_MS ) );
+
+    plaintextParams.nonBlocking = pMode->nonBlocking;
+
+    if( pMode->recvBufferSize > 0U )
+    {
+        plaintextParams.pRecvBuffer = recvBuffer;
+        plaintextParams.recvBufferSize = pMode->recvBufferSize;
+    }
+
+    recvCallCount = 0U;
+    pollCallCount = 0U;
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+
+    for( sequence = 0U; sequence < MESSAGE_COUNT; sequence++ )
+    {
+        if( receiveMessage( &networkContext, message ) == false )
+        {
+            break;
+        }
+
+        buildMessage( expectedMessage, sequence );
+
+        if( memcmp( message, expectedMessage, MESSAGE_LENGTH ) != 0 )
+        {
+            break;
+        }
+    }
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &end );
+
+    /* Disconnect before asserting, so that the server is not left sending. */
+    ( void ) Plaintext_Disconnect( &networkContext );
+    ( void ) pthread_join( serverThread, NULL );
+    isServerRunning = false;
+
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE( MESSAGE_COUNT, sequence, "A message was lost, corrupted or out of order." );
+
+    elapsedNs = ( ( double ) ( end.tv_sec - start.tv_sec ) * NANOSECONDS_PER_SECOND ) +
+                ( double ) ( end.tv_nsec - start.tv_nsec );
+    *pMessagesPerSecond = ( ( double ) MESSAGE_COUNT * NANOSECONDS_PER_SECOND ) / elapsedNs;
+    *pSyscallsPerMessage = ( double ) ( recvCallCount + pollCallCount ) / ( double ) MESSAGE_COUNT;
+}
+
+/*-----------------------------------------------------------*/
+
+static int connectToPeer( NetworkContext_t * pNetworkContext )
+{
+    ServerInfo_t serverInfo = { SERVER_ADDRESS, SERVER_ADDRESS_LENGTH, 0U };
+    int peerSocket = -1;
+
+    serverInfo.port = serverPort;
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, Plaintext_Connect( pNetworkContext,
+                                                           &serverInfo,
+                                                           TRANSPORT_SEND_RECV_TIMEOUT_MS,
+                                                           TRANSPORT_SEND_RECV_TIMEOUT_MS ) );
+
+    /* The connection is already established, in the accept queue. */
+    peerSocket = accept( serverSocket, NULL, NULL );
+    TEST_ASSERT_NOT_EQUAL( -1, peerSocket );
+
+    return peerSocket;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool sendVectors( NetworkContext_t * pNetworkContext,
+                         TransportOutVector_t * pIoVec,
+                         size_t ioVecCount,
+                         bool useWritev )
+{
+    int32_t bytesSent = 0;
+    size_t index = 0U, remainingLength = 0U;
+    bool isSending = true;
+
+    while( ( isSending == true ) && ( index < ioVecCount ) )
+    {
+        if( useWritev == true )
+        {
+            bytesSent = Plaintext_Writev( pNetworkContext, &pIoVec[ index ], ioVecCount - index );
+        }
+        else
+        {
+            bytesSent = Plaintext_Send( pNetworkContext, pIoVec[ index ].iov_base, pIoVec[ index ].iov_len );
+        }
+
+        isSending = ( bytesSent >= 0 );
+        remainingLength = ( isSending == true ) ? ( size_t ) bytesSent : 0U;
+
+        /* Skip the buffers sent, then the part sent of the next one. */
+        while( ( index < ioVecCount ) && ( remainingLength >= pIoVec[ index ].iov_len ) )
+        {
+            remainingLength -= pIoVec[ index ].iov_len;
+            index++;
+        }
+
+        if( index < ioVecCount )
+        {
+            pIoVec[ index ].iov_base = &( ( const uint8_t * ) pIoVec[ index ].iov_base )[ remainingLength ];
+            pIoVec[ index ].iov_len -= remainingLength;
+        }
+    }
+
+    return isSending;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t getDataSegmentsOut( int tcpSocket )
+{
+    struct tcp_info tcpInfo = { 0 };
+    socklen_t infoLength = sizeof( tcpInfo );
+
+    TEST_ASSERT_EQUAL( 0, getsockopt( tcpSocket, IPPROTO_TCP, TCP_INFO, &tcpInfo, &infoLength ) );
+
+    return tcpInfo.tcpi_data_segs_out;
+}
+
+/*-----------------------------------------------------------*/
+
+static void benchmarkSendMode( bool useWritev,
+                               SendResult_t * pResult )
+{
+    NetworkContext_t networkContext = { 0 };
+    PlaintextParams_t plaintextParams = { 0 };
+    TransportOutVector_t ioVec[ 3 ];
+    uint8_t publish[ PUBLISH_LENGTH ];
+    uint8_t received[ PUBLISH_LENGTH ];
+    uint8_t ack = 0x40U;
+    struct timespec start, end;
+    uint32_t publishIndex = 0U, firstSegmentCount = 0U;
+    int peerSocket = -1;
+    long elapsedUs = 0L, totalUs = 0L;
+    bool isIntact = true;
+
+    ( void ) memset( publish, 0xA5, sizeof( publish ) );
+    publish[ 0 ] = 0x30U;
+    publish[ 1 ] = ( uint8_t ) ( PUBLISH_LENGTH - 2U );
+    publish[ 2 ] = 0U;
+    publish[ 3 ] = ( uint8_t ) PUBLISH_TOPIC_LENGTH;
+
+    networkContext.pParams = &plaintextParams;
+    peerSocket = connectToPeer( &networkContext );
+    firstSegmentCount = getDataSegmentsOut( plaintextParams.socketDescriptor );
+    pResult->maxUs = 0L;
+
+    for( publishIndex = 0U; ( isIntact == true ) && ( publishIndex < PUBLISH_COUNT ); publishIndex++ )
+    {
+        ioVec[ 0 ].iov_base = publish;
+        ioVec[ 0 ].iov_len = PUBLISH_HEADER_LENGTH;
+        ioVec[ 1 ].iov_base = &publish[ PUBLISH_HEADER_LENGTH ];
+        ioVec[ 1 ].iov_len = PUBLISH_TOPIC_LENGTH;
+        ioVec[ 2 ].iov_base = &publish[ PUBLISH_HEADER_LENGTH + PUBLISH_TOPIC_LENGTH ];
+        ioVec[ 2 ].iov_len = PUBLISH_PAYLOAD_LENGTH;
+
+        ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+
+        /* The peer acknowledges each PUBLISH once it has all of it. */
+        isIntact = ( ( sendVectors( &networkContext, ioVec, 3U, useWritev ) == true ) &&
+                     ( recv( peerSocket, received, sizeof( received ), MSG_WAITALL ) == ( ssize_t ) sizeof( received ) ) &&
+                     ( send( peerSocket, &ack, 1U, MSG_NOSIGNAL ) == 1 ) &&
+                     ( receiveExactly( &networkContext, &ack, 1U ) == true ) &&
+                     ( memcmp( received, publish, sizeof( publish ) ) == 0 ) );
+
+        ( void ) clock_gettime( CLOCK_MONOTONIC, &end );
+
+        elapsedUs = ( ( end.tv_sec - start.tv_sec ) * 1000000L ) +
+                    ( ( end.tv_nsec - start.tv_nsec ) / 1000L );
+        totalUs += elapsedUs;
+
+        if( elapsedUs > pResult->maxUs )
+        {
+            pResult->maxUs = elapsedUs;
+        }
+    }
+
+    pResult->segmentsPerPublish = ( double ) ( getDataSegmentsOut( plaintextParams.socketDescriptor ) - firstSegmentCount ) /
+                                  ( double ) PUBLISH_COUNT;
+    pResult->averageUs = totalUs / ( long ) PUBLISH_COUNT;
+
+    ( void ) Plaintext_Disconnect( &networkContext );
+    ( void ) close( peerSocket );
+
+    TEST_ASSERT_TRUE_MESSAGE( isIntact, "A PUBLISH was not sent or acknowledged intact." );
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    struct sockaddr_in address = { 0 };
+    socklen_t addressLength = sizeof( address );
+
+    serverSocket = socket( AF_INET, SOCK_STREAM, 0 );
+    TEST_ASSERT_NOT_EQUAL( -1, serverSocket );
+    address.sin_family = AF_INET;
+    TEST_ASSERT_EQUAL( 1, inet_pton( AF_INET, SERVER_ADDRESS, &address.sin_addr ) );
+    TEST_ASSERT_EQUAL( 0, bind( serverSocket, ( struct sockaddr * ) &address, sizeof( address ) ) );
+    TEST_ASSERT_EQUAL( 0, listen( serverSocket, 1 ) );
+    TEST_ASSERT_EQUAL( 0, getsockname( serverSocket, ( struct sockaddr * ) &address, &addressLength ) );
+    serverPort = ntohs( address.sin_port );
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+    /* Closing the listening socket ends an accept that is still waiting. */
+    ( void ) shutdown( serverSocket, SHUT_RDWR );
+    ( void ) close( serverSocket );
+
+    if( isServerRunning == true )
+    {
+        ( void ) pthread_join( serverThread, NULL );
+        isServerRunning = false;
+    }
+}
+
+/* ========================== Test Cases ============================ */
+
+/**
+ * @brief Receives #MESSAGE_COUNT messages in each receive mode of the
+ * plaintext transport, and measures the messages received per second and the
+ * calls to recv and poll per message. The receive buffer must save system
+ * calls over reading the socket on every call.
+ */
+void test_Plaintext_Recv_MessageRate( void )
+{
+    double messagesPerSecond[ sizeof( recvModes ) / sizeof( recvModes[ 0 ] ) ];
+    double syscallsPerMessage[ sizeof( recvModes ) / sizeof( recvModes[ 0 ] ) ];
+    size_t index = 0U;
+
+    for( index = 0U; index < ( sizeof( recvModes ) / sizeof( recvModes[ 0 ] ) ); index++ )
+    {
+        benchmarkRecvMode( &recvModes[ index ], &messagesPerSecond[ index ], &syscallsPerMessage[ index ] );
+
+        LogInfo( ( "%s: %.0f messages/s, %.2f system calls per message.",
+                   recvModes[ index ].pName,
+                   messagesPerSecond[ index ],
+                   syscallsPerMessage[ index ] ) );
+    }
+
+    /* Without a buffer, each of the three reads of a message makes a call to
+     * recv, after a call to poll unless non-blocking. */
+    TEST_ASSERT_TRUE( syscallsPerMessage[ 1 ] < syscallsPerMessage[ 0 ] );
+    TEST_ASSERT_TRUE( syscallsPerMessage[ 2 ] < syscallsPerMessage[ 0 ] );
+    TEST_ASSERT_TRUE( syscallsPerMessage[ 3 ] < syscallsPerMessage[ 1 ] );
+}
+
+/**
+ * @brief Sends more buffers than one call to Plaintext_Writev takes, and
+ * checks that the first call sends the first #PLAINTEXT_WRITEV_MAX_VECTORS
+ * buffers, and that the rest follows in order.
+ */
+void test_Plaintext_Writev_MoreThanMaxVectors( void )
+{
+    NetworkContext_t networkContext = { 0 };
+    PlaintextParams_t plaintextParams = { 0 };
+    TransportOutVector_t ioVec[ MANY_VECTOR_COUNT ];
+    uint8_t data[ MANY_VECTOR_COUNT * MANY_VECTOR_LENGTH ];
+    uint8_t received[ MANY_VECTOR_COUNT * MANY_VECTOR_LENGTH ];
+    int32_t firstBytesSent = 0;
+    size_t index = 0U;
+    int peerSocket = -1;
+    bool isSent = false;
+
+    for( index = 0U; index < sizeof( data ); index++ )
+    {
+        data[ index ] = ( uint8_t ) index;
+    }
+
+    for( index = 0U; index < MANY_VECTOR_COUNT; index++ )
+    {
+        ioVec[ index ].iov_base = &data[ index * MANY_VECTOR_LENGTH ];
+        ioVec[ index ].iov_len = MANY_VECTOR_LENGTH;
+    }
+
+    networkContext.pParams = &plaintextParams;
+    peerSocket = connectToPeer( &networkContext );
+
+    firstBytesSent = Plaintext_Writev( &networkContext, ioVec, MANY_VECTOR_COUNT );
+    isSent = sendVectors( &networkContext,
+                          &ioVec[ PLAINTEXT_WRITEV_MAX_VECTORS ],
+                          MANY_VECTOR_COUNT - PLAINTEXT_WRITEV_MAX_VECTORS,
+                          true );
+
+    TEST_ASSERT_EQUAL( sizeof( received ), recv( peerSocket, received, sizeof( received ), MSG_WAITALL ) );
+
+    ( void ) Plaintext_Disconnect( &networkContext );
+    ( void ) close( peerSocket );
+
+    TEST_ASSERT_EQUAL( PLAINTEXT_WRITEV_MAX_VECTORS * MANY_VECTOR_LENGTH, firstBytesSent );
+    TEST_ASSERT_TRUE( isSent );
+    TEST_ASSERT_EQUAL_INT( 0, memcmp( data, received, sizeof( data ) ) );
+}
+
+/**
+ * @brief Sends #PUBLISH_COUNT QoS 0 PUBLISH packets as three buffers, each
+ * acknowledged by the peer before the next is sent, with one Plaintext_Send
+ * per buffer and with Plaintext_Writev, and measures the round trips and the
+ * TCP segments sent per PUBLISH.
+ */
+void test_Plaintext_Writev_PublishLatency( void )
+{
+    SendResult_t sendResult = { 0 }, writevResult = { 0 };
+
+    benchmarkSendMode( false, &sendResult );
+    benchmarkSendMode( true, &writevResult );
+
+    LogInfo( ( "%u PUBLISH packets of %u bytes: one send per buffer %.2f segments per PUBLISH, "
+               "average %ld us, max %ld us; writev %.2f segments, average %ld us, max %ld us.",
+               ( unsigned int ) PUBLISH_COUNT,
+               ( unsigned int ) PUBLISH_LENGTH,
+               sendResult.segmentsPerPublish,
+               sendResult.averageUs,
+               sendResult.maxUs,
+               writevResult.segmentsPerPublish,
+               writevResult.averageUs,
+               writevResult.maxUs ) );
+
+    /* Each PUBLISH fits in one segment. */
+    TEST_ASSERT_TRUE( writevResult.segmentsPerPublish < 1.01 );
+}
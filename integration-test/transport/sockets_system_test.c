@@ -0,0 +1,520 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file sockets_system_test.c
+ * @brief Integration tests for the connection setup and the DNS cache of the
+ * POSIX sockets utility, with a stub resolver and servers on the loopback
+ * interface.
+ */
+
+/* Standard header includes. */
+#include <string.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+
+/* POSIX includes. */
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/* Include config file before other non-system includes. */
+#include "test_config.h"
+
+/* Unity testing framework includes. */
+#include "unity.h"
+
+/* Include plaintext implementation of transport interface. */
+#include "plaintext_posix.h"
+
+/* The DNS cache is disabled by default; the build enables it with short
+ * lifetimes that the tests wait out. */
+#ifndef SOCKETS_DNS_CACHE_TTL_MS
+    #error "SOCKETS_DNS_CACHE_TTL_MS should be defined for the sockets integration tests."
+#endif
+
+#ifndef SOCKETS_DNS_CACHE_NEGATIVE_TTL_MS
+    #error "SOCKETS_DNS_CACHE_NEGATIVE_TTL_MS should be defined for the sockets integration tests."
+#endif
+
+/**
+ * @brief Address that drops connection requests to #serverPort.
+ */
+#define BLACKHOLE_ADDRESS               "127.0.0.1"
+
+/**
+ * @brief Address accepting connections on #serverPort.
+ */
+#define SERVER_ADDRESS                  "127.0.0.2"
+
+/**
+ * @brief Length of #SERVER_HOST, which is resolved by the stub resolver.
+ */
+#define SERVER_HOST_LENGTH              ( sizeof( SERVER_HOST ) - 1U )
+
+/**
+ * @brief Maximum number of addresses returned by the stub resolver.
+ */
+#define MAX_STUB_ADDRESSES              ( 2U )
+
+/**
+ * @brief Maximum number of connections queued on the blackhole listener.
+ */
+#define MAX_BLACKHOLE_CONNECTIONS       ( 8U )
+
+/**
+ * @brief Time a connection request must stay pending for the blackhole
+ * to be considered full.
+ */
+#define BLACKHOLE_PENDING_MS            ( 200 )
+
+/**
+ * @brief Upper bound on the time to connect past the blackholed address.
+ *
+ * The attempt to the second address starts after a head start of 250 ms given
+ * to the first one; a blocking connect would instead wait for the TCP connect
+ * timeout of the kernel, over a minute.
+ */
+#define BLACKHOLE_MAX_CONNECT_MS        ( 1000L )
+
+/**
+ * @brief Overall time allowed for connecting in the DNS cache tests.
+ */
+#define CONNECT_TIMEOUT_MS              ( 5000U )
+
+/**
+ * @brief Number of microseconds in a millisecond.
+ */
+#define MICROSECONDS_PER_MILLISECOND    ( 1000U )
+
+/**
+ * @brief Number of nanoseconds in a millisecond.
+ */
+#define NANOSECONDS_PER_MILLISECOND     ( 1000000L )
+
+/**
+ * @brief Number of milliseconds in a second.
+ */
+#define MILLISECONDS_PER_SECOND         ( 1000L )
+
+/*-----------------------------------------------------------*/
+
+/* Each compilation unit must define the NetworkContext struct. */
+struct NetworkContext
+{
+    PlaintextParams_t * pParams;
+};
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Addresses returned by the stub resolver, in order.
+ */
+static const char * stubAddresses[ MAX_STUB_ADDRESSES ];
+static size_t stubAddressCount = 0U;
+
+/**
+ * @brief Number of calls to the stub resolver.
+ */
+static volatile int stubLookupCount = 0;
+
+/**
+ * @brief Port shared by the blackhole and the server, and their listening
+ * sockets.
+ */
+static uint16_t serverPort = 0U;
+static int blackholeSocket = -1;
+static int serverSocket = -1;
+
+/**
+ * @brief Connections that fill the accept queue of #blackholeSocket.
+ */
+static int blackholeConnections[ MAX_BLACKHOLE_CONNECTIONS ];
+static size_t blackholeConnectionCount = 0U;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Opens a socket listening on the given address.
+ *
+ * @param[in] pAddress IPv4 address to listen on.
+ * @param[in] port Port to listen on in host order; 0 for an ephemeral port.
+ * @param[in] backlog Length of the accept queue.
+ *
+ * @return The listening socket.
+ */
+static int listenOn( const char * pAddress,
+                     uint16_t port,
+                     int backlog );
+
+/**
+ * @brief Fills the accept queue of #blackholeSocket, so that further
+ * connection requests to it are dropped without a reply.
+ */
+static void fillBlackhole( void );
+
+/**
+ * @brief Returns the time elapsed since a point in time, in milliseconds.
+ *
+ * @param[in] pStart The point in time, on the monotonic clock.
+ *
+ * @return Elapsed milliseconds.
+ */
+static long getElapsedMs( const struct timespec * pStart );
+
+/**
+ * @brief Connects to #SERVER_HOST with #Sockets_ConnectParallel and closes
+ * the connection.
+ *
+ * @return The status returned by #Sockets_ConnectParallel.
+ */
+static SocketStatus_t connectAndClose( void );
+
+/*-----------------------------------------------------------*/
+
+/* The stub resolver replaces the one of the C library. */
+int getaddrinfo( const char * pNode,
+                 const char * pService,
+                 const struct addrinfo * pHints,
+                 struct addrinfo ** ppResult )
+{
+    struct addrinfo * pHead = NULL, * pTail = NULL, * pEntry = NULL;
+    struct sockaddr_in * pAddress = NULL;
+    size_t index = 0U;
+
+    ( void ) pNode;
+    ( void ) pService;
+    ( void ) pHints;
+
+    stubLookupCount++;
+
+    for( index = 0U; index < stubAddressCount; index++ )
+    {
+        pEntry = calloc( 1, sizeof( struct addrinfo ) );
+        pAddress = calloc( 1, sizeof( struct sockaddr_in ) );
+        TEST_ASSERT_NOT_NULL( pEntry );
+        TEST_ASSERT_NOT_NULL( pAddress );
+
+        pAddress->sin_family = AF_INET;
+        TEST_ASSERT_EQUAL( 1, inet_pton( AF_INET, stubAddresses[ index ], &pAddress->sin_addr ) );
+
+        pEntry->ai_family = AF_INET;
+        pEntry->ai_socktype = SOCK_STREAM;
+        pEntry->ai_protocol = IPPROTO_TCP;
+        pEntry->ai_addrlen = sizeof( struct sockaddr_in );
+        pEntry->ai_addr = ( struct sockaddr * ) pAddress;
+
+        if( pTail == NULL )
+        {
+            pHead = pEntry;
+        }
+        else
+        {
+            pTail->ai_next = pEntry;
+        }
+
+        pTail = pEntry;
+    }
+
+    *ppResult = pHead;
+
+    return ( pHead == NULL ) ? EAI_NONAME : 0;
+}
+
+/*-----------------------------------------------------------*/
+
+void freeaddrinfo( struct addrinfo * pResult )
+{
+    struct addrinfo * pNext = NULL;
+
+    while( pResult != NULL )
+    {
+        pNext = pResult->ai_next;
+        free( pResult->ai_addr );
+        free( pResult );
+        pResult = pNext;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static int listenOn( const char * pAddress,
+                     uint16_t port,
+                     int backlog )
+{
+    struct sockaddr_in address = { 0 };
+    int listenSocket = socket( AF_INET, SOCK_STREAM, 0 );
+
+    TEST_ASSERT_NOT_EQUAL( -1, listenSocket );
+
+    address.sin_family = AF_INET;
+    address.sin_port = htons( port );
+    TEST_ASSERT_EQUAL( 1, inet_pton( AF_INET, pAddress, &address.sin_addr ) );
+    TEST_ASSERT_EQUAL( 0, bind( listenSocket, ( struct sockaddr * ) &address, sizeof( address ) ) );
+    TEST_ASSERT_EQUAL( 0, listen( listenSocket, backlog ) );
+
+    return listenSocket;
+}
+
+/*-----------------------------------------------------------*/
+
+static void fillBlackhole( void )
+{
+    struct sockaddr_in address = { 0 };
+    struct pollfd pollFd = { 0 };
+    int connectionSocket = -1, pollStatus = 1;
+
+    address.sin_family = AF_INET;
+    address.sin_port = htons( serverPort );
+    TEST_ASSERT_EQUAL( 1, inet_pton( AF_INET, BLACKHOLE_ADDRESS, &address.sin_addr ) );
+
+    /* Connections complete until the accept queue is full; the first one
+     * that stays pending shows that requests are now dropped. */
+    while( pollStatus != 0 )
+    {
+        TEST_ASSERT_LESS_THAN( MAX_BLACKHOLE_CONNECTIONS, blackholeConnectionCount );
+
+        connectionSocket = socket( AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0 );
+        TEST_ASSERT_NOT_EQUAL( -1, connectionSocket );
+        blackholeConnections[ blackholeConnectionCount ] = connectionSocket;
+        blackholeConnectionCount++;
+
+        if( connect( connectionSocket, ( struct sockaddr * ) &address, sizeof( address ) ) != 0 )
+        {
+            TEST_ASSERT_EQUAL( EINPROGRESS, errno );
+            pollFd.fd = connectionSocket;
+            pollFd.events = POLLOUT;
+            pollStatus = poll( &pollFd, 1, BLACKHOLE_PENDING_MS );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static long getElapsedMs( const struct timespec * pStart )
+{
+    struct timespec now;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ( ( now.tv_sec - pStart->tv_sec ) * MILLISECONDS_PER_SECOND ) +
+           ( ( now.tv_nsec - pStart->tv_nsec ) / NANOSECONDS_PER_MILLISECOND );
+}
+
+/*-----------------------------------------------------------*/
+
+static SocketStatus_t connectAndClose( void )
+{
+    SocketStatus_t socketStatus = SOCKETS_SUCCESS;
+    ServerInfo_t serverInfo = { 0 };
+    int32_t tcpSocket = -1;
+
+    serverInfo.pHostName = SERVER_HOST;
+    serverInfo.hostNameLength = SERVER_HOST_LENGTH;
+    serverInfo.port = serverPort;
+
+    socketStatus = Sockets_ConnectParallel( &tcpSocket,
+                                            &serverInfo,
+                                            CONNECT_TIMEOUT_MS,
+                                            TRANSPORT_SEND_RECV_TIMEOUT_MS,
+                                            TRANSPORT_SEND_RECV_TIMEOUT_MS );
+
+    if( socketStatus == SOCKETS_SUCCESS )
+    {
+        ( void ) Sockets_Disconnect( tcpSocket );
+    }
+
+    return socketStatus;
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    struct sockaddr_in address = { 0 };
+    socklen_t addressLength = sizeof( address );
+
+    stubAddressCount = 0U;
+    stubLookupCount = 0;
+    blackholeConnectionCount = 0U;
+
+    /* The blackhole and the server share a port on two loopback addresses,
+     * as the transport connects to every resolved address on the same port. */
+    blackholeSocket = listenOn( BLACKHOLE_ADDRESS, 0U, 0 );
+    TEST_ASSERT_EQUAL( 0, getsockname( blackholeSocket, ( struct sockaddr * ) &address, &addressLength ) );
+    serverPort = ntohs( address.sin_port );
+    serverSocket = listenOn( SERVER_ADDRESS, serverPort, 16 );
+
+    Sockets_ClearDnsCache();
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+    size_t index = 0U;
+
+    for( index = 0U; index < blackholeConnectionCount; index++ )
+    {
+        ( void ) close( blackholeConnections[ index ] );
+    }
+
+    ( void ) close( blackholeSocket );
+    ( void ) close( serverSocket );
+}
+
+/* ========================== Test Cases ============================ */
+
+/**
+ * @brief Connects with the first resolved address blackholed and verifies
+ * that the connection to the second address is not held up by the first.
+ */
+void test_Plaintext_Connect_BlackholedFirstAddress( void )
+{
+    NetworkContext_t networkContext = { 0 };
+    PlaintextParams_t plaintextParams = { 0 };
+    ServerInfo_t serverInfo = { 0 };
+    struct sockaddr_in peerAddress = { 0 };
+    socklen_t addressLength = sizeof( peerAddress );
+    struct timespec start;
+    long elapsedMs = 0L;
+    char peerName[ INET_ADDRSTRLEN ];
+
+    fillBlackhole();
+    stubAddresses[ 0 ] = BLACKHOLE_ADDRESS;
+    stubAddresses[ 1 ] = SERVER_ADDRESS;
+    stubAddressCount = 2U;
+
+    serverInfo.pHostName = SERVER_HOST;
+    serverInfo.hostNameLength = SERVER_HOST_LENGTH;
+    serverInfo.port = serverPort;
+    networkContext.pParams = &plaintextParams;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, Plaintext_Connect( &networkContext,
+                                                           &serverInfo,
+                                                           TRANSPORT_SEND_RECV_TIMEOUT_MS,
+                                                           TRANSPORT_SEND_RECV_TIMEOUT_MS ) );
+    elapsedMs = getElapsedMs( &start );
+
+    TEST_ASSERT_EQUAL( 0, getpeername( plaintextParams.socketDescriptor,
+                                       ( struct sockaddr * ) &peerAddress,
+                                       &addressLength ) );
+    TEST_ASSERT_NOT_NULL( inet_ntop( AF_INET, &peerAddress.sin_addr, peerName, sizeof( peerName ) ) );
+    ( void ) Plaintext_Disconnect( &networkContext );
+
+    LogInfo( ( "Connected to %s past a blackholed address in %ld ms.", peerName, elapsedMs ) );
+
+    TEST_ASSERT_EQUAL_STRING( SERVER_ADDRESS, peerName );
+    TEST_ASSERT_LESS_THAN( BLACKHOLE_MAX_CONNECT_MS, elapsedMs );
+}
+
+/**
+ * @brief Verifies that resolved addresses are reused until their lifetime
+ * expires, and that the host name is then resolved again.
+ */
+void test_Sockets_DnsCache_ExpiresAfterTtl( void )
+{
+    SocketsDnsCacheStats_t stats = { 0 };
+
+    stubAddresses[ 0 ] = SERVER_ADDRESS;
+    stubAddressCount = 1U;
+
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, connectAndClose() );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, connectAndClose() );
+    TEST_ASSERT_EQUAL( 1, stubLookupCount );
+
+    ( void ) usleep( ( SOCKETS_DNS_CACHE_TTL_MS + 100U ) * MICROSECONDS_PER_MILLISECOND );
+
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, connectAndClose() );
+    TEST_ASSERT_EQUAL( 2, stubLookupCount );
+
+    Sockets_GetDnsCacheStats( &stats );
+    TEST_ASSERT_EQUAL( 1, stats.hits );
+    TEST_ASSERT_EQUAL( 2, stats.misses );
+    TEST_ASSERT_EQUAL( 0, stats.negativeHits );
+}
+
+/**
+ * @brief Verifies that a host name that does not exist is answered from the
+ * cache until the negative entry expires, and that a name that appears in
+ * the meantime is then resolved.
+ */
+void test_Sockets_DnsCache_NegativeEntryExpires( void )
+{
+    SocketsDnsCacheStats_t stats = { 0 };
+
+    /* The stub resolver reports EAI_NONAME without addresses. */
+    stubAddressCount = 0U;
+
+    TEST_ASSERT_EQUAL( SOCKETS_DNS_FAILURE, connectAndClose() );
+    TEST_ASSERT_EQUAL( 1, stubLookupCount );
+
+    /* The name now exists, but the negative entry is still current. */
+    stubAddresses[ 0 ] = SERVER_ADDRESS;
+    stubAddressCount = 1U;
+    TEST_ASSERT_EQUAL( SOCKETS_DNS_FAILURE, connectAndClose() );
+    TEST_ASSERT_EQUAL( 1, stubLookupCount );
+
+    ( void ) usleep( ( SOCKETS_DNS_CACHE_NEGATIVE_TTL_MS + 100U ) * MICROSECONDS_PER_MILLISECOND );
+
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, connectAndClose() );
+    TEST_ASSERT_EQUAL( 2, stubLookupCount );
+
+    Sockets_GetDnsCacheStats( &stats );
+    TEST_ASSERT_EQUAL( 0, stats.hits );
+    TEST_ASSERT_EQUAL( 1, stats.negativeHits );
+    TEST_ASSERT_EQUAL( 2, stats.misses );
+}
+
+/**
+ * @brief Verifies that cached addresses that cannot be connected to are
+ * dropped, so that the next connection resolves the host name again.
+ */
+void test_Sockets_DnsCache_InvalidatedOnConnectFailure( void )
+{
+    SocketsDnsCacheStats_t stats = { 0 };
+
+    stubAddresses[ 0 ] = SERVER_ADDRESS;
+    stubAddressCount = 1U;
+
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, connectAndClose() );
+
+    /* The server goes away; the cached address is refused. */
+    ( void ) close( serverSocket );
+    serverSocket = -1;
+    TEST_ASSERT_EQUAL( SOCKETS_CONNECT_FAILURE, connectAndClose() );
+    TEST_ASSERT_EQUAL( 1, stubLookupCount );
+
+    serverSocket = listenOn( SERVER_ADDRESS, serverPort, 16 );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, connectAndClose() );
+    TEST_ASSERT_EQUAL( 2, stubLookupCount );
+
+    Sockets_GetDnsCacheStats( &stats );
+    TEST_ASSERT_EQUAL( 1, stats.invalidations );
+}
@@ -0,0 +1,826 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file transport_reactor_load_test.c
+ * @brief Load test of the epoll-based transport reactor, driving many
+ * plaintext connections to a local MQTT broker stand-in from a small pool of
+ * worker threads.
+ */
+
+/* Standard header includes. */
+#include <string.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+
+/* POSIX includes. */
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/* Include config file before other non-system includes. */
+#include "test_config.h"
+
+/* Unity testing framework includes. */
+#include "unity.h"
+
+/* Include plaintext implementation of transport interface. */
+#include "plaintext_posix.h"
+
+/* Include the transport reactor. */
+#include "transport_reactor_posix.h"
+
+/**
+ * @brief Address the broker stand-in listens on.
+ */
+#define BROKER_ADDRESS                  "127.0.0.1"
+
+/**
+ * @brief Length of #BROKER_ADDRESS.
+ */
+#define BROKER_ADDRESS_LENGTH           ( sizeof( BROKER_ADDRESS ) - 1U )
+
+/**
+ * @brief Number of simulated connections of the load test.
+ */
+#define LOAD_CONNECTION_COUNT           ( 1000U )
+
+/**
+ * @brief Number of worker threads of the reactor in the load test.
+ */
+#define LOAD_WORKER_COUNT               ( 4U )
+
+/**
+ * @brief Number of PUBLISH packets each connection has echoed by the broker
+ * stand-in, one at a time.
+ */
+#define LOAD_MESSAGES_PER_CONNECTION    ( 10U )
+
+/**
+ * @brief Idle interval after which a connection sends a PINGREQ.
+ */
+#define KEEP_ALIVE_INTERVAL_MS          ( 100U )
+
+/**
+ * @brief Time allowed for all connections to complete their exchange.
+ */
+#define LOAD_TIMEOUT_MS                 ( 30000L )
+
+/**
+ * @brief Size of the packet buffers of the connections and the broker
+ * stand-in. Packets have a single-byte remaining length.
+ */
+#define PACKET_BUFFER_SIZE              ( 64U )
+
+/**
+ * @brief Length of the fixed header of the packets exchanged.
+ */
+#define FIXED_HEADER_LENGTH             ( 2U )
+
+/**
+ * @brief MQTT packet types, as the first byte of the fixed header.
+ */
+#define MQTT_PACKET_CONNECT             ( 0x10U )
+#define MQTT_PACKET_CONNACK             ( 0x20U )
+#define MQTT_PACKET_PUBLISH             ( 0x30U )
+#define MQTT_PACKET_PINGREQ             ( 0xC0U )
+#define MQTT_PACKET_PINGRESP            ( 0xD0U )
+#define MQTT_PACKET_DISCONNECT          ( 0xE0U )
+
+/**
+ * @brief Interval at which the broker stand-in checks for the end of a test.
+ */
+#define BROKER_POLL_INTERVAL_MS         ( 50 )
+
+/**
+ * @brief Interval at which the test checks for the completion of the load.
+ */
+#define COMPLETION_POLL_INTERVAL_US     ( 10000U )
+
+/**
+ * @brief Number of nanoseconds in a millisecond.
+ */
+#define NANOSECONDS_PER_MILLISECOND     ( 1000000L )
+
+/**
+ * @brief Number of milliseconds in a second.
+ */
+#define MILLISECONDS_PER_SECOND         ( 1000L )
+
+/*-----------------------------------------------------------*/
+
+/* Each compilation unit must define the NetworkContext struct. */
+struct NetworkContext
+{
+    PlaintextParams_t * pParams;
+};
+
+/**
+ * @brief A simulated connection, driven by the callbacks of the reactor.
+ */
+typedef struct LoadConnection
+{
+    NetworkContext_t networkContext;
+    PlaintextParams_t plaintextParams;
+    TransportReactorEntry_t entry;
+    uint8_t buffer[ PACKET_BUFFER_SIZE ]; /**< @brief Bytes of a packet received in part. */
+    size_t bufferLength;
+    uint32_t inCallback;                  /**< @brief Set while a callback of the connection runs. */
+    uint32_t echoCount;                   /**< @brief Number of PUBLISH packets echoed back. */
+    uint32_t pingResponseCount;
+    uint32_t seenEvents;                  /**< @brief Events reported to the callbacks of the connection. */
+    uint8_t isConnected;
+    uint8_t isComplete;
+    uint8_t unregisterFromCallback;       /**< @brief Return 1 from the callback once complete. */
+} LoadConnection_t;
+
+/**
+ * @brief A connection accepted by the broker stand-in.
+ */
+typedef struct BrokerConnection
+{
+    int socket;
+    uint8_t buffer[ PACKET_BUFFER_SIZE ];
+    size_t bufferLength;
+} BrokerConnection_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The simulated connections and the registration slots of the reactor.
+ */
+static LoadConnection_t connections[ LOAD_CONNECTION_COUNT ];
+static TransportReactorSlot_t slots[ LOAD_CONNECTION_COUNT ];
+static TransportReactor_t reactor;
+
+/**
+ * @brief Connections of the broker stand-in, and the poll set covering them
+ * and the listening socket.
+ */
+static BrokerConnection_t brokerConnections[ LOAD_CONNECTION_COUNT ];
+static struct pollfd brokerPollFds[ LOAD_CONNECTION_COUNT + 1U ];
+static size_t brokerConnectionCount = 0U;
+
+/**
+ * @brief Listening socket and port of the broker stand-in, and its thread.
+ */
+static int brokerSocket = -1;
+static uint16_t brokerPort = 0U;
+static pthread_t brokerThread;
+static uint32_t isBrokerStopping = 0U;
+
+/**
+ * @brief Counters updated by the callbacks of all connections.
+ */
+static uint32_t completedCount = 0U;
+static uint32_t callbackCount = 0U;
+static uint32_t overlapCount = 0U;
+static uint32_t sequenceErrorCount = 0U;
+static uint32_t transportErrorCount = 0U;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Handles the packets received by the broker stand-in on a
+ * connection, answering CONNECT, PUBLISH and PINGREQ as a broker would.
+ *
+ * @param[in] pConnection The connection.
+ *
+ * @return false if the connection must be closed.
+ */
+static bool serveBrokerConnection( BrokerConnection_t * pConnection );
+
+/**
+ * @brief Thread routine of the broker stand-in.
+ *
+ * @param[in] pArgs Unused.
+ *
+ * @return Always NULL.
+ */
+static void * brokerThreadRoutine( void * pArgs );
+
+/**
+ * @brief Sends a packet on a simulated connection.
+ *
+ * @param[in] pConnection The connection.
+ * @param[in] pPacket The packet.
+ * @param[in] packetLength Length of the packet.
+ */
+static void sendPacket( LoadConnection_t * pConnection,
+                        const uint8_t * pPacket,
+                        size_t packetLength );
+
+/**
+ * @brief Sends a QoS 0 PUBLISH carrying a sequence number.
+ *
+ * @param[in] pConnection The connection.
+ * @param[in] sequence The sequence number.
+ */
+static void sendPublish( LoadConnection_t * pConnection,
+                         uint32_t sequence );
+
+/**
+ * @brief Handles a packet received by a simulated connection.
+ *
+ * @param[in] pConnection The connection.
+ * @param[in] pPacket The packet, including its fixed header.
+ */
+static void handlePacket( LoadConnection_t * pConnection,
+                          const uint8_t * pPacket );
+
+/**
+ * @brief Reactor callback of the simulated connections.
+ *
+ * Reads the packets received, sends the next PUBLISH on each echo and a
+ * PINGREQ when the connection is idle.
+ *
+ * @param[in] pEntry Registration of the connection.
+ * @param[in] readyEvents Events reported by the reactor.
+ *
+ * @return 1 to unregister a completed connection that unregisters from its
+ * callback; 0 otherwise.
+ */
+static int32_t connectionCallback( TransportReactorEntry_t * pEntry,
+                                   uint32_t readyEvents );
+
+/**
+ * @brief Connects a simulated connection to the broker stand-in and sends
+ * its CONNECT packet.
+ *
+ * @param[in] pConnection The connection.
+ */
+static void connectToBroker( LoadConnection_t * pConnection );
+
+/**
+ * @brief Returns the time elapsed since a point in time, in milliseconds.
+ *
+ * @param[in] pStart The point in time, on the monotonic clock.
+ *
+ * @return Elapsed milliseconds.
+ */
+static long getElapsedMs( const struct timespec * pStart );
+
+/*-----------------------------------------------------------*/
+
+static bool serveBrokerConnection( BrokerConnection_t * pConnection )
+{
+    static const uint8_t connack[] = { MQTT_PACKET_CONNACK, 0x02U, 0x00U, 0x00U };
+    static const uint8_t pingresp[] = { MQTT_PACKET_PINGRESP, 0x00U };
+    ssize_t bytesReceived = 0;
+    size_t packetLength = 0U;
+    bool isOpen = true;
+
+    bytesReceived = recv( pConnection->socket,
+                          &pConnection->buffer[ pConnection->bufferLength ],
+                          PACKET_BUFFER_SIZE - pConnection->bufferLength,
+                          MSG_DONTWAIT );
+
+    if( bytesReceived > 0 )
+    {
+        pConnection->bufferLength += ( size_t ) bytesReceived;
+    }
+    else if( ( bytesReceived == 0 ) || ( ( errno != EAGAIN ) && ( errno != EWOULDBLOCK ) ) )
+    {
+        isOpen = false;
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    /* Assertions are left to the test thread; a connection that is not
+     * served as expected is closed, and fails to complete its exchange. */
+    while( ( isOpen == true ) && ( pConnection->bufferLength >= FIXED_HEADER_LENGTH ) )
+    {
+        /* The connections only send packets of a single-byte remaining
+         * length, which fit in the buffer. */
+        packetLength = FIXED_HEADER_LENGTH + pConnection->buffer[ 1 ];
+
+        if( ( packetLength > PACKET_BUFFER_SIZE ) || ( ( pConnection->buffer[ 1 ] & 0x80U ) != 0U ) )
+        {
+            isOpen = false;
+            break;
+        }
+
+        if( pConnection->bufferLength < packetLength )
+        {
+            break;
+        }
+
+        /* The replies are small enough to never fill the send buffer. */
+        switch( pConnection->buffer[ 0 ] & 0xF0U )
+        {
+            case MQTT_PACKET_CONNECT:
+                isOpen = ( send( pConnection->socket, connack, sizeof( connack ), 0 ) == ( ssize_t ) sizeof( connack ) );
+                break;
+
+            case MQTT_PACKET_PUBLISH:
+                isOpen = ( send( pConnection->socket, pConnection->buffer, packetLength, 0 ) == ( ssize_t ) packetLength );
+                break;
+
+            case MQTT_PACKET_PINGREQ:
+                isOpen = ( send( pConnection->socket, pingresp, sizeof( pingresp ), 0 ) == ( ssize_t ) sizeof( pingresp ) );
+                break;
+
+            default:
+                /* DISCONNECT, or any other packet, ends the connection. */
+                isOpen = false;
+                break;
+        }
+
+        pConnection->bufferLength -= packetLength;
+        ( void ) memmove( pConnection->buffer,
+                          &pConnection->buffer[ packetLength ],
+                          pConnection->bufferLength );
+    }
+
+    return isOpen;
+}
+
+/*-----------------------------------------------------------*/
+
+static void * brokerThreadRoutine( void * pArgs )
+{
+    size_t index = 0U;
+    int connectionSocket = -1;
+
+    ( void ) pArgs;
+
+    brokerPollFds[ 0 ].fd = brokerSocket;
+    brokerPollFds[ 0 ].events = POLLIN;
+
+    while( __atomic_load_n( &isBrokerStopping, __ATOMIC_ACQUIRE ) == 0U )
+    {
+        if( poll( brokerPollFds, brokerConnectionCount + 1U, BROKER_POLL_INTERVAL_MS ) <= 0 )
+        {
+            continue;
+        }
+
+        if( ( brokerPollFds[ 0 ].revents & POLLIN ) != 0 )
+        {
+            connectionSocket = accept( brokerSocket, NULL, NULL );
+
+            if( ( connectionSocket >= 0 ) && ( brokerConnectionCount == LOAD_CONNECTION_COUNT ) )
+            {
+                ( void ) close( connectionSocket );
+            }
+            else if( connectionSocket >= 0 )
+            {
+                brokerConnections[ brokerConnectionCount ].socket = connectionSocket;
+                brokerConnections[ brokerConnectionCount ].bufferLength = 0U;
+                brokerPollFds[ brokerConnectionCount + 1U ].fd = connectionSocket;
+                brokerPollFds[ brokerConnectionCount + 1U ].events = POLLIN;
+                brokerConnectionCount++;
+            }
+        }
+
+        for( index = 0U; index < brokerConnectionCount; index++ )
+        {
+            if( ( brokerPollFds[ index + 1U ].revents & ( POLLIN | POLLHUP | POLLERR ) ) != 0 )
+            {
+                if( serveBrokerConnection( &brokerConnections[ index ] ) == false )
+                {
+                    /* A negative descriptor is ignored by poll. */
+                    ( void ) close( brokerConnections[ index ].socket );
+                    brokerPollFds[ index + 1U ].fd = -1;
+                }
+            }
+        }
+    }
+
+    for( index = 0U; index < brokerConnectionCount; index++ )
+    {
+        if( brokerPollFds[ index + 1U ].fd >= 0 )
+        {
+            ( void ) close( brokerConnections[ index ].socket );
+        }
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static void sendPacket( LoadConnection_t * pConnection,
+                        const uint8_t * pPacket,
+                        size_t packetLength )
+{
+    int32_t bytesSent = Plaintext_Send( &pConnection->networkContext, pPacket, packetLength );
+
+    if( bytesSent != ( int32_t ) packetLength )
+    {
+        ( void ) __atomic_add_fetch( &transportErrorCount, 1U, __ATOMIC_RELAXED );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void sendPublish( LoadConnection_t * pConnection,
+                         uint32_t sequence )
+{
+    /* Topic "load", followed by the sequence number as the payload. */
+    uint8_t publish[] = { MQTT_PACKET_PUBLISH, 0x0AU, 0x00U, 0x04U, 'l', 'o', 'a', 'd',
+                          0x00U, 0x00U, 0x00U, 0x00U };
+
+    publish[ 8 ] = ( uint8_t ) ( sequence >> 24 );
+    publish[ 9 ] = ( uint8_t ) ( sequence >> 16 );
+    publish[ 10 ] = ( uint8_t ) ( sequence >> 8 );
+    publish[ 11 ] = ( uint8_t ) sequence;
+
+    sendPacket( pConnection, publish, sizeof( publish ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static void handlePacket( LoadConnection_t * pConnection,
+                          const uint8_t * pPacket )
+{
+    uint32_t sequence = 0U;
+
+    switch( pPacket[ 0 ] & 0xF0U )
+    {
+        case MQTT_PACKET_CONNACK:
+            pConnection->isConnected = 1U;
+            sendPublish( pConnection, 0U );
+            break;
+
+        case MQTT_PACKET_PUBLISH:
+            sequence = ( ( uint32_t ) pPacket[ 8 ] << 24 ) | ( ( uint32_t ) pPacket[ 9 ] << 16 ) |
+                       ( ( uint32_t ) pPacket[ 10 ] << 8 ) | ( uint32_t ) pPacket[ 11 ];
+
+            if( sequence != pConnection->echoCount )
+            {
+                ( void ) __atomic_add_fetch( &sequenceErrorCount, 1U, __ATOMIC_RELAXED );
+            }
+
+            pConnection->echoCount++;
+
+            if( pConnection->echoCount < LOAD_MESSAGES_PER_CONNECTION )
+            {
+                sendPublish( pConnection, pConnection->echoCount );
+            }
+
+            break;
+
+        case MQTT_PACKET_PINGRESP:
+            pConnection->pingResponseCount++;
+            break;
+
+        default:
+            ( void ) __atomic_add_fetch( &sequenceErrorCount, 1U, __ATOMIC_RELAXED );
+            break;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t connectionCallback( TransportReactorEntry_t * pEntry,
+                                   uint32_t readyEvents )
+{
+    static const uint8_t pingreq[] = { MQTT_PACKET_PINGREQ, 0x00U };
+    LoadConnection_t * pConnection = ( LoadConnection_t * ) pEntry->pUserContext;
+    int32_t bytesReceived = 0;
+    size_t packetLength = 0U;
+    int32_t result = 0;
+
+    ( void ) __atomic_add_fetch( &callbackCount, 1U, __ATOMIC_RELAXED );
+
+    /* The reactor must not run two callbacks of a connection at once. */
+    if( __atomic_exchange_n( &pConnection->inCallback, 1U, __ATOMIC_ACQUIRE ) != 0U )
+    {
+        ( void ) __atomic_add_fetch( &overlapCount, 1U, __ATOMIC_RELAXED );
+    }
+
+    pConnection->seenEvents |= readyEvents;
+
+    if( ( readyEvents & TRANSPORT_REACTOR_EVENT_ERROR ) != 0U )
+    {
+        ( void ) __atomic_add_fetch( &transportErrorCount, 1U, __ATOMIC_RELAXED );
+    }
+
+    if( readyEvents == 0U )
+    {
+        /* Idle for KEEP_ALIVE_INTERVAL_MS. */
+        if( pConnection->isConnected == 1U )
+        {
+            sendPacket( pConnection, pingreq, sizeof( pingreq ) );
+        }
+    }
+    else
+    {
+        /* Read until no data is left, as the connection is only reported
+         * again once more data arrives. */
+        do
+        {
+            bytesReceived = Plaintext_Recv( &pConnection->networkContext,
+                                            &pConnection->buffer[ pConnection->bufferLength ],
+                                            PACKET_BUFFER_SIZE - pConnection->bufferLength );
+
+            if( bytesReceived > 0 )
+            {
+                pConnection->bufferLength += ( size_t ) bytesReceived;
+            }
+
+            while( pConnection->bufferLength >= FIXED_HEADER_LENGTH )
+            {
+                packetLength = FIXED_HEADER_LENGTH + pConnection->buffer[ 1 ];
+
+                if( pConnection->bufferLength < packetLength )
+                {
+                    break;
+                }
+
+                handlePacket( pConnection, pConnection->buffer );
+                pConnection->bufferLength -= packetLength;
+                ( void ) memmove( pConnection->buffer,
+                                  &pConnection->buffer[ packetLength ],
+                                  pConnection->bufferLength );
+            }
+        } while( bytesReceived > 0 );
+    }
+
+    /* Complete once every message is echoed and a keep-alive answered. */
+    if( ( pConnection->isComplete == 0U ) &&
+        ( pConnection->echoCount == LOAD_MESSAGES_PER_CONNECTION ) &&
+        ( pConnection->pingResponseCount > 0U ) )
+    {
+        pConnection->isComplete = 1U;
+        result = ( int32_t ) pConnection->unregisterFromCallback;
+        ( void ) __atomic_add_fetch( &completedCount, 1U, __ATOMIC_RELEASE );
+    }
+
+    __atomic_store_n( &pConnection->inCallback, 0U, __ATOMIC_RELEASE );
+
+    return result;
+}
+
+/*-----------------------------------------------------------*/
+
+static void connectToBroker( LoadConnection_t * pConnection )
+{
+    /* MQTT 3.1.1 CONNECT with a clean session and an empty client
+     * identifier. */
+    static const uint8_t connect[] = { MQTT_PACKET_CONNECT, 0x0CU, 0x00U, 0x04U, 'M', 'Q', 'T', 'T',
+                                       0x04U, 0x02U, 0x00U, 0x3CU, 0x00U, 0x00U };
+    ServerInfo_t serverInfo = { 0 };
+
+    serverInfo.pHostName = BROKER_ADDRESS;
+    serverInfo.hostNameLength = BROKER_ADDRESS_LENGTH;
+    serverInfo.port = brokerPort;
+    pConnection->networkContext.pParams = &pConnection->plaintextParams;
+
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, Plaintext_Connect( &pConnection->networkContext,
+                                                           &serverInfo,
+                                                           TRANSPORT_SEND_RECV_TIMEOUT_MS,
+                                                           TRANSPORT_SEND_RECV_TIMEOUT_MS ) );
+
+    /* Callbacks must not wait for data. */
+    pConnection->plaintextParams.nonBlocking = 1U;
+
+    /* Sent before registering, so that no keep-alive can precede it. */
+    sendPacket( pConnection, connect, sizeof( connect ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static long getElapsedMs( const struct timespec * pStart )
+{
+    struct timespec now;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ( ( now.tv_sec - pStart->tv_sec ) * MILLISECONDS_PER_SECOND ) +
+           ( ( now.tv_nsec - pStart->tv_nsec ) / NANOSECONDS_PER_MILLISECOND );
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    struct sockaddr_in address = { 0 };
+    socklen_t addressLength = sizeof( address );
+    struct rlimit fileLimit = { 0 };
+
+    /* Both ends of every connection are open in this process. */
+    TEST_ASSERT_EQUAL( 0, getrlimit( RLIMIT_NOFILE, &fileLimit ) );
+
+    if( fileLimit.rlim_cur < fileLimit.rlim_max )
+    {
+        fileLimit.rlim_cur = fileLimit.rlim_max;
+        ( void ) setrlimit( RLIMIT_NOFILE, &fileLimit );
+    }
+
+    TEST_ASSERT_TRUE( fileLimit.rlim_cur > ( ( 2U * LOAD_CONNECTION_COUNT ) + 64U ) );
+
+    ( void ) memset( connections, 0, sizeof( connections ) );
+    brokerConnectionCount = 0U;
+    completedCount = 0U;
+    callbackCount = 0U;
+    overlapCount = 0U;
+    sequenceErrorCount = 0U;
+    transportErrorCount = 0U;
+
+    brokerSocket = socket( AF_INET, SOCK_STREAM, 0 );
+    TEST_ASSERT_NOT_EQUAL( -1, brokerSocket );
+    address.sin_family = AF_INET;
+    TEST_ASSERT_EQUAL( 1, inet_pton( AF_INET, BROKER_ADDRESS, &address.sin_addr ) );
+    TEST_ASSERT_EQUAL( 0, bind( brokerSocket, ( struct sockaddr * ) &address, sizeof( address ) ) );
+    TEST_ASSERT_EQUAL( 0, listen( brokerSocket, ( int ) LOAD_CONNECTION_COUNT ) );
+    TEST_ASSERT_EQUAL( 0, getsockname( brokerSocket, ( struct sockaddr * ) &address, &addressLength ) );
+    brokerPort = ntohs( address.sin_port );
+
+    __atomic_store_n( &isBrokerStopping, 0U, __ATOMIC_RELEASE );
+    TEST_ASSERT_EQUAL( 0, pthread_create( &brokerThread, NULL, brokerThreadRoutine, NULL ) );
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+    __atomic_store_n( &isBrokerStopping, 1U, __ATOMIC_RELEASE );
+    ( void ) pthread_join( brokerThread, NULL );
+    ( void ) close( brokerSocket );
+}
+
+/* ========================== Test Cases ============================ */
+
+/**
+ * @brief Runs #LOAD_CONNECTION_COUNT connections from #LOAD_WORKER_COUNT
+ * worker threads, and verifies that every connection completes its exchange,
+ * including a keep-alive sent when idle, and that the callbacks of a
+ * connection never run concurrently.
+ */
+void test_TransportReactor_LoadManyConnections( void )
+{
+    static const uint8_t disconnect[] = { MQTT_PACKET_DISCONNECT, 0x00U };
+    LoadConnection_t * pConnection = NULL;
+    struct timespec start;
+    long elapsedMs = 0L;
+    size_t index = 0U;
+
+    TEST_ASSERT_EQUAL( TRANSPORT_REACTOR_SUCCESS,
+                       TransportReactor_Init( &reactor, slots, LOAD_CONNECTION_COUNT, LOAD_WORKER_COUNT ) );
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+
+    for( index = 0U; index < LOAD_CONNECTION_COUNT; index++ )
+    {
+        pConnection = &connections[ index ];
+        connectToBroker( pConnection );
+
+        /* Half of the connections unregister from their callback. */
+        pConnection->unregisterFromCallback = ( uint8_t ) ( index % 2U );
+        pConnection->entry.socketDescriptor = pConnection->plaintextParams.socketDescriptor;
+        pConnection->entry.interestEvents = TRANSPORT_REACTOR_EVENT_READABLE;
+        pConnection->entry.idleIntervalMs = KEEP_ALIVE_INTERVAL_MS;
+        pConnection->entry.callback = connectionCallback;
+        pConnection->entry.pNetworkContext = &pConnection->networkContext;
+        pConnection->entry.pUserContext = pConnection;
+        TEST_ASSERT_EQUAL( TRANSPORT_REACTOR_SUCCESS, TransportReactor_Register( &reactor, &pConnection->entry ) );
+    }
+
+    while( ( __atomic_load_n( &completedCount, __ATOMIC_ACQUIRE ) < LOAD_CONNECTION_COUNT ) &&
+           ( getElapsedMs( &start ) < LOAD_TIMEOUT_MS ) )
+    {
+        ( void ) usleep( COMPLETION_POLL_INTERVAL_US );
+    }
+
+    elapsedMs = getElapsedMs( &start );
+
+    for( index = 0U; index < LOAD_CONNECTION_COUNT; index++ )
+    {
+        pConnection = &connections[ index ];
+
+        /* Connections that unregistered from their callback are no longer
+         * registered; checking one of them is enough. */
+        if( pConnection->unregisterFromCallback == 0U )
+        {
+            TEST_ASSERT_EQUAL( TRANSPORT_REACTOR_SUCCESS, TransportReactor_Unregister( &reactor, &pConnection->entry ) );
+        }
+        else if( index == 1U )
+        {
+            TEST_ASSERT_EQUAL( TRANSPORT_REACTOR_INVALID_PARAMETER, TransportReactor_Unregister( &reactor, &pConnection->entry ) );
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+
+        pConnection->plaintextParams.nonBlocking = 0U;
+        sendPacket( pConnection, disconnect, sizeof( disconnect ) );
+        ( void ) Plaintext_Disconnect( &pConnection->networkContext );
+    }
+
+    TEST_ASSERT_EQUAL( TRANSPORT_REACTOR_SUCCESS, TransportReactor_Deinit( &reactor ) );
+
+    LogInfo( ( "%u connections completed %u echoes each and a keep-alive in %ld ms "
+               "with %u worker threads (%u callbacks).",
+               ( unsigned int ) completedCount,
+               LOAD_MESSAGES_PER_CONNECTION,
+               elapsedMs,
+               LOAD_WORKER_COUNT,
+               ( unsigned int ) callbackCount ) );
+
+    TEST_ASSERT_EQUAL( LOAD_CONNECTION_COUNT, completedCount );
+    TEST_ASSERT_EQUAL( 0U, overlapCount );
+    TEST_ASSERT_EQUAL( 0U, sequenceErrorCount );
+    TEST_ASSERT_EQUAL( 0U, transportErrorCount );
+
+    for( index = 0U; index < LOAD_CONNECTION_COUNT; index++ )
+    {
+        TEST_ASSERT_EQUAL( LOAD_MESSAGES_PER_CONNECTION, connections[ index ].echoCount );
+    }
+}
+
+/**
+ * @brief Verifies that a reactor without worker threads reports the
+ * readiness of a connection through #TransportReactor_Dispatch, writable
+ * first and readable once data arrives.
+ */
+void test_TransportReactor_DispatchWithoutWorkers( void )
+{
+    static const uint8_t pingreq[] = { MQTT_PACKET_PINGREQ, 0x00U };
+    LoadConnection_t * pConnection = &connections[ 0 ];
+    struct timespec start;
+
+    TEST_ASSERT_EQUAL( TRANSPORT_REACTOR_SUCCESS,
+                       TransportReactor_Init( &reactor, slots, 1U, 0U ) );
+
+    connectToBroker( pConnection );
+    pConnection->entry.socketDescriptor = pConnection->plaintextParams.socketDescriptor;
+    pConnection->entry.interestEvents = TRANSPORT_REACTOR_EVENT_WRITABLE;
+    pConnection->entry.callback = connectionCallback;
+    pConnection->entry.pNetworkContext = &pConnection->networkContext;
+    pConnection->entry.pUserContext = pConnection;
+    TEST_ASSERT_EQUAL( TRANSPORT_REACTOR_SUCCESS, TransportReactor_Register( &reactor, &pConnection->entry ) );
+
+    /* A second registration does not fit in the single slot. */
+    connections[ 1 ].entry = pConnection->entry;
+    TEST_ASSERT_EQUAL( TRANSPORT_REACTOR_NO_FREE_SLOT, TransportReactor_Register( &reactor, &connections[ 1 ].entry ) );
+
+    /* The callback reads the CONNACK as it is invoked on any event. */
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &start );
+
+    while( ( pConnection->isConnected == 0U ) && ( getElapsedMs( &start ) < LOAD_TIMEOUT_MS ) )
+    {
+        TEST_ASSERT_GREATER_OR_EQUAL( 0, TransportReactor_Dispatch( &reactor, KEEP_ALIVE_INTERVAL_MS ) );
+    }
+
+    TEST_ASSERT_EQUAL( 1U, pConnection->isConnected );
+    TEST_ASSERT_BITS_HIGH( TRANSPORT_REACTOR_EVENT_WRITABLE, pConnection->seenEvents );
+
+    /* Once readable only, the connection is reported after its echoes. */
+    TEST_ASSERT_EQUAL( TRANSPORT_REACTOR_SUCCESS, TransportReactor_Unregister( &reactor, &pConnection->entry ) );
+    pConnection->entry.interestEvents = TRANSPORT_REACTOR_EVENT_READABLE;
+    pConnection->seenEvents = 0U;
+    TEST_ASSERT_EQUAL( TRANSPORT_REACTOR_SUCCESS, TransportReactor_Register( &reactor, &pConnection->entry ) );
+
+    while( ( pConnection->echoCount < LOAD_MESSAGES_PER_CONNECTION ) && ( getElapsedMs( &start ) < LOAD_TIMEOUT_MS ) )
+    {
+        TEST_ASSERT_GREATER_OR_EQUAL( 0, TransportReactor_Dispatch( &reactor, KEEP_ALIVE_INTERVAL_MS ) );
+    }
+
+    TEST_ASSERT_EQUAL( LOAD_MESSAGES_PER_CONNECTION, pConnection->echoCount );
+
+    sendPacket( pConnection, pingreq, sizeof( pingreq ) );
+
+    while( ( pConnection->pingResponseCount == 0U ) && ( getElapsedMs( &start ) < LOAD_TIMEOUT_MS ) )
+    {
+        TEST_ASSERT_GREATER_OR_EQUAL( 0, TransportReactor_Dispatch( &reactor, KEEP_ALIVE_INTERVAL_MS ) );
+    }
+
+    TEST_ASSERT_EQUAL( 1U, pConnection->pingResponseCount );
+    TEST_ASSERT_EQUAL( TRANSPORT_REACTOR_EVENT_READABLE, pConnection->seenEvents );
+    TEST_ASSERT_EQUAL( TRANSPORT_REACTOR_SUCCESS, TransportReactor_Unregister( &reactor, &pConnection->entry ) );
+    ( void ) Plaintext_Disconnect( &pConnection->networkContext );
+    TEST_ASSERT_EQUAL( TRANSPORT_REACTOR_SUCCESS, TransportReactor_Deinit( &reactor ) );
+
+    TEST_ASSERT_EQUAL( 0U, overlapCount );
+    TEST_ASSERT_EQUAL( 0U, transportErrorCount );
+}
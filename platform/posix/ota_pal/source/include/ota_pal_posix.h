@@ -171,6 +171,18 @@ OtaPalStatus_t otaPal_ActivateNewImage( OtaFileContext_t * const C );
 
 OtaPalStatus_t otaPal_ResetDevice( OtaFileContext_t * const C );
 
+/**
+ * @brief Drop the cached code signer key.
+ *
+ * The public key of the signer certificate is kept between signature checks
+ * and is loaded again when the certificate file changes path, modification
+ * time or size. Call this after replacing the certificate in a way that keeps
+ * these unchanged, or after changing the built-in certificate, so that the
+ * next signature check loads the certificate again. It is safe to call while
+ * a file is being checked.
+ */
+void otaPal_ReloadSignerCertificate( void );
+
 /**
  * @brief Attempt to set the state of the OTA update image.
  *
@@ -31,6 +31,10 @@
 #include <assert.h>
 #include <libgen.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "ota.h"
 #include "ota_pal_posix.h"
@@ -56,9 +60,39 @@
 static const char signingcredentialSIGNING_CERTIFICATE_PEM[] = "Paste code signing certificate here";
 
 /**
- * @brief Size of buffer used in file operations on this platform (POSIX).
+ * @brief Number of blocks that can be queued for writing by the write-behind
+ * thread. otaPal_WriteBlock only waits for storage when the queue is full.
+ * Set to 0 to write blocks on the caller's thread.
  */
-#define OTA_PAL_POSIX_BUF_SIZE           ( ( size_t ) 4096U )
+#ifndef OTA_PAL_WRITE_QUEUE_LENGTH
+    #define OTA_PAL_WRITE_QUEUE_LENGTH    ( 8U )
+#endif
+
+/**
+ * @brief Size of each buffer of the write-behind queue. Blocks larger than
+ * this are written on the caller's thread, after the queue is drained.
+ */
+#ifndef OTA_PAL_WRITE_BUFFER_SIZE
+    #define OTA_PAL_WRITE_BUFFER_SIZE    ( 4096U )
+#endif
+
+/**
+ * @brief Set to 1 to reserve storage for the whole image when the receive
+ * file is created, so that running out of space is detected before the
+ * download and the file is laid out contiguously.
+ */
+#ifndef OTA_PAL_PREALLOCATE_FILE
+    #define OTA_PAL_PREALLOCATE_FILE    ( 1 )
+#endif
+
+/**
+ * @brief Set to 1 to hash the image as its blocks are received in order, so
+ * that closing the file only has to check the signature. The file is hashed
+ * when it is closed if a block is received out of order.
+ */
+#ifndef OTA_PAL_STREAMING_DIGEST
+    #define OTA_PAL_STREAMING_DIGEST    ( 1 )
+#endif
 
 /**
  * @brief Name of the file used for storing platform image state.
@@ -70,6 +104,173 @@ static const char signingcredentialSIGNING_CERTIFICATE_PEM[] = "Paste code signi
  */
 const char OTA_JsonFileSignatureKey[ OTA_FILE_SIG_KEY_STR_MAX_LENGTH ] = "sig-sha256-ecdsa";
 
+#if ( OTA_PAL_WRITE_QUEUE_LENGTH > 0U )
+
+/**
+ * @brief A block waiting to be written by the write-behind thread.
+ */
+    typedef struct OtaPalQueuedBlock
+    {
+        uint32_t offset;
+        uint32_t size;
+        uint8_t data[ OTA_PAL_WRITE_BUFFER_SIZE ];
+    } OtaPalQueuedBlock_t;
+
+/**
+ * @brief State of the write-behind thread of the receive file.
+ *
+ * The OTA agent receives a single file at a time, so a single writer is kept.
+ */
+    typedef struct OtaPalWriter
+    {
+        pthread_t thread;
+        pthread_mutex_t mutex;
+        pthread_cond_t notEmpty;  /**< Signalled when a block is queued or the writer must stop. */
+        pthread_cond_t notFull;   /**< Signalled when a queued block has been written. */
+        int fileDescriptor;
+        bool isRunning;
+        bool stopRequested;
+        bool isWriting;           /**< True while the block at head is being written. */
+        int writeError;           /**< errno of the first failed write, 0 if none. */
+        size_t head;
+        size_t count;
+        OtaPalQueuedBlock_t blocks[ OTA_PAL_WRITE_QUEUE_LENGTH ];
+    } OtaPalWriter_t;
+
+/**
+ * @brief The write-behind thread state.
+ */
+    static OtaPalWriter_t writer =
+    {
+        .mutex    = PTHREAD_MUTEX_INITIALIZER,
+        .notEmpty = PTHREAD_COND_INITIALIZER,
+        .notFull  = PTHREAD_COND_INITIALIZER
+    };
+
+/**
+ * @brief Start the write-behind thread for a receive file.
+ */
+    static bool startWriter( FILE * pFile );
+
+/**
+ * @brief Write the queued blocks and stop the write-behind thread.
+ *
+ * @return 0 if all blocks were written, otherwise the errno of the first
+ * failed write.
+ */
+    static int stopWriter( void );
+
+/**
+ * @brief Drop the queued blocks that are not being written yet, and stop the
+ * write-behind thread.
+ */
+    static void discardWriter( void );
+
+/**
+ * @brief Wait until all queued blocks are written.
+ */
+    static void drainWriter( void );
+
+/**
+ * @brief Thread routine writing the queued blocks.
+ */
+    static void * writerThread( void * pArgs );
+
+/**
+ * @brief Queue a block for the write-behind thread.
+ *
+ * @return The size of the block if it was queued or written; -1 if it, or a
+ * block queued earlier, failed to be written.
+ */
+    static int32_t queueBlock( OtaFileContext_t * const C,
+                               uint32_t ulOffset,
+                               const uint8_t * pcData,
+                               uint32_t ulBlockSize );
+
+#endif /* if ( OTA_PAL_WRITE_QUEUE_LENGTH > 0U ) */
+
+/**
+ * @brief SHA-256 digest of the receive file, updated as blocks are received.
+ *
+ * The OTA agent receives a single file at a time, so a single digest is kept.
+ */
+typedef struct OtaPalDigest
+{
+    EVP_MD_CTX * pContext; /**< Digest of the bytes before nextOffset. */
+    uint32_t nextOffset;   /**< Offset of the block that continues the digest. */
+    bool isStreaming;      /**< False if the digest does not cover the received blocks. */
+} OtaPalDigest_t;
+
+/**
+ * @brief The digest of the receive file.
+ */
+static OtaPalDigest_t receiveDigest = { 0 };
+
+/**
+ * @brief Public key of the code signer, kept across signature checks.
+ *
+ * Bundle updates check many files signed by the same signer, so the signer
+ * certificate is parsed once and parsed again only when its file changes.
+ */
+typedef struct OtaPalSignerCache
+{
+    pthread_mutex_t mutex;
+    EVP_PKEY_CTX * pVerifyTemplate; /**< Verify context of the signer key, NULL if none is cached. */
+    char certFilePath[ OTA_FILE_PATH_LENGTH_MAX ];
+    bool isFromFile;                /**< False if the key is from the built-in PEM string. */
+    struct timespec modifiedTime;   /**< Modification time of the certificate file. */
+    off_t fileSize;
+    ino_t fileInode;
+} OtaPalSignerCache_t;
+
+/**
+ * @brief The cached signer, shared by every OTA file context.
+ */
+static OtaPalSignerCache_t signerCache = { .mutex = PTHREAD_MUTEX_INITIALIZER };
+
+/**
+ * @brief Start hashing a new receive file.
+ */
+static void startDigest( void );
+
+/**
+ * @brief Include a received block in the digest of the receive file, or stop
+ * hashing as blocks are received if it is out of order.
+ */
+static void updateDigest( uint32_t ulOffset,
+                          const uint8_t * pcData,
+                          uint32_t ulBlockSize );
+
+/**
+ * @brief Get the SHA-256 digest of the whole receive file, from the blocks
+ * hashed as they were received, or else by hashing the file through mmap.
+ *
+ * @return true on success; false otherwise.
+ */
+static bool finishDigest( FILE * pFile,
+                          uint8_t * pDigest,
+                          unsigned int * pDigestLength );
+
+/**
+ * @brief Write a block to the receive file on the caller's thread.
+ *
+ * @return The size of the block on success, -1 on failure.
+ */
+static int32_t writeBlockToFile( OtaFileContext_t * const C,
+                                 uint32_t ulOffset,
+                                 const uint8_t * pcData,
+                                 uint32_t ulBlockSize );
+
+/**
+ * @brief Write a whole buffer at an offset of a file.
+ *
+ * @return 0 on success, otherwise errno.
+ */
+static int writeAtOffset( int fileDescriptor,
+                          const uint8_t * pData,
+                          size_t size,
+                          uint32_t offset );
+
 /**
  * @brief Read the specified signer certificate from the filesystem into a local buffer. The allocated
  * memory becomes the property of the caller who is responsible for freeing it.
@@ -77,11 +278,27 @@ const char OTA_JsonFileSignatureKey[ OTA_FILE_SIG_KEY_STR_MAX_LENGTH ] = "sig-sh
 static EVP_PKEY * Openssl_GetPkeyFromCertificate( uint8_t * pCertFilePath );
 
 /**
- * @brief Verify the signature of the input content with OpenSSL.
+ * @brief Get a verify context for the signer of the certificate file, from
+ * the signer cache if the file has not changed since it was parsed.
+ *
+ * @return A context prepared for ECDSA-SHA256 verification, to be freed by
+ * the caller; NULL if the signer certificate could not be loaded.
  */
-static OtaPalMainStatus_t Openssl_DigestVerify( EVP_MD_CTX * pSigContext,
-                                                EVP_PKEY * pPkey,
-                                                FILE * pFile,
+static EVP_PKEY_CTX * getSignerVerifyContext( uint8_t * pCertFilePath );
+
+/**
+ * @brief Free the signer kept in the cache.
+ *
+ * Must be called with signerCache.mutex held.
+ */
+static void clearSignerCache( void );
+
+/**
+ * @brief Verify the signature of a SHA-256 digest with OpenSSL.
+ */
+static OtaPalMainStatus_t Openssl_DigestVerify( EVP_PKEY_CTX * pVerifyContext,
+                                                const uint8_t * pDigest,
+                                                unsigned int digestLength,
                                                 Sig_t * pSignature );
 
 /**
@@ -100,6 +317,292 @@ static OtaPalPathGenStatus_t getFilePathFromCWD( char * realFilePath,
 
 /*-----------------------------------------------------------*/
 
+static int writeAtOffset( int fileDescriptor,
+                          const uint8_t * pData,
+                          size_t size,
+                          uint32_t offset )
+{
+    ssize_t written = 0;
+    size_t totalWritten = 0U;
+    int error = 0;
+
+    while( ( error == 0 ) && ( totalWritten < size ) )
+    {
+        written = pwrite( fileDescriptor,
+                          &pData[ totalWritten ],
+                          size - totalWritten,
+                          ( off_t ) offset + ( off_t ) totalWritten );
+
+        if( written > 0 )
+        {
+            totalWritten += ( size_t ) written;
+        }
+        else if( ( written < 0 ) && ( errno == EINTR ) )
+        {
+            /* Interrupted before writing anything; retry. */
+        }
+        else
+        {
+            error = ( written < 0 ) ? errno : EIO;
+        }
+    }
+
+    return error;
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t writeBlockToFile( OtaFileContext_t * const C,
+                                 uint32_t ulOffset,
+                                 const uint8_t * pcData,
+                                 uint32_t ulBlockSize )
+{
+    int32_t filerc = 0;
+    size_t writeSize = 0;
+
+    /* POSIX port using standard library */
+    /* coverity[misra_c_2012_rule_21_6_violation] */
+    filerc = fseek( C->pFile, ( int64_t ) ulOffset, SEEK_SET );
+
+    if( 0 == filerc )
+    {
+        /* POSIX port using standard library */
+        /* coverity[misra_c_2012_rule_21_6_violation] */
+        writeSize = fwrite( pcData, 1, ulBlockSize, C->pFile );
+
+        if( writeSize != ulBlockSize )
+        {
+            LogError( ( "Failed to write block to file: "
+                        "fwrite returned error: "
+                        "errno=%d", errno ) );
+
+            filerc = -1;
+        }
+        else
+        {
+            filerc = ( int32_t ) writeSize;
+        }
+    }
+    else
+    {
+        LogError( ( "fseek failed. fseek returned errno = %d", errno ) );
+        filerc = -1;
+    }
+
+    return filerc;
+}
+
+/*-----------------------------------------------------------*/
+
+#if ( OTA_PAL_WRITE_QUEUE_LENGTH > 0U )
+
+    static void * writerThread( void * pArgs )
+    {
+        OtaPalQueuedBlock_t * pBlock = NULL;
+        int error = 0;
+        bool exitThread = false;
+
+        ( void ) pArgs;
+
+        while( exitThread == false )
+        {
+            ( void ) pthread_mutex_lock( &writer.mutex );
+
+            while( ( writer.count == 0U ) && ( writer.stopRequested == false ) )
+            {
+                ( void ) pthread_cond_wait( &writer.notEmpty, &writer.mutex );
+            }
+
+            if( writer.count == 0U )
+            {
+                exitThread = true;
+                pBlock = NULL;
+            }
+            else
+            {
+                /* The block stays in the queue, so that its buffer is not
+                 * reused, until it has been written. */
+                pBlock = &writer.blocks[ writer.head ];
+                writer.isWriting = true;
+            }
+
+            ( void ) pthread_mutex_unlock( &writer.mutex );
+
+            if( pBlock != NULL )
+            {
+                error = writeAtOffset( writer.fileDescriptor, pBlock->data, pBlock->size, pBlock->offset );
+
+                ( void ) pthread_mutex_lock( &writer.mutex );
+
+                if( ( error != 0 ) && ( writer.writeError == 0 ) )
+                {
+                    LogError( ( "Failed to write block to file: "
+                                "pwrite returned error: offset=%u, errno=%d",
+                                ( unsigned int ) pBlock->offset, error ) );
+                    writer.writeError = error;
+                }
+
+                writer.isWriting = false;
+                writer.head = ( writer.head + 1U ) % OTA_PAL_WRITE_QUEUE_LENGTH;
+                writer.count--;
+                ( void ) pthread_cond_broadcast( &writer.notFull );
+                ( void ) pthread_mutex_unlock( &writer.mutex );
+            }
+        }
+
+        return NULL;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static int32_t queueBlock( OtaFileContext_t * const C,
+                               uint32_t ulOffset,
+                               const uint8_t * pcData,
+                               uint32_t ulBlockSize )
+    {
+        int32_t filerc = 0;
+        int error = 0;
+        OtaPalQueuedBlock_t * pBlock = NULL;
+        bool isQueued = false;
+
+        ( void ) pthread_mutex_lock( &writer.mutex );
+
+        /* Wait for storage only when the queue is full. */
+        while( ( writer.count == OTA_PAL_WRITE_QUEUE_LENGTH ) && ( writer.writeError == 0 ) )
+        {
+            ( void ) pthread_cond_wait( &writer.notFull, &writer.mutex );
+        }
+
+        if( writer.writeError != 0 )
+        {
+            /* A block queued earlier failed to be written. */
+            filerc = -1;
+            isQueued = true;
+        }
+        else if( ulBlockSize <= OTA_PAL_WRITE_BUFFER_SIZE )
+        {
+            pBlock = &writer.blocks[ ( writer.head + writer.count ) % OTA_PAL_WRITE_QUEUE_LENGTH ];
+            pBlock->offset = ulOffset;
+            pBlock->size = ulBlockSize;
+            ( void ) memcpy( pBlock->data, pcData, ulBlockSize );
+            writer.count++;
+            ( void ) pthread_cond_signal( &writer.notEmpty );
+
+            filerc = ( int32_t ) ulBlockSize;
+            isQueued = true;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+
+        ( void ) pthread_mutex_unlock( &writer.mutex );
+
+        if( isQueued == false )
+        {
+            /* The block does not fit in a queue buffer. Write it on this
+             * thread, after the blocks queued before it. */
+            drainWriter();
+            error = writeAtOffset( fileno( C->pFile ), pcData, ulBlockSize, ulOffset );
+
+            if( error == 0 )
+            {
+                filerc = ( int32_t ) ulBlockSize;
+            }
+            else
+            {
+                LogError( ( "Failed to write block to file: "
+                            "pwrite returned error: "
+                            "errno=%d", error ) );
+                filerc = -1;
+            }
+        }
+
+        return filerc;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static bool startWriter( FILE * pFile )
+    {
+        bool started = false;
+
+        ( void ) stopWriter();
+
+        writer.fileDescriptor = fileno( pFile );
+        writer.stopRequested = false;
+        writer.isWriting = false;
+        writer.writeError = 0;
+        writer.head = 0U;
+        writer.count = 0U;
+
+        if( pthread_create( &writer.thread, NULL, writerThread, NULL ) == 0 )
+        {
+            writer.isRunning = true;
+            started = true;
+        }
+        else
+        {
+            LogWarn( ( "Failed to start the OTA write-behind thread. Writing blocks synchronously." ) );
+        }
+
+        return started;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void drainWriter( void )
+    {
+        ( void ) pthread_mutex_lock( &writer.mutex );
+
+        while( writer.count > 0U )
+        {
+            ( void ) pthread_cond_wait( &writer.notFull, &writer.mutex );
+        }
+
+        ( void ) pthread_mutex_unlock( &writer.mutex );
+    }
+
+/*-----------------------------------------------------------*/
+
+    static int stopWriter( void )
+    {
+        int error = 0;
+
+        if( writer.isRunning == true )
+        {
+            ( void ) pthread_mutex_lock( &writer.mutex );
+            writer.stopRequested = true;
+            ( void ) pthread_cond_signal( &writer.notEmpty );
+            ( void ) pthread_mutex_unlock( &writer.mutex );
+
+            /* The thread writes all queued blocks before exiting. */
+            ( void ) pthread_join( writer.thread, NULL );
+            writer.isRunning = false;
+            error = writer.writeError;
+        }
+
+        return error;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void discardWriter( void )
+    {
+        ( void ) pthread_mutex_lock( &writer.mutex );
+
+        /* The block being written is still owned by the thread, which
+         * removes it from the queue once written. */
+        writer.count = ( writer.isWriting == true ) ? 1U : 0U;
+        ( void ) pthread_mutex_unlock( &writer.mutex );
+
+        ( void ) stopWriter();
+    }
+
+#endif /* if ( OTA_PAL_WRITE_QUEUE_LENGTH > 0U ) */
+
+/*-----------------------------------------------------------*/
+
 static EVP_PKEY * Openssl_GetPkeyFromCertificate( uint8_t * pCertFilePath )
 {
     BIO * pBio = NULL;
@@ -177,117 +680,243 @@ static EVP_PKEY * Openssl_GetPkeyFromCertificate( uint8_t * pCertFilePath )
 }
 
 
-static OtaPalMainStatus_t Openssl_DigestVerifyStart( EVP_MD_CTX * pSigContext,
-                                                     EVP_PKEY * pPkey,
-                                                     FILE * pFile,
-                                                     uint8_t ** pBuf )
+static void startDigest( void )
 {
-    OtaPalMainStatus_t mainErr = OtaPalSignatureCheckFailed;
+    receiveDigest.nextOffset = 0U;
+    receiveDigest.isStreaming = false;
 
-    assert( pBuf != NULL );
-    assert( ( pSigContext != NULL ) && ( pPkey != NULL ) );
+    #if ( OTA_PAL_STREAMING_DIGEST == 1 )
+        if( receiveDigest.pContext == NULL )
+        {
+            receiveDigest.pContext = EVP_MD_CTX_new();
+        }
 
-    /* Verify an ECDSA-SHA256 signature. */
-    if( ( pFile != NULL ) &&
-        ( 1 == EVP_DigestVerifyInit( pSigContext, NULL, EVP_sha256(), NULL, pPkey ) ) )
-    {
-        LogDebug( ( "Started signature verification." ) );
+        if( ( receiveDigest.pContext != NULL ) &&
+            ( 1 == EVP_DigestInit_ex( receiveDigest.pContext, EVP_sha256(), NULL ) ) )
+        {
+            receiveDigest.isStreaming = true;
+        }
+        else
+        {
+            LogWarn( ( "Failed to start the digest. The file is hashed when it is closed." ) );
+        }
+    #endif
+}
 
-        *pBuf = OPENSSL_malloc( OTA_PAL_POSIX_BUF_SIZE );
+/*-----------------------------------------------------------*/
 
-        if( *pBuf == NULL )
+static void updateDigest( uint32_t ulOffset,
+                          const uint8_t * pcData,
+                          uint32_t ulBlockSize )
+{
+    if( receiveDigest.isStreaming == true )
+    {
+        if( ulOffset != receiveDigest.nextOffset )
         {
-            LogError( ( "Failed to allocate buffer memory." ) );
-            mainErr = OtaPalOutOfMemory;
+            LogDebug( ( "Block at offset %u received out of order. The file is hashed when it is closed.",
+                        ( unsigned int ) ulOffset ) );
+            receiveDigest.isStreaming = false;
+        }
+        else if( 1 != EVP_DigestUpdate( receiveDigest.pContext, pcData, ulBlockSize ) )
+        {
+            LogWarn( ( "Failed to update the digest. The file is hashed when it is closed." ) );
+            receiveDigest.isStreaming = false;
         }
         else
         {
-            mainErr = OtaPalSuccess;
+            receiveDigest.nextOffset += ulBlockSize;
         }
     }
-    else
-    {
-        LogError( ( "File signature check failed at INIT." ) );
-    }
-
-    return mainErr;
 }
 
-static bool Openssl_DigestVerifyUpdate( EVP_MD_CTX * pSigContext,
-                                        FILE * pFile,
-                                        uint8_t * pBuf )
+/*-----------------------------------------------------------*/
+
+static bool finishDigest( FILE * pFile,
+                          uint8_t * pDigest,
+                          unsigned int * pDigestLength )
 {
-    size_t bytesRead;
+    bool result = false;
+    struct stat fileStat;
+    EVP_MD_CTX * pContext = NULL;
+    void * pMapping = MAP_FAILED;
 
-    do
+    if( fstat( fileno( pFile ), &fileStat ) != 0 )
     {
-        /* POSIX port using standard library */
-        /* coverity[misra_c_2012_rule_21_6_violation] */
-        bytesRead = fread( pBuf, 1U, OTA_PAL_POSIX_BUF_SIZE, pFile );
+        LogError( ( "Failed to get the size of the file: errno=%d", errno ) );
+    }
+    else if( ( receiveDigest.isStreaming == true ) &&
+             ( ( off_t ) receiveDigest.nextOffset == fileStat.st_size ) )
+    {
+        /* Every byte of the file was hashed as it was received. */
+        result = ( 1 == EVP_DigestFinal_ex( receiveDigest.pContext, pDigest, pDigestLength ) );
+    }
+    else
+    {
+        LogDebug( ( "Hashing the received file." ) );
 
-        assert( bytesRead <= OTA_PAL_POSIX_BUF_SIZE );
+        pContext = EVP_MD_CTX_new();
 
-        /* feof returns non-zero if end of file is reached, otherwise it returns 0. When
-         * bytesRead is not equal to OTA_PAL_POSIX_BUF_SIZE, we should be reading last
-         * chunk and reach to end of file. */
+        if( fileStat.st_size > 0 )
+        {
+            pMapping = mmap( NULL, ( size_t ) fileStat.st_size, PROT_READ, MAP_PRIVATE, fileno( pFile ), 0 );
 
-        /* POSIX port using standard library */
-        /* coverity[misra_c_2012_rule_21_6_violation] */
-        if( ( bytesRead < OTA_PAL_POSIX_BUF_SIZE ) && ( 0 == feof( pFile ) ) )
+            if( pMapping == MAP_FAILED )
+            {
+                LogError( ( "Failed to map the file: errno=%d", errno ) );
+            }
+            else
+            {
+                ( void ) madvise( pMapping, ( size_t ) fileStat.st_size, MADV_SEQUENTIAL );
+            }
+        }
+
+        if( ( pContext != NULL ) &&
+            ( ( pMapping != MAP_FAILED ) || ( fileStat.st_size == 0 ) ) &&
+            ( 1 == EVP_DigestInit_ex( pContext, EVP_sha256(), NULL ) ) &&
+            ( ( pMapping == MAP_FAILED ) ||
+              ( 1 == EVP_DigestUpdate( pContext, pMapping, ( size_t ) fileStat.st_size ) ) ) &&
+            ( 1 == EVP_DigestFinal_ex( pContext, pDigest, pDigestLength ) ) )
         {
-            break;
+            result = true;
         }
 
-        /* Include the file chunk in the signature validation. Zero size is OK. */
-        if( 1 != EVP_DigestVerifyUpdate( pSigContext, pBuf, bytesRead ) )
+        if( pMapping != MAP_FAILED )
         {
-            break;
+            ( void ) munmap( pMapping, ( size_t ) fileStat.st_size );
         }
-    } while( bytesRead > 0UL );
 
-    /* POSIX port using standard library */
-    /* coverity[misra_c_2012_rule_21_6_violation] */
-    return( 0 != feof( pFile ) ? true : false );
+        EVP_MD_CTX_free( pContext );
+    }
+
+    receiveDigest.isStreaming = false;
+
+    return result;
 }
 
-static OtaPalMainStatus_t Openssl_DigestVerify( EVP_MD_CTX * pSigContext,
-                                                EVP_PKEY * pPkey,
-                                                FILE * pFile,
-                                                Sig_t * pSignature )
+/*-----------------------------------------------------------*/
+
+static void clearSignerCache( void )
 {
-    OtaPalMainStatus_t mainErr = OtaPalSignatureCheckFailed;
-    OtaPalMainStatus_t startErr;
-    uint8_t * pBuf;
+    EVP_PKEY_CTX_free( signerCache.pVerifyTemplate );
+    signerCache.pVerifyTemplate = NULL;
+    signerCache.certFilePath[ 0 ] = '\0';
+}
+
+/*-----------------------------------------------------------*/
 
-    startErr = Openssl_DigestVerifyStart( pSigContext, pPkey, pFile, &pBuf );
+static EVP_PKEY_CTX * getSignerVerifyContext( uint8_t * pCertFilePath )
+{
+    EVP_PKEY_CTX * pVerifyContext = NULL;
+    EVP_PKEY * pPkey = NULL;
+    struct stat certStat;
+    bool isFromFile = false;
+    bool isCached = false;
 
-    if( OtaPalSuccess == startErr )
+    assert( pCertFilePath != NULL );
+
+    ( void ) pthread_mutex_lock( &signerCache.mutex );
+
+    /* The certificate is read from the built-in PEM string when there is no
+     * such file, so a missing file is as much part of the key as its mtime. */
+    isFromFile = ( stat( ( const char * ) pCertFilePath, &certStat ) == 0 );
+
+    if( signerCache.pVerifyTemplate != NULL )
     {
-        /* Rewind the received file to the beginning. */
-        /* POSIX port using standard library */
-        /* coverity[misra_c_2012_rule_21_6_violation] */
-        if( fseek( pFile, 0L, SEEK_SET ) == 0 )
+        if( isFromFile == false )
+        {
+            isCached = ( signerCache.isFromFile == false );
+        }
+        else
+        {
+            isCached = ( signerCache.isFromFile == true ) &&
+                       ( strncmp( signerCache.certFilePath, ( const char * ) pCertFilePath, OTA_FILE_PATH_LENGTH_MAX ) == 0 ) &&
+                       ( signerCache.modifiedTime.tv_sec == certStat.st_mtim.tv_sec ) &&
+                       ( signerCache.modifiedTime.tv_nsec == certStat.st_mtim.tv_nsec ) &&
+                       ( signerCache.fileSize == certStat.st_size ) &&
+                       ( signerCache.fileInode == certStat.st_ino );
+        }
+    }
+
+    if( isCached == false )
+    {
+        clearSignerCache();
+
+        LogDebug( ( "Loading the signer certificate." ) );
+        pPkey = Openssl_GetPkeyFromCertificate( pCertFilePath );
+
+        if( pPkey != NULL )
         {
-            bool eof = Openssl_DigestVerifyUpdate( pSigContext, pFile, pBuf );
+            signerCache.pVerifyTemplate = EVP_PKEY_CTX_new( pPkey, NULL );
 
-            if( ( eof == true ) && ( 1 == EVP_DigestVerifyFinal( pSigContext,
-                                                                 pSignature->data,
-                                                                 pSignature->size ) ) )
+            if( signerCache.pVerifyTemplate == NULL )
             {
-                mainErr = OtaPalSuccess;
+                LogError( ( "Failed to create a verify context for the signer key." ) );
+            }
+            else if( ( 1 != EVP_PKEY_verify_init( signerCache.pVerifyTemplate ) ) ||
+                     ( 1 != EVP_PKEY_CTX_set_signature_md( signerCache.pVerifyTemplate, EVP_sha256() ) ) )
+            {
+                LogError( ( "Failed to prepare the verify context of the signer key." ) );
+                clearSignerCache();
+            }
+            else if( isFromFile == true )
+            {
+                ( void ) strncpy( signerCache.certFilePath, ( const char * ) pCertFilePath, OTA_FILE_PATH_LENGTH_MAX - 1U );
+                signerCache.certFilePath[ OTA_FILE_PATH_LENGTH_MAX - 1U ] = '\0';
+                signerCache.isFromFile = true;
+                signerCache.modifiedTime = certStat.st_mtim;
+                signerCache.fileSize = certStat.st_size;
+                signerCache.fileInode = certStat.st_ino;
             }
             else
             {
-                LogError( ( "File signature check failed at FINAL" ) );
+                signerCache.isFromFile = false;
             }
+
+            /* The verify context holds its own reference to the key. */
+            EVP_PKEY_free( pPkey );
         }
+    }
 
-        /* Free the temporary file page buffer. */
-        OPENSSL_free( pBuf );
+    /* Each check gets its own copy, so the template is never used by two
+     * threads at once. */
+    if( signerCache.pVerifyTemplate != NULL )
+    {
+        pVerifyContext = EVP_PKEY_CTX_dup( signerCache.pVerifyTemplate );
+
+        if( pVerifyContext == NULL )
+        {
+            LogError( ( "Failed to copy the verify context of the signer key." ) );
+        }
+    }
+
+    ( void ) pthread_mutex_unlock( &signerCache.mutex );
+
+    return pVerifyContext;
+}
+
+/*-----------------------------------------------------------*/
+
+static OtaPalMainStatus_t Openssl_DigestVerify( EVP_PKEY_CTX * pVerifyContext,
+                                                const uint8_t * pDigest,
+                                                unsigned int digestLength,
+                                                Sig_t * pSignature )
+{
+    OtaPalMainStatus_t mainErr = OtaPalSignatureCheckFailed;
+
+    assert( pVerifyContext != NULL );
+
+    /* Verify an ECDSA-SHA256 signature of the digest. */
+    if( 1 == EVP_PKEY_verify( pVerifyContext,
+                              pSignature->data,
+                              pSignature->size,
+                              pDigest,
+                              digestLength ) )
+    {
+        mainErr = OtaPalSuccess;
     }
     else
     {
-        mainErr = startErr;
+        LogError( ( "File signature check failed at FINAL" ) );
     }
 
     return mainErr;
@@ -296,38 +925,32 @@ static OtaPalMainStatus_t Openssl_DigestVerify( EVP_MD_CTX * pSigContext,
 static OtaPalStatus_t otaPal_CheckFileSignature( OtaFileContext_t * const C )
 {
     OtaPalMainStatus_t mainErr = OtaPalSignatureCheckFailed;
-    EVP_PKEY * pPkey = NULL;
-    EVP_MD_CTX * pSigContext = NULL;
+    EVP_PKEY_CTX * pVerifyContext = NULL;
+    uint8_t digest[ EVP_MAX_MD_SIZE ];
+    unsigned int digestLength = 0U;
 
     assert( C != NULL );
 
-    /* Extract the signer cert from the file. */
-    pPkey = Openssl_GetPkeyFromCertificate( C->pCertFilepath );
+    /* Get the key of the signer cert. */
+    pVerifyContext = getSignerVerifyContext( C->pCertFilepath );
 
-    /* Create a new signature context for verification purpose. */
-    pSigContext = EVP_MD_CTX_new();
-
-    if( ( pPkey != NULL ) && ( pSigContext != NULL ) )
+    if( pVerifyContext == NULL )
     {
-        /* Verify the signature. */
-        mainErr = Openssl_DigestVerify( pSigContext, pPkey, C->pFile, C->pSignature );
+        LogError( ( "File signature check failed at EXTRACT pkey from signer certificate." ) );
+        mainErr = OtaPalBadSignerCert;
+    }
+    else if( finishDigest( C->pFile, digest, &digestLength ) == false )
+    {
+        LogError( ( "File signature check failed at DIGEST." ) );
     }
     else
     {
-        if( pSigContext == NULL )
-        {
-            LogError( ( "File signature check failed at NEW sig context." ) );
-        }
-        else
-        {
-            LogError( ( "File signature check failed at EXTRACT pkey from signer certificate." ) );
-            mainErr = OtaPalBadSignerCert;
-        }
+        /* Verify the signature. */
+        mainErr = Openssl_DigestVerify( pVerifyContext, digest, digestLength, C->pSignature );
     }
 
     /* Free up objects */
-    EVP_MD_CTX_free( pSigContext );
-    EVP_PKEY_free( pPkey );
+    EVP_PKEY_CTX_free( pVerifyContext );
 
     return OTA_PAL_COMBINE_ERR( mainErr, 0 );
 }
@@ -378,6 +1001,13 @@ OtaPalStatus_t otaPal_Abort( OtaFileContext_t * const C )
         /* Close the OTA update file if it's open. */
         if( NULL != C->pFile )
         {
+            #if ( OTA_PAL_WRITE_QUEUE_LENGTH > 0U )
+                /* The aborted file is not used, so the queued blocks are
+                 * dropped rather than written. The write-behind thread uses
+                 * the file until it stops. */
+                discardWriter();
+            #endif
+
             /* POSIX port using standard library */
             /* coverity[misra_c_2012_rule_21_6_violation] */
             lFileCloseResult = fclose( C->pFile );
@@ -442,6 +1072,23 @@ OtaPalStatus_t otaPal_CreateFileForRx( OtaFileContext_t * const C )
 
                 if( C->pFile != NULL )
                 {
+                    #if ( OTA_PAL_PREALLOCATE_FILE == 1 )
+                        if( ( C->fileSize > 0U ) &&
+                            ( posix_fallocate( fileno( C->pFile ), 0, ( off_t ) C->fileSize ) != 0 ) )
+                        {
+                            /* Not fatal: blocks are still written, and a lack of
+                             * space is then reported when writing them. */
+                            LogWarn( ( "Failed to reserve %u bytes for the receive file.",
+                                       ( unsigned int ) C->fileSize ) );
+                        }
+                    #endif
+
+                    #if ( OTA_PAL_WRITE_QUEUE_LENGTH > 0U )
+                        ( void ) startWriter( C->pFile );
+                    #endif
+
+                    startDigest();
+
                     result = OTA_PAL_COMBINE_ERR( OtaPalSuccess, 0 );
                     LogInfo( ( "Receive file created." ) );
                 }
@@ -476,13 +1123,34 @@ OtaPalStatus_t otaPal_CreateFileForRx( OtaFileContext_t * const C )
 OtaPalStatus_t otaPal_CloseFile( OtaFileContext_t * const C )
 {
     int32_t filerc = 0;
+    int writeError = 0;
     OtaPalMainStatus_t mainErr = OtaPalSuccess;
     OtaPalSubStatus_t subErr = 0;
     OtaPalStatus_t result;
 
     if( C != NULL )
     {
-        if( C->pSignature != NULL )
+        #if ( OTA_PAL_WRITE_QUEUE_LENGTH > 0U )
+            /* Write the queued blocks before reading the file back. */
+            writeError = stopWriter();
+        #endif
+
+        /* Make sure the image is on storage before it is marked for testing. */
+        /* POSIX port using standard library */
+        /* coverity[misra_c_2012_rule_21_6_violation] */
+        if( ( writeError == 0 ) &&
+            ( ( fflush( C->pFile ) != 0 ) || ( fsync( fileno( C->pFile ) ) != 0 ) ) )
+        {
+            writeError = errno;
+        }
+
+        if( writeError != 0 )
+        {
+            LogError( ( "Failed to write OTA update file: errno=%d", writeError ) );
+            mainErr = OtaPalFileClose;
+            subErr = ( uint32_t ) writeError;
+        }
+        else if( C->pSignature != NULL )
         {
             /* Verify the file signature, close the file and return the signature verification result. */
             result = otaPal_CheckFileSignature( C );
@@ -540,37 +1208,25 @@ int16_t otaPal_WriteBlock( OtaFileContext_t * const C,
                            uint32_t ulBlockSize )
 {
     int32_t filerc = 0;
-    size_t writeSize = 0;
 
     if( C != NULL )
     {
-        /* POSIX port using standard library */
-        /* coverity[misra_c_2012_rule_21_6_violation] */
-        filerc = fseek( C->pFile, ( int64_t ) ulOffset, SEEK_SET );
-
-        if( 0 == filerc )
-        {
-            /* POSIX port using standard library */
-            /* coverity[misra_c_2012_rule_21_6_violation] */
-            writeSize = fwrite( pcData, 1, ulBlockSize, C->pFile );
-
-            if( writeSize != ulBlockSize )
+        #if ( OTA_PAL_WRITE_QUEUE_LENGTH > 0U )
+            if( writer.isRunning == true )
             {
-                LogError( ( "Failed to write block to file: "
-                            "fwrite returned error: "
-                            "errno=%d", errno ) );
-
-                filerc = -1;
+                filerc = queueBlock( C, ulOffset, pcData, ulBlockSize );
             }
             else
             {
-                filerc = ( int32_t ) writeSize;
+                filerc = writeBlockToFile( C, ulOffset, pcData, ulBlockSize );
             }
-        }
-        else
+        #else
+            filerc = writeBlockToFile( C, ulOffset, pcData, ulBlockSize );
+        #endif
+
+        if( filerc == ( int32_t ) ulBlockSize )
         {
-            LogError( ( "fseek failed. fseek returned errno = %d", errno ) );
-            filerc = -1;
+            updateDigest( ulOffset, pcData, ulBlockSize );
         }
     }
     else /* Invalid context or file pointer provided. */
@@ -665,6 +1321,13 @@ OtaPalStatus_t otaPal_SetPlatformImageState( OtaFileContext_t * const C,
     return OTA_PAL_COMBINE_ERR( mainErr, subErr );
 }
 
+void otaPal_ReloadSignerCertificate( void )
+{
+    ( void ) pthread_mutex_lock( &signerCache.mutex );
+    clearSignerCache();
+    ( void ) pthread_mutex_unlock( &signerCache.mutex );
+}
+
 OtaPalStatus_t otaPal_ResetDevice( OtaFileContext_t * const C )
 {
     ( void ) C;
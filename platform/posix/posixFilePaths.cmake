@@ -9,6 +9,10 @@
 set( SOCKETS_SOURCES
      ${CMAKE_CURRENT_LIST_DIR}/transport/src/sockets_posix.c )
 
+# Transport reactor source files.
+set( TRANSPORT_REACTOR_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/transport/src/transport_reactor_posix.c )
+
 # Plaintext transport source files.
 set( PLAINTEXT_TRANSPORT_SOURCES
      ${CMAKE_CURRENT_LIST_DIR}/transport/src/plaintext_posix.c )
@@ -75,6 +75,43 @@ typedef struct OpensslParams
 {
     int32_t socketDescriptor;
     SSL * pSsl;
+
+    /**
+     * @brief Shared SSL context from which @ref OpensslParams.pSsl was created.
+     *
+     * @note This is managed by #Openssl_Connect and #Openssl_Disconnect and
+     * must not be modified by the application.
+     */
+    struct OpensslCachedContext * pCachedContext;
+
+    /**
+     * @brief Set by #Openssl_Connect to 1 if the TLS session was resumed from
+     * a cached session, 0 if a full handshake was performed.
+     */
+    uint8_t sessionResumed;
+
+    /**
+     * @brief Optional buffer, provided by the application, holding decrypted
+     * data read ahead of the reads of the application. NULL to call SSL_read
+     * with the size requested by every call to #Openssl_Recv.
+     *
+     * coreMQTT decodes the type and remaining length of a packet a few bytes
+     * at a time; with this buffer, each SSL_read returns a full TLS record
+     * and these small reads are served from memory.
+     *
+     * @note Like data reported by SSL_pending, data held in this buffer is
+     * not covered by readiness of the socket. Applications waiting for the
+     * socket to become readable must first read until #Openssl_Recv
+     * returns 0.
+     *
+     * @note #Openssl_Connect does not set this member or
+     * #OpensslParams_t.recvBufferSize, so the structure must be
+     * zero-initialized when no buffer is provided.
+     */
+    uint8_t * pRecvBuffer;
+    size_t recvBufferSize;   /**< @brief Size of #OpensslParams_t.pRecvBuffer. */
+    size_t recvBufferOffset; /**< @brief Offset of the first unread byte in the buffer. Managed by the transport. */
+    size_t recvBufferLength; /**< @brief Number of unread bytes in the buffer. Managed by the transport. */
 } OpensslParams_t;
 
 /**
@@ -138,6 +175,19 @@ typedef struct OpensslCredentials
     const char * pRootCaPath;     /**< @brief Filepath string to the trusted server root CA. */
     const char * pClientCertPath; /**< @brief Filepath string to the client certificate. */
     const char * pPrivateKeyPath; /**< @brief Filepath string to the client certificate's private key. */
+
+    /**
+     * @brief Set to 1 to resume the last TLS session established with the same
+     * server and port, using a session ID (TLS 1.2) or a session ticket (TLS 1.3).
+     *
+     * Sessions are shared by connections using the same credential files and
+     * skip the certificate exchange and key agreement of a full handshake.
+     * The server falls back to a full handshake if it no longer accepts the
+     * session.
+     *
+     * @note By setting this to 0, every connection performs a full handshake.
+     */
+    uint8_t enableSessionResumption;
 } OpensslCredentials_t;
 
 /**
@@ -151,6 +201,9 @@ typedef struct OpensslCredentials
  *
  * @note A timeout of 0 means infinite timeout.
  *
+ * @note The TCP connection is established with #Sockets_ConnectParallel,
+ * within #SOCKETS_CONNECT_TIMEOUT_MS.
+ *
  * @return #OPENSSL_SUCCESS on success;
  * #OPENSSL_INVALID_PARAMETER, #OPENSSL_INVALID_CREDENTIALS,
  * #OPENSSL_INVALID_CREDENTIALS, #OPENSSL_SYSTEM_ERROR on failure.
@@ -171,6 +224,20 @@ OpensslStatus_t Openssl_Connect( NetworkContext_t * pNetworkContext,
  */
 OpensslStatus_t Openssl_Disconnect( const NetworkContext_t * pNetworkContext );
 
+/**
+ * @brief Releases all SSL contexts held by the credential cache.
+ *
+ * #Openssl_Connect keeps the SSL context built from a set of credentials and
+ * shares it with later connections that use the same credential files. A cached
+ * context is rebuilt automatically when one of its files changes on disk; this
+ * function can be used to force every context to be rebuilt, for example after
+ * the credentials are replaced without changing the file metadata.
+ *
+ * @note Connections that are already established keep their context alive
+ * until they are closed with #Openssl_Disconnect.
+ */
+void Openssl_ClearContextCache( void );
+
 /**
  * @brief Receives data over an established TLS session using the OpenSSL API.
  *
@@ -207,6 +274,27 @@ int32_t Openssl_Send( NetworkContext_t * pNetworkContext,
                       const void * pBuffer,
                       size_t bytesToSend );
 
+/**
+ * @brief Sends several buffers over an established TLS session as a single
+ * TLS record where possible.
+ *
+ * This can be used as the #TransportInterface.writev function, so that the
+ * header, topic and payload of a PUBLISH are sent in one SSL_write instead of
+ * one TLS record each. Buffers are copied into a
+ * #OPENSSL_WRITEV_BUFFER_SIZE stack buffer; a buffer at the front of the
+ * vector that does not fit is sent without copying.
+ *
+ * @param[in] pNetworkContext The network context created using Openssl_Connect API.
+ * @param[in] pIoVec Array of buffers to send.
+ * @param[in] ioVecCount Number of buffers in @p pIoVec.
+ *
+ * @return Number of bytes sent, which may be fewer than the total length of
+ * the buffers; negative value on error.
+ */
+int32_t Openssl_Writev( NetworkContext_t * pNetworkContext,
+                        TransportOutVector_t * pIoVec,
+                        size_t ioVecCount );
+
 /* *INDENT-OFF* */
 #ifdef __cplusplus
     }
@@ -66,6 +66,32 @@
 typedef struct PlaintextParams
 {
     int32_t socketDescriptor;
+
+    /**
+     * @brief Set to 1 to use non-blocking socket calls instead of polling
+     * the socket before every send and receive.
+     *
+     * Data that cannot be sent or received right away is reported as 0 bytes,
+     * the same as when polling reports the socket as not ready.
+     */
+    uint8_t nonBlocking;
+
+    /**
+     * @brief Optional buffer, provided by the application, holding data
+     * received ahead of the reads of the application. NULL to read the socket
+     * on every call to #Plaintext_Recv.
+     *
+     * coreMQTT reads the fixed header of a packet a few bytes at a time; with
+     * this buffer, these reads are served from memory after a single recv.
+     *
+     * @note Readiness of the socket does not cover data held in this buffer.
+     * Applications waiting for the socket to become readable must first read
+     * until #Plaintext_Recv returns 0.
+     */
+    uint8_t * pRecvBuffer;
+    size_t recvBufferSize;   /**< @brief Size of #PlaintextParams_t.pRecvBuffer. */
+    size_t recvBufferOffset; /**< @brief Offset of the first unread byte in the buffer. Managed by the transport. */
+    size_t recvBufferLength; /**< @brief Number of unread bytes in the buffer. Managed by the transport. */
 } PlaintextParams_t;
 
 /**
@@ -78,6 +104,9 @@ typedef struct PlaintextParams
  *
  * @note A timeout of 0 means infinite timeout.
  *
+ * @note The connection is established with #Sockets_ConnectParallel, within
+ * #SOCKETS_CONNECT_TIMEOUT_MS.
+ *
  * @return #SOCKETS_SUCCESS if successful;
  * #SOCKETS_INVALID_PARAMETER, #SOCKETS_DNS_FAILURE, #SOCKETS_CONNECT_FAILURE on error.
  */
@@ -127,6 +156,24 @@ int32_t Plaintext_Send( NetworkContext_t * pNetworkContext,
                         const void * pBuffer,
                         size_t bytesToSend );
 
+/**
+ * @brief Sends several buffers over an established TCP connection with a
+ * single system call.
+ *
+ * This can be used as the #TransportInterface.writev function, so that the
+ * header, topic and payload of a PUBLISH go out in one sendmsg call.
+ *
+ * @param[in] pNetworkContext The network context created using Plaintext_Connect API.
+ * @param[in] pIoVec Array of buffers to send.
+ * @param[in] ioVecCount Number of buffers in @p pIoVec.
+ *
+ * @return Number of bytes sent, which may be fewer than the total length of
+ * the buffers; negative value on error.
+ */
+int32_t Plaintext_Writev( NetworkContext_t * pNetworkContext,
+                          TransportOutVector_t * pIoVec,
+                          size_t ioVecCount );
+
 /* *INDENT-OFF* */
 #ifdef __cplusplus
     }
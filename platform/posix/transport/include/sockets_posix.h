@@ -80,6 +80,32 @@ typedef struct ServerInfo
     uint16_t port;          /**< @brief Server port in host-order. */
 } ServerInfo_t;
 
+/**
+ * @brief Overall time allowed to the transports for resolving the host name of
+ * the server and connecting to it with #Sockets_ConnectParallel.
+ */
+#ifndef SOCKETS_CONNECT_TIMEOUT_MS
+    #define SOCKETS_CONNECT_TIMEOUT_MS    ( 30000U )
+#endif
+
+/**
+ * @brief Counters of the DNS cache used by #Sockets_Connect and
+ * #Sockets_ConnectParallel.
+ *
+ * @note The cache is disabled by default. It is enabled by building
+ * sockets_posix.c with SOCKETS_DNS_CACHE_TTL_MS, the time for which resolved
+ * addresses are reused, or SOCKETS_DNS_CACHE_NEGATIVE_TTL_MS, the time for
+ * which a host name that does not exist is not looked up again, set to a
+ * non-zero number of milliseconds.
+ */
+typedef struct SocketsDnsCacheStats
+{
+    uint32_t hits;          /**< @brief Lookups answered with cached addresses. */
+    uint32_t negativeHits;  /**< @brief Lookups answered with a cached resolution failure. */
+    uint32_t misses;        /**< @brief Lookups that required a DNS query. */
+    uint32_t invalidations; /**< @brief Entries dropped because no cached address could be connected to. */
+} SocketsDnsCacheStats_t;
+
 /**
  * @brief Establish a connection to server.
  *
@@ -98,6 +124,48 @@ SocketStatus_t Sockets_Connect( int32_t * pTcpSocket,
                                 uint32_t sendTimeoutMs,
                                 uint32_t recvTimeoutMs );
 
+/**
+ * @brief Establish a connection to server by racing connection attempts to
+ * the resolved addresses, within an overall deadline.
+ *
+ * The host name is resolved on a separate thread so that a slow resolver
+ * cannot hold the caller past the deadline. Non-blocking connection attempts
+ * are then started to the resolved addresses in turn, alternating between
+ * IPv6 and IPv4, with each attempt given a head start before the next one is
+ * started. The first attempt to complete is used and all others are closed,
+ * so an unreachable address only delays the connection by the head start
+ * instead of a full TCP connect timeout.
+ *
+ * @param[out] pTcpSocket The output parameter to return the created socket descriptor.
+ * @param[in] pServerInfo Server connection info.
+ * @param[in] connectTimeoutMs Overall time allowed for resolving the host name
+ * and connecting. Must be greater than 0.
+ * @param[in] sendTimeoutMs Timeout for transport send.
+ * @param[in] recvTimeoutMs Timeout for transport recv.
+ *
+ * @note A send or receive timeout of 0 means infinite timeout.
+ *
+ * @return #SOCKETS_SUCCESS if successful;
+ * #SOCKETS_INVALID_PARAMETER, #SOCKETS_DNS_FAILURE, #SOCKETS_CONNECT_FAILURE on error.
+ */
+SocketStatus_t Sockets_ConnectParallel( int32_t * pTcpSocket,
+                                        const ServerInfo_t * pServerInfo,
+                                        uint32_t connectTimeoutMs,
+                                        uint32_t sendTimeoutMs,
+                                        uint32_t recvTimeoutMs );
+
+/**
+ * @brief Read the counters of the DNS cache.
+ *
+ * @param[out] pStats Output parameter for the counters.
+ */
+void Sockets_GetDnsCacheStats( SocketsDnsCacheStats_t * pStats );
+
+/**
+ * @brief Drop all entries of the DNS cache and reset its counters.
+ */
+void Sockets_ClearDnsCache( void );
+
 /**
  * @brief End connection to server.
  *
@@ -0,0 +1,253 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef TRANSPORT_REACTOR_POSIX_H_
+#define TRANSPORT_REACTOR_POSIX_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Logging related header files are required to be included in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define LIBRARY_LOG_NAME and  LIBRARY_LOG_LEVEL.
+ * 3. Include the header file "logging_stack.h".
+ */
+
+/* Include header that defines log levels. */
+#include "logging_levels.h"
+
+/* Logging configuration for the transport reactor. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME     "Transport_Reactor"
+#endif
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_ERROR
+#endif
+
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/* *INDENT-OFF* */
+#ifdef __cplusplus
+    extern "C" {
+#endif
+/* *INDENT-ON* */
+
+/* POSIX includes. */
+#include <pthread.h>
+
+/* Transport includes. */
+#include "transport_interface.h"
+
+/**
+ * @brief Maximum number of worker threads of a reactor.
+ */
+#ifndef TRANSPORT_REACTOR_MAX_WORKERS
+    #define TRANSPORT_REACTOR_MAX_WORKERS    ( 16U )
+#endif
+
+/**
+ * @brief The connection has data to read, or the peer closed it.
+ */
+#define TRANSPORT_REACTOR_EVENT_READABLE    ( 0x01U )
+
+/**
+ * @brief The connection can accept more data to send.
+ */
+#define TRANSPORT_REACTOR_EVENT_WRITABLE    ( 0x02U )
+
+/**
+ * @brief An error or hang-up was reported on the connection.
+ */
+#define TRANSPORT_REACTOR_EVENT_ERROR       ( 0x04U )
+
+/**
+ * @brief Reactor return status.
+ */
+typedef enum TransportReactorStatus
+{
+    TRANSPORT_REACTOR_SUCCESS = 0,       /**< Function successfully completed. */
+    TRANSPORT_REACTOR_INVALID_PARAMETER, /**< At least one parameter was invalid. */
+    TRANSPORT_REACTOR_NO_FREE_SLOT,      /**< All registration slots are in use. */
+    TRANSPORT_REACTOR_API_ERROR          /**< A call to a system API resulted in an internal error. */
+} TransportReactorStatus_t;
+
+struct TransportReactorEntry;
+
+/**
+ * @brief Callback invoked when a registered connection is ready.
+ *
+ * The reactor never invokes the callback of an entry on two threads at once,
+ * so the callback may call MQTT_ProcessLoop on the MQTT context of the
+ * connection without further locking.
+ *
+ * @note The connection is only reported again once it becomes ready again
+ * after the callback returns. A callback for a TLS connection must therefore
+ * process all data already decrypted by the TLS library, for example by
+ * calling MQTT_ProcessLoop until it returns no more packets.
+ *
+ * @param[in] pEntry Registration of the connection.
+ * @param[in] readyEvents Bitwise OR of TRANSPORT_REACTOR_EVENT_* flags, or 0
+ * when the callback is invoked because the connection was idle for
+ * #TransportReactorEntry.idleIntervalMs.
+ *
+ * @return 0 to keep the connection registered; any other value to unregister
+ * it before the callback's thread moves on.
+ */
+typedef int32_t ( * TransportReactorCallback_t )( struct TransportReactorEntry * pEntry,
+                                                  uint32_t readyEvents );
+
+/**
+ * @brief Registration of a connection with a reactor, allocated by the
+ * application.
+ */
+typedef struct TransportReactorEntry
+{
+    int32_t socketDescriptor;            /**< @brief Socket of the connection. */
+    uint32_t interestEvents;             /**< @brief TRANSPORT_REACTOR_EVENT_READABLE and/or TRANSPORT_REACTOR_EVENT_WRITABLE. */
+    uint32_t idleIntervalMs;             /**< @brief Invoke the callback with no events after this long without one, e.g. to send MQTT keep-alives. 0 to disable. */
+    TransportReactorCallback_t callback; /**< @brief Callback invoked when the connection is ready. */
+    NetworkContext_t * pNetworkContext;  /**< @brief Network context of the connection, for use by the callback. */
+    void * pUserContext;                 /**< @brief Application context, for example the MQTT context. */
+    size_t slotIndex;                    /**< @brief Set by #TransportReactor_Register. */
+} TransportReactorEntry_t;
+
+/**
+ * @brief State of one registration slot. The members are private to the
+ * reactor.
+ */
+typedef struct TransportReactorSlot
+{
+    pthread_mutex_t mutex;            /**< @brief Held while the callback of the slot runs. */
+    TransportReactorEntry_t * pEntry; /**< @brief Registered entry; NULL if the slot is free. */
+    uint32_t generation;              /**< @brief Incremented when the slot is freed, to ignore stale events. */
+    uint64_t lastCallbackMs;          /**< @brief Monotonic time of the last callback. */
+    size_t nextFreeSlot;              /**< @brief Next slot in the free list. */
+} TransportReactorSlot_t;
+
+/**
+ * @brief A reactor dispatching readiness of many connections from a single
+ * epoll instance to a pool of worker threads.
+ */
+typedef struct TransportReactor
+{
+    int32_t epollDescriptor;                             /**< @brief epoll instance. */
+    int32_t wakeDescriptor;                              /**< @brief eventfd signalled to stop the workers. */
+    TransportReactorSlot_t * pSlots;                     /**< @brief Registration slots. */
+    size_t slotCount;                                    /**< @brief Number of registration slots. */
+    size_t freeSlot;                                     /**< @brief First free slot; slotCount if none. */
+    pthread_mutex_t mutex;                               /**< @brief Protects the free list and stop flag. */
+    pthread_mutex_t sweepMutex;                          /**< @brief Held by the thread checking for idle connections. */
+    uint64_t nextSweepMs;                                /**< @brief Monotonic time of the next idle check. */
+    pthread_t workers[ TRANSPORT_REACTOR_MAX_WORKERS ];  /**< @brief Worker threads. */
+    size_t workerCount;                                  /**< @brief Number of worker threads. */
+    uint8_t isStopping;                                  /**< @brief Set when the workers must exit. */
+} TransportReactor_t;
+
+/**
+ * @brief Create a reactor and start its worker threads.
+ *
+ * @param[out] pReactor Reactor to initialize.
+ * @param[in] pSlots Array of registration slots, one per connection that can
+ * be registered at a time. Must stay valid until #TransportReactor_Deinit.
+ * @param[in] slotCount Number of slots in @p pSlots.
+ * @param[in] workerCount Number of worker threads, at most
+ * #TRANSPORT_REACTOR_MAX_WORKERS. With 0, the application invokes the
+ * callbacks by calling #TransportReactor_Dispatch.
+ *
+ * @return #TRANSPORT_REACTOR_SUCCESS on success;
+ * #TRANSPORT_REACTOR_INVALID_PARAMETER, #TRANSPORT_REACTOR_API_ERROR on failure.
+ */
+TransportReactorStatus_t TransportReactor_Init( TransportReactor_t * pReactor,
+                                                TransportReactorSlot_t * pSlots,
+                                                size_t slotCount,
+                                                size_t workerCount );
+
+/**
+ * @brief Register a connection with the reactor.
+ *
+ * @param[in] pReactor Reactor created with #TransportReactor_Init.
+ * @param[in] pEntry Registration of the connection. Must stay valid until the
+ * connection is unregistered.
+ *
+ * @return #TRANSPORT_REACTOR_SUCCESS on success;
+ * #TRANSPORT_REACTOR_INVALID_PARAMETER, #TRANSPORT_REACTOR_NO_FREE_SLOT,
+ * #TRANSPORT_REACTOR_API_ERROR on failure.
+ */
+TransportReactorStatus_t TransportReactor_Register( TransportReactor_t * pReactor,
+                                                    TransportReactorEntry_t * pEntry );
+
+/**
+ * @brief Unregister a connection from the reactor.
+ *
+ * Waits for a running callback of the connection to return. Once this
+ * function returns, the callback is not invoked again and @p pEntry may be
+ * freed. It must be called before the socket of the connection is closed.
+ *
+ * @note Must not be called from the callback of the same connection; return
+ * a non-zero value from the callback instead.
+ *
+ * @param[in] pReactor Reactor the connection is registered with.
+ * @param[in] pEntry Registration of the connection.
+ *
+ * @return #TRANSPORT_REACTOR_SUCCESS on success;
+ * #TRANSPORT_REACTOR_INVALID_PARAMETER if the entry is not registered.
+ */
+TransportReactorStatus_t TransportReactor_Unregister( TransportReactor_t * pReactor,
+                                                      TransportReactorEntry_t * pEntry );
+
+/**
+ * @brief Wait for ready connections and invoke their callbacks on the calling
+ * thread.
+ *
+ * This is what each worker thread runs in a loop. It can be called by the
+ * application when the reactor was created without worker threads.
+ *
+ * @param[in] pReactor Reactor created with #TransportReactor_Init.
+ * @param[in] timeoutMs Maximum time to wait for a connection to become ready.
+ *
+ * @return Number of callbacks invoked; negative value on error.
+ */
+int32_t TransportReactor_Dispatch( TransportReactor_t * pReactor,
+                                   uint32_t timeoutMs );
+
+/**
+ * @brief Stop the worker threads and free the resources of the reactor.
+ *
+ * All connections should be unregistered first.
+ *
+ * @param[in] pReactor Reactor created with #TransportReactor_Init.
+ *
+ * @return #TRANSPORT_REACTOR_SUCCESS on success;
+ * #TRANSPORT_REACTOR_INVALID_PARAMETER on failure.
+ */
+TransportReactorStatus_t TransportReactor_Deinit( TransportReactor_t * pReactor );
+
+/* *INDENT-OFF* */
+#ifdef __cplusplus
+    }
+#endif
+/* *INDENT-ON* */
+
+#endif /* ifndef TRANSPORT_REACTOR_POSIX_H_ */
@@ -23,12 +23,17 @@
 
 /* Standard includes. */
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 
 /* POSIX socket includes. */
 #include <unistd.h>
 #include <poll.h>
 
+/* POSIX includes for the SSL context cache. */
+#include <pthread.h>
+#include <sys/stat.h>
+
 /* Transport interface include. */
 #include "transport_interface.h"
 
@@ -56,15 +61,125 @@
  */
 #define CLIENT_KEY_LABEL     "client's key"
 
+/**
+ * @brief Path to the OPTIGA Trust M provider loaded into every SSL context.
+ */
+#ifndef TRUSTM_PROVIDER_PATH
+    #define TRUSTM_PROVIDER_PATH \
+    "/home/pi/optiga-trust-m-explorer/Python_TrustM_GUI/linux-optiga-trust-m/bin/trustm_provider.so"
+#endif
+
+/**
+ * @brief Size of the stack buffer #Openssl_Writev coalesces buffers into
+ * before sending them as one TLS record.
+ */
+#ifndef OPENSSL_WRITEV_BUFFER_SIZE
+    #define OPENSSL_WRITEV_BUFFER_SIZE    ( 2048U )
+#endif
+
+/**
+ * @brief Maximum number of SSL contexts kept by the credential cache.
+ *
+ * Every distinct combination of root CA, client certificate and private key
+ * paths occupies one entry. When the cache is full, the least recently used
+ * entry is evicted.
+ */
+#ifndef OPENSSL_CONTEXT_CACHE_SIZE
+    #define OPENSSL_CONTEXT_CACHE_SIZE    ( 4U )
+#endif
+
+/**
+ * @brief Number of credential files that identify a cached SSL context.
+ */
+#define CREDENTIAL_FILE_COUNT    ( 3U )
+
+/**
+ * @brief Maximum number of servers for which a TLS session is kept by each
+ * cached SSL context.
+ */
+#ifndef OPENSSL_SESSION_CACHE_SIZE
+    #define OPENSSL_SESSION_CACHE_SIZE    ( 4U )
+#endif
+
+/**
+ * @brief Length of the decimal port and separator appended to the host name
+ * to form a session key.
+ */
+#define SESSION_KEY_PORT_LENGTH    ( 6U )
+
 /*-----------------------------------------------------------*/
 
 /* Each compilation unit must define the NetworkContext struct. */
 struct NetworkContext
 {
     OpensslParams_t * pParams;
-    OSSL_PROVIDER * pProvider;
 };
 
+/**
+ * @brief State of a credential file when its SSL context was built.
+ */
+typedef struct CredentialFileInfo
+{
+    char * pPath;                 /**< @brief Copy of the file path; NULL if the credential is unused. */
+    struct timespec modifiedTime; /**< @brief Last modification time of the file, to the nanosecond. */
+    off_t fileSize;               /**< @brief Size of the file in bytes. */
+    ino_t inode;                  /**< @brief Inode of the file, changed when the file is replaced. */
+} CredentialFileInfo_t;
+
+/**
+ * @brief Last TLS session established with a server.
+ */
+typedef struct OpensslSessionSlot
+{
+    char * pSessionKey;      /**< @brief "host:port" of the server; NULL if the slot is free. */
+    SSL_SESSION * pSession;  /**< @brief Resumable session; NULL if none was received yet. */
+    uint32_t lastUsed;       /**< @brief Value of #contextCacheClock when last used. */
+} OpensslSessionSlot_t;
+
+/**
+ * @brief SSL context shared between all connections that use the same
+ * credential files.
+ *
+ * The SSL context holds the parsed root CA store, client certificate and
+ * private key, so sharing it avoids reading and parsing the PEM files on
+ * every connection.
+ */
+typedef struct OpensslCachedContext
+{
+    CredentialFileInfo_t files[ CREDENTIAL_FILE_COUNT ]; /**< @brief Root CA, client certificate and private key files. */
+    OSSL_LIB_CTX * pLibraryContext;                      /**< @brief Library context the SSL context is created in. */
+    OSSL_PROVIDER * pDefaultProvider;                    /**< @brief Default provider loaded into the library context. */
+    OSSL_PROVIDER * pTrustMProvider;                     /**< @brief Trust M provider loaded into the library context. */
+    SSL_CTX * pSslContext;                               /**< @brief SSL context built from the credentials. */
+    OpensslSessionSlot_t sessions[ OPENSSL_SESSION_CACHE_SIZE ]; /**< @brief Sessions to resume, per server. */
+    uint32_t referenceCount;                             /**< @brief One reference for the cache slot plus one per connection. */
+    uint32_t lastUsed;                                   /**< @brief Value of #contextCacheClock when last acquired. */
+} OpensslCachedContext_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief SSL contexts cached by credential file paths.
+ */
+static OpensslCachedContext_t * contextCache[ OPENSSL_CONTEXT_CACHE_SIZE ] = { NULL };
+
+/**
+ * @brief Counter used to find the least recently used cache entry.
+ */
+static uint32_t contextCacheClock = 0U;
+
+/**
+ * @brief Mutex protecting #contextCache, the reference counts of its entries
+ * and their session slots.
+ */
+static pthread_mutex_t contextCacheMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Index of the SSL ex_data holding the session key of a connection
+ * that resumes sessions.
+ */
+static int32_t sessionKeyIndex = -1;
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -177,6 +292,166 @@ static OpensslStatus_t tlsHandshake( const ServerInfo_t * pServerInfo,
  * @return 1 on success; 0 on failure.
  */
 static int32_t isValidNetworkContext( const NetworkContext_t * pNetworkContext );
+
+/**
+ * @brief Read the identity of a credential file used to detect changes.
+ *
+ * @param[in, out] pFileInfo File whose path is set and whose state is to be read.
+ *
+ * @return 1 if the file could be read; 0 otherwise.
+ */
+static int32_t readCredentialFileInfo( CredentialFileInfo_t * pFileInfo );
+
+/**
+ * @brief Check if a cached SSL context was built from the given credential paths.
+ *
+ * @param[in] pCachedContext Cached SSL context.
+ * @param[in] pPaths Root CA, client certificate and private key paths.
+ *
+ * @return 1 if all paths match; 0 otherwise.
+ */
+static int32_t matchesCredentialPaths( const OpensslCachedContext_t * pCachedContext,
+                                       const char * const * pPaths );
+
+/**
+ * @brief Check if the credential files of a cached SSL context are unchanged
+ * since the context was built.
+ *
+ * @param[in] pCachedContext Cached SSL context.
+ *
+ * @return 1 if no file changed; 0 otherwise.
+ */
+static int32_t isCachedContextCurrent( const OpensslCachedContext_t * pCachedContext );
+
+/**
+ * @brief Build a new SSL context from the credentials.
+ *
+ * @param[in] pOpensslCredentials TLS credentials to load.
+ * @param[in] pPaths Root CA, client certificate and private key paths.
+ * @param[out] ppCachedContext The created context, with no references taken.
+ *
+ * @return #OPENSSL_SUCCESS, #OPENSSL_INSUFFICIENT_MEMORY, #OPENSSL_API_ERROR,
+ * and #OPENSSL_INVALID_CREDENTIALS.
+ */
+static OpensslStatus_t createCachedContext( const OpensslCredentials_t * pOpensslCredentials,
+                                            const char * const * pPaths,
+                                            OpensslCachedContext_t ** ppCachedContext );
+
+/**
+ * @brief Free an SSL context along with the library context and providers
+ * it was built with.
+ *
+ * @param[in] pCachedContext Context to free.
+ */
+static void destroyCachedContext( OpensslCachedContext_t * pCachedContext );
+
+/**
+ * @brief Drop a reference to a cached SSL context, freeing it when no
+ * references remain.
+ *
+ * @note #contextCacheMutex must be held by the caller.
+ *
+ * @param[in] pCachedContext Context to release.
+ */
+static void releaseCachedContextLocked( OpensslCachedContext_t * pCachedContext );
+
+/**
+ * @brief Get a reference to the SSL context for the credentials, building and
+ * caching it if no current one exists.
+ *
+ * @param[in] pOpensslCredentials TLS credentials of the connection.
+ * @param[out] ppCachedContext The referenced SSL context.
+ *
+ * @return #OPENSSL_SUCCESS, #OPENSSL_INSUFFICIENT_MEMORY, #OPENSSL_API_ERROR,
+ * and #OPENSSL_INVALID_CREDENTIALS.
+ */
+static OpensslStatus_t acquireCachedContext( const OpensslCredentials_t * pOpensslCredentials,
+                                             OpensslCachedContext_t ** ppCachedContext );
+
+/**
+ * @brief Drop a connection's reference to a cached SSL context.
+ *
+ * @param[in] pCachedContext Context to release.
+ */
+static void releaseCachedContext( OpensslCachedContext_t * pCachedContext );
+
+/**
+ * @brief Find the session slot of a server, optionally claiming a slot for it.
+ *
+ * @note #contextCacheMutex must be held by the caller.
+ *
+ * @param[in] pCachedContext SSL context owning the session slots.
+ * @param[in] pSessionKey "host:port" of the server.
+ * @param[in] create 1 to claim a free or the least recently used slot if the
+ * server has none.
+ *
+ * @return The session slot, or NULL if not found or out of memory.
+ */
+static OpensslSessionSlot_t * findSessionSlot( OpensslCachedContext_t * pCachedContext,
+                                               const char * pSessionKey,
+                                               uint8_t create );
+
+/**
+ * @brief Attach the session key of the server to the SSL object and offer the
+ * cached session of the server, if any.
+ *
+ * @param[in] pOpensslParams Connection whose SSL object has been created.
+ * @param[in] pServerInfo Server connection info.
+ *
+ * @return #OPENSSL_SUCCESS, #OPENSSL_INSUFFICIENT_MEMORY, and #OPENSSL_API_ERROR.
+ */
+static OpensslStatus_t offerCachedSession( OpensslParams_t * pOpensslParams,
+                                           const ServerInfo_t * pServerInfo );
+
+/**
+ * @brief Drop the cached session of the server of a connection.
+ *
+ * Used when a handshake offering the session failed, so that the next
+ * attempt performs a full handshake.
+ *
+ * @param[in] pSsl SSL object of the connection.
+ */
+static void discardCachedSession( SSL * pSsl );
+
+/**
+ * @brief Callback invoked by OpenSSL when a new session is established. For
+ * TLS 1.3, this happens when the server sends a session ticket after the
+ * handshake.
+ *
+ * @param[in] pSsl SSL object of the connection.
+ * @param[in] pSession The new session.
+ *
+ * @return 1 if the reference to @p pSession was kept; 0 otherwise.
+ */
+static int storeSessionCallback( SSL * pSsl,
+                                 SSL_SESSION * pSession );
+
+/**
+ * @brief Free the session key attached to an SSL object.
+ */
+static void freeSessionKey( void * pParent,
+                            void * pSessionKey,
+                            CRYPTO_EX_DATA * pExData,
+                            int index,
+                            long argl,
+                            void * pArg );
+
+/**
+ * @brief Read decrypted data from the TLS connection.
+ *
+ * @param[in] pOpensslParams Parameters of the connection.
+ * @param[out] pBuffer Buffer to read data into.
+ * @param[in] bufferSize Maximum number of bytes to read.
+ * @param[in] bytesRequested Number of bytes requested by the application,
+ * which decides whether the read may block.
+ *
+ * @return Number of bytes read; 0 if no data is available; negative value on
+ * error.
+ */
+static int32_t receiveFromSsl( const OpensslParams_t * pOpensslParams,
+                               void * pBuffer,
+                               size_t bufferSize,
+                               size_t bytesRequested );
 /*-----------------------------------------------------------*/
 
 #if ( LIBRARY_LOG_LEVEL == LOG_DEBUG )
@@ -454,7 +729,7 @@ static int32_t setPrivateKey( SSL_CTX * pSslContext,
     }
     
     if(pTrustMProvider == NULL) {
-        pTrustMProvider = OSSL_PROVIDER_load(libctx, "/home/pi/optiga-trust-m-explorer/Python_TrustM_GUI/linux-optiga-trust-m/bin/trustm_provider.so");
+        pTrustMProvider = OSSL_PROVIDER_load(libctx, TRUSTM_PROVIDER_PATH);
         if(pTrustMProvider == NULL)
         {
             LogError( ( "Failed to load TrustM provider." ) );
@@ -613,54 +888,138 @@ static int32_t isValidNetworkContext( const NetworkContext_t * pNetworkContext )
 }
 /*-----------------------------------------------------------*/
 
-OpensslStatus_t Openssl_Connect( NetworkContext_t * pNetworkContext,
-                                 const ServerInfo_t * pServerInfo,
-                                 const OpensslCredentials_t * pOpensslCredentials,
-                                 uint32_t sendTimeoutMs,
-                                 uint32_t recvTimeoutMs )
+static int32_t readCredentialFileInfo( CredentialFileInfo_t * pFileInfo )
 {
-    OpensslParams_t * pOpensslParams = NULL;
-    SocketStatus_t socketStatus = SOCKETS_SUCCESS;
-    OpensslStatus_t returnStatus = OPENSSL_SUCCESS;
-    int32_t sslStatus = 0;
-    uint8_t sslObjectCreated = 0;
-    SSL_CTX * pSslContext = NULL;
-    OSSL_PROVIDER *pDefaultProvider = NULL;
-    OSSL_PROVIDER *pTrustMProvider = NULL;
-    OSSL_LIB_CTX *libctx = NULL;
-    
-    /* Validate parameters. */
-    if( ( pNetworkContext == NULL ) || ( pNetworkContext->pParams == NULL ) )
+    int32_t status = 0;
+    struct stat fileStat;
+
+    assert( pFileInfo != NULL );
+    assert( pFileInfo->pPath != NULL );
+
+    if( stat( pFileInfo->pPath, &fileStat ) == 0 )
     {
-        LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
-        returnStatus = OPENSSL_INVALID_PARAMETER;
+        pFileInfo->modifiedTime = fileStat.st_mtim;
+        pFileInfo->fileSize = fileStat.st_size;
+        pFileInfo->inode = fileStat.st_ino;
+        status = 1;
     }
-    else if( pOpensslCredentials == NULL )
+
+    return status;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t matchesCredentialPaths( const OpensslCachedContext_t * pCachedContext,
+                                       const char * const * pPaths )
+{
+    int32_t matches = 1;
+    size_t index = 0U;
+    const char * pCachedPath = NULL;
+
+    assert( pCachedContext != NULL );
+    assert( pPaths != NULL );
+
+    for( index = 0U; ( index < CREDENTIAL_FILE_COUNT ) && ( matches == 1 ); index++ )
     {
-        LogError( ( "Parameter check failed: pOpensslCredentials is NULL." ) );
-        returnStatus = OPENSSL_INVALID_PARAMETER;
+        pCachedPath = pCachedContext->files[ index ].pPath;
+
+        if( ( pCachedPath == NULL ) || ( pPaths[ index ] == NULL ) )
+        {
+            matches = ( pCachedPath == pPaths[ index ] ) ? 1 : 0;
+        }
+        else if( strcmp( pCachedPath, pPaths[ index ] ) != 0 )
+        {
+            matches = 0;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
     }
-    else
+
+    return matches;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t isCachedContextCurrent( const OpensslCachedContext_t * pCachedContext )
+{
+    int32_t isCurrent = 1;
+    size_t index = 0U;
+    CredentialFileInfo_t currentInfo;
+
+    assert( pCachedContext != NULL );
+
+    for( index = 0U; ( index < CREDENTIAL_FILE_COUNT ) && ( isCurrent == 1 ); index++ )
     {
-        /* Empty else. */
+        if( pCachedContext->files[ index ].pPath != NULL )
+        {
+            currentInfo.pPath = pCachedContext->files[ index ].pPath;
+
+            if( ( readCredentialFileInfo( &currentInfo ) == 0 ) ||
+                ( currentInfo.modifiedTime.tv_sec != pCachedContext->files[ index ].modifiedTime.tv_sec ) ||
+                ( currentInfo.modifiedTime.tv_nsec != pCachedContext->files[ index ].modifiedTime.tv_nsec ) ||
+                ( currentInfo.fileSize != pCachedContext->files[ index ].fileSize ) ||
+                ( currentInfo.inode != pCachedContext->files[ index ].inode ) )
+            {
+                isCurrent = 0;
+            }
+        }
     }
 
-    /* Establish the TCP connection. */
-    if( returnStatus == OPENSSL_SUCCESS )
+    return isCurrent;
+}
+/*-----------------------------------------------------------*/
+
+static OpensslStatus_t createCachedContext( const OpensslCredentials_t * pOpensslCredentials,
+                                            const char * const * pPaths,
+                                            OpensslCachedContext_t ** ppCachedContext )
+{
+    OpensslStatus_t returnStatus = OPENSSL_SUCCESS;
+    OpensslCachedContext_t * pCachedContext = NULL;
+    size_t index = 0U, pathLength = 0U;
+    int32_t sslStatus = 0;
+
+    assert( pOpensslCredentials != NULL );
+    assert( pPaths != NULL );
+    assert( ppCachedContext != NULL );
+
+    pCachedContext = calloc( 1, sizeof( OpensslCachedContext_t ) );
+
+    if( pCachedContext == NULL )
     {
-        pOpensslParams = pNetworkContext->pParams;
-        socketStatus = Sockets_Connect( &pOpensslParams->socketDescriptor,
-                                        pServerInfo, sendTimeoutMs, recvTimeoutMs );
+        LogError( ( "Failed to allocate memory for the SSL context cache entry." ) );
+        returnStatus = OPENSSL_INSUFFICIENT_MEMORY;
+    }
 
-        /* Convert socket wrapper status to openssl status. */
-        returnStatus = convertToOpensslStatus( socketStatus );
+    /* Record the credential files before they are loaded so that a change
+     * made while the context is being built invalidates it. */
+    for( index = 0U; ( index < CREDENTIAL_FILE_COUNT ) && ( returnStatus == OPENSSL_SUCCESS ); index++ )
+    {
+        if( pPaths[ index ] != NULL )
+        {
+            pathLength = strlen( pPaths[ index ] );
+            pCachedContext->files[ index ].pPath = malloc( pathLength + 1U );
+
+            if( pCachedContext->files[ index ].pPath == NULL )
+            {
+                LogError( ( "Failed to allocate memory for the credential path." ) );
+                returnStatus = OPENSSL_INSUFFICIENT_MEMORY;
+            }
+            else
+            {
+                ( void ) memcpy( pCachedContext->files[ index ].pPath, pPaths[ index ], pathLength + 1U );
+
+                /* A missing file is reported when the credentials are loaded. */
+                ( void ) readCredentialFileInfo( &pCachedContext->files[ index ] );
+            }
+        }
     }
 
     /* Load the TrustM provider */
     if( returnStatus == OPENSSL_SUCCESS )
     {
-        libctx = OSSL_LIB_CTX_new(); /* Create a new library context */
-        if (libctx == NULL)
+        pCachedContext->pLibraryContext = OSSL_LIB_CTX_new(); /* Create a new library context */
+
+        if( pCachedContext->pLibraryContext == NULL )
         {
             LogError( ( "Failed to create a new OpenSSL library context." ) );
             returnStatus = OPENSSL_API_ERROR;
@@ -669,43 +1028,37 @@ OpensslStatus_t Openssl_Connect( NetworkContext_t * pNetworkContext,
 
     if( returnStatus == OPENSSL_SUCCESS )
     {
-        if(pDefaultProvider == NULL) {
-            pDefaultProvider = OSSL_PROVIDER_load(libctx, "default");
-            if(pDefaultProvider == NULL)
-            {
-                LogError( ( "Failed to load default provider." ) );
-                ERR_print_errors_fp(stderr);  // Print detailed OpenSSL error
-                returnStatus = OPENSSL_API_ERROR;
-            }
+        pCachedContext->pDefaultProvider = OSSL_PROVIDER_load( pCachedContext->pLibraryContext, "default" );
+
+        if( pCachedContext->pDefaultProvider == NULL )
+        {
+            LogError( ( "Failed to load default provider." ) );
+            ERR_print_errors_fp( stderr ); /* Print detailed OpenSSL error. */
+            returnStatus = OPENSSL_API_ERROR;
         }
     }
 
     if( returnStatus == OPENSSL_SUCCESS )
     {
-        if(pTrustMProvider == NULL) {
-            pTrustMProvider = OSSL_PROVIDER_load(libctx, "/home/pi/optiga-trust-m-explorer/Python_TrustM_GUI/linux-optiga-trust-m/bin/trustm_provider.so");
-            if(pTrustMProvider == NULL)
-            {
-                LogError( ( "Failed to load TrustM provider." ) );
-                ERR_print_errors_fp(stderr);  // Print detailed OpenSSL error
-                returnStatus = OPENSSL_API_ERROR;
-            }
-            else
-            {
-                pNetworkContext->pProvider = pTrustMProvider; /* Store the provider in the network context */
-            }
+        pCachedContext->pTrustMProvider = OSSL_PROVIDER_load( pCachedContext->pLibraryContext, TRUSTM_PROVIDER_PATH );
+
+        if( pCachedContext->pTrustMProvider == NULL )
+        {
+            LogError( ( "Failed to load TrustM provider." ) );
+            ERR_print_errors_fp( stderr ); /* Print detailed OpenSSL error. */
+            returnStatus = OPENSSL_API_ERROR;
         }
     }
 
     /* Create SSL context with the specified library context */
     if( returnStatus == OPENSSL_SUCCESS )
     {
-        pSslContext = SSL_CTX_new_ex(libctx, NULL, TLS_client_method());
+        pCachedContext->pSslContext = SSL_CTX_new_ex( pCachedContext->pLibraryContext, NULL, TLS_client_method() );
 
-        if( pSslContext == NULL )
+        if( pCachedContext->pSslContext == NULL )
         {
             LogError( ( "Creation of a new SSL_CTX object failed." ) );
-            ERR_print_errors_fp(stderr);  // Print detailed OpenSSL error
+            ERR_print_errors_fp( stderr ); /* Print detailed OpenSSL error. */
             returnStatus = OPENSSL_API_ERROR;
         }
     }
@@ -721,9 +1074,9 @@ OpensslStatus_t Openssl_Connect( NetworkContext_t * pNetworkContext,
         * numerical type long. This directive is suppressed because openssl
         * function #SSL_CTX_set_mode takes an argument of type long. */
         /* coverity[misra_c_2012_directive_4_6_violation] */
-        ( void ) SSL_CTX_set_mode( pSslContext, ( long ) SSL_MODE_ENABLE_PARTIAL_WRITE );
+        ( void ) SSL_CTX_set_mode( pCachedContext->pSslContext, ( long ) SSL_MODE_ENABLE_PARTIAL_WRITE );
 
-        sslStatus = setCredentials( pSslContext, pOpensslCredentials );
+        sslStatus = setCredentials( pCachedContext->pSslContext, pOpensslCredentials );
 
         if( sslStatus != 1 )
         {
@@ -732,73 +1085,691 @@ OpensslStatus_t Openssl_Connect( NetworkContext_t * pNetworkContext,
         }
     }
 
-    /* Create a new SSL session. */
+    /* Keep sessions out of the internal cache; they are stored per server
+     * in the session slots by #storeSessionCallback. */
     if( returnStatus == OPENSSL_SUCCESS )
     {
-        pOpensslParams->pSsl = SSL_new( pSslContext );
-
-        if( pOpensslParams->pSsl == NULL )
-        {
-            LogError( ( "SSL_new failed to create a new SSL context." ) );
-            returnStatus = OPENSSL_API_ERROR;
-        }
-        else
-        {
-            sslObjectCreated = 1u;
-        }
+        /* MISRA Directive 4.6 flags the following line for using basic
+        * numerical type long. This directive is suppressed because openssl
+        * function #SSL_CTX_set_session_cache_mode takes an argument of type long. */
+        /* coverity[misra_c_2012_directive_4_6_violation] */
+        ( void ) SSL_CTX_set_session_cache_mode( pCachedContext->pSslContext,
+                                                 ( long ) ( SSL_SESS_CACHE_CLIENT |
+                                                            SSL_SESS_CACHE_NO_INTERNAL_STORE ) );
+        SSL_CTX_sess_set_new_cb( pCachedContext->pSslContext, storeSessionCallback );
+        ( void ) SSL_CTX_set_app_data( pCachedContext->pSslContext, pCachedContext );
     }
 
-    /* Setup the socket to use for communication. */
     if( returnStatus == OPENSSL_SUCCESS )
     {
-        returnStatus =
-            tlsHandshake( pServerInfo, pOpensslParams, pOpensslCredentials );
-    }
-
-    /* Free the SSL context. */
-    if( pSslContext != NULL )
-    {
-        SSL_CTX_free( pSslContext );
-        pSslContext = NULL;
-    }
-
-    /* Clean up on error. */
-    if( ( returnStatus != OPENSSL_SUCCESS ) && ( sslObjectCreated == 1u ) )
-    {
-        SSL_free( pOpensslParams->pSsl );
-        pOpensslParams->pSsl = NULL;
+        LogDebug( ( "Created a new SSL context for the credentials." ) );
+        *ppCachedContext = pCachedContext;
     }
-
-    /* Log failure or success depending on status. */
-    if( returnStatus != OPENSSL_SUCCESS )
+    else if( pCachedContext != NULL )
     {
-        LogError( ( "Failed to establish a TLS connection." ) );
+        destroyCachedContext( pCachedContext );
     }
     else
     {
-        LogDebug( ( "Established a TLS connection." ) );
+        /* Empty else MISRA 15.7 */
     }
 
     return returnStatus;
 }
 /*-----------------------------------------------------------*/
 
-OpensslStatus_t Openssl_Disconnect( const NetworkContext_t * pNetworkContext )
+static void destroyCachedContext( OpensslCachedContext_t * pCachedContext )
 {
-    OpensslParams_t * pOpensslParams = NULL;
-    SocketStatus_t socketStatus = SOCKETS_INVALID_PARAMETER;
+    size_t index = 0U;
 
-    if( ( pNetworkContext == NULL ) || ( pNetworkContext->pParams == NULL ) )
+    assert( pCachedContext != NULL );
+
+    /* The SSL context must be freed before the library context it was
+     * created in. */
+    if( pCachedContext->pSslContext != NULL )
     {
-        /* No need to update the status here. The socket status
-         * SOCKETS_INVALID_PARAMETER will be converted to openssl
-         * status OPENSSL_INVALID_PARAMETER before returning from this
-         * function. */
-        LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
+        SSL_CTX_free( pCachedContext->pSslContext );
     }
-    else
+
+    if( pCachedContext->pTrustMProvider != NULL )
     {
-        pOpensslParams = pNetworkContext->pParams;
+        ( void ) OSSL_PROVIDER_unload( pCachedContext->pTrustMProvider );
+    }
+
+    if( pCachedContext->pDefaultProvider != NULL )
+    {
+        ( void ) OSSL_PROVIDER_unload( pCachedContext->pDefaultProvider );
+    }
+
+    if( pCachedContext->pLibraryContext != NULL )
+    {
+        OSSL_LIB_CTX_free( pCachedContext->pLibraryContext );
+    }
+
+    for( index = 0U; index < OPENSSL_SESSION_CACHE_SIZE; index++ )
+    {
+        if( pCachedContext->sessions[ index ].pSession != NULL )
+        {
+            SSL_SESSION_free( pCachedContext->sessions[ index ].pSession );
+        }
+
+        free( pCachedContext->sessions[ index ].pSessionKey );
+    }
+
+    for( index = 0U; index < CREDENTIAL_FILE_COUNT; index++ )
+    {
+        free( pCachedContext->files[ index ].pPath );
+    }
+
+    free( pCachedContext );
+}
+/*-----------------------------------------------------------*/
+
+static void releaseCachedContextLocked( OpensslCachedContext_t * pCachedContext )
+{
+    assert( pCachedContext != NULL );
+    assert( pCachedContext->referenceCount > 0U );
+
+    pCachedContext->referenceCount--;
+
+    if( pCachedContext->referenceCount == 0U )
+    {
+        LogDebug( ( "Freeing SSL context that is no longer referenced." ) );
+        destroyCachedContext( pCachedContext );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static OpensslStatus_t acquireCachedContext( const OpensslCredentials_t * pOpensslCredentials,
+                                             OpensslCachedContext_t ** ppCachedContext )
+{
+    OpensslStatus_t returnStatus = OPENSSL_SUCCESS;
+    OpensslCachedContext_t * pCachedContext = NULL;
+    const char * pPaths[ CREDENTIAL_FILE_COUNT ];
+    size_t index = 0U, slot = 0U;
+
+    assert( pOpensslCredentials != NULL );
+    assert( ppCachedContext != NULL );
+
+    pPaths[ 0 ] = pOpensslCredentials->pRootCaPath;
+    pPaths[ 1 ] = pOpensslCredentials->pClientCertPath;
+    pPaths[ 2 ] = pOpensslCredentials->pPrivateKeyPath;
+
+    ( void ) pthread_mutex_lock( &contextCacheMutex );
+
+    for( index = 0U; index < OPENSSL_CONTEXT_CACHE_SIZE; index++ )
+    {
+        if( ( contextCache[ index ] != NULL ) &&
+            ( matchesCredentialPaths( contextCache[ index ], pPaths ) == 1 ) )
+        {
+            if( isCachedContextCurrent( contextCache[ index ] ) == 1 )
+            {
+                pCachedContext = contextCache[ index ];
+            }
+            else
+            {
+                /* Connections still using the old context keep it alive. */
+                LogInfo( ( "Credential files changed; rebuilding the SSL context." ) );
+                releaseCachedContextLocked( contextCache[ index ] );
+                contextCache[ index ] = NULL;
+            }
+
+            break;
+        }
+    }
+
+    /* Building the context while holding the lock ensures that concurrent
+     * connections with the same credentials parse the files only once. */
+    if( pCachedContext == NULL )
+    {
+        returnStatus = createCachedContext( pOpensslCredentials, pPaths, &pCachedContext );
+
+        if( returnStatus == OPENSSL_SUCCESS )
+        {
+            /* Use a free slot, or evict the least recently used context. */
+            for( index = 0U; index < OPENSSL_CONTEXT_CACHE_SIZE; index++ )
+            {
+                if( contextCache[ index ] == NULL )
+                {
+                    slot = index;
+                    break;
+                }
+                else if( contextCache[ index ]->lastUsed < contextCache[ slot ]->lastUsed )
+                {
+                    slot = index;
+                }
+                else
+                {
+                    /* Empty else MISRA 15.7 */
+                }
+            }
+
+            if( contextCache[ slot ] != NULL )
+            {
+                releaseCachedContextLocked( contextCache[ slot ] );
+            }
+
+            /* Reference held by the cache slot. */
+            pCachedContext->referenceCount = 1U;
+            contextCache[ slot ] = pCachedContext;
+        }
+    }
+
+    if( returnStatus == OPENSSL_SUCCESS )
+    {
+        /* Reference held by the connection. */
+        pCachedContext->referenceCount++;
+        contextCacheClock++;
+        pCachedContext->lastUsed = contextCacheClock;
+        *ppCachedContext = pCachedContext;
+    }
+
+    ( void ) pthread_mutex_unlock( &contextCacheMutex );
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+static void releaseCachedContext( OpensslCachedContext_t * pCachedContext )
+{
+    ( void ) pthread_mutex_lock( &contextCacheMutex );
+    releaseCachedContextLocked( pCachedContext );
+    ( void ) pthread_mutex_unlock( &contextCacheMutex );
+}
+/*-----------------------------------------------------------*/
+
+static OpensslSessionSlot_t * findSessionSlot( OpensslCachedContext_t * pCachedContext,
+                                               const char * pSessionKey,
+                                               uint8_t create )
+{
+    OpensslSessionSlot_t * pSlot = NULL;
+    size_t index = 0U, slot = 0U, keyLength = 0U;
+
+    assert( pCachedContext != NULL );
+    assert( pSessionKey != NULL );
+
+    for( index = 0U; index < OPENSSL_SESSION_CACHE_SIZE; index++ )
+    {
+        if( ( pCachedContext->sessions[ index ].pSessionKey != NULL ) &&
+            ( strcmp( pCachedContext->sessions[ index ].pSessionKey, pSessionKey ) == 0 ) )
+        {
+            pSlot = &pCachedContext->sessions[ index ];
+            break;
+        }
+    }
+
+    if( ( pSlot == NULL ) && ( create == 1U ) )
+    {
+        /* Use a free slot, or evict the least recently used session. */
+        for( index = 0U; index < OPENSSL_SESSION_CACHE_SIZE; index++ )
+        {
+            if( pCachedContext->sessions[ index ].pSessionKey == NULL )
+            {
+                slot = index;
+                break;
+            }
+            else if( pCachedContext->sessions[ index ].lastUsed < pCachedContext->sessions[ slot ].lastUsed )
+            {
+                slot = index;
+            }
+            else
+            {
+                /* Empty else MISRA 15.7 */
+            }
+        }
+
+        pSlot = &pCachedContext->sessions[ slot ];
+
+        if( pSlot->pSession != NULL )
+        {
+            SSL_SESSION_free( pSlot->pSession );
+            pSlot->pSession = NULL;
+        }
+
+        free( pSlot->pSessionKey );
+        keyLength = strlen( pSessionKey );
+        pSlot->pSessionKey = malloc( keyLength + 1U );
+
+        if( pSlot->pSessionKey == NULL )
+        {
+            LogError( ( "Failed to allocate memory for the TLS session key." ) );
+            pSlot = NULL;
+        }
+        else
+        {
+            ( void ) memcpy( pSlot->pSessionKey, pSessionKey, keyLength + 1U );
+        }
+    }
+
+    if( pSlot != NULL )
+    {
+        contextCacheClock++;
+        pSlot->lastUsed = contextCacheClock;
+    }
+
+    return pSlot;
+}
+/*-----------------------------------------------------------*/
+
+static OpensslStatus_t offerCachedSession( OpensslParams_t * pOpensslParams,
+                                           const ServerInfo_t * pServerInfo )
+{
+    OpensslStatus_t returnStatus = OPENSSL_SUCCESS;
+    OpensslSessionSlot_t * pSlot = NULL;
+    char * pSessionKey = NULL;
+    size_t keyLength = 0U;
+
+    assert( pOpensslParams != NULL );
+    assert( pOpensslParams->pSsl != NULL );
+    assert( pOpensslParams->pCachedContext != NULL );
+    assert( pServerInfo != NULL );
+
+    keyLength = pServerInfo->hostNameLength + SESSION_KEY_PORT_LENGTH;
+    pSessionKey = malloc( keyLength + 1U );
+
+    if( pSessionKey == NULL )
+    {
+        LogError( ( "Failed to allocate memory for the TLS session key." ) );
+        returnStatus = OPENSSL_INSUFFICIENT_MEMORY;
+    }
+    else
+    {
+        ( void ) snprintf( pSessionKey, keyLength + 1U, "%.*s:%u",
+                           ( int32_t ) pServerInfo->hostNameLength,
+                           pServerInfo->pHostName,
+                           ( unsigned int ) pServerInfo->port );
+    }
+
+    ( void ) pthread_mutex_lock( &contextCacheMutex );
+
+    if( ( returnStatus == OPENSSL_SUCCESS ) && ( sessionKeyIndex < 0 ) )
+    {
+        sessionKeyIndex = ( int32_t ) SSL_get_ex_new_index( 0, NULL, NULL, NULL, freeSessionKey );
+
+        if( sessionKeyIndex < 0 )
+        {
+            LogError( ( "SSL_get_ex_new_index failed to allocate the session key index." ) );
+            returnStatus = OPENSSL_API_ERROR;
+        }
+    }
+
+    /* On success, the SSL object owns the key and frees it with #freeSessionKey. */
+    if( returnStatus == OPENSSL_SUCCESS )
+    {
+        if( SSL_set_ex_data( pOpensslParams->pSsl, sessionKeyIndex, pSessionKey ) != 1 )
+        {
+            LogError( ( "SSL_set_ex_data failed to attach the TLS session key." ) );
+            returnStatus = OPENSSL_API_ERROR;
+        }
+    }
+
+    if( returnStatus == OPENSSL_SUCCESS )
+    {
+        pSlot = findSessionSlot( pOpensslParams->pCachedContext, pSessionKey, 0U );
+
+        if( ( pSlot != NULL ) &&
+            ( pSlot->pSession != NULL ) &&
+            ( SSL_SESSION_is_resumable( pSlot->pSession ) == 1 ) )
+        {
+            /* The SSL object takes its own reference to the session. */
+            if( SSL_set_session( pOpensslParams->pSsl, pSlot->pSession ) == 1 )
+            {
+                LogDebug( ( "Offering cached TLS session for %s.", pSessionKey ) );
+            }
+            else
+            {
+                LogWarn( ( "SSL_set_session failed; performing a full handshake." ) );
+            }
+        }
+    }
+
+    ( void ) pthread_mutex_unlock( &contextCacheMutex );
+
+    if( ( returnStatus != OPENSSL_SUCCESS ) && ( pSessionKey != NULL ) )
+    {
+        free( pSessionKey );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+static void discardCachedSession( SSL * pSsl )
+{
+    OpensslCachedContext_t * pCachedContext = NULL;
+    OpensslSessionSlot_t * pSlot = NULL;
+    const char * pSessionKey = NULL;
+
+    assert( pSsl != NULL );
+
+    ( void ) pthread_mutex_lock( &contextCacheMutex );
+
+    if( sessionKeyIndex >= 0 )
+    {
+        pSessionKey = SSL_get_ex_data( pSsl, sessionKeyIndex );
+    }
+
+    if( pSessionKey != NULL )
+    {
+        pCachedContext = SSL_CTX_get_app_data( SSL_get_SSL_CTX( pSsl ) );
+        pSlot = findSessionSlot( pCachedContext, pSessionKey, 0U );
+    }
+
+    if( ( pSlot != NULL ) && ( pSlot->pSession != NULL ) )
+    {
+        SSL_SESSION_free( pSlot->pSession );
+        pSlot->pSession = NULL;
+    }
+
+    ( void ) pthread_mutex_unlock( &contextCacheMutex );
+}
+/*-----------------------------------------------------------*/
+
+static int storeSessionCallback( SSL * pSsl,
+                                 SSL_SESSION * pSession )
+{
+    int keepReference = 0;
+    OpensslCachedContext_t * pCachedContext = NULL;
+    OpensslSessionSlot_t * pSlot = NULL;
+    const char * pSessionKey = NULL;
+
+    ( void ) pthread_mutex_lock( &contextCacheMutex );
+
+    /* Only connections that enabled session resumption have a session key. */
+    if( sessionKeyIndex >= 0 )
+    {
+        pSessionKey = SSL_get_ex_data( pSsl, sessionKeyIndex );
+    }
+
+    if( pSessionKey != NULL )
+    {
+        pCachedContext = SSL_CTX_get_app_data( SSL_get_SSL_CTX( pSsl ) );
+        pSlot = findSessionSlot( pCachedContext, pSessionKey, 1U );
+    }
+
+    if( pSlot != NULL )
+    {
+        if( pSlot->pSession != NULL )
+        {
+            SSL_SESSION_free( pSlot->pSession );
+        }
+
+        LogDebug( ( "Stored TLS session for %s.", pSessionKey ) );
+        pSlot->pSession = pSession;
+        keepReference = 1;
+    }
+
+    ( void ) pthread_mutex_unlock( &contextCacheMutex );
+
+    return keepReference;
+}
+/*-----------------------------------------------------------*/
+
+static void freeSessionKey( void * pParent,
+                            void * pSessionKey,
+                            CRYPTO_EX_DATA * pExData,
+                            int index,
+                            long argl,
+                            void * pArg )
+{
+    /* Unused parameters. */
+    ( void ) pParent;
+    ( void ) pExData;
+    ( void ) index;
+    ( void ) argl;
+    ( void ) pArg;
+
+    free( pSessionKey );
+}
+/*-----------------------------------------------------------*/
+
+static int32_t receiveFromSsl( const OpensslParams_t * pOpensslParams,
+                               void * pBuffer,
+                               size_t bufferSize,
+                               size_t bytesRequested )
+{
+    int32_t bytesReceived = 0;
+    int32_t pollStatus = 1, readStatus = 1, sslError = 0;
+    uint8_t shouldRead = 0U;
+    struct pollfd pollFds;
+
+    /* Initialize the file descriptor.
+     * #POLLPRI corresponds to high-priority data while #POLLIN corresponds
+     * to any other data that may be read. */
+    pollFds.events = POLLIN | POLLPRI;
+    pollFds.revents = 0;
+    /* Set the file descriptor for poll. */
+    pollFds.fd = pOpensslParams->socketDescriptor;
+
+    /* #SSL_pending returns a value > 0 if application data
+     * from the last processed TLS record remains to be read.
+     * This implementation will ALWAYS block when the number of bytes
+     * requested is greater than 1. Otherwise, poll the socket first
+     * as blocking may negatively impact performance by waiting for the
+     * entire duration of the socket timeout even when no data is available. */
+    if( ( bytesRequested > 1 ) || ( SSL_pending( pOpensslParams->pSsl ) > 0 ) )
+    {
+        shouldRead = 1U;
+    }
+    else
+    {
+        /* Speculative read for the start of a payload.
+         * Note: This is done to avoid blocking when no
+         * data is available to be read from the socket. */
+        pollStatus = poll( &pollFds, 1, 0 );
+    }
+
+    if( pollStatus < 0 )
+    {
+        bytesReceived = -1;
+    }
+    else if( pollStatus == 0 )
+    {
+        /* No data available to be read from the socket. */
+        bytesReceived = 0;
+    }
+    else
+    {
+        shouldRead = 1U;
+    }
+
+    if( shouldRead == 1U )
+    {
+        /* Blocking SSL read of data.
+         * Note: The TLS record may only be partially received or unprocessed,
+         * so it is possible that no processed application data is returned
+         * even though the socket has data available to be read. */
+        readStatus = ( int32_t ) SSL_read( pOpensslParams->pSsl, pBuffer,
+                                           ( int32_t ) bufferSize );
+
+        /* Successfully read of application data. */
+        if( readStatus > 0 )
+        {
+            bytesReceived = readStatus;
+        }
+    }
+
+    /* Handle error return status if transport read did not succeed. */
+    if( readStatus <= 0 )
+    {
+        sslError = SSL_get_error( pOpensslParams->pSsl, readStatus );
+
+        if( sslError == SSL_ERROR_WANT_READ )
+        {
+            /* The OpenSSL documentation mentions that SSL_Read can provide a
+             * return code of SSL_ERROR_WANT_READ in blocking mode, if the SSL
+             * context is not configured with with the SSL_MODE_AUTO_RETRY. This
+             * error code means that the SSL_read() operation needs to be retried
+             * to complete the read operation. Thus, setting the return value of
+             * this function as zero to represent that no data was received from
+             * the network. */
+            bytesReceived = 0;
+        }
+        else
+        {
+            LogError( ( "Failed to receive data over network: SSL_read failed: "
+                        "ErrorStatus=%s.",
+                        ERR_reason_error_string( sslError ) ) );
+
+            /* The transport interface requires zero return code only when the
+             * receive operation can be retried to achieve success. Thus, convert
+             * a zero error code to a negative return value as this cannot be
+             * retried. */
+            bytesReceived = -1;
+        }
+    }
+
+    return bytesReceived;
+}
+/*-----------------------------------------------------------*/
+
+OpensslStatus_t Openssl_Connect( NetworkContext_t * pNetworkContext,
+                                 const ServerInfo_t * pServerInfo,
+                                 const OpensslCredentials_t * pOpensslCredentials,
+                                 uint32_t sendTimeoutMs,
+                                 uint32_t recvTimeoutMs )
+{
+    OpensslParams_t * pOpensslParams = NULL;
+    SocketStatus_t socketStatus = SOCKETS_SUCCESS;
+    OpensslStatus_t returnStatus = OPENSSL_SUCCESS;
+    uint8_t sslObjectCreated = 0;
+
+    /* Validate parameters. */
+    if( ( pNetworkContext == NULL ) || ( pNetworkContext->pParams == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
+        returnStatus = OPENSSL_INVALID_PARAMETER;
+    }
+    else if( pOpensslCredentials == NULL )
+    {
+        LogError( ( "Parameter check failed: pOpensslCredentials is NULL." ) );
+        returnStatus = OPENSSL_INVALID_PARAMETER;
+    }
+    else
+    {
+        /* Empty else. */
+    }
+
+    /* Establish the TCP connection. */
+    if( returnStatus == OPENSSL_SUCCESS )
+    {
+        pOpensslParams = pNetworkContext->pParams;
+        pOpensslParams->pCachedContext = NULL;
+        pOpensslParams->sessionResumed = 0U;
+
+        /* Discard data read ahead on a previous connection. */
+        pOpensslParams->recvBufferOffset = 0U;
+        pOpensslParams->recvBufferLength = 0U;
+
+        socketStatus = Sockets_ConnectParallel( &pOpensslParams->socketDescriptor,
+                                                pServerInfo,
+                                                SOCKETS_CONNECT_TIMEOUT_MS,
+                                                sendTimeoutMs,
+                                                recvTimeoutMs );
+
+        /* Convert socket wrapper status to openssl status. */
+        returnStatus = convertToOpensslStatus( socketStatus );
+    }
+
+    /* Get the SSL context for the credentials, reusing the cached one if the
+     * credential files have not changed. */
+    if( returnStatus == OPENSSL_SUCCESS )
+    {
+        returnStatus = acquireCachedContext( pOpensslCredentials,
+                                             &pOpensslParams->pCachedContext );
+    }
+
+    /* Create a new SSL session. */
+    if( returnStatus == OPENSSL_SUCCESS )
+    {
+        pOpensslParams->pSsl = SSL_new( pOpensslParams->pCachedContext->pSslContext );
+
+        if( pOpensslParams->pSsl == NULL )
+        {
+            LogError( ( "SSL_new failed to create a new SSL context." ) );
+            returnStatus = OPENSSL_API_ERROR;
+        }
+        else
+        {
+            sslObjectCreated = 1u;
+        }
+    }
+
+    /* Offer the last session established with the server. */
+    if( ( returnStatus == OPENSSL_SUCCESS ) &&
+        ( pOpensslCredentials->enableSessionResumption == 1U ) )
+    {
+        returnStatus = offerCachedSession( pOpensslParams, pServerInfo );
+    }
+
+    /* Setup the socket to use for communication. */
+    if( returnStatus == OPENSSL_SUCCESS )
+    {
+        returnStatus =
+            tlsHandshake( pServerInfo, pOpensslParams, pOpensslCredentials );
+
+        if( returnStatus == OPENSSL_SUCCESS )
+        {
+            pOpensslParams->sessionResumed = ( SSL_session_reused( pOpensslParams->pSsl ) == 1 ) ? 1U : 0U;
+            LogDebug( ( "TLS handshake completed: SessionResumed=%u.",
+                        ( unsigned int ) pOpensslParams->sessionResumed ) );
+        }
+        else if( pOpensslCredentials->enableSessionResumption == 1U )
+        {
+            /* Do not offer the same session on the next attempt. */
+            discardCachedSession( pOpensslParams->pSsl );
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+    }
+
+    /* Clean up on error. */
+    if( ( returnStatus != OPENSSL_SUCCESS ) && ( sslObjectCreated == 1u ) )
+    {
+        SSL_free( pOpensslParams->pSsl );
+        pOpensslParams->pSsl = NULL;
+    }
+
+    if( ( returnStatus != OPENSSL_SUCCESS ) &&
+        ( pOpensslParams != NULL ) &&
+        ( pOpensslParams->pCachedContext != NULL ) )
+    {
+        releaseCachedContext( pOpensslParams->pCachedContext );
+        pOpensslParams->pCachedContext = NULL;
+    }
+
+    /* Log failure or success depending on status. */
+    if( returnStatus != OPENSSL_SUCCESS )
+    {
+        LogError( ( "Failed to establish a TLS connection." ) );
+    }
+    else
+    {
+        LogDebug( ( "Established a TLS connection." ) );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+OpensslStatus_t Openssl_Disconnect( const NetworkContext_t * pNetworkContext )
+{
+    OpensslParams_t * pOpensslParams = NULL;
+    SocketStatus_t socketStatus = SOCKETS_INVALID_PARAMETER;
+
+    if( ( pNetworkContext == NULL ) || ( pNetworkContext->pParams == NULL ) )
+    {
+        /* No need to update the status here. The socket status
+         * SOCKETS_INVALID_PARAMETER will be converted to openssl
+         * status OPENSSL_INVALID_PARAMETER before returning from this
+         * function. */
+        LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
+    }
+    else
+    {
+        pOpensslParams = pNetworkContext->pParams;
 
         if( pOpensslParams->pSsl != NULL )
         {
@@ -813,6 +1784,13 @@ OpensslStatus_t Openssl_Disconnect( const NetworkContext_t * pNetworkContext )
             pOpensslParams->pSsl = NULL;
         }
 
+        /* Drop the connection's reference to the shared SSL context. */
+        if( pOpensslParams->pCachedContext != NULL )
+        {
+            releaseCachedContext( pOpensslParams->pCachedContext );
+            pOpensslParams->pCachedContext = NULL;
+        }
+
         /* Tear down the socket connection, pNetworkContext != NULL here. */
         socketStatus = Sockets_Disconnect( pOpensslParams->socketDescriptor );
     }
@@ -821,6 +1799,25 @@ OpensslStatus_t Openssl_Disconnect( const NetworkContext_t * pNetworkContext )
 }
 /*-----------------------------------------------------------*/
 
+void Openssl_ClearContextCache( void )
+{
+    size_t index = 0U;
+
+    ( void ) pthread_mutex_lock( &contextCacheMutex );
+
+    for( index = 0U; index < OPENSSL_CONTEXT_CACHE_SIZE; index++ )
+    {
+        if( contextCache[ index ] != NULL )
+        {
+            releaseCachedContextLocked( contextCache[ index ] );
+            contextCache[ index ] = NULL;
+        }
+    }
+
+    ( void ) pthread_mutex_unlock( &contextCacheMutex );
+}
+/*-----------------------------------------------------------*/
+
 /* MISRA Rule 8.13 flags the following line for not using the const qualifier
  * on `pNetworkContext`. Indeed, the object pointed by it is not modified
  * by OpenSSL, but other implementations of `TransportRecv_t` may do so. */
@@ -830,6 +1827,7 @@ int32_t Openssl_Recv( NetworkContext_t * pNetworkContext,
 {
     OpensslParams_t * pOpensslParams = NULL;
     int32_t bytesReceived = 0;
+    size_t bytesToCopy = 0U;
 
     if( !isValidNetworkContext( pNetworkContext ) ||
         ( pBuffer == NULL ) ||
@@ -840,94 +1838,49 @@ int32_t Openssl_Recv( NetworkContext_t * pNetworkContext,
     }
     else
     {
-        int32_t pollStatus = 1, readStatus = 1, sslError = 0;
-        uint8_t shouldRead = 0U;
-        struct pollfd pollFds;
         pOpensslParams = pNetworkContext->pParams;
 
-        /* Initialize the file descriptor.
-         * #POLLPRI corresponds to high-priority data while #POLLIN corresponds
-         * to any other data that may be read. */
-        pollFds.events = POLLIN | POLLPRI;
-        pollFds.revents = 0;
-        /* Set the file descriptor for poll. */
-        pollFds.fd = pOpensslParams->socketDescriptor;
-
-        /* #SSL_pending returns a value > 0 if application data
-         * from the last processed TLS record remains to be read.
-         * This implementation will ALWAYS block when the number of bytes
-         * requested is greater than 1. Otherwise, poll the socket first
-         * as blocking may negatively impact performance by waiting for the
-         * entire duration of the socket timeout even when no data is available. */
-        if( ( bytesToRecv > 1 ) || ( SSL_pending( pOpensslParams->pSsl ) > 0 ) )
+        if( ( pOpensslParams->pRecvBuffer == NULL ) ||
+            ( pOpensslParams->recvBufferSize == 0U ) )
         {
-            shouldRead = 1U;
+            bytesReceived = receiveFromSsl( pOpensslParams, pBuffer, bytesToRecv, bytesToRecv );
         }
-        else
+        else if( pOpensslParams->recvBufferLength > 0U )
         {
-            /* Speculative read for the start of a payload.
-             * Note: This is done to avoid blocking when no
-             * data is available to be read from the socket. */
-            pollStatus = poll( &pollFds, 1, 0 );
+            /* Serve the read from data read ahead. */
+            bytesToCopy = ( bytesToRecv < pOpensslParams->recvBufferLength ) ?
+                          bytesToRecv : pOpensslParams->recvBufferLength;
+            ( void ) memcpy( pBuffer,
+                             &pOpensslParams->pRecvBuffer[ pOpensslParams->recvBufferOffset ],
+                             bytesToCopy );
+            pOpensslParams->recvBufferOffset += bytesToCopy;
+            pOpensslParams->recvBufferLength -= bytesToCopy;
+            bytesReceived = ( int32_t ) bytesToCopy;
         }
-
-        if( pollStatus < 0 )
-        {
-            bytesReceived = -1;
-        }
-        else if( pollStatus == 0 )
+        else if( bytesToRecv >= pOpensslParams->recvBufferSize )
         {
-            /* No data available to be read from the socket. */
-            bytesReceived = 0;
+            /* Large reads, such as PUBLISH payloads, go straight to the
+             * buffer of the caller to avoid copying them twice. */
+            bytesReceived = receiveFromSsl( pOpensslParams, pBuffer, bytesToRecv, bytesToRecv );
         }
         else
         {
-            shouldRead = 1U;
-        }
-
-        if( shouldRead == 1U )
-        {
-            /* Blocking SSL read of data.
-             * Note: The TLS record may only be partially received or unprocessed,
-             * so it is possible that no processed application data is returned
-             * even though the socket has data available to be read. */
-            readStatus = ( int32_t ) SSL_read( pOpensslParams->pSsl, pBuffer,
-                                               ( int32_t ) bytesToRecv );
-
-            /* Successfully read of application data. */
-            if( readStatus > 0 )
+            /* Read up to a full buffer, while deciding whether to block on
+             * the size requested by the caller. */
+            pOpensslParams->recvBufferOffset = 0U;
+            bytesReceived = receiveFromSsl( pOpensslParams,
+                                            pOpensslParams->pRecvBuffer,
+                                            pOpensslParams->recvBufferSize,
+                                            bytesToRecv );
+
+            if( bytesReceived > 0 )
             {
-                bytesReceived = readStatus;
-            }
-        }
-
-        /* Handle error return status if transport read did not succeed. */
-        if( readStatus <= 0 )
-        {
-            sslError = SSL_get_error( pOpensslParams->pSsl, readStatus );
-
-            if( sslError == SSL_ERROR_WANT_READ )
-            {
-                /* The OpenSSL documentation mentions that SSL_Read can provide a
-                 * return code of SSL_ERROR_WANT_READ in blocking mode, if the SSL
-                 * context is not configured with with the SSL_MODE_AUTO_RETRY. This
-                 * error code means that the SSL_read() operation needs to be retried
-                 * to complete the read operation. Thus, setting the return value of
-                 * this function as zero to represent that no data was received from
-                 * the network. */
-                bytesReceived = 0;
-            }
-            else
-            {
-                LogError( ( "Failed to receive data over network: SSL_read failed: "
-                            "ErrorStatus=%s.",
-                            ERR_reason_error_string( sslError ) ) );
-
-                /* The transport interface requires zero return code only when the
-                 * receive operation can be retried to achieve success. Thus, convert
-                 * a zero error code to a negative return value as this cannot be
-                 * retried. */
-                bytesReceived = -1;
+                bytesToCopy = ( bytesToRecv < ( size_t ) bytesReceived ) ?
+                              bytesToRecv : ( size_t ) bytesReceived;
+                ( void ) memcpy( pBuffer, pOpensslParams->pRecvBuffer, bytesToCopy );
+                pOpensslParams->recvBufferOffset = bytesToCopy;
+                pOpensslParams->recvBufferLength = ( size_t ) bytesReceived - bytesToCopy;
+                bytesReceived = ( int32_t ) bytesToCopy;
             }
         }
     }
@@ -1022,3 +1975,56 @@ int32_t Openssl_Send( NetworkContext_t * pNetworkContext,
     return bytesSent;
 }
 /*-----------------------------------------------------------*/
+
+int32_t Openssl_Writev( NetworkContext_t * pNetworkContext,
+                        TransportOutVector_t * pIoVec,
+                        size_t ioVecCount )
+{
+    int32_t bytesSent = 0;
+    uint8_t recordBuffer[ OPENSSL_WRITEV_BUFFER_SIZE ];
+    size_t recordLength = 0U, bytesToCopy = 0U, index = 0U;
+
+    if( !isValidNetworkContext( pNetworkContext ) ||
+        ( pIoVec == NULL ) ||
+        ( ioVecCount == 0U ) )
+    {
+        LogError( ( "Parameter check failed: invalid input, pNetworkContext is invalid or pIoVec = %p, ioVecCount = %lu",
+                    ( void * ) pIoVec, ( unsigned long ) ioVecCount ) );
+        bytesSent = -1;
+    }
+    else if( pIoVec[ 0 ].iov_len >= OPENSSL_WRITEV_BUFFER_SIZE )
+    {
+        /* A large buffer, such as a PUBLISH payload, fills records on its
+         * own; copying it would not save any record. */
+        bytesSent = Openssl_Send( pNetworkContext, pIoVec[ 0 ].iov_base, pIoVec[ 0 ].iov_len );
+    }
+    else
+    {
+        /* Coalesce the buffers so that they are sent as one TLS record. A
+         * buffer that only partly fits is sent in part; the caller sends the
+         * rest with the following buffers. */
+        for( index = 0U; ( index < ioVecCount ) && ( recordLength < sizeof( recordBuffer ) ); index++ )
+        {
+            bytesToCopy = sizeof( recordBuffer ) - recordLength;
+
+            if( pIoVec[ index ].iov_len < bytesToCopy )
+            {
+                bytesToCopy = pIoVec[ index ].iov_len;
+            }
+
+            if( bytesToCopy > 0U )
+            {
+                ( void ) memcpy( &recordBuffer[ recordLength ], pIoVec[ index ].iov_base, bytesToCopy );
+                recordLength += bytesToCopy;
+            }
+        }
+
+        if( recordLength > 0U )
+        {
+            bytesSent = Openssl_Send( pNetworkContext, recordBuffer, recordLength );
+        }
+    }
+
+    return bytesSent;
+}
+/*-----------------------------------------------------------*/
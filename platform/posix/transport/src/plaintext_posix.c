@@ -27,12 +27,23 @@
 /* POSIX socket includes. */
 #include <errno.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <poll.h>
 
 #include "plaintext_posix.h"
 
 /*-----------------------------------------------------------*/
 
+/**
+ * @brief Maximum number of buffers sent by one call to #Plaintext_Writev.
+ * Further buffers are left for the next call.
+ */
+#ifndef PLAINTEXT_WRITEV_MAX_VECTORS
+    #define PLAINTEXT_WRITEV_MAX_VECTORS    ( 16U )
+#endif
+
+/*-----------------------------------------------------------*/
+
 /* Each compilation unit must define the NetworkContext struct. */
 struct NetworkContext
 {
@@ -48,6 +59,20 @@ struct NetworkContext
  */
 static void logTransportError( int32_t errorNumber );
 
+/**
+ * @brief Receive data from the socket without blocking.
+ *
+ * @param[in] pPlaintextParams Parameters of the connection.
+ * @param[out] pBuffer Buffer to receive data into.
+ * @param[in] bytesToRecv Maximum number of bytes to receive.
+ *
+ * @return Number of bytes received; 0 if no data is available; negative
+ * value on error or if the peer closed the connection.
+ */
+static int32_t receiveFromSocket( const PlaintextParams_t * pPlaintextParams,
+                                  void * pBuffer,
+                                  size_t bytesToRecv );
+
 /*-----------------------------------------------------------*/
 
 static void logTransportError( int32_t errorNumber )
@@ -59,6 +84,81 @@ static void logTransportError( int32_t errorNumber )
 }
 /*-----------------------------------------------------------*/
 
+static int32_t receiveFromSocket( const PlaintextParams_t * pPlaintextParams,
+                                  void * pBuffer,
+                                  size_t bytesToRecv )
+{
+    int32_t bytesReceived = -1, pollStatus = 1;
+    struct pollfd pollFds;
+
+    if( pPlaintextParams->nonBlocking == 1U )
+    {
+        /* Let recv() report the lack of data instead of polling first. */
+        bytesReceived = ( int32_t ) recv( pPlaintextParams->socketDescriptor,
+                                          pBuffer,
+                                          bytesToRecv,
+                                          MSG_DONTWAIT );
+
+        if( ( bytesReceived < 0 ) && ( ( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) ) )
+        {
+            /* No data available to receive. */
+            bytesReceived = 0;
+            pollStatus = 0;
+        }
+    }
+    else
+    {
+        /* Initialize the file descriptor.
+         * #POLLPRI corresponds to high-priority data while #POLLIN corresponds
+         * to any other data that may be read. */
+        pollFds.events = POLLIN | POLLPRI;
+        pollFds.revents = 0;
+        /* Set the file descriptor for poll. */
+        pollFds.fd = pPlaintextParams->socketDescriptor;
+
+        /* Check if there is data to read (without blocking) from the socket. */
+        pollStatus = poll( &pollFds, 1, 0 );
+
+        if( pollStatus > 0 )
+        {
+            /* The socket is available for receiving data. */
+            bytesReceived = ( int32_t ) recv( pPlaintextParams->socketDescriptor,
+                                              pBuffer,
+                                              bytesToRecv,
+                                              0 );
+        }
+        else if( pollStatus < 0 )
+        {
+            /* An error occurred while polling. */
+            bytesReceived = -1;
+        }
+        else
+        {
+            /* No data available to receive. */
+            bytesReceived = 0;
+        }
+    }
+
+    /* Note: A zero value return from recv() represents
+     * closure of TCP connection by the peer. */
+    if( ( pollStatus > 0 ) && ( bytesReceived == 0 ) )
+    {
+        /* Peer has closed the connection. Treat as an error. */
+        bytesReceived = -1;
+    }
+    else if( bytesReceived < 0 )
+    {
+        logTransportError( errno );
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return bytesReceived;
+}
+/*-----------------------------------------------------------*/
+
 SocketStatus_t Plaintext_Connect( NetworkContext_t * pNetworkContext,
                                   const ServerInfo_t * pServerInfo,
                                   uint32_t sendTimeoutMs,
@@ -76,10 +176,16 @@ SocketStatus_t Plaintext_Connect( NetworkContext_t * pNetworkContext,
     else
     {
         pPlaintextParams = pNetworkContext->pParams;
-        returnStatus = Sockets_Connect( &pPlaintextParams->socketDescriptor,
-                                        pServerInfo,
-                                        sendTimeoutMs,
-                                        recvTimeoutMs );
+
+        /* Discard data received ahead on a previous connection. */
+        pPlaintextParams->recvBufferOffset = 0U;
+        pPlaintextParams->recvBufferLength = 0U;
+
+        returnStatus = Sockets_ConnectParallel( &pPlaintextParams->socketDescriptor,
+                                                pServerInfo,
+                                                SOCKETS_CONNECT_TIMEOUT_MS,
+                                                sendTimeoutMs,
+                                                recvTimeoutMs );
     }
 
     return returnStatus;
@@ -115,54 +221,136 @@ int32_t Plaintext_Recv( NetworkContext_t * pNetworkContext,
                         size_t bytesToRecv )
 {
     PlaintextParams_t * pPlaintextParams = NULL;
-    int32_t bytesReceived = -1, pollStatus = 1;
-    struct pollfd pollFds;
+    int32_t bytesReceived = -1;
+    size_t bytesToCopy = 0U;
 
     assert( pNetworkContext != NULL && pNetworkContext->pParams != NULL );
     assert( pBuffer != NULL );
     assert( bytesToRecv > 0 );
 
-    /* Get receive timeout from the socket to use as the timeout for #select. */
     pPlaintextParams = pNetworkContext->pParams;
 
-    /* Initialize the file descriptor.
-     * #POLLPRI corresponds to high-priority data while #POLLIN corresponds
-     * to any other data that may be read. */
-    pollFds.events = POLLIN | POLLPRI;
-    pollFds.revents = 0;
-    /* Set the file descriptor for poll. */
-    pollFds.fd = pPlaintextParams->socketDescriptor;
-
-    /* Check if there is data to read (without blocking) from the socket. */
-    pollStatus = poll( &pollFds, 1, 0 );
-
-    if( pollStatus > 0 )
+    if( ( pPlaintextParams->pRecvBuffer == NULL ) ||
+        ( pPlaintextParams->recvBufferSize == 0U ) )
     {
-        /* The socket is available for receiving data. */
-        bytesReceived = ( int32_t ) recv( pPlaintextParams->socketDescriptor,
-                                          pBuffer,
-                                          bytesToRecv,
-                                          0 );
+        bytesReceived = receiveFromSocket( pPlaintextParams, pBuffer, bytesToRecv );
     }
-    else if( pollStatus < 0 )
+    else if( pPlaintextParams->recvBufferLength > 0U )
     {
-        /* An error occurred while polling. */
-        bytesReceived = -1;
+        /* Serve the read from data received ahead. */
+        bytesToCopy = ( bytesToRecv < pPlaintextParams->recvBufferLength ) ?
+                      bytesToRecv : pPlaintextParams->recvBufferLength;
+        ( void ) memcpy( pBuffer,
+                         &pPlaintextParams->pRecvBuffer[ pPlaintextParams->recvBufferOffset ],
+                         bytesToCopy );
+        pPlaintextParams->recvBufferOffset += bytesToCopy;
+        pPlaintextParams->recvBufferLength -= bytesToCopy;
+        bytesReceived = ( int32_t ) bytesToCopy;
+    }
+    else if( bytesToRecv >= pPlaintextParams->recvBufferSize )
+    {
+        /* Large reads, such as PUBLISH payloads, go straight to the buffer of
+         * the caller to avoid copying them twice. */
+        bytesReceived = receiveFromSocket( pPlaintextParams, pBuffer, bytesToRecv );
     }
     else
     {
-        /* No data available to receive. */
-        bytesReceived = 0;
+        /* Fill the buffer with a single recv and serve the read from it. */
+        pPlaintextParams->recvBufferOffset = 0U;
+        bytesReceived = receiveFromSocket( pPlaintextParams,
+                                           pPlaintextParams->pRecvBuffer,
+                                           pPlaintextParams->recvBufferSize );
+
+        if( bytesReceived > 0 )
+        {
+            bytesToCopy = ( bytesToRecv < ( size_t ) bytesReceived ) ?
+                          bytesToRecv : ( size_t ) bytesReceived;
+            ( void ) memcpy( pBuffer, pPlaintextParams->pRecvBuffer, bytesToCopy );
+            pPlaintextParams->recvBufferOffset = bytesToCopy;
+            pPlaintextParams->recvBufferLength = ( size_t ) bytesReceived - bytesToCopy;
+            bytesReceived = ( int32_t ) bytesToCopy;
+        }
     }
 
-    /* Note: A zero value return from recv() represents
-     * closure of TCP connection by the peer. */
-    if( ( pollStatus > 0 ) && ( bytesReceived == 0 ) )
+    return bytesReceived;
+}
+/*-----------------------------------------------------------*/
+
+/* MISRA Rule 8.13 flags the following line for not using the const qualifier
+ * on `pNetworkContext`. Indeed, the object pointed by it is not modified
+ * by POSIX sockets, but other implementations of `TransportSend_t` may do so. */
+int32_t Plaintext_Send( NetworkContext_t * pNetworkContext,
+                        const void * pBuffer,
+                        size_t bytesToSend )
+{
+    PlaintextParams_t * pPlaintextParams = NULL;
+    int32_t bytesSent = -1, pollStatus = -1;
+    struct pollfd pollFds;
+
+    assert( pNetworkContext != NULL && pNetworkContext->pParams != NULL );
+    assert( pBuffer != NULL );
+    assert( bytesToSend > 0 );
+
+    /* Get send timeout from the socket to use as the timeout for #select. */
+    pPlaintextParams = pNetworkContext->pParams;
+
+    if( pPlaintextParams->nonBlocking == 1U )
+    {
+        /* A full TX buffer is reported by send() itself, so no poll is
+         * needed. */
+        pollStatus = 1;
+        bytesSent = ( int32_t ) send( pPlaintextParams->socketDescriptor,
+                                      pBuffer,
+                                      bytesToSend,
+                                      MSG_DONTWAIT );
+
+        if( ( bytesSent < 0 ) && ( ( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) ) )
+        {
+            /* Socket is not available for sending data. */
+            bytesSent = 0;
+            pollStatus = 0;
+        }
+    }
+    else
+    {
+        /* Initialize the file descriptor. */
+        pollFds.events = POLLOUT;
+        pollFds.revents = 0;
+        /* Set the file descriptor for poll. */
+        pollFds.fd = pPlaintextParams->socketDescriptor;
+
+        /* Check if data can be written to the socket.
+         * Note: This is done to avoid blocking on send() when
+         * the socket is not ready to accept more data for network
+         * transmission (possibly due to a full TX buffer). */
+        pollStatus = poll( &pollFds, 1, 0 );
+
+        if( pollStatus > 0 )
+        {
+            /* The socket is available for sending data. */
+            bytesSent = ( int32_t ) send( pPlaintextParams->socketDescriptor,
+                                          pBuffer,
+                                          bytesToSend,
+                                          0 );
+        }
+        else if( pollStatus < 0 )
+        {
+            /* An error occurred while polling. */
+            bytesSent = -1;
+        }
+        else
+        {
+            /* Socket is not available for sending data. */
+            bytesSent = 0;
+        }
+    }
+
+    if( ( pollStatus > 0 ) && ( bytesSent == 0 ) )
     {
         /* Peer has closed the connection. Treat as an error. */
-        bytesReceived = -1;
+        bytesSent = -1;
     }
-    else if( bytesReceived < 0 )
+    else if( bytesSent < 0 )
     {
         logTransportError( errno );
     }
@@ -171,47 +359,76 @@ int32_t Plaintext_Recv( NetworkContext_t * pNetworkContext,
         /* Empty else MISRA 15.7 */
     }
 
-    return bytesReceived;
+    return bytesSent;
 }
 /*-----------------------------------------------------------*/
 
 /* MISRA Rule 8.13 flags the following line for not using the const qualifier
  * on `pNetworkContext`. Indeed, the object pointed by it is not modified
- * by POSIX sockets, but other implementations of `TransportSend_t` may do so. */
-int32_t Plaintext_Send( NetworkContext_t * pNetworkContext,
-                        const void * pBuffer,
-                        size_t bytesToSend )
+ * by POSIX sockets, but other implementations of `TransportWritev_t` may do so. */
+int32_t Plaintext_Writev( NetworkContext_t * pNetworkContext,
+                          TransportOutVector_t * pIoVec,
+                          size_t ioVecCount )
 {
     PlaintextParams_t * pPlaintextParams = NULL;
     int32_t bytesSent = -1, pollStatus = -1;
     struct pollfd pollFds;
+    struct iovec ioVectors[ PLAINTEXT_WRITEV_MAX_VECTORS ];
+    struct msghdr message;
+    size_t index = 0U;
+    int flags = 0;
 
     assert( pNetworkContext != NULL && pNetworkContext->pParams != NULL );
-    assert( pBuffer != NULL );
-    assert( bytesToSend > 0 );
+    assert( pIoVec != NULL );
+    assert( ioVecCount > 0 );
 
-    /* Get send timeout from the socket to use as the timeout for #select. */
     pPlaintextParams = pNetworkContext->pParams;
 
-    /* Initialize the file descriptor. */
-    pollFds.events = POLLOUT;
-    pollFds.revents = 0;
-    /* Set the file descriptor for poll. */
-    pollFds.fd = pPlaintextParams->socketDescriptor;
+    if( ioVecCount > PLAINTEXT_WRITEV_MAX_VECTORS )
+    {
+        ioVecCount = PLAINTEXT_WRITEV_MAX_VECTORS;
+    }
+
+    for( index = 0U; index < ioVecCount; index++ )
+    {
+        /* sendmsg does not modify the buffers it sends. */
+        ioVectors[ index ].iov_base = ( void * ) pIoVec[ index ].iov_base;
+        ioVectors[ index ].iov_len = pIoVec[ index ].iov_len;
+    }
 
-    /* Check if data can be written to the socket.
-     * Note: This is done to avoid blocking on send() when
-     * the socket is not ready to accept more data for network
-     * transmission (possibly due to a full TX buffer). */
-    pollStatus = poll( &pollFds, 1, 0 );
+    ( void ) memset( &message, 0, sizeof( message ) );
+    message.msg_iov = ioVectors;
+    message.msg_iovlen = ioVecCount;
+
+    if( pPlaintextParams->nonBlocking == 1U )
+    {
+        pollStatus = 1;
+        flags = MSG_DONTWAIT;
+    }
+    else
+    {
+        /* Initialize the file descriptor. */
+        pollFds.events = POLLOUT;
+        pollFds.revents = 0;
+        /* Set the file descriptor for poll. */
+        pollFds.fd = pPlaintextParams->socketDescriptor;
+
+        /* Check if data can be written to the socket, as in #Plaintext_Send. */
+        pollStatus = poll( &pollFds, 1, 0 );
+    }
 
     if( pollStatus > 0 )
     {
-        /* The socket is available for sending data. */
-        bytesSent = ( int32_t ) send( pPlaintextParams->socketDescriptor,
-                                      pBuffer,
-                                      bytesToSend,
-                                      0 );
+        bytesSent = ( int32_t ) sendmsg( pPlaintextParams->socketDescriptor,
+                                         &message,
+                                         flags );
+
+        if( ( bytesSent < 0 ) && ( ( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) ) )
+        {
+            /* Socket is not available for sending data. */
+            bytesSent = 0;
+            pollStatus = 0;
+        }
     }
     else if( pollStatus < 0 )
     {
@@ -22,11 +22,15 @@
 
 /* Standard includes. */
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 
 /* POSIX sockets includes. */
 #include <errno.h>
+#include <fcntl.h>
 #include <netdb.h>
+#include <poll.h>
+#include <pthread.h>
 #include <time.h>
 #include <unistd.h>
 #include <sys/time.h>
@@ -47,6 +51,107 @@
  */
 #define ONE_MS_TO_US     ( 1000 )
 
+/**
+ * @brief Number of nanoseconds in one millisecond.
+ */
+#define ONE_MS_TO_NS     ( 1000000 )
+
+/**
+ * @brief Head start given to a connection attempt in #Sockets_ConnectParallel
+ * before the attempt to the next address is started.
+ *
+ * RFC 8305 recommends 250 milliseconds.
+ */
+#ifndef SOCKETS_CONNECTION_ATTEMPT_DELAY_MS
+    #define SOCKETS_CONNECTION_ATTEMPT_DELAY_MS    ( 250 )
+#endif
+
+/**
+ * @brief Maximum number of resolved addresses tried by #Sockets_ConnectParallel.
+ */
+#ifndef SOCKETS_MAX_CONNECTION_ATTEMPTS
+    #define SOCKETS_MAX_CONNECTION_ATTEMPTS    ( 8U )
+#endif
+
+/**
+ * @brief Maximum number of host names kept in the DNS cache.
+ *
+ * When the cache is full, the entry closest to expiry is replaced.
+ */
+#ifndef SOCKETS_DNS_CACHE_SIZE
+    #define SOCKETS_DNS_CACHE_SIZE    ( 8U )
+#endif
+
+/**
+ * @brief Time for which resolved addresses are reused.
+ *
+ * getaddrinfo does not report the TTL of the DNS records, so a fixed time is
+ * used. The default of 0 disables caching of resolved addresses, so that every
+ * connection sees DNS changes at once.
+ */
+#ifndef SOCKETS_DNS_CACHE_TTL_MS
+    #define SOCKETS_DNS_CACHE_TTL_MS    ( 0U )
+#endif
+
+/**
+ * @brief Time for which a host name that does not exist is not looked up
+ * again.
+ *
+ * Only failures reporting that the name does not exist are cached; temporary
+ * resolver failures are always retried. The default of 0 disables negative
+ * caching.
+ */
+#ifndef SOCKETS_DNS_CACHE_NEGATIVE_TTL_MS
+    #define SOCKETS_DNS_CACHE_NEGATIVE_TTL_MS    ( 0U )
+#endif
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Resolution of a host name kept in the DNS cache.
+ */
+typedef struct DnsCacheEntry
+{
+    char * pHostName;            /**< @brief NULL-terminated host name; NULL if the entry is free. */
+    struct addrinfo * pListHead; /**< @brief Copy of the resolved records; NULL for a failed resolution. */
+    uint64_t expiryTimeMs;       /**< @brief Monotonic time after which the entry is stale. */
+} DnsCacheEntry_t;
+
+/**
+ * @brief Host name resolution shared between the caller of
+ * #Sockets_ConnectParallel and the thread performing the lookup.
+ *
+ * The request is freed by whichever of the two releases it last, so the caller
+ * can give up on a slow lookup without waiting for it to finish.
+ */
+typedef struct ResolverRequest
+{
+    pthread_mutex_t mutex;       /**< @brief Protects the members below. */
+    pthread_cond_t completed;    /**< @brief Signalled when the lookup finishes. */
+    char * pHostName;            /**< @brief NULL-terminated copy of the host name. */
+    struct addrinfo * pListHead; /**< @brief Resolved records, until taken by the caller. */
+    int32_t dnsStatus;           /**< @brief Return value of getaddrinfo. */
+    uint8_t isComplete;          /**< @brief 1 once the lookup has finished. */
+    uint8_t referenceCount;      /**< @brief Number of parties still using the request. */
+} ResolverRequest_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Cached host name resolutions.
+ */
+static DnsCacheEntry_t dnsCache[ SOCKETS_DNS_CACHE_SIZE ];
+
+/**
+ * @brief Counters of the DNS cache.
+ */
+static SocketsDnsCacheStats_t dnsCacheStats = { 0 };
+
+/**
+ * @brief Mutex protecting #dnsCache and #dnsCacheStats.
+ */
+static pthread_mutex_t dnsCacheMutex = PTHREAD_MUTEX_INITIALIZER;
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -102,6 +207,194 @@ static SocketStatus_t connectToAddress( struct sockaddr * pAddrInfo,
  */
 static SocketStatus_t retrieveError( int32_t errorNumber );
 
+/**
+ * @brief Set the send and receive timeouts of a connected socket.
+ *
+ * @param[in] tcpSocket Socket handle.
+ * @param[in] sendTimeoutMs Timeout for transport send.
+ * @param[in] recvTimeoutMs Timeout for transport recv.
+ *
+ * @return #SOCKETS_SUCCESS if successful; #SOCKETS_API_ERROR,
+ * #SOCKETS_INSUFFICIENT_MEMORY, #SOCKETS_INVALID_PARAMETER on error.
+ */
+static SocketStatus_t setSocketTimeouts( int32_t tcpSocket,
+                                         uint32_t sendTimeoutMs,
+                                         uint32_t recvTimeoutMs );
+
+/**
+ * @brief Get the number of milliseconds left until a deadline.
+ *
+ * @param[in] pDeadline Deadline on the monotonic clock.
+ *
+ * @return Milliseconds remaining, or 0 if the deadline has passed.
+ */
+static int32_t getRemainingTimeMs( const struct timespec * pDeadline );
+
+/**
+ * @brief Drop a reference to a resolver request, freeing it when no references
+ * remain.
+ *
+ * @param[in] pRequest Resolver request.
+ */
+static void releaseResolverRequest( ResolverRequest_t * pRequest );
+
+/**
+ * @brief Thread performing the lookup of a resolver request.
+ *
+ * @param[in] pArgument The #ResolverRequest_t to resolve.
+ *
+ * @return NULL.
+ */
+static void * resolverThread( void * pArgument );
+
+/**
+ * @brief Resolve a host name on a separate thread, waiting for it no later
+ * than a deadline.
+ *
+ * @param[in] pHostName Server host name.
+ * @param[in] hostNameLength Length associated with host name.
+ * @param[in] pDeadline Deadline on the monotonic clock.
+ * @param[out] pListHead The output parameter to return the list containing
+ * resolved DNS records.
+ *
+ * @return #SOCKETS_SUCCESS if successful; #SOCKETS_DNS_FAILURE,
+ * #SOCKETS_INSUFFICIENT_MEMORY, #SOCKETS_API_ERROR on error.
+ */
+static SocketStatus_t resolveHostNameWithDeadline( const char * pHostName,
+                                                   size_t hostNameLength,
+                                                   const struct timespec * pDeadline,
+                                                   struct addrinfo ** pListHead );
+
+/**
+ * @brief Order resolved addresses for connection attempts, alternating
+ * between address families starting with the family of the first record.
+ *
+ * @param[in] pListHead List containing resolved DNS records.
+ * @param[out] pAddresses Array of #SOCKETS_MAX_CONNECTION_ATTEMPTS records.
+ *
+ * @return Number of records written to @p pAddresses.
+ */
+static size_t orderAddresses( const struct addrinfo * pListHead,
+                              const struct addrinfo ** pAddresses );
+
+/**
+ * @brief Start a non-blocking connection to an address.
+ *
+ * @param[in] pAddress Address record of the server.
+ * @param[in] port Server port in host-order.
+ * @param[out] pIsConnected Set to 1 if the connection completed immediately.
+ *
+ * @return Socket of the connection attempt, or -1 if it failed immediately.
+ */
+static int32_t startConnectionAttempt( const struct addrinfo * pAddress,
+                                       uint16_t port,
+                                       uint8_t * pIsConnected );
+
+/**
+ * @brief Get the current time of the monotonic clock.
+ *
+ * @return Time in milliseconds.
+ */
+static uint64_t getMonotonicTimeMs( void );
+
+/**
+ * @brief Copy a list of DNS records into memory owned by this file.
+ *
+ * Records returned by the DNS cache are always copies, as the connection
+ * attempts write the port into them.
+ *
+ * @param[in] pListHead List to copy.
+ *
+ * @return The copy, to be freed with #freeAddressList; NULL if out of memory.
+ */
+static struct addrinfo * copyAddressList( const struct addrinfo * pListHead );
+
+/**
+ * @brief Free a list created by #copyAddressList.
+ *
+ * @param[in] pListHead List to free. May be NULL.
+ */
+static void freeAddressList( struct addrinfo * pListHead );
+
+/**
+ * @brief Look up a host name in the DNS cache.
+ *
+ * @param[in] pHostName Server host name.
+ * @param[in] hostNameLength Length associated with host name.
+ * @param[out] pListHead Copy of the cached records on a positive hit.
+ * @param[out] pStatus #SOCKETS_SUCCESS on a positive hit, #SOCKETS_DNS_FAILURE
+ * on a negative hit, #SOCKETS_INSUFFICIENT_MEMORY if the records could not
+ * be copied.
+ *
+ * @return 1 if the cache held a current entry for the host name; 0 otherwise.
+ */
+static int32_t lookupDnsCache( const char * pHostName,
+                               size_t hostNameLength,
+                               struct addrinfo ** pListHead,
+                               SocketStatus_t * pStatus );
+
+/**
+ * @brief Store the result of a DNS query in the DNS cache.
+ *
+ * @param[in] pHostName Server host name.
+ * @param[in] hostNameLength Length associated with host name.
+ * @param[in] dnsStatus Return value of getaddrinfo.
+ * @param[in] pListHead Records returned by getaddrinfo if @p dnsStatus is 0.
+ */
+static void updateDnsCache( const char * pHostName,
+                            size_t hostNameLength,
+                            int32_t dnsStatus,
+                            const struct addrinfo * pListHead );
+
+/**
+ * @brief Drop a host name from the DNS cache after none of its addresses
+ * could be connected to.
+ *
+ * @param[in] pHostName Server host name.
+ * @param[in] hostNameLength Length associated with host name.
+ */
+static void invalidateDnsCache( const char * pHostName,
+                                size_t hostNameLength );
+
+/**
+ * @brief Find the entry of a host name in the DNS cache.
+ *
+ * @note #dnsCacheMutex must be held by the caller.
+ *
+ * @param[in] pHostName Server host name.
+ * @param[in] hostNameLength Length associated with host name.
+ *
+ * @return The entry, or NULL if the host name is not cached.
+ */
+static DnsCacheEntry_t * findDnsCacheEntry( const char * pHostName,
+                                            size_t hostNameLength );
+
+/**
+ * @brief Free the contents of a DNS cache entry.
+ *
+ * @note #dnsCacheMutex must be held by the caller.
+ *
+ * @param[in] pEntry Entry to clear.
+ */
+static void clearDnsCacheEntry( DnsCacheEntry_t * pEntry );
+
+/**
+ * @brief Race connection attempts to the resolved addresses until one
+ * completes or the deadline passes.
+ *
+ * @param[in] pListHead List containing resolved DNS records.
+ * @param[in] pServerInfo Server connection info.
+ * @param[in] pDeadline Deadline on the monotonic clock.
+ * @param[out] pTcpSocket The output parameter to return the connected socket,
+ * in blocking mode.
+ *
+ * @return #SOCKETS_SUCCESS if successful; #SOCKETS_CONNECT_FAILURE on error.
+ */
+static SocketStatus_t raceConnections( const struct addrinfo * pListHead,
+                                       const ServerInfo_t * pServerInfo,
+                                       const struct timespec * pDeadline,
+                                       int32_t * pTcpSocket );
+
 /*-----------------------------------------------------------*/
 
 static SocketStatus_t resolveHostName( const char * pHostName,
@@ -111,32 +404,56 @@ static SocketStatus_t resolveHostName( const char * pHostName,
     SocketStatus_t returnStatus = SOCKETS_SUCCESS;
     int32_t dnsStatus = -1;
     struct addrinfo hints;
+    struct addrinfo * pResolvedList = NULL;
 
     assert( pHostName != NULL );
     assert( hostNameLength > 0 );
 
-    /* Unused parameter. These parameters are used only for logging. */
-    ( void ) hostNameLength;
+    if( lookupDnsCache( pHostName, hostNameLength, pListHead, &returnStatus ) == 0 )
+    {
+        /* Add hints to retrieve only TCP sockets in getaddrinfo. */
+        ( void ) memset( &hints, 0, sizeof( hints ) );
 
-    /* Add hints to retrieve only TCP sockets in getaddrinfo. */
-    ( void ) memset( &hints, 0, sizeof( hints ) );
+        /* Address family of either IPv4 or IPv6. */
+        hints.ai_family = AF_UNSPEC;
+        /* TCP Socket. */
+        hints.ai_socktype = ( int32_t ) SOCK_STREAM;
+        hints.ai_protocol = IPPROTO_TCP;
 
-    /* Address family of either IPv4 or IPv6. */
-    hints.ai_family = AF_UNSPEC;
-    /* TCP Socket. */
-    hints.ai_socktype = ( int32_t ) SOCK_STREAM;
-    hints.ai_protocol = IPPROTO_TCP;
+        /* Perform a DNS lookup on the given host name. */
+        dnsStatus = getaddrinfo( pHostName, NULL, &hints, &pResolvedList );
 
-    /* Perform a DNS lookup on the given host name. */
-    dnsStatus = getaddrinfo( pHostName, NULL, &hints, pListHead );
+        updateDnsCache( pHostName, hostNameLength, dnsStatus, pResolvedList );
+
+        if( dnsStatus != 0 )
+        {
+            LogError( ( "Failed to resolve DNS: Hostname=%.*s, ErrorCode=%d.\n",
+                        ( int32_t ) hostNameLength,
+                        pHostName,
+                        dnsStatus ) );
+            returnStatus = SOCKETS_DNS_FAILURE;
+        }
+        else
+        {
+            *pListHead = copyAddressList( pResolvedList );
+            freeaddrinfo( pResolvedList );
 
-    if( dnsStatus != 0 )
+            if( *pListHead == NULL )
+            {
+                LogError( ( "Failed to allocate memory for the resolved addresses." ) );
+                returnStatus = SOCKETS_INSUFFICIENT_MEMORY;
+            }
+        }
+    }
+    else if( returnStatus == SOCKETS_DNS_FAILURE )
     {
-        LogError( ( "Failed to resolve DNS: Hostname=%.*s, ErrorCode=%d.\n",
+        LogError( ( "Failed to resolve DNS: Hostname=%.*s does not exist (cached).",
                     ( int32_t ) hostNameLength,
-                    pHostName,
-                    dnsStatus ) );
-        returnStatus = SOCKETS_DNS_FAILURE;
+                    pHostName ) );
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
     }
 
     return returnStatus;
@@ -273,7 +590,7 @@ static SocketStatus_t attemptConnection( struct addrinfo * pListHead,
                     pHostName ) );
     }
 
-    freeaddrinfo( pListHead );
+    freeAddressList( pListHead );
 
     return returnStatus;
 }
@@ -302,80 +619,34 @@ static SocketStatus_t retrieveError( int32_t errorNumber )
 }
 /*-----------------------------------------------------------*/
 
-SocketStatus_t Sockets_Connect( int32_t * pTcpSocket,
-                                const ServerInfo_t * pServerInfo,
-                                uint32_t sendTimeoutMs,
-                                uint32_t recvTimeoutMs )
+static SocketStatus_t setSocketTimeouts( int32_t tcpSocket,
+                                         uint32_t sendTimeoutMs,
+                                         uint32_t recvTimeoutMs )
 {
     SocketStatus_t returnStatus = SOCKETS_SUCCESS;
-    struct addrinfo * pListHead = NULL;
     struct timeval transportTimeout;
     int32_t setTimeoutStatus = -1;
 
-    if( pServerInfo == NULL )
-    {
-        LogError( ( "Parameter check failed: pServerInfo is NULL." ) );
-        returnStatus = SOCKETS_INVALID_PARAMETER;
-    }
-    else if( pServerInfo->pHostName == NULL )
-    {
-        LogError( ( "Parameter check failed: pServerInfo->pHostName is NULL." ) );
-        returnStatus = SOCKETS_INVALID_PARAMETER;
-    }
-    else if( pTcpSocket == NULL )
-    {
-        LogError( ( "Parameter check failed: pTcpSocket is NULL." ) );
-        returnStatus = SOCKETS_INVALID_PARAMETER;
-    }
-    else if( pServerInfo->hostNameLength == 0UL )
-    {
-        LogError( ( "Parameter check failed: hostNameLength must be greater than 0." ) );
-        returnStatus = SOCKETS_INVALID_PARAMETER;
-    }
-    else
-    {
-        /* Empty else. */
-    }
-
-    if( returnStatus == SOCKETS_SUCCESS )
-    {
-        returnStatus = resolveHostName( pServerInfo->pHostName,
-                                        pServerInfo->hostNameLength,
-                                        &pListHead );
-    }
-
-    if( returnStatus == SOCKETS_SUCCESS )
-    {
-        returnStatus = attemptConnection( pListHead,
-                                          pServerInfo->pHostName,
-                                          pServerInfo->hostNameLength,
-                                          pServerInfo->port,
-                                          pTcpSocket );
-    }
-
     /* Set the send timeout. */
-    if( returnStatus == SOCKETS_SUCCESS )
-    {
-        transportTimeout.tv_sec = ( ( ( int64_t ) sendTimeoutMs ) / ONE_SEC_TO_MS );
-        transportTimeout.tv_usec = ( ONE_MS_TO_US * ( ( ( int64_t ) sendTimeoutMs ) % ONE_SEC_TO_MS ) );
+    transportTimeout.tv_sec = ( ( ( int64_t ) sendTimeoutMs ) / ONE_SEC_TO_MS );
+    transportTimeout.tv_usec = ( ONE_MS_TO_US * ( ( ( int64_t ) sendTimeoutMs ) % ONE_SEC_TO_MS ) );
 
-        setTimeoutStatus = setsockopt( *pTcpSocket,
-                                       SOL_SOCKET,
-                                       SO_SNDTIMEO,
-                                       &transportTimeout,
-                                       ( socklen_t ) sizeof( transportTimeout ) );
+    setTimeoutStatus = setsockopt( tcpSocket,
+                                   SOL_SOCKET,
+                                   SO_SNDTIMEO,
+                                   &transportTimeout,
+                                   ( socklen_t ) sizeof( transportTimeout ) );
 
-        if( setTimeoutStatus < 0 )
+    if( setTimeoutStatus < 0 )
+    {
+        if( errno == ENOPROTOOPT )
         {
-            if( errno == ENOPROTOOPT )
-            {
-                LogInfo( ( "Setting socket send timeout skipped." ) );
-            }
-            else
-            {
-                LogError( ( "Setting socket send timeout failed." ) );
-                returnStatus = retrieveError( errno );
-            }
+            LogInfo( ( "Setting socket send timeout skipped." ) );
+        }
+        else
+        {
+            LogError( ( "Setting socket send timeout failed." ) );
+            returnStatus = retrieveError( errno );
         }
     }
 
@@ -385,7 +656,7 @@ SocketStatus_t Sockets_Connect( int32_t * pTcpSocket,
         transportTimeout.tv_sec = ( ( ( int64_t ) recvTimeoutMs ) / ONE_SEC_TO_MS );
         transportTimeout.tv_usec = ( ONE_MS_TO_US * ( ( ( int64_t ) recvTimeoutMs ) % ONE_SEC_TO_MS ) );
 
-        setTimeoutStatus = setsockopt( *pTcpSocket,
+        setTimeoutStatus = setsockopt( tcpSocket,
                                        SOL_SOCKET,
                                        SO_RCVTIMEO,
                                        &transportTimeout,
@@ -409,6 +680,928 @@ SocketStatus_t Sockets_Connect( int32_t * pTcpSocket,
 }
 /*-----------------------------------------------------------*/
 
+static int32_t getRemainingTimeMs( const struct timespec * pDeadline )
+{
+    struct timespec now;
+    int64_t remainingMs = 0;
+
+    assert( pDeadline != NULL );
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &now );
+
+    remainingMs = ( ( ( int64_t ) pDeadline->tv_sec - ( int64_t ) now.tv_sec ) * ONE_SEC_TO_MS ) +
+                  ( ( ( int64_t ) pDeadline->tv_nsec - ( int64_t ) now.tv_nsec ) / ONE_MS_TO_NS );
+
+    if( remainingMs < 0 )
+    {
+        remainingMs = 0;
+    }
+
+    return ( int32_t ) remainingMs;
+}
+/*-----------------------------------------------------------*/
+
+static void releaseResolverRequest( ResolverRequest_t * pRequest )
+{
+    uint8_t referenceCount = 0U;
+
+    assert( pRequest != NULL );
+
+    ( void ) pthread_mutex_lock( &pRequest->mutex );
+    pRequest->referenceCount--;
+    referenceCount = pRequest->referenceCount;
+    ( void ) pthread_mutex_unlock( &pRequest->mutex );
+
+    if( referenceCount == 0U )
+    {
+        freeAddressList( pRequest->pListHead );
+
+        ( void ) pthread_cond_destroy( &pRequest->completed );
+        ( void ) pthread_mutex_destroy( &pRequest->mutex );
+        free( pRequest->pHostName );
+        free( pRequest );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void * resolverThread( void * pArgument )
+{
+    ResolverRequest_t * pRequest = pArgument;
+    struct addrinfo hints;
+    struct addrinfo * pListHead = NULL;
+    int32_t dnsStatus = -1;
+
+    assert( pRequest != NULL );
+
+    /* Add hints to retrieve only TCP sockets in getaddrinfo. */
+    ( void ) memset( &hints, 0, sizeof( hints ) );
+
+    /* Address family of either IPv4 or IPv6. */
+    hints.ai_family = AF_UNSPEC;
+    /* TCP Socket. */
+    hints.ai_socktype = ( int32_t ) SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+
+    /* The host name copy is not modified once the thread is started. */
+    dnsStatus = getaddrinfo( pRequest->pHostName, NULL, &hints, &pListHead );
+
+    /* Cache the result even if the caller has given up waiting, so that its
+     * next attempt does not have to wait for the resolver again. */
+    updateDnsCache( pRequest->pHostName, strlen( pRequest->pHostName ), dnsStatus, pListHead );
+
+    ( void ) pthread_mutex_lock( &pRequest->mutex );
+    pRequest->dnsStatus = dnsStatus;
+
+    if( dnsStatus == 0 )
+    {
+        pRequest->pListHead = copyAddressList( pListHead );
+        freeaddrinfo( pListHead );
+
+        if( pRequest->pListHead == NULL )
+        {
+            pRequest->dnsStatus = EAI_MEMORY;
+        }
+    }
+
+    pRequest->isComplete = 1U;
+    ( void ) pthread_cond_signal( &pRequest->completed );
+    ( void ) pthread_mutex_unlock( &pRequest->mutex );
+
+    releaseResolverRequest( pRequest );
+
+    return NULL;
+}
+/*-----------------------------------------------------------*/
+
+static SocketStatus_t resolveHostNameWithDeadline( const char * pHostName,
+                                                   size_t hostNameLength,
+                                                   const struct timespec * pDeadline,
+                                                   struct addrinfo ** pListHead )
+{
+    SocketStatus_t returnStatus = SOCKETS_SUCCESS;
+    ResolverRequest_t * pRequest = NULL;
+    pthread_condattr_t conditionAttributes;
+    pthread_attr_t threadAttributes;
+    pthread_t thread;
+    int32_t waitStatus = 0;
+    uint8_t isCached = 0U;
+
+    assert( pHostName != NULL );
+    assert( hostNameLength > 0 );
+    assert( pDeadline != NULL );
+    assert( pListHead != NULL );
+
+    if( lookupDnsCache( pHostName, hostNameLength, pListHead, &returnStatus ) == 1 )
+    {
+        isCached = 1U;
+
+        if( returnStatus == SOCKETS_DNS_FAILURE )
+        {
+            LogError( ( "Failed to resolve DNS: Hostname=%.*s does not exist (cached).",
+                        ( int32_t ) hostNameLength,
+                        pHostName ) );
+        }
+    }
+    else
+    {
+        pRequest = calloc( 1, sizeof( ResolverRequest_t ) );
+
+        if( pRequest != NULL )
+        {
+            pRequest->pHostName = malloc( hostNameLength + 1U );
+        }
+
+        if( ( pRequest == NULL ) || ( pRequest->pHostName == NULL ) )
+        {
+            LogError( ( "Failed to allocate memory for the DNS request." ) );
+            free( pRequest );
+            pRequest = NULL;
+            returnStatus = SOCKETS_INSUFFICIENT_MEMORY;
+        }
+        else
+        {
+            ( void ) memcpy( pRequest->pHostName, pHostName, hostNameLength );
+            pRequest->pHostName[ hostNameLength ] = '\0';
+
+            /* The deadline is on the monotonic clock, so the condition variable
+             * must wait on the same clock. */
+            ( void ) pthread_condattr_init( &conditionAttributes );
+            ( void ) pthread_condattr_setclock( &conditionAttributes, CLOCK_MONOTONIC );
+            ( void ) pthread_cond_init( &pRequest->completed, &conditionAttributes );
+            ( void ) pthread_condattr_destroy( &conditionAttributes );
+            ( void ) pthread_mutex_init( &pRequest->mutex, NULL );
+
+            /* One reference for the caller and one for the resolver thread. */
+            pRequest->referenceCount = 2U;
+
+            ( void ) pthread_attr_init( &threadAttributes );
+            ( void ) pthread_attr_setdetachstate( &threadAttributes, PTHREAD_CREATE_DETACHED );
+
+            if( pthread_create( &thread, &threadAttributes, resolverThread, pRequest ) != 0 )
+            {
+                LogError( ( "Failed to create the DNS resolver thread." ) );
+                pRequest->referenceCount = 1U;
+                returnStatus = SOCKETS_API_ERROR;
+            }
+
+            ( void ) pthread_attr_destroy( &threadAttributes );
+        }
+    }
+
+    if( ( returnStatus == SOCKETS_SUCCESS ) && ( isCached == 0U ) )
+    {
+        ( void ) pthread_mutex_lock( &pRequest->mutex );
+
+        while( ( pRequest->isComplete == 0U ) && ( waitStatus != ETIMEDOUT ) )
+        {
+            waitStatus = pthread_cond_timedwait( &pRequest->completed,
+                                                 &pRequest->mutex,
+                                                 pDeadline );
+        }
+
+        if( pRequest->isComplete == 0U )
+        {
+            /* The resolver thread frees the request when it finishes. */
+            LogError( ( "Timed out resolving DNS: Hostname=%.*s.",
+                        ( int32_t ) hostNameLength,
+                        pHostName ) );
+            returnStatus = SOCKETS_DNS_FAILURE;
+        }
+        else if( pRequest->dnsStatus != 0 )
+        {
+            LogError( ( "Failed to resolve DNS: Hostname=%.*s, ErrorCode=%d.",
+                        ( int32_t ) hostNameLength,
+                        pHostName,
+                        pRequest->dnsStatus ) );
+            returnStatus = SOCKETS_DNS_FAILURE;
+        }
+        else
+        {
+            /* Take ownership of the records. */
+            *pListHead = pRequest->pListHead;
+            pRequest->pListHead = NULL;
+        }
+
+        ( void ) pthread_mutex_unlock( &pRequest->mutex );
+    }
+
+    if( pRequest != NULL )
+    {
+        releaseResolverRequest( pRequest );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+static size_t orderAddresses( const struct addrinfo * pListHead,
+                              const struct addrinfo ** pAddresses )
+{
+    const struct addrinfo * pPreferred = pListHead;
+    const struct addrinfo * pOther = pListHead;
+    int32_t preferredFamily = AF_UNSPEC;
+    size_t addressCount = 0U;
+    uint8_t usePreferred = 1U;
+
+    assert( pListHead != NULL );
+    assert( pAddresses != NULL );
+
+    preferredFamily = pListHead->ai_family;
+
+    /* Walk the records of each family in resolver order, taking from the
+     * two families alternately. */
+    while( addressCount < SOCKETS_MAX_CONNECTION_ATTEMPTS )
+    {
+        while( ( pPreferred != NULL ) && ( pPreferred->ai_family != preferredFamily ) )
+        {
+            pPreferred = pPreferred->ai_next;
+        }
+
+        while( ( pOther != NULL ) && ( pOther->ai_family == preferredFamily ) )
+        {
+            pOther = pOther->ai_next;
+        }
+
+        if( ( pPreferred == NULL ) && ( pOther == NULL ) )
+        {
+            break;
+        }
+
+        if( ( pOther == NULL ) || ( ( usePreferred == 1U ) && ( pPreferred != NULL ) ) )
+        {
+            pAddresses[ addressCount ] = pPreferred;
+            pPreferred = pPreferred->ai_next;
+        }
+        else
+        {
+            pAddresses[ addressCount ] = pOther;
+            pOther = pOther->ai_next;
+        }
+
+        addressCount++;
+        usePreferred = ( usePreferred == 1U ) ? 0U : 1U;
+    }
+
+    return addressCount;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t startConnectionAttempt( const struct addrinfo * pAddress,
+                                       uint16_t port,
+                                       uint8_t * pIsConnected )
+{
+    int32_t tcpSocket = -1, flags = 0;
+    struct sockaddr_storage address;
+    socklen_t addressLength = 0;
+
+    assert( pAddress != NULL );
+    assert( pIsConnected != NULL );
+
+    *pIsConnected = 0U;
+
+    if( ( ( pAddress->ai_family == AF_INET ) || ( pAddress->ai_family == AF_INET6 ) ) &&
+        ( pAddress->ai_addrlen <= sizeof( address ) ) )
+    {
+        tcpSocket = socket( pAddress->ai_family,
+                            pAddress->ai_socktype,
+                            pAddress->ai_protocol );
+    }
+
+    if( tcpSocket != -1 )
+    {
+        flags = fcntl( tcpSocket, F_GETFL, 0 );
+
+        if( ( flags == -1 ) || ( fcntl( tcpSocket, F_SETFL, flags | O_NONBLOCK ) == -1 ) )
+        {
+            ( void ) close( tcpSocket );
+            tcpSocket = -1;
+        }
+    }
+
+    if( tcpSocket != -1 )
+    {
+        /* Copy the record so that the resolved list is not modified. */
+        ( void ) memcpy( &address, pAddress->ai_addr, pAddress->ai_addrlen );
+        addressLength = ( socklen_t ) pAddress->ai_addrlen;
+
+        /* MISRA Rule 11.3 flags the following lines for casting a pointer of
+         * a object type to a pointer of a different object type. This rule
+         * is suppressed because casting from a struct sockaddr_storage pointer
+         * to a struct sockaddr_in or sockaddr_in6 pointer is supported in POSIX. */
+        if( pAddress->ai_family == AF_INET )
+        {
+            /* coverity[misra_c_2012_rule_11_3_violation] */
+            ( ( struct sockaddr_in * ) &address )->sin_port = htons( port );
+        }
+        else
+        {
+            /* coverity[misra_c_2012_rule_11_3_violation] */
+            ( ( struct sockaddr_in6 * ) &address )->sin6_port = htons( port );
+        }
+
+        if( connect( tcpSocket, ( struct sockaddr * ) &address, addressLength ) == 0 )
+        {
+            *pIsConnected = 1U;
+        }
+        else if( errno != EINPROGRESS )
+        {
+            LogWarn( ( "Failed to start connection to a resolved address: %s.",
+                       strerror( errno ) ) );
+            ( void ) close( tcpSocket );
+            tcpSocket = -1;
+        }
+        else
+        {
+            /* Connection in progress. */
+        }
+    }
+
+    return tcpSocket;
+}
+/*-----------------------------------------------------------*/
+
+static uint64_t getMonotonicTimeMs( void )
+{
+    struct timespec now;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ( ( uint64_t ) now.tv_sec * ( uint64_t ) ONE_SEC_TO_MS ) +
+           ( ( uint64_t ) now.tv_nsec / ( uint64_t ) ONE_MS_TO_NS );
+}
+/*-----------------------------------------------------------*/
+
+static struct addrinfo * copyAddressList( const struct addrinfo * pListHead )
+{
+    struct addrinfo * pCopyHead = NULL;
+    struct addrinfo ** ppNext = &pCopyHead;
+    struct addrinfo * pCopy = NULL;
+    const struct addrinfo * pIndex = NULL;
+    uint8_t isOutOfMemory = 0U;
+
+    for( pIndex = pListHead; ( pIndex != NULL ) && ( isOutOfMemory == 0U ); pIndex = pIndex->ai_next )
+    {
+        /* Allocate the record and its address in one block. */
+        pCopy = malloc( sizeof( struct addrinfo ) + pIndex->ai_addrlen );
+
+        if( pCopy == NULL )
+        {
+            isOutOfMemory = 1U;
+        }
+        else
+        {
+            ( void ) memcpy( pCopy, pIndex, sizeof( struct addrinfo ) );
+            pCopy->ai_addr = ( struct sockaddr * ) &pCopy[ 1 ];
+            ( void ) memcpy( pCopy->ai_addr, pIndex->ai_addr, pIndex->ai_addrlen );
+            pCopy->ai_canonname = NULL;
+            pCopy->ai_next = NULL;
+
+            *ppNext = pCopy;
+            ppNext = &pCopy->ai_next;
+        }
+    }
+
+    if( isOutOfMemory == 1U )
+    {
+        freeAddressList( pCopyHead );
+        pCopyHead = NULL;
+    }
+
+    return pCopyHead;
+}
+/*-----------------------------------------------------------*/
+
+static void freeAddressList( struct addrinfo * pListHead )
+{
+    struct addrinfo * pNext = NULL;
+
+    while( pListHead != NULL )
+    {
+        pNext = pListHead->ai_next;
+        free( pListHead );
+        pListHead = pNext;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static DnsCacheEntry_t * findDnsCacheEntry( const char * pHostName,
+                                            size_t hostNameLength )
+{
+    DnsCacheEntry_t * pEntry = NULL;
+    size_t index = 0U;
+
+    for( index = 0U; index < SOCKETS_DNS_CACHE_SIZE; index++ )
+    {
+        if( ( dnsCache[ index ].pHostName != NULL ) &&
+            ( strncmp( dnsCache[ index ].pHostName, pHostName, hostNameLength ) == 0 ) &&
+            ( dnsCache[ index ].pHostName[ hostNameLength ] == '\0' ) )
+        {
+            pEntry = &dnsCache[ index ];
+            break;
+        }
+    }
+
+    return pEntry;
+}
+/*-----------------------------------------------------------*/
+
+static void clearDnsCacheEntry( DnsCacheEntry_t * pEntry )
+{
+    free( pEntry->pHostName );
+    freeAddressList( pEntry->pListHead );
+    pEntry->pHostName = NULL;
+    pEntry->pListHead = NULL;
+    pEntry->expiryTimeMs = 0U;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t lookupDnsCache( const char * pHostName,
+                               size_t hostNameLength,
+                               struct addrinfo ** pListHead,
+                               SocketStatus_t * pStatus )
+{
+    int32_t isCached = 0;
+    DnsCacheEntry_t * pEntry = NULL;
+
+    assert( pHostName != NULL );
+    assert( pListHead != NULL );
+    assert( pStatus != NULL );
+
+    ( void ) pthread_mutex_lock( &dnsCacheMutex );
+
+    pEntry = findDnsCacheEntry( pHostName, hostNameLength );
+
+    if( ( pEntry != NULL ) && ( pEntry->expiryTimeMs <= getMonotonicTimeMs() ) )
+    {
+        clearDnsCacheEntry( pEntry );
+        pEntry = NULL;
+    }
+
+    if( pEntry == NULL )
+    {
+        dnsCacheStats.misses++;
+    }
+    else if( pEntry->pListHead == NULL )
+    {
+        dnsCacheStats.negativeHits++;
+        *pStatus = SOCKETS_DNS_FAILURE;
+        isCached = 1;
+    }
+    else
+    {
+        dnsCacheStats.hits++;
+        *pListHead = copyAddressList( pEntry->pListHead );
+        *pStatus = ( *pListHead != NULL ) ? SOCKETS_SUCCESS : SOCKETS_INSUFFICIENT_MEMORY;
+        isCached = 1;
+    }
+
+    ( void ) pthread_mutex_unlock( &dnsCacheMutex );
+
+    return isCached;
+}
+/*-----------------------------------------------------------*/
+
+static void updateDnsCache( const char * pHostName,
+                            size_t hostNameLength,
+                            int32_t dnsStatus,
+                            const struct addrinfo * pListHead )
+{
+    DnsCacheEntry_t * pEntry = NULL;
+    struct addrinfo * pCopy = NULL;
+    uint64_t ttlMs = 0U;
+    size_t index = 0U;
+
+    assert( pHostName != NULL );
+
+    if( dnsStatus == 0 )
+    {
+        ttlMs = SOCKETS_DNS_CACHE_TTL_MS;
+    }
+    else if( dnsStatus == EAI_NONAME )
+    {
+        /* Only cache failures stating that the name does not exist. */
+        ttlMs = SOCKETS_DNS_CACHE_NEGATIVE_TTL_MS;
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    if( ( ttlMs > 0U ) && ( dnsStatus == 0 ) )
+    {
+        pCopy = copyAddressList( pListHead );
+
+        if( pCopy == NULL )
+        {
+            ttlMs = 0U;
+        }
+    }
+
+    if( ttlMs > 0U )
+    {
+        ( void ) pthread_mutex_lock( &dnsCacheMutex );
+
+        pEntry = findDnsCacheEntry( pHostName, hostNameLength );
+
+        /* Use a free entry, or replace the entry closest to expiry. */
+        for( index = 0U; ( index < SOCKETS_DNS_CACHE_SIZE ) && ( pEntry == NULL ); index++ )
+        {
+            if( dnsCache[ index ].pHostName == NULL )
+            {
+                pEntry = &dnsCache[ index ];
+            }
+        }
+
+        if( pEntry == NULL )
+        {
+            pEntry = &dnsCache[ 0 ];
+
+            for( index = 1U; index < SOCKETS_DNS_CACHE_SIZE; index++ )
+            {
+                if( dnsCache[ index ].expiryTimeMs < pEntry->expiryTimeMs )
+                {
+                    pEntry = &dnsCache[ index ];
+                }
+            }
+        }
+
+        clearDnsCacheEntry( pEntry );
+        pEntry->pHostName = malloc( hostNameLength + 1U );
+
+        if( pEntry->pHostName == NULL )
+        {
+            freeAddressList( pCopy );
+        }
+        else
+        {
+            ( void ) memcpy( pEntry->pHostName, pHostName, hostNameLength );
+            pEntry->pHostName[ hostNameLength ] = '\0';
+            pEntry->pListHead = pCopy;
+            pEntry->expiryTimeMs = getMonotonicTimeMs() + ttlMs;
+        }
+
+        ( void ) pthread_mutex_unlock( &dnsCacheMutex );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void invalidateDnsCache( const char * pHostName,
+                                size_t hostNameLength )
+{
+    DnsCacheEntry_t * pEntry = NULL;
+
+    ( void ) pthread_mutex_lock( &dnsCacheMutex );
+
+    pEntry = findDnsCacheEntry( pHostName, hostNameLength );
+
+    if( pEntry != NULL )
+    {
+        LogDebug( ( "Dropping cached addresses of %.*s after connection failure.",
+                    ( int32_t ) hostNameLength,
+                    pHostName ) );
+        clearDnsCacheEntry( pEntry );
+        dnsCacheStats.invalidations++;
+    }
+
+    ( void ) pthread_mutex_unlock( &dnsCacheMutex );
+}
+/*-----------------------------------------------------------*/
+
+static SocketStatus_t raceConnections( const struct addrinfo * pListHead,
+                                       const ServerInfo_t * pServerInfo,
+                                       const struct timespec * pDeadline,
+                                       int32_t * pTcpSocket )
+{
+    SocketStatus_t returnStatus = SOCKETS_CONNECT_FAILURE;
+    const struct addrinfo * pAddresses[ SOCKETS_MAX_CONNECTION_ATTEMPTS ];
+    struct pollfd pollFds[ SOCKETS_MAX_CONNECTION_ATTEMPTS ];
+    size_t addressCount = 0U, nextAddress = 0U, pendingCount = 0U, index = 0U;
+    int32_t connectedSocket = -1, attemptSocket = -1;
+    int32_t remainingMs = 0, waitMs = 0, pollStatus = 0, socketError = 0, flags = 0;
+    socklen_t errorLength = 0;
+    uint8_t startNext = 1U, isConnected = 0U;
+
+    assert( pListHead != NULL );
+    assert( pServerInfo != NULL );
+    assert( pDeadline != NULL );
+    assert( pTcpSocket != NULL );
+
+    addressCount = orderAddresses( pListHead, pAddresses );
+
+    LogDebug( ( "Racing connections to %lu addresses of: Host=%.*s.",
+                ( unsigned long ) addressCount,
+                ( int32_t ) pServerInfo->hostNameLength,
+                pServerInfo->pHostName ) );
+
+    while( connectedSocket == -1 )
+    {
+        remainingMs = getRemainingTimeMs( pDeadline );
+
+        if( remainingMs == 0 )
+        {
+            LogError( ( "Timed out connecting to %.*s.",
+                        ( int32_t ) pServerInfo->hostNameLength,
+                        pServerInfo->pHostName ) );
+            break;
+        }
+
+        /* Start the next attempt when the previous one has had its head start
+         * or has failed. */
+        if( ( startNext == 1U ) && ( nextAddress < addressCount ) )
+        {
+            attemptSocket = startConnectionAttempt( pAddresses[ nextAddress ],
+                                                    pServerInfo->port,
+                                                    &isConnected );
+            nextAddress++;
+
+            if( isConnected == 1U )
+            {
+                connectedSocket = attemptSocket;
+            }
+            else if( attemptSocket != -1 )
+            {
+                pollFds[ pendingCount ].fd = attemptSocket;
+                pollFds[ pendingCount ].events = POLLOUT;
+                pollFds[ pendingCount ].revents = 0;
+                pendingCount++;
+                startNext = 0U;
+            }
+            else
+            {
+                /* Failed immediately, move on to the next address. */
+            }
+
+            continue;
+        }
+
+        if( pendingCount == 0U )
+        {
+            LogError( ( "Could not connect to any resolved IP address from %.*s.",
+                        ( int32_t ) pServerInfo->hostNameLength,
+                        pServerInfo->pHostName ) );
+            break;
+        }
+
+        waitMs = remainingMs;
+
+        if( ( nextAddress < addressCount ) && ( waitMs > SOCKETS_CONNECTION_ATTEMPT_DELAY_MS ) )
+        {
+            waitMs = SOCKETS_CONNECTION_ATTEMPT_DELAY_MS;
+        }
+
+        pollStatus = poll( pollFds, ( nfds_t ) pendingCount, waitMs );
+
+        if( pollStatus == 0 )
+        {
+            startNext = 1U;
+        }
+        else if( pollStatus < 0 )
+        {
+            if( errno != EINTR )
+            {
+                ( void ) retrieveError( errno );
+                break;
+            }
+        }
+        else
+        {
+            /* Iterate backwards so that failed attempts can be removed by
+             * moving the last pending attempt into their place. */
+            for( index = pendingCount; ( index > 0U ) && ( connectedSocket == -1 ); index-- )
+            {
+                if( pollFds[ index - 1U ].revents != 0 )
+                {
+                    socketError = 0;
+                    errorLength = ( socklen_t ) sizeof( socketError );
+
+                    if( ( getsockopt( pollFds[ index - 1U ].fd, SOL_SOCKET, SO_ERROR,
+                                      &socketError, &errorLength ) == 0 ) &&
+                        ( socketError == 0 ) )
+                    {
+                        connectedSocket = pollFds[ index - 1U ].fd;
+                    }
+                    else
+                    {
+                        LogWarn( ( "Connection attempt to a resolved address failed: %s.",
+                                   strerror( socketError ) ) );
+                        ( void ) close( pollFds[ index - 1U ].fd );
+
+                        /* A failed attempt lets the next one start at once. */
+                        startNext = 1U;
+                    }
+
+                    pendingCount--;
+                    pollFds[ index - 1U ] = pollFds[ pendingCount ];
+                }
+            }
+        }
+    }
+
+    /* Close the attempts that lost the race. */
+    for( index = 0U; index < pendingCount; index++ )
+    {
+        ( void ) close( pollFds[ index ].fd );
+    }
+
+    /* Restore blocking mode, which the transports rely on. */
+    if( connectedSocket != -1 )
+    {
+        flags = fcntl( connectedSocket, F_GETFL, 0 );
+
+        if( ( flags == -1 ) || ( fcntl( connectedSocket, F_SETFL, flags & ~O_NONBLOCK ) == -1 ) )
+        {
+            LogError( ( "Failed to restore blocking mode on the connected socket." ) );
+            ( void ) close( connectedSocket );
+        }
+        else
+        {
+            LogDebug( ( "Established TCP connection: Server=%.*s.",
+                        ( int32_t ) pServerInfo->hostNameLength,
+                        pServerInfo->pHostName ) );
+            *pTcpSocket = connectedSocket;
+            returnStatus = SOCKETS_SUCCESS;
+        }
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+SocketStatus_t Sockets_Connect( int32_t * pTcpSocket,
+                                const ServerInfo_t * pServerInfo,
+                                uint32_t sendTimeoutMs,
+                                uint32_t recvTimeoutMs )
+{
+    SocketStatus_t returnStatus = SOCKETS_SUCCESS;
+    struct addrinfo * pListHead = NULL;
+
+    if( pServerInfo == NULL )
+    {
+        LogError( ( "Parameter check failed: pServerInfo is NULL." ) );
+        returnStatus = SOCKETS_INVALID_PARAMETER;
+    }
+    else if( pServerInfo->pHostName == NULL )
+    {
+        LogError( ( "Parameter check failed: pServerInfo->pHostName is NULL." ) );
+        returnStatus = SOCKETS_INVALID_PARAMETER;
+    }
+    else if( pTcpSocket == NULL )
+    {
+        LogError( ( "Parameter check failed: pTcpSocket is NULL." ) );
+        returnStatus = SOCKETS_INVALID_PARAMETER;
+    }
+    else if( pServerInfo->hostNameLength == 0UL )
+    {
+        LogError( ( "Parameter check failed: hostNameLength must be greater than 0." ) );
+        returnStatus = SOCKETS_INVALID_PARAMETER;
+    }
+    else
+    {
+        /* Empty else. */
+    }
+
+    if( returnStatus == SOCKETS_SUCCESS )
+    {
+        returnStatus = resolveHostName( pServerInfo->pHostName,
+                                        pServerInfo->hostNameLength,
+                                        &pListHead );
+    }
+
+    if( returnStatus == SOCKETS_SUCCESS )
+    {
+        returnStatus = attemptConnection( pListHead,
+                                          pServerInfo->pHostName,
+                                          pServerInfo->hostNameLength,
+                                          pServerInfo->port,
+                                          pTcpSocket );
+
+        /* The cached addresses may be out of date; resolve again next time. */
+        if( returnStatus == SOCKETS_CONNECT_FAILURE )
+        {
+            invalidateDnsCache( pServerInfo->pHostName, pServerInfo->hostNameLength );
+        }
+    }
+
+    if( returnStatus == SOCKETS_SUCCESS )
+    {
+        returnStatus = setSocketTimeouts( *pTcpSocket, sendTimeoutMs, recvTimeoutMs );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+SocketStatus_t Sockets_ConnectParallel( int32_t * pTcpSocket,
+                                        const ServerInfo_t * pServerInfo,
+                                        uint32_t connectTimeoutMs,
+                                        uint32_t sendTimeoutMs,
+                                        uint32_t recvTimeoutMs )
+{
+    SocketStatus_t returnStatus = SOCKETS_SUCCESS;
+    struct addrinfo * pListHead = NULL;
+    struct timespec deadline;
+
+    if( pServerInfo == NULL )
+    {
+        LogError( ( "Parameter check failed: pServerInfo is NULL." ) );
+        returnStatus = SOCKETS_INVALID_PARAMETER;
+    }
+    else if( pServerInfo->pHostName == NULL )
+    {
+        LogError( ( "Parameter check failed: pServerInfo->pHostName is NULL." ) );
+        returnStatus = SOCKETS_INVALID_PARAMETER;
+    }
+    else if( pTcpSocket == NULL )
+    {
+        LogError( ( "Parameter check failed: pTcpSocket is NULL." ) );
+        returnStatus = SOCKETS_INVALID_PARAMETER;
+    }
+    else if( pServerInfo->hostNameLength == 0UL )
+    {
+        LogError( ( "Parameter check failed: hostNameLength must be greater than 0." ) );
+        returnStatus = SOCKETS_INVALID_PARAMETER;
+    }
+    else if( connectTimeoutMs == 0U )
+    {
+        LogError( ( "Parameter check failed: connectTimeoutMs must be greater than 0." ) );
+        returnStatus = SOCKETS_INVALID_PARAMETER;
+    }
+    else
+    {
+        /* Empty else. */
+    }
+
+    if( returnStatus == SOCKETS_SUCCESS )
+    {
+        ( void ) clock_gettime( CLOCK_MONOTONIC, &deadline );
+        deadline.tv_sec += ( time_t ) ( connectTimeoutMs / ( uint32_t ) ONE_SEC_TO_MS );
+        deadline.tv_nsec += ( long ) ( connectTimeoutMs % ( uint32_t ) ONE_SEC_TO_MS ) * ONE_MS_TO_NS;
+
+        if( deadline.tv_nsec >= ( ( long ) ONE_SEC_TO_MS * ONE_MS_TO_NS ) )
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= ( long ) ONE_SEC_TO_MS * ONE_MS_TO_NS;
+        }
+
+        returnStatus = resolveHostNameWithDeadline( pServerInfo->pHostName,
+                                                    pServerInfo->hostNameLength,
+                                                    &deadline,
+                                                    &pListHead );
+    }
+
+    if( returnStatus == SOCKETS_SUCCESS )
+    {
+        returnStatus = raceConnections( pListHead, pServerInfo, &deadline, pTcpSocket );
+        freeAddressList( pListHead );
+
+        /* The cached addresses may be out of date; resolve again next time. */
+        if( returnStatus == SOCKETS_CONNECT_FAILURE )
+        {
+            invalidateDnsCache( pServerInfo->pHostName, pServerInfo->hostNameLength );
+        }
+    }
+
+    if( returnStatus == SOCKETS_SUCCESS )
+    {
+        returnStatus = setSocketTimeouts( *pTcpSocket, sendTimeoutMs, recvTimeoutMs );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+void Sockets_GetDnsCacheStats( SocketsDnsCacheStats_t * pStats )
+{
+    if( pStats == NULL )
+    {
+        LogError( ( "Parameter check failed: pStats is NULL." ) );
+    }
+    else
+    {
+        ( void ) pthread_mutex_lock( &dnsCacheMutex );
+        *pStats = dnsCacheStats;
+        ( void ) pthread_mutex_unlock( &dnsCacheMutex );
+    }
+}
+/*-----------------------------------------------------------*/
+
+void Sockets_ClearDnsCache( void )
+{
+    size_t index = 0U;
+
+    ( void ) pthread_mutex_lock( &dnsCacheMutex );
+
+    for( index = 0U; index < SOCKETS_DNS_CACHE_SIZE; index++ )
+    {
+        clearDnsCacheEntry( &dnsCache[ index ] );
+    }
+
+    ( void ) memset( &dnsCacheStats, 0, sizeof( dnsCacheStats ) );
+
+    ( void ) pthread_mutex_unlock( &dnsCacheMutex );
+}
+/*-----------------------------------------------------------*/
+
 SocketStatus_t Sockets_Disconnect( int32_t tcpSocket )
 {
     SocketStatus_t returnStatus = SOCKETS_SUCCESS;
@@ -0,0 +1,688 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202211.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <string.h>
+#include <time.h>
+
+/* POSIX includes. */
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include "transport_reactor_posix.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Maximum number of events taken from the epoll instance at once.
+ *
+ * Kept small so that ready connections are spread over the worker threads
+ * instead of being handled in sequence by the thread that woke up first.
+ */
+#ifndef TRANSPORT_REACTOR_EVENTS_PER_WAIT
+    #define TRANSPORT_REACTOR_EVENTS_PER_WAIT    ( 8U )
+#endif
+
+/**
+ * @brief Interval in milliseconds at which connections are checked for
+ * #TransportReactorEntry_t.idleIntervalMs expiry.
+ */
+#ifndef TRANSPORT_REACTOR_SWEEP_INTERVAL_MS
+    #define TRANSPORT_REACTOR_SWEEP_INTERVAL_MS    ( 100U )
+#endif
+
+/**
+ * @brief Milliseconds per second.
+ */
+#define ONE_SEC_TO_MS                 ( 1000U )
+
+/**
+ * @brief Nanoseconds per millisecond.
+ */
+#define ONE_MS_TO_NS                  ( 1000000U )
+
+/**
+ * @brief epoll data value identifying the wake-up eventfd.
+ */
+#define TRANSPORT_REACTOR_WAKE_DATA    ( UINT64_MAX )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Get the current monotonic time in milliseconds.
+ *
+ * @return Monotonic time in milliseconds.
+ */
+static uint64_t getMonotonicTimeMs( void );
+
+/**
+ * @brief Convert TRANSPORT_REACTOR_EVENT_* flags to epoll events.
+ *
+ * @param[in] interestEvents Bitwise OR of TRANSPORT_REACTOR_EVENT_* flags.
+ *
+ * @return epoll events, armed for a single notification.
+ */
+static uint32_t toEpollEvents( uint32_t interestEvents );
+
+/**
+ * @brief Convert epoll events to TRANSPORT_REACTOR_EVENT_* flags.
+ *
+ * @param[in] epollEvents Events reported by epoll_wait.
+ *
+ * @return Bitwise OR of TRANSPORT_REACTOR_EVENT_* flags.
+ */
+static uint32_t fromEpollEvents( uint32_t epollEvents );
+
+/**
+ * @brief Build the epoll data of a slot from its index and generation.
+ *
+ * @param[in] slotIndex Index of the slot.
+ * @param[in] generation Generation of the slot.
+ *
+ * @return epoll data value.
+ */
+static uint64_t toEpollData( size_t slotIndex,
+                             uint32_t generation );
+
+/**
+ * @brief Free a slot whose mutex is held by the caller.
+ *
+ * @param[in] pReactor Reactor owning the slot.
+ * @param[in] slotIndex Index of the slot to free.
+ */
+static void freeSlotLocked( TransportReactor_t * pReactor,
+                            size_t slotIndex );
+
+/**
+ * @brief Invoke the callback of a slot whose mutex is held by the caller, and
+ * unregister or re-arm the connection depending on its result.
+ *
+ * @param[in] pReactor Reactor owning the slot.
+ * @param[in] slotIndex Index of the slot.
+ * @param[in] readyEvents Events passed to the callback.
+ * @param[in] rearm Whether the connection must be re-armed in epoll.
+ */
+static void invokeCallbackLocked( TransportReactor_t * pReactor,
+                                  size_t slotIndex,
+                                  uint32_t readyEvents,
+                                  uint8_t rearm );
+
+/**
+ * @brief Invoke the callback of connections idle for longer than their
+ * #TransportReactorEntry_t.idleIntervalMs.
+ *
+ * Only one thread sweeps at a time; slots whose callback is running are
+ * skipped since they are not idle.
+ *
+ * @param[in] pReactor Reactor to sweep.
+ *
+ * @return Number of callbacks invoked.
+ */
+static int32_t sweepIdleConnections( TransportReactor_t * pReactor );
+
+/**
+ * @brief Thread routine of the worker threads.
+ *
+ * @param[in] pArgs Reactor of the worker.
+ *
+ * @return Always NULL.
+ */
+static void * workerThread( void * pArgs );
+
+/*-----------------------------------------------------------*/
+
+static uint64_t getMonotonicTimeMs( void )
+{
+    struct timespec now = { 0 };
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ( ( uint64_t ) now.tv_sec * ONE_SEC_TO_MS ) +
+           ( ( uint64_t ) now.tv_nsec / ONE_MS_TO_NS );
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t toEpollEvents( uint32_t interestEvents )
+{
+    uint32_t epollEvents = ( uint32_t ) EPOLLONESHOT | ( uint32_t ) EPOLLRDHUP;
+
+    if( ( interestEvents & TRANSPORT_REACTOR_EVENT_READABLE ) != 0U )
+    {
+        epollEvents |= ( uint32_t ) EPOLLIN;
+    }
+
+    if( ( interestEvents & TRANSPORT_REACTOR_EVENT_WRITABLE ) != 0U )
+    {
+        epollEvents |= ( uint32_t ) EPOLLOUT;
+    }
+
+    return epollEvents;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t fromEpollEvents( uint32_t epollEvents )
+{
+    uint32_t readyEvents = 0U;
+
+    if( ( epollEvents & ( ( uint32_t ) EPOLLIN | ( uint32_t ) EPOLLRDHUP ) ) != 0U )
+    {
+        readyEvents |= TRANSPORT_REACTOR_EVENT_READABLE;
+    }
+
+    if( ( epollEvents & ( uint32_t ) EPOLLOUT ) != 0U )
+    {
+        readyEvents |= TRANSPORT_REACTOR_EVENT_WRITABLE;
+    }
+
+    if( ( epollEvents & ( ( uint32_t ) EPOLLERR | ( uint32_t ) EPOLLHUP ) ) != 0U )
+    {
+        readyEvents |= TRANSPORT_REACTOR_EVENT_ERROR;
+    }
+
+    return readyEvents;
+}
+/*-----------------------------------------------------------*/
+
+static uint64_t toEpollData( size_t slotIndex,
+                             uint32_t generation )
+{
+    return ( ( uint64_t ) slotIndex << 32 ) | ( uint64_t ) generation;
+}
+/*-----------------------------------------------------------*/
+
+static void freeSlotLocked( TransportReactor_t * pReactor,
+                            size_t slotIndex )
+{
+    TransportReactorSlot_t * pSlot = &pReactor->pSlots[ slotIndex ];
+
+    /* The socket may already be closed by the peer; removal is best effort as
+     * closing the socket removes it from the epoll instance anyway. */
+    ( void ) epoll_ctl( pReactor->epollDescriptor,
+                        EPOLL_CTL_DEL,
+                        pSlot->pEntry->socketDescriptor,
+                        NULL );
+
+    pSlot->pEntry = NULL;
+
+    /* Events already taken from the epoll instance by another thread carry
+     * the old generation and are ignored. */
+    pSlot->generation++;
+
+    ( void ) pthread_mutex_lock( &pReactor->mutex );
+    pSlot->nextFreeSlot = pReactor->freeSlot;
+    pReactor->freeSlot = slotIndex;
+    ( void ) pthread_mutex_unlock( &pReactor->mutex );
+}
+/*-----------------------------------------------------------*/
+
+static void invokeCallbackLocked( TransportReactor_t * pReactor,
+                                  size_t slotIndex,
+                                  uint32_t readyEvents,
+                                  uint8_t rearm )
+{
+    TransportReactorSlot_t * pSlot = &pReactor->pSlots[ slotIndex ];
+    TransportReactorEntry_t * pEntry = pSlot->pEntry;
+    struct epoll_event event;
+    int32_t callbackResult = 0;
+
+    callbackResult = pEntry->callback( pEntry, readyEvents );
+    pSlot->lastCallbackMs = getMonotonicTimeMs();
+
+    if( callbackResult != 0 )
+    {
+        LogDebug( ( "Unregistering socket %d at the request of its callback.",
+                    pEntry->socketDescriptor ) );
+        freeSlotLocked( pReactor, slotIndex );
+    }
+    else if( rearm == 1U )
+    {
+        ( void ) memset( &event, 0, sizeof( event ) );
+        event.events = toEpollEvents( pEntry->interestEvents );
+        event.data.u64 = toEpollData( slotIndex, pSlot->generation );
+
+        if( epoll_ctl( pReactor->epollDescriptor,
+                       EPOLL_CTL_MOD,
+                       pEntry->socketDescriptor,
+                       &event ) != 0 )
+        {
+            LogError( ( "Failed to re-arm socket %d: %s. Unregistering it.",
+                        pEntry->socketDescriptor,
+                        strerror( errno ) ) );
+            freeSlotLocked( pReactor, slotIndex );
+        }
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+}
+/*-----------------------------------------------------------*/
+
+static int32_t sweepIdleConnections( TransportReactor_t * pReactor )
+{
+    int32_t callbackCount = 0;
+    uint64_t nowMs = 0U;
+    size_t slotIndex = 0U;
+    TransportReactorSlot_t * pSlot = NULL;
+
+    if( pthread_mutex_trylock( &pReactor->sweepMutex ) == 0 )
+    {
+        nowMs = getMonotonicTimeMs();
+
+        if( nowMs >= pReactor->nextSweepMs )
+        {
+            pReactor->nextSweepMs = nowMs + TRANSPORT_REACTOR_SWEEP_INTERVAL_MS;
+
+            for( slotIndex = 0U; slotIndex < pReactor->slotCount; slotIndex++ )
+            {
+                pSlot = &pReactor->pSlots[ slotIndex ];
+
+                if( pthread_mutex_trylock( &pSlot->mutex ) == 0 )
+                {
+                    if( ( pSlot->pEntry != NULL ) &&
+                        ( pSlot->pEntry->idleIntervalMs > 0U ) &&
+                        ( ( nowMs - pSlot->lastCallbackMs ) >= pSlot->pEntry->idleIntervalMs ) )
+                    {
+                        invokeCallbackLocked( pReactor, slotIndex, 0U, 0U );
+                        callbackCount++;
+                    }
+
+                    ( void ) pthread_mutex_unlock( &pSlot->mutex );
+                }
+            }
+        }
+
+        ( void ) pthread_mutex_unlock( &pReactor->sweepMutex );
+    }
+
+    return callbackCount;
+}
+/*-----------------------------------------------------------*/
+
+static void * workerThread( void * pArgs )
+{
+    TransportReactor_t * pReactor = ( TransportReactor_t * ) pArgs;
+    uint8_t isStopping = 0U;
+
+    while( isStopping == 0U )
+    {
+        ( void ) TransportReactor_Dispatch( pReactor, TRANSPORT_REACTOR_SWEEP_INTERVAL_MS );
+
+        ( void ) pthread_mutex_lock( &pReactor->mutex );
+        isStopping = pReactor->isStopping;
+        ( void ) pthread_mutex_unlock( &pReactor->mutex );
+    }
+
+    return NULL;
+}
+/*-----------------------------------------------------------*/
+
+TransportReactorStatus_t TransportReactor_Init( TransportReactor_t * pReactor,
+                                                TransportReactorSlot_t * pSlots,
+                                                size_t slotCount,
+                                                size_t workerCount )
+{
+    TransportReactorStatus_t returnStatus = TRANSPORT_REACTOR_SUCCESS;
+    struct epoll_event event;
+    size_t slotIndex = 0U;
+
+    if( ( pReactor == NULL ) || ( pSlots == NULL ) || ( slotCount == 0U ) ||
+        ( slotCount > ( size_t ) UINT32_MAX ) )
+    {
+        LogError( ( "Parameter check failed: pReactor=%p, pSlots=%p, slotCount=%lu.",
+                    ( void * ) pReactor,
+                    ( void * ) pSlots,
+                    ( unsigned long ) slotCount ) );
+        returnStatus = TRANSPORT_REACTOR_INVALID_PARAMETER;
+    }
+    else if( workerCount > TRANSPORT_REACTOR_MAX_WORKERS )
+    {
+        LogError( ( "Parameter check failed: workerCount=%lu exceeds "
+                    "TRANSPORT_REACTOR_MAX_WORKERS=%u.",
+                    ( unsigned long ) workerCount,
+                    TRANSPORT_REACTOR_MAX_WORKERS ) );
+        returnStatus = TRANSPORT_REACTOR_INVALID_PARAMETER;
+    }
+    else
+    {
+        ( void ) memset( pReactor, 0, sizeof( TransportReactor_t ) );
+        pReactor->pSlots = pSlots;
+        pReactor->slotCount = slotCount;
+        pReactor->wakeDescriptor = -1;
+
+        for( slotIndex = 0U; slotIndex < slotCount; slotIndex++ )
+        {
+            ( void ) pthread_mutex_init( &pSlots[ slotIndex ].mutex, NULL );
+            pSlots[ slotIndex ].pEntry = NULL;
+            pSlots[ slotIndex ].generation = 0U;
+            pSlots[ slotIndex ].lastCallbackMs = 0U;
+            pSlots[ slotIndex ].nextFreeSlot = slotIndex + 1U;
+        }
+
+        pReactor->freeSlot = 0U;
+        ( void ) pthread_mutex_init( &pReactor->mutex, NULL );
+        ( void ) pthread_mutex_init( &pReactor->sweepMutex, NULL );
+
+        pReactor->epollDescriptor = epoll_create1( EPOLL_CLOEXEC );
+
+        if( pReactor->epollDescriptor < 0 )
+        {
+            LogError( ( "Failed to create epoll instance: %s.", strerror( errno ) ) );
+            returnStatus = TRANSPORT_REACTOR_API_ERROR;
+        }
+    }
+
+    if( returnStatus == TRANSPORT_REACTOR_SUCCESS )
+    {
+        /* The eventfd is registered level-triggered and never read, so that
+         * once signalled it wakes every worker blocked in epoll_wait. */
+        pReactor->wakeDescriptor = eventfd( 0U, EFD_CLOEXEC | EFD_NONBLOCK );
+
+        ( void ) memset( &event, 0, sizeof( event ) );
+        event.events = ( uint32_t ) EPOLLIN;
+        event.data.u64 = TRANSPORT_REACTOR_WAKE_DATA;
+
+        if( ( pReactor->wakeDescriptor < 0 ) ||
+            ( epoll_ctl( pReactor->epollDescriptor,
+                         EPOLL_CTL_ADD,
+                         pReactor->wakeDescriptor,
+                         &event ) != 0 ) )
+        {
+            LogError( ( "Failed to set up wake-up eventfd: %s.", strerror( errno ) ) );
+            returnStatus = TRANSPORT_REACTOR_API_ERROR;
+        }
+    }
+
+    while( ( returnStatus == TRANSPORT_REACTOR_SUCCESS ) &&
+           ( pReactor->workerCount < workerCount ) )
+    {
+        if( pthread_create( &pReactor->workers[ pReactor->workerCount ],
+                            NULL,
+                            workerThread,
+                            pReactor ) != 0 )
+        {
+            LogError( ( "Failed to create reactor worker thread %lu.",
+                        ( unsigned long ) pReactor->workerCount ) );
+            returnStatus = TRANSPORT_REACTOR_API_ERROR;
+        }
+        else
+        {
+            pReactor->workerCount++;
+        }
+    }
+
+    if( ( returnStatus == TRANSPORT_REACTOR_API_ERROR ) && ( pReactor != NULL ) )
+    {
+        /* Stops the workers already started and frees the descriptors. */
+        ( void ) TransportReactor_Deinit( pReactor );
+    }
+    else if( returnStatus == TRANSPORT_REACTOR_SUCCESS )
+    {
+        LogDebug( ( "Created reactor with %lu slots and %lu worker threads.",
+                    ( unsigned long ) slotCount,
+                    ( unsigned long ) workerCount ) );
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+TransportReactorStatus_t TransportReactor_Register( TransportReactor_t * pReactor,
+                                                    TransportReactorEntry_t * pEntry )
+{
+    TransportReactorStatus_t returnStatus = TRANSPORT_REACTOR_SUCCESS;
+    TransportReactorSlot_t * pSlot = NULL;
+    struct epoll_event event;
+    size_t slotIndex = 0U;
+
+    if( ( pReactor == NULL ) || ( pEntry == NULL ) ||
+        ( pEntry->callback == NULL ) || ( pEntry->socketDescriptor < 0 ) )
+    {
+        LogError( ( "Parameter check failed: pReactor=%p, pEntry=%p.",
+                    ( void * ) pReactor,
+                    ( void * ) pEntry ) );
+        returnStatus = TRANSPORT_REACTOR_INVALID_PARAMETER;
+    }
+    else
+    {
+        ( void ) pthread_mutex_lock( &pReactor->mutex );
+        slotIndex = pReactor->freeSlot;
+
+        if( slotIndex < pReactor->slotCount )
+        {
+            pReactor->freeSlot = pReactor->pSlots[ slotIndex ].nextFreeSlot;
+        }
+
+        ( void ) pthread_mutex_unlock( &pReactor->mutex );
+
+        if( slotIndex >= pReactor->slotCount )
+        {
+            LogError( ( "Cannot register socket %d: all %lu slots are in use.",
+                        pEntry->socketDescriptor,
+                        ( unsigned long ) pReactor->slotCount ) );
+            returnStatus = TRANSPORT_REACTOR_NO_FREE_SLOT;
+        }
+    }
+
+    if( returnStatus == TRANSPORT_REACTOR_SUCCESS )
+    {
+        pSlot = &pReactor->pSlots[ slotIndex ];
+        pEntry->slotIndex = slotIndex;
+
+        ( void ) pthread_mutex_lock( &pSlot->mutex );
+        pSlot->pEntry = pEntry;
+        pSlot->lastCallbackMs = getMonotonicTimeMs();
+
+        ( void ) memset( &event, 0, sizeof( event ) );
+        event.events = toEpollEvents( pEntry->interestEvents );
+        event.data.u64 = toEpollData( slotIndex, pSlot->generation );
+
+        if( epoll_ctl( pReactor->epollDescriptor,
+                       EPOLL_CTL_ADD,
+                       pEntry->socketDescriptor,
+                       &event ) != 0 )
+        {
+            LogError( ( "Failed to add socket %d to epoll instance: %s.",
+                        pEntry->socketDescriptor,
+                        strerror( errno ) ) );
+            freeSlotLocked( pReactor, slotIndex );
+            returnStatus = TRANSPORT_REACTOR_API_ERROR;
+        }
+
+        ( void ) pthread_mutex_unlock( &pSlot->mutex );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+TransportReactorStatus_t TransportReactor_Unregister( TransportReactor_t * pReactor,
+                                                      TransportReactorEntry_t * pEntry )
+{
+    TransportReactorStatus_t returnStatus = TRANSPORT_REACTOR_SUCCESS;
+    TransportReactorSlot_t * pSlot = NULL;
+
+    if( ( pReactor == NULL ) || ( pEntry == NULL ) ||
+        ( pEntry->slotIndex >= pReactor->slotCount ) )
+    {
+        LogError( ( "Parameter check failed: pReactor=%p, pEntry=%p.",
+                    ( void * ) pReactor,
+                    ( void * ) pEntry ) );
+        returnStatus = TRANSPORT_REACTOR_INVALID_PARAMETER;
+    }
+    else
+    {
+        pSlot = &pReactor->pSlots[ pEntry->slotIndex ];
+
+        /* Waits for a running callback of the connection to return. */
+        ( void ) pthread_mutex_lock( &pSlot->mutex );
+
+        if( pSlot->pEntry == pEntry )
+        {
+            freeSlotLocked( pReactor, pEntry->slotIndex );
+        }
+        else
+        {
+            LogError( ( "Socket %d is not registered with the reactor.",
+                        pEntry->socketDescriptor ) );
+            returnStatus = TRANSPORT_REACTOR_INVALID_PARAMETER;
+        }
+
+        ( void ) pthread_mutex_unlock( &pSlot->mutex );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+int32_t TransportReactor_Dispatch( TransportReactor_t * pReactor,
+                                   uint32_t timeoutMs )
+{
+    int32_t callbackCount = 0;
+    int32_t eventCount = 0;
+    int32_t eventIndex = 0;
+    struct epoll_event events[ TRANSPORT_REACTOR_EVENTS_PER_WAIT ];
+    TransportReactorSlot_t * pSlot = NULL;
+    size_t slotIndex = 0U;
+    uint32_t generation = 0U;
+
+    if( pReactor == NULL )
+    {
+        LogError( ( "Parameter check failed: pReactor is NULL." ) );
+        callbackCount = -1;
+    }
+    else
+    {
+        /* Wake up in time to invoke the callbacks of idle connections. */
+        if( timeoutMs > TRANSPORT_REACTOR_SWEEP_INTERVAL_MS )
+        {
+            timeoutMs = TRANSPORT_REACTOR_SWEEP_INTERVAL_MS;
+        }
+
+        eventCount = epoll_wait( pReactor->epollDescriptor,
+                                 events,
+                                 ( int ) TRANSPORT_REACTOR_EVENTS_PER_WAIT,
+                                 ( int ) timeoutMs );
+
+        if( ( eventCount < 0 ) && ( errno != EINTR ) )
+        {
+            LogError( ( "epoll_wait failed: %s.", strerror( errno ) ) );
+            callbackCount = -1;
+        }
+    }
+
+    for( eventIndex = 0; eventIndex < eventCount; eventIndex++ )
+    {
+        if( events[ eventIndex ].data.u64 != TRANSPORT_REACTOR_WAKE_DATA )
+        {
+            slotIndex = ( size_t ) ( events[ eventIndex ].data.u64 >> 32 );
+            generation = ( uint32_t ) events[ eventIndex ].data.u64;
+            pSlot = &pReactor->pSlots[ slotIndex ];
+
+            ( void ) pthread_mutex_lock( &pSlot->mutex );
+
+            /* The connection may have been unregistered, and the slot
+             * reused, after the event was reported. */
+            if( ( pSlot->pEntry != NULL ) && ( pSlot->generation == generation ) )
+            {
+                invokeCallbackLocked( pReactor,
+                                      slotIndex,
+                                      fromEpollEvents( events[ eventIndex ].events ),
+                                      1U );
+                callbackCount++;
+            }
+
+            ( void ) pthread_mutex_unlock( &pSlot->mutex );
+        }
+    }
+
+    if( callbackCount >= 0 )
+    {
+        callbackCount += sweepIdleConnections( pReactor );
+    }
+
+    return callbackCount;
+}
+/*-----------------------------------------------------------*/
+
+TransportReactorStatus_t TransportReactor_Deinit( TransportReactor_t * pReactor )
+{
+    TransportReactorStatus_t returnStatus = TRANSPORT_REACTOR_SUCCESS;
+    uint64_t wakeValue = 1U;
+    size_t index = 0U;
+
+    if( pReactor == NULL )
+    {
+        LogError( ( "Parameter check failed: pReactor is NULL." ) );
+        returnStatus = TRANSPORT_REACTOR_INVALID_PARAMETER;
+    }
+    else
+    {
+        ( void ) pthread_mutex_lock( &pReactor->mutex );
+        pReactor->isStopping = 1U;
+        ( void ) pthread_mutex_unlock( &pReactor->mutex );
+
+        if( pReactor->wakeDescriptor >= 0 )
+        {
+            ( void ) write( pReactor->wakeDescriptor, &wakeValue, sizeof( wakeValue ) );
+        }
+
+        /* Workers also notice the stop flag within
+         * TRANSPORT_REACTOR_SWEEP_INTERVAL_MS should the wake-up fail. */
+        for( index = 0U; index < pReactor->workerCount; index++ )
+        {
+            ( void ) pthread_join( pReactor->workers[ index ], NULL );
+        }
+
+        pReactor->workerCount = 0U;
+
+        if( pReactor->wakeDescriptor >= 0 )
+        {
+            ( void ) close( pReactor->wakeDescriptor );
+            pReactor->wakeDescriptor = -1;
+        }
+
+        if( pReactor->epollDescriptor >= 0 )
+        {
+            ( void ) close( pReactor->epollDescriptor );
+            pReactor->epollDescriptor = -1;
+        }
+
+        for( index = 0U; index < pReactor->slotCount; index++ )
+        {
+            ( void ) pthread_mutex_destroy( &pReactor->pSlots[ index ].mutex );
+        }
+
+        ( void ) pthread_mutex_destroy( &pReactor->sweepMutex );
+        ( void ) pthread_mutex_destroy( &pReactor->mutex );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/